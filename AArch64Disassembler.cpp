@@ -0,0 +1,241 @@
+#include "AArch64Disassembler.h"
+#include "AArch64Instructions.h"
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+uint32_t field(uint32_t encoding, uint32_t shift) {
+    return (encoding >> shift) & 0x1F;
+}
+
+int64_t signExtend(uint32_t value, int bits) {
+    int64_t shifted = static_cast<int64_t>(value) << (64 - bits);
+    return shifted >> (64 - bits);
+}
+
+std::string reg(uint32_t r) {
+    return AArch64Disassembler::registerName(r, false);
+}
+
+std::string regOrSp(uint32_t r) {
+    return AArch64Disassembler::registerName(r, true);
+}
+
+std::string wreg(uint32_t r) {
+    return r == 31 ? "wzr" : "w" + std::to_string(r);
+}
+
+std::string immediate(int64_t value) {
+    return "#" + std::to_string(value);
+}
+
+// The label name when known, otherwise the PC-relative byte offset
+std::string branchTarget(const std::string& target, int64_t offset) {
+    return target.empty() ? immediate(offset) : target;
+}
+
+std::string memory(uint32_t base, int64_t offset, bool alwaysShowOffset) {
+    std::string text = "[" + regOrSp(base);
+    if (offset != 0 || alwaysShowOffset) {
+        text += ", " + immediate(offset);
+    }
+    return text + "]";
+}
+
+std::string word(uint32_t encoding) {
+    std::ostringstream ss;
+    ss << ".word 0x" << std::hex << std::setw(8) << std::setfill('0') << encoding;
+    return ss.str();
+}
+
+} // namespace
+
+std::string AArch64Disassembler::registerName(uint32_t reg, bool stackPointer) {
+    if (reg == 31) {
+        return stackPointer ? "sp" : "xzr";
+    }
+    return reg <= 30 ? "x" + std::to_string(reg) : "unknown";
+}
+
+std::string AArch64Disassembler::disassemble(uint32_t enc, const std::string& target) {
+    const uint32_t rd = field(enc, 0);
+    const uint32_t rn = field(enc, 5);
+    const uint32_t rm = field(enc, 16);
+    const uint32_t ra = field(enc, 10);
+
+    if (enc == 0xD503201F) {
+        return "nop";
+    }
+    if (enc == 0xD65F03C0) {
+        return "ret";
+    }
+    if ((enc & 0xFFFFFC1F) == 0xD65F0000) {
+        return "ret " + reg(rn);
+    }
+    if ((enc & 0xFFFFFC1F) == 0xD61F0000) {
+        return "br " + reg(rn);
+    }
+    if ((enc & 0xFFFFFC1F) == 0xD63F0000) {
+        return "blr " + reg(rn);
+    }
+
+    // Branches and adr
+    if ((enc & 0x7C000000) == 0x14000000) {
+        const int64_t offset = signExtend(enc & 0x03FFFFFF, 26) * 4;
+        return std::string((enc & 0x80000000) ? "bl " : "b ") + branchTarget(target, offset);
+    }
+    if ((enc & 0xFF000010) == 0x54000000) {
+        const int64_t offset = signExtend((enc >> 5) & 0x7FFFF, 19) * 4;
+        return "b." + AArch64Instructions::conditionName(enc & 0xF) + " " + branchTarget(target, offset);
+    }
+    if ((enc & 0x7E000000) == 0x34000000) {
+        const int64_t offset = signExtend((enc >> 5) & 0x7FFFF, 19) * 4;
+        const std::string rt = (enc & 0x80000000) ? reg(rd) : wreg(rd);
+        return std::string((enc & 0x01000000) ? "cbnz " : "cbz ") + rt + ", " + branchTarget(target, offset);
+    }
+    if ((enc & 0x7E000000) == 0x36000000) {
+        const int64_t offset = signExtend((enc >> 5) & 0x3FFF, 14) * 4;
+        const uint32_t bitNumber = ((enc >> 31) << 5) | ((enc >> 19) & 0x1F);
+        return std::string((enc & 0x01000000) ? "tbnz " : "tbz ") + reg(rd) + ", " + immediate(bitNumber) + ", " +
+               branchTarget(target, offset);
+    }
+    if ((enc & 0x9F000000) == 0x10000000) {
+        const int64_t offset = signExtend((((enc >> 5) & 0x7FFFF) << 2) | ((enc >> 29) & 0x3), 21);
+        return "adr " + reg(rd) + ", " + branchTarget(target, offset);
+    }
+    if ((enc & 0x9F000000) == 0x90000000) {
+        const int64_t pages = signExtend((((enc >> 5) & 0x7FFFF) << 2) | ((enc >> 29) & 0x3), 21);
+        return "adrp " + reg(rd) + ", " + branchTarget(target, pages * 4096);
+    }
+
+    // Move wide
+    if ((enc & 0xFF800000) == 0xD2800000 || (enc & 0xFF800000) == 0xF2800000 ||
+        (enc & 0xFF800000) == 0x92800000) {
+        const char* mnemonic = (enc & 0xFF800000) == 0xD2800000 ? "movz "
+                             : (enc & 0xFF800000) == 0xF2800000 ? "movk " : "movn ";
+        std::ostringstream ss;
+        ss << mnemonic << reg(rd) << ", #0x" << std::hex << ((enc >> 5) & 0xFFFF);
+        const uint32_t hw = (enc >> 21) & 3;
+        if (hw) {
+            ss << ", lsl #" << std::dec << (hw * 16);
+        }
+        return ss.str();
+    }
+
+    // Add/subtract (immediate); register 31 is SP except as the target of adds/subs
+    if ((enc & 0xFF000000) == 0x91000000 || (enc & 0xFF000000) == 0xD1000000 ||
+        (enc & 0xFF000000) == 0xF1000000 || (enc & 0xFF000000) == 0xB1000000) {
+        const int64_t imm = static_cast<int64_t>((enc >> 10) & 0xFFF) << ((enc & (1U << 22)) ? 12 : 0);
+        const bool setsFlags = enc & 0x20000000;
+        const bool subtract = enc & 0x40000000;
+        if (!target.empty()) { // Low 12 bits of a label's address, after an adrp
+            return "add " + regOrSp(rd) + ", " + regOrSp(rn) + ", :lo12:" + target;
+        }
+        if (setsFlags && rd == 31) {
+            return std::string(subtract ? "cmp " : "cmn ") + regOrSp(rn) + ", " + immediate(imm);
+        }
+        if (!setsFlags && !subtract && imm == 0 && (rd == 31 || rn == 31)) {
+            return "mov " + regOrSp(rd) + ", " + regOrSp(rn);
+        }
+        const std::string mnemonic = std::string(subtract ? "sub" : "add") + (setsFlags ? "s " : " ");
+        return mnemonic + (setsFlags ? reg(rd) : regOrSp(rd)) + ", " + regOrSp(rn) + ", " + immediate(imm);
+    }
+
+    // Logical and add/subtract (shifted register)
+    const uint32_t shiftedRegister = enc & 0xFF200000;
+    if (shiftedRegister == 0xAA000000 || shiftedRegister == 0x8A000000 || shiftedRegister == 0xCA000000 ||
+        shiftedRegister == 0xAA200000 || shiftedRegister == 0x8B000000 || shiftedRegister == 0xCB000000 ||
+        shiftedRegister == 0xAB000000 || shiftedRegister == 0xEB000000) {
+        static const char* const SHIFTS[] = {"lsl", "lsr", "asr", "ror"};
+        const uint32_t amount = (enc >> 10) & 0x3F;
+        const std::string shift = amount ? std::string(", ") + SHIFTS[(enc >> 22) & 3] + " " + immediate(amount) : "";
+
+        if (amount == 0 && rn == 31 && shiftedRegister == 0xAA000000) {
+            return "mov " + reg(rd) + ", " + reg(rm);
+        }
+        if (rn == 31 && shiftedRegister == 0xAA200000) {
+            return "mvn " + reg(rd) + ", " + reg(rm) + shift;
+        }
+        if (rn == 31 && shiftedRegister == 0xCB000000) {
+            return "neg " + reg(rd) + ", " + reg(rm) + shift;
+        }
+        if (rd == 31 && shiftedRegister == 0xEB000000) {
+            return "cmp " + reg(rn) + ", " + reg(rm) + shift;
+        }
+        const char* mnemonic = shiftedRegister == 0xAA000000 ? "orr "
+                             : shiftedRegister == 0x8A000000 ? "and "
+                             : shiftedRegister == 0xCA000000 ? "eor "
+                             : shiftedRegister == 0xAA200000 ? "orn "
+                             : shiftedRegister == 0x8B000000 ? "add "
+                             : shiftedRegister == 0xCB000000 ? "sub "
+                             : shiftedRegister == 0xAB000000 ? "adds " : "subs ";
+        return mnemonic + reg(rd) + ", " + reg(rn) + ", " + reg(rm) + shift;
+    }
+
+    // Data processing (2 source), 64- and 32-bit
+    if ((enc & 0x7FE00000) == 0x1AC00000) {
+        const char* mnemonic = nullptr;
+        switch ((enc >> 10) & 0x3F) {
+            case 0x02: mnemonic = "udiv "; break;
+            case 0x03: mnemonic = "sdiv "; break;
+            case 0x08: mnemonic = "lslv "; break;
+            case 0x09: mnemonic = "lsrv "; break;
+            case 0x0A: mnemonic = "asrv "; break;
+            case 0x0B: mnemonic = "rorv "; break;
+        }
+        if (mnemonic) {
+            if (enc & 0x80000000) {
+                return mnemonic + reg(rd) + ", " + reg(rn) + ", " + reg(rm);
+            }
+            return mnemonic + wreg(rd) + ", " + wreg(rn) + ", " + wreg(rm);
+        }
+    }
+
+    // madd/msub (mul is madd with xzr)
+    if ((enc & 0xFFE00000) == 0x9B000000) {
+        if (enc & 0x8000) {
+            return "msub " + reg(rd) + ", " + reg(rn) + ", " + reg(rm) + ", " + reg(ra);
+        }
+        if (ra == 31) {
+            return "mul " + reg(rd) + ", " + reg(rn) + ", " + reg(rm);
+        }
+        return "madd " + reg(rd) + ", " + reg(rn) + ", " + reg(rm) + ", " + reg(ra);
+    }
+
+    // Bitfield move, as emitted by AArch64Instructions::lsl (immr holds the shift)
+    if ((enc & 0xFFC00000) == 0x53400000) {
+        return "lsl " + reg(rd) + ", " + reg(rn) + ", " + immediate((enc >> 16) & 0x3F);
+    }
+
+    // Conditional select: cset/csetm are csinc/csinv of xzr with the inverted condition
+    if ((enc & 0xFFE00C00) == 0x9A800400 || (enc & 0xFFE00C00) == 0xDA800000 ||
+        (enc & 0xFFE00C00) == 0x9A800000 || (enc & 0xFFE00C00) == 0xDA800400) {
+        const uint32_t cond = (enc >> 12) & 0xF;
+        const bool increment = enc & 0x400;
+        const bool invert = enc & 0x40000000;
+        if (rn == 31 && rm == 31 && (increment != invert)) {
+            return std::string(increment ? "cset " : "csetm ") + reg(rd) + ", " +
+                   AArch64Instructions::conditionName(cond ^ 1);
+        }
+        const char* mnemonic = invert ? (increment ? "csneg " : "csinv ") : (increment ? "csinc " : "csel ");
+        return mnemonic + reg(rd) + ", " + reg(rn) + ", " + reg(rm) + ", " + AArch64Instructions::conditionName(cond);
+    }
+
+    // Loads and stores (64-bit)
+    if ((enc & 0xFFC00000) == 0xF9000000 || (enc & 0xFFC00000) == 0xF9400000) {
+        const int64_t offset = static_cast<int64_t>((enc >> 10) & 0xFFF) * 8;
+        return std::string((enc & 0x00400000) ? "ldr " : "str ") + reg(rd) + ", " + memory(rn, offset, false);
+    }
+    if ((enc & 0xFFE00C00) == 0xF8000000 || (enc & 0xFFE00C00) == 0xF8400000) {
+        const int64_t offset = signExtend((enc >> 12) & 0x1FF, 9);
+        return std::string((enc & 0x00400000) ? "ldr " : "str ") + reg(rd) + ", " + memory(rn, offset, false);
+    }
+    if ((enc & 0xFFC00000) == 0xA9000000 || (enc & 0xFFC00000) == 0xA9400000) {
+        const int64_t offset = signExtend((enc >> 15) & 0x7F, 7) * 8;
+        return std::string((enc & 0x00400000) ? "ldp " : "stp ") + reg(rd) + ", " + reg(ra) + ", " +
+               memory(rn, offset, true);
+    }
+
+    return word(enc);
+}
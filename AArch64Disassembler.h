@@ -0,0 +1,28 @@
+// AArch64Disassembler.h
+#ifndef AARCH64_DISASSEMBLER_H
+#define AARCH64_DISASSEMBLER_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class AArch64Disassembler
+ * @brief Renders 32-bit AArch64 encodings as assembly text.
+ *
+ * Instructions are stored as encodings only; their text is produced here when
+ * a listing or a test asks for it. Every form AArch64Instructions emits is
+ * recognised, including the aliases it was written with (mov, cmp, neg, mvn,
+ * cset, csetm). Branches, calls, adr and adrp print @p target when one is
+ * given and the offset held in the encoding otherwise; an add given a target
+ * adds the low 12 bits (:lo12:) of its address. Anything else is shown as a
+ * .word directive.
+ */
+class AArch64Disassembler {
+public:
+    static std::string disassemble(uint32_t encoding, const std::string& target = "");
+
+    /// x0-x30; register 31 is sp or xzr depending on the operand.
+    static std::string registerName(uint32_t reg, bool stackPointer = false);
+};
+
+#endif // AARCH64_DISASSEMBLER_H
@@ -1,10 +1,7 @@
 #include "AArch64Instructions.h"
-#include "LabelManager.h"
+#include "AArch64Disassembler.h"
+#include <algorithm>
 #include <stdexcept>
-#include <sstream>
-#include <iomanip>
-#include <algorithm> // For std::sort
-#include <map>       // For std::map
 
 // Define static members
 const uint32_t AArch64Instructions::X0;
@@ -15,46 +12,109 @@ const uint32_t AArch64Instructions::X29;
 const uint32_t AArch64Instructions::X30;
 const uint32_t AArch64Instructions::SP;
 const uint32_t AArch64Instructions::XZR;
+const uint32_t AArch64Instructions::NoLabel;
+const uint32_t AArch64Instructions::NoComment;
 
-void AArch64Instructions::setPendingLabel(const std::string& label) {
-    pendingLabel_ = label;
+void AArch64Instructions::setPendingLabel(Label label) {
+    if (label.id >= labels_.size()) {
+        throw std::runtime_error("Invalid label handle");
+    }
+    if (labels_[label.id].bound) {
+        throw std::runtime_error("Label already defined: " + labelName(label));
+    }
+    labels_[label.id].bound = true;
+    if (pendingLabel_ != NoLabel) {
+        // Two labels at the same address: give the first one its own NOP so neither is lost
+        const uint32_t first = pendingLabel_;
+        nop([&] { return "Label " + labelName(first); });
+    }
+    pendingLabel_ = label.id;
+}
+
+AArch64Instructions::Label AArch64Instructions::newLabel(const char* prefix) {
+    LabelEntry entry;
+    entry.prefix = prefix;
+    entry.serial = labelSerial_++;
+    labels_.push_back(entry);
+    return Label{static_cast<uint32_t>(labels_.size() - 1)};
+}
+
+AArch64Instructions::Label AArch64Instructions::namedLabel(const std::string& name) {
+    auto it = labelIds_.find(name);
+    if (it != labelIds_.end()) {
+        return Label{it->second};
+    }
+    LabelEntry entry;
+    entry.name = static_cast<uint32_t>(labelNames_.size());
+    labelNames_.push_back(name);
+    labels_.push_back(entry);
+    uint32_t id = static_cast<uint32_t>(labels_.size() - 1);
+    labelIds_.emplace(name, id);
+    return Label{id};
+}
+
+std::string AArch64Instructions::labelName(uint32_t id) const {
+    if (id >= labels_.size()) {
+        return "";
+    }
+    const LabelEntry& entry = labels_[id];
+    if (entry.name != NoLabel) {
+        return labelNames_[entry.name];
+    }
+    return std::string(entry.prefix) + "_" + std::to_string(entry.serial);
+}
+
+const std::string& AArch64Instructions::commentOf(const Instruction& instr) const {
+    static const std::string none;
+    return instr.comment < comments_.size() ? comments_[instr.comment] : none;
+}
+
+std::string AArch64Instructions::disassemble(const Instruction& instr) const {
+    return AArch64Disassembler::disassemble(instr.encoding, labelName(instr.target));
 }
 
-void AArch64Instructions::addInstruction(Instruction instr) {
-    if (!pendingLabel_.empty()) {
-        instr.hasLabel = true;
-        instr.label = pendingLabel_;
-        pendingLabel_.clear();
+void AArch64Instructions::addInstruction(uint32_t encoding, Comment comment) {
+    Instruction instr;
+    instr.encoding = encoding;
+    instr.label = pendingLabel_;
+    pendingLabel_ = NoLabel;
+    if (keepComments_) {
+        std::string text = comment.str();
+        if (!text.empty()) {
+            instr.comment = static_cast<uint32_t>(comments_.size());
+            comments_.push_back(std::move(text));
+        }
     }
     instructions.push_back(instr);
 }
 
-void AArch64Instructions::mov(uint32_t rd, uint32_t rm, const std::string& comment) {
-    uint32_t encoding = 0xAA0003E0 | (rm << 16) | rd;
-    addInstruction({encoding, "mov " + regName(rd) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+void AArch64Instructions::addBranch(uint32_t encoding, Label label, Comment comment) {
+    if (label.id >= labels_.size()) {
+        throw std::runtime_error("Invalid label handle");
+    }
+    addInstruction(encoding, comment);
+    instructions.back().target = label.id;
+    instructions.back().needsLabelResolution = true;
 }
 
-void AArch64Instructions::movz(uint32_t rd, uint16_t imm16, uint8_t shift, const std::string& comment) {
+void AArch64Instructions::mov(uint32_t rd, uint32_t rm, Comment comment) {
+    // MOV to/from SP is an alias of ADD (immediate); the ORR form would read XZR.
+    uint32_t encoding = (rd == SP || rm == SP) ? (0x91000000 | (rm << 5) | rd)
+                                               : (0xAA0003E0 | (rm << 16) | rd);
+    addInstruction(encoding, comment);
+}
+
+void AArch64Instructions::movz(uint32_t rd, uint16_t imm16, uint8_t shift, Comment comment) {
     uint32_t encoding = 0xD2800000 | (static_cast<uint32_t>(shift) << 21) | (imm16 << 5) | rd;
-    std::stringstream ss;
-    ss << "movz " << regName(rd) << ", #0x" << std::hex << imm16;
-    if (shift) {
-        ss << ", lsl #" << (shift * 16);
-    }
-    addInstruction({encoding, ss.str(), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::movk(uint32_t rd, uint16_t imm16, uint8_t shift, const std::string& comment) {
+void AArch64Instructions::movk(uint32_t rd, uint16_t imm16, uint8_t shift, Comment comment) {
     uint32_t encoding = 0xF2800000 | (static_cast<uint32_t>(shift) << 21) | (imm16 << 5) | rd;
-    std::stringstream ss;
-    ss << "movk " << regName(rd) << ", #0x" << std::hex << imm16;
-    if (shift) {
-        ss << ", lsl #" << (shift * 16);
-    }
-    addInstruction({encoding, ss.str(), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::add(uint32_t rd, uint32_t rn, uint32_t rm, ShiftType shift_type, uint32_t shift_amount, const std::string& comment) {
+void AArch64Instructions::add(uint32_t rd, uint32_t rn, uint32_t rm, ShiftType shift_type, uint32_t shift_amount, Comment comment) {
     uint32_t encoding = 0x8B000000 | (rm << 16) | (rn << 5) | rd;
     // Add shift encoding
     switch (shift_type) {
@@ -64,86 +124,76 @@ void AArch64Instructions::add(uint32_t rd, uint32_t rn, uint32_t rm, ShiftType s
         case ROR: encoding |= (0b11 << 22); break;
     }
     encoding |= (shift_amount << 10);
-
-    std::string shift_str;
-    if (shift_amount > 0) {
-        switch (shift_type) {
-            case LSL: shift_str = ", lsl #" + std::to_string(shift_amount); break;
-            case LSR: shift_str = ", lsr #" + std::to_string(shift_amount); break;
-            case ASR: shift_str = ", asr #" + std::to_string(shift_amount); break;
-            case ROR: shift_str = ", ror #" + std::to_string(shift_amount); break;
-        }
-    }
-    addInstruction({encoding, "add " + regName(rd) + ", " + regName(rn) + ", " + regName(rm) + shift_str, comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::add(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment) {
+void AArch64Instructions::add(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment) {
     uint32_t encoding = 0x91000000 | (imm << 10) | (rn << 5) | rd;
-    addInstruction({encoding, "add " + regName(rd) + ", " + regName(rn) + ", #" + std::to_string(imm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
 
 
-void AArch64Instructions::sub(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::sub(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0xCB000000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "sub " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
 // Add this new function for subtracting an immediate value
-void AArch64Instructions::sub_imm(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment) {
+void AArch64Instructions::sub_imm(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment) {
     // SUB rd, rn, #imm
     // Base encoding for 64-bit SUB (immediate) is 0xD1000000
     uint32_t encoding = 0xD1000000 | (imm << 10) | (rn << 5) | rd;
-    addInstruction({encoding, "sub " + regName(rd) + ", " + regName(rn) + ", #" + std::to_string(imm), comment});
+    addInstruction(encoding, comment);
 }
 
 // Rename your existing register-based sub function to this
-void AArch64Instructions::sub_reg(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::sub_reg(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     // SUB rd, rn, rm
     // Base encoding for 64-bit SUB (register) is 0xCB000000
     uint32_t encoding = 0xCB000000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "sub " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment});
+    addInstruction(encoding, comment);
 }
 
 
-void AArch64Instructions::mul(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::mul(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0x9B007C00 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "mul " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::sdiv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
-    addInstruction({0x9AC00C00 | (rm << 16) | (rn << 5) | rd, "sdiv " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment});
+void AArch64Instructions::sdiv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
+    addInstruction(0x9AC00C00 | (rm << 16) | (rn << 5) | rd, comment);
 }
 
-void AArch64Instructions::lsl(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment) {
+void AArch64Instructions::lsl(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment) {
     // This is a simplified version that uses UBFM for LSL
     uint32_t encoding = 0x53000000 | (1 << 22) | (rd & 0x1F) | ((rn & 0x1F) << 5) | ((imm & 0x3F) << 16) | ((63 - imm) << 10);
-    addInstruction({encoding, "lsl " + regName(rd) + ", " + regName(rn) + ", #" + std::to_string(imm), comment});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::lslv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::lslv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     // This function generates the LSLV instruction: rd = rn << rm
     // The base encoding for 64-bit LSLV Xd, Xn, Xm is 0x9AC02000
     uint32_t encoding = 0x9AC02000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "lslv " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment});
+    addInstruction(encoding, comment);
 }
 
-void  AArch64Instructions::lsrv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment)
+void  AArch64Instructions::lsrv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment)
 {
     // This function generates the LSRV instruction: rd = rn >> rm
     // The base encoding for 64-bit LSRV Xd, Xn, Xm is 0x9AC02400
     uint32_t encoding = 0x9AC02400 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "lsrv " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment});
+    addInstruction(encoding, comment);
 }
 
 
-void AArch64Instructions::lsr(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::lsr(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0x1AC02800 | (rd & 0x1F) | ((rn & 0x1F) << 5) | ((rm & 0x1F) << 16);
-    addInstruction({encoding, "lsr " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::msub(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra, const std::string& comment) {
-    addInstruction({0x9B000000 | (rm << 16) | (ra << 10) | (rn << 5) | rd, "msub " + regName(rd) + ", " + regName(rn) + ", " + regName(rm) + ", " + regName(ra), comment});
+void AArch64Instructions::msub(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra, Comment comment) {
+    addInstruction(0x9B008000 | (rm << 16) | (ra << 10) | (rn << 5) | rd, comment);
 }
 
 std::string AArch64Instructions::regName(uint32_t reg) const {
@@ -161,230 +211,421 @@ size_t AArch64Instructions::getCurrentAddress() const {
     return instructions.size() * 4; // Each instruction is 4 bytes
 }
 
-void AArch64Instructions::stp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, const std::string& comment) {
-    uint32_t encoding = 0xA9000000 | ((imm & 0x7F) << 15) | (rt2 << 10) | (rn << 5) | rt1;
-    addInstruction({encoding, "stp " + regName(rt1) + ", " + regName(rt2) + ", [" +
-                         regName(rn) + ", #" + std::to_string(imm) + "]", comment, false, "", getCurrentAddress()});
+void AArch64Instructions::stp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, Comment comment) {
+    uint32_t encoding = 0xA9000000 | (((imm / 8) & 0x7F) << 15) | (rt2 << 10) | (rn << 5) | rt1;
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::ldp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, const std::string& comment) {
-    uint32_t encoding = 0xA9400000 | ((imm & 0x7F) << 15) | (rt2 << 10) | (rn << 5) | rt1;
-    addInstruction({encoding, "ldp " + regName(rt1) + ", " + regName(rt2) + ", [" +
-                         regName(rn) + ", #" + std::to_string(imm) + "]", comment, false, "", getCurrentAddress()});
+void AArch64Instructions::ldp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, Comment comment) {
+    uint32_t encoding = 0xA9400000 | (((imm / 8) & 0x7F) << 15) | (rt2 << 10) | (rn << 5) | rt1;
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::str(uint32_t rt, uint32_t rn, int32_t imm, const std::string& comment) {
-    uint32_t encoding = 0xF9000000 | ((imm / 8) << 10) | (rn << 5) | rt;
-    addInstruction({encoding, "str " + regName(rt) + ", [" + regName(rn) +
-                         (imm != 0 ? ", #" + std::to_string(imm) : "") + "]", comment, false, "", getCurrentAddress()});
+void AArch64Instructions::str(uint32_t rt, uint32_t rn, int32_t imm, Comment comment) {
+    // Negative or unaligned offsets use the unscaled STUR form
+    uint32_t encoding = (imm < 0 || imm % 8 != 0) ? (0xF8000000 | ((imm & 0x1FF) << 12) | (rn << 5) | rt)
+                                                  : (0xF9000000 | ((imm / 8) << 10) | (rn << 5) | rt);
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::ldr(uint32_t rt, uint32_t rn, int32_t imm, const std::string& comment) {
-    uint32_t encoding = 0xF9400000 | ((imm / 8) << 10) | (rn << 5) | rt;
-    addInstruction({encoding, "ldr " + regName(rt) + ", [" + regName(rn) +
-                         (imm != 0 ? ", #" + std::to_string(imm) : "") + "]", comment, false, "", getCurrentAddress()});
+void AArch64Instructions::ldr(uint32_t rt, uint32_t rn, int32_t imm, Comment comment) {
+    // Negative or unaligned offsets use the unscaled LDUR form
+    uint32_t encoding = (imm < 0 || imm % 8 != 0) ? (0xF8400000 | ((imm & 0x1FF) << 12) | (rn << 5) | rt)
+                                                  : (0xF9400000 | ((imm / 8) << 10) | (rn << 5) | rt);
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::b(const std::string& label, const std::string& comment) {
+void AArch64Instructions::b(Label label, Comment comment) {
     uint32_t encoding = 0x14000000;
-    addInstruction({encoding, "b " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::bl(const std::string& label, const std::string& comment) {
+void AArch64Instructions::bl(Label label, Comment comment) {
     uint32_t encoding = 0x94000000;
-    addInstruction({encoding, "bl " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::ret(const std::string& comment) {
+void AArch64Instructions::ret(Comment comment) {
     uint32_t encoding = 0xD65F03C0;
-    addInstruction({encoding, "ret", comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::adr(uint32_t rd, const std::string& label, const std::string& comment) {
+void AArch64Instructions::adr(uint32_t rd, Label label, Comment comment) {
     uint32_t encoding = 0x10000000 | rd; // Placeholder, will be patched
-    addInstruction({encoding, "adr " + regName(rd) + ", " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
+}
+
+void AArch64Instructions::nop(Comment comment) {
+    addInstruction(0xD503201F, comment);
 }
 
-void AArch64Instructions::br(uint32_t rn, const std::string& comment) {
+void AArch64Instructions::br(uint32_t rn, Comment comment) {
     uint32_t encoding = 0xD61F0000 | (rn << 5);
-    addInstruction({encoding, "br " + regName(rn), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::cbz(uint32_t rt, const std::string& label, const std::string& comment) {
-    uint32_t encoding = 0x34000000 | (rt << 0); // Placeholder for offset
-    addInstruction({encoding, "cbz " + regName(rt) + ", " + label, comment, true, label, getCurrentAddress()});
+void AArch64Instructions::cbz(uint32_t rt, Label label, Comment comment) {
+    uint32_t encoding = 0xB4000000 | (rt << 0); // 64-bit CBZ, placeholder for offset
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::loadImmediate(uint32_t rd, int64_t value, const std::string& comment) {
-    std::stringstream ss;
-    ss << "Loading " << value << " into " << regName(rd);
-    std::string baseComment = comment.empty() ? ss.str() : comment;
+void AArch64Instructions::cbnz(uint32_t rt, Label label, Comment comment) {
+    uint32_t encoding = 0xB5000000 | (rt << 0); // 64-bit CBNZ, placeholder for offset
+    addBranch(encoding, label, comment);
+}
+
+void AArch64Instructions::tbz(uint32_t rt, uint32_t bit, Label label, Comment comment) {
+    uint32_t encoding = 0x36000000 | ((bit >> 5) << 31) | ((bit & 0x1F) << 19) | rt; // Placeholder for offset
+    addBranch(encoding, label, comment);
+}
+
+void AArch64Instructions::tbnz(uint32_t rt, uint32_t bit, Label label, Comment comment) {
+    uint32_t encoding = 0x37000000 | ((bit >> 5) << 31) | ((bit & 0x1F) << 19) | rt; // Placeholder for offset
+    addBranch(encoding, label, comment);
+}
+
+void AArch64Instructions::loadImmediate(uint32_t rd, int64_t value, Comment comment) {
+    std::string baseComment;
+    if (keepComments_) {
+        baseComment = comment.str();
+        if (baseComment.empty()) {
+            baseComment = "Loading " + std::to_string(value) + " into " + regName(rd);
+        }
+    }
 
     if (value >= 0 && value < 65536) {
         movz(rd, value & 0xFFFF, 0, baseComment);
     } else {
-        movz(rd, value & 0xFFFF, 0, baseComment + " (low)");
+        movz(rd, value & 0xFFFF, 0, [&] { return baseComment + " (low)"; });
         if (value & 0xFFFF0000) {
-            movk(rd, (value >> 16) & 0xFFFF, 1, baseComment + " (high)");
+            movk(rd, (value >> 16) & 0xFFFF, 1, [&] { return baseComment + " (high)"; });
         }
         if (value & 0xFFFF00000000) {
-            movk(rd, (value >> 32) & 0xFFFF, 2, baseComment + " (upper)");
+            movk(rd, (value >> 32) & 0xFFFF, 2, [&] { return baseComment + " (upper)"; });
         }
         if (value & 0xFFFF000000000000) {
-            movk(rd, (value >> 48) & 0xFFFF, 3, baseComment + " (top)");
+            movk(rd, (value >> 48) & 0xFFFF, 3, [&] { return baseComment + " (top)"; });
         }
     }
 }
 
-void AArch64Instructions::neg(uint32_t rd, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::neg(uint32_t rd, uint32_t rm, Comment comment) {
     uint32_t encoding = 0xCB0003E0 | (rm << 16) | rd; // SUB rd, XZR, rm
-    addInstruction({encoding, "neg " + regName(rd) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::eor(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::eor(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0xCA000000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "eor " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::and_op(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::and_op(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0x8A000000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "and " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::orr(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::orr(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0xAA000000 | (rm << 16) | (rn << 5) | rd;
-    addInstruction({encoding, "orr " + regName(rd) + ", " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::cmp(uint32_t rn, uint32_t rm, const std::string& comment) {
+void AArch64Instructions::cmp(uint32_t rn, uint32_t rm, Comment comment) {
     uint32_t encoding = 0xEB00001F | (rm << 16) | (rn << 5); // SUBS XZR, rn, rm
-    addInstruction({encoding, "cmp " + regName(rn) + ", " + regName(rm), comment, false, "", getCurrentAddress()});
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::beq(const std::string& label, const std::string& comment) {
+void AArch64Instructions::cmp_imm(uint32_t rn, uint32_t imm, Comment comment) {
+    if (imm > 4095) {
+        throw std::runtime_error("cmp immediate out of range: " + std::to_string(imm));
+    }
+    uint32_t encoding = 0xF100001F | (imm << 10) | (rn << 5); // SUBS XZR, rn, #imm
+    addInstruction(encoding, comment);
+}
+
+void AArch64Instructions::beq(Label label, Comment comment) {
     uint32_t encoding = 0x54000000; // B.EQ
-    addInstruction({encoding, "b.eq " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::bne(const std::string& label, const std::string& comment) {
+void AArch64Instructions::bne(Label label, Comment comment) {
     uint32_t encoding = 0x54000000 | 0b0001; // B.NE (condition code 0b0001)
-    addInstruction({encoding, "b.ne " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::bge(const std::string& label, const std::string& comment) {
+void AArch64Instructions::bge(Label label, Comment comment) {
     uint32_t encoding = 0x54000000 | 0b1010; // B.GE (condition code 0b1010)
-    addInstruction({encoding, "b.ge " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::blt(const std::string& label, const std::string& comment) {
+void AArch64Instructions::blt(Label label, Comment comment) {
     uint32_t encoding = 0x54000000 | 0b1011; // B.LT (condition code 0b1011)
-    addInstruction({encoding, "b.lt " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::ble(const std::string& label, const std::string& comment) {
+void AArch64Instructions::ble(Label label, Comment comment) {
     uint32_t encoding = 0x54000000 | 0b1101; // B.LE (condition code 0b1101)
-    addInstruction({encoding, "b.le " + label, comment, true, label, getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::bgt(const std::string& label, const std::string& comment) {
+void AArch64Instructions::bgt(Label label, Comment comment) {
     uint32_t encoding = 0x54000000 | 0b1100; // B.GT (condition code 0b1100)
-    addInstruction({encoding, "b.gt " + label, comment, true, label, getCurrentAddress()});
-}
-
-void AArch64Instructions::cset(uint32_t rd, uint32_t cond, const std::string& comment) {
-    uint32_t encoding = 0x9A9F0000 | (cond << 12) | rd;
-    std::string condStr;
-    switch (cond) {
-        case EQ: condStr = "eq"; break;
-        case NE: condStr = "ne"; break;
-        case CS: condStr = "cs"; break;
-        case CC: condStr = "cc"; break;
-        case MI: condStr = "mi"; break;
-        case PL: condStr = "pl"; break;
-        case VS: condStr = "vs"; break;
-        case VC: condStr = "vc"; break;
-        case HI: condStr = "hi"; break;
-        case LS: condStr = "ls"; break;
-        case GE: condStr = "ge"; break;
-        case LT: condStr = "lt"; break;
-        case GT: condStr = "gt"; break;
-        case LE: condStr = "le"; break;
-        case AL: condStr = "al"; break;
-        case NV: condStr = "nv"; break;
-        default: condStr = "unknown"; break;
-    }
-    addInstruction({encoding, "cset " + regName(rd) + ", " + condStr, comment, false, "", getCurrentAddress()});
+    addBranch(encoding, label, comment);
 }
 
-void AArch64Instructions::resolveBranch(size_t instructionIndex, int32_t offset) {
-    if (instructionIndex >= instructions.size()) {
-        throw std::runtime_error("Invalid instruction index for branch resolution");
-    }
+void AArch64Instructions::bhi(Label label, Comment comment) {
+    uint32_t encoding = 0x54000000 | 0b1000; // B.HI (condition code 0b1000, unsigned higher)
+    addBranch(encoding, label, comment);
+}
 
-    Instruction& instr = instructions[instructionIndex];
-    uint32_t opcode = instr.encoding & 0xFC000000; // Extract top 6 bits
+std::string AArch64Instructions::conditionName(uint32_t cond) {
+    static const char* const names[] = {"eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc",
+                                        "hi", "ls", "ge", "lt", "gt", "le", "al", "nv"};
+    return cond < 16 ? names[cond] : "unknown";
+}
 
-    if (opcode == 0x14000000) { // B instruction
-        instr.encoding |= ((offset / 4) & 0x03FFFFFF);
-    } else if ((opcode & 0xFE000000) == 0x54000000) { // Conditional branch (B.cond)
-        instr.encoding |= ((offset / 4) & 0x0007FFFF);
-    } else if (opcode == 0x94000000) { // BL instruction
-        instr.encoding |= ((offset / 4) & 0x03FFFFFF);
-    } else {
-        throw std::runtime_error("Attempted to resolve non-branch instruction");
-    }
-    instr.needsLabelResolution = false;
+void AArch64Instructions::bcond(uint32_t cond, Label label, Comment comment) {
+    uint32_t encoding = 0x54000000 | (cond & 0xF);
+    addBranch(encoding, label, comment);
+}
+
+void AArch64Instructions::cset(uint32_t rd, uint32_t cond, Comment comment) {
+    // CSET is CSINC rd, XZR, XZR, invert(cond)
+    uint32_t encoding = 0x9A9F07E0 | ((cond ^ 1) << 12) | rd;
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::addUnresolvedBranch(const std::string& label) {
-    // Placeholder implementation
+void AArch64Instructions::csetm(uint32_t rd, uint32_t cond, Comment comment) {
+    // CSETM is CSINV rd, XZR, XZR, invert(cond): all ones when cond holds
+    uint32_t encoding = 0xDA9F03E0 | ((cond ^ 1) << 12) | rd;
+    addInstruction(encoding, comment);
 }
 
-void AArch64Instructions::resolveBranches(const LabelManager& labelManager) {
-    // Placeholder implementation
+void AArch64Instructions::mvn(uint32_t rd, uint32_t rm, Comment comment) {
+    uint32_t encoding = 0xAA2003E0 | (rm << 16) | rd; // ORN rd, XZR, rm
+    addInstruction(encoding, comment);
 }
 
 void AArch64Instructions::computeAddresses(size_t baseAddress) {
-    size_t currentAddress = baseAddress;
-    for (auto& instr : instructions) {
-        instr.address = currentAddress;
-        currentAddress += 4; // Each AArch64 instruction is 4 bytes
+    // Each AArch64 instruction is 4 bytes, so addresses follow from the index
+    baseAddress_ = baseAddress;
+}
+
+namespace {
+
+bool fitsSigned(int64_t value, int bits) {
+    return value >= -(int64_t(1) << (bits - 1)) && value < (int64_t(1) << (bits - 1));
+}
+
+// Width of the offset field of a branch relaxBranches() can invert, or 0
+int conditionalBits(uint32_t enc) {
+    if ((enc & 0xFF000010) == 0x54000000) {
+        return (enc & 0xF) >= 0xE ? 0 : 19; // b.al and b.nv cannot be inverted
+    }
+    if ((enc & 0x7E000000) == 0x34000000) {
+        return 19;
     }
+    return (enc & 0x7E000000) == 0x36000000 ? 14 : 0;
 }
 
-void AArch64Instructions::resolveAllBranches() {
-    // Build a map of labels to their addresses
-    std::map<std::string, size_t> labelMap;
-    for (const auto& instr : instructions) {
-        if (instr.hasLabel) {
-            labelMap[instr.label] = instr.address;
+// Conditions pair up by their low bit; cbz/cbnz and tbz/tbnz differ in bit 24
+uint32_t invertBranch(uint32_t enc) {
+    return (enc & 0xFF000010) == 0x54000000 ? enc ^ 1 : enc ^ 0x01000000;
+}
+
+bool isCall(uint32_t enc) {
+    return (enc & 0xFC000000) == 0x94000000;
+}
+
+bool isReturn(uint32_t enc) {
+    return (enc & 0xFFFFFC1F) == 0xD65F0000;
+}
+
+} // namespace
+
+std::vector<uint32_t> AArch64Instructions::labelPositions() const {
+    std::vector<uint32_t> position(labels_.size(), NoLabel);
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i].label < position.size()) {
+            position[instructions[i].label] = static_cast<uint32_t>(i);
         }
     }
+    return position;
+}
+
+AArch64Instructions::RelaxationStatistics AArch64Instructions::relaxBranches(int callBits) {
+    RelaxationStatistics stats;
+    std::vector<Instruction> relaxed;
+
+    for (bool changed = true; changed;) {
+        ++stats.passes;
+        changed = false;
+        const std::vector<uint32_t> position = labelPositions();
+        auto outOfRange = [&](size_t i, int bits) {
+            const Instruction& instr = instructions[i];
+            if (!instr.needsLabelResolution || instr.target >= position.size() || position[instr.target] == NoLabel) {
+                return false;
+            }
+            return !fitsSigned(static_cast<int64_t>(position[instr.target]) - static_cast<int64_t>(i), bits);
+        };
+
+        // Conditional branches: b.!cond +8; b target
+        relaxed.clear();
+        relaxed.reserve(instructions.size());
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const Instruction& instr = instructions[i];
+            const int bits = conditionalBits(instr.encoding);
+            if (bits == 0 || !outOfRange(i, bits)) {
+                relaxed.push_back(instr);
+                continue;
+            }
+            Instruction skip = instr;
+            skip.encoding = invertBranch(instr.encoding) | (2 << 5);
+            skip.target = NoLabel;
+            skip.needsLabelResolution = false;
+            Instruction jump;
+            jump.encoding = 0x14000000;
+            jump.target = instr.target;
+            jump.needsLabelResolution = true;
+            relaxed.push_back(skip);
+            relaxed.push_back(jump);
+            ++stats.conditionalBranches;
+            changed = true;
+        }
+        if (changed) {
+            instructions.swap(relaxed);
+            continue;
+        }
 
-    // Resolve branch targets
-    for (auto& instr : instructions) {
-        if (instr.needsLabelResolution) {
-            auto it = labelMap.find(instr.targetLabel);
-            if (it != labelMap.end()) {
-                size_t targetAddress = it->second;
-                int64_t offset = static_cast<int64_t>(targetAddress) - static_cast<int64_t>(instr.address);
-
-                // Update the instruction encoding based on instruction type
-                uint32_t opcode = instr.encoding & 0xFC000000; // Extract opcode bits
-
-                if (opcode == 0x14000000) { // B instruction
-                    instr.encoding |= ((offset / 4) & 0x03FFFFFF);
-                } else if ((opcode & 0xFE000000) == 0x54000000) { // Conditional branch (B.cond)
-                    instr.encoding |= (((offset / 4) & 0x0007FFFF) << 5);
-                } else if (opcode == 0x94000000) { // BL instruction
-                    instr.encoding |= ((offset / 4) & 0x03FFFFFF);
-                } else if ((opcode & 0xFF000000) == 0x34000000) { // CBZ/CBNZ
-                    instr.encoding |= (((offset / 4) & 0x0007FFFF) << 5);
-                }
-
-                instr.needsLabelResolution = false;
+        // Far calls: retarget to a veneer after the next ret in reach, else the previous one.
+        // Nothing falls through a ret, and the b inserted above never follows one.
+        std::vector<size_t> returns;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            if (isReturn(instructions[i].encoding)) {
+                returns.push_back(i);
             }
         }
+        std::unordered_map<size_t, std::vector<std::pair<uint32_t, Label>>> islands;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            Instruction& instr = instructions[i];
+            if (!isCall(instr.encoding) || !outOfRange(i, callBits)) {
+                continue;
+            }
+            auto reaches = [&](size_t island) {
+                return fitsSigned(static_cast<int64_t>(island + 1) - static_cast<int64_t>(i), callBits);
+            };
+            auto next = std::lower_bound(returns.begin(), returns.end(), i);
+            size_t island;
+            if (next != returns.end() && reaches(*next)) {
+                island = *next;
+            } else if (next != returns.begin() && reaches(*std::prev(next))) {
+                island = *std::prev(next);
+            } else {
+                throw std::runtime_error("No veneer in reach for call to '" + labelName(instr.target) + "'");
+            }
+
+            auto& veneers = islands[island];
+            auto veneer = std::find_if(veneers.begin(), veneers.end(),
+                                       [&](const std::pair<uint32_t, Label>& v) { return v.first == instr.target; });
+            if (veneer == veneers.end()) {
+                Label label = newLabel("veneer");
+                labels_[label.id].bound = true;
+                veneers.emplace_back(instr.target, label);
+                veneer = std::prev(veneers.end());
+                ++stats.veneers;
+            }
+            instr.target = veneer->second.id;
+            changed = true;
+        }
+        if (!changed) {
+            break;
+        }
+
+        relaxed.clear();
+        relaxed.reserve(instructions.size() + stats.veneers * 3);
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            relaxed.push_back(instructions[i]);
+            auto island = islands.find(i);
+            if (island == islands.end()) {
+                continue;
+            }
+            for (const auto& veneer : island->second) {
+                Instruction page;
+                page.encoding = 0x90000000 | 16; // adrp x16, target
+                page.label = veneer.second.id;
+                page.target = veneer.first;
+                page.needsLabelResolution = true;
+                Instruction offset = page;
+                offset.encoding = 0x91000000 | (16 << 5) | 16; // add x16, x16, :lo12:target
+                offset.label = NoLabel;
+                Instruction jump;
+                jump.encoding = 0xD61F0000 | (16 << 5); // br x16
+                relaxed.push_back(page);
+                relaxed.push_back(offset);
+                relaxed.push_back(jump);
+            }
+        }
+        instructions.swap(relaxed);
+    }
+    return stats;
+}
+
+void AArch64Instructions::resolveAllBranches() {
+    // Position of every label bound in this code, indexed by label id
+    const std::vector<uint32_t> position = labelPositions();
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        Instruction& instr = instructions[i];
+        if (!instr.needsLabelResolution || instr.target >= position.size() || position[instr.target] == NoLabel) {
+            continue;
+        }
+        const int64_t delta = static_cast<int64_t>(position[instr.target]) - static_cast<int64_t>(i);
+        const int64_t offset = delta * 4;
+        const uint32_t enc = instr.encoding;
+        int bits;
+        uint32_t field;
+
+        if ((enc & 0x7C000000) == 0x14000000) { // B/BL
+            bits = 26;
+            field = static_cast<uint32_t>(delta) & 0x03FFFFFF;
+        } else if ((enc & 0xFF000010) == 0x54000000 || (enc & 0x7E000000) == 0x34000000) { // B.cond, CBZ/CBNZ
+            bits = 19;
+            field = (static_cast<uint32_t>(delta) & 0x7FFFF) << 5;
+        } else if ((enc & 0x7E000000) == 0x36000000) { // TBZ/TBNZ
+            bits = 14;
+            field = (static_cast<uint32_t>(delta) & 0x3FFF) << 5;
+        } else if ((enc & 0x9F000000) == 0x10000000) { // ADR (byte offset)
+            if (!fitsSigned(offset, 21)) {
+                throw std::runtime_error("adr to '" + labelName(instr.target) + "' out of range");
+            }
+            instr.encoding |= ((static_cast<uint32_t>(offset) & 0x3) << 29) |
+                              (((static_cast<uint32_t>(offset) >> 2) & 0x7FFFF) << 5);
+            instr.needsLabelResolution = false;
+            continue;
+        } else if ((enc & 0x9F000000) == 0x90000000) { // ADRP (4KB pages)
+            const int64_t pages = static_cast<int64_t>(addressOf(position[instr.target]) >> 12) -
+                                  static_cast<int64_t>(addressOf(i) >> 12);
+            if (!fitsSigned(pages, 21)) {
+                throw std::runtime_error("adrp to '" + labelName(instr.target) + "' out of range");
+            }
+            instr.encoding |= ((static_cast<uint32_t>(pages) & 0x3) << 29) |
+                              (((static_cast<uint32_t>(pages) >> 2) & 0x7FFFF) << 5);
+            instr.needsLabelResolution = false;
+            continue;
+        } else if ((enc & 0xFFC00000) == 0x91000000) { // ADD of the low 12 bits of an address
+            instr.encoding |= static_cast<uint32_t>(addressOf(position[instr.target]) & 0xFFF) << 10;
+            instr.needsLabelResolution = false;
+            continue;
+        } else {
+            throw std::runtime_error("Cannot resolve label '" + labelName(instr.target) + "' in " +
+                                     disassemble(instr));
+        }
+
+        if (!fitsSigned(delta, bits)) {
+            throw std::runtime_error("Branch to '" + labelName(instr.target) + "' out of range (" +
+                                     std::to_string(offset) + " bytes)");
+        }
+        instr.encoding |= field;
+        instr.needsLabelResolution = false;
     }
 }
 
@@ -404,6 +645,13 @@ size_t AArch64Instructions::encodeToBuffer(uint8_t* buffer, size_t bufferSize) c
 
 void AArch64Instructions::clear() {
     instructions.clear();
+    labels_.clear();
+    labelNames_.clear();
+    labelIds_.clear();
+    labelSerial_ = 0;
+    comments_.clear();
+    pendingLabel_ = NoLabel;
+    baseAddress_ = 0;
 }
 
 AArch64Instructions::Instruction& AArch64Instructions::at(size_t index) {
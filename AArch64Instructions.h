@@ -5,8 +5,36 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 
-class LabelManager;
+/**
+ * The comment argument of an emitter. It holds text that already exists,
+ * or a formatter such as [&] { return "Load " + name; } that is only
+ * called when comments are kept, so a run without a listing builds no
+ * strings. A temporary std::string is rejected: it would be built
+ * whether or not it is kept.
+ */
+class InstructionComment {
+public:
+    InstructionComment() = default;
+    InstructionComment(const char* text) : text_(text) {}
+    InstructionComment(const std::string& text) : text_(text.c_str()) {}
+    InstructionComment(std::string&&) = delete;
+    template <typename Format,
+              typename = std::enable_if_t<std::is_invocable_r_v<std::string, const Format&>>>
+    InstructionComment(const Format& format) : format_(&call<Format>), closure_(&format) {}
+
+    std::string str() const { return format_ ? format_(closure_) : std::string(text_); }
+
+private:
+    const char* text_ = "";
+    std::string (*format_)(const void*) = nullptr;
+    const void* closure_ = nullptr; // The formatter; it lives until the emitter returns
+
+    template <typename Format>
+    static std::string call(const void* format) { return (*static_cast<const Format*>(format))(); }
+};
 
 /**
  * AArch64 Instruction Generator and Binary Encoder
@@ -16,9 +44,10 @@ class LabelManager;
  *
  * The instruction encoding process works as follows:
  * 1. Instructions are created with their binary encodings pre-computed
- * 2. computeAddresses() assigns memory addresses to each instruction
- * 3. resolveAllBranches() updates branch instruction encodings with correct offsets
- * 4. encodeToBuffer() outputs the final binary machine code
+ * 2. relaxBranches() rewrites branches whose targets are out of reach
+ * 3. computeAddresses() sets the address of the first instruction
+ * 4. resolveAllBranches() updates branch instruction encodings with correct offsets
+ * 5. encodeToBuffer() outputs the final binary machine code
  *
  * Each instruction is exactly 4 bytes (32 bits) in AArch64, and the binary
  * encoding follows the little-endian format required by the architecture.
@@ -42,20 +71,36 @@ public:
     static const uint32_t SP = 31;  // Stack pointer
     static const uint32_t XZR = 31; // Zero register (when used as source)
 
+    static const uint32_t NoLabel = 0xFFFFFFFF;
+    static const uint32_t NoComment = 0xFFFFFFFF;
+
+    /// Handle to an entry of the label table; labels are numbered densely from 0.
+    struct Label {
+        uint32_t id = NoLabel;
+        bool isValid() const { return id != NoLabel; }
+        bool operator==(const Label& other) const { return id == other.id; }
+        bool operator!=(const Label& other) const { return id != other.id; }
+    };
+
+    using Comment = InstructionComment;
+
+    /**
+     * One emitted instruction: its encoding plus indices into the label and
+     * comment tables of the AArch64Instructions that owns it. Assembly text
+     * is produced by AArch64Disassembler only when a listing is requested,
+     * and the address of an instruction is its index times four.
+     */
     struct Instruction {
-        uint32_t encoding;
-        std::string assembly;
-        std::string comment;
+        uint32_t encoding = 0;
+        uint32_t label = NoLabel;      // Label defined at this instruction
+        uint32_t target = NoLabel;     // Label a branch, call or adr refers to
+        uint32_t comment = NoComment;  // Only recorded while comments are kept
         bool needsLabelResolution = false;
-        std::string targetLabel;
-        size_t address; // Address of the instruction in the generated code
-        bool hasLabel = false;
-        std::string label;
 
+        bool hasLabel() const { return label != NoLabel; }
         bool isStore() const { return (encoding & 0x3B000000) == 0x38000000; } // Simplified check for STR/LDR (immediate offset)
         bool isLoad() const { return (encoding & 0x3B000000) == 0x38000000; } // Simplified check for STR/LDR (immediate offset)
         void resolveLabel(int32_t offset) { encoding |= ((offset / 4) & 0x7FFFF) << 5; } // Simplified for B/BL
-        std::string toString() const { return assembly; }
 
         /**
          * Encode this instruction to binary machine code.
@@ -72,18 +117,62 @@ public:
         }
     };
 
-    void setPendingLabel(const std::string& label);
+    // Binds a label to the next emitted instruction; a label is bound only once
+    void setPendingLabel(Label label);
+    void setPendingLabel(const std::string& label) { setPendingLabel(namedLabel(label)); }
+
+    /**
+     * Creates a fresh label without touching any string: its name, @p prefix
+     * followed by a serial number, is only built for listings and errors.
+     * @p prefix must outlive this object (a string literal).
+     */
+    Label newLabel(const char* prefix);
+
+    /// Looks up or creates the label of a source-level name (function, GOTO target, runtime symbol).
+    Label namedLabel(const std::string& name);
+
+    std::string labelName(uint32_t id) const;
+    std::string labelName(Label label) const { return labelName(label.id); }
+    size_t labelCount() const { return labels_.size(); }
+
+    /**
+     * Comments are only useful in a listing, so they are dropped unless
+     * requested before code generation.
+     */
+    void setKeepComments(bool keep) { keepComments_ = keep; }
+    bool keepsComments() const { return keepComments_; }
+    const std::string& commentOf(const Instruction& instr) const;
+
+    /// Assembly text of an instruction, with its branch target by name.
+    std::string disassemble(const Instruction& instr) const;
 
 private:
+    struct LabelEntry {
+        const char* prefix = nullptr; // Generated label: prefix + "_" + serial
+        uint32_t serial = 0;
+        uint32_t name = NoLabel;      // Named label: index into labelNames_
+        bool bound = false;
+    };
+
     std::vector<Instruction> instructions;
-    std::string pendingLabel_;
-    void addInstruction(Instruction instr);
+    std::vector<LabelEntry> labels_;
+    std::vector<std::string> labelNames_;
+    std::unordered_map<std::string, uint32_t> labelIds_;
+    uint32_t labelSerial_ = 0;
+    std::vector<std::string> comments_;
+    bool keepComments_ = false;
+    uint32_t pendingLabel_ = NoLabel;
+    size_t baseAddress_ = 0;
+
+    void addInstruction(uint32_t encoding, Comment comment);
+    std::vector<uint32_t> labelPositions() const;
+    void addBranch(uint32_t encoding, Label label, Comment comment);
 
 public:
     // Basic instruction generators
-    void mov(uint32_t rd, uint32_t rm, const std::string& comment = "");
-    void movz(uint32_t rd, uint16_t imm16, uint8_t shift, const std::string& comment = "");
-    void movk(uint32_t rd, uint16_t imm16, uint8_t shift, const std::string& comment = "");
+    void mov(uint32_t rd, uint32_t rm, Comment comment = {});
+    void movz(uint32_t rd, uint16_t imm16, uint8_t shift, Comment comment = {});
+    void movk(uint32_t rd, uint16_t imm16, uint8_t shift, Comment comment = {});
     enum ShiftType {
         LSL, // Logical Shift Left
         LSR, // Logical Shift Right
@@ -91,49 +180,74 @@ public:
         ROR  // Rotate Right
     };
 
-    void add(uint32_t rd, uint32_t rn, uint32_t rm, ShiftType shift_type, uint32_t shift_amount, const std::string& comment = "");
-    void add(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment = "");
-    void sub(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment);
-    void sub_imm(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment);
-    void sub_reg(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment);
-    void mul(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void sdiv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void lsl(uint32_t rd, uint32_t rn, uint32_t imm, const std::string& comment = "");
-    void lslv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment);
-    void lsrv(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment);
-    void lsr(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void msub(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra, const std::string& comment = "");
-    void stp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, const std::string& comment = "");
-    void ldp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, const std::string& comment = "");
-    void str(uint32_t rt, uint32_t rn, int32_t imm, const std::string& comment = "");
-    void ldr(uint32_t rt, uint32_t rn, int32_t imm, const std::string& comment = "");
-    void b(const std::string& label, const std::string& comment = "");
-    void bl(const std::string& label, const std::string& comment = "");
-    void ret(const std::string& comment = "");
-
-    void adr(uint32_t rd, const std::string& label, const std::string& comment = "");
-    void br(uint32_t rn, const std::string& comment = "");
-
-    void cbz(uint32_t rt, const std::string& label, const std::string& comment = "");
+    void add(uint32_t rd, uint32_t rn, uint32_t rm, ShiftType shift_type, uint32_t shift_amount, Comment comment = {});
+    void add(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment = {});
+    void sub(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment);
+    void sub_imm(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment);
+    void sub_reg(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment);
+    void mul(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void sdiv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void lsl(uint32_t rd, uint32_t rn, uint32_t imm, Comment comment = {});
+    void lslv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment);
+    void lsrv(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment);
+    void lsr(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void msub(uint32_t rd, uint32_t rn, uint32_t rm, uint32_t ra, Comment comment = {});
+    void stp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, Comment comment = {});
+    void ldp(uint32_t rt1, uint32_t rt2, uint32_t rn, int32_t imm, Comment comment = {});
+    void str(uint32_t rt, uint32_t rn, int32_t imm, Comment comment = {});
+    void ldr(uint32_t rt, uint32_t rn, int32_t imm, Comment comment = {});
+    void b(Label label, Comment comment = {});
+    void b(const std::string& label, Comment comment = {}) { b(namedLabel(label), comment); }
+    void bl(Label label, Comment comment = {});
+    void bl(const std::string& label, Comment comment = {}) { bl(namedLabel(label), comment); }
+    void ret(Comment comment = {});
+
+    void adr(uint32_t rd, Label label, Comment comment = {});
+    void adr(uint32_t rd, const std::string& label, Comment comment = {}) { adr(rd, namedLabel(label), comment); }
+    void br(uint32_t rn, Comment comment = {});
+    void nop(Comment comment = {});
+
+    void cbz(uint32_t rt, Label label, Comment comment = {});
+    void cbz(uint32_t rt, const std::string& label, Comment comment = {}) { cbz(rt, namedLabel(label), comment); }
+    void cbnz(uint32_t rt, Label label, Comment comment = {});
+    void cbnz(uint32_t rt, const std::string& label, Comment comment = {}) { cbnz(rt, namedLabel(label), comment); }
+    void tbz(uint32_t rt, uint32_t bit, Label label, Comment comment = {});
+    void tbz(uint32_t rt, uint32_t bit, const std::string& label, Comment comment = {}) { tbz(rt, bit, namedLabel(label), comment); }
+    void tbnz(uint32_t rt, uint32_t bit, Label label, Comment comment = {});
+    void tbnz(uint32_t rt, uint32_t bit, const std::string& label, Comment comment = {}) { tbnz(rt, bit, namedLabel(label), comment); }
 
     // Helper methods for common BCPL patterns
     void moveAtoB() { mov(X1, X0, "B := A"); }
     void moveBtoC() { mov(X2, X1, "C := B"); }
-    void loadImmediate(uint32_t rd, int64_t value, const std::string& comment = "");
-
-
-    void neg(uint32_t rd, uint32_t rm, const std::string& comment = "");
-    void eor(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void and_op(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void orr(uint32_t rd, uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void cmp(uint32_t rn, uint32_t rm, const std::string& comment = "");
-    void beq(const std::string& label, const std::string& comment = "");
-    void bne(const std::string& label, const std::string& comment = "");
-    void bge(const std::string& label, const std::string& comment = "");
-    void blt(const std::string& label, const std::string& comment = "");
-    void ble(const std::string& label, const std::string& comment = "");
-    void bgt(const std::string& label, const std::string& comment = "");
-    void cset(uint32_t rd, uint32_t cond, const std::string& comment = "");
+    void loadImmediate(uint32_t rd, int64_t value, Comment comment = {});
+
+
+    void neg(uint32_t rd, uint32_t rm, Comment comment = {});
+    void eor(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void and_op(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void orr(uint32_t rd, uint32_t rn, uint32_t rm, Comment comment = {});
+    void cmp(uint32_t rn, uint32_t rm, Comment comment = {});
+    void cmp_imm(uint32_t rn, uint32_t imm, Comment comment = {}); // imm in 0..4095
+    void beq(Label label, Comment comment = {});
+    void beq(const std::string& label, Comment comment = {}) { beq(namedLabel(label), comment); }
+    void bne(Label label, Comment comment = {});
+    void bne(const std::string& label, Comment comment = {}) { bne(namedLabel(label), comment); }
+    void bge(Label label, Comment comment = {});
+    void bge(const std::string& label, Comment comment = {}) { bge(namedLabel(label), comment); }
+    void blt(Label label, Comment comment = {});
+    void blt(const std::string& label, Comment comment = {}) { blt(namedLabel(label), comment); }
+    void ble(Label label, Comment comment = {});
+    void ble(const std::string& label, Comment comment = {}) { ble(namedLabel(label), comment); }
+    void bgt(Label label, Comment comment = {});
+    void bgt(const std::string& label, Comment comment = {}) { bgt(namedLabel(label), comment); }
+    void bhi(Label label, Comment comment = {});
+    void bhi(const std::string& label, Comment comment = {}) { bhi(namedLabel(label), comment); }
+    void bcond(uint32_t cond, Label label, Comment comment = {});
+    void bcond(uint32_t cond, const std::string& label, Comment comment = {}) { bcond(cond, namedLabel(label), comment); }
+    void cset(uint32_t rd, uint32_t cond, Comment comment = {});
+    void csetm(uint32_t rd, uint32_t cond, Comment comment = {}); // -1 if cond, else 0
+    void mvn(uint32_t rd, uint32_t rm, Comment comment = {});
+    static std::string conditionName(uint32_t cond);
 
     enum Condition {
         EQ = 0b0000,
@@ -161,11 +275,6 @@ public:
     // Get the current instruction address (for label resolution)
     size_t getCurrentAddress() const;
 
-    // Resolve a branch instruction's offset
-    void resolveBranch(size_t instructionIndex, int32_t offset);
-    void addUnresolvedBranch(const std::string& label);
-    void resolveBranches(const LabelManager& labelManager);
-
     /**
      * Compute addresses for all instructions in the sequence.
      * This pass assigns addresses to each instruction, enabling proper
@@ -174,14 +283,45 @@ public:
      */
     void computeAddresses(size_t baseAddress = 0);
 
+    /// Address of the instruction at @p index, as placed by computeAddresses().
+    size_t addressOf(size_t index) const { return baseAddress_ + index * 4; }
+
     /**
      * Resolve all branch targets and update instruction encodings.
      * This pass must be called after computeAddresses() and after all
-     * labels have been defined. It updates branch instruction encodings
-     * with the correct relative offsets to their targets.
+     * labels have been defined. It is a single linear pass: label positions
+     * are collected into a table indexed by label id, then every branch,
+     * call and adr whose target is bound in this code is patched. Targets
+     * that are not bound here (runtime functions, string literals) are left
+     * for the JIT loader. Throws std::runtime_error when an offset does not
+     * fit the instruction's immediate field.
      */
     void resolveAllBranches();
 
+    /// What relaxBranches() rewrote.
+    struct RelaxationStatistics {
+        size_t conditionalBranches = 0; // Inverted over an unconditional b
+        size_t veneers = 0;             // adrp/add/br stubs for far calls
+        size_t passes = 0;
+    };
+
+    /**
+     * Rewrite branches whose target lies beyond the reach of their offset
+     * field, so that resolveAllBranches() can encode every one of them.
+     * An out-of-range b.cond, cbz, cbnz, tbz or tbnz becomes the inverted
+     * branch over a b to the same label, which reaches +-128MB. An
+     * out-of-range bl is pointed at a veneer (adrp x16; add x16; br x16)
+     * placed after the nearest ret within reach; x16 is already assumed
+     * to be clobbered by calls. Each insertion moves other branches further
+     * apart, so passes repeat until nothing changes.
+     *
+     * Runs after peephole optimization and before resolveAllBranches().
+     * The veneer's adrp assumes the code is loaded at a page-aligned
+     * address, as JIT memory is.
+     * @param callBits Width of the bl offset field; only tests narrow it
+     */
+    RelaxationStatistics relaxBranches(int callBits = 26);
+
     /**
      * Encode all instructions to a binary buffer.
      * @param buffer Output buffer to write encoded instructions to
@@ -0,0 +1,668 @@
+#include "AArch64Simulator.h"
+#include "JitRuntime.h"
+#include <stdexcept>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+// Return address planted in x30 before entering guest code. Reaching it ends the run.
+const uint64_t EXIT_ADDRESS = 0xFFFFFFFFFFFFFFF0ULL;
+
+// Guest accesses below this address are null pointer dereferences
+const uint64_t NULL_PAGE_SIZE = 4096;
+
+inline int64_t signExtend(uint64_t value, unsigned bits) {
+    uint64_t m = 1ULL << (bits - 1);
+    value &= (bits == 64) ? ~0ULL : ((1ULL << bits) - 1);
+    return static_cast<int64_t>((value ^ m) - m);
+}
+
+inline uint64_t widthMask(bool is64) {
+    return is64 ? ~0ULL : 0xFFFFFFFFULL;
+}
+
+inline uint64_t ror(uint64_t value, unsigned amount, unsigned width) {
+    uint64_t mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+    value &= mask;
+    amount %= width;
+    if (amount == 0) return value;
+    return ((value >> amount) | (value << (width - amount))) & mask;
+}
+
+inline uint64_t replicate(uint64_t element, unsigned esize) {
+    uint64_t result = 0;
+    for (unsigned i = 0; i < 64; i += esize) {
+        result |= element << i;
+    }
+    return result;
+}
+
+inline uint64_t ones(unsigned count) {
+    return count >= 64 ? ~0ULL : ((1ULL << count) - 1);
+}
+} // namespace
+
+AArch64Simulator::AArch64Simulator(size_t stackSize) : stack_(stackSize) {
+}
+
+uint64_t AArch64Simulator::getRegister(uint32_t reg) const {
+    if (reg > 31) {
+        throw std::runtime_error("Simulator: invalid register x" + std::to_string(reg));
+    }
+    return reg == 31 ? sp_ : x_[reg];
+}
+
+void AArch64Simulator::setRegister(uint32_t reg, uint64_t value) {
+    if (reg > 31) {
+        throw std::runtime_error("Simulator: invalid register x" + std::to_string(reg));
+    }
+    if (reg == 31) {
+        sp_ = value;
+    } else {
+        x_[reg] = value;
+    }
+}
+
+int64_t AArch64Simulator::run(uintptr_t entry, uint64_t instructionLimit) {
+    runtimeSymbols_.clear();
+    for (const auto& symbol : JitRuntime::getInstance().getSymbolTable()) {
+        runtimeSymbols_[symbol.second] = symbol.first;
+    }
+
+    std::memset(x_, 0, sizeof(x_));
+    x_[28] = globalPointer_;
+    n_ = z_ = c_ = v_ = false;
+    halted_ = false;
+    uintptr_t stackTop = reinterpret_cast<uintptr_t>(stack_.data() + stack_.size());
+    sp_ = stackTop & ~static_cast<uintptr_t>(15);
+    x_[30] = EXIT_ADDRESS;
+    pc_ = entry;
+
+    while (!halted_ && pc_ != EXIT_ADDRESS) {
+        auto it = runtimeSymbols_.find(pc_);
+        if (it != runtimeSymbols_.end()) {
+            callRuntime(it->second);
+            continue;
+        }
+        if (instructionLimit != 0 && stats_.instructions >= instructionLimit) {
+            throw std::runtime_error("Simulator: instruction limit reached");
+        }
+        step();
+    }
+    return static_cast<int64_t>(x_[0]);
+}
+
+void AArch64Simulator::callRuntime(const std::string& name) {
+    stats_.runtimeCalls++;
+    if (name == "finish") {
+        std::fflush(nullptr);
+        halted_ = true;
+        return;
+    }
+    using RuntimeFunction = int64_t (*)(uint64_t, uint64_t, uint64_t, uint64_t,
+                                        uint64_t, uint64_t, uint64_t, uint64_t);
+    auto fn = reinterpret_cast<RuntimeFunction>(pc_);
+    x_[0] = static_cast<uint64_t>(fn(x_[0], x_[1], x_[2], x_[3], x_[4], x_[5], x_[6], x_[7]));
+    pc_ = x_[30];
+}
+
+void AArch64Simulator::step() {
+    uint32_t insn;
+    std::memcpy(&insn, reinterpret_cast<const void*>(pc_), sizeof(insn));
+    stats_.instructions++;
+    nextPc_ = pc_ + 4;
+
+    switch ((insn >> 25) & 0xF) {
+        case 0x8: case 0x9:
+            execDataProcessingImmediate(insn);
+            break;
+        case 0xA: case 0xB:
+            execBranch(insn);
+            break;
+        case 0x4: case 0x6: case 0xC: case 0xE:
+            execLoadStore(insn);
+            break;
+        case 0x5: case 0xD:
+            execDataProcessingRegister(insn);
+            break;
+        default:
+            unsupported(insn);
+    }
+    pc_ = nextPc_;
+}
+
+uint64_t AArch64Simulator::readReg(uint32_t reg, bool is64, bool spAllowed) const {
+    uint64_t value = (reg == 31) ? (spAllowed ? sp_ : 0) : x_[reg];
+    return value & widthMask(is64);
+}
+
+void AArch64Simulator::writeReg(uint32_t reg, uint64_t value, bool is64, bool spAllowed) {
+    value &= widthMask(is64);
+    if (reg == 31) {
+        if (spAllowed) {
+            uintptr_t stackBase = reinterpret_cast<uintptr_t>(stack_.data());
+            if (value < stackBase || value > stackBase + stack_.size()) {
+                std::stringstream ss;
+                ss << "Simulator: guest stack overflow at 0x" << std::hex << pc_;
+                throw std::runtime_error(ss.str());
+            }
+            sp_ = value;
+        }
+        return;
+    }
+    x_[reg] = value;
+}
+
+bool AArch64Simulator::conditionHolds(uint32_t cond) const {
+    bool result;
+    switch (cond >> 1) {
+        case 0: result = z_; break;                  // EQ / NE
+        case 1: result = c_; break;                  // CS / CC
+        case 2: result = n_; break;                  // MI / PL
+        case 3: result = v_; break;                  // VS / VC
+        case 4: result = c_ && !z_; break;           // HI / LS
+        case 5: result = n_ == v_; break;            // GE / LT
+        case 6: result = (n_ == v_) && !z_; break;   // GT / LE
+        default: result = true; break;               // AL / NV
+    }
+    if ((cond & 1) && cond != 0xF) {
+        result = !result;
+    }
+    return result;
+}
+
+uint64_t AArch64Simulator::addWithCarry(uint64_t a, uint64_t b, bool carryIn, bool is64, bool setFlags) {
+    uint64_t result;
+    bool carry, overflow;
+    if (is64) {
+        unsigned __int128 usum = static_cast<unsigned __int128>(a) + b + (carryIn ? 1 : 0);
+        result = static_cast<uint64_t>(usum);
+        carry = (usum >> 64) != 0;
+        __int128 ssum = static_cast<__int128>(static_cast<int64_t>(a)) + static_cast<int64_t>(b) + (carryIn ? 1 : 0);
+        overflow = ssum != static_cast<__int128>(static_cast<int64_t>(result));
+    } else {
+        uint64_t usum = static_cast<uint64_t>(static_cast<uint32_t>(a)) + static_cast<uint32_t>(b) + (carryIn ? 1 : 0);
+        result = usum & 0xFFFFFFFFULL;
+        carry = (usum >> 32) != 0;
+        int64_t ssum = static_cast<int64_t>(static_cast<int32_t>(a)) + static_cast<int32_t>(b) + (carryIn ? 1 : 0);
+        overflow = ssum != static_cast<int64_t>(static_cast<int32_t>(result));
+    }
+    if (setFlags) {
+        n_ = (result >> (is64 ? 63 : 31)) & 1;
+        z_ = result == 0;
+        c_ = carry;
+        v_ = overflow;
+    }
+    return result;
+}
+
+uint64_t AArch64Simulator::shiftValue(uint64_t value, uint32_t type, uint32_t amount, bool is64) {
+    unsigned width = is64 ? 64 : 32;
+    value &= widthMask(is64);
+    amount %= width;
+    switch (type) {
+        case 0: return (value << amount) & widthMask(is64);
+        case 1: return value >> amount;
+        case 2: return static_cast<uint64_t>(signExtend(value, width) >> amount) & widthMask(is64);
+        default: return ror(value, amount, width);
+    }
+}
+
+uint64_t AArch64Simulator::extendValue(uint64_t value, uint32_t option, uint32_t shift, bool is64) {
+    uint64_t extended;
+    switch (option) {
+        case 0: extended = value & 0xFF; break;
+        case 1: extended = value & 0xFFFF; break;
+        case 2: extended = value & 0xFFFFFFFFULL; break;
+        case 3: extended = value; break;
+        case 4: extended = static_cast<uint64_t>(signExtend(value, 8)); break;
+        case 5: extended = static_cast<uint64_t>(signExtend(value, 16)); break;
+        case 6: extended = static_cast<uint64_t>(signExtend(value, 32)); break;
+        default: extended = value; break;
+    }
+    return (extended << shift) & widthMask(is64);
+}
+
+bool AArch64Simulator::decodeBitMasks(uint32_t n, uint32_t imms, uint32_t immr, bool immediate, bool is64,
+                                      uint64_t& wmask, uint64_t& tmask) {
+    uint32_t combined = (n << 6) | (~imms & 0x3F);
+    int len = -1;
+    for (int i = 6; i >= 0; --i) {
+        if (combined & (1u << i)) { len = i; break; }
+    }
+    if (len < 1 || (!is64 && len == 6)) return false;
+
+    uint32_t levels = (1u << len) - 1;
+    if (immediate && (imms & levels) == levels) return false;
+
+    uint32_t s = imms & levels;
+    uint32_t r = immr & levels;
+    uint32_t diff = (s - r) & levels;
+    unsigned esize = 1u << len;
+
+    uint64_t welem = ones(s + 1);
+    uint64_t telem = ones(diff + 1);
+    wmask = replicate(ror(welem, r, esize), esize) & widthMask(is64);
+    tmask = replicate(telem, esize) & widthMask(is64);
+    return true;
+}
+
+void AArch64Simulator::checkAccess(uint64_t address, uint32_t size, bool isStore) const {
+    const char* problem = nullptr;
+    if (address < NULL_PAGE_SIZE || address + size < address) {
+        problem = "out of bounds";
+    } else if (isStore) {
+        for (const auto& region : readOnly_) {
+            if (address < region.second && address + size > region.first) {
+                problem = "to read-only memory";
+                break;
+            }
+        }
+    }
+    if (problem) {
+        std::stringstream ss;
+        ss << "Simulator: " << (isStore ? "store " : "load ") << problem << " at address 0x" << std::hex << address
+           << " from 0x" << pc_;
+        throw std::runtime_error(ss.str());
+    }
+}
+
+uint64_t AArch64Simulator::load(uint64_t address, uint32_t size, bool signExtendValue, bool is64) {
+    checkAccess(address, size, false);
+    uint64_t value = 0;
+    std::memcpy(&value, reinterpret_cast<const void*>(address), size);
+    if (signExtendValue && size < 8) {
+        value = static_cast<uint64_t>(signExtend(value, size * 8));
+    }
+    return value & widthMask(is64);
+}
+
+void AArch64Simulator::store(uint64_t address, uint64_t value, uint32_t size) {
+    checkAccess(address, size, true);
+    std::memcpy(reinterpret_cast<void*>(address), &value, size);
+}
+
+void AArch64Simulator::execDataProcessingImmediate(uint32_t insn) {
+    bool is64 = (insn >> 31) & 1;
+    uint32_t rd = insn & 0x1F;
+    uint32_t rn = (insn >> 5) & 0x1F;
+
+    if ((insn & 0x1F000000) == 0x10000000) { // ADR / ADRP
+        uint64_t immlo = (insn >> 29) & 0x3;
+        uint64_t immhi = (insn >> 5) & 0x7FFFF;
+        int64_t imm = signExtend((immhi << 2) | immlo, 21);
+        uint64_t base = pc_;
+        if (insn & 0x80000000) {
+            base &= ~0xFFFULL;
+            imm *= 4096;
+        }
+        writeReg(rd, base + imm, true);
+    } else if ((insn & 0x1F000000) == 0x11000000) { // ADD/SUB (immediate)
+        bool isSub = (insn >> 30) & 1;
+        bool setFlags = (insn >> 29) & 1;
+        uint64_t imm = (insn >> 10) & 0xFFF;
+        if ((insn >> 22) & 1) imm <<= 12;
+        uint64_t a = readReg(rn, is64, true);
+        uint64_t result = isSub ? addWithCarry(a, ~imm, true, is64, setFlags)
+                                : addWithCarry(a, imm, false, is64, setFlags);
+        writeReg(rd, result, is64, !setFlags);
+    } else if ((insn & 0x1F800000) == 0x12000000) { // Logical (immediate)
+        uint32_t opc = (insn >> 29) & 0x3;
+        uint64_t wmask, tmask;
+        if (!decodeBitMasks((insn >> 22) & 1, (insn >> 10) & 0x3F, (insn >> 16) & 0x3F, true, is64, wmask, tmask)) {
+            unsupported(insn);
+        }
+        uint64_t a = readReg(rn, is64);
+        uint64_t result;
+        switch (opc) {
+            case 0: result = a & wmask; break;
+            case 1: result = a | wmask; break;
+            case 2: result = a ^ wmask; break;
+            default:
+                result = a & wmask;
+                n_ = (result >> (is64 ? 63 : 31)) & 1;
+                z_ = result == 0;
+                c_ = v_ = false;
+                break;
+        }
+        writeReg(rd, result, is64, opc != 3);
+    } else if ((insn & 0x1F800000) == 0x12800000) { // Move wide
+        uint32_t opc = (insn >> 29) & 0x3;
+        uint32_t shift = ((insn >> 21) & 0x3) * 16;
+        uint64_t imm = static_cast<uint64_t>((insn >> 5) & 0xFFFF) << shift;
+        switch (opc) {
+            case 0: writeReg(rd, ~imm, is64); break;
+            case 2: writeReg(rd, imm, is64); break;
+            case 3: writeReg(rd, (readReg(rd, is64) & ~(0xFFFFULL << shift)) | imm, is64); break;
+            default: unsupported(insn);
+        }
+    } else if ((insn & 0x1F800000) == 0x13000000) { // Bitfield (SBFM/BFM/UBFM)
+        uint32_t opc = (insn >> 29) & 0x3;
+        uint32_t immr = (insn >> 16) & 0x3F;
+        uint32_t imms = (insn >> 10) & 0x3F;
+        uint64_t wmask, tmask;
+        if (opc == 3 || ((insn >> 22) & 1) != static_cast<uint32_t>(is64) ||
+            !decodeBitMasks((insn >> 22) & 1, imms, immr, false, is64, wmask, tmask)) {
+            unsupported(insn);
+        }
+        unsigned width = is64 ? 64 : 32;
+        uint64_t src = readReg(rn, is64);
+        uint64_t dst = (opc == 1) ? readReg(rd, is64) : 0;
+        uint64_t bot = (dst & ~wmask) | (ror(src, immr, width) & wmask);
+        uint64_t top;
+        if (opc == 0) {
+            top = ((src >> imms) & 1) ? widthMask(is64) : 0;
+        } else {
+            top = dst;
+        }
+        writeReg(rd, (top & ~tmask) | (bot & tmask), is64);
+    } else {
+        unsupported(insn);
+    }
+}
+
+void AArch64Simulator::execBranch(uint32_t insn) {
+    if ((insn & 0x7C000000) == 0x14000000) { // B / BL
+        int64_t offset = signExtend(insn & 0x03FFFFFF, 26) * 4;
+        if (insn & 0x80000000) {
+            x_[30] = pc_ + 4;
+        }
+        stats_.branches++;
+        stats_.takenBranches++;
+        nextPc_ = pc_ + offset;
+    } else if ((insn & 0xFF000010) == 0x54000000) { // B.cond
+        int64_t offset = signExtend((insn >> 5) & 0x7FFFF, 19) * 4;
+        stats_.branches++;
+        if (conditionHolds(insn & 0xF)) {
+            stats_.takenBranches++;
+            nextPc_ = pc_ + offset;
+        }
+    } else if ((insn & 0x7E000000) == 0x34000000) { // CBZ / CBNZ
+        bool is64 = (insn >> 31) & 1;
+        bool nonZero = (insn >> 24) & 1;
+        int64_t offset = signExtend((insn >> 5) & 0x7FFFF, 19) * 4;
+        uint64_t value = readReg(insn & 0x1F, is64);
+        stats_.branches++;
+        if ((value != 0) == nonZero) {
+            stats_.takenBranches++;
+            nextPc_ = pc_ + offset;
+        }
+    } else if ((insn & 0x7E000000) == 0x36000000) { // TBZ / TBNZ
+        uint32_t bit = (((insn >> 31) & 1) << 5) | ((insn >> 19) & 0x1F);
+        bool nonZero = (insn >> 24) & 1;
+        int64_t offset = signExtend((insn >> 5) & 0x3FFF, 14) * 4;
+        bool bitSet = (readReg(insn & 0x1F, true) >> bit) & 1;
+        stats_.branches++;
+        if (bitSet == nonZero) {
+            stats_.takenBranches++;
+            nextPc_ = pc_ + offset;
+        }
+    } else if ((insn & 0xFF9FFC1F) == 0xD61F0000) { // BR / BLR / RET
+        uint32_t opc = (insn >> 21) & 0x3;
+        uint64_t target = readReg((insn >> 5) & 0x1F, true);
+        if (opc == 1) {
+            x_[30] = pc_ + 4;
+        }
+        stats_.branches++;
+        stats_.takenBranches++;
+        nextPc_ = target;
+    } else if ((insn & 0xFFFFF01F) == 0xD503201F) { // NOP and other hints
+        // No architectural effect.
+    } else if ((insn & 0xFFE0001F) == 0xD4200000) {
+        std::stringstream ss;
+        ss << "Simulator: brk #" << ((insn >> 5) & 0xFFFF) << " at 0x" << std::hex << pc_;
+        throw std::runtime_error(ss.str());
+    } else {
+        unsupported(insn);
+    }
+}
+
+void AArch64Simulator::execLoadStore(uint32_t insn) {
+    uint32_t rt = insn & 0x1F;
+    uint32_t rn = (insn >> 5) & 0x1F;
+
+    if (insn & 0x04000000) {
+        unsupported(insn); // SIMD & floating point registers
+    }
+
+    if ((insn & 0x3A000000) == 0x28000000) { // LDP / STP
+        uint32_t opc = (insn >> 30) & 0x3;
+        uint32_t mode = (insn >> 23) & 0x3;
+        bool isLoad = (insn >> 22) & 1;
+        uint32_t rt2 = (insn >> 10) & 0x1F;
+        if (opc == 3 || (opc == 1 && !isLoad)) unsupported(insn);
+
+        uint32_t scale = (opc == 2) ? 3 : 2;
+        uint32_t size = 1u << scale;
+        int64_t offset = signExtend((insn >> 15) & 0x7F, 7) * static_cast<int64_t>(size);
+        uint64_t base = readReg(rn, true, true);
+        uint64_t address = (mode == 1) ? base : base + offset;
+
+        if (isLoad) {
+            bool is64 = opc != 0;
+            uint64_t first = load(address, size, opc == 1, is64);
+            uint64_t second = load(address + size, size, opc == 1, is64);
+            writeReg(rt, first, is64);
+            writeReg(rt2, second, is64);
+            stats_.loads++;
+        } else {
+            store(address, readReg(rt, true), size);
+            store(address + size, readReg(rt2, true), size);
+            stats_.stores++;
+        }
+        if (mode == 1 || mode == 3) {
+            writeReg(rn, base + offset, true, true);
+        }
+        return;
+    }
+
+    if ((insn & 0x3B000000) == 0x18000000) { // LDR (literal)
+        uint32_t opc = (insn >> 30) & 0x3;
+        int64_t offset = signExtend((insn >> 5) & 0x7FFFF, 19) * 4;
+        uint64_t address = pc_ + offset;
+        switch (opc) {
+            case 0: writeReg(rt, load(address, 4, false, false), false); break;
+            case 1: writeReg(rt, load(address, 8, false, true), true); break;
+            case 2: writeReg(rt, load(address, 4, true, true), true); break;
+            default: unsupported(insn);
+        }
+        stats_.loads++;
+        return;
+    }
+
+    uint32_t sizeLog2 = (insn >> 30) & 0x3;
+    uint32_t opc = (insn >> 22) & 0x3;
+    uint64_t base = readReg(rn, true, true);
+    uint64_t address;
+    bool writeBack = false;
+    uint64_t newBase = base;
+
+    if ((insn & 0x3B000000) == 0x39000000) { // Unsigned offset
+        address = base + (static_cast<uint64_t>((insn >> 10) & 0xFFF) << sizeLog2);
+    } else if ((insn & 0x3B200000) == 0x38000000) { // Unscaled / pre-index / post-index
+        int64_t imm = signExtend((insn >> 12) & 0x1FF, 9);
+        uint32_t mode = (insn >> 10) & 0x3;
+        if (mode == 1) { // Post-index
+            address = base;
+            newBase = base + imm;
+            writeBack = true;
+        } else if (mode == 3) { // Pre-index
+            address = base + imm;
+            newBase = address;
+            writeBack = true;
+        } else {
+            address = base + imm;
+        }
+    } else if ((insn & 0x3B200C00) == 0x38200800) { // Register offset
+        uint32_t rm = (insn >> 16) & 0x1F;
+        uint32_t option = (insn >> 13) & 0x7;
+        uint32_t shift = ((insn >> 12) & 1) ? sizeLog2 : 0;
+        address = base + extendValue(readReg(rm, true), option, shift, true);
+    } else {
+        unsupported(insn);
+    }
+
+    uint32_t size = 1u << sizeLog2;
+    switch (opc) {
+        case 0: // Store
+            store(address, readReg(rt, true), size);
+            stats_.stores++;
+            break;
+        case 1: // Load, zero-extended
+            writeReg(rt, load(address, size, false, true), true);
+            stats_.loads++;
+            break;
+        case 2: // Load, sign-extended to 64 bits
+            if (sizeLog2 == 3) unsupported(insn);
+            writeReg(rt, load(address, size, true, true), true);
+            stats_.loads++;
+            break;
+        default: // Load, sign-extended to 32 bits
+            if (sizeLog2 >= 2) unsupported(insn);
+            writeReg(rt, load(address, size, true, false), false);
+            stats_.loads++;
+            break;
+    }
+    if (writeBack) {
+        writeReg(rn, newBase, true, true);
+    }
+}
+
+void AArch64Simulator::execDataProcessingRegister(uint32_t insn) {
+    bool is64 = (insn >> 31) & 1;
+    uint32_t rd = insn & 0x1F;
+    uint32_t rn = (insn >> 5) & 0x1F;
+    uint32_t rm = (insn >> 16) & 0x1F;
+
+    if ((insn & 0x1F000000) == 0x0A000000) { // Logical (shifted register)
+        uint32_t opc = (insn >> 29) & 0x3;
+        uint32_t amount = (insn >> 10) & 0x3F;
+        if (!is64 && amount >= 32) unsupported(insn);
+        uint64_t b = shiftValue(readReg(rm, is64), (insn >> 22) & 0x3, amount, is64);
+        if ((insn >> 21) & 1) b = ~b & widthMask(is64);
+        uint64_t a = readReg(rn, is64);
+        uint64_t result;
+        switch (opc) {
+            case 0: result = a & b; break;
+            case 1: result = a | b; break;
+            case 2: result = a ^ b; break;
+            default:
+                result = a & b;
+                n_ = (result >> (is64 ? 63 : 31)) & 1;
+                z_ = result == 0;
+                c_ = v_ = false;
+                break;
+        }
+        writeReg(rd, result, is64);
+    } else if ((insn & 0x1F200000) == 0x0B000000) { // ADD/SUB (shifted register)
+        bool isSub = (insn >> 30) & 1;
+        bool setFlags = (insn >> 29) & 1;
+        uint32_t type = (insn >> 22) & 0x3;
+        uint32_t amount = (insn >> 10) & 0x3F;
+        if (type == 3 || (!is64 && amount >= 32)) unsupported(insn);
+        uint64_t a = readReg(rn, is64);
+        uint64_t b = shiftValue(readReg(rm, is64), type, amount, is64);
+        uint64_t result = isSub ? addWithCarry(a, ~b, true, is64, setFlags)
+                                : addWithCarry(a, b, false, is64, setFlags);
+        writeReg(rd, result, is64);
+    } else if ((insn & 0x1F200000) == 0x0B200000) { // ADD/SUB (extended register)
+        bool isSub = (insn >> 30) & 1;
+        bool setFlags = (insn >> 29) & 1;
+        uint32_t shift = (insn >> 10) & 0x7;
+        if (shift > 4) unsupported(insn);
+        uint64_t a = readReg(rn, is64, true);
+        uint64_t b = extendValue(readReg(rm, true), (insn >> 13) & 0x7, shift, is64);
+        uint64_t result = isSub ? addWithCarry(a, ~b, true, is64, setFlags)
+                                : addWithCarry(a, b, false, is64, setFlags);
+        writeReg(rd, result, is64, !setFlags);
+    } else if ((insn & 0x1FE00000) == 0x1A800000) { // Conditional select
+        if ((insn >> 29) & 1) unsupported(insn);
+        bool op = (insn >> 30) & 1;
+        uint32_t op2 = (insn >> 10) & 0x3;
+        if (op2 > 1) unsupported(insn);
+        uint64_t result;
+        if (conditionHolds((insn >> 12) & 0xF)) {
+            result = readReg(rn, is64);
+        } else {
+            uint64_t b = readReg(rm, is64);
+            if (!op) {
+                result = (op2 == 0) ? b : b + 1;      // CSEL / CSINC
+            } else {
+                result = (op2 == 0) ? ~b : (~b + 1);  // CSINV / CSNEG
+            }
+        }
+        writeReg(rd, result, is64);
+    } else if ((insn & 0x5FE00000) == 0x1AC00000) { // Data processing (2 source)
+        uint32_t opcode = (insn >> 10) & 0x3F;
+        uint64_t a = readReg(rn, is64);
+        uint64_t b = readReg(rm, is64);
+        unsigned width = is64 ? 64 : 32;
+        uint64_t result;
+        switch (opcode) {
+            case 0x02: // UDIV
+                result = (b == 0) ? 0 : a / b;
+                break;
+            case 0x03: { // SDIV
+                int64_t sa = signExtend(a, width);
+                int64_t sb = signExtend(b, width);
+                if (sb == 0) {
+                    result = 0;
+                } else if (sb == -1) {
+                    result = 0 - a; // Avoids the host trap on INT_MIN / -1
+                } else {
+                    result = static_cast<uint64_t>(sa / sb);
+                }
+                break;
+            }
+            case 0x08: result = shiftValue(a, 0, static_cast<uint32_t>(b % width), is64); break; // LSLV
+            case 0x09: result = shiftValue(a, 1, static_cast<uint32_t>(b % width), is64); break; // LSRV
+            case 0x0A: result = shiftValue(a, 2, static_cast<uint32_t>(b % width), is64); break; // ASRV
+            case 0x0B: result = shiftValue(a, 3, static_cast<uint32_t>(b % width), is64); break; // RORV
+            default: unsupported(insn);
+        }
+        writeReg(rd, result, is64);
+    } else if ((insn & 0x1F000000) == 0x1B000000) { // Data processing (3 source)
+        if ((insn >> 29) & 0x3) unsupported(insn);
+        uint32_t op31 = (insn >> 21) & 0x7;
+        bool o0 = (insn >> 15) & 1;
+        uint32_t ra = (insn >> 10) & 0x1F;
+        uint64_t a = readReg(rn, is64);
+        uint64_t b = readReg(rm, is64);
+        uint64_t result;
+        if (op31 == 0) { // MADD / MSUB
+            uint64_t acc = readReg(ra, is64);
+            result = o0 ? acc - a * b : acc + a * b;
+        } else if (op31 == 2 && !o0 && is64) { // SMULH
+            __int128 product = static_cast<__int128>(static_cast<int64_t>(a)) * static_cast<int64_t>(b);
+            result = static_cast<uint64_t>(product >> 64);
+        } else if (op31 == 6 && !o0 && is64) { // UMULH
+            unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            result = static_cast<uint64_t>(product >> 64);
+        } else {
+            unsupported(insn);
+        }
+        writeReg(rd, result, is64);
+    } else {
+        unsupported(insn);
+    }
+}
+
+void AArch64Simulator::unsupported(uint32_t insn) const {
+    std::stringstream ss;
+    ss << "Simulator: unsupported instruction 0x" << std::hex << std::setw(8) << std::setfill('0') << insn
+       << " at 0x" << pc_;
+    throw std::runtime_error(ss.str());
+}
+
+void AArch64Simulator::printStats() const {
+    std::cout << "=== Simulator Statistics ===\n";
+    std::cout << "  Instructions retired: " << stats_.instructions << "\n";
+    std::cout << "  Memory accesses:      " << stats_.memoryAccesses()
+              << " (" << stats_.loads << " loads, " << stats_.stores << " stores)\n";
+    std::cout << "  Branches:             " << stats_.branches
+              << " (" << stats_.takenBranches << " taken)\n";
+    std::cout << "  Runtime calls:        " << stats_.runtimeCalls << "\n";
+}
@@ -0,0 +1,133 @@
+#ifndef AARCH64_SIMULATOR_H
+#define AARCH64_SIMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class AArch64Simulator
+ * @brief An instruction-set simulator for the AArch64 subset emitted by AArch64Instructions.
+ *
+ * The simulator executes a linked JIT image (see JITExecutor) in-process on
+ * hosts that cannot run AArch64 code natively. Guest memory is host memory:
+ * loads and stores go straight to the addresses computed by the program, so
+ * strings in the image and vectors returned by bcpl_vec work unchanged. The
+ * guest stack is a buffer owned by the simulator. Accesses to the first page
+ * and stores into regions marked with protect() stop the run with a fault
+ * naming the guest PC, rather than crashing the host.
+ *
+ * When control reaches the address of a symbol registered in JitRuntime, the
+ * simulator calls the host function natively with x0-x7 as arguments, stores
+ * the result in x0 and returns to x30. A call to "finish" halts the simulation
+ * instead of exiting the process, so statistics can still be reported.
+ *
+ * Supported instructions:
+ * - movz/movk/movn, adr/adrp
+ * - add/sub/adds/subs (immediate, shifted and extended register)
+ * - mul/madd/msub, sdiv/udiv, lslv/lsrv/asrv/rorv, ubfm/sbfm
+ * - and/orr/eor/ands (shifted register and bitmask immediate)
+ * - csel/csinc/csinv/csneg (cset, csetm, cneg)
+ * - ldr/str (unsigned offset, unscaled, pre/post index, register offset, literal)
+ * - ldp/stp (signed offset, pre/post index)
+ * - b/bl/b.cond/cbz/cbnz/tbz/tbnz/br/blr/ret, nop
+ */
+class AArch64Simulator {
+public:
+    /**
+     * @brief Counters describing a simulated run.
+     */
+    struct Stats {
+        uint64_t instructions = 0;   ///< Retired guest instructions
+        uint64_t loads = 0;          ///< Load instructions (ldr/ldp/literal)
+        uint64_t stores = 0;         ///< Store instructions (str/stp)
+        uint64_t branches = 0;       ///< Taken and not-taken branch instructions
+        uint64_t takenBranches = 0;  ///< Branches that changed the program counter
+        uint64_t runtimeCalls = 0;   ///< Native calls into JitRuntime symbols
+
+        uint64_t memoryAccesses() const { return loads + stores; }
+    };
+
+    /**
+     * @brief Creates a simulator with a guest stack of the given size.
+     * @param stackSize Size of the guest stack in bytes.
+     */
+    explicit AArch64Simulator(size_t stackSize = 1024 * 1024);
+
+    /**
+     * @brief Runs guest code from the given entry point until it returns.
+     * @param entry Host address of the first instruction.
+     * @param instructionLimit Stop with an error after this many instructions (0 = no limit).
+     * @return The value of x0 when the entry function returns or the program finishes.
+     * @throws std::runtime_error on an undefined or unsupported instruction, or a memory fault.
+     */
+    int64_t run(uintptr_t entry, uint64_t instructionLimit = 0);
+
+    /**
+     * @brief Sets the address run() loads into x28, the global vector pointer.
+     */
+    void setGlobalPointer(uint64_t address) { globalPointer_ = address; }
+
+    /**
+     * @brief Marks [base, base + size) read-only to the guest, such as a loaded JIT image.
+     */
+    void protect(uint64_t base, size_t size) { readOnly_.push_back({base, base + size}); }
+
+    const Stats& getStats() const { return stats_; }
+    void resetStats() { stats_ = Stats(); }
+
+    uint64_t getRegister(uint32_t reg) const;
+    void setRegister(uint32_t reg, uint64_t value);
+    uint64_t getSP() const { return sp_; }
+    uint64_t getPC() const { return pc_; }
+
+    /**
+     * @brief Prints the statistics of the last run to stdout.
+     */
+    void printStats() const;
+
+private:
+    uint64_t x_[31] = {};
+    uint64_t globalPointer_ = 0;
+    uint64_t sp_ = 0;
+    uint64_t pc_ = 0;
+    uint64_t nextPc_ = 0;
+    bool n_ = false, z_ = false, c_ = false, v_ = false;
+    bool halted_ = false;
+
+    std::vector<uint8_t> stack_;
+    std::unordered_map<uintptr_t, std::string> runtimeSymbols_;
+    std::vector<std::pair<uint64_t, uint64_t>> readOnly_;  // [begin, end) of protected regions
+    Stats stats_;
+
+    void step();
+    void callRuntime(const std::string& name);
+
+    // Register access. Register 31 is SP or XZR depending on the encoding.
+    uint64_t readReg(uint32_t reg, bool is64, bool spAllowed = false) const;
+    void writeReg(uint32_t reg, uint64_t value, bool is64, bool spAllowed = false);
+
+    bool conditionHolds(uint32_t cond) const;
+    uint64_t addWithCarry(uint64_t a, uint64_t b, bool carryIn, bool is64, bool setFlags);
+    static uint64_t shiftValue(uint64_t value, uint32_t type, uint32_t amount, bool is64);
+    static uint64_t extendValue(uint64_t value, uint32_t option, uint32_t shift, bool is64);
+    static bool decodeBitMasks(uint32_t n, uint32_t imms, uint32_t immr, bool immediate, bool is64,
+                               uint64_t& wmask, uint64_t& tmask);
+
+    uint64_t load(uint64_t address, uint32_t size, bool signExtend, bool is64);
+    void store(uint64_t address, uint64_t value, uint32_t size);
+
+    void execDataProcessingImmediate(uint32_t insn);
+    void execBranch(uint32_t insn);
+    void execLoadStore(uint32_t insn);
+    void execDataProcessingRegister(uint32_t insn);
+
+    void checkAccess(uint64_t address, uint32_t size, bool isStore) const;
+
+    [[noreturn]] void unsupported(uint32_t insn) const;
+};
+
+#endif // AARCH64_SIMULATOR_H
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <type_traits>
 #include "Lexer.h" // For TokenType
 #include "ASTVisitor.h" // Include for ASTVisitor
 
@@ -21,26 +23,117 @@ using StmtPtr = std::unique_ptr<Statement>;
 using DeclPtr = std::unique_ptr<Declaration>;
 using ProgramPtr = std::unique_ptr<Program>;
 
+// --- Node Kinds ---
+// One tag per concrete node class, grouped so that each abstract base covers
+// a contiguous range. Dispatch switches on the tag instead of probing with
+// dynamic_cast; see nodeCast() below and ASTRewriter.h.
+enum class NodeKind : uint8_t {
+    // Expressions
+    NumberLiteral,
+    FloatLiteral,
+    StringLiteral,
+    CharLiteral,
+    VariableAccess,
+    UnaryOp,
+    BinaryOp,
+    FunctionCall,
+    ConditionalExpression,
+    TableConstructor,
+    VectorConstructor,
+    Valof,
+    DereferenceExpr,
+    VectorAccess,
+    CharacterAccess,
+    // Statements
+    SwitchonStatement,
+    BreakStatement,
+    LoopStatement,
+    RepeatStatement,
+    EndcaseStatement,
+    Assignment,
+    RoutineCall,
+    CompoundStatement,
+    IfStatement,
+    TestStatement,
+    WhileStatement,
+    ForStatement,
+    GotoStatement,
+    LabeledStatement,
+    ReturnStatement,
+    DeclarationStatement,
+    FinishStatement,
+    ResultisStatement,
+    // Declarations
+    GetDirective,
+    LetDeclaration,
+    GlobalDeclaration,
+    ManifestDeclaration,
+    FunctionDeclaration,
+    // Root
+    Program
+};
+
 // --- Base Node Class ---
 // The base class for all nodes in the Abstract Syntax Tree.
+// Nodes are allocated in the current ASTArena when there is one (see ASTArena.h).
 class Node {
 public:
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     virtual ~Node() = default;
     virtual std::unique_ptr<Node> clone() const = 0;
     virtual void accept(ASTVisitor* visitor) = 0;
+
+    NodeKind kind() const { return kind_; }
+
+protected:
+    explicit Node(NodeKind kind) : kind_(kind) {}
+
+private:
+    NodeKind kind_;
 };
 
+// --- Kind Checks ---
+// isNode<T>(n) and nodeCast<T>(n) replace dynamic_cast<T*>(n) for AST nodes:
+// one compare of the kind tag for a concrete class, a range check for
+// Expression, Statement and Declaration. Both accept nullptr.
+template <typename T>
+bool isNode(const Node* node) {
+    if (!node) return false;
+    if constexpr (std::is_abstract_v<T>) {
+        return T::classof(node->kind());
+    } else {
+        return node->kind() == T::KIND;
+    }
+}
+
+template <typename T>
+T* nodeCast(Node* node) {
+    return isNode<T>(node) ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* nodeCast(const Node* node) {
+    return isNode<T>(node) ? static_cast<const T*>(node) : nullptr;
+}
+
 // --- Expression Nodes ---
 class Expression : public Node {
 public:
+    static bool classof(NodeKind kind) { return kind >= NodeKind::NumberLiteral && kind <= NodeKind::CharacterAccess; }
     virtual ExprPtr cloneExpr() const = 0; // Specific clone for expressions
     std::unique_ptr<Node> clone() const override { return cloneExpr(); }
+
+protected:
+    explicit Expression(NodeKind kind) : Node(kind) {}
 };
 
 // Represents a numeric literal (integer).
 class NumberLiteral : public Expression {
 public:
-    NumberLiteral(int64_t val) : value(val) {}
+    static constexpr NodeKind KIND = NodeKind::NumberLiteral;
+    NumberLiteral(int64_t val) : Expression(KIND), value(val) {}
     int64_t value;
     ExprPtr cloneExpr() const override { return std::make_unique<NumberLiteral>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -49,7 +142,8 @@ public:
 // Represents a floating-point literal.
 class FloatLiteral : public Expression {
 public:
-    FloatLiteral(double val) : value(val) {}
+    static constexpr NodeKind KIND = NodeKind::FloatLiteral;
+    FloatLiteral(double val) : Expression(KIND), value(val) {}
     double value;
     ExprPtr cloneExpr() const override { return std::make_unique<FloatLiteral>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -58,7 +152,8 @@ public:
 // Represents a string literal.
 class StringLiteral : public Expression {
 public:
-    StringLiteral(std::string val) : value(std::move(val)) {}
+    static constexpr NodeKind KIND = NodeKind::StringLiteral;
+    StringLiteral(std::string val) : Expression(KIND), value(std::move(val)) {}
     std::string value;
     ExprPtr cloneExpr() const override { return std::make_unique<StringLiteral>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -67,7 +162,8 @@ public:
 // Represents a character literal.
 class CharLiteral : public Expression {
 public:
-    CharLiteral(int64_t val) : value(val) {}
+    static constexpr NodeKind KIND = NodeKind::CharLiteral;
+    CharLiteral(int64_t val) : Expression(KIND), value(val) {}
     int64_t value;
     ExprPtr cloneExpr() const override { return std::make_unique<CharLiteral>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -76,8 +172,11 @@ public:
 // Represents accessing a variable by its name.
 class VariableAccess : public Expression {
 public:
-    VariableAccess(std::string name) : name(std::move(name)) {}
+    static constexpr NodeKind KIND = NodeKind::VariableAccess;
+    VariableAccess(std::string name) : Expression(KIND), name(std::move(name)), symbol(SymbolTable::getInstance().intern(this->name)) {}
+    VariableAccess(std::string name, SymbolId symbol) : Expression(KIND), name(std::move(name)), symbol(symbol) {}
     std::string name;
+    SymbolId symbol; // The interned name, which tables downstream are keyed on
     ExprPtr cloneExpr() const override { return std::make_unique<VariableAccess>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -85,7 +184,8 @@ public:
 // Represents a unary operation (e.g., @E, ~E, !E).
 class UnaryOp : public Expression {
 public:
-    UnaryOp(TokenType op, ExprPtr rhs) : op(op), rhs(std::move(rhs)) {}
+    static constexpr NodeKind KIND = NodeKind::UnaryOp;
+    UnaryOp(TokenType op, ExprPtr rhs) : Expression(KIND), op(op), rhs(std::move(rhs)) {}
     TokenType op;
     ExprPtr rhs;
     ExprPtr cloneExpr() const override { return std::make_unique<UnaryOp>(op, rhs->cloneExpr()); }
@@ -95,8 +195,9 @@ public:
 // Represents a binary operation (e.g., E1 + E2, E1 = E2).
 class BinaryOp : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::BinaryOp;
     BinaryOp(TokenType op, ExprPtr left, ExprPtr right)
-        : op(op), left(std::move(left)), right(std::move(right)) {}
+        : Expression(KIND), op(op), left(std::move(left)), right(std::move(right)) {}
     TokenType op;
     ExprPtr left;
     ExprPtr right;
@@ -107,8 +208,9 @@ public:
 // Represents a function call.
 class FunctionCall : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::FunctionCall;
     FunctionCall(ExprPtr func, std::vector<ExprPtr> args)
-        : function(std::move(func)), arguments(std::move(args)) {}
+        : Expression(KIND), function(std::move(func)), arguments(std::move(args)) {}
     ExprPtr function;
     std::vector<ExprPtr> arguments;
     ExprPtr cloneExpr() const override {
@@ -124,8 +226,9 @@ public:
 // Represents a conditional expression (E1 -> E2, E3).
 class ConditionalExpression : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::ConditionalExpression;
     ConditionalExpression(ExprPtr cond, ExprPtr true_expr, ExprPtr false_expr)
-        : condition(std::move(cond)),
+        : Expression(KIND), condition(std::move(cond)),
           trueExpr(std::move(true_expr)),
           falseExpr(std::move(false_expr)) {}
     ExprPtr condition;
@@ -138,12 +241,17 @@ public:
 // --- Statement Nodes ---
 class Statement : public Node {
 public:
+    static bool classof(NodeKind kind) { return kind >= NodeKind::SwitchonStatement && kind <= NodeKind::ResultisStatement; }
     virtual StmtPtr cloneStmt() const = 0; // Specific clone for statements
     std::unique_ptr<Node> clone() const override { return cloneStmt(); }
+
+protected:
+    explicit Statement(NodeKind kind) : Node(kind) {}
 };
 
 class RepeatStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::RepeatStatement;
     enum class LoopType { repeat, repeatwhile, repeatuntil };
 
     std::unique_ptr<Statement> body;
@@ -151,11 +259,11 @@ public:
     LoopType loopType;
 
     RepeatStatement(StmtPtr body)
-        : body(std::move(body)) {}
+        : Statement(KIND), body(std::move(body)) {}
 
 
     RepeatStatement(std::unique_ptr<Statement> body, std::unique_ptr<Expression> condition, LoopType loopType)
-        : body(std::move(body)), condition(std::move(condition)), loopType(loopType) {}
+        : Statement(KIND), body(std::move(body)), condition(std::move(condition)), loopType(loopType) {}
 
     void accept(ASTVisitor* visitor) override;
 
@@ -171,13 +279,14 @@ public:
 // Represents a SWITCHON statement.
 class SwitchonStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::SwitchonStatement;
     struct SwitchCase {
         int value;
         std::string label; // Label for the case's code block
         StmtPtr statement;
     };
     SwitchonStatement(ExprPtr expr, std::vector<SwitchCase> cases, StmtPtr default_case)
-        : expression(std::move(expr)), cases(std::move(cases)), default_case(std::move(default_case)) {}
+        : Statement(KIND), expression(std::move(expr)), cases(std::move(cases)), default_case(std::move(default_case)) {}
     ExprPtr expression;
     std::vector<SwitchCase> cases;
     StmtPtr default_case; // Can be nullptr
@@ -194,6 +303,8 @@ public:
 // Represents a BREAK statement.
 class BreakStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::BreakStatement;
+    BreakStatement() : Statement(KIND) {}
     StmtPtr cloneStmt() const override { return std::make_unique<BreakStatement>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -201,6 +312,8 @@ public:
 // Represents a LOOP statement.
 class LoopStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::LoopStatement;
+    LoopStatement() : Statement(KIND) {}
     StmtPtr cloneStmt() const override { return std::make_unique<LoopStatement>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -209,6 +322,8 @@ public:
 // Represents an ENDCASE statement.
 class EndcaseStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::EndcaseStatement;
+    EndcaseStatement() : Statement(KIND) {}
     StmtPtr cloneStmt() const override { return std::make_unique<EndcaseStatement>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -217,6 +332,8 @@ public:
 // Represents a table constructor.
 class TableConstructor : public Expression {
 public:
+    static constexpr NodeKind KIND = NodeKind::TableConstructor;
+    TableConstructor() : Expression(KIND) {}
     ExprPtr cloneExpr() const override { return std::make_unique<TableConstructor>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -224,7 +341,8 @@ public:
 // Represents a vector constructor.
 class VectorConstructor : public Expression {
 public:
-    explicit VectorConstructor(ExprPtr size) : size(std::move(size)) {}
+    static constexpr NodeKind KIND = NodeKind::VectorConstructor;
+    explicit VectorConstructor(ExprPtr size) : Expression(KIND), size(std::move(size)) {}
     ExprPtr size;
     ExprPtr cloneExpr() const override { return std::make_unique<VectorConstructor>(size->cloneExpr()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -233,7 +351,8 @@ public:
 // Represents a VALOF block.
 class Valof : public Expression {
 public:
-    explicit Valof(StmtPtr body) : body(std::move(body)) {}
+    static constexpr NodeKind KIND = NodeKind::Valof;
+    explicit Valof(StmtPtr body) : Expression(KIND), body(std::move(body)) {}
     StmtPtr body;
     ExprPtr cloneExpr() const override { return std::make_unique<Valof>(body->cloneStmt()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -242,7 +361,8 @@ public:
 // Represents a dereference expression (e.g., !P).
 class DereferenceExpr : public Expression {
 public:
-    explicit DereferenceExpr(ExprPtr ptr) : pointer(std::move(ptr)) {}
+    static constexpr NodeKind KIND = NodeKind::DereferenceExpr;
+    explicit DereferenceExpr(ExprPtr ptr) : Expression(KIND), pointer(std::move(ptr)) {}
     ExprPtr pointer;
     ExprPtr cloneExpr() const override { return std::make_unique<DereferenceExpr>(pointer->cloneExpr()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -251,7 +371,8 @@ public:
 // Represents a vector access expression (e.g., V!I).
 class VectorAccess : public Expression {
 public:
-    VectorAccess(ExprPtr vec, ExprPtr idx) : vector(std::move(vec)), index(std::move(idx)) {}
+    static constexpr NodeKind KIND = NodeKind::VectorAccess;
+    VectorAccess(ExprPtr vec, ExprPtr idx) : Expression(KIND), vector(std::move(vec)), index(std::move(idx)) {}
     ExprPtr vector;
     ExprPtr index;
     ExprPtr cloneExpr() const override { return std::make_unique<VectorAccess>(vector->cloneExpr(), index->cloneExpr()); }
@@ -261,7 +382,8 @@ public:
 // Represents a character access expression (e.g., S%I).
 class CharacterAccess : public Expression {
 public:
-    CharacterAccess(ExprPtr str, ExprPtr idx) : string(std::move(str)), index(std::move(idx)) {}
+    static constexpr NodeKind KIND = NodeKind::CharacterAccess;
+    CharacterAccess(ExprPtr str, ExprPtr idx) : Expression(KIND), string(std::move(str)), index(std::move(idx)) {}
     ExprPtr string;
     ExprPtr index;
     ExprPtr cloneExpr() const override { return std::make_unique<CharacterAccess>(string->cloneExpr(), index->cloneExpr()); }
@@ -271,8 +393,9 @@ public:
 // Represents an assignment (e.g., V!i := E).
 class Assignment : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::Assignment;
     Assignment(std::vector<ExprPtr> lhs, std::vector<ExprPtr> rhs)
-        : lhs(std::move(lhs)), rhs(std::move(rhs)) {}
+        : Statement(KIND), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
     std::vector<ExprPtr> lhs;
     std::vector<ExprPtr> rhs;
     StmtPtr cloneStmt() const override {
@@ -292,7 +415,8 @@ public:
 // Represents a call to a routine (which doesn't return a value).
 class RoutineCall : public Statement {
 public:
-    explicit RoutineCall(ExprPtr call_expr) : call_expression(std::move(call_expr)) {}
+    static constexpr NodeKind KIND = NodeKind::RoutineCall;
+    explicit RoutineCall(ExprPtr call_expr) : Statement(KIND), call_expression(std::move(call_expr)) {}
     ExprPtr call_expression;
     StmtPtr cloneStmt() const override { return std::make_unique<RoutineCall>(call_expression->cloneExpr()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -301,7 +425,8 @@ public:
 // Represents a block of statements, e.g., $( C1; C2 $)
 class CompoundStatement : public Statement {
 public:
-    explicit CompoundStatement(std::vector<std::unique_ptr<Node>> stmts) : statements(std::move(stmts)) {}
+    static constexpr NodeKind KIND = NodeKind::CompoundStatement;
+    explicit CompoundStatement(std::vector<std::unique_ptr<Node>> stmts) : Statement(KIND), statements(std::move(stmts)) {}
     std::vector<std::unique_ptr<Node>> statements;
     StmtPtr cloneStmt() const override {
         std::vector<std::unique_ptr<Node>> new_stmts;
@@ -317,8 +442,9 @@ public:
 // Represents an IF/UNLESS command.
 class IfStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::IfStatement;
     IfStatement(ExprPtr cond, StmtPtr then_stmt)
-        : condition(std::move(cond)), then_statement(std::move(then_stmt)) {}
+        : Statement(KIND), condition(std::move(cond)), then_statement(std::move(then_stmt)) {}
     ExprPtr condition;
     StmtPtr then_statement;
     StmtPtr cloneStmt() const override { return std::make_unique<IfStatement>(condition->cloneExpr(), then_statement->cloneStmt()); }
@@ -328,8 +454,9 @@ public:
 // Represents a TEST command.
 class TestStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::TestStatement;
     TestStatement(ExprPtr cond, StmtPtr then_stmt, StmtPtr else_stmt)
-        : condition(std::move(cond)),
+        : Statement(KIND), condition(std::move(cond)),
           then_statement(std::move(then_stmt)),
           else_statement(std::move(else_stmt)) {}
     ExprPtr condition;
@@ -342,8 +469,9 @@ public:
 // Represents a WHILE/UNTIL loop.
 class WhileStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::WhileStatement;
     WhileStatement(ExprPtr cond, StmtPtr body)
-        : condition(std::move(cond)), body(std::move(body)) {}
+        : Statement(KIND), condition(std::move(cond)), body(std::move(body)) {}
     ExprPtr condition;
     StmtPtr body;
     StmtPtr cloneStmt() const override { return std::make_unique<WhileStatement>(condition->cloneExpr(), body->cloneStmt()); }
@@ -353,8 +481,9 @@ public:
 // Represents a FOR loop.
 class ForStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::ForStatement;
     ForStatement(std::string var, ExprPtr from, ExprPtr to, ExprPtr by, StmtPtr body)
-        : var_name(std::move(var)), from_expr(std::move(from)),
+        : Statement(KIND), var_name(std::move(var)), from_expr(std::move(from)),
           to_expr(std::move(to)), by_expr(std::move(by)), body(std::move(body)) {}
     std::string var_name;
     ExprPtr from_expr;
@@ -368,7 +497,8 @@ public:
 // Represents a GOTO statement.
 class GotoStatement : public Statement {
 public:
-    explicit GotoStatement(ExprPtr label_expr) : label(std::move(label_expr)) {}
+    static constexpr NodeKind KIND = NodeKind::GotoStatement;
+    explicit GotoStatement(ExprPtr label_expr) : Statement(KIND), label(std::move(label_expr)) {}
     ExprPtr label;
     StmtPtr cloneStmt() const override { return std::make_unique<GotoStatement>(label->cloneExpr()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -377,7 +507,8 @@ public:
 // Represents a labeled statement.
 class LabeledStatement : public Statement {
 public:
-    LabeledStatement(std::string name, StmtPtr stmt) : name(std::move(name)), statement(std::move(stmt)) {}
+    static constexpr NodeKind KIND = NodeKind::LabeledStatement;
+    LabeledStatement(std::string name, StmtPtr stmt) : Statement(KIND), name(std::move(name)), statement(std::move(stmt)) {}
     std::string name;
     StmtPtr statement;
     StmtPtr cloneStmt() const override { return std::make_unique<LabeledStatement>(name, statement->cloneStmt()); }
@@ -387,13 +518,16 @@ public:
 // Represents a RETURN statement.
 class ReturnStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::ReturnStatement;
+    ReturnStatement() : Statement(KIND) {}
     StmtPtr cloneStmt() const override { return std::make_unique<ReturnStatement>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
 
 class DeclarationStatement : public Statement {
 public:
-    explicit DeclarationStatement(DeclPtr decl) : declaration(std::move(decl)) {}
+    static constexpr NodeKind KIND = NodeKind::DeclarationStatement;
+    explicit DeclarationStatement(DeclPtr decl) : Statement(KIND), declaration(std::move(decl)) {}
     DeclPtr declaration;
     StmtPtr cloneStmt() const override;
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -402,6 +536,8 @@ public:
 // Represents a FINISH statement.
 class FinishStatement : public Statement {
 public:
+    static constexpr NodeKind KIND = NodeKind::FinishStatement;
+    FinishStatement() : Statement(KIND) {}
     StmtPtr cloneStmt() const override { return std::make_unique<FinishStatement>(); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
 };
@@ -409,7 +545,8 @@ public:
 // Represents a RESULTIS statement.
 class ResultisStatement : public Statement {
 public:
-    explicit ResultisStatement(ExprPtr val) : value(std::move(val)) {}
+    static constexpr NodeKind KIND = NodeKind::ResultisStatement;
+    explicit ResultisStatement(ExprPtr val) : Statement(KIND), value(std::move(val)) {}
     ExprPtr value;
     StmtPtr cloneStmt() const override { return std::make_unique<ResultisStatement>(value->cloneExpr()); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -418,13 +555,18 @@ public:
 // --- Declaration Nodes ---
 class Declaration : public Node {
 public:
+    static bool classof(NodeKind kind) { return kind >= NodeKind::GetDirective && kind <= NodeKind::FunctionDeclaration; }
     virtual DeclPtr cloneDecl() const = 0; // Specific clone for declarations
     std::unique_ptr<Node> clone() const override { return cloneDecl(); }
+
+protected:
+    explicit Declaration(NodeKind kind) : Node(kind) {}
 };
 
 class GetDirective : public Declaration {
 public:
-    explicit GetDirective(std::string file) : filename(std::move(file)) {}
+    static constexpr NodeKind KIND = NodeKind::GetDirective;
+    explicit GetDirective(std::string file) : Declaration(KIND), filename(std::move(file)) {}
     std::string filename;
     DeclPtr cloneDecl() const override { return std::make_unique<GetDirective>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -433,11 +575,12 @@ public:
 // Represents a LET declaration for variables.
 class LetDeclaration : public Declaration {
 public:
+    static constexpr NodeKind KIND = NodeKind::LetDeclaration;
     struct VarInit {
         std::string name;
         ExprPtr init; // Can be nullptr
     };
-    explicit LetDeclaration(std::vector<VarInit> inits) : initializers(std::move(inits)) {}
+    explicit LetDeclaration(std::vector<VarInit> inits) : Declaration(KIND), initializers(std::move(inits)) {}
     std::vector<VarInit> initializers;
     DeclPtr cloneDecl() const override {
         std::vector<VarInit> new_inits;
@@ -451,11 +594,12 @@ public:
 
 class GlobalDeclaration : public Declaration {
 public:
+    static constexpr NodeKind KIND = NodeKind::GlobalDeclaration;
     struct Global {
         std::string name;
         int size;
     };
-    explicit GlobalDeclaration(std::vector<Global> globals) : globals(std::move(globals)) {}
+    explicit GlobalDeclaration(std::vector<Global> globals) : Declaration(KIND), globals(std::move(globals)) {}
     std::vector<Global> globals;
     DeclPtr cloneDecl() const override { return std::make_unique<GlobalDeclaration>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -463,11 +607,12 @@ public:
 
 class ManifestDeclaration : public Declaration {
 public:
+    static constexpr NodeKind KIND = NodeKind::ManifestDeclaration;
     struct Manifest {
         std::string name;
         int value;
     };
-    explicit ManifestDeclaration(std::vector<Manifest> manifests) : manifests(std::move(manifests)) {}
+    explicit ManifestDeclaration(std::vector<Manifest> manifests) : Declaration(KIND), manifests(std::move(manifests)) {}
     std::vector<Manifest> manifests;
     DeclPtr cloneDecl() const override { return std::make_unique<ManifestDeclaration>(*this); }
     void accept(ASTVisitor* visitor) override { visitor->visit(this); }
@@ -476,8 +621,9 @@ public:
 // Represents a function or routine declaration.
 class FunctionDeclaration : public Declaration {
 public:
+    static constexpr NodeKind KIND = NodeKind::FunctionDeclaration;
     FunctionDeclaration(std::string name, std::vector<std::string> params, ExprPtr body_expr, StmtPtr body_stmt)
-        : name(std::move(name)), params(std::move(params)),
+        : Declaration(KIND), name(std::move(name)), params(std::move(params)),
           body_expr(std::move(body_expr)), body_stmt(std::move(body_stmt)) {}
     std::string name;
     std::vector<std::string> params;
@@ -492,7 +638,8 @@ public:
 // The root of the entire AST.
 class Program : public Node {
 public:
-    explicit Program(std::vector<DeclPtr> decls) : declarations(std::move(decls)) {}
+    static constexpr NodeKind KIND = NodeKind::Program;
+    explicit Program(std::vector<DeclPtr> decls) : Node(KIND), declarations(std::move(decls)) {}
     std::vector<DeclPtr> declarations;
     std::unique_ptr<Node> clone() const override {
         std::vector<DeclPtr> new_decls;
@@ -0,0 +1,105 @@
+#include "ASTArena.h"
+#include "AST.h"
+#include <cstdint>
+
+namespace {
+
+thread_local ASTArena* currentArena = nullptr;
+
+constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+size_t alignUp(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// Every node is preceded by a header recording where its memory came from,
+// since it may be deleted after the scope that created it has ended.
+constexpr size_t NODE_HEADER = ALIGNMENT;
+constexpr uintptr_t FROM_HEAP = 0;
+constexpr uintptr_t FROM_ARENA = 1;
+
+} // namespace
+
+ASTArena::ASTArena(size_t chunkSize)
+    : chunkSize_(alignUp(chunkSize)) {
+}
+
+ASTArena::~ASTArena() {
+    reset();
+}
+
+void* ASTArena::allocate(size_t size) {
+    size = alignUp(size);
+    if (static_cast<size_t>(limit_ - next_) < size) {
+        // Oversized requests get a chunk of their own; the current chunk stays in use
+        const size_t chunkBytes = size > chunkSize_ ? size : chunkSize_;
+        char* chunk = static_cast<char*>(::operator new(chunkBytes));
+        chunks_.emplace_back(chunk);
+        chunkSizes_.push_back(chunkBytes);
+        if (size > chunkSize_) {
+            ++allocations_;
+            bytes_ += size;
+            return chunk;
+        }
+        next_ = chunk;
+        limit_ = chunk + chunkBytes;
+    }
+    void* result = next_;
+    next_ += size;
+    ++allocations_;
+    bytes_ += size;
+    return result;
+}
+
+void ASTArena::reset() {
+    chunks_.clear();
+    chunkSizes_.clear();
+    next_ = nullptr;
+    limit_ = nullptr;
+    allocations_ = 0;
+    bytes_ = 0;
+}
+
+bool ASTArena::contains(const void* ptr) const {
+    const char* p = static_cast<const char*>(ptr);
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        const char* chunk = chunks_[i].get();
+        if (p >= chunk && p < chunk + chunkSizes_[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ASTArena* ASTArena::current() {
+    return currentArena;
+}
+
+ASTArena::Scope::Scope(ASTArena& arena)
+    : previous_(currentArena) {
+    currentArena = &arena;
+}
+
+ASTArena::Scope::~Scope() {
+    currentArena = previous_;
+}
+
+// --- Node allocation ---
+
+void* Node::operator new(size_t size) {
+    ASTArena* arena = ASTArena::current();
+    char* block = static_cast<char*>(arena ? arena->allocate(NODE_HEADER + size) : ::operator new(NODE_HEADER + size));
+    *reinterpret_cast<uintptr_t*>(block) = arena ? FROM_ARENA : FROM_HEAP;
+    return block + NODE_HEADER;
+}
+
+void Node::operator delete(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    char* block = static_cast<char*>(ptr) - NODE_HEADER;
+    if (*reinterpret_cast<uintptr_t*>(block) == FROM_HEAP) {
+        ::operator delete(block);
+    }
+    // Arena memory is released with the whole arena
+}
@@ -0,0 +1,75 @@
+// ASTArena.h
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @class ASTArena
+ * @brief Bump allocator holding the AST nodes of one compilation unit.
+ *
+ * While an ASTArena::Scope is active, every node made with std::make_unique
+ * is carved out of the current arena's chunks (see Node::operator new) instead
+ * of being a separate heap allocation, so a tree is laid out roughly in the
+ * order the parser builds it. Deleting an arena node still runs its destructor,
+ * which frees its strings and vectors, but does not return the node's memory:
+ * the chunks are released together by reset() or the destructor.
+ *
+ * Nodes created with no active scope come from the heap as before, and trees
+ * may mix both. An arena must outlive every node allocated in it. Scopes nest,
+ * so a pass can give a single function its own arena.
+ */
+class ASTArena {
+public:
+    explicit ASTArena(size_t chunkSize = 64 * 1024);
+    ~ASTArena();
+
+    ASTArena(const ASTArena&) = delete;
+    ASTArena& operator=(const ASTArena&) = delete;
+
+    /// Returns @p size bytes aligned for any node type.
+    void* allocate(size_t size);
+
+    /// Releases every chunk in one operation; all nodes in the arena must be gone.
+    void reset();
+
+    /// True if @p ptr points into one of this arena's chunks.
+    bool contains(const void* ptr) const;
+
+    size_t allocationCount() const { return allocations_; }
+    size_t bytesAllocated() const { return bytes_; }
+    size_t chunkCount() const { return chunks_.size(); }
+
+    /// The arena that new nodes are allocated in, or nullptr for the heap.
+    static ASTArena* current();
+
+    /// Directs node allocation to an arena until the end of the scope.
+    class Scope {
+    public:
+        explicit Scope(ASTArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ASTArena* previous_;
+    };
+
+private:
+    struct FreeChunk {
+        void operator()(char* chunk) const { ::operator delete(chunk); }
+    };
+
+    size_t chunkSize_;
+    std::vector<std::unique_ptr<char, FreeChunk>> chunks_;
+    std::vector<size_t> chunkSizes_;
+    char* next_ = nullptr;  // Bump pointer into the last chunk
+    char* limit_ = nullptr; // End of the last chunk
+    size_t allocations_ = 0;
+    size_t bytes_ = 0;
+};
+
+#endif // AST_ARENA_H
@@ -0,0 +1,266 @@
+#ifndef AST_MUTATOR_H
+#define AST_MUTATOR_H
+
+#include "AST.h"
+
+/**
+ * @class ASTMutator
+ * @brief Compile-time visitor that edits a tree in place, for passes to specialize.
+ *
+ * mutate() is given the pointer that owns a node, switches on the node's kind
+ * and calls Derived's rewrite overload for the concrete class. A rewrite
+ * returns the node's replacement, or nullptr to keep the node it was given.
+ * The defaults mutate the node's children and keep it, so a pass only
+ * declares the nodes it transforms and nothing else is copied:
+ *
+ *     class MyPass : public OptimizationPass, private ASTMutator<MyPass> {
+ *         friend class ASTMutator<MyPass>;
+ *         using ASTMutator<MyPass>::rewrite;
+ *         ExprPtr rewrite(BinaryOp* node); // Calls mutateChildren(node) first
+ *     };
+ *
+ * A replacement may be built from the node's own children by moving them
+ * out. Replacing a node records a change; a rewrite that edits its node
+ * without replacing it calls markMutated() so that hasMutated() stays
+ * accurate. Declarations are only ever edited in place.
+ */
+template <typename Derived>
+class ASTMutator {
+public:
+    // --- Dispatchers ---
+
+    void mutate(ExprPtr& slot) {
+        Expression* node = slot.get();
+        if (!node) return;
+        switch (node->kind()) {
+            case NodeKind::NumberLiteral:         return replace(slot, static_cast<NumberLiteral*>(node));
+            case NodeKind::FloatLiteral:          return replace(slot, static_cast<FloatLiteral*>(node));
+            case NodeKind::StringLiteral:         return replace(slot, static_cast<StringLiteral*>(node));
+            case NodeKind::CharLiteral:           return replace(slot, static_cast<CharLiteral*>(node));
+            case NodeKind::VariableAccess:        return replace(slot, static_cast<VariableAccess*>(node));
+            case NodeKind::UnaryOp:               return replace(slot, static_cast<UnaryOp*>(node));
+            case NodeKind::BinaryOp:              return replace(slot, static_cast<BinaryOp*>(node));
+            case NodeKind::FunctionCall:          return replace(slot, static_cast<FunctionCall*>(node));
+            case NodeKind::ConditionalExpression: return replace(slot, static_cast<ConditionalExpression*>(node));
+            case NodeKind::TableConstructor:      return replace(slot, static_cast<TableConstructor*>(node));
+            case NodeKind::VectorConstructor:     return replace(slot, static_cast<VectorConstructor*>(node));
+            case NodeKind::Valof:                 return replace(slot, static_cast<Valof*>(node));
+            case NodeKind::DereferenceExpr:       return replace(slot, static_cast<DereferenceExpr*>(node));
+            case NodeKind::VectorAccess:          return replace(slot, static_cast<VectorAccess*>(node));
+            case NodeKind::CharacterAccess:       return replace(slot, static_cast<CharacterAccess*>(node));
+            default:                              return;
+        }
+    }
+
+    void mutate(StmtPtr& slot) { mutateStatement(slot); }
+
+    // An element of CompoundStatement::statements
+    void mutate(std::unique_ptr<Node>& slot) { mutateStatement(slot); }
+
+    void mutate(Declaration* node) {
+        if (!node) return;
+        switch (node->kind()) {
+            case NodeKind::LetDeclaration:      return self().rewrite(static_cast<LetDeclaration*>(node));
+            case NodeKind::FunctionDeclaration: return self().rewrite(static_cast<FunctionDeclaration*>(node));
+            default:                            return; // GLOBAL, MANIFEST and GET
+        }
+    }
+
+    void mutate(Program* node) {
+        for (auto& decl : node->declarations) {
+            self().mutate(decl.get());
+        }
+    }
+
+    /// True if anything was replaced or marked since the last resetMutated().
+    bool hasMutated() const { return mutated; }
+    void resetMutated() { mutated = false; }
+
+protected:
+    bool mutated = false;
+
+    Derived& self() { return static_cast<Derived&>(*this); }
+    void markMutated() { mutated = true; }
+
+    // --- Children, for rewrites that transform a node after its operands ---
+
+    void mutateChildren(LetDeclaration* node) {
+        for (auto& init : node->initializers) {
+            self().mutate(init.init);
+        }
+    }
+
+    void mutateChildren(FunctionDeclaration* node) {
+        self().mutate(node->body_stmt);
+        self().mutate(node->body_expr);
+    }
+
+    void mutateChildren(UnaryOp* node) { self().mutate(node->rhs); }
+
+    void mutateChildren(BinaryOp* node) {
+        self().mutate(node->left);
+        self().mutate(node->right);
+    }
+
+    void mutateChildren(FunctionCall* node) {
+        self().mutate(node->function);
+        for (auto& arg : node->arguments) {
+            self().mutate(arg);
+        }
+    }
+
+    void mutateChildren(ConditionalExpression* node) {
+        self().mutate(node->condition);
+        self().mutate(node->trueExpr);
+        self().mutate(node->falseExpr);
+    }
+
+    void mutateChildren(VectorConstructor* node) { self().mutate(node->size); }
+    void mutateChildren(Valof* node) { self().mutate(node->body); }
+    void mutateChildren(DereferenceExpr* node) { self().mutate(node->pointer); }
+
+    void mutateChildren(VectorAccess* node) {
+        self().mutate(node->vector);
+        self().mutate(node->index);
+    }
+
+    void mutateChildren(CharacterAccess* node) {
+        self().mutate(node->string);
+        self().mutate(node->index);
+    }
+
+    void mutateChildren(CompoundStatement* node) {
+        for (auto& stmt : node->statements) {
+            self().mutate(stmt);
+        }
+    }
+
+    void mutateChildren(Assignment* node) {
+        for (auto& expr : node->lhs) {
+            self().mutate(expr);
+        }
+        for (auto& expr : node->rhs) {
+            self().mutate(expr);
+        }
+    }
+
+    void mutateChildren(IfStatement* node) {
+        self().mutate(node->condition);
+        self().mutate(node->then_statement);
+    }
+
+    void mutateChildren(TestStatement* node) {
+        self().mutate(node->condition);
+        self().mutate(node->then_statement);
+        self().mutate(node->else_statement);
+    }
+
+    void mutateChildren(WhileStatement* node) {
+        self().mutate(node->condition);
+        self().mutate(node->body);
+    }
+
+    void mutateChildren(RepeatStatement* node) {
+        self().mutate(node->body);
+        self().mutate(node->condition);
+    }
+
+    void mutateChildren(ForStatement* node) {
+        self().mutate(node->from_expr);
+        self().mutate(node->to_expr);
+        self().mutate(node->by_expr);
+        self().mutate(node->body);
+    }
+
+    void mutateChildren(SwitchonStatement* node) {
+        self().mutate(node->expression);
+        for (auto& scase : node->cases) {
+            self().mutate(scase.statement);
+        }
+        self().mutate(node->default_case);
+    }
+
+    void mutateChildren(RoutineCall* node) { self().mutate(node->call_expression); }
+    void mutateChildren(LabeledStatement* node) { self().mutate(node->statement); }
+    void mutateChildren(GotoStatement* node) { self().mutate(node->label); }
+    void mutateChildren(ResultisStatement* node) { self().mutate(node->value); }
+    void mutateChildren(DeclarationStatement* node) { self().mutate(node->declaration.get()); }
+
+    // --- Default rewrites: mutate the children, keep the node ---
+
+    void rewrite(LetDeclaration* node) { mutateChildren(node); }
+    void rewrite(FunctionDeclaration* node) { mutateChildren(node); }
+
+    ExprPtr rewrite(NumberLiteral*) { return nullptr; }
+    ExprPtr rewrite(FloatLiteral*) { return nullptr; }
+    ExprPtr rewrite(StringLiteral*) { return nullptr; }
+    ExprPtr rewrite(CharLiteral*) { return nullptr; }
+    ExprPtr rewrite(VariableAccess*) { return nullptr; }
+    ExprPtr rewrite(TableConstructor*) { return nullptr; }
+    ExprPtr rewrite(UnaryOp* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(BinaryOp* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(FunctionCall* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(ConditionalExpression* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(VectorConstructor* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(Valof* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(DereferenceExpr* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(VectorAccess* node) { mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(CharacterAccess* node) { mutateChildren(node); return nullptr; }
+
+    StmtPtr rewrite(CompoundStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(Assignment* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(IfStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(TestStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(WhileStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(RepeatStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(ForStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(SwitchonStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(RoutineCall* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(LabeledStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(GotoStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(ResultisStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(DeclarationStatement* node) { mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(ReturnStatement*) { return nullptr; }
+    StmtPtr rewrite(FinishStatement*) { return nullptr; }
+    StmtPtr rewrite(BreakStatement*) { return nullptr; }
+    StmtPtr rewrite(LoopStatement*) { return nullptr; }
+    StmtPtr rewrite(EndcaseStatement*) { return nullptr; }
+
+private:
+    template <typename Slot, typename T>
+    void replace(Slot& slot, T* node) {
+        if (auto replacement = self().rewrite(node)) {
+            slot = std::move(replacement);
+            mutated = true;
+        }
+    }
+
+    template <typename Slot>
+    void mutateStatement(Slot& slot) {
+        auto* node = static_cast<Statement*>(slot.get());
+        if (!node) return;
+        switch (node->kind()) {
+            case NodeKind::SwitchonStatement:    return replace(slot, static_cast<SwitchonStatement*>(node));
+            case NodeKind::BreakStatement:       return replace(slot, static_cast<BreakStatement*>(node));
+            case NodeKind::LoopStatement:        return replace(slot, static_cast<LoopStatement*>(node));
+            case NodeKind::RepeatStatement:      return replace(slot, static_cast<RepeatStatement*>(node));
+            case NodeKind::EndcaseStatement:     return replace(slot, static_cast<EndcaseStatement*>(node));
+            case NodeKind::Assignment:           return replace(slot, static_cast<Assignment*>(node));
+            case NodeKind::RoutineCall:          return replace(slot, static_cast<RoutineCall*>(node));
+            case NodeKind::CompoundStatement:    return replace(slot, static_cast<CompoundStatement*>(node));
+            case NodeKind::IfStatement:          return replace(slot, static_cast<IfStatement*>(node));
+            case NodeKind::TestStatement:        return replace(slot, static_cast<TestStatement*>(node));
+            case NodeKind::WhileStatement:       return replace(slot, static_cast<WhileStatement*>(node));
+            case NodeKind::ForStatement:         return replace(slot, static_cast<ForStatement*>(node));
+            case NodeKind::GotoStatement:        return replace(slot, static_cast<GotoStatement*>(node));
+            case NodeKind::LabeledStatement:     return replace(slot, static_cast<LabeledStatement*>(node));
+            case NodeKind::ReturnStatement:      return replace(slot, static_cast<ReturnStatement*>(node));
+            case NodeKind::DeclarationStatement: return replace(slot, static_cast<DeclarationStatement*>(node));
+            case NodeKind::FinishStatement:      return replace(slot, static_cast<FinishStatement*>(node));
+            case NodeKind::ResultisStatement:    return replace(slot, static_cast<ResultisStatement*>(node));
+            default:                             return;
+        }
+    }
+};
+
+#endif // AST_MUTATOR_H
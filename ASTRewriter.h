@@ -0,0 +1,253 @@
+#ifndef AST_REWRITER_H
+#define AST_REWRITER_H
+
+#include "AST.h"
+#include <vector>
+
+/**
+ * @class ASTRewriter
+ * @brief Compile-time visitor that rebuilds a tree, for passes to specialize.
+ *
+ * visit(Expression*), visit(Statement*) and visit(Declaration*) switch on the
+ * node's kind and call Derived's visit overload for the concrete class. Every
+ * overload defaults to rebuilding the node from its rewritten children, so a
+ * pass only declares the nodes it transforms:
+ *
+ *     class MyPass : public OptimizationPass, private ASTRewriter<MyPass> {
+ *         friend class ASTRewriter<MyPass>;
+ *         using ASTRewriter<MyPass>::visit;
+ *         StmtPtr visit(ForStatement* node); // Everything else is rebuilt
+ *     };
+ *
+ * Calls are resolved statically, so there is no virtual dispatch or RTTI
+ * per node. Global, manifest and GET declarations are dropped from the
+ * rewritten program, and a statement that rewrites to nullptr is removed
+ * from its block.
+ */
+template <typename Derived>
+class ASTRewriter {
+public:
+    // --- Dispatchers ---
+
+    ExprPtr visit(Expression* node) {
+        if (!node) return nullptr;
+        switch (node->kind()) {
+            case NodeKind::NumberLiteral:         return self().visit(static_cast<NumberLiteral*>(node));
+            case NodeKind::FloatLiteral:          return self().visit(static_cast<FloatLiteral*>(node));
+            case NodeKind::StringLiteral:         return self().visit(static_cast<StringLiteral*>(node));
+            case NodeKind::CharLiteral:           return self().visit(static_cast<CharLiteral*>(node));
+            case NodeKind::VariableAccess:        return self().visit(static_cast<VariableAccess*>(node));
+            case NodeKind::UnaryOp:               return self().visit(static_cast<UnaryOp*>(node));
+            case NodeKind::BinaryOp:              return self().visit(static_cast<BinaryOp*>(node));
+            case NodeKind::FunctionCall:          return self().visit(static_cast<FunctionCall*>(node));
+            case NodeKind::ConditionalExpression: return self().visit(static_cast<ConditionalExpression*>(node));
+            case NodeKind::TableConstructor:      return self().visit(static_cast<TableConstructor*>(node));
+            case NodeKind::VectorConstructor:     return self().visit(static_cast<VectorConstructor*>(node));
+            case NodeKind::Valof:                 return self().visit(static_cast<Valof*>(node));
+            case NodeKind::DereferenceExpr:       return self().visit(static_cast<DereferenceExpr*>(node));
+            case NodeKind::VectorAccess:          return self().visit(static_cast<VectorAccess*>(node));
+            case NodeKind::CharacterAccess:       return self().visit(static_cast<CharacterAccess*>(node));
+            default:                              return node->cloneExpr();
+        }
+    }
+
+    StmtPtr visit(Statement* node) {
+        if (!node) return nullptr;
+        switch (node->kind()) {
+            case NodeKind::SwitchonStatement:    return self().visit(static_cast<SwitchonStatement*>(node));
+            case NodeKind::BreakStatement:       return self().visit(static_cast<BreakStatement*>(node));
+            case NodeKind::LoopStatement:        return self().visit(static_cast<LoopStatement*>(node));
+            case NodeKind::RepeatStatement:      return self().visit(static_cast<RepeatStatement*>(node));
+            case NodeKind::EndcaseStatement:     return self().visit(static_cast<EndcaseStatement*>(node));
+            case NodeKind::Assignment:           return self().visit(static_cast<Assignment*>(node));
+            case NodeKind::RoutineCall:          return self().visit(static_cast<RoutineCall*>(node));
+            case NodeKind::CompoundStatement:    return self().visit(static_cast<CompoundStatement*>(node));
+            case NodeKind::IfStatement:          return self().visit(static_cast<IfStatement*>(node));
+            case NodeKind::TestStatement:        return self().visit(static_cast<TestStatement*>(node));
+            case NodeKind::WhileStatement:       return self().visit(static_cast<WhileStatement*>(node));
+            case NodeKind::ForStatement:         return self().visit(static_cast<ForStatement*>(node));
+            case NodeKind::GotoStatement:        return self().visit(static_cast<GotoStatement*>(node));
+            case NodeKind::LabeledStatement:     return self().visit(static_cast<LabeledStatement*>(node));
+            case NodeKind::ReturnStatement:      return self().visit(static_cast<ReturnStatement*>(node));
+            case NodeKind::DeclarationStatement: return self().visit(static_cast<DeclarationStatement*>(node));
+            case NodeKind::FinishStatement:      return self().visit(static_cast<FinishStatement*>(node));
+            case NodeKind::ResultisStatement:    return self().visit(static_cast<ResultisStatement*>(node));
+            default:                             return node->cloneStmt();
+        }
+    }
+
+    DeclPtr visit(Declaration* node) {
+        if (!node) return nullptr;
+        switch (node->kind()) {
+            case NodeKind::LetDeclaration:      return self().visit(static_cast<LetDeclaration*>(node));
+            case NodeKind::FunctionDeclaration: return self().visit(static_cast<FunctionDeclaration*>(node));
+            default:                            return nullptr; // GLOBAL, MANIFEST and GET
+        }
+    }
+
+    ProgramPtr visit(Program* node) {
+        std::vector<DeclPtr> new_decls;
+        for (const auto& decl : node->declarations) {
+            if (DeclPtr rewritten = self().visit(decl.get())) {
+                new_decls.push_back(std::move(rewritten));
+            }
+        }
+        return std::make_unique<Program>(std::move(new_decls));
+    }
+
+    // --- Declarations ---
+
+    DeclPtr visit(LetDeclaration* node) {
+        std::vector<LetDeclaration::VarInit> new_inits;
+        for (const auto& init : node->initializers) {
+            new_inits.push_back({init.name, init.init ? self().visit(init.init.get()) : nullptr});
+        }
+        return std::make_unique<LetDeclaration>(std::move(new_inits));
+    }
+
+    DeclPtr visit(FunctionDeclaration* node) {
+        auto new_body_stmt = node->body_stmt ? self().visit(node->body_stmt.get()) : nullptr;
+        auto new_body_expr = node->body_expr ? self().visit(node->body_expr.get()) : nullptr;
+        return std::make_unique<FunctionDeclaration>(node->name, node->params, std::move(new_body_expr), std::move(new_body_stmt));
+    }
+
+    // --- Expressions ---
+
+    ExprPtr visit(NumberLiteral* node) { return std::make_unique<NumberLiteral>(*node); }
+    ExprPtr visit(FloatLiteral* node) { return std::make_unique<FloatLiteral>(*node); }
+    ExprPtr visit(StringLiteral* node) { return std::make_unique<StringLiteral>(*node); }
+    ExprPtr visit(CharLiteral* node) { return std::make_unique<CharLiteral>(*node); }
+    ExprPtr visit(VariableAccess* node) { return std::make_unique<VariableAccess>(*node); }
+    ExprPtr visit(TableConstructor* node) { return std::make_unique<TableConstructor>(); }
+
+    ExprPtr visit(UnaryOp* node) {
+        return std::make_unique<UnaryOp>(node->op, self().visit(node->rhs.get()));
+    }
+
+    ExprPtr visit(BinaryOp* node) {
+        auto left = self().visit(node->left.get());
+        auto right = self().visit(node->right.get());
+        return std::make_unique<BinaryOp>(node->op, std::move(left), std::move(right));
+    }
+
+    ExprPtr visit(FunctionCall* node) {
+        auto new_func = self().visit(node->function.get());
+        std::vector<ExprPtr> new_args;
+        for (const auto& arg : node->arguments) {
+            new_args.push_back(self().visit(arg.get()));
+        }
+        return std::make_unique<FunctionCall>(std::move(new_func), std::move(new_args));
+    }
+
+    ExprPtr visit(ConditionalExpression* node) {
+        auto new_cond = self().visit(node->condition.get());
+        auto new_true = self().visit(node->trueExpr.get());
+        auto new_false = self().visit(node->falseExpr.get());
+        return std::make_unique<ConditionalExpression>(std::move(new_cond), std::move(new_true), std::move(new_false));
+    }
+
+    ExprPtr visit(VectorConstructor* node) { return std::make_unique<VectorConstructor>(self().visit(node->size.get())); }
+    ExprPtr visit(Valof* node) { return std::make_unique<Valof>(self().visit(node->body.get())); }
+    ExprPtr visit(DereferenceExpr* node) { return std::make_unique<DereferenceExpr>(self().visit(node->pointer.get())); }
+
+    ExprPtr visit(VectorAccess* node) {
+        auto new_vector = self().visit(node->vector.get());
+        auto new_index = self().visit(node->index.get());
+        return std::make_unique<VectorAccess>(std::move(new_vector), std::move(new_index));
+    }
+
+    ExprPtr visit(CharacterAccess* node) {
+        auto new_string = self().visit(node->string.get());
+        auto new_index = self().visit(node->index.get());
+        return std::make_unique<CharacterAccess>(std::move(new_string), std::move(new_index));
+    }
+
+    // --- Statements ---
+
+    StmtPtr visit(CompoundStatement* node) {
+        std::vector<std::unique_ptr<Node>> new_stmts;
+        for (const auto& stmt : node->statements) {
+            if (auto new_stmt = self().visit(static_cast<Statement*>(stmt.get()))) {
+                new_stmts.push_back(std::move(new_stmt));
+            }
+        }
+        return std::make_unique<CompoundStatement>(std::move(new_stmts));
+    }
+
+    StmtPtr visit(Assignment* node) {
+        std::vector<ExprPtr> new_lhs;
+        for (const auto& expr : node->lhs) {
+            new_lhs.push_back(self().visit(expr.get()));
+        }
+        std::vector<ExprPtr> new_rhs;
+        for (const auto& expr : node->rhs) {
+            new_rhs.push_back(self().visit(expr.get()));
+        }
+        return std::make_unique<Assignment>(std::move(new_lhs), std::move(new_rhs));
+    }
+
+    StmtPtr visit(IfStatement* node) {
+        auto new_cond = self().visit(node->condition.get());
+        return std::make_unique<IfStatement>(std::move(new_cond), self().visit(node->then_statement.get()));
+    }
+
+    StmtPtr visit(TestStatement* node) {
+        auto new_cond = self().visit(node->condition.get());
+        auto new_then = self().visit(node->then_statement.get());
+        auto new_else = node->else_statement ? self().visit(node->else_statement.get()) : nullptr;
+        return std::make_unique<TestStatement>(std::move(new_cond), std::move(new_then), std::move(new_else));
+    }
+
+    StmtPtr visit(WhileStatement* node) {
+        auto new_cond = self().visit(node->condition.get());
+        auto new_body = self().visit(node->body.get());
+        return std::make_unique<WhileStatement>(std::move(new_cond), std::move(new_body));
+    }
+
+    StmtPtr visit(RepeatStatement* node) {
+        auto new_body = self().visit(node->body.get());
+        auto new_cond = node->condition ? self().visit(node->condition.get()) : nullptr;
+        return std::make_unique<RepeatStatement>(std::move(new_body), std::move(new_cond), node->loopType);
+    }
+
+    StmtPtr visit(ForStatement* node) {
+        auto new_from = self().visit(node->from_expr.get());
+        auto new_to = self().visit(node->to_expr.get());
+        auto new_by = node->by_expr ? self().visit(node->by_expr.get()) : nullptr;
+        auto new_body = self().visit(node->body.get());
+        return std::make_unique<ForStatement>(node->var_name, std::move(new_from), std::move(new_to), std::move(new_by), std::move(new_body));
+    }
+
+    StmtPtr visit(SwitchonStatement* node) {
+        auto new_expr = self().visit(node->expression.get());
+        std::vector<SwitchonStatement::SwitchCase> new_cases;
+        for (const auto& scase : node->cases) {
+            new_cases.push_back({scase.value, scase.label, self().visit(scase.statement.get())});
+        }
+        auto new_default = node->default_case ? self().visit(node->default_case.get()) : nullptr;
+        return std::make_unique<SwitchonStatement>(std::move(new_expr), std::move(new_cases), std::move(new_default));
+    }
+
+    StmtPtr visit(RoutineCall* node) { return std::make_unique<RoutineCall>(self().visit(node->call_expression.get())); }
+    StmtPtr visit(LabeledStatement* node) { return std::make_unique<LabeledStatement>(node->name, self().visit(node->statement.get())); }
+    StmtPtr visit(GotoStatement* node) { return std::make_unique<GotoStatement>(self().visit(node->label.get())); }
+    StmtPtr visit(ResultisStatement* node) { return std::make_unique<ResultisStatement>(self().visit(node->value.get())); }
+    StmtPtr visit(ReturnStatement* node) { return std::make_unique<ReturnStatement>(); }
+    StmtPtr visit(FinishStatement* node) { return std::make_unique<FinishStatement>(); }
+    StmtPtr visit(BreakStatement* node) { return std::make_unique<BreakStatement>(); }
+    StmtPtr visit(LoopStatement* node) { return std::make_unique<LoopStatement>(); }
+    StmtPtr visit(EndcaseStatement* node) { return std::make_unique<EndcaseStatement>(); }
+
+    StmtPtr visit(DeclarationStatement* node) {
+        // A declaration that rewrites to nothing takes its statement with it
+        if (DeclPtr new_decl = self().visit(node->declaration.get())) {
+            return std::make_unique<DeclarationStatement>(std::move(new_decl));
+        }
+        return nullptr;
+    }
+
+protected:
+    Derived& self() { return static_cast<Derived&>(*this); }
+};
+
+#endif // AST_REWRITER_H
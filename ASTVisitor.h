@@ -47,7 +47,7 @@ class Program;
  * @brief Abstract base class for AST visitors.
  *
  * This class defines the interface for visiting different types of AST nodes.
- * Concrete visitors (like VariableVisitor) will implement these methods
+ * Concrete visitors implement these methods
  * to perform specific operations during AST traversal.
  */
 class ASTVisitor {
@@ -2,53 +2,45 @@
 #define BASIC_BLOCK_H
 
 #include "AST.h" // Include AST.h to get StatementPtr and other AST types
+#include "SmallVector.h"
+#include <cstdint>
+#include <string>
 #include <vector>
-#include <set>
-#include <memory>
+
+/// Index of a block within its ControlFlowGraph; the entry block is 0.
+using BlockId = uint32_t;
+constexpr BlockId NoBlock = 0xFFFFFFFF;
 
 /**
  * @class BasicBlock
  * @brief Represents a basic block in a Control Flow Graph (CFG).
  *
  * A basic block is a sequence of statements that is entered only at the
- * beginning and exited only at the end.
+ * beginning and exited only at the end. Blocks live in their function's
+ * ControlFlowGraph and refer to each other by BlockId.
  */
-class BasicBlock : public std::enable_shared_from_this<BasicBlock> {
+class BasicBlock {
 public:
-    using Ptr = std::shared_ptr<BasicBlock>;
-
-    // Unique identifier for the basic block
-    int id;
+    // Index of the block in its graph
+    BlockId id;
 
-    // Statements contained within this basic block (now raw pointers)
+    // Statements contained within this basic block (owned by the AST)
     std::vector<Statement*> statements;
 
-    // Successor basic blocks
-    std::set<Ptr> successors;
-
-    // Predecessor basic blocks
-    std::set<Ptr> predecessors;
+    // Edges, in the order they were added
+    SmallVector<BlockId, 2> successors;
+    SmallVector<BlockId, 2> predecessors;
 
-    // Constructor
-    BasicBlock(int block_id) : id(block_id) {}
+    explicit BasicBlock(BlockId block_id) : id(block_id) {}
 
-    // Add a statement to the basic block (now takes raw pointer)
     void addStatement(Statement* stmt) {
         statements.push_back(stmt);
     }
 
-    // Add a successor basic block
-    void addSuccessor(Ptr succ) {
-        if (succ) {
-            successors.insert(succ);
-            succ->predecessors.insert(shared_from_this());
-        }
-    }
-
     // For debugging/visualization
     std::string toString() const {
         return "BB" + std::to_string(id);
     }
 };
 
-#endif // BASIC_BLOCK_H
\ No newline at end of file
+#endif // BASIC_BLOCK_H
@@ -0,0 +1,86 @@
+// BitVector.h
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class BitVector
+ * @brief A fixed-size set of small integers stored one bit each in 64-bit words.
+ *
+ * Dataflow analyses number their facts densely and keep one BitVector per
+ * block, so meets and transfer functions are a loop over whole words.
+ */
+class BitVector {
+public:
+    explicit BitVector(size_t bits = 0) : bits_(bits), words_((bits + 63) / 64, 0) {}
+
+    size_t size() const { return bits_; }
+
+    bool test(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+    void set(size_t i) { words_[i >> 6] |= uint64_t(1) << (i & 63); }
+    void reset(size_t i) { words_[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+    void clear() {
+        for (uint64_t& word : words_) {
+            word = 0;
+        }
+    }
+
+    /// Adds every bit of @p other; returns true if any bit was new.
+    bool unionWith(const BitVector& other) {
+        uint64_t added = 0;
+        for (size_t w = 0; w < words_.size(); ++w) {
+            added |= other.words_[w] & ~words_[w];
+            words_[w] |= other.words_[w];
+        }
+        return added != 0;
+    }
+
+    /// Removes every bit of @p other.
+    void subtract(const BitVector& other) {
+        for (size_t w = 0; w < words_.size(); ++w) {
+            words_[w] &= ~other.words_[w];
+        }
+    }
+
+    /// Sets this to gen | (in & ~kill); returns true if it changed.
+    bool assignTransfer(const BitVector& gen, const BitVector& in, const BitVector& kill) {
+        uint64_t changed = 0;
+        for (size_t w = 0; w < words_.size(); ++w) {
+            uint64_t word = gen.words_[w] | (in.words_[w] & ~kill.words_[w]);
+            changed |= word ^ words_[w];
+            words_[w] = word;
+        }
+        return changed != 0;
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t word : words_) {
+            n += static_cast<size_t>(__builtin_popcountll(word));
+        }
+        return n;
+    }
+
+    /// Calls @p fn with the index of every set bit, in ascending order.
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t w = 0; w < words_.size(); ++w) {
+            for (uint64_t word = words_[w]; word != 0; word &= word - 1) {
+                fn(w * 64 + static_cast<size_t>(__builtin_ctzll(word)));
+            }
+        }
+    }
+
+    bool operator==(const BitVector& other) const { return bits_ == other.bits_ && words_ == other.words_; }
+    bool operator!=(const BitVector& other) const { return !(*this == other); }
+
+private:
+    size_t bits_;
+    std::vector<uint64_t> words_;
+};
+
+#endif // BIT_VECTOR_H
@@ -1,86 +1,92 @@
 #include "CFGBuilder.h"
-#include <iostream>
 
-BasicBlock::Ptr CFGBuilder::createNewBlock() {
-    BasicBlock::Ptr newBlock = std::make_shared<BasicBlock>(nextBlockId++);
-    std::cout << "CFGBuilder: Created new block " << newBlock->toString() << "\n";
-    return newBlock;
+BlockId CFGBuilder::createNewBlock() {
+    return cfg->createBlock();
 }
 
 void CFGBuilder::build(const ProgramPtr& program) {
-    functionEntryBlocks.clear();
-    nextBlockId = 0;
-
-    std::cout << "CFGBuilder: Starting CFG construction...\n";
+    functionCFGs.clear();
 
     for (auto& decl : program->declarations) { 
-        if (auto funcDecl = dynamic_cast<FunctionDeclaration*>(decl.get())) {
-            std::cout << "CFGBuilder: Processing function: " << funcDecl->name << "\n";
-            // Create an entry block for each function
-            BasicBlock::Ptr entryBlock = createNewBlock();
-            functionEntryBlocks[funcDecl->name] = entryBlock;
-
-            // Build CFG for the function body
+        if (auto funcDecl = nodeCast<FunctionDeclaration>(decl.get())) {
+            // Each function gets its own graph; block 0 is its entry
+            cfg = &functionCFGs[funcDecl->name];
+            *cfg = ControlFlowGraph();
+            labels.clear();
+            pendingGotos.clear();
+
+            // Build CFG for the function body; a VALOF body is its block of statements
             if (funcDecl->body_stmt) {
-                std::cout << "CFGBuilder: Building CFG for function body...\n";
-                // Pass raw pointer to buildCFGForStatement
-                buildCFGForStatement(funcDecl->body_stmt.get(), entryBlock);
-            } 
+                buildCFGForStatement(funcDecl->body_stmt.get(), cfg->entry());
+            } else if (auto valof = nodeCast<Valof>(funcDecl->body_expr.get())) {
+                buildCFGForStatement(valof->body.get(), cfg->entry());
+            }
+
+            // Now every label has a block, connect the GOTOs to them
+            for (const auto& [from, label] : pendingGotos) {
+                if (const BlockId* target = labels.find(label)) {
+                    cfg->addEdge(from, *target);
+                } else {
+                    cfg->markUnstructured();
+                }
+            }
+            cfg = nullptr;
         }
     }
-    std::cout << "CFGBuilder: CFG construction complete.\n";
 }
 
-BasicBlock::Ptr CFGBuilder::addStatementToBlock(Statement* stmt, BasicBlock::Ptr currentBlock) {
-    if (!currentBlock) {
+BlockId CFGBuilder::addStatementToBlock(Statement* stmt, BlockId currentBlock) {
+    if (currentBlock == NoBlock) {
         currentBlock = createNewBlock();
     }
-    // std::cout << "CFGBuilder: Adding statement to " << currentBlock->toString() << ": " << stmt->toString() << "\n"; // Removed: Statement does not have toString()
-    currentBlock->addStatement(stmt);
+    cfg->addStatement(currentBlock, stmt);
     return currentBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::buildCFGForStatement(Statement* stmt, BasicBlock::Ptr currentBlock) {
+BlockId CFGBuilder::buildCFGForStatement(Statement* stmt, BlockId currentBlock) {
     if (!stmt) return currentBlock;
 
-    // std::cout << "CFGBuilder: Handling statement type: " << stmt->toString() << "\n"; // Removed: Statement does not have toString()
 
     // Handle different statement types
-    if (CompoundStatement* compound = dynamic_cast<CompoundStatement*>(stmt)) {
+    if (CompoundStatement* compound = nodeCast<CompoundStatement>(stmt)) {
         return handleCompoundStatement(compound, currentBlock);
-    } else if (IfStatement* ifStmt = dynamic_cast<IfStatement*>(stmt)) {
+    } else if (IfStatement* ifStmt = nodeCast<IfStatement>(stmt)) {
         return handleIfStatement(ifStmt, currentBlock);
-    } else if (WhileStatement* whileStmt = dynamic_cast<WhileStatement*>(stmt)) {
+    } else if (WhileStatement* whileStmt = nodeCast<WhileStatement>(stmt)) {
         return handleWhileStatement(whileStmt, currentBlock);
-    } else if (ForStatement* forStmt = dynamic_cast<ForStatement*>(stmt)) {
+    } else if (ForStatement* forStmt = nodeCast<ForStatement>(stmt)) {
         return handleForStatement(forStmt, currentBlock);
-    } else if (RoutineCall* routineCall = dynamic_cast<RoutineCall*>(stmt)) {
+    } else if (RoutineCall* routineCall = nodeCast<RoutineCall>(stmt)) {
         return handleRoutineCall(routineCall, currentBlock);
-    } else if (ReturnStatement* ret = dynamic_cast<ReturnStatement*>(stmt)) {
+    } else if (ReturnStatement* ret = nodeCast<ReturnStatement>(stmt)) {
         return handleReturnStatement(ret, currentBlock);
-    } else if (LoopStatement* loop = dynamic_cast<LoopStatement*>(stmt)) {
+    } else if (LoopStatement* loop = nodeCast<LoopStatement>(stmt)) {
         return handleLoopStatement(loop, currentBlock);
-    } else if (RepeatStatement* repeat = dynamic_cast<RepeatStatement*>(stmt)) {
+    } else if (RepeatStatement* repeat = nodeCast<RepeatStatement>(stmt)) {
         return handleRepeatStatement(repeat, currentBlock);
-    } else if (SwitchonStatement* switchon = dynamic_cast<SwitchonStatement*>(stmt)) {
+    } else if (SwitchonStatement* switchon = nodeCast<SwitchonStatement>(stmt)) {
         return handleSwitchonStatement(switchon, currentBlock);
-    } else if (GotoStatement* gotoStmt = dynamic_cast<GotoStatement*>(stmt)) {
+    } else if (GotoStatement* gotoStmt = nodeCast<GotoStatement>(stmt)) {
         return handleGotoStatement(gotoStmt, currentBlock);
-    } else if (LabeledStatement* labeledStmt = dynamic_cast<LabeledStatement*>(stmt)) {
+    } else if (LabeledStatement* labeledStmt = nodeCast<LabeledStatement>(stmt)) {
         return handleLabeledStatement(labeledStmt, currentBlock);
-    } else if (DeclarationStatement* declStmt = dynamic_cast<DeclarationStatement*>(stmt)) {
+    } else if (DeclarationStatement* declStmt = nodeCast<DeclarationStatement>(stmt)) {
         return handleDeclarationStatement(declStmt, currentBlock);
-    } else if (Assignment* assign = dynamic_cast<Assignment*>(stmt)) {
+    } else if (Assignment* assign = nodeCast<Assignment>(stmt)) {
         return handleAssignment(assign, currentBlock);
-    } else if (TestStatement* testStmt = dynamic_cast<TestStatement*>(stmt)) {
+    } else if (TestStatement* testStmt = nodeCast<TestStatement>(stmt)) {
         return handleTestStatement(testStmt, currentBlock);
-    } else if (ResultisStatement* resultis = dynamic_cast<ResultisStatement*>(stmt)) {
+    } else if (ResultisStatement* resultis = nodeCast<ResultisStatement>(stmt)) {
         return handleResultisStatement(resultis, currentBlock);
-    } else if (EndcaseStatement* endcase = dynamic_cast<EndcaseStatement*>(stmt)) {
+    } else if (EndcaseStatement* endcase = nodeCast<EndcaseStatement>(stmt)) {
         return handleEndcaseStatement(endcase, currentBlock);
-    } else if (FinishStatement* finish = dynamic_cast<FinishStatement*>(stmt)) {
+    } else if (FinishStatement* finish = nodeCast<FinishStatement>(stmt)) {
         return handleFinishStatement(finish, currentBlock);
     } else {
+        // BREAK and LOOP jump to the enclosing loop, which is not tracked here
+        if (nodeCast<BreakStatement>(stmt)) {
+            cfg->markUnstructured();
+        }
         // Default: add statement to current block and continue
         return addStatementToBlock(stmt, currentBlock);
     }
@@ -88,130 +94,110 @@ BasicBlock::Ptr CFGBuilder::buildCFGForStatement(Statement* stmt, BasicBlock::Pt
 
 // --- Specific Statement Handlers ---
 
-BasicBlock::Ptr CFGBuilder::handleCompoundStatement(CompoundStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling CompoundStatement in " << currentBlock->toString() << "\n";
-
+BlockId CFGBuilder::handleCompoundStatement(CompoundStatement* stmt, BlockId currentBlock) {
     for (auto& s_node_ptr : stmt->statements) { 
         currentBlock = buildCFGForStatement(static_cast<Statement*>(s_node_ptr.get()), currentBlock);
     }
     return currentBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleIfStatement(IfStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling IfStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleIfStatement(IfStatement* stmt, BlockId currentBlock) {
     // Add the if condition to the current block
     currentBlock = addStatementToBlock(stmt, currentBlock);
 
     // Create blocks for then branch
-    BasicBlock::Ptr thenBlock = createNewBlock();
+    BlockId thenBlock = createNewBlock();
 
     // Connect current block to then block
-    currentBlock->addSuccessor(thenBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << thenBlock->toString() << " (then branch)\n";
+    cfg->addEdge(currentBlock, thenBlock);
 
     // Build CFG for then branch
-    BasicBlock::Ptr thenEndBlock = buildCFGForStatement(stmt->then_statement.get(), thenBlock);
+    BlockId thenEndBlock = buildCFGForStatement(stmt->then_statement.get(), thenBlock);
 
     // Create a merge block
-    BasicBlock::Ptr mergeBlock = createNewBlock();
+    BlockId mergeBlock = createNewBlock();
 
     // Connect end of then branch to merge block
-    thenEndBlock->addSuccessor(mergeBlock);
-    std::cout << "CFGBuilder: " << thenEndBlock->toString() << " -> " << mergeBlock->toString() << " (merge)\n";
+    cfg->addEdge(thenEndBlock, mergeBlock);
 
     // If no else branch, current block also connects to merge block
-    currentBlock->addSuccessor(mergeBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << mergeBlock->toString() << " (no else branch)\n";
+    cfg->addEdge(currentBlock, mergeBlock);
 
     return mergeBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleWhileStatement(WhileStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling WhileStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleWhileStatement(WhileStatement* stmt, BlockId currentBlock) {
     // Create a block for the loop header (condition)
-    BasicBlock::Ptr loopHeaderBlock = createNewBlock();
-    currentBlock->addSuccessor(loopHeaderBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << loopHeaderBlock->toString() << " (loop header)\n";
+    BlockId loopHeaderBlock = createNewBlock();
+    cfg->addEdge(currentBlock, loopHeaderBlock);
 
     // Add condition to loop header
     currentBlock = addStatementToBlock(stmt, loopHeaderBlock);
 
     // Create block for loop body
-    BasicBlock::Ptr loopBodyBlock = createNewBlock();
-    loopHeaderBlock->addSuccessor(loopBodyBlock);
-    std::cout << "CFGBuilder: " << loopHeaderBlock->toString() << " -> " << loopBodyBlock->toString() << " (loop body)\n";
+    BlockId loopBodyBlock = createNewBlock();
+    cfg->addEdge(loopHeaderBlock, loopBodyBlock);
 
     // Build CFG for loop body
-    BasicBlock::Ptr bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
+    BlockId bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
 
     // Connect end of body back to loop header
-    bodyEndBlock->addSuccessor(loopHeaderBlock);
-    std::cout << "CFGBuilder: " << bodyEndBlock->toString() << " -> " << loopHeaderBlock->toString() << " (loop backedge)\n";
+    cfg->addEdge(bodyEndBlock, loopHeaderBlock);
 
     // Create exit block for the loop
-    BasicBlock::Ptr exitBlock = createNewBlock();
-    loopHeaderBlock->addSuccessor(exitBlock); // Condition can lead to exit
-    std::cout << "CFGBuilder: " << loopHeaderBlock->toString() << " -> " << exitBlock->toString() << " (loop exit)\n";
+    BlockId exitBlock = createNewBlock();
+    cfg->addEdge(loopHeaderBlock, exitBlock); // Condition can lead to exit
 
     return exitBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleForStatement(ForStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling ForStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleForStatement(ForStatement* stmt, BlockId currentBlock) {
     // For statement is complex: initialization, condition, increment, body
 
-    // Initialization part (part of current block or new block)
-    currentBlock = addStatementToBlock(stmt, currentBlock); // Add the for statement itself
-
-    // Loop header (condition check)
-    BasicBlock::Ptr loopHeaderBlock = createNewBlock();
-    currentBlock->addSuccessor(loopHeaderBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << loopHeaderBlock->toString() << " (for loop header)\n";
+    // Loop header (condition check). The FOR statement itself is placed here,
+    // so the loop variable and limit are used on every iteration.
+    BlockId loopHeaderBlock = createNewBlock();
+    cfg->addEdge(currentBlock, loopHeaderBlock);
+    addStatementToBlock(stmt, loopHeaderBlock);
 
     // Loop body
-    BasicBlock::Ptr loopBodyBlock = createNewBlock();
-    loopHeaderBlock->addSuccessor(loopBodyBlock);
-    std::cout << "CFGBuilder: " << loopHeaderBlock->toString() << " -> " << loopBodyBlock->toString() << " (for loop body)\n";
+    BlockId loopBodyBlock = createNewBlock();
+    cfg->addEdge(loopHeaderBlock, loopBodyBlock);
 
     // Build CFG for loop body
-    BasicBlock::Ptr bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
+    BlockId bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
 
     // Increment part (after body, before next condition check)
     // For simplicity, we'll assume increment is part of the body's end block or a new block leading to header
     // A more precise CFG would have a dedicated increment block.
-    bodyEndBlock->addSuccessor(loopHeaderBlock);
-    std::cout << "CFGBuilder: " << bodyEndBlock->toString() << " -> " << loopHeaderBlock->toString() << " (for loop backedge)\n";
+    cfg->addEdge(bodyEndBlock, loopHeaderBlock);
 
     // Exit block
-    BasicBlock::Ptr exitBlock = createNewBlock();
-    loopHeaderBlock->addSuccessor(exitBlock);
-    std::cout << "CFGBuilder: " << loopHeaderBlock->toString() << " -> " << exitBlock->toString() << " (for loop exit)\n";
+    BlockId exitBlock = createNewBlock();
+    cfg->addEdge(loopHeaderBlock, exitBlock);
 
     return exitBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleRoutineCall(RoutineCall* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling RoutineCall in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleRoutineCall(RoutineCall* stmt, BlockId currentBlock) {
     return addStatementToBlock(stmt, currentBlock);
 }
 
-BasicBlock::Ptr CFGBuilder::handleReturnStatement(ReturnStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling ReturnStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleReturnStatement(ReturnStatement* stmt, BlockId currentBlock) {
     // Return statement terminates the current control flow path
     currentBlock = addStatementToBlock(stmt, currentBlock);
     // No successors from a return statement within the function's CFG
-    return nullptr; // Indicates that this path is terminated
+    return NoBlock; // Indicates that this path is terminated
 }
 
-BasicBlock::Ptr CFGBuilder::handleLoopStatement(LoopStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling LoopStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleLoopStatement(LoopStatement* stmt, BlockId currentBlock) {
+    cfg->markUnstructured();
     // Add the LOOP statement itself to the current block
     currentBlock = addStatementToBlock(stmt, currentBlock);
 
     // Create a block for the loop header (where control re-enters)
-    BasicBlock::Ptr loopHeaderBlock = createNewBlock();
-    currentBlock->addSuccessor(loopHeaderBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << loopHeaderBlock->toString() << " (loop header)\n";
+    BlockId loopHeaderBlock = createNewBlock();
+    cfg->addEdge(currentBlock, loopHeaderBlock);
 
     // The body of the LOOP statement is not directly part of the LoopStatement AST node.
     // It's usually the next statement in the sequence.
@@ -229,156 +215,146 @@ BasicBlock::Ptr CFGBuilder::handleLoopStatement(LoopStatement* stmt, BasicBlock:
     return loopHeaderBlock; // The loop itself is a continuous block, control flow exits via EXIT/FINISH
 }
 
-BasicBlock::Ptr CFGBuilder::handleRepeatStatement(RepeatStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling RepeatStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleRepeatStatement(RepeatStatement* stmt, BlockId currentBlock) {
     // REPEAT ... UNTIL is a post-test loop
 
     // Create block for loop body
-    BasicBlock::Ptr loopBodyBlock = createNewBlock();
-    currentBlock->addSuccessor(loopBodyBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << loopBodyBlock->toString() << " (repeat loop body)\n";
+    BlockId loopBodyBlock = createNewBlock();
+    cfg->addEdge(currentBlock, loopBodyBlock);
 
     // Build CFG for loop body
-    BasicBlock::Ptr bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
+    BlockId bodyEndBlock = buildCFGForStatement(stmt->body.get(), loopBodyBlock);
 
     // Add condition to bodyEndBlock
     bodyEndBlock = addStatementToBlock(stmt, bodyEndBlock); // The UNTIL condition is part of the last block of the body
 
     // Create exit block
-    BasicBlock::Ptr exitBlock = createNewBlock();
+    BlockId exitBlock = createNewBlock();
 
     // Connect bodyEndBlock to itself (for repeat) and to exitBlock (for until condition met)
-    bodyEndBlock->addSuccessor(loopBodyBlock); // Loop back
-    std::cout << "CFGBuilder: " << bodyEndBlock->toString() << " -> " << loopBodyBlock->toString() << " (repeat loop backedge)\n";
-    bodyEndBlock->addSuccessor(exitBlock);     // Exit condition
-    std::cout << "CFGBuilder: " << bodyEndBlock->toString() << " -> " << exitBlock->toString() << " (repeat loop exit)\n";
+    cfg->addEdge(bodyEndBlock, loopBodyBlock); // Loop back
+    cfg->addEdge(bodyEndBlock, exitBlock);     // Exit condition
 
     return exitBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleSwitchonStatement(SwitchonStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling SwitchonStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleSwitchonStatement(SwitchonStatement* stmt, BlockId currentBlock) {
     currentBlock = addStatementToBlock(stmt, currentBlock);
 
-    BasicBlock::Ptr mergeBlock = createNewBlock();
+    BlockId mergeBlock = createNewBlock();
 
     // Access cases and default_case from the raw pointer after moving stmt
     SwitchonStatement* rawStmt = stmt;
 
+    // Each case may fall through into the next one as well as leave the switch
+    BlockId previousEndBlock = NoBlock;
     for (auto& scase : rawStmt->cases) {
-        BasicBlock::Ptr caseBlock = createNewBlock();
-        currentBlock->addSuccessor(caseBlock);
-        std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << caseBlock->toString() << " (switch case)\n";
-        BasicBlock::Ptr caseEndBlock = buildCFGForStatement(scase.statement.get(), caseBlock);
-        caseEndBlock->addSuccessor(mergeBlock);
-        std::cout << "CFGBuilder: " << caseEndBlock->toString() << " -> " << mergeBlock->toString() << " (switch merge)\n";
+        BlockId caseBlock = createNewBlock();
+        cfg->addEdge(currentBlock, caseBlock);
+        cfg->addEdge(previousEndBlock, caseBlock);
+        previousEndBlock = buildCFGForStatement(scase.statement.get(), caseBlock);
+        cfg->addEdge(previousEndBlock, mergeBlock);
     }
 
     if (rawStmt->default_case) {
-        BasicBlock::Ptr defaultBlock = createNewBlock();
-        currentBlock->addSuccessor(defaultBlock);
-        std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << defaultBlock->toString() << " (switch default)\n";
-        BasicBlock::Ptr defaultEndBlock = buildCFGForStatement(rawStmt->default_case.get(), defaultBlock);
-        defaultEndBlock->addSuccessor(mergeBlock);
-        std::cout << "CFGBuilder: " << defaultEndBlock->toString() << " -> " << mergeBlock->toString() << " (switch merge)\n";
+        BlockId defaultBlock = createNewBlock();
+        cfg->addEdge(currentBlock, defaultBlock);
+        cfg->addEdge(previousEndBlock, defaultBlock);
+        BlockId defaultEndBlock = buildCFGForStatement(rawStmt->default_case.get(), defaultBlock);
+        cfg->addEdge(defaultEndBlock, mergeBlock);
+    } else {
+        cfg->addEdge(currentBlock, mergeBlock);
     }
 
     return mergeBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleGotoStatement(GotoStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling GotoStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleGotoStatement(GotoStatement* stmt, BlockId currentBlock) {
     currentBlock = addStatementToBlock(stmt, currentBlock);
-    // GOTO requires resolution of labels after all blocks are created.
-    // For now, it terminates the current path. Label resolution will connect it later.
-    return nullptr;
+    // GOTO requires resolution of labels after all blocks are created, so
+    // build() adds the edge. A computed target cannot be followed.
+    if (auto label = nodeCast<VariableAccess>(stmt->label.get())) {
+        pendingGotos.emplace_back(currentBlock, label->symbol);
+    } else {
+        cfg->markUnstructured();
+    }
+    return NoBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleLabeledStatement(LabeledStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling LabeledStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleLabeledStatement(LabeledStatement* stmt, BlockId currentBlock) {
     // A labeled statement can be a target of a GOTO.
     // Create a new block for the labeled statement if the current block is not empty
     // or if it's the start of a function.
-    BasicBlock::Ptr labeledBlock = createNewBlock();
-    // TODO: Store mapping from label name to labeledBlock for GOTO resolution
+    BlockId labeledBlock = createNewBlock();
+    labels[SymbolTable::getInstance().intern(stmt->name)] = labeledBlock;
 
-    if (currentBlock) {
-        currentBlock->addSuccessor(labeledBlock);
-        std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << labeledBlock->toString() << " (labeled statement)\n";
-    }
+    cfg->addEdge(currentBlock, labeledBlock);
 
     // Continue building CFG from the labeled statement's body
     return buildCFGForStatement(stmt->statement.get(), labeledBlock);
 }
 
-BasicBlock::Ptr CFGBuilder::handleDeclarationStatement(DeclarationStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling DeclarationStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleDeclarationStatement(DeclarationStatement* stmt, BlockId currentBlock) {
     // Declarations are typically sequential and don't alter control flow directly.
     // However, initializers might contain expressions that need to be evaluated.
     // For simplicity, treat as a regular statement within the current block.
     return addStatementToBlock(stmt, currentBlock);
 }
 
-BasicBlock::Ptr CFGBuilder::handleAssignment(Assignment* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling Assignment in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleAssignment(Assignment* stmt, BlockId currentBlock) {
     return addStatementToBlock(stmt, currentBlock);
 }
 
-BasicBlock::Ptr CFGBuilder::handleTestStatement(TestStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling TestStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleTestStatement(TestStatement* stmt, BlockId currentBlock) {
     // TEST is similar to IF, but with an OR branch
     currentBlock = addStatementToBlock(stmt, currentBlock);
 
-    BasicBlock::Ptr thenBlock = createNewBlock();
-    BasicBlock::Ptr elseBlock = nullptr;
+    BlockId thenBlock = createNewBlock();
+    BlockId elseBlock = NoBlock;
     if (stmt->else_statement) {
         elseBlock = createNewBlock();
     }
 
-    currentBlock->addSuccessor(thenBlock);
-    std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << thenBlock->toString() << " (test then branch)\n";
-    if (elseBlock) {
-        currentBlock->addSuccessor(elseBlock);
-        std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << elseBlock->toString() << " (test else branch)\n";
+    cfg->addEdge(currentBlock, thenBlock);
+    if (elseBlock != NoBlock) {
+        cfg->addEdge(currentBlock, elseBlock);
     }
 
-    BasicBlock::Ptr thenEndBlock = buildCFGForStatement(stmt->then_statement.get(), thenBlock);
-    BasicBlock::Ptr elseEndBlock = nullptr;
+    BlockId thenEndBlock = buildCFGForStatement(stmt->then_statement.get(), thenBlock);
+    BlockId elseEndBlock = NoBlock;
     if (stmt->else_statement) {
         elseEndBlock = buildCFGForStatement(stmt->else_statement.get(), elseBlock);
     }
 
-    BasicBlock::Ptr mergeBlock = createNewBlock();
+    BlockId mergeBlock = createNewBlock();
 
-    thenEndBlock->addSuccessor(mergeBlock);
-    std::cout << "CFGBuilder: " << thenEndBlock->toString() << " -> " << mergeBlock->toString() << " (test merge)\n";
-    if (elseEndBlock) {
-        elseEndBlock->addSuccessor(mergeBlock);
-        std::cout << "CFGBuilder: " << elseEndBlock->toString() << " -> " << mergeBlock->toString() << " (test merge)\n";
+    cfg->addEdge(thenEndBlock, mergeBlock);
+    if (stmt->else_statement) {
+        cfg->addEdge(elseEndBlock, mergeBlock);
     } else {
-        currentBlock->addSuccessor(mergeBlock);
-        std::cout << "CFGBuilder: " << currentBlock->toString() << " -> " << mergeBlock->toString() << " (test merge, no else)\n";
+        cfg->addEdge(currentBlock, mergeBlock);
     }
 
     return mergeBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleResultisStatement(ResultisStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling ResultisStatement in " << currentBlock->toString() << "\n";
-    return addStatementToBlock(stmt, currentBlock);
+BlockId CFGBuilder::handleResultisStatement(ResultisStatement* stmt, BlockId currentBlock) {
+    // RESULTIS leaves the function's VALOF body; VALOFs nested in expressions
+    // are not expanded into blocks, so this always ends the path.
+    addStatementToBlock(stmt, currentBlock);
+    return NoBlock;
 }
 
-BasicBlock::Ptr CFGBuilder::handleEndcaseStatement(EndcaseStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling EndcaseStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleEndcaseStatement(EndcaseStatement* stmt, BlockId currentBlock) {
     // ENDCASE typically jumps to the end of the enclosing SWITCHON statement.
     // This requires context of the enclosing SWITCHON, which is not directly available here.
     // For now, treat it as terminating the current path, similar to GOTO.
+    cfg->markUnstructured();
     return addStatementToBlock(stmt, currentBlock);
 }
 
-BasicBlock::Ptr CFGBuilder::handleFinishStatement(FinishStatement* stmt, BasicBlock::Ptr currentBlock) {
-    std::cout << "CFGBuilder: Handling FinishStatement in " << currentBlock->toString() << "\n";
+BlockId CFGBuilder::handleFinishStatement(FinishStatement* stmt, BlockId currentBlock) {
     // FINISH terminates the program or current routine.
     currentBlock = addStatementToBlock(stmt, currentBlock);
-    return nullptr; // Terminates the path
+    return NoBlock; // Terminates the path
 }
\ No newline at end of file
@@ -2,66 +2,78 @@
 #define CFG_BUILDER_H
 
 #include "AST.h" // Include AST.h to get StatementPtr and other AST types
-#include "BasicBlock.h"
+#include "ControlFlowGraph.h"
+#include "SymbolTable.h"
 #include <map>
+#include <string>
+#include <utility>
 #include <vector>
-#include <memory>
 
 /**
  * @class CFGBuilder
  * @brief Builds a Control Flow Graph (CFG) from an Abstract Syntax Tree (AST).
  *
- * This class traverses the AST and constructs basic blocks, identifying control
- * flow edges (successors and predecessors) based on the semantics of statements
- * like if, while, for, routine calls, and jumps.
+ * This class traverses the AST and constructs one ControlFlowGraph per
+ * function, identifying control flow edges based on the semantics of
+ * statements like if, while, for, routine calls, and jumps.
+ *
+ * A GOTO naming a label of the same function gets its edge once the whole
+ * function is built. Jumps whose target is not tracked (computed GOTOs,
+ * LOOP, BREAK, ENDCASE) are not given their real edges; their graphs report
+ * !isStructured() so analyses can fall back to a conservative answer.
  */
 class CFGBuilder {
 public:
-    CFGBuilder() : nextBlockId(0) {}
-
     /**
      * @brief Builds the CFG for a given program.
      * @param program The root of the AST.
      */
     void build(const ProgramPtr& program);
 
-    // Getter for functionEntryBlocks
-    const std::map<std::string, BasicBlock::Ptr>& getFunctionEntryBlocks() const {
-        return functionEntryBlocks;
+    // One graph per function, by function name
+    const std::map<std::string, ControlFlowGraph>& getFunctionCFGs() const {
+        return functionCFGs;
+    }
+
+    // Hands the graphs to the caller, leaving the builder empty
+    std::map<std::string, ControlFlowGraph> takeFunctionCFGs() {
+        return std::move(functionCFGs);
     }
 
 private:
-    int nextBlockId;
-    std::map<std::string, BasicBlock::Ptr> functionEntryBlocks; // Maps function names to their entry block
-    std::map<std::string, BasicBlock::Ptr> labels; // Maps label names to their basic blocks
+    std::map<std::string, ControlFlowGraph> functionCFGs;
+    ControlFlowGraph* cfg = nullptr;                       // Graph of the function being built
+    SymbolMap<BlockId> labels;                             // Its labels, by name
+    std::vector<std::pair<BlockId, SymbolId>> pendingGotos; // GOTOs waiting for their label
 
     // Helper to create a new basic block
-    BasicBlock::Ptr createNewBlock();
+    BlockId createNewBlock();
 
-    // Recursive function to build CFG for a statement
-    BasicBlock::Ptr buildCFGForStatement(Statement* stmt, BasicBlock::Ptr currentBlock);
+    // Recursive function to build CFG for a statement. A block of NoBlock
+    // means the path into the statement has already ended.
+    BlockId buildCFGForStatement(Statement* stmt, BlockId currentBlock);
 
     // Specific statement handlers
-    BasicBlock::Ptr handleCompoundStatement(CompoundStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleIfStatement(IfStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleWhileStatement(WhileStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleForStatement(ForStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleRoutineCall(RoutineCall* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleReturnStatement(ReturnStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleLoopStatement(LoopStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleRepeatStatement(RepeatStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleSwitchonStatement(SwitchonStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleGotoStatement(GotoStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleLabeledStatement(LabeledStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleDeclarationStatement(DeclarationStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleAssignment(Assignment* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleTestStatement(TestStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleResultisStatement(ResultisStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleEndcaseStatement(EndcaseStatement* stmt, BasicBlock::Ptr currentBlock);
-    BasicBlock::Ptr handleFinishStatement(FinishStatement* stmt, BasicBlock::Ptr currentBlock);
+    BlockId handleCompoundStatement(CompoundStatement* stmt, BlockId currentBlock);
+    BlockId handleIfStatement(IfStatement* stmt, BlockId currentBlock);
+    BlockId handleWhileStatement(WhileStatement* stmt, BlockId currentBlock);
+    BlockId handleForStatement(ForStatement* stmt, BlockId currentBlock);
+    BlockId handleRoutineCall(RoutineCall* stmt, BlockId currentBlock);
+    BlockId handleReturnStatement(ReturnStatement* stmt, BlockId currentBlock);
+    BlockId handleLoopStatement(LoopStatement* stmt, BlockId currentBlock);
+    BlockId handleRepeatStatement(RepeatStatement* stmt, BlockId currentBlock);
+    BlockId handleSwitchonStatement(SwitchonStatement* stmt, BlockId currentBlock);
+    BlockId handleGotoStatement(GotoStatement* stmt, BlockId currentBlock);
+    BlockId handleLabeledStatement(LabeledStatement* stmt, BlockId currentBlock);
+    BlockId handleDeclarationStatement(DeclarationStatement* stmt, BlockId currentBlock);
+    BlockId handleAssignment(Assignment* stmt, BlockId currentBlock);
+    BlockId handleTestStatement(TestStatement* stmt, BlockId currentBlock);
+    BlockId handleResultisStatement(ResultisStatement* stmt, BlockId currentBlock);
+    BlockId handleEndcaseStatement(EndcaseStatement* stmt, BlockId currentBlock);
+    BlockId handleFinishStatement(FinishStatement* stmt, BlockId currentBlock);
 
     // Helper to add a statement to the current block or start a new one if needed
-    BasicBlock::Ptr addStatementToBlock(Statement* stmt, BasicBlock::Ptr currentBlock);
+    BlockId addStatementToBlock(Statement* stmt, BlockId currentBlock);
 };
 
 #endif // CFG_BUILDER_H
@@ -2,16 +2,20 @@
 #include "StatementCodeGenerator.h"
 #include "ExpressionCodeGenerator.h"
 #include "AST.h"
+#include "IRBuilder.h"
+#include "IRSelector.h"
 #include "StringAccess.h"
 #include "VectorAllocationVisitor.h"
 #include "JitRuntime.h"
+#include "JITExecutor.h"
+#include "PeepholeOptimizer.h"
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
 #include <algorithm> // For std::min
 
-CodeGenerator::CodeGenerator() : instructions(), labelManager(), scratchAllocator(), registerManager(instructions), currentLocalVarOffset(0), maxOutgoingParamSpace(0), maxCallerSavedRegsSpace(0), manifestConstants() {
+CodeGenerator::CodeGenerator() : instructions(), labelManager(instructions), scratchAllocator(), registerManager(instructions), currentLocalVarOffset(0), maxOutgoingParamSpace(0), maxCallerSavedRegsSpace(0), manifestConstants() {
     // Initialize callee-saved registers (x19-x28)
     for (uint32_t i = 19; i <= 28; ++i) {
         calleeSavedRegs.push_back(i);
@@ -29,41 +33,53 @@ uintptr_t CodeGenerator::compile(ProgramPtr program) {
     instructions.clear();
     localVars.clear();
     functions.clear();
+    programFunctions.clear();
     globals.clear();
+    manifestConstants.clear();
     currentLocalVarOffset = 0;
     maxOutgoingParamSpace = 0;
     maxCallerSavedRegsSpace = 0;
     savedCalleeRegsInPrologue.clear();
+    tailCallFrameReleases.clear();
+    allocatorStats = LinearScanAllocator::Statistics();
     assemblyListing.str("");
     pendingCases.clear();
     registerManager.clear(); // Clear register manager state
+    irSelector = std::make_unique<IRSelector>(*this);
+    constantPropagation = SparseConditionalConstantPropagation();
+    valueNumbering = GlobalValueNumbering();
+    irFallbacks = 0;
 
     // Register runtime functions
+    SymbolTable& symbols = SymbolTable::getInstance();
     for (const auto& symbol : JitRuntime::getInstance().getSymbolTable()) {
-        functions[symbol.first] = symbol.second;
+        functions[symbols.intern(symbol.first)] = symbol.second;
     }
 
     // Generate code
     visitProgram(program.get());
 
     // Find entry point (START function)
-    auto it = functions.find("START");
-    if (it == functions.end()) {
+    const SymbolId start = symbols.intern("START");
+    if (!functions.contains(start)) {
         throw std::runtime_error("No START function found");
     }
 
-    finalizeCode(); // Call finalizeCode to generate the assembly listing
+    finalizeCode(); // Optimizes and resolves branches
 
-    return it->second;
+    return functions[start]; // Updated by finalizeCode if the peephole pass moved START
 }
 
 void CodeGenerator::visitProgram(const Program* node) {
-    // First pass: collect all global and manifest declarations
+    // First pass: collect all global and manifest declarations, and the
+    // functions that may be called before their code is generated
     for (const auto& decl : node->declarations) {
-        if (auto globalDecl = dynamic_cast<const GlobalDeclaration*>(decl.get())) {
+        if (auto globalDecl = nodeCast<GlobalDeclaration>(decl.get())) {
             statementGenerator->visitGlobalDeclaration(globalDecl);
-        } else if (auto manifestDecl = dynamic_cast<const ManifestDeclaration*>(decl.get())) {
+        } else if (auto manifestDecl = nodeCast<ManifestDeclaration>(decl.get())) {
             statementGenerator->visitManifestDeclaration(manifestDecl);
+        } else if (auto functionDecl = nodeCast<FunctionDeclaration>(decl.get())) {
+            programFunctions.insert(SymbolTable::getInstance().intern(functionDecl->name));
         }
     }
 
@@ -74,98 +90,156 @@ void CodeGenerator::visitProgram(const Program* node) {
 }
 
 void CodeGenerator::visitStatement(const Statement* stmt) {
-    if (auto compound = dynamic_cast<const CompoundStatement*>(stmt)) {
-        statementGenerator->visitCompoundStatement(compound);
-    } else if (auto letDecl = dynamic_cast<const LetDeclaration*>(stmt)) {
-        statementGenerator->visitLetDeclaration(letDecl);
-    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(stmt)) {
-        statementGenerator->visitIfStatement(ifStmt);
-    } else if (auto testStmt = dynamic_cast<const TestStatement*>(stmt)) {
-        statementGenerator->visitTestStatement(testStmt);
-    } else if (auto whileStmt = dynamic_cast<const WhileStatement*>(stmt)) {
-        statementGenerator->visitWhileStatement(whileStmt);
-    } else if (auto switchStmt = dynamic_cast<const SwitchonStatement*>(stmt)) {
-        statementGenerator->visitSwitchonStatement(switchStmt);
-    } else if (auto forStmt = dynamic_cast<const ForStatement*>(stmt)) {
-        statementGenerator->visitForStatement(forStmt);
-    } else if (auto gotoStmt = dynamic_cast<const GotoStatement*>(stmt)) {
-        statementGenerator->visitGotoStatement(gotoStmt);
-    } else if (auto labeledStmt = dynamic_cast<const LabeledStatement*>(stmt)) {
-        statementGenerator->visitLabeledStatement(labeledStmt);
-    } else if (auto assign = dynamic_cast<const Assignment*>(stmt)) {
-        statementGenerator->visitAssignment(assign);
-    } else if (auto routine = dynamic_cast<const RoutineCall*>(stmt)) {
-        statementGenerator->visitRoutineCall(routine);
-    } else if (auto resultis = dynamic_cast<const ResultisStatement*>(stmt)) {
-        statementGenerator->visitResultisStatement(resultis);
-    } else if (auto breakStmt = dynamic_cast<const BreakStatement*>(stmt)) {
-        statementGenerator->visitBreakStatement(breakStmt);
-    } else if (auto returnStmt = dynamic_cast<const ReturnStatement*>(stmt)) {
-        statementGenerator->visitReturnStatement(returnStmt);
-    } else if (auto loopStmt = dynamic_cast<const LoopStatement*>(stmt)) {
-        statementGenerator->visitLoopStatement(loopStmt);
-    } else if (auto repeatStmt = dynamic_cast<const RepeatStatement*>(stmt)) {
-        statementGenerator->visitRepeatStatement(repeatStmt);
-    } else if (auto endcaseStmt = dynamic_cast<const EndcaseStatement*>(stmt)) {
-        statementGenerator->visitEndcaseStatement(endcaseStmt);
-    } else if (auto finishStmt = dynamic_cast<const FinishStatement*>(stmt)) {
-        statementGenerator->visitFinishStatement(finishStmt);
-    } else if (auto declStmt = dynamic_cast<const DeclarationStatement*>(stmt)) {
-        statementGenerator->visitDeclarationStatement(declStmt);
+    if (!stmt) return;
+    switch (stmt->kind()) {
+        case NodeKind::CompoundStatement:
+            statementGenerator->visitCompoundStatement(static_cast<const CompoundStatement*>(stmt));
+            break;
+        case NodeKind::IfStatement:
+            statementGenerator->visitIfStatement(static_cast<const IfStatement*>(stmt));
+            break;
+        case NodeKind::TestStatement:
+            statementGenerator->visitTestStatement(static_cast<const TestStatement*>(stmt));
+            break;
+        case NodeKind::WhileStatement:
+            statementGenerator->visitWhileStatement(static_cast<const WhileStatement*>(stmt));
+            break;
+        case NodeKind::SwitchonStatement:
+            statementGenerator->visitSwitchonStatement(static_cast<const SwitchonStatement*>(stmt));
+            break;
+        case NodeKind::ForStatement:
+            statementGenerator->visitForStatement(static_cast<const ForStatement*>(stmt));
+            break;
+        case NodeKind::GotoStatement:
+            statementGenerator->visitGotoStatement(static_cast<const GotoStatement*>(stmt));
+            break;
+        case NodeKind::LabeledStatement:
+            statementGenerator->visitLabeledStatement(static_cast<const LabeledStatement*>(stmt));
+            break;
+        case NodeKind::Assignment:
+            statementGenerator->visitAssignment(static_cast<const Assignment*>(stmt));
+            break;
+        case NodeKind::RoutineCall:
+            statementGenerator->visitRoutineCall(static_cast<const RoutineCall*>(stmt));
+            break;
+        case NodeKind::ResultisStatement:
+            statementGenerator->visitResultisStatement(static_cast<const ResultisStatement*>(stmt));
+            break;
+        case NodeKind::BreakStatement:
+            statementGenerator->visitBreakStatement(static_cast<const BreakStatement*>(stmt));
+            break;
+        case NodeKind::ReturnStatement:
+            statementGenerator->visitReturnStatement(static_cast<const ReturnStatement*>(stmt));
+            break;
+        case NodeKind::LoopStatement:
+            statementGenerator->visitLoopStatement(static_cast<const LoopStatement*>(stmt));
+            break;
+        case NodeKind::RepeatStatement:
+            statementGenerator->visitRepeatStatement(static_cast<const RepeatStatement*>(stmt));
+            break;
+        case NodeKind::EndcaseStatement:
+            statementGenerator->visitEndcaseStatement(static_cast<const EndcaseStatement*>(stmt));
+            break;
+        case NodeKind::FinishStatement:
+            statementGenerator->visitFinishStatement(static_cast<const FinishStatement*>(stmt));
+            break;
+        case NodeKind::DeclarationStatement:
+            statementGenerator->visitDeclarationStatement(static_cast<const DeclarationStatement*>(stmt));
+            break;
+        default:
+            break;
     }
 }
 
 void CodeGenerator::visitDeclaration(const Declaration* decl) {
-    if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl)) {
-        statementGenerator->visitFunctionDeclaration(funcDecl);
-    } else if (auto letDecl = dynamic_cast<const LetDeclaration*>(decl)) {
-        statementGenerator->visitLetDeclaration(letDecl);
-    } else if (auto globalDecl = dynamic_cast<const GlobalDeclaration*>(decl)) {
-        statementGenerator->visitGlobalDeclaration(globalDecl);
-    } else if (auto manifestDecl = dynamic_cast<const ManifestDeclaration*>(decl)) {
-        statementGenerator->visitManifestDeclaration(manifestDecl);
-    } else if (auto valof = dynamic_cast<const Valof*>(decl)) {
-        expressionGenerator->visitValof(valof);
+    if (!decl) return;
+    switch (decl->kind()) {
+        case NodeKind::FunctionDeclaration:
+            if (!selectFromIR(static_cast<const FunctionDeclaration*>(decl))) {
+                statementGenerator->visitFunctionDeclaration(static_cast<const FunctionDeclaration*>(decl));
+            }
+            break;
+        case NodeKind::LetDeclaration:
+            statementGenerator->visitLetDeclaration(static_cast<const LetDeclaration*>(decl));
+            break;
+        case NodeKind::GlobalDeclaration:
+            statementGenerator->visitGlobalDeclaration(static_cast<const GlobalDeclaration*>(decl));
+            break;
+        case NodeKind::ManifestDeclaration:
+            statementGenerator->visitManifestDeclaration(static_cast<const ManifestDeclaration*>(decl));
+            break;
+        default:
+            break;
     }
 }
 
-void CodeGenerator::visitExpression(const Expression* expr) {
-    if (auto* numLit = dynamic_cast<const NumberLiteral*>(expr)) {
-        expressionGenerator->visitNumberLiteral(numLit);
-    } else if (auto* strLit = dynamic_cast<const StringLiteral*>(expr)) {
-        expressionGenerator->visitStringLiteral(strLit);
-    } else if (auto* charLit = dynamic_cast<const CharLiteral*>(expr)) {
-        expressionGenerator->visitCharLiteral(charLit);
-    } else if (auto* var = dynamic_cast<const VariableAccess*>(expr)) {
-        expressionGenerator->visitVariableAccess(var);
-    } else if (auto* unary = dynamic_cast<const UnaryOp*>(expr)) {
-        expressionGenerator->visitUnaryOp(unary);
-    } else if (auto* binary = dynamic_cast<const BinaryOp*>(expr)) {
-        expressionGenerator->visitBinaryOp(binary);
-    } else if (auto* call = dynamic_cast<const FunctionCall*>(expr)) {
-        expressionGenerator->visitFunctionCall(call);
-    } else if (auto* cond = dynamic_cast<const ConditionalExpression*>(expr)) {
-        expressionGenerator->visitConditionalExpression(cond);
-    } else if (auto* valof = dynamic_cast<const Valof*>(expr)) {
-        expressionGenerator->visitValof(valof);
-    } else if (auto* table = dynamic_cast<const TableConstructor*>(expr)) {
-        expressionGenerator->visitTableConstructor(table);
-    } else if (auto* vec = dynamic_cast<const VectorConstructor*>(expr)) {
-        expressionGenerator->visitVectorConstructor(vec);
-    } else if (auto* charAccess = dynamic_cast<const CharacterAccess*>(expr)) {
-        expressionGenerator->visitCharacterAccess(charAccess);
-    } else if (auto* vecAccess = dynamic_cast<const VectorAccess*>(expr)) {
-        expressionGenerator->visitVectorAccess(vecAccess);
+bool CodeGenerator::selectFromIR(const FunctionDeclaration* node) {
+    if (!irSelectionEnabled) {
+        return false;
+    }
+    IRBuilder::Environment environment;
+    environment.globals = &globals;
+    environment.manifests = &manifestConstants;
+    environment.isFunction = [this](SymbolId symbol) {
+        return functions.contains(symbol) || programFunctions.contains(symbol);
+    };
+    IRBuilder builder(std::move(environment));
+    std::unique_ptr<IRFunction> function = builder.build(node);
+    if (function) {
+        constantPropagation.run(*function);
+        valueNumbering.run(*function);
     }
+    if (!function || !irSelector->select(*function)) {
+        ++irFallbacks;
+        return false;
+    }
+    return true;
 }
 
-// Keep only the essential helper methods that are not visitor-specific
-void CodeGenerator::resolveLabels() {
-    auto fixups = labelManager.getFixups();
-    for (const auto& fixup : fixups) {
-        size_t targetAddress = labelManager.getLabelAddress(fixup.labelName);
-        int32_t offset = static_cast<int32_t>(targetAddress - fixup.instructionAddress);
-        instructions.resolveBranch(fixup.instructionAddress / 4, offset);
+void CodeGenerator::visitExpression(const Expression* expr) {
+    if (!expr) return;
+    switch (expr->kind()) {
+        case NodeKind::NumberLiteral:
+            expressionGenerator->visitNumberLiteral(static_cast<const NumberLiteral*>(expr));
+            break;
+        case NodeKind::StringLiteral:
+            expressionGenerator->visitStringLiteral(static_cast<const StringLiteral*>(expr));
+            break;
+        case NodeKind::CharLiteral:
+            expressionGenerator->visitCharLiteral(static_cast<const CharLiteral*>(expr));
+            break;
+        case NodeKind::VariableAccess:
+            expressionGenerator->visitVariableAccess(static_cast<const VariableAccess*>(expr));
+            break;
+        case NodeKind::UnaryOp:
+            expressionGenerator->visitUnaryOp(static_cast<const UnaryOp*>(expr));
+            break;
+        case NodeKind::BinaryOp:
+            expressionGenerator->visitBinaryOp(static_cast<const BinaryOp*>(expr));
+            break;
+        case NodeKind::FunctionCall:
+            expressionGenerator->visitFunctionCall(static_cast<const FunctionCall*>(expr));
+            break;
+        case NodeKind::ConditionalExpression:
+            expressionGenerator->visitConditionalExpression(static_cast<const ConditionalExpression*>(expr));
+            break;
+        case NodeKind::Valof:
+            expressionGenerator->visitValof(static_cast<const Valof*>(expr));
+            break;
+        case NodeKind::TableConstructor:
+            expressionGenerator->visitTableConstructor(static_cast<const TableConstructor*>(expr));
+            break;
+        case NodeKind::VectorConstructor:
+            expressionGenerator->visitVectorConstructor(static_cast<const VectorConstructor*>(expr));
+            break;
+        case NodeKind::CharacterAccess:
+            expressionGenerator->visitCharacterAccess(static_cast<const CharacterAccess*>(expr));
+            break;
+        case NodeKind::VectorAccess:
+            expressionGenerator->visitVectorAccess(static_cast<const VectorAccess*>(expr));
+            break;
+        default:
+            break;
     }
 }
 
@@ -191,21 +265,20 @@ void CodeGenerator::restoreCallerSavedRegisters() {
     // Implementation placeholder
 }
 
-int CodeGenerator::allocateLocal(const std::string& name) {
-    if (localVars.find(name) != localVars.end()) {
-        return localVars[name];
+int CodeGenerator::allocateLocal(SymbolId var) {
+    if (const int* offset = localVars.find(var)) {
+        return *offset;
     }
     currentLocalVarOffset -= 8; // 8 bytes per local variable
-    localVars[name] = currentLocalVarOffset;
+    localVars[var] = currentLocalVarOffset;
     return currentLocalVarOffset;
 }
 
-int CodeGenerator::getLocalOffset(const std::string& name) {
-    auto it = localVars.find(name);
-    if (it != localVars.end()) {
-        return it->second;
+int CodeGenerator::getLocalOffset(SymbolId var) {
+    if (const int* offset = localVars.find(var)) {
+        return *offset;
     }
-    throw std::runtime_error("Local variable not found: " + name);
+    throw std::runtime_error("Local variable not found: " + SymbolTable::getInstance().name(var));
 }
 
 size_t CodeGenerator::allocateGlobal() {
@@ -249,29 +322,46 @@ bool CodeGenerator::isRegisterInUse(uint32_t reg) {
 }
 
 void CodeGenerator::saveCalleeSavedRegisters() {
-    // Implementation placeholder
+    // Only the callee-saved registers the allocator handed out need saving
+    savedCalleeRegsInPrologue.clear();
+    for (uint32_t reg : registerManager.getCalleeSavedRegisters()) {
+        currentLocalVarOffset -= 8;
+        instructions.str(reg, X29, currentLocalVarOffset, [&] { return "Save callee-saved register " + instructions.regName(reg); });
+        savedCalleeRegsInPrologue.emplace_back(reg, currentLocalVarOffset);
+    }
 }
 
 void CodeGenerator::restoreCalleeSavedRegisters() {
+    // Also used by tail calls, so the save list is kept until the next prologue
     for (auto it = savedCalleeRegsInPrologue.rbegin(); it != savedCalleeRegsInPrologue.rend(); ++it) {
-        instructions.ldr(it->first, X29, it->second, "Restore callee-saved register " + instructions.regName(it->first));
-        currentLocalVarOffset += 8;
+        instructions.ldr(it->first, X29, it->second, [&] { return "Restore callee-saved register " + instructions.regName(it->first); });
     }
-    savedCalleeRegsInPrologue.clear();
 }
 
 void CodeGenerator::finalizeCode() {
+    // Perform peephole optimization while branches still refer to labels
+    performPeepholeOptimization();
+
+    // Rewrite branches the peephole pass left out of reach of their targets
+    relaxationStats = instructions.relaxBranches();
+
     // Compute addresses for all instructions
     instructions.computeAddresses();
 
+    // Function entry offsets were recorded during generation; removed
+    // instructions shift them, so take them from the labels again.
+    const auto& instrs = instructions.getInstructions();
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        if (instrs[i].hasLabel()) {
+            // Labels that were never interned are not function names
+            if (size_t* function = functions.find(SymbolTable::getInstance().lookup(instructions.labelName(instrs[i].label)))) {
+                *function = instructions.addressOf(i);
+            }
+        }
+    }
+
     // Resolve all branch targets
     instructions.resolveAllBranches();
-
-    // Perform peephole optimization
-    performPeepholeOptimization();
-
-    // Generate final assembly listing
-    generateAssemblyListing();
 }
 
 void CodeGenerator::resolveBranchTargets() {
@@ -279,41 +369,90 @@ void CodeGenerator::resolveBranchTargets() {
 }
 
 void CodeGenerator::performPeepholeOptimization() {
-    // Implementation placeholder
+    PeepholeOptimizer optimizer(instructions.getInstructions());
+    optimizer.run();
+    peepholeStats = optimizer.getStatistics();
 }
 
-void CodeGenerator::generateAssemblyListing() {
-    assemblyListing.clear();
-    assemblyListing << ".text\n";
-    assemblyListing << ".align 4\n\n";
+void CodeGenerator::generateAssemblyListing(std::ostream& out) const {
+    // Text is disassembled from the final encodings only when a listing is asked for
+    out << ".text\n";
+    out << ".align 4\n\n";
 
     for (const auto& instr : instructions.getInstructions()) {
-        if (instr.hasLabel) {
-            assemblyListing << instr.label << ":\n";
+        if (instr.hasLabel()) {
+            out << instructions.labelName(instr.label) << ":\n";
+        }
+        const std::string& comment = instructions.commentOf(instr);
+        if (comment.empty()) {
+            out << "\t" << instructions.disassemble(instr) << "\n";
+        } else {
+            out << "\t" << std::left << std::setw(32) << instructions.disassemble(instr) << " // " << comment << "\n";
         }
-        assemblyListing << "\t" << instr.toString() << "\n";
     }
 
     // Print string pool
     if (!stringPool.empty()) {
-        assemblyListing << "\n.data\n";
+        out << "\n.data\n";
         for (size_t i = 0; i < stringPool.size(); ++i) {
-            assemblyListing << ".L.str" << i << ":\n";
-            assemblyListing << "    .string \"" << stringPool[i] << "\"\n";
+            out << ".L.str" << i << ":\n";
+            out << "    .string \"" << stringPool[i] << "\"\n";
         }
     }
 }
 
-bool CodeGenerator::canCombineLoadStore(const AArch64Instructions::Instruction& instr1, const AArch64Instructions::Instruction& instr2) {
-    return false; // Placeholder
+void CodeGenerator::printAsm() const {
+    std::cout << "\n;------------ Generated ARM64 Assembly ------------\n\n";
+    generateAssemblyListing(std::cout);
+    std::cout << "\n;------------ End of Assembly ------------\n\n";
 }
 
-void CodeGenerator::combineLoadStore(AArch64Instructions::Instruction& instr1, AArch64Instructions::Instruction& instr2) {
-    // Implementation placeholder
+void CodeGenerator::printStatistics() const {
+    const auto& stats = peepholeStats;
+    std::cout << "=== Peephole Statistics ===\n";
+    std::cout << "  Self moves removed:       " << stats.selfMoves << "\n";
+    std::cout << "  Copies propagated:        " << stats.propagatedCopies << "\n";
+    std::cout << "  Dead definitions removed: " << stats.deadDefinitions << "\n";
+    std::cout << "  Immediates folded:        " << stats.foldedImmediates << "\n";
+    std::cout << "  Redundant loads removed:  " << stats.redundantLoads << "\n";
+    std::cout << "  Load/store pairs formed:  " << stats.pairedLoadStores << "\n";
+    std::cout << "  Branches to next removed: " << stats.branchesToNext << "\n";
+    std::cout << "  Compare/branch fusions:   " << stats.fusedCompareBranches << "\n";
+    std::cout << "  Instructions:             " << stats.instructionsBefore << " -> "
+              << stats.instructionsAfter << " (" << stats.removed() << " removed)\n";
+
+    const auto& alloc = allocatorStats;
+    std::cout << "=== Register Allocation Statistics ===\n";
+    std::cout << "  Live intervals:           " << alloc.intervals << "\n";
+    std::cout << "  Kept in registers:        " << alloc.allocated << "\n";
+    std::cout << "  Kept on the stack:        " << alloc.spilled << "\n";
+    std::cout << "  Callee-saved registers:   " << alloc.calleeSavedUsed << "\n";
+
+    const auto& relax = relaxationStats;
+    std::cout << "=== Branch Relaxation Statistics ===\n";
+    std::cout << "  Conditional branches:     " << relax.conditionalBranches << "\n";
+    std::cout << "  Call veneers:             " << relax.veneers << "\n";
+    std::cout << "  Passes:                   " << relax.passes << "\n";
+
+    if (irSelectionEnabled) {
+        const auto& ir = irSelector->getStatistics();
+        std::cout << "=== IR Selection Statistics ===\n";
+        std::cout << "  Functions from the IR:    " << ir.functions << "\n";
+        std::cout << "  Fallbacks to the AST:     " << irFallbacks << "\n";
+        const auto& sccp = constantPropagation.getStatistics();
+        std::cout << "  Constants propagated:     " << sccp.constants << "\n";
+        std::cout << "  Branches folded:          " << sccp.branches << "\n";
+        std::cout << "  Dead blocks removed:      " << sccp.blocks << "\n";
+        const auto& gvn = valueNumbering.getStatistics();
+        std::cout << "  Redundant values removed: " << gvn.values + gvn.phis << "\n";
+        std::cout << "  Redundant loads removed:  " << gvn.loads << "\n";
+        std::cout << "  IR instructions:          " << ir.values << "\n";
+        std::cout << "  Values in registers:      " << ir.registers << "\n";
+        std::cout << "  Values spilled:           " << ir.spilled << "\n";
+        std::cout << "  Phi copies:               " << ir.phiMoves << "\n";
+    }
 }
 
-void CodeGenerator::printAsm() const {
-    std::cout << "\n;------------ Generated ARM64 Assembly ------------\n\n";
-    std::cout << assemblyListing.str();
-    std::cout << "\n;------------ End of Assembly ------------\n\n";
+void* CodeGenerator::load(JITExecutor& executor, uintptr_t entryOffset) const {
+    return executor.load(instructions, stringPool, entryOffset, globals.size());
 }
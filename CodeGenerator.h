@@ -7,6 +7,12 @@
 #include "LabelManager.h"
 #include "ScratchAllocator.h"
 #include "RegisterManager.h" // Include the new RegisterManager
+#include "LinearScanAllocator.h"
+#include "SymbolTable.h"
+#include "Target.h"
+#include "PeepholeOptimizer.h"
+#include "GlobalValueNumbering.h"
+#include "SparseConditionalConstantPropagation.h"
 #include <string>
 #include <unordered_map>
 #include <sstream>
@@ -15,17 +21,31 @@
 class StringAccess;
 class StatementCodeGenerator;
 class ExpressionCodeGenerator;
+class IRSelector;
 
-class CodeGenerator {
+class CodeGenerator : public TargetCodeGenerator {
 public:
     CodeGenerator();
-    ~CodeGenerator(); // Need to declare destructor when using forward declarations with unique_ptr
-    uintptr_t compile(ProgramPtr program);
-    void printAsm() const;
+    ~CodeGenerator() override; // Need to declare destructor when using forward declarations with unique_ptr
+    uintptr_t compile(ProgramPtr program) override;
+    void printAsm() const override;
+    void setListingEnabled(bool enabled) override { instructions.setKeepComments(enabled); }
+    void setIRSelectionEnabled(bool enabled) override { irSelectionEnabled = enabled; }
+    void printStatistics() const override;
+    void* load(JITExecutor& executor, uintptr_t entryOffset) const override;
+    TargetArch getTarget() const override { return TargetArch::AArch64; }
+
+    // Access to the finalized output, used by the JIT loader
+    const AArch64Instructions& getInstructions() const { return instructions; }
+    const std::vector<std::string>& getStringPool() const { return stringPool; }
+    const PeepholeOptimizer::Statistics& getPeepholeStatistics() const { return peepholeStats; }
+    const LinearScanAllocator::Statistics& getAllocatorStatistics() const { return allocatorStats; }
+    const AArch64Instructions::RelaxationStatistics& getRelaxationStatistics() const { return relaxationStats; }
 
     // Give specialized code generators access to private members
     friend class StatementCodeGenerator;
     friend class ExpressionCodeGenerator;
+    friend class IRSelector;
 
 private:
     // Core components
@@ -36,6 +56,9 @@ private:
     std::stringstream assemblyListing;
     std::vector<std::string> stringPool;
     std::string currentFunctionName; // Added to track the function being compiled
+    PeepholeOptimizer::Statistics peepholeStats;
+    LinearScanAllocator::Statistics allocatorStats;
+    AArch64Instructions::RelaxationStatistics relaxationStats;
 
     // State tracking
     // Stack management
@@ -45,12 +68,15 @@ private:
     std::vector<std::tuple<uint32_t, int, std::string>> savedCallerRegsAroundCall; // Stores (reg, offset_from_FP, var_name) for caller-saved registers
     std::vector<std::pair<uint32_t, int>> savedCalleeRegsInPrologue; // Stores (reg, offset_from_FP) for callee-saved registers
     std::vector<uint32_t> calleeSavedRegs; // List of callee-saved registers (x19-x28)
+    std::vector<size_t> tailCallFrameReleases; // ldp/add pairs of tail calls, back-patched with the frame size
     std::vector<const VectorConstructor*> vectorAllocations;
 
-    std::unordered_map<std::string, int> localVars;
-    std::unordered_map<std::string, size_t> globals;
-    std::unordered_map<std::string, int> manifestConstants;
-    std::unordered_map<std::string, size_t> functions;
+    // Keyed on the interned names of the identifiers
+    SymbolMap<int> localVars;
+    SymbolMap<size_t> globals;
+    SymbolMap<int> manifestConstants;
+    SymbolMap<size_t> functions;
+    SymbolSet programFunctions; // Every function and routine the program declares
 
     struct PendingCase {
         std::string label;
@@ -62,6 +88,13 @@ private:
     std::unique_ptr<StatementCodeGenerator> statementGenerator;
     std::unique_ptr<ExpressionCodeGenerator> expressionGenerator;
 
+    // Functions the IR covers are selected from it; the rest fall back to the AST
+    bool irSelectionEnabled = false;
+    std::unique_ptr<IRSelector> irSelector;
+    SparseConditionalConstantPropagation constantPropagation;
+    GlobalValueNumbering valueNumbering;
+    size_t irFallbacks = 0;
+
     // Register constants
     const uint32_t X0 = AArch64Instructions::X0;   // Result/A register
     const uint32_t X1 = AArch64Instructions::X1;   // B register
@@ -78,15 +111,15 @@ private:
     void visitExpression(const Expression* node);
     void visitDeclarationStatement(const DeclarationStatement* node);
     void visitDeclaration(const Declaration* node);
+    bool selectFromIR(const FunctionDeclaration* node);
 
     // Code generation helpers
-    void resolveLabels();
     void finalizeInstructionAddressing(size_t baseAddress = 0);
     void saveCallerSavedRegisters();
     void restoreCallerSavedRegisters();
 
-    int allocateLocal(const std::string& name);
-    int getLocalOffset(const std::string& name);
+    int allocateLocal(SymbolId var);
+    int getLocalOffset(SymbolId var);
     size_t allocateGlobal();
     std::string getLabelFromComment(const std::string& comment);
     void addToListing(const std::string& instruction, const std::string& comment = "");
@@ -100,9 +133,7 @@ private:
     void finalizeCode();
     void resolveBranchTargets();
     void performPeepholeOptimization();
-    void generateAssemblyListing();
-    bool canCombineLoadStore(const AArch64Instructions::Instruction& instr1, const AArch64Instructions::Instruction& instr2);
-    void combineLoadStore(AArch64Instructions::Instruction& instr1, AArch64Instructions::Instruction& instr2);
+    void generateAssemblyListing(std::ostream& out) const;
 };
 
 #endif // CODEGENERATOR_H
@@ -3,7 +3,8 @@
 
 #include "OptimizationPass.h"
 #include "AST.h"
-#include <unordered_map>
+#include "ASTMutator.h"
+#include "SymbolTable.h"
 #include <memory>
 
 /**
@@ -17,57 +18,27 @@
  * - x * 0 = 0
  * - Conditional expressions with constant conditions
  */
-class ConstantFoldingPass : public OptimizationPass {
+class ConstantFoldingPass : public OptimizationPass, private ASTMutator<ConstantFoldingPass> {
 public:
-    ConstantFoldingPass(std::unordered_map<std::string, int64_t>& manifests);
+    ConstantFoldingPass(SymbolMap<int64_t>& manifests);
     
     ProgramPtr apply(ProgramPtr program) override;
     std::string getName() const override;
+    bool isFunctionPass() const override { return true; }
+    bool applyToDeclaration(Declaration* declaration) override;
 
 private:
-    std::unordered_map<std::string, int64_t>& manifests;
-    
-    // Visitor pattern for transforming nodes
-    ExprPtr visit(Expression* node);
-    StmtPtr visit(Statement* node);
-    DeclPtr visit(Declaration* node);
-    ProgramPtr visit(Program* node);
-    
-    // Expression visitors
-    ExprPtr visit(NumberLiteral* node);
-    ExprPtr visit(FloatLiteral* node);
-    ExprPtr visit(StringLiteral* node);
-    ExprPtr visit(CharLiteral* node);
-    ExprPtr visit(VariableAccess* node);
-    ExprPtr visit(UnaryOp* node);
-    ExprPtr visit(BinaryOp* node);
-    ExprPtr visit(FunctionCall* node);
-    ExprPtr visit(ConditionalExpression* node);
-    ExprPtr visit(Valof* node);
-    ExprPtr visit(VectorConstructor* node);
-    ExprPtr visit(VectorAccess* node);
-    
-    // Statement visitors
-    StmtPtr visit(Assignment* node);
-    StmtPtr visit(RoutineCall* node);
-    StmtPtr visit(CompoundStatement* node);
-    StmtPtr visit(IfStatement* node);
-    StmtPtr visit(TestStatement* node);
-    StmtPtr visit(WhileStatement* node);
-    StmtPtr visit(ForStatement* node);
-    StmtPtr visit(GotoStatement* node);
-    StmtPtr visit(LabeledStatement* node);
-    StmtPtr visit(ReturnStatement* node);
-    StmtPtr visit(FinishStatement* node);
-    StmtPtr visit(ResultisStatement* node);
-    StmtPtr visit(RepeatStatement* node);
-    StmtPtr visit(SwitchonStatement* node);
-    StmtPtr visit(EndcaseStatement* node);
-    StmtPtr visit(DeclarationStatement* node);
+    friend class ASTMutator<ConstantFoldingPass>;
+    using ASTMutator<ConstantFoldingPass>::rewrite;
+
+    SymbolMap<int64_t>& manifests;
     
-    // Declaration visitors
-    DeclPtr visit(LetDeclaration* node);
-    DeclPtr visit(FunctionDeclaration* node);
+    // Nodes this pass folds; ASTMutator walks everything else in place
+    ExprPtr rewrite(VariableAccess* node);
+    ExprPtr rewrite(BinaryOp* node);
+    ExprPtr rewrite(ConditionalExpression* node);
+    StmtPtr rewrite(IfStatement* node);
+    StmtPtr rewrite(TestStatement* node);
 };
 
 #endif // CONSTANT_FOLDING_PASS_H
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "ControlFlowGraph.h"
+#include "GraphOrder.h"
+
+BlockId ControlFlowGraph::createBlock() {
+    const BlockId id = static_cast<BlockId>(blocks_.size());
+    blocks_.emplace_back(id);
+    orders_.valid = false;
+    return id;
+}
+
+void ControlFlowGraph::addEdge(BlockId from, BlockId to) {
+    if (from == NoBlock || to == NoBlock || blocks_[from].successors.contains(to)) {
+        return;
+    }
+    blocks_[from].successors.push_back(to);
+    blocks_[to].predecessors.push_back(from);
+    orders_.valid = false;
+}
+
+const ControlFlowGraph::Orders& ControlFlowGraph::orders() const {
+    if (orders_.valid) {
+        return orders_;
+    }
+    const size_t n = blocks_.size();
+
+    // Forward: reverse postorder from the entry, then dominators
+    auto successors = [this](uint32_t b) -> const SmallVector<BlockId, 2>& { return blocks_[b].successors; };
+    auto predecessors = [this](uint32_t b) -> const SmallVector<BlockId, 2>& { return blocks_[b].predecessors; };
+    numberReversePostorder(entry(), n, successors, orders_.rpo, orders_.rpoIndex);
+    computeDominators(orders_.rpo, orders_.rpoIndex, predecessors, orders_.idom);
+    orders_.idom[entry()] = NoBlock;
+
+    // Backward: the same on the reversed graph, rooted at a virtual exit
+    // numbered n that every reachable block without successors flows into
+    const uint32_t exit = static_cast<uint32_t>(n);
+    std::vector<std::vector<BlockId>> into(n + 1), outOf(n + 1);
+    for (BlockId b : orders_.rpo) {
+        for (BlockId pred : blocks_[b].predecessors) {
+            if (orders_.rpoIndex[pred] != NoBlock) into[b].push_back(pred);
+        }
+        for (BlockId succ : blocks_[b].successors) outOf[b].push_back(succ);
+        if (blocks_[b].successors.empty()) {
+            into[exit].push_back(b);
+            outOf[b].push_back(exit);
+        }
+    }
+    std::vector<uint32_t> postIndex;
+    numberReversePostorder(exit, n + 1, [&](uint32_t b) -> const std::vector<BlockId>& { return into[b]; },
+                     orders_.postOrder, postIndex);
+    computeDominators(orders_.postOrder, postIndex, [&](uint32_t b) -> const std::vector<BlockId>& { return outOf[b]; },
+               orders_.ipdom);
+
+    // Drop the virtual exit from the results
+    orders_.postOrder.erase(orders_.postOrder.begin());
+    postIndex.pop_back();
+    for (uint32_t& i : postIndex) {
+        if (i != NoBlock) --i;
+    }
+    orders_.postIndex = std::move(postIndex);
+    orders_.ipdom.pop_back();
+    for (BlockId& d : orders_.ipdom) {
+        if (d == exit) d = NoBlock;
+    }
+
+    orders_.valid = true;
+    return orders_;
+}
+
+const std::vector<BlockId>& ControlFlowGraph::reversePostorder() const {
+    return orders().rpo;
+}
+
+uint32_t ControlFlowGraph::rpoIndex(BlockId id) const {
+    return orders().rpoIndex[id];
+}
+
+BlockId ControlFlowGraph::idom(BlockId id) const {
+    return orders().idom[id];
+}
+
+bool ControlFlowGraph::dominates(BlockId a, BlockId b) const {
+    const Orders& o = orders();
+    if (o.rpoIndex[a] == NoBlock || o.rpoIndex[b] == NoBlock) return false;
+    // Dominators come earlier in reverse postorder, so the walk stops early
+    while (b != NoBlock && o.rpoIndex[b] >= o.rpoIndex[a]) {
+        if (b == a) return true;
+        b = o.idom[b];
+    }
+    return false;
+}
+
+const std::vector<BlockId>& ControlFlowGraph::postDominatorOrder() const {
+    return orders().postOrder;
+}
+
+BlockId ControlFlowGraph::ipdom(BlockId id) const {
+    return orders().ipdom[id];
+}
+
+bool ControlFlowGraph::postDominates(BlockId a, BlockId b) const {
+    const Orders& o = orders();
+    if (o.postIndex[a] == NoBlock || o.postIndex[b] == NoBlock) return false;
+    while (b != NoBlock && o.postIndex[b] >= o.postIndex[a]) {
+        if (b == a) return true;
+        b = o.ipdom[b];
+    }
+    return false;
+}
@@ -0,0 +1,78 @@
+// ControlFlowGraph.h
+#ifndef CONTROL_FLOW_GRAPH_H
+#define CONTROL_FLOW_GRAPH_H
+
+#include "BasicBlock.h"
+#include <vector>
+
+/**
+ * @class ControlFlowGraph
+ * @brief The basic blocks of one function, stored in an arena and addressed by BlockId.
+ *
+ * Block 0 is the entry. Edges are BlockIds held inline in each block, so a
+ * graph is a single vector and copies or moves like a value. Reverse
+ * postorder, dominators and post-dominators are computed together on first
+ * use and cached until the next edit; blocks unreachable from the entry have
+ * no place in any of them. Post-dominance is taken against a virtual exit
+ * that every block without successors flows into.
+ */
+class ControlFlowGraph {
+public:
+    ControlFlowGraph() { createBlock(); }
+
+    BlockId entry() const { return 0; }
+    size_t size() const { return blocks_.size(); }
+
+    BasicBlock& block(BlockId id) { return blocks_[id]; }
+    const BasicBlock& block(BlockId id) const { return blocks_[id]; }
+
+    BlockId createBlock();
+
+    /// Adds from -> to once; does nothing if from is NoBlock (a path that already ended).
+    void addEdge(BlockId from, BlockId to);
+
+    void addStatement(BlockId id, Statement* stmt) { blocks_[id].addStatement(stmt); }
+
+    /// False if some jump in the function has no edge to its real target.
+    bool isStructured() const { return structured_; }
+    void markUnstructured() { structured_ = false; }
+
+    // --- Cached orders ---
+
+    /// Blocks reachable from the entry, in reverse postorder; entry first.
+    const std::vector<BlockId>& reversePostorder() const;
+
+    /// Position of a block in reversePostorder(), or NoBlock if it is unreachable.
+    uint32_t rpoIndex(BlockId id) const;
+    bool isReachable(BlockId id) const { return rpoIndex(id) != NoBlock; }
+
+    /// Immediate dominator; NoBlock for the entry and for unreachable blocks.
+    BlockId idom(BlockId id) const;
+    bool dominates(BlockId a, BlockId b) const;
+
+    /// Blocks that reach an exit, in reverse postorder of the reversed graph.
+    const std::vector<BlockId>& postDominatorOrder() const;
+
+    /// Immediate post-dominator; NoBlock when only the virtual exit post-dominates.
+    BlockId ipdom(BlockId id) const;
+    bool postDominates(BlockId a, BlockId b) const;
+
+private:
+    std::vector<BasicBlock> blocks_;
+    bool structured_ = true;
+
+    struct Orders {
+        bool valid = false;
+        std::vector<BlockId> rpo;
+        std::vector<uint32_t> rpoIndex;
+        std::vector<BlockId> idom;
+        std::vector<BlockId> postOrder;
+        std::vector<uint32_t> postIndex;
+        std::vector<BlockId> ipdom;
+    };
+    mutable Orders orders_;
+
+    const Orders& orders() const;
+};
+
+#endif // CONTROL_FLOW_GRAPH_H
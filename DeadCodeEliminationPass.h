@@ -4,74 +4,63 @@
 #include "OptimizationPass.h"
 #include "LivenessAnalysisPass.h"
 #include "AST.h"
-#include <set>
+#include "ASTMutator.h"
+#include "SymbolTable.h"
+#include <cstddef>
 #include <memory>
 
 /**
  * @class DeadCodeEliminationPass
- * @brief Removes unused variable declarations and assignments.
+ * @brief Removes dead stores to locals, unused LET initializers and unreachable statements.
  *
- * This pass operates in two stages:
- * 1. An analysis stage that traverses the AST to find all "live" variables.
- * 2. A transformation stage that removes declarations and assignments to "dead" variables.
+ * Three rewrites share one walk of each function:
+ * 1. An assignment to a local that is not live afterwards is dropped; if its
+ *    value is a call, the call is kept as a routine call.
+ * 2. A LET whose pure initializer is dead is dropped when nothing else in the
+ *    function names the variable, and otherwise has its initializer replaced
+ *    by 0.
+ * 3. Statements following a GOTO, RETURN, FINISH, ENDCASE, BREAK, LOOP or
+ *    RESULTIS in the same block are dropped, up to the first one holding a
+ *    label; declarations before such a label are kept for the code after it.
+ *
+ * Only locals tracked by the LivenessAnalysisPass are considered, and it
+ * answers conservatively for address-taken locals and unstructured functions.
+ * Removing a store can make the values it read dead in turn, so after a round
+ * that changed anything liveness is recomputed and the walk repeated. The
+ * liveness pass is left describing the final tree.
  */
-class DeadCodeEliminationPass : public OptimizationPass {
+class DeadCodeEliminationPass : public OptimizationPass, private ASTMutator<DeadCodeEliminationPass> {
 public:
-    DeadCodeEliminationPass(LivenessAnalysisPass* livenessPass) : livenessAnalysis(livenessPass) {}
-
-private:
-    LivenessAnalysisPass* livenessAnalysis; // Pointer to the liveness analysis pass
+    explicit DeadCodeEliminationPass(LivenessAnalysisPass* livenessPass) : livenessAnalysis(livenessPass) {}
 
-public:
     ProgramPtr apply(ProgramPtr program) override;
     std::string getName() const override;
 
-private:
-    // --- Analysis Stage ---
-    
-    void analyzeNode(Node* node);
+    struct Statistics {
+        size_t stores = 0;        // Assignments removed, or reduced to their call
+        size_t initializers = 0;  // LET initializers removed or replaced by 0
+        size_t unreachable = 0;   // Statements removed after a jump
+        size_t rounds = 0;        // Walks of the program, each after fresh liveness
+    };
 
-    // --- Transformation Stage ---
-    ExprPtr visit(Expression* node);
-    ExprPtr visit(NumberLiteral* node);
-    ExprPtr visit(FloatLiteral* node);
-    ExprPtr visit(StringLiteral* node);
-    ExprPtr visit(CharLiteral* node);
-    ExprPtr visit(VariableAccess* node);
-    ExprPtr visit(UnaryOp* node);
-    ExprPtr visit(BinaryOp* node);
-    ExprPtr visit(FunctionCall* node);
-    ExprPtr visit(ConditionalExpression* node);
-    ExprPtr visit(Valof* node);
-    ExprPtr visit(VectorConstructor* node);
-    ExprPtr visit(VectorAccess* node);
+    const Statistics& getStatistics() const { return stats_; }
 
-    StmtPtr visit(Statement* node);
-    StmtPtr visit(RoutineCall* node);
-    StmtPtr visit(CompoundStatement* node);
-    StmtPtr visit(IfStatement* node);
-    StmtPtr visit(TestStatement* node);
-    StmtPtr visit(WhileStatement* node);
-    StmtPtr visit(ForStatement* node);
-    StmtPtr visit(GotoStatement* node);
-    StmtPtr visit(LabeledStatement* node);
-    StmtPtr visit(ReturnStatement* node);
-    StmtPtr visit(FinishStatement* node);
-    StmtPtr visit(ResultisStatement* node);
-    StmtPtr visit(RepeatStatement* node);
-    StmtPtr visit(SwitchonStatement* node);
-    StmtPtr visit(EndcaseStatement* node);
-    StmtPtr visit(DeclarationStatement* node);
+private:
+    friend class ASTMutator<DeadCodeEliminationPass>;
+    using ASTMutator<DeadCodeEliminationPass>::rewrite;
 
-    DeclPtr visit(Declaration* node);
-    DeclPtr visit(FunctionDeclaration* node);
-    ProgramPtr visit(Program* node);
+    LivenessAnalysisPass* livenessAnalysis;
+    Statistics stats_;
+    SymbolMap<uint32_t> mentions_; // Reads and writes of each name in the function being walked
 
-    // Key transformation logic
-    DeclPtr visit(LetDeclaration* node);
-    StmtPtr visit(Assignment* node);
+    // Statements keep their identity until they are replaced, so liveness
+    // answers for the ones not yet visited stay valid during a walk.
+    void rewrite(FunctionDeclaration* node);
+    StmtPtr rewrite(Assignment* node);
+    StmtPtr rewrite(DeclarationStatement* node);
+    StmtPtr rewrite(CompoundStatement* node);
 
-    // Other visitor declarations would follow the standard pattern...
+    void removeUnreachable(CompoundStatement* node);
 };
 
 #endif // DEAD_CODE_ELIMINATION_PASS_H
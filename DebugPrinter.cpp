@@ -55,9 +55,8 @@ std::string tokenTypeToString(TokenType type) {
     return "UnknownToken";
 }
 
-void DebugPrinter::printTokens(const std::string& source) {
-    Lexer& lexer = Lexer::getInstance();
-    lexer.init(source);
+void DebugPrinter::printTokens(std::string_view source) {
+    TokenStream tokens = Lexer::getInstance().tokenize(source);
 
     std::cout << "\n--- TOKEN STREAM ---" << std::endl;
     std::cout << std::left << std::setw(8) << "Line"
@@ -66,14 +65,12 @@ void DebugPrinter::printTokens(const std::string& source) {
               << "Text" << std::endl;
     std::cout << "-----------------------------------------------------" << std::endl;
 
-    Token token;
-    do {
-        token = lexer.getNextToken();
-        std::cout << std::left << std::setw(8) << token.line
-                  << std::setw(8) << token.col
-                  << std::setw(20) << tokenTypeToString(token.type)
-                  << "'" << token.text << "'" << std::endl;
-    } while (token.type != TokenType::Eof);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        std::cout << std::left << std::setw(8) << tokens.line(i)
+                  << std::setw(8) << tokens.col(i)
+                  << std::setw(20) << tokenTypeToString(tokens.type(i))
+                  << "'" << tokens.text(i) << "'" << std::endl;
+    }
     std::cout << "-----------------------------------------------------\n" << std::endl;
 }
 
@@ -92,38 +89,39 @@ void DebugPrinter::indent(int level) {
 // --- Visitor Dispatcher ---
 void DebugPrinter::visit(Node* node, int indent_level) {
     if (!node) return;
-    if (auto* n = dynamic_cast<Program*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<FunctionDeclaration*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<LetDeclaration*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<NumberLiteral*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<FloatLiteral*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<StringLiteral*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<CharLiteral*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<VariableAccess*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<UnaryOp*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<BinaryOp*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<FunctionCall*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<ConditionalExpression*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<Valof*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<Assignment*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<RoutineCall*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<CompoundStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<IfStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<TestStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<WhileStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<ForStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<GotoStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<LabeledStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<ReturnStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<FinishStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<ResultisStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<SwitchonStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<EndcaseStatement*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<VectorConstructor*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<VectorAccess*>(node)) visit(n, indent_level);
-    else if (auto* n = dynamic_cast<DeclarationStatement*>(node)) visit(n, indent_level);
-
-    else std::cout << "Unknown AST Node" << std::endl;
+    switch (node->kind()) {
+        case NodeKind::Program: visit(static_cast<Program*>(node), indent_level); break;
+        case NodeKind::FunctionDeclaration: visit(static_cast<FunctionDeclaration*>(node), indent_level); break;
+        case NodeKind::LetDeclaration: visit(static_cast<LetDeclaration*>(node), indent_level); break;
+        case NodeKind::NumberLiteral: visit(static_cast<NumberLiteral*>(node), indent_level); break;
+        case NodeKind::FloatLiteral: visit(static_cast<FloatLiteral*>(node), indent_level); break;
+        case NodeKind::StringLiteral: visit(static_cast<StringLiteral*>(node), indent_level); break;
+        case NodeKind::CharLiteral: visit(static_cast<CharLiteral*>(node), indent_level); break;
+        case NodeKind::VariableAccess: visit(static_cast<VariableAccess*>(node), indent_level); break;
+        case NodeKind::UnaryOp: visit(static_cast<UnaryOp*>(node), indent_level); break;
+        case NodeKind::BinaryOp: visit(static_cast<BinaryOp*>(node), indent_level); break;
+        case NodeKind::FunctionCall: visit(static_cast<FunctionCall*>(node), indent_level); break;
+        case NodeKind::ConditionalExpression: visit(static_cast<ConditionalExpression*>(node), indent_level); break;
+        case NodeKind::Valof: visit(static_cast<Valof*>(node), indent_level); break;
+        case NodeKind::Assignment: visit(static_cast<Assignment*>(node), indent_level); break;
+        case NodeKind::RoutineCall: visit(static_cast<RoutineCall*>(node), indent_level); break;
+        case NodeKind::CompoundStatement: visit(static_cast<CompoundStatement*>(node), indent_level); break;
+        case NodeKind::IfStatement: visit(static_cast<IfStatement*>(node), indent_level); break;
+        case NodeKind::TestStatement: visit(static_cast<TestStatement*>(node), indent_level); break;
+        case NodeKind::WhileStatement: visit(static_cast<WhileStatement*>(node), indent_level); break;
+        case NodeKind::ForStatement: visit(static_cast<ForStatement*>(node), indent_level); break;
+        case NodeKind::GotoStatement: visit(static_cast<GotoStatement*>(node), indent_level); break;
+        case NodeKind::LabeledStatement: visit(static_cast<LabeledStatement*>(node), indent_level); break;
+        case NodeKind::ReturnStatement: visit(static_cast<ReturnStatement*>(node), indent_level); break;
+        case NodeKind::FinishStatement: visit(static_cast<FinishStatement*>(node), indent_level); break;
+        case NodeKind::ResultisStatement: visit(static_cast<ResultisStatement*>(node), indent_level); break;
+        case NodeKind::SwitchonStatement: visit(static_cast<SwitchonStatement*>(node), indent_level); break;
+        case NodeKind::EndcaseStatement: visit(static_cast<EndcaseStatement*>(node), indent_level); break;
+        case NodeKind::VectorConstructor: visit(static_cast<VectorConstructor*>(node), indent_level); break;
+        case NodeKind::VectorAccess: visit(static_cast<VectorAccess*>(node), indent_level); break;
+        case NodeKind::DeclarationStatement: visit(static_cast<DeclarationStatement*>(node), indent_level); break;
+        default: std::cout << "Unknown AST Node" << std::endl;
+    }
 }
 
 // --- Specific Visitors ---
@@ -30,7 +30,7 @@ public:
      * @brief Prints all tokens from a given source string.
      * @param source The BCPL source code.
      */
-    void printTokens(const std::string& source);
+    void printTokens(std::string_view source);
 
     /**
      * @brief Prints the Abstract Syntax Tree in a structured, indented format.
@@ -11,6 +11,192 @@
 ExpressionCodeGenerator::ExpressionCodeGenerator(CodeGenerator& codeGenerator) : codeGen(codeGenerator) {
 }
 
+int ExpressionCodeGenerator::acquireCallTemp() {
+    // Temporaries are named by nesting depth so every function reuses the same slots
+    if (callTemps == static_cast<int>(callTempSymbols.size())) {
+        callTempSymbols.push_back(SymbolTable::getInstance().intern(".tmp" + std::to_string(callTemps)));
+    }
+    return codeGen.allocateLocal(callTempSymbols[callTemps++]);
+}
+
+void ExpressionCodeGenerator::releaseCallTemp() {
+    --callTemps;
+}
+
+// Condition code that holds after cmp lhs, rhs when the relation is true
+static bool relationalCondition(TokenType op, uint32_t& cond) {
+    switch (op) {
+        case TokenType::OpEq: cond = AArch64Instructions::EQ; return true;
+        case TokenType::OpNe: cond = AArch64Instructions::NE; return true;
+        case TokenType::OpLt: cond = AArch64Instructions::LT; return true;
+        case TokenType::OpGt: cond = AArch64Instructions::GT; return true;
+        case TokenType::OpLe: cond = AArch64Instructions::LE; return true;
+        case TokenType::OpGe: cond = AArch64Instructions::GE; return true;
+        default: return false;
+    }
+}
+
+// A literal that fits the 12-bit immediate of cmp
+static bool isCompareImmediate(const Expression* expr, int64_t& value) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        value = number->value;
+    } else if (auto character = nodeCast<CharLiteral>(expr)) {
+        value = character->value;
+    } else {
+        return false;
+    }
+    return value >= 0 && value <= 4095;
+}
+
+static bool isZero(const Expression* expr) {
+    int64_t value;
+    return isCompareImmediate(expr, value) && value == 0;
+}
+
+// True when expr always yields TRUE (-1) or FALSE (0), so that its bitwise
+// and logical combinations agree
+static bool isTruthValue(const Expression* expr) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        return number->value == 0 || number->value == -1;
+    }
+    if (auto binary = nodeCast<BinaryOp>(expr)) {
+        uint32_t cond;
+        if (relationalCondition(binary->op, cond)) {
+            return true;
+        }
+        return (binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+               isTruthValue(binary->left.get()) && isTruthValue(binary->right.get());
+    }
+    if (auto unary = nodeCast<UnaryOp>(expr)) {
+        return unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get());
+    }
+    return false;
+}
+
+uint32_t ExpressionCodeGenerator::evaluateOperands(const BinaryOp* node) {
+    // Evaluate LHS, result in X0
+    codeGen.visitExpression(node->left.get());
+
+    uint32_t lhs_reg;
+    if (LinearScanAllocator::containsCall(node->right.get())) {
+        // Scratch registers do not survive calls, so park the LHS in the frame
+        int tempOffset = acquireCallTemp();
+        codeGen.instructions.str(codeGen.X0, codeGen.X29, tempOffset, "Save LHS result across call");
+        codeGen.visitExpression(node->right.get());
+        lhs_reg = codeGen.scratchAllocator.acquire();
+        codeGen.instructions.ldr(lhs_reg, codeGen.X29, tempOffset, "Reload LHS result");
+        releaseCallTemp();
+    } else {
+        // *** FIX: Use the scratch allocator for temporary values ***
+        lhs_reg = codeGen.scratchAllocator.acquire();
+
+        // Move LHS result from X0 to the acquired scratch register
+        codeGen.instructions.mov(lhs_reg, codeGen.X0, "Save LHS result to scratch register");
+
+        // Evaluate RHS, result in X0
+        codeGen.visitExpression(node->right.get());
+    }
+    return lhs_reg;
+}
+
+uint32_t ExpressionCodeGenerator::emitComparison(const BinaryOp* node) {
+    uint32_t cond = AArch64Instructions::AL;
+    relationalCondition(node->op, cond);
+
+    int64_t value;
+    if (isCompareImmediate(node->right.get(), value)) {
+        codeGen.visitExpression(node->left.get());
+        codeGen.instructions.cmp_imm(codeGen.X0, static_cast<uint32_t>(value), "Compare with constant");
+        return cond;
+    }
+    if (isCompareImmediate(node->left.get(), value)) {
+        // k < E is E > k: swap the operands and mirror the condition
+        codeGen.visitExpression(node->right.get());
+        codeGen.instructions.cmp_imm(codeGen.X0, static_cast<uint32_t>(value), "Compare with constant");
+        switch (cond) {
+            case AArch64Instructions::LT: return AArch64Instructions::GT;
+            case AArch64Instructions::GT: return AArch64Instructions::LT;
+            case AArch64Instructions::LE: return AArch64Instructions::GE;
+            case AArch64Instructions::GE: return AArch64Instructions::LE;
+            default: return cond;
+        }
+    }
+
+    uint32_t lhs_reg = evaluateOperands(node);
+    codeGen.instructions.cmp(lhs_reg, codeGen.X0, "Compare");
+    codeGen.scratchAllocator.release(lhs_reg);
+    return cond;
+}
+
+void ExpressionCodeGenerator::generateCondition(const Expression* expr, bool branchIfTrue, LabelManager::Label target) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        if ((number->value != 0) == branchIfTrue) {
+            codeGen.instructions.b(target, "Constant condition");
+        }
+        return;
+    }
+
+    if (auto binary = nodeCast<BinaryOp>(expr)) {
+        uint32_t cond;
+        if (relationalCondition(binary->op, cond)) {
+            if (isZero(binary->right.get()) && (binary->op == TokenType::OpEq || binary->op == TokenType::OpNe)) {
+                codeGen.visitExpression(binary->left.get());
+                if ((binary->op == TokenType::OpEq) == branchIfTrue) {
+                    codeGen.instructions.cbz(codeGen.X0, target, "Branch if zero");
+                } else {
+                    codeGen.instructions.cbnz(codeGen.X0, target, "Branch if not zero");
+                }
+                return;
+            }
+            if (isZero(binary->right.get()) && (binary->op == TokenType::OpLt || binary->op == TokenType::OpGe)) {
+                // The sign bit alone decides a comparison with zero
+                codeGen.visitExpression(binary->left.get());
+                if ((binary->op == TokenType::OpLt) == branchIfTrue) {
+                    codeGen.instructions.tbnz(codeGen.X0, 63, target, "Branch if negative");
+                } else {
+                    codeGen.instructions.tbz(codeGen.X0, 63, target, "Branch if not negative");
+                }
+                return;
+            }
+            cond = emitComparison(binary);
+            codeGen.instructions.bcond(branchIfTrue ? cond : cond ^ 1, target);
+            return;
+        }
+
+        if ((binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+            isTruthValue(binary->left.get()) && isTruthValue(binary->right.get())) {
+            const bool isAnd = binary->op == TokenType::OpLogAnd;
+            if (isAnd != branchIfTrue) {
+                // Either operand decides alone: a false A & B, or a true A | B
+                generateCondition(binary->left.get(), branchIfTrue, target);
+                generateCondition(binary->right.get(), branchIfTrue, target);
+            } else {
+                // The LHS can only rule the branch out; the RHS then decides
+                auto skipLabel = codeGen.labelManager.generateLabel(isAnd ? "and_false" : "or_true");
+                generateCondition(binary->left.get(), !branchIfTrue, skipLabel);
+                generateCondition(binary->right.get(), branchIfTrue, target);
+                codeGen.instructions.setPendingLabel(skipLabel);
+            }
+            return;
+        }
+    }
+
+    if (auto unary = nodeCast<UnaryOp>(expr)) {
+        if (unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get())) {
+            generateCondition(unary->rhs.get(), !branchIfTrue, target);
+            return;
+        }
+    }
+
+    // Any other value is true when it is not zero
+    codeGen.visitExpression(expr);
+    if (branchIfTrue) {
+        codeGen.instructions.cbnz(codeGen.X0, target, "Branch if condition is true");
+    } else {
+        codeGen.instructions.cbz(codeGen.X0, target, "Branch if condition is false");
+    }
+}
+
 void ExpressionCodeGenerator::visitNumberLiteral(const NumberLiteral* node) {
     codeGen.instructions.loadImmediate(codeGen.X0, node->value, "Load number literal");
 }
@@ -27,29 +213,20 @@ void ExpressionCodeGenerator::visitStringLiteral(const StringLiteral* node) {
 
 void ExpressionCodeGenerator::visitVariableAccess(const VariableAccess* node) {
     // First, check for manifest constants
-    if (auto it = codeGen.manifestConstants.find(node->name); it != codeGen.manifestConstants.end()) {
-        codeGen.instructions.loadImmediate(codeGen.X0, it->second, "Load manifest constant " + node->name);
+    if (const int* value = codeGen.manifestConstants.find(node->symbol)) {
+        codeGen.instructions.loadImmediate(codeGen.X0, *value, [&] { return "Load manifest constant " + node->name; });
         return;
     }
 
     // Second, check for globals
-    if (auto it = codeGen.globals.find(node->name); it != codeGen.globals.end()) {
-        codeGen.instructions.ldr(codeGen.X0, codeGen.X28, it->second * 8, "Load global " + node->name);
+    if (const size_t* global = codeGen.globals.find(node->symbol)) {
+        codeGen.instructions.ldr(codeGen.X0, codeGen.X28, *global * 8, [&] { return "Load global " + node->name; });
         return;
     }
 
-    // Local variables - check if already in register
-    uint32_t reg = codeGen.registerManager.getVariableRegister(node->name);
-
-    if (reg != 0xFFFFFFFF) {
-        // Variable is in a register - generate register-to-register move
-        codeGen.instructions.mov(codeGen.X0, reg, "Move " + node->name + " from " + codeGen.instructions.regName(reg) + " to X0");
-    } else {
-        // Variable is not in register - load from stack
-        int offset = codeGen.getLocalOffset(node->name);
-        uint32_t new_reg = codeGen.registerManager.acquireRegister(node->name, offset);
-        codeGen.instructions.mov(codeGen.X0, new_reg, "Move " + node->name + " from " + codeGen.instructions.regName(new_reg) + " to X0");
-    }
+    // Local variables live in the register or stack slot chosen by the allocator
+    int offset = codeGen.getLocalOffset(node->symbol);
+    codeGen.registerManager.loadVariable(node->symbol, offset, codeGen.X0);
 }
 
 // Placeholder implementations for other expression visitor methods
@@ -58,19 +235,19 @@ void ExpressionCodeGenerator::visitUnaryOp(const UnaryOp* node) {
 
     switch (node->op) {
         case TokenType::OpLogNot:
-            codeGen.instructions.eor(codeGen.X0, codeGen.X0, 1, "Logical NOT");
+            codeGen.instructions.mvn(codeGen.X0, codeGen.X0, "Logical NOT");
             break;
         case TokenType::OpMinus:
             codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Arithmetic negation");
             break;
         case TokenType::OpAt:  // @ operator (address-of)
             // For variables, calculate address instead of loading value
-            if (auto var = dynamic_cast<const VariableAccess*>(node->rhs.get())) {
-                if (auto it = codeGen.globals.find(var->name); it != codeGen.globals.end()) {
-                    codeGen.instructions.add(codeGen.X0, codeGen.X28, it->second * 8, AArch64Instructions::LSL, 0, "Address of global " + var->name);
+            if (auto var = nodeCast<VariableAccess>(node->rhs.get())) {
+                if (const size_t* global = codeGen.globals.find(var->symbol)) {
+                    codeGen.instructions.add(codeGen.X0, codeGen.X28, *global * 8, AArch64Instructions::LSL, 0, [&] { return "Address of global " + var->name; });
                 } else {
-                    int offset = codeGen.getLocalOffset(var->name);
-                    codeGen.instructions.add(codeGen.X0, codeGen.X29, offset, AArch64Instructions::LSL, 0, "Address of local " + var->name);
+                    int offset = codeGen.getLocalOffset(var->symbol);
+                    codeGen.instructions.add(codeGen.X0, codeGen.X29, offset, AArch64Instructions::LSL, 0, [&] { return "Address of local " + var->name; });
                 }
             } else {
                 throw std::runtime_error("@ operator requires addressable operand");
@@ -86,22 +263,20 @@ void ExpressionCodeGenerator::visitUnaryOp(const UnaryOp* node) {
 
 
 void ExpressionCodeGenerator::visitBinaryOp(const BinaryOp* node) {
-    // Evaluate LHS, result in X0
-    codeGen.visitExpression(node->left.get());
-
-    // *** FIX: Use the scratch allocator for temporary values ***
-    uint32_t lhs_reg = codeGen.scratchAllocator.acquire();
-
-    // Move LHS result from X0 to the acquired scratch register
-    codeGen.instructions.mov(lhs_reg, codeGen.X0, "Save LHS result to scratch register");
+    // Comparisons (result -1 for true, 0 for false) come straight from the flags
+    uint32_t cond;
+    if (relationalCondition(node->op, cond)) {
+        cond = emitComparison(node);
+        codeGen.instructions.csetm(codeGen.X0, cond, [&] { return "TRUE (-1) if " + AArch64Instructions::conditionName(cond); });
+        return;
+    }
 
-    // Evaluate RHS, result in X0
-    codeGen.visitExpression(node->right.get());
+    uint32_t lhs_reg = evaluateOperands(node);
     uint32_t rhs_reg = codeGen.X0; // RHS result is in X0
 
     switch (node->op) {
         case TokenType::OpPlus:
-            codeGen.instructions.add(codeGen.X0, lhs_reg, rhs_reg, "Addition");
+            codeGen.instructions.add(codeGen.X0, lhs_reg, rhs_reg, AArch64Instructions::LSL, 0, "Addition");
             break;
         case TokenType::OpMinus:
             codeGen.instructions.sub(codeGen.X0, lhs_reg, rhs_reg, "Subtraction");
@@ -122,38 +297,6 @@ void ExpressionCodeGenerator::visitBinaryOp(const BinaryOp* node) {
             }
             break;
 
-        // Comparisons (result -1 for true, 0 for false)
-        case TokenType::OpEq:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for equality");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::EQ, "Set X0 if equal");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-        case TokenType::OpNe:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for inequality");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::NE, "Set X0 if not equal");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-        case TokenType::OpLt:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for less than");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::LT, "Set X0 if less than");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-        case TokenType::OpGt:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for greater than");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::GT, "Set X0 if greater than");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-        case TokenType::OpLe:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for less than or equal");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::LE, "Set X0 if less than or equal");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-        case TokenType::OpGe:
-            codeGen.instructions.cmp(lhs_reg, rhs_reg, "Compare for greater than or equal");
-            codeGen.instructions.cset(codeGen.X0, AArch64Instructions::GE, "Set X0 if greater than or equal");
-            codeGen.instructions.neg(codeGen.X0, codeGen.X0, "Convert 1 to -1 for true");
-            break;
-
         // Logical operations (bitwise)
         case TokenType::OpLogAnd:
             codeGen.instructions.and_op(codeGen.X0, lhs_reg, rhs_reg, "Bitwise AND");
@@ -175,6 +318,43 @@ void ExpressionCodeGenerator::visitBinaryOp(const BinaryOp* node) {
     codeGen.scratchAllocator.release(lhs_reg);
 }
 
+void ExpressionCodeGenerator::evaluateArguments(const std::vector<ExprPtr>& arguments) {
+    // Arguments are evaluated last first, so the lowest-numbered one that
+    // contains a call is the last call made. A register argument evaluated
+    // before it would be clobbered, so it waits in a frame temporary instead.
+    int lastCallingArg = -1;
+    for (int i = 0; i < (int)arguments.size(); ++i) {
+        if (LinearScanAllocator::containsCall(arguments[i].get())) {
+            lastCallingArg = i;
+            break;
+        }
+    }
+    std::vector<std::pair<uint32_t, int>> parkedArgs;
+
+    // Evaluate arguments and place them in registers or on the stack.
+    // Evaluate in reverse order to avoid overwriting argument registers.
+    for (int i = arguments.size() - 1; i >= 0; --i) {
+        codeGen.visitExpression(arguments[i].get()); // Result is in X0
+
+        if (i < 8 && lastCallingArg >= 0 && i > lastCallingArg) {
+            int tempOffset = acquireCallTemp();
+            codeGen.instructions.str(codeGen.X0, codeGen.X29, tempOffset, [&] { return "Park arg " + std::to_string(i) + " across call"; });
+            parkedArgs.emplace_back(codeGen.X0 + i, tempOffset);
+        } else if (i < 8) { // First 8 arguments go into registers X0-X7
+            codeGen.instructions.mov(codeGen.X0 + i, codeGen.X0, [&] { return "Move arg " + std::to_string(i) + " to X" + std::to_string(i); });
+        } else { // Arguments beyond the 8th go onto the stack
+            // Stack arguments are pushed in order, so calculate offset from the beginning of the allocated block.
+            size_t stack_offset_index = i - 8;
+            codeGen.instructions.str(codeGen.X0, codeGen.SP, stack_offset_index * 8, [&] { return "Store arg " + std::to_string(i) + " to stack"; });
+        }
+    }
+
+    for (auto it = parkedArgs.rbegin(); it != parkedArgs.rend(); ++it) {
+        codeGen.instructions.ldr(it->first, codeGen.X29, it->second, [&] { return "Load parked arg into X" + std::to_string(it->first); });
+        releaseCallTemp();
+    }
+}
+
 void ExpressionCodeGenerator::visitFunctionCall(const FunctionCall* node) {
     // Calculate the number of arguments that will be passed on the stack.
     size_t num_stack_args = 0;
@@ -182,8 +362,8 @@ void ExpressionCodeGenerator::visitFunctionCall(const FunctionCall* node) {
         num_stack_args = node->arguments.size() - 8;
     }
 
-    // Update maxOutgoingParamSpace based on actual stack arguments.
-    size_t currentCallParamBytes = num_stack_args * 8;
+    // Update maxOutgoingParamSpace based on actual stack arguments; SP stays 16-byte aligned.
+    size_t currentCallParamBytes = (num_stack_args * 8 + 15) & ~static_cast<size_t>(15);
     if (currentCallParamBytes > codeGen.maxOutgoingParamSpace) {
         codeGen.maxOutgoingParamSpace = currentCallParamBytes;
     }
@@ -192,28 +372,16 @@ void ExpressionCodeGenerator::visitFunctionCall(const FunctionCall* node) {
 
     // Allocate space for stack arguments if necessary.
     if (num_stack_args > 0) {
-        codeGen.instructions.sub(codeGen.SP, codeGen.SP, currentCallParamBytes, "Allocate space for outgoing arguments");
+        codeGen.instructions.sub_imm(codeGen.SP, codeGen.SP, currentCallParamBytes, "Allocate space for outgoing arguments");
     }
 
-    // Evaluate arguments and place them in registers or on the stack.
-    // Evaluate in reverse order to avoid overwriting argument registers.
-    for (int i = node->arguments.size() - 1; i >= 0; --i) {
-        codeGen.visitExpression(node->arguments[i].get()); // Result is in X0
-
-        if (i < 8) { // First 8 arguments go into registers X0-X7
-            codeGen.instructions.mov(codeGen.X0 + i, codeGen.X0, "Move arg " + std::to_string(i) + " to X" + std::to_string(i));
-        } else { // Arguments beyond the 8th go onto the stack
-            // Stack arguments are pushed in order, so calculate offset from the beginning of the allocated block.
-            size_t stack_offset_index = i - 8;
-            codeGen.instructions.str(codeGen.X0, codeGen.SP, stack_offset_index * 8, "Store arg " + std::to_string(i) + " to stack");
-        }
-    }
+    evaluateArguments(node->arguments);
 
     // Generate call
-    if (auto funcVar = dynamic_cast<const VariableAccess*>(node->function.get())) {
+    if (auto funcVar = nodeCast<VariableAccess>(node->function.get())) {
         // Direct function call
-        if (auto it = codeGen.functions.find(funcVar->name); it != codeGen.functions.end()) {
-            codeGen.instructions.bl(funcVar->name, "Call " + funcVar->name);
+        if (codeGen.functions.contains(funcVar->symbol)) {
+            codeGen.instructions.bl(funcVar->name, [&] { return "Call " + funcVar->name; });
         } else {
             throw std::runtime_error("Unknown function: " + funcVar->name);
         }
@@ -236,24 +404,18 @@ void ExpressionCodeGenerator::visitConditionalExpression(const ConditionalExpres
     auto endLabel = codeGen.labelManager.generateLabel("cond_end");
 
     // Evaluate the condition
-    codeGen.visitExpression(node->condition.get());
-    codeGen.instructions.cmp(codeGen.X0, 0);
-    codeGen.labelManager.requestLabelFixup(elseLabel, codeGen.instructions.getCurrentAddress());
-    codeGen.instructions.beq(elseLabel);
+    generateCondition(node->condition.get(), false, elseLabel);
 
     // If true, evaluate the 'then' expression
     codeGen.visitExpression(node->trueExpr.get());
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
     codeGen.instructions.b(endLabel);
 
     // If false, evaluate the 'else' expression
     codeGen.instructions.setPendingLabel(elseLabel);
-    codeGen.labelManager.defineLabel(elseLabel, codeGen.instructions.getCurrentAddress());
     codeGen.visitExpression(node->falseExpr.get());
 
     // Define the end label
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
 }
 
 void ExpressionCodeGenerator::visitValof(const Valof* node) {
@@ -36,8 +36,29 @@ public:
     void visitCharacterAccess(const CharacterAccess* node);
     void visitVectorAccess(const VectorAccess* node);
 
+    // Branches to target when the truth value of expr equals branchIfTrue and
+    // falls through otherwise. Comparisons branch on their own flags, and &
+    // and | between truth values short-circuit.
+    void generateCondition(const Expression* expr, bool branchIfTrue, LabelManager::Label target);
+
+    // Evaluates call arguments into X0-X7 and, beyond the eighth, the outgoing
+    // area at SP. No argument register is set until no nested call remains.
+    void evaluateArguments(const std::vector<ExprPtr>& arguments);
+
 private:
     CodeGenerator& codeGen;
+    int callTemps = 0; // Frame temporaries in use for values that must survive a call
+    std::vector<SymbolId> callTempSymbols; // Interned names of the temporaries, by depth
+
+    // Frame slot for a value held across a call, released in LIFO order
+    int acquireCallTemp();
+    void releaseCallTemp();
+
+    // Evaluates both operands: the LHS ends up in the returned scratch register, the RHS in X0
+    uint32_t evaluateOperands(const BinaryOp* node);
+
+    // Emits the compare for a relational operator and returns the condition that holds when it is true
+    uint32_t emitComparison(const BinaryOp* node);
 };
 
 #endif // EXPRESSIONCODEGENERATOR_H
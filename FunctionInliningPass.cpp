@@ -9,41 +9,10 @@ ProgramPtr FunctionInliningPass::apply(ProgramPtr program) {
     findInlinableFunctions(program.get());
 
     // Stage 2: Visit the AST and perform the inlining.
-    return visit(program.get());
-}
-
-ProgramPtr FunctionInliningPass::visit(Program* node) {
-    std::vector<DeclPtr> new_decls;
-    for (const auto& decl : node->declarations) {
-        if (DeclPtr optimized_decl = visit(decl.get())) {
-            new_decls.push_back(std::move(optimized_decl));
-        }
-    }
-    return std::make_unique<Program>(std::move(new_decls));
-}
-
-DeclPtr FunctionInliningPass::visit(Declaration* node) {
-    if (!node) return nullptr;
-    if (auto* n = dynamic_cast<FunctionDeclaration*>(node)) return visit(n);
-    return node->cloneDecl();
-}
-
-DeclPtr FunctionInliningPass::visit(FunctionDeclaration* node) {
-    auto new_body_stmt = node->body_stmt ? visit(node->body_stmt.get()) : nullptr;
-    auto new_body_expr = node->body_expr ? visit(node->body_expr.get()) : nullptr;
-    return std::make_unique<FunctionDeclaration>(node->name, node->params, std::move(new_body_expr), std::move(new_body_stmt));
-}
-
-ExprPtr FunctionInliningPass::visit(Expression* node) {
-    if (!node) return nullptr;
-    if (auto* n = dynamic_cast<FunctionCall*>(node)) return visit(n);
-    return node->cloneExpr();
-}
-
-StmtPtr FunctionInliningPass::visit(Statement* node) {
-    if (!node) return nullptr;
-    if (auto* n = dynamic_cast<CompoundStatement*>(node)) return visit(n);
-    return node->cloneStmt();
+    resetMutated();
+    mutate(program.get());
+    changed = hasMutated();
+    return program;
 }
 
 void FunctionInliningPass::findInlinableFunctions(Program* program) {
@@ -54,18 +23,18 @@ void FunctionInliningPass::findInlinableFunctions(Program* program) {
     // If so, add it to the 'inlinableFunctions' map.
 }
 
-ExprPtr FunctionInliningPass::visit(FunctionCall* node) {
+ExprPtr FunctionInliningPass::rewrite(FunctionCall* node) {
     // First, recursively optimize the arguments of the call.
-    // ...
+    mutateChildren(node);
 
-    auto* func_var = dynamic_cast<VariableAccess*>(node->function.get());
+    auto* func_var = nodeCast<VariableAccess>(node->function.get());
     if (!func_var) {
-        return node->cloneExpr(); // Cannot inline indirect function calls.
+        return nullptr; // Cannot inline indirect function calls.
     }
 
     auto it = inlinableFunctions.find(func_var->name);
     if (it == inlinableFunctions.end()) {
-        return node->cloneExpr(); // Not an inlinable function.
+        return nullptr; // Not an inlinable function.
     }
 
     const FunctionDeclaration* func_decl = it->second.declaration;
@@ -75,7 +44,7 @@ ExprPtr FunctionInliningPass::visit(FunctionCall* node) {
     //    LET param1 = arg1, param2 = arg2, ...
     std::vector<LetDeclaration::VarInit> param_bindings;
     for (size_t i = 0; i < func_decl->params.size(); ++i) {
-        param_bindings.push_back({func_decl->params[i], node->arguments[i]->cloneExpr()});
+        param_bindings.push_back({func_decl->params[i], std::move(node->arguments[i])});
     }
     auto let_decl = std::make_unique<LetDeclaration>(std::move(param_bindings));
 
@@ -84,20 +53,10 @@ ExprPtr FunctionInliningPass::visit(FunctionCall* node) {
 
     // 3. Create a CompoundStatement with the bindings and the body.
     std::vector<std::unique_ptr<Node>> new_block_stmts;
-    new_block_stmts.push_back(std::move(let_decl));
+    new_block_stmts.push_back(std::make_unique<DeclarationStatement>(std::move(let_decl)));
     new_block_stmts.push_back(std::move(inlined_body));
     auto new_block = std::make_unique<CompoundStatement>(std::move(new_block_stmts));
 
     // 4. Wrap the entire thing in a VALOF expression to replace the original FunctionCall.
     return std::make_unique<Valof>(std::move(new_block));
 }
-
-StmtPtr FunctionInliningPass::visit(CompoundStatement* node) {
-    std::vector<std::unique_ptr<Node>> new_stmts;
-    for (const auto& stmt : node->statements) {
-        if(auto new_stmt = visit(static_cast<Statement*>(stmt.get()))) {
-             new_stmts.push_back(std::move(new_stmt));
-        }
-    }
-    return std::make_unique<CompoundStatement>(std::move(new_stmts));
-}
\ No newline at end of file
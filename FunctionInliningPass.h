@@ -3,6 +3,7 @@
 
 #include "OptimizationPass.h"
 #include "AST.h"
+#include "ASTMutator.h"
 #include <map>
 #include <string>
 #include <memory>
@@ -17,27 +18,22 @@ struct InlinableFunction {
  * @class FunctionInliningPass
  * @brief Replaces calls to small, non-recursive functions with the function's body.
  */
-class FunctionInliningPass : public OptimizationPass {
+class FunctionInliningPass : public OptimizationPass, private ASTMutator<FunctionInliningPass> {
 public:
     ProgramPtr apply(ProgramPtr program) override;
     std::string getName() const override;
 
 private:
+    friend class ASTMutator<FunctionInliningPass>;
+    using ASTMutator<FunctionInliningPass>::rewrite;
+
     std::map<std::string, InlinableFunction> inlinableFunctions;
 
     // Stage 1: Analyze and find functions suitable for inlining.
     void findInlinableFunctions(Program* program);
 
-    // Stage 2: Transform the AST by inlining calls.
-    ProgramPtr visit(Program* node);
-    ExprPtr visit(Expression* node);
-    StmtPtr visit(Statement* node);
-    DeclPtr visit(Declaration* node);
-    DeclPtr visit(FunctionDeclaration* node);
-    StmtPtr visit(CompoundStatement* node);
-    // ... other visitors
-
-    ExprPtr visit(FunctionCall* node); // Core transformation logic here.
+    // Stage 2: Transform the AST in place by inlining calls.
+    ExprPtr rewrite(FunctionCall* node); // Core transformation logic here.
 };
 
 #endif // FUNCTION_INLINING_PASS_H
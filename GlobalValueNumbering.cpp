@@ -0,0 +1,163 @@
+#include "GlobalValueNumbering.h"
+#include <algorithm>
+#include <utility>
+
+bool GlobalValueNumbering::run(IRFunction& function) {
+    fn_ = &function;
+    available_.clear();
+    undo_.clear();
+    replacement_.assign(function.valueCount(), NoValue);
+    nextGeneration_ = 0;
+
+    const std::vector<BlockId> order = function.reversePostorder();
+    const std::vector<BlockId> idom = function.dominators();
+    std::vector<std::vector<BlockId>> children(function.blockCount());
+    for (BlockId b : order) {
+        if (idom[b] != NoBlock) children[idom[b]].push_back(b);
+    }
+
+    // Preorder over the dominator tree; each frame keeps the memory
+    // generation its block ended with, for a child it is the sole predecessor of
+    struct Frame {
+        BlockId block;
+        size_t nextChild;
+        size_t undoMark;
+        uint32_t generation;
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](BlockId block, uint32_t dominatorGeneration) {
+        const size_t mark = undo_.size();
+        generation_ = function.block(block).predecessors.size() == 1 ? dominatorGeneration : nextGeneration_++;
+        numberBlock(block);
+        stack.push_back({block, 0, mark, generation_});
+    };
+    enter(function.entry(), 0);
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.nextChild < children[frame.block].size()) {
+            const BlockId child = children[frame.block][frame.nextChild++];
+            enter(child, frame.generation);
+            continue;
+        }
+        leaveScope(frame.undoMark);
+        stack.pop_back();
+    }
+
+    // Phi operands on back edges were numbered after their phis were seen
+    bool changed = false;
+    for (ValueId v = 0; v < function.valueCount(); ++v) {
+        IRInst& inst = function.inst(v);
+        if (inst.isRemoved()) continue;
+        for (ValueId& operand : inst.operands) {
+            operand = resolve(operand);
+        }
+    }
+    for (ValueId v = 0; v < function.valueCount(); ++v) {
+        if (replacement_[v] != NoValue && !function.inst(v).isRemoved()) {
+            function.remove(v);
+            changed = true;
+        }
+    }
+    if (changed) {
+        function.removeDeadValues();
+    }
+    fn_ = nullptr;
+    return changed;
+}
+
+void GlobalValueNumbering::numberBlock(BlockId block) {
+    std::vector<ValueId> phis;
+    for (ValueId v : fn_->block(block).insts) {
+        IRInst& inst = fn_->inst(v);
+        for (ValueId& operand : inst.operands) {
+            operand = resolve(operand);
+        }
+
+        ValueId existing = NoValue;
+        switch (inst.op) {
+            case IROp::Phi:
+                for (ValueId phi : phis) {
+                    if (fn_->inst(phi).operands.size() == inst.operands.size() &&
+                        std::equal(inst.operands.begin(), inst.operands.end(), fn_->inst(phi).operands.begin())) {
+                        existing = phi;
+                        break;
+                    }
+                }
+                if (existing != NoValue) {
+                    ++stats_.phis;
+                } else {
+                    phis.push_back(v);
+                }
+                break;
+            case IROp::Load:
+                existing = findOrAdd({IROp::Load, generation_, inst.operands[0], NoValue}, v);
+                if (existing != NoValue) ++stats_.loads;
+                break;
+            case IROp::Store:
+                // Nothing known about memory survives a store, except what it stored
+                generation_ = nextGeneration_++;
+                define({IROp::Load, generation_, inst.operands[0], NoValue}, inst.operands[1]);
+                break;
+            case IROp::Call:
+                generation_ = nextGeneration_++;
+                break;
+            default:
+                if (inst.isPure()) {
+                    existing = findOrAdd(keyOf(inst), v);
+                    if (existing != NoValue) ++stats_.values;
+                }
+                break;
+        }
+        if (existing != NoValue) {
+            replacement_[v] = existing;
+        }
+    }
+}
+
+ValueId GlobalValueNumbering::resolve(ValueId value) const {
+    while (replacement_[value] != NoValue) {
+        value = replacement_[value];
+    }
+    return value;
+}
+
+GlobalValueNumbering::Key GlobalValueNumbering::keyOf(const IRInst& inst) const {
+    Key key{inst.op, inst.imm, NoValue, NoValue};
+    if (!inst.operands.empty()) key.lhs = inst.operands[0];
+    if (inst.operands.size() > 1) key.rhs = inst.operands[1];
+
+    if (inst.op == IROp::Gt || inst.op == IROp::Ge) {
+        key.op = inst.op == IROp::Gt ? IROp::Lt : IROp::Le;
+        std::swap(key.lhs, key.rhs);
+    } else if (inst.isCommutative() && key.lhs > key.rhs) {
+        std::swap(key.lhs, key.rhs);
+    }
+    return key;
+}
+
+ValueId GlobalValueNumbering::findOrAdd(const Key& key, ValueId value) {
+    auto inserted = available_.emplace(key, value);
+    if (!inserted.second) {
+        return inserted.first->second;
+    }
+    undo_.push_back({key, NoValue});
+    return NoValue;
+}
+
+void GlobalValueNumbering::define(const Key& key, ValueId value) {
+    auto it = available_.find(key);
+    undo_.push_back({key, it == available_.end() ? NoValue : it->second});
+    available_[key] = value;
+}
+
+void GlobalValueNumbering::leaveScope(size_t mark) {
+    while (undo_.size() > mark) {
+        const Undo& entry = undo_.back();
+        if (entry.previous == NoValue) {
+            available_.erase(entry.key);
+        } else {
+            available_[entry.key] = entry.previous;
+        }
+        undo_.pop_back();
+    }
+}
@@ -0,0 +1,86 @@
+// GlobalValueNumbering.h
+#ifndef GLOBAL_VALUE_NUMBERING_H
+#define GLOBAL_VALUE_NUMBERING_H
+
+#include "IR.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class GlobalValueNumbering
+ * @brief Replaces each IR value computed again where an equal one is available.
+ *
+ * The dominator tree is walked in preorder with a scoped hash table keyed on
+ * (operation, operands), so a value is reused wherever its first computation
+ * dominates it, across statements and loop bodies alike. Operands of
+ * commutative operations are ordered, and > and >= are keyed as the mirrored
+ * < and <=, so I*N and N*I, or A < B and B > A, share a number.
+ *
+ * Locals are SSA values, so assignments need no invalidation of their own.
+ * Memory is versioned instead: every store through `!`, `%` or to a global,
+ * and every call, starts a new generation, and a load is only reused within
+ * the generation it was made in. A block inherits its dominator's generation
+ * only when the dominator is its sole predecessor. A store also makes its
+ * value available to later loads of the same address.
+ */
+class GlobalValueNumbering {
+public:
+    struct Statistics {
+        size_t values = 0;  // Pure values replaced by a dominating equal one
+        size_t loads = 0;   // Loads replaced by an earlier load or the value stored
+        size_t phis = 0;    // Phis replaced by an identical phi in the same block
+    };
+
+    /// Numbers @p function in place; returns true if it removed anything.
+    bool run(IRFunction& function);
+
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    struct Key {
+        IROp op;
+        int64_t imm;       // The constant of a leaf; the memory generation of a load
+        ValueId lhs;
+        ValueId rhs;
+
+        bool operator==(const Key& other) const {
+            return op == other.op && imm == other.imm && lhs == other.lhs && rhs == other.rhs;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t hash = std::hash<int64_t>()(key.imm);
+            hash = hash * 31 + static_cast<size_t>(key.op);
+            hash = hash * 31 + key.lhs;
+            hash = hash * 31 + key.rhs;
+            return hash;
+        }
+    };
+
+    // Entries a scope shadowed or added, restored when the walk leaves it
+    struct Undo {
+        Key key;
+        ValueId previous;
+    };
+
+    Statistics stats_;
+    IRFunction* fn_ = nullptr;
+    std::unordered_map<Key, ValueId, KeyHash> available_;
+    std::vector<Undo> undo_;
+    std::vector<ValueId> replacement_;
+    uint32_t generation_ = 0;
+    uint32_t nextGeneration_ = 0;
+
+    void numberBlock(BlockId block);
+    ValueId resolve(ValueId value) const;
+    Key keyOf(const IRInst& inst) const;
+    ValueId findOrAdd(const Key& key, ValueId value);
+    void define(const Key& key, ValueId value);
+    void leaveScope(size_t mark);
+};
+
+#endif // GLOBAL_VALUE_NUMBERING_H
@@ -0,0 +1,86 @@
+// GraphOrder.h
+#ifndef GRAPH_ORDER_H
+#define GRAPH_ORDER_H
+
+#include "BasicBlock.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * Orders shared by the graphs whose nodes are dense indices: the statement
+ * CFG (ControlFlowGraph) and the SSA IR (IRFunction).
+ */
+
+// Numbers the nodes reachable from root in reverse postorder, following
+// edges(node) with an explicit stack. index[node] gets the node's position.
+template <typename Edges>
+inline void numberReversePostorder(uint32_t root, size_t nodes, Edges edges,
+                      std::vector<uint32_t>& order, std::vector<uint32_t>& index) {
+    index.assign(nodes, NoBlock);
+    order.clear();
+
+    std::vector<std::pair<uint32_t, uint32_t>> stack; // Node, next edge to follow
+    std::vector<bool> seen(nodes, false);
+    seen[root] = true;
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+        auto& [node, next] = stack.back();
+        const auto& out = edges(node);
+        if (next < out.size()) {
+            uint32_t succ = out[next++];
+            if (!seen[succ]) {
+                seen[succ] = true;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            order.push_back(node);
+            stack.pop_back();
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        index[order[i]] = i;
+    }
+}
+
+// Cooper, Harvey and Kennedy's iterative dominator algorithm. order is a
+// reverse postorder from its first node, which dominates itself; idom is
+// filled for every ordered node and NoBlock for the rest.
+template <typename Edges>
+inline void computeDominators(const std::vector<uint32_t>& order, const std::vector<uint32_t>& index,
+                Edges predecessors, std::vector<uint32_t>& idom) {
+    idom.assign(index.size(), NoBlock);
+    if (order.empty()) return;
+    const uint32_t root = order[0];
+    idom[root] = root;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (index[a] > index[b]) a = idom[a];
+            while (index[b] > index[a]) b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            const uint32_t node = order[i];
+            uint32_t newIdom = NoBlock;
+            for (uint32_t pred : predecessors(node)) {
+                if (index[pred] == NoBlock || idom[pred] == NoBlock) continue;
+                newIdom = newIdom == NoBlock ? pred : intersect(pred, newIdom);
+            }
+            if (idom[node] != newIdom) {
+                idom[node] = newIdom;
+                changed = true;
+            }
+        }
+    }
+}
+
+#endif // GRAPH_ORDER_H
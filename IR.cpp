@@ -0,0 +1,495 @@
+#include "IR.h"
+#include "GraphOrder.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+const char* irOpName(IROp op) {
+    switch (op) {
+        case IROp::Const:      return "const";
+        case IROp::Arg:        return "arg";
+        case IROp::StringAddr: return "string";
+        case IROp::GlobalAddr: return "global";
+        case IROp::Phi:        return "phi";
+        case IROp::Neg:        return "neg";
+        case IROp::Not:        return "not";
+        case IROp::Add:        return "add";
+        case IROp::Sub:        return "sub";
+        case IROp::Mul:        return "mul";
+        case IROp::Div:        return "div";
+        case IROp::Rem:        return "rem";
+        case IROp::And:        return "and";
+        case IROp::Or:         return "or";
+        case IROp::Shl:        return "shl";
+        case IROp::Shr:        return "shr";
+        case IROp::Eq:         return "eq";
+        case IROp::Ne:         return "ne";
+        case IROp::Lt:         return "lt";
+        case IROp::Gt:         return "gt";
+        case IROp::Le:         return "le";
+        case IROp::Ge:         return "ge";
+        case IROp::Load:       return "load";
+        case IROp::Store:      return "store";
+        case IROp::Call:       return "call";
+        case IROp::Jump:       return "jump";
+        case IROp::Branch:     return "branch";
+        case IROp::Switch:     return "switch";
+        case IROp::Return:     return "return";
+    }
+    return "?";
+}
+
+IRFunction::IRFunction(std::string name, SymbolId symbol, size_t paramCount)
+    : name(std::move(name)), symbol(symbol), paramCount(paramCount) {
+    createBlock();
+}
+
+BlockId IRFunction::createBlock() {
+    const BlockId id = static_cast<BlockId>(blocks_.size());
+    blocks_.emplace_back(id);
+    return id;
+}
+
+void IRFunction::addEdge(BlockId from, BlockId to) {
+    blocks_[from].successors.push_back(to);
+    blocks_[to].predecessors.push_back(from);
+}
+
+ValueId IRFunction::newInst(BlockId block, IROp op, std::initializer_list<ValueId> operands, int64_t imm) {
+    IRInst inst;
+    inst.op = op;
+    inst.block = block;
+    inst.imm = imm;
+    for (ValueId operand : operands) {
+        inst.operands.push_back(operand);
+    }
+    insts_.push_back(inst);
+    return static_cast<ValueId>(insts_.size() - 1);
+}
+
+ValueId IRFunction::append(BlockId block, IROp op, std::initializer_list<ValueId> operands, int64_t imm) {
+    const ValueId id = newInst(block, op, operands, imm);
+    blocks_[block].insts.push_back(id);
+    return id;
+}
+
+ValueId IRFunction::insertBeforeTerminator(BlockId block, IROp op, std::initializer_list<ValueId> operands, int64_t imm) {
+    std::vector<ValueId>& insts = blocks_[block].insts;
+    if (terminator(block) == NoValue) {
+        return append(block, op, operands, imm);
+    }
+    const ValueId id = newInst(block, op, operands, imm);
+    insts.insert(insts.end() - 1, id);
+    return id;
+}
+
+ValueId IRFunction::addPhi(BlockId block) {
+    const ValueId id = newInst(block, IROp::Phi, {}, 0);
+    std::vector<ValueId>& insts = blocks_[block].insts;
+    auto firstNonPhi = std::find_if(insts.begin(), insts.end(),
+                                    [this](ValueId v) { return insts_[v].op != IROp::Phi; });
+    insts.insert(firstNonPhi, id);
+    return id;
+}
+
+ValueId IRFunction::constant(int64_t value) {
+    auto it = constants_.find(value);
+    if (it != constants_.end()) {
+        return it->second;
+    }
+    const ValueId id = insertBeforeTerminator(entry(), IROp::Const, {}, value);
+    constants_.emplace(value, id);
+    return id;
+}
+
+ValueId IRFunction::terminator(BlockId block) const {
+    const std::vector<ValueId>& insts = blocks_[block].insts;
+    if (insts.empty() || !insts_[insts.back()].isTerminator()) {
+        return NoValue;
+    }
+    return insts.back();
+}
+
+void IRFunction::foldTerminator(BlockId block, BlockId target) {
+    // The target's phis keep the operands of the first edge from the block
+    IRBlock& next = blocks_[target];
+    const size_t kept = std::find(next.predecessors.begin(), next.predecessors.end(), block) - next.predecessors.begin();
+    std::vector<ValueId> operands;
+    for (ValueId id : next.insts) {
+        if (insts_[id].op != IROp::Phi) break;
+        operands.push_back(insts_[id].operands[kept]);
+    }
+
+    const std::vector<BlockId> successors(blocks_[block].successors.begin(), blocks_[block].successors.end());
+    for (BlockId succ : successors) {
+        removeEdge(block, succ);
+    }
+    addEdge(block, target);
+    for (size_t i = 0; i < operands.size(); ++i) {
+        insts_[next.insts[i]].operands.push_back(operands[i]);
+    }
+
+    IRInst& inst = insts_[terminator(block)];
+    inst.op = IROp::Jump;
+    inst.operands.clear();
+    inst.imm = 0;
+}
+
+void IRFunction::remove(ValueId id) {
+    IRInst& inst = insts_[id];
+    if (inst.isRemoved()) return;
+    std::vector<ValueId>& insts = blocks_[inst.block].insts;
+    insts.erase(std::find(insts.begin(), insts.end(), id));
+    if (inst.op == IROp::Const) {
+        constants_.erase(inst.imm);
+    }
+    inst.block = NoBlock;
+}
+
+void IRFunction::replaceAllUses(ValueId from, ValueId to) {
+    for (IRInst& inst : insts_) {
+        if (inst.isRemoved()) continue;
+        for (ValueId& operand : inst.operands) {
+            if (operand == from) operand = to;
+        }
+    }
+}
+
+std::vector<uint32_t> IRFunction::useCounts() const {
+    std::vector<uint32_t> counts(insts_.size(), 0);
+    for (const IRInst& inst : insts_) {
+        if (inst.isRemoved()) continue;
+        for (ValueId operand : inst.operands) {
+            ++counts[operand];
+        }
+    }
+    return counts;
+}
+
+std::vector<BlockId> IRFunction::reversePostorder() const {
+    // Successors are followed last first, so that a block's first successor
+    // comes right after it: the fall-through of a branch and a loop body
+    // directly after its entry test
+    std::vector<std::vector<BlockId>> edges(blocks_.size());
+    for (const IRBlock& block : blocks_) {
+        edges[block.id].assign(block.successors.begin(), block.successors.end());
+        std::reverse(edges[block.id].begin(), edges[block.id].end());
+    }
+    std::vector<BlockId> order;
+    std::vector<uint32_t> index;
+    numberReversePostorder(entry(), blocks_.size(),
+                           [&](uint32_t b) -> const std::vector<BlockId>& { return edges[b]; }, order, index);
+    return order;
+}
+
+std::vector<BlockId> IRFunction::dominators() const {
+    std::vector<BlockId> order;
+    std::vector<uint32_t> index;
+    numberReversePostorder(entry(), blocks_.size(),
+                           [this](uint32_t b) -> const SmallVector<BlockId, 2>& { return blocks_[b].successors; },
+                           order, index);
+    std::vector<BlockId> idom;
+    computeDominators(order, index,
+                      [this](uint32_t b) -> const SmallVector<BlockId, 2>& { return blocks_[b].predecessors; }, idom);
+    idom[entry()] = NoBlock;
+    return idom;
+}
+
+void IRFunction::removeEdge(BlockId from, BlockId to) {
+    IRBlock& source = blocks_[from];
+    SmallVector<BlockId, 2> successors;
+    for (BlockId succ : source.successors) {
+        if (succ != to) successors.push_back(succ);
+    }
+    source.successors = successors;
+
+    // The phis of the target lose the operand of the edge
+    IRBlock& target = blocks_[to];
+    SmallVector<BlockId, 2> predecessors;
+    std::vector<bool> keep;
+    for (BlockId pred : target.predecessors) {
+        keep.push_back(pred != from);
+        if (pred != from) predecessors.push_back(pred);
+    }
+    target.predecessors = predecessors;
+    for (ValueId id : target.insts) {
+        IRInst& phi = insts_[id];
+        if (phi.op != IROp::Phi) break;
+        SmallVector<ValueId, 2> operands;
+        for (size_t i = 0; i < phi.operands.size(); ++i) {
+            if (keep[i]) operands.push_back(phi.operands[i]);
+        }
+        phi.operands = operands;
+    }
+}
+
+bool IRFunction::removeUnreachableBlocks() {
+    std::vector<bool> reachable(blocks_.size(), false);
+    for (BlockId b : reversePostorder()) {
+        reachable[b] = true;
+    }
+
+    bool changed = false;
+    for (IRBlock& block : blocks_) {
+        if (reachable[block.id] || (block.insts.empty() && block.successors.empty())) continue;
+        const std::vector<BlockId> successors(block.successors.begin(), block.successors.end());
+        for (BlockId succ : successors) {
+            removeEdge(block.id, succ);
+        }
+        for (ValueId id : block.insts) {
+            if (insts_[id].op == IROp::Const) constants_.erase(insts_[id].imm);
+            insts_[id].block = NoBlock;
+        }
+        block.insts.clear();
+        block.predecessors.clear();
+        changed = true;
+    }
+    return changed;
+}
+
+bool IRFunction::removeTrivialPhis() {
+    // Replacements are chained through phis found trivial in earlier sweeps
+    std::vector<ValueId> replacement(insts_.size(), NoValue);
+    auto resolve = [&replacement](ValueId v) {
+        while (replacement[v] != NoValue) v = replacement[v];
+        return v;
+    };
+
+    bool found = false;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IRInst& phi : insts_) {
+            if (phi.isRemoved() || phi.op != IROp::Phi) continue;
+            const ValueId self = static_cast<ValueId>(&phi - insts_.data());
+            if (replacement[self] != NoValue) continue;
+            ValueId same = NoValue;
+            bool trivial = true;
+            for (ValueId operand : phi.operands) {
+                operand = resolve(operand);
+                if (operand == self || operand == same) continue;
+                if (same != NoValue) {
+                    trivial = false;
+                    break;
+                }
+                same = operand;
+            }
+            if (!trivial) continue;
+            // A phi that only merges itself is never given a value
+            replacement[self] = same != NoValue ? same : constant(0);
+            changed = found = true;
+        }
+    }
+    if (!found) return false;
+
+    for (IRInst& inst : insts_) {
+        if (inst.isRemoved()) continue;
+        for (ValueId& operand : inst.operands) {
+            operand = resolve(operand);
+        }
+    }
+    for (ValueId v = 0; v < replacement.size(); ++v) {
+        if (replacement[v] != NoValue) remove(v);
+    }
+    return true;
+}
+
+bool IRFunction::splitCriticalEdges() {
+    bool changed = false;
+    const size_t count = blocks_.size();
+    for (BlockId from = 0; from < count; ++from) {
+        if (blocks_[from].successors.size() < 2) continue;
+        for (size_t s = 0; s < blocks_[from].successors.size(); ++s) {
+            const BlockId to = blocks_[from].successors[s];
+            if (blocks_[to].predecessors.size() < 2) continue;
+
+            // The new block takes the place of each end of the edge, so
+            // successor and phi operand positions are unchanged
+            const BlockId middle = createBlock();
+            append(middle, IROp::Jump);
+            blocks_[from].successors[s] = middle;
+            for (BlockId& pred : blocks_[to].predecessors) {
+                if (pred == from) {
+                    pred = middle;
+                    break;
+                }
+            }
+            blocks_[middle].predecessors.push_back(from);
+            blocks_[middle].successors.push_back(to);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool IRFunction::removeDeadValues() {
+    // Mark from the instructions with effects back through their operands,
+    // so cycles of phis that only feed each other are dropped too
+    std::vector<bool> live(insts_.size(), false);
+    std::vector<ValueId> worklist;
+    for (ValueId v = 0; v < insts_.size(); ++v) {
+        if (!insts_[v].isRemoved() && !insts_[v].isPure()) {
+            live[v] = true;
+            worklist.push_back(v);
+        }
+    }
+    while (!worklist.empty()) {
+        const ValueId v = worklist.back();
+        worklist.pop_back();
+        for (ValueId operand : insts_[v].operands) {
+            if (!live[operand]) {
+                live[operand] = true;
+                worklist.push_back(operand);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (ValueId v = 0; v < insts_.size(); ++v) {
+        if (!live[v] && !insts_[v].isRemoved()) {
+            remove(v);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+namespace {
+
+size_t expectedSuccessors(const IRFunction& function, const IRInst& inst) {
+    switch (inst.op) {
+        case IROp::Jump:   return 1;
+        case IROp::Branch: return 2;
+        case IROp::Switch: return function.switchCases[inst.imm].size() + 1;
+        default:           return 0;
+    }
+}
+
+} // namespace
+
+void IRFunction::verify() const {
+    auto fail = [this](const std::string& message) {
+        throw std::runtime_error("IR of " + name + ": " + message);
+    };
+
+    const std::vector<BlockId> order = reversePostorder();
+    const std::vector<BlockId> idom = dominators();
+    std::vector<bool> reachable(blocks_.size(), false);
+    for (BlockId b : order) reachable[b] = true;
+
+    // Position of each instruction in its block, for dominance within a block
+    std::vector<uint32_t> position(insts_.size(), 0);
+    for (BlockId b : order) {
+        for (uint32_t i = 0; i < blocks_[b].insts.size(); ++i) {
+            position[blocks_[b].insts[i]] = i;
+        }
+    }
+    auto dominates = [&](BlockId a, BlockId b) {
+        for (; b != NoBlock; b = idom[b]) {
+            if (a == b) return true;
+        }
+        return false;
+    };
+
+    for (BlockId b : order) {
+        const IRBlock& block = blocks_[b];
+        const ValueId term = terminator(b);
+        if (term == NoValue) fail("bb" + std::to_string(b) + " has no terminator");
+        if (block.successors.size() != expectedSuccessors(*this, insts_[term])) {
+            fail("bb" + std::to_string(b) + " has the wrong number of successors");
+        }
+        for (BlockId succ : block.successors) {
+            if (!blocks_[succ].predecessors.contains(b)) fail("edge bb" + std::to_string(b) + " -> bb" + std::to_string(succ) + " is one-sided");
+        }
+
+        bool phisDone = false;
+        for (ValueId id : block.insts) {
+            const IRInst& inst = insts_[id];
+            const std::string where = "%" + std::to_string(id) + " in bb" + std::to_string(b);
+            if (inst.block != b) fail(where + " names the wrong block");
+            if (inst.isTerminator() && id != term) fail(where + " is a terminator before the end");
+            if (inst.op == IROp::Phi) {
+                if (phisDone) fail(where + " is a phi after other instructions");
+                if (inst.operands.size() != block.predecessors.size()) fail(where + " does not match the predecessors");
+            } else {
+                phisDone = true;
+            }
+
+            for (size_t i = 0; i < inst.operands.size(); ++i) {
+                const ValueId operand = inst.operands[i];
+                if (operand >= insts_.size() || insts_[operand].isRemoved()) {
+                    fail(where + " uses a removed value");
+                }
+                const IRInst& def = insts_[operand];
+                if (def.op >= IROp::Store && def.op != IROp::Call) fail(where + " uses an instruction without a value");
+                // A phi operand must be available at the end of its predecessor
+                const BlockId useBlock = inst.op == IROp::Phi ? block.predecessors[i] : b;
+                const bool available = def.block == useBlock
+                    ? (inst.op == IROp::Phi || position[operand] < position[id])
+                    : dominates(def.block, useBlock);
+                if (reachable[useBlock] && !available) fail(where + " uses %" + std::to_string(operand) + " where it is not defined");
+            }
+        }
+    }
+}
+
+std::string IRFunction::toString() const {
+    std::ostringstream out;
+    out << "function " << name << "(" << paramCount << ")" << (returnsValue ? " =" : " BE") << "\n";
+    for (BlockId b : reversePostorder()) {
+        const IRBlock& block = blocks_[b];
+        out << "bb" << b << ":";
+        if (!block.predecessors.empty()) {
+            out << " ; preds";
+            for (size_t i = 0; i < block.predecessors.size(); ++i) {
+                out << (i ? ", " : " ") << "bb" << block.predecessors[i];
+            }
+        }
+        out << "\n";
+
+        for (ValueId id : block.insts) {
+            const IRInst& inst = insts_[id];
+            out << "  ";
+            if (!inst.isTerminator() && inst.op != IROp::Store) {
+                out << "%" << id << " = ";
+            }
+            out << irOpName(inst.op);
+            switch (inst.op) {
+                case IROp::Const:
+                case IROp::Arg:
+                case IROp::GlobalAddr:
+                    out << " " << inst.imm;
+                    break;
+                case IROp::StringAddr:
+                    out << " \"" << strings[inst.imm] << "\"";
+                    break;
+                case IROp::Call:
+                    out << " " << SymbolTable::getInstance().name(inst.callee);
+                    break;
+                default:
+                    break;
+            }
+            for (size_t i = 0; i < inst.operands.size(); ++i) {
+                out << (i ? ", " : " ");
+                if (inst.op == IROp::Phi) {
+                    out << "[%" << inst.operands[i] << ", bb" << block.predecessors[i] << "]";
+                } else {
+                    out << "%" << inst.operands[i];
+                }
+            }
+            if (inst.op == IROp::Switch) {
+                out << " default bb" << block.successors[0];
+                const std::vector<int64_t>& cases = switchCases[inst.imm];
+                for (size_t i = 0; i < cases.size(); ++i) {
+                    out << ", " << cases[i] << ": bb" << block.successors[i + 1];
+                }
+            } else if (inst.isTerminator()) {
+                for (size_t i = 0; i < block.successors.size(); ++i) {
+                    out << (i || !inst.operands.empty() ? ", " : " ") << "bb" << block.successors[i];
+                }
+            }
+            out << "\n";
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,186 @@
+// IR.h
+#ifndef IR_H
+#define IR_H
+
+#include "BasicBlock.h"
+#include "SmallVector.h"
+#include "SymbolTable.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Index of an instruction, and of the value it defines, within its IRFunction.
+using ValueId = uint32_t;
+constexpr ValueId NoValue = 0xFFFFFFFF;
+
+/**
+ * Operations of the mid-level IR. Every value is a machine word; relations
+ * yield TRUE (-1) or FALSE (0) as in BCPL.
+ */
+enum class IROp : uint8_t {
+    // Values without operands
+    Const,       // imm: the value; one per distinct value, in the entry block
+    Arg,         // imm: index of the parameter
+    StringAddr,  // imm: index into IRFunction::strings
+    GlobalAddr,  // imm: slot of the global
+    Phi,         // One operand per predecessor, in the order of IRBlock::predecessors
+
+    // Arithmetic and logic
+    Neg, Not,
+    Add, Sub, Mul, Div, Rem, And, Or, Shl, Shr,
+
+    // Relations
+    Eq, Ne, Lt, Gt, Le, Ge,
+
+    // Memory: words addressed by byte; `!` and `%` compute the address explicitly
+    Load,        // operands: address
+    Store,       // operands: address, value
+    Call,        // callee: label called; operands: arguments
+
+    // Terminators, the last instruction of every block
+    Jump,        // To successors[0]
+    Branch,      // operands: condition; to successors[0] if it is non-zero, else successors[1]
+    Switch,      // operands: value; imm: index into IRFunction::switchCases;
+                 // successors[0] is the default and successors[i + 1] takes case i
+    Return,      // operands: the result, if any
+};
+
+const char* irOpName(IROp op);
+
+/// One instruction, and the value it defines if it has one.
+struct IRInst {
+    IROp op = IROp::Const;
+    BlockId block = NoBlock;            // Block holding it; NoBlock once removed
+    int64_t imm = 0;
+    SymbolId callee = SymbolTable::NoSymbol;
+    SmallVector<ValueId, 2> operands;
+
+    bool isTerminator() const { return op >= IROp::Jump; }
+    bool isRemoved() const { return block == NoBlock; }
+
+    /// True if it has no effect beyond its value, so it may be dropped when unused.
+    bool isPure() const { return op < IROp::Load || op == IROp::Load; }
+
+    /// True for the values the selector rebuilds at each use instead of keeping in a register.
+    bool isRematerializable() const {
+        return op == IROp::Const || op == IROp::StringAddr || op == IROp::GlobalAddr;
+    }
+
+    bool isCommutative() const {
+        return op == IROp::Add || op == IROp::Mul || op == IROp::And || op == IROp::Or ||
+               op == IROp::Eq || op == IROp::Ne;
+    }
+
+    bool isRelation() const { return op >= IROp::Eq && op <= IROp::Ge; }
+};
+
+/// A basic block: phis first, then ordinary instructions, then one terminator.
+struct IRBlock {
+    BlockId id;
+    std::vector<ValueId> insts;
+    SmallVector<BlockId, 2> predecessors;
+    SmallVector<BlockId, 2> successors;
+
+    explicit IRBlock(BlockId block_id) : id(block_id) {}
+};
+
+/**
+ * @class IRFunction
+ * @brief One BCPL function in SSA form.
+ *
+ * Blocks and instructions live in two arenas and refer to each other by
+ * BlockId and ValueId, like ControlFlowGraph. Block 0 is the entry; it holds
+ * the parameters and constants and jumps to the body. Removed instructions
+ * keep their IDs, with block set to NoBlock, so IDs stay stable across passes.
+ */
+class IRFunction {
+public:
+    IRFunction(std::string name, SymbolId symbol, size_t paramCount);
+
+    std::string name;
+    SymbolId symbol;           // Label of the function
+    size_t paramCount;
+    bool returnsValue = false; // A function (=) rather than a routine (BE)
+
+    std::vector<std::string> strings;                  // String literals, for StringAddr
+    std::vector<std::vector<int64_t>> switchCases;     // Case values, for Switch
+
+    // --- Blocks ---
+
+    BlockId entry() const { return 0; }
+    size_t blockCount() const { return blocks_.size(); }
+    IRBlock& block(BlockId id) { return blocks_[id]; }
+    const IRBlock& block(BlockId id) const { return blocks_[id]; }
+
+    BlockId createBlock();
+    void addEdge(BlockId from, BlockId to);
+
+    // --- Instructions ---
+
+    size_t valueCount() const { return insts_.size(); }
+    IRInst& inst(ValueId id) { return insts_[id]; }
+    const IRInst& inst(ValueId id) const { return insts_[id]; }
+
+    /// Appends an instruction to the end of @p block.
+    ValueId append(BlockId block, IROp op, std::initializer_list<ValueId> operands = {}, int64_t imm = 0);
+
+    /// Inserts an instruction into @p block just before its terminator.
+    ValueId insertBeforeTerminator(BlockId block, IROp op, std::initializer_list<ValueId> operands = {}, int64_t imm = 0);
+
+    /// Adds an empty phi at the top of @p block; its operands are pushed by the caller.
+    ValueId addPhi(BlockId block);
+
+    /// The constant @p value, created in the entry block on first use.
+    ValueId constant(int64_t value);
+
+    /// The terminator of @p block, or NoValue while it has none.
+    ValueId terminator(BlockId block) const;
+
+    /// Turns the branch or switch ending @p block into a jump to @p target, one of its successors.
+    void foldTerminator(BlockId block, BlockId target);
+
+    /// Takes @p id out of its block; its uses must already be gone.
+    void remove(ValueId id);
+
+    /// Makes every operand that names @p from name @p to instead.
+    void replaceAllUses(ValueId from, ValueId to);
+
+    /// Number of operands naming each value, indexed by ValueId.
+    std::vector<uint32_t> useCounts() const;
+
+    // --- Whole-function transforms ---
+
+    /// Blocks reachable from the entry, in reverse postorder.
+    std::vector<BlockId> reversePostorder() const;
+
+    /// Immediate dominators indexed by BlockId; NoBlock for the entry and unreachable blocks.
+    std::vector<BlockId> dominators() const;
+
+    /// Drops blocks the entry cannot reach, with their edges and phi operands.
+    bool removeUnreachableBlocks();
+
+    /// Replaces each phi whose operands are all one value (or the phi itself) by that value.
+    bool removeTrivialPhis();
+
+    /// Puts a new block on every edge from a block with several successors to one with several predecessors.
+    bool splitCriticalEdges();
+
+    /// Drops pure instructions whose values are never used.
+    bool removeDeadValues();
+
+    /// Checks the SSA invariants; throws std::runtime_error naming the first one broken.
+    void verify() const;
+
+    std::string toString() const;
+
+private:
+    std::vector<IRBlock> blocks_;
+    std::vector<IRInst> insts_;
+    std::unordered_map<int64_t, ValueId> constants_;
+
+    ValueId newInst(BlockId block, IROp op, std::initializer_list<ValueId> operands, int64_t imm);
+    void removeEdge(BlockId from, BlockId to);
+};
+
+#endif // IR_H
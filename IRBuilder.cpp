@@ -0,0 +1,772 @@
+#include "IRBuilder.h"
+#include "LoopOptimizer.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Thrown by IRBuilder::unsupported and caught by build(); never escapes it
+class UnsupportedConstruct : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+bool relationOp(TokenType op, IROp& result) {
+    switch (op) {
+        case TokenType::OpEq: result = IROp::Eq; return true;
+        case TokenType::OpNe: result = IROp::Ne; return true;
+        case TokenType::OpLt: result = IROp::Lt; return true;
+        case TokenType::OpGt: result = IROp::Gt; return true;
+        case TokenType::OpLe: result = IROp::Le; return true;
+        case TokenType::OpGe: result = IROp::Ge; return true;
+        default: return false;
+    }
+}
+
+bool arithmeticOp(TokenType op, IROp& result) {
+    switch (op) {
+        case TokenType::OpPlus:      result = IROp::Add; return true;
+        case TokenType::OpMinus:     result = IROp::Sub; return true;
+        case TokenType::OpMultiply:  result = IROp::Mul; return true;
+        case TokenType::OpDivide:    result = IROp::Div; return true;
+        case TokenType::OpRemainder: result = IROp::Rem; return true;
+        case TokenType::OpLogAnd:    result = IROp::And; return true;
+        case TokenType::OpLogOr:     result = IROp::Or; return true;
+        case TokenType::OpLshift:    result = IROp::Shl; return true;
+        case TokenType::OpRshift:    result = IROp::Shr; return true;
+        default: return false;
+    }
+}
+
+// True when expr always yields TRUE (-1) or FALSE (0), so that & and | may
+// short-circuit; the same test as the AST code generator's
+bool isTruthValue(const Expression* expr) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        return number->value == 0 || number->value == -1;
+    }
+    if (auto binary = nodeCast<BinaryOp>(expr)) {
+        IROp op;
+        if (relationOp(binary->op, op)) {
+            return true;
+        }
+        return (binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+               isTruthValue(binary->left.get()) && isTruthValue(binary->right.get());
+    }
+    if (auto unary = nodeCast<UnaryOp>(expr)) {
+        return unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get());
+    }
+    return false;
+}
+
+} // namespace
+
+IRBuilder::IRBuilder(Environment environment) : env_(std::move(environment)) {
+}
+
+void IRBuilder::unsupported(const std::string& what) const {
+    throw UnsupportedConstruct(what);
+}
+
+std::unique_ptr<IRFunction> IRBuilder::build(const FunctionDeclaration* function) {
+    SymbolTable& symbols = SymbolTable::getInstance();
+    auto result = std::make_unique<IRFunction>(function->name, symbols.intern(function->name), function->params.size());
+    fn_ = result.get();
+    unsupportedReason_.clear();
+    defs_.assign(1, {});
+    sealed_.assign(1, true);
+    incompletePhis_.assign(1, {});
+    locals_.clear();
+    variableCount_ = 0;
+    targets_.clear();
+    valofs_.clear();
+
+    try {
+        if (function->params.size() > 8) {
+            unsupported("more than eight parameters");
+        }
+
+        // The entry block takes the parameters and jumps to the body
+        continueIn(fn_->entry());
+        for (size_t i = 0; i < function->params.size(); ++i) {
+            const uint32_t param = declareLocal(symbols.intern(function->params[i]));
+            writeVariable(param, fn_->entry(), emit(IROp::Arg, {}, static_cast<int64_t>(i)));
+        }
+        const BlockId body = newBlock();
+        jumpTo(body);
+        sealBlock(body);
+        continueIn(body);
+
+        if (function->body_expr) {
+            fn_->returnsValue = true;
+            if (auto valof = nodeCast<Valof>(function->body_expr.get())) {
+                // RESULTIS in the function's own VALOF returns directly
+                valofs_.push_back({true, 0, NoBlock});
+                lowerStatement(valof->body.get());
+                valofs_.pop_back();
+                if (isReachable()) {
+                    returnValue(fn_->constant(0));
+                }
+            } else {
+                returnValue(lowerExpression(function->body_expr.get()));
+            }
+        } else {
+            lowerStatement(function->body_stmt.get());
+            if (isReachable()) {
+                returnValue(NoValue);
+            }
+        }
+    } catch (const UnsupportedConstruct& e) {
+        unsupportedReason_ = e.what();
+        fn_ = nullptr;
+        return nullptr;
+    }
+    fn_ = nullptr;
+
+    result->removeUnreachableBlocks();
+    result->removeTrivialPhis();
+    result->removeDeadValues();
+    result->verify();
+    return result;
+}
+
+// --- Blocks and SSA variables ---
+
+BlockId IRBuilder::newBlock() {
+    const BlockId block = fn_->createBlock();
+    defs_.emplace_back();
+    sealed_.push_back(false);
+    incompletePhis_.emplace_back();
+    return block;
+}
+
+void IRBuilder::sealBlock(BlockId block) {
+    // Completing a phi may read through other blocks, so take the list first
+    std::vector<std::pair<uint32_t, ValueId>> pending = std::move(incompletePhis_[block]);
+    incompletePhis_[block].clear();
+    sealed_[block] = true;
+    for (const auto& [variable, phi] : pending) {
+        addPhiOperands(variable, phi);
+    }
+}
+
+uint32_t IRBuilder::newVariable() {
+    return variableCount_++;
+}
+
+uint32_t IRBuilder::declareLocal(SymbolId symbol) {
+    // Like the AST code generator, a name declared again reuses its variable
+    if (const uint32_t* variable = locals_.find(symbol)) {
+        return *variable;
+    }
+    const uint32_t variable = newVariable();
+    locals_[symbol] = variable;
+    return variable;
+}
+
+void IRBuilder::writeVariable(uint32_t variable, BlockId block, ValueId value) {
+    std::vector<ValueId>& defs = defs_[block];
+    if (defs.size() <= variable) {
+        defs.resize(variableCount_, NoValue);
+    }
+    defs[variable] = value;
+}
+
+ValueId IRBuilder::readVariable(uint32_t variable, BlockId block) {
+    const std::vector<ValueId>& defs = defs_[block];
+    if (variable < defs.size() && defs[variable] != NoValue) {
+        return defs[variable];
+    }
+    return readVariableRecursive(variable, block);
+}
+
+ValueId IRBuilder::readVariableRecursive(uint32_t variable, BlockId block) {
+    const IRBlock& irBlock = fn_->block(block);
+    ValueId value;
+    if (!sealed_[block]) {
+        value = fn_->addPhi(block);
+        incompletePhis_[block].emplace_back(variable, value);
+    } else if (irBlock.predecessors.size() == 1) {
+        value = readVariable(variable, irBlock.predecessors[0]);
+    } else if (irBlock.predecessors.empty()) {
+        // Read before any assignment, or in code that cannot be reached
+        value = fn_->constant(0);
+    } else {
+        // Written first so that a loop back to this block finds the phi
+        value = fn_->addPhi(block);
+        writeVariable(variable, block, value);
+        addPhiOperands(variable, value);
+    }
+    writeVariable(variable, block, value);
+    return value;
+}
+
+void IRBuilder::addPhiOperands(uint32_t variable, ValueId phi) {
+    const BlockId block = fn_->inst(phi).block;
+    const size_t count = fn_->block(block).predecessors.size();
+    for (size_t i = 0; i < count; ++i) {
+        // Reading may add instructions, so the phi is looked up again each time
+        const ValueId operand = readVariable(variable, fn_->block(block).predecessors[i]);
+        fn_->inst(phi).operands.push_back(operand);
+    }
+}
+
+// --- Emission into the current block ---
+
+ValueId IRBuilder::emit(IROp op, std::initializer_list<ValueId> operands, int64_t imm) {
+    return fn_->append(current_, op, operands, imm);
+}
+
+ValueId IRBuilder::call(SymbolId callee, const std::vector<ValueId>& arguments) {
+    const ValueId result = emit(IROp::Call);
+    IRInst& inst = fn_->inst(result);
+    inst.callee = callee;
+    for (ValueId argument : arguments) {
+        inst.operands.push_back(argument);
+    }
+    return result;
+}
+
+ValueId IRBuilder::elementAddress(ValueId base, ValueId index, int64_t shift) {
+    const IRInst& indexInst = fn_->inst(index);
+    if (indexInst.op == IROp::Const) {
+        const int64_t offset = indexInst.imm << shift;
+        return offset == 0 ? base : emit(IROp::Add, {base, fn_->constant(offset)});
+    }
+    return emit(IROp::Add, {base, emit(IROp::Shl, {index, fn_->constant(shift)})});
+}
+
+bool IRBuilder::isReachable() const {
+    return current_ == fn_->entry() || !fn_->block(current_).predecessors.empty();
+}
+
+void IRBuilder::continueUnreachable() {
+    // Code after a jump goes into a block without predecessors, dropped at the end
+    current_ = newBlock();
+    sealed_[current_] = true;
+}
+
+void IRBuilder::jumpTo(BlockId target) {
+    emit(IROp::Jump);
+    fn_->addEdge(current_, target);
+    continueUnreachable();
+}
+
+void IRBuilder::branch(ValueId condition, BlockId ifTrue, BlockId ifFalse) {
+    emit(IROp::Branch, {condition});
+    fn_->addEdge(current_, ifTrue);
+    fn_->addEdge(current_, ifFalse);
+    continueUnreachable();
+}
+
+void IRBuilder::returnValue(ValueId value) {
+    if (value == NoValue) {
+        emit(IROp::Return);
+    } else {
+        emit(IROp::Return, {value});
+    }
+    continueUnreachable();
+}
+
+// --- Statements ---
+
+void IRBuilder::lowerStatement(const Node* node) {
+    if (!node) return;
+    switch (node->kind()) {
+        case NodeKind::CompoundStatement:
+            for (const auto& statement : static_cast<const CompoundStatement*>(node)->statements) {
+                lowerStatement(statement.get());
+            }
+            break;
+        case NodeKind::DeclarationStatement:
+            lowerDeclaration(static_cast<const DeclarationStatement*>(node)->declaration.get());
+            break;
+        case NodeKind::Assignment:
+            lowerAssignment(static_cast<const Assignment*>(node));
+            break;
+        case NodeKind::RoutineCall:
+            lowerRoutineCall(static_cast<const RoutineCall*>(node));
+            break;
+        case NodeKind::IfStatement: {
+            auto ifStmt = static_cast<const IfStatement*>(node);
+            const BlockId then = newBlock();
+            const BlockId end = newBlock();
+            lowerCondition(ifStmt->condition.get(), then, end);
+            sealBlock(then);
+            continueIn(then);
+            lowerStatement(ifStmt->then_statement.get());
+            if (isReachable()) jumpTo(end);
+            sealBlock(end);
+            continueIn(end);
+            break;
+        }
+        case NodeKind::TestStatement: {
+            auto test = static_cast<const TestStatement*>(node);
+            const BlockId then = newBlock();
+            const BlockId otherwise = newBlock();
+            const BlockId end = newBlock();
+            lowerCondition(test->condition.get(), then, otherwise);
+            sealBlock(then);
+            sealBlock(otherwise);
+            continueIn(then);
+            lowerStatement(test->then_statement.get());
+            if (isReachable()) jumpTo(end);
+            continueIn(otherwise);
+            lowerStatement(test->else_statement.get());
+            if (isReachable()) jumpTo(end);
+            sealBlock(end);
+            continueIn(end);
+            break;
+        }
+        case NodeKind::WhileStatement:
+            lowerWhile(static_cast<const WhileStatement*>(node));
+            break;
+        case NodeKind::ForStatement:
+            lowerFor(static_cast<const ForStatement*>(node));
+            break;
+        case NodeKind::RepeatStatement:
+            lowerRepeat(static_cast<const RepeatStatement*>(node));
+            break;
+        case NodeKind::SwitchonStatement:
+            lowerSwitchon(static_cast<const SwitchonStatement*>(node));
+            break;
+        case NodeKind::ResultisStatement:
+            lowerResultis(static_cast<const ResultisStatement*>(node));
+            break;
+        case NodeKind::ReturnStatement:
+            returnValue(NoValue);
+            break;
+        case NodeKind::BreakStatement:
+        case NodeKind::FinishStatement:
+            // Both leave the innermost loop or SWITCHON, or else the function
+            if (targets_.empty()) {
+                returnValue(NoValue);
+            } else {
+                jumpTo(targets_.back().exit);
+            }
+            break;
+        case NodeKind::LoopStatement: {
+            auto loop = std::find_if(targets_.rbegin(), targets_.rend(), [](const JumpTargets& t) { return !t.isSwitch; });
+            if (loop == targets_.rend()) {
+                unsupported("LOOP outside a loop");
+            }
+            jumpTo(loop->next);
+            break;
+        }
+        case NodeKind::EndcaseStatement: {
+            auto switchon = std::find_if(targets_.rbegin(), targets_.rend(), [](const JumpTargets& t) { return t.isSwitch; });
+            if (switchon == targets_.rend()) {
+                unsupported("ENDCASE outside a SWITCHON");
+            }
+            jumpTo(switchon->exit);
+            break;
+        }
+        case NodeKind::GotoStatement:
+        case NodeKind::LabeledStatement:
+            unsupported("GOTO and labels");
+        default:
+            if (auto declaration = nodeCast<Declaration>(node)) {
+                lowerDeclaration(declaration);
+            }
+            break;
+    }
+}
+
+void IRBuilder::lowerDeclaration(const Declaration* node) {
+    auto let = nodeCast<LetDeclaration>(node);
+    if (!let) {
+        unsupported("nested declarations");
+    }
+    for (const auto& init : let->initializers) {
+        const ValueId value = init.init ? lowerExpression(init.init.get()) : fn_->constant(0);
+        writeVariable(declareLocal(SymbolTable::getInstance().intern(init.name)), current_, value);
+    }
+}
+
+void IRBuilder::lowerAssignment(const Assignment* node) {
+    if (node->lhs.size() != node->rhs.size()) {
+        unsupported("assignment with unequal sides");
+    }
+
+    // All the values are found before any is stored
+    std::vector<ValueId> values;
+    for (const auto& rhs : node->rhs) {
+        values.push_back(lowerExpression(rhs.get()));
+    }
+
+    for (size_t i = 0; i < node->lhs.size(); ++i) {
+        const Expression* target = node->lhs[i].get();
+        ValueId address;
+        if (auto var = nodeCast<VariableAccess>(target)) {
+            if (env_.manifests->contains(var->symbol)) {
+                unsupported("assignment to a manifest constant");
+            }
+            if (const size_t* global = env_.globals->find(var->symbol)) {
+                address = emit(IROp::GlobalAddr, {}, static_cast<int64_t>(*global));
+            } else if (const uint32_t* local = findLocal(var)) {
+                writeVariable(*local, current_, values[i]);
+                continue;
+            } else {
+                unsupported("assignment to undeclared " + var->name);
+            }
+        } else if (auto vector = nodeCast<VectorAccess>(target)) {
+            const ValueId index = lowerExpression(vector->index.get());
+            address = elementAddress(lowerExpression(vector->vector.get()), index, 3);
+        } else if (auto character = nodeCast<CharacterAccess>(target)) {
+            const ValueId index = lowerExpression(character->index.get());
+            address = elementAddress(lowerExpression(character->string.get()), index, 2);
+        } else if (auto deref = nodeCast<DereferenceExpr>(target)) {
+            address = lowerExpression(deref->pointer.get());
+        } else if (auto unary = nodeCast<UnaryOp>(target); unary && unary->op == TokenType::OpBang) {
+            address = lowerExpression(unary->rhs.get());
+        } else {
+            unsupported("assignment to this kind of expression");
+        }
+        emit(IROp::Store, {address, values[i]});
+    }
+}
+
+void IRBuilder::lowerRoutineCall(const RoutineCall* node) {
+    auto call = nodeCast<FunctionCall>(node->call_expression.get());
+    auto callee = call ? nodeCast<VariableAccess>(call->function.get()) : nullptr;
+    if (!callee) {
+        unsupported("indirect routine calls");
+    }
+
+    // The output routines map onto the runtime the way the AST code generator maps them
+    SymbolTable& symbols = SymbolTable::getInstance();
+    if (callee->name == "WRITES" || callee->name == "WRITEN") {
+        if (call->arguments.empty()) {
+            unsupported(callee->name + " without an argument");
+        }
+        const ValueId argument = lowerExpression(call->arguments[0].get());
+        this->call(symbols.intern(callee->name == "WRITES" ? "writes" : "writen"), {argument});
+    } else if (callee->name == "NEWLINE") {
+        this->call(symbols.intern("newline"), {});
+    } else if (callee->name == "FINISH") {
+        this->call(symbols.intern("finish"), {});
+    } else if (callee->name == "WRITEF") {
+        unsupported("WRITEF");
+    } else {
+        if (!env_.isFunction(callee->symbol)) {
+            unsupported("call of unknown routine " + callee->name);
+        }
+        this->call(callee->symbol, lowerArguments(call->arguments, false));
+    }
+}
+
+void IRBuilder::lowerWhile(const WhileStatement* node) {
+    // The test is copied above the loop and to its bottom
+    const BlockId body = newBlock();
+    const BlockId test = newBlock();
+    const BlockId exit = newBlock();
+    lowerCondition(node->condition.get(), body, exit);
+
+    targets_.push_back({false, exit, test});
+    continueIn(body);
+    lowerStatement(node->body.get());
+    if (isReachable()) jumpTo(test);
+    targets_.pop_back();
+
+    sealBlock(test);
+    continueIn(test);
+    lowerCondition(node->condition.get(), body, exit);
+    sealBlock(body);
+    sealBlock(exit);
+    continueIn(exit);
+}
+
+void IRBuilder::lowerFor(const ForStatement* node) {
+    // The limit and step are found once, before the loop, as in the AST code generator
+    const ValueId from = lowerExpression(node->from_expr.get());
+    const uint32_t var = declareLocal(SymbolTable::getInstance().intern(node->var_name));
+    writeVariable(var, current_, from);
+    const ValueId limit = lowerExpression(node->to_expr.get());
+    int64_t constantStep = 0;
+    const bool isConstantStep = LoopOptimizer::constantForStep(node, constantStep);
+    const ValueId step = isConstantStep ? fn_->constant(constantStep) : lowerExpression(node->by_expr.get());
+
+    // The loop runs while the variable has not passed the limit; only a
+    // constant negative step counts down
+    const IROp keepGoing = isConstantStep && constantStep < 0 ? IROp::Ge : IROp::Le;
+
+    const BlockId body = newBlock();
+    const BlockId next = newBlock();
+    const BlockId exit = newBlock();
+    branch(emit(keepGoing, {readVariable(var, current_), limit}), body, exit);
+
+    targets_.push_back({false, exit, next});
+    continueIn(body);
+    lowerStatement(node->body.get());
+    if (isReachable()) jumpTo(next);
+    targets_.pop_back();
+
+    sealBlock(next);
+    continueIn(next);
+    const ValueId incremented = emit(IROp::Add, {readVariable(var, next), step});
+    writeVariable(var, next, incremented);
+    branch(emit(keepGoing, {incremented, limit}), body, exit);
+    sealBlock(body);
+    sealBlock(exit);
+    continueIn(exit);
+}
+
+void IRBuilder::lowerRepeat(const RepeatStatement* node) {
+    const BlockId body = newBlock();
+    const bool hasTest = node->loopType != RepeatStatement::LoopType::repeat;
+    const BlockId test = hasTest ? newBlock() : body;
+    const BlockId exit = newBlock();
+    jumpTo(body);
+
+    targets_.push_back({false, exit, test});
+    continueIn(body);
+    lowerStatement(node->body.get());
+    if (isReachable()) jumpTo(test);
+    targets_.pop_back();
+
+    if (hasTest) {
+        sealBlock(test);
+        continueIn(test);
+        if (node->loopType == RepeatStatement::LoopType::repeatwhile) {
+            lowerCondition(node->condition.get(), body, exit);
+        } else {
+            lowerCondition(node->condition.get(), exit, body);
+        }
+    }
+    sealBlock(body);
+    sealBlock(exit);
+    continueIn(exit);
+}
+
+void IRBuilder::lowerSwitchon(const SwitchonStatement* node) {
+    const ValueId value = lowerExpression(node->expression.get());
+    const BlockId dispatch = current_;
+    const BlockId end = newBlock();
+    const BlockId defaultBlock = node->default_case ? newBlock() : end;
+
+    // Sorted unique values, the first case of several equal ones winning;
+    // the others are unreachable
+    std::vector<BlockId> caseBlocks;
+    std::vector<std::pair<int64_t, BlockId>> targets;
+    for (const auto& switchCase : node->cases) {
+        caseBlocks.push_back(newBlock());
+        targets.emplace_back(switchCase.value, caseBlocks.back());
+    }
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    targets.erase(std::unique(targets.begin(), targets.end(),
+                              [](const auto& a, const auto& b) { return a.first == b.first; }),
+                  targets.end());
+
+    std::vector<int64_t> values;
+    emit(IROp::Switch, {value}, static_cast<int64_t>(fn_->switchCases.size()));
+    fn_->addEdge(dispatch, defaultBlock);
+    for (const auto& [caseValue, block] : targets) {
+        values.push_back(caseValue);
+        fn_->addEdge(dispatch, block);
+    }
+    fn_->switchCases.push_back(std::move(values));
+
+    // Every case body, and the default, ends at the end of the switch
+    targets_.push_back({true, end, NoBlock});
+    for (size_t i = 0; i < node->cases.size(); ++i) {
+        sealBlock(caseBlocks[i]);
+        continueIn(caseBlocks[i]);
+        lowerStatement(node->cases[i].statement.get());
+        if (isReachable()) jumpTo(end);
+    }
+    if (node->default_case) {
+        sealBlock(defaultBlock);
+        continueIn(defaultBlock);
+        lowerStatement(node->default_case.get());
+        if (isReachable()) jumpTo(end);
+    }
+    targets_.pop_back();
+
+    sealBlock(end);
+    continueIn(end);
+}
+
+void IRBuilder::lowerResultis(const ResultisStatement* node) {
+    const ValueId value = lowerExpression(node->value.get());
+    if (valofs_.empty() || valofs_.back().returns) {
+        returnValue(value);
+        return;
+    }
+    writeVariable(valofs_.back().variable, current_, value);
+    jumpTo(valofs_.back().join);
+}
+
+void IRBuilder::lowerCondition(const Expression* expr, BlockId ifTrue, BlockId ifFalse) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        jumpTo(number->value != 0 ? ifTrue : ifFalse);
+        return;
+    }
+
+    if (auto binary = nodeCast<BinaryOp>(expr)) {
+        if ((binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+            isTruthValue(binary->left.get()) && isTruthValue(binary->right.get())) {
+            // The RHS is only tested when the LHS does not decide
+            const BlockId rhs = newBlock();
+            if (binary->op == TokenType::OpLogAnd) {
+                lowerCondition(binary->left.get(), rhs, ifFalse);
+            } else {
+                lowerCondition(binary->left.get(), ifTrue, rhs);
+            }
+            sealBlock(rhs);
+            continueIn(rhs);
+            lowerCondition(binary->right.get(), ifTrue, ifFalse);
+            return;
+        }
+    }
+
+    if (auto unary = nodeCast<UnaryOp>(expr)) {
+        if (unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get())) {
+            lowerCondition(unary->rhs.get(), ifFalse, ifTrue);
+            return;
+        }
+    }
+
+    // Any other value is true when it is not zero
+    branch(lowerExpression(expr), ifTrue, ifFalse);
+}
+
+// --- Expressions ---
+
+ValueId IRBuilder::lowerExpression(const Expression* expr) {
+    switch (expr->kind()) {
+        case NodeKind::NumberLiteral:
+            return fn_->constant(static_cast<const NumberLiteral*>(expr)->value);
+        case NodeKind::CharLiteral:
+            return fn_->constant(static_cast<const CharLiteral*>(expr)->value);
+        case NodeKind::StringLiteral:
+            fn_->strings.push_back(static_cast<const StringLiteral*>(expr)->value);
+            return emit(IROp::StringAddr, {}, static_cast<int64_t>(fn_->strings.size() - 1));
+        case NodeKind::VariableAccess: {
+            // Manifest constants first, then globals, then locals
+            auto var = static_cast<const VariableAccess*>(expr);
+            if (const int* value = env_.manifests->find(var->symbol)) {
+                return fn_->constant(*value);
+            }
+            if (const size_t* global = env_.globals->find(var->symbol)) {
+                return emit(IROp::Load, {emit(IROp::GlobalAddr, {}, static_cast<int64_t>(*global))});
+            }
+            if (const uint32_t* local = findLocal(var)) {
+                return readVariable(*local, current_);
+            }
+            unsupported(env_.isFunction(var->symbol) ? "function " + var->name + " used as a value"
+                                                     : "undeclared " + var->name);
+        }
+        case NodeKind::UnaryOp: {
+            auto unary = static_cast<const UnaryOp*>(expr);
+            if (unary->op == TokenType::OpAt) {
+                auto var = nodeCast<VariableAccess>(unary->rhs.get());
+                const size_t* global = var ? env_.globals->find(var->symbol) : nullptr;
+                if (!global) {
+                    unsupported("@ of anything but a global");
+                }
+                return emit(IROp::GlobalAddr, {}, static_cast<int64_t>(*global));
+            }
+            const ValueId operand = lowerExpression(unary->rhs.get());
+            switch (unary->op) {
+                case TokenType::OpLogNot: return emit(IROp::Not, {operand});
+                case TokenType::OpMinus:  return emit(IROp::Neg, {operand});
+                case TokenType::OpBang:   return emit(IROp::Load, {operand});
+                default: unsupported("unary " + Token::tokenTypeToString(unary->op));
+            }
+        }
+        case NodeKind::BinaryOp:
+            return lowerBinaryOp(static_cast<const BinaryOp*>(expr));
+        case NodeKind::FunctionCall:
+            return lowerCall(static_cast<const FunctionCall*>(expr));
+        case NodeKind::ConditionalExpression:
+            return lowerConditional(static_cast<const ConditionalExpression*>(expr));
+        case NodeKind::Valof:
+            return lowerValof(static_cast<const Valof*>(expr));
+        case NodeKind::VectorConstructor: {
+            const ValueId size = lowerExpression(static_cast<const VectorConstructor*>(expr)->size.get());
+            return call(SymbolTable::getInstance().intern("bcpl_vec"), {size});
+        }
+        case NodeKind::DereferenceExpr:
+            return emit(IROp::Load, {lowerExpression(static_cast<const DereferenceExpr*>(expr)->pointer.get())});
+        case NodeKind::VectorAccess: {
+            // The index is found before the vector, as in the AST code generator
+            auto vector = static_cast<const VectorAccess*>(expr);
+            const ValueId index = lowerExpression(vector->index.get());
+            return emit(IROp::Load, {elementAddress(lowerExpression(vector->vector.get()), index, 3)});
+        }
+        case NodeKind::CharacterAccess: {
+            auto character = static_cast<const CharacterAccess*>(expr);
+            const ValueId index = lowerExpression(character->index.get());
+            return emit(IROp::Load, {elementAddress(lowerExpression(character->string.get()), index, 2)});
+        }
+        default:
+            unsupported("floating point and table expressions");
+    }
+}
+
+ValueId IRBuilder::lowerBinaryOp(const BinaryOp* node) {
+    IROp op;
+    if (!relationOp(node->op, op) && !arithmeticOp(node->op, op)) {
+        unsupported("binary " + Token::tokenTypeToString(node->op));
+    }
+    const ValueId left = lowerExpression(node->left.get());
+    const ValueId right = lowerExpression(node->right.get());
+    return emit(op, {left, right});
+}
+
+std::vector<ValueId> IRBuilder::lowerArguments(const std::vector<ExprPtr>& arguments, bool lastFirst) {
+    if (arguments.size() > 8) {
+        unsupported("more than eight arguments");
+    }
+    std::vector<ValueId> values(arguments.size());
+    for (size_t k = 0; k < arguments.size(); ++k) {
+        const size_t i = lastFirst ? arguments.size() - 1 - k : k;
+        values[i] = lowerExpression(arguments[i].get());
+    }
+    return values;
+}
+
+ValueId IRBuilder::lowerCall(const FunctionCall* node) {
+    auto callee = nodeCast<VariableAccess>(node->function.get());
+    if (!callee || !env_.isFunction(callee->symbol)) {
+        unsupported("indirect calls");
+    }
+    // Arguments are found last first, as in the AST code generator
+    return call(callee->symbol, lowerArguments(node->arguments, true));
+}
+
+ValueId IRBuilder::lowerValof(const Valof* node) {
+    const uint32_t result = newVariable();
+    const BlockId join = newBlock();
+    valofs_.push_back({false, result, join});
+    lowerStatement(node->body.get());
+    valofs_.pop_back();
+    if (isReachable()) {
+        writeVariable(result, current_, fn_->constant(0));
+        jumpTo(join);
+    }
+    sealBlock(join);
+    continueIn(join);
+    return readVariable(result, join);
+}
+
+ValueId IRBuilder::lowerConditional(const ConditionalExpression* node) {
+    const uint32_t result = newVariable();
+    const BlockId ifTrue = newBlock();
+    const BlockId ifFalse = newBlock();
+    const BlockId join = newBlock();
+    lowerCondition(node->condition.get(), ifTrue, ifFalse);
+    sealBlock(ifTrue);
+    sealBlock(ifFalse);
+
+    continueIn(ifTrue);
+    writeVariable(result, current_, lowerExpression(node->trueExpr.get()));
+    jumpTo(join);
+    continueIn(ifFalse);
+    writeVariable(result, current_, lowerExpression(node->falseExpr.get()));
+    jumpTo(join);
+
+    sealBlock(join);
+    continueIn(join);
+    return readVariable(result, join);
+}
@@ -0,0 +1,124 @@
+// IRBuilder.h
+#ifndef IR_BUILDER_H
+#define IR_BUILDER_H
+
+#include "AST.h"
+#include "IR.h"
+#include "SymbolTable.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class IRBuilder
+ * @brief Lowers one FunctionDeclaration to an IRFunction in SSA form.
+ *
+ * Locals become SSA values directly, with phis placed while the blocks are
+ * built (Braun et al., "Simple and Efficient Construction of Static Single
+ * Assignment Form"): a block is sealed once all its predecessors are known,
+ * and a read in an unsealed block leaves a phi to be completed then. WHILE
+ * and FOR loops are lowered with the test duplicated at the bottom, so each
+ * iteration takes one branch.
+ *
+ * Constructs the IR does not cover (GOTO and labels, nested declarations,
+ * @ of a local, indirect calls, more than eight arguments, WRITEF, floats)
+ * make build() return nullptr, and the caller falls back to the AST code
+ * generator.
+ */
+class IRBuilder {
+public:
+    /// What the builder needs to know about names declared outside the function.
+    struct Environment {
+        const SymbolMap<size_t>* globals = nullptr;  // Global slot of each global
+        const SymbolMap<int>* manifests = nullptr;   // Value of each manifest constant
+        std::function<bool(SymbolId)> isFunction;    // True for names that may be called
+    };
+
+    explicit IRBuilder(Environment environment);
+
+    /**
+     * @brief Builds and verifies the IR of @p function.
+     * @return The function, or nullptr if it uses a construct the IR does not
+     *         cover; getUnsupportedReason() then says which.
+     */
+    std::unique_ptr<IRFunction> build(const FunctionDeclaration* function);
+
+    const std::string& getUnsupportedReason() const { return unsupportedReason_; }
+
+private:
+    Environment env_;
+    std::string unsupportedReason_;
+
+    IRFunction* fn_ = nullptr;
+    BlockId current_ = NoBlock;
+
+    // SSA construction state, indexed by BlockId
+    std::vector<std::vector<ValueId>> defs_;                          // Current value of each variable
+    std::vector<bool> sealed_;
+    std::vector<std::vector<std::pair<uint32_t, ValueId>>> incompletePhis_;
+
+    // Variables: the locals by name, then hidden ones for VALOF and conditional results
+    SymbolMap<uint32_t> locals_;
+    uint32_t variableCount_ = 0;
+
+    // Targets of BREAK, LOOP and ENDCASE, innermost last
+    struct JumpTargets {
+        bool isSwitch;
+        BlockId exit;       // BREAK, and ENDCASE in a SWITCHON
+        BlockId next;       // LOOP; NoBlock for a SWITCHON
+    };
+    std::vector<JumpTargets> targets_;
+
+    // Enclosing VALOFs, innermost last; RESULTIS in the function's own VALOF returns
+    struct ValofTarget {
+        bool returns;
+        uint32_t variable;
+        BlockId join;
+    };
+    std::vector<ValofTarget> valofs_;
+
+    // --- Blocks and SSA variables ---
+    BlockId newBlock();
+    void sealBlock(BlockId block);
+    uint32_t newVariable();
+    uint32_t declareLocal(SymbolId symbol);
+    void writeVariable(uint32_t variable, BlockId block, ValueId value);
+    ValueId readVariable(uint32_t variable, BlockId block);
+    ValueId readVariableRecursive(uint32_t variable, BlockId block);
+    void addPhiOperands(uint32_t variable, ValueId phi);
+
+    // --- Emission into the current block ---
+    ValueId emit(IROp op, std::initializer_list<ValueId> operands = {}, int64_t imm = 0);
+    ValueId call(SymbolId callee, const std::vector<ValueId>& arguments);
+    ValueId elementAddress(ValueId base, ValueId index, int64_t shift);
+    void jumpTo(BlockId target);
+    void branch(ValueId condition, BlockId ifTrue, BlockId ifFalse);
+    void returnValue(ValueId value);
+    bool isReachable() const;
+    void continueIn(BlockId block) { current_ = block; }
+    void continueUnreachable();
+
+    // --- Lowering ---
+    void lowerStatement(const Node* node);
+    void lowerDeclaration(const Declaration* node);
+    void lowerAssignment(const Assignment* node);
+    void lowerRoutineCall(const RoutineCall* node);
+    void lowerWhile(const WhileStatement* node);
+    void lowerFor(const ForStatement* node);
+    void lowerRepeat(const RepeatStatement* node);
+    void lowerSwitchon(const SwitchonStatement* node);
+    void lowerResultis(const ResultisStatement* node);
+    void lowerCondition(const Expression* expr, BlockId ifTrue, BlockId ifFalse);
+    ValueId lowerExpression(const Expression* expr);
+    ValueId lowerBinaryOp(const BinaryOp* node);
+    ValueId lowerCall(const FunctionCall* node);
+    ValueId lowerValof(const Valof* node);
+    ValueId lowerConditional(const ConditionalExpression* node);
+    std::vector<ValueId> lowerArguments(const std::vector<ExprPtr>& arguments, bool lastFirst);
+    const uint32_t* findLocal(const VariableAccess* node) const { return locals_.find(node->symbol); }
+
+    [[noreturn]] void unsupported(const std::string& what) const;
+};
+
+#endif // IR_BUILDER_H
@@ -0,0 +1,992 @@
+#include "IRSelector.h"
+#include "BitVector.h"
+#include "CodeGenerator.h"
+#include "LinearScanAllocator.h"
+#include "StatementCodeGenerator.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t NoPosition = 0xFFFFFFFF;
+constexpr uint32_t NoRegister = 0xFFFFFFFF;
+
+// Callee-saved registers and spill slots are addressed below x29 with LDUR/STUR
+constexpr size_t MAX_FRAME_SLOTS = 32;
+
+const uint32_t X0 = AArch64Instructions::X0;
+const uint32_t X28 = AArch64Instructions::X28;
+const uint32_t X29 = AArch64Instructions::X29;
+const uint32_t X30 = AArch64Instructions::X30;
+const uint32_t SP = AArch64Instructions::SP;
+const uint32_t XZR = AArch64Instructions::XZR;
+
+uint32_t conditionOf(IROp op) {
+    switch (op) {
+        case IROp::Eq: return AArch64Instructions::EQ;
+        case IROp::Ne: return AArch64Instructions::NE;
+        case IROp::Lt: return AArch64Instructions::LT;
+        case IROp::Gt: return AArch64Instructions::GT;
+        case IROp::Le: return AArch64Instructions::LE;
+        default:       return AArch64Instructions::GE;
+    }
+}
+
+// The condition that holds after cmp b, a when cond holds after cmp a, b
+uint32_t mirrored(uint32_t cond) {
+    switch (cond) {
+        case AArch64Instructions::LT: return AArch64Instructions::GT;
+        case AArch64Instructions::GT: return AArch64Instructions::LT;
+        case AArch64Instructions::LE: return AArch64Instructions::GE;
+        case AArch64Instructions::GE: return AArch64Instructions::LE;
+        default: return cond;
+    }
+}
+
+bool isImm12(int64_t value) {
+    return value >= 0 && value <= 4095;
+}
+
+// Offsets a load or store takes directly: scaled unsigned, or unscaled negative
+bool isMemoryOffset(int64_t offset) {
+    return (offset >= 0 && offset <= 32760 && offset % 8 == 0) || (offset >= -256 && offset < 0);
+}
+
+bool contains(const std::vector<uint32_t>& registers, uint32_t reg) {
+    return std::find(registers.begin(), registers.end(), reg) != registers.end();
+}
+
+} // namespace
+
+IRSelector::IRSelector(CodeGenerator& codeGenerator) : codeGen(codeGenerator), out(codeGenerator.instructions) {
+}
+
+bool IRSelector::select(IRFunction& function) {
+    fn_ = &function;
+    function.splitCriticalEdges();
+    order_ = function.reversePostorder();
+    uses_ = function.useCounts();
+
+    chooseFolds();
+    buildIntervals();
+    allocateRegisters();
+    if (calleeSaved_.size() + spillSlots_ > MAX_FRAME_SLOTS) {
+        fn_ = nullptr;
+        return false;
+    }
+    planLayout();
+
+    // Only functions that call, spill or use callee-saved registers need a frame
+    bool hasCalls = false;
+    for (BlockId b : order_) {
+        for (ValueId v : function.block(b).insts) {
+            hasCalls = hasCalls || (function.inst(v).op == IROp::Call && !folded_[v]);
+        }
+    }
+    hasFrame_ = hasCalls || spillSlots_ > 0 || !calleeSaved_.empty();
+    frameSize_ = hasFrame_ ? static_cast<int>((16 + 8 * (calleeSaved_.size() + spillSlots_) + 15) & ~size_t(15)) : 0;
+
+    stringPoolIndex_.clear();
+    for (const std::string& literal : function.strings) {
+        stringPoolIndex_.push_back(codeGen.stringPool.size());
+        codeGen.stringPool.push_back(literal);
+    }
+    labels_.assign(function.blockCount(), AArch64Instructions::Label());
+    returnLabel_ = AArch64Instructions::Label();
+    fallsIntoEpilogue_ = false;
+
+    codeGen.functions[function.symbol] = out.getCurrentAddress();
+    out.setPendingLabel(function.name);
+    emitPrologue();
+    for (BlockId b : order_) {
+        if (!skipped_[b]) {
+            emitBlock(b);
+        }
+    }
+    emitEpilogue();
+
+    ++stats_.functions;
+    for (ValueId v = 0; v < function.valueCount(); ++v) {
+        if (!function.inst(v).isRemoved()) {
+            ++stats_.values;
+        }
+        if (location_[v].kind == Location::Kind::Register) {
+            ++stats_.registers;
+        } else if (location_[v].kind == Location::Kind::Stack) {
+            ++stats_.spilled;
+        }
+    }
+    fn_ = nullptr;
+    return true;
+}
+
+// --- Analysis ---
+
+void IRSelector::chooseFolds() {
+    const size_t count = fn_->valueCount();
+    folded_.assign(count, false);
+    shifted_.assign(count, NoValue);
+
+    for (BlockId b : order_) {
+        const std::vector<ValueId>& insts = fn_->block(b).insts;
+        for (size_t k = 0; k < insts.size(); ++k) {
+            const ValueId v = insts[k];
+            const IRInst& inst = fn_->inst(v);
+            // A terminator can only take the flags or a call from the instruction right before it
+            const bool fedByPrevious = k > 0 && !inst.operands.empty() && insts[k - 1] == inst.operands[0] &&
+                                       uses_[inst.operands[0]] == 1;
+            int64_t amount;
+
+            switch (inst.op) {
+                case IROp::Add:
+                    for (size_t side = 0; side < 2; ++side) {
+                        const ValueId shift = inst.operands[side];
+                        const IRInst& shl = fn_->inst(shift);
+                        if (shl.op == IROp::Shl && shl.block == b && uses_[shift] == 1 &&
+                            isConstant(shl.operands[1], amount) && amount > 0 && amount < 64) {
+                            shifted_[v] = shift;
+                            folded_[shift] = true;
+                            break;
+                        }
+                    }
+                    break;
+                case IROp::Load:
+                case IROp::Store: {
+                    const ValueId address = inst.operands[0];
+                    ValueId base;
+                    int64_t offset;
+                    if (fn_->inst(address).block == b && uses_[address] == 1 && addressOffset(address, base, offset)) {
+                        folded_[address] = true;
+                    }
+                    break;
+                }
+                case IROp::Branch:
+                    if (fedByPrevious && fn_->inst(inst.operands[0]).isRelation()) {
+                        folded_[inst.operands[0]] = true;
+                    }
+                    break;
+                case IROp::Return:
+                    if (fedByPrevious) {
+                        // RESULTIS F(...) inside F becomes a jump back to its entry
+                        const IRInst& call = fn_->inst(inst.operands[0]);
+                        if (call.op == IROp::Call && call.callee == fn_->symbol && call.operands.size() <= 8) {
+                            folded_[inst.operands[0]] = true;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+bool IRSelector::addressOffset(ValueId address, ValueId& base, int64_t& offset) const {
+    const IRInst& add = fn_->inst(address);
+    if (add.op != IROp::Add || shifted_[address] != NoValue) {
+        return false;
+    }
+    for (size_t side = 0; side < 2; ++side) {
+        int64_t other;
+        if (isConstant(add.operands[side], offset) && isMemoryOffset(offset) && !isConstant(add.operands[1 - side], other)) {
+            base = add.operands[1 - side];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IRSelector::needsLocation(ValueId value) const {
+    const IRInst& inst = fn_->inst(value);
+    const bool definesValue = inst.op < IROp::Store || inst.op == IROp::Call;
+    return definesValue && uses_[value] > 0 && !inst.isRemoved() && !inst.isRematerializable() && !folded_[value];
+}
+
+void IRSelector::collectOperands(ValueId value, std::vector<ValueId>& operands) const {
+    for (ValueId operand : fn_->inst(value).operands) {
+        if (folded_[operand]) {
+            collectOperands(operand, operands);
+        } else if (needsLocation(operand)) {
+            operands.push_back(operand);
+        }
+    }
+}
+
+void IRSelector::buildIntervals() {
+    const size_t blocks = fn_->blockCount();
+    const size_t values = fn_->valueCount();
+
+    // Two positions per instruction: operands are read at the first and the
+    // result written at the second, so a value may take the register of an
+    // operand that dies there. Phis are defined at the top of their block.
+    position_.assign(values, NoPosition);
+    blockStart_.assign(blocks, 0);
+    blockEnd_.assign(blocks, 0);
+    uint32_t pos = 0;
+    for (BlockId b : order_) {
+        blockStart_[b] = pos;
+        pos += 2;
+        for (ValueId v : fn_->block(b).insts) {
+            if (fn_->inst(v).op == IROp::Phi) {
+                position_[v] = blockStart_[b];
+            } else {
+                position_[v] = pos;
+                pos += 2;
+            }
+        }
+        blockEnd_[b] = pos - 1;
+    }
+
+    // Liveness over the blocks; a phi operand is live out of the predecessor it comes from
+    std::vector<BitVector> gen(blocks, BitVector(values));
+    std::vector<BitVector> kill(blocks, BitVector(values));
+    std::vector<BitVector> edgeUses(blocks, BitVector(values));
+    std::vector<ValueId> operands;
+    for (BlockId b : order_) {
+        for (ValueId v : fn_->block(b).insts) {
+            if (fn_->inst(v).op != IROp::Phi && !folded_[v]) {
+                operands.clear();
+                collectOperands(v, operands);
+                for (ValueId operand : operands) {
+                    if (!kill[b].test(operand)) gen[b].set(operand);
+                }
+            }
+            if (needsLocation(v)) kill[b].set(v);
+        }
+        for (BlockId succ : fn_->block(b).successors) {
+            const IRBlock& target = fn_->block(succ);
+            const size_t edge = std::find(target.predecessors.begin(), target.predecessors.end(), b) - target.predecessors.begin();
+            for (ValueId phi : target.insts) {
+                if (fn_->inst(phi).op != IROp::Phi) break;
+                const ValueId operand = fn_->inst(phi).operands[edge];
+                if (needsLocation(phi) && needsLocation(operand)) edgeUses[b].set(operand);
+            }
+        }
+    }
+
+    std::vector<BitVector> liveIn(blocks, BitVector(values));
+    std::vector<BitVector> liveOut(blocks, BitVector(values));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+            const BlockId b = *it;
+            BitVector live = edgeUses[b];
+            for (BlockId succ : fn_->block(b).successors) {
+                live.unionWith(liveIn[succ]);
+            }
+            liveOut[b] = live;
+            changed |= liveIn[b].assignTransfer(gen[b], liveOut[b], kill[b]);
+        }
+    }
+
+    // Each interval is the hull of the positions where its value is live
+    start_.assign(values, NoPosition);
+    end_.assign(values, 0);
+    auto extend = [this](size_t v, uint32_t p) {
+        start_[v] = std::min(start_[v], p);
+        end_[v] = std::max(end_[v], p);
+    };
+    std::vector<uint32_t> calls;
+    for (BlockId b : order_) {
+        liveIn[b].forEach([&](size_t v) { extend(v, blockStart_[b]); });
+        liveOut[b].forEach([&](size_t v) { extend(v, blockEnd_[b]); });
+        for (ValueId v : fn_->block(b).insts) {
+            const IRInst& inst = fn_->inst(v);
+            if (inst.op == IROp::Phi) {
+                if (needsLocation(v)) extend(v, blockStart_[b]);
+                continue;
+            }
+            if (needsLocation(v)) extend(v, position_[v] + 1);
+            if (folded_[v]) continue;
+            operands.clear();
+            collectOperands(v, operands);
+            for (ValueId operand : operands) {
+                extend(operand, position_[v]);
+            }
+            if (inst.op == IROp::Call) calls.push_back(position_[v]);
+        }
+    }
+
+    // The copies into a phi are made at the end of each predecessor, which
+    // keeps its register taken past its last use. An operand starting after
+    // that use may share the register, as long as no other copy into the phi
+    // lands inside the operand's interval.
+    phiEnd_ = end_;
+    hint_.assign(values, NoValue);
+    for (BlockId b : order_) {
+        const IRBlock& block = fn_->block(b);
+        for (ValueId v : block.insts) {
+            const IRInst& inst = fn_->inst(v);
+            if (inst.op != IROp::Phi) break;
+            if (!needsLocation(v)) continue;
+            for (size_t edge = 0; edge < block.predecessors.size(); ++edge) {
+                extend(v, blockEnd_[block.predecessors[edge]]);
+                const ValueId operand = inst.operands[edge];
+                if (needsLocation(operand) && hint_[operand] == NoValue) hint_[operand] = v;
+            }
+        }
+    }
+
+    // A value whose interval strictly contains a call must survive it
+    crossesCall_.assign(values, false);
+    for (ValueId v = 0; v < values; ++v) {
+        if (start_[v] == NoPosition) continue;
+        auto call = std::upper_bound(calls.begin(), calls.end(), start_[v]);
+        crossesCall_[v] = call != calls.end() && *call < end_[v];
+    }
+}
+
+void IRSelector::allocateRegisters() {
+    const size_t values = fn_->valueCount();
+    location_.assign(values, Location());
+    calleeSaved_.clear();
+    spillSlots_ = 0;
+
+    std::vector<ValueId> intervals;
+    for (ValueId v = 0; v < values; ++v) {
+        if (needsLocation(v) && start_[v] != NoPosition) intervals.push_back(v);
+    }
+    std::sort(intervals.begin(), intervals.end(), [this](ValueId a, ValueId b) {
+        return start_[a] != start_[b] ? start_[a] < start_[b] : a < b;
+    });
+
+    const std::vector<uint32_t>& callerSaved = LinearScanAllocator::callerSavedPool();
+    const std::vector<uint32_t>& calleeSavedPool = LinearScanAllocator::calleeSavedPool();
+    std::vector<uint8_t> taken(32, 0); // Intervals holding each register; two when one shares a phi's
+    std::vector<bool> calleeUsed(32, false);
+    auto firstFree = [&taken](const std::vector<uint32_t>& pool) {
+        for (uint32_t reg : pool) {
+            if (!taken[reg]) return reg;
+        }
+        return NoRegister;
+    };
+    auto spill = [this](ValueId v) {
+        location_[v] = {Location::Kind::Stack, spillSlots_++};
+    };
+
+    std::vector<ValueId> active;
+    for (ValueId v : intervals) {
+        active.erase(std::remove_if(active.begin(), active.end(), [&](ValueId a) {
+                         if (end_[a] >= start_[v]) return false;
+                         --taken[location_[a].index];
+                         return true;
+                     }),
+                     active.end());
+
+        // Values that do not live across a call prefer the registers a call may clobber
+        uint32_t reg = sharedPhiRegister(v, taken);
+        if (reg == NoRegister && !crossesCall_[v]) reg = firstFree(callerSaved);
+        if (reg == NoRegister) reg = firstFree(calleeSavedPool);
+        if (reg == NoRegister) {
+            // Out of registers: the interval that ends last goes to the stack
+            ValueId victim = NoValue;
+            for (ValueId a : active) {
+                if (crossesCall_[v] && !contains(calleeSavedPool, location_[a].index)) continue;
+                if (taken[location_[a].index] > 1) continue;
+                if (victim == NoValue || end_[a] > end_[victim]) victim = a;
+            }
+            if (victim == NoValue || end_[victim] <= end_[v]) {
+                spill(v);
+                continue;
+            }
+            reg = location_[victim].index;
+            spill(victim);
+            active.erase(std::find(active.begin(), active.end(), victim));
+        }
+        ++taken[reg];
+        if (contains(calleeSavedPool, reg)) calleeUsed[reg] = true;
+        location_[v] = {Location::Kind::Register, reg};
+        active.push_back(v);
+    }
+
+    for (uint32_t reg : calleeSavedPool) {
+        if (calleeUsed[reg]) calleeSaved_.push_back(reg);
+    }
+}
+
+uint32_t IRSelector::sharedPhiRegister(ValueId value, const std::vector<uint8_t>& taken) const {
+    const ValueId phi = hint_[value];
+    if (phi == NoValue || location_[phi].kind != Location::Kind::Register || phiEnd_[phi] >= start_[value]) {
+        return NoRegister;
+    }
+    const uint32_t reg = location_[phi].index;
+    const bool phiHoldsIt = end_[phi] >= start_[value];
+    if (taken[reg] != (phiHoldsIt ? 1 : 0) || (crossesCall_[value] && !contains(LinearScanAllocator::calleeSavedPool(), reg))) {
+        return NoRegister;
+    }
+    const IRBlock& block = fn_->block(fn_->inst(phi).block);
+    for (size_t edge = 0; edge < block.predecessors.size(); ++edge) {
+        const uint32_t copy = blockEnd_[block.predecessors[edge]];
+        if (fn_->inst(phi).operands[edge] != value && copy >= start_[value] && copy <= end_[value]) {
+            return NoRegister;
+        }
+    }
+    return reg;
+}
+
+void IRSelector::planLayout() {
+    const size_t blocks = fn_->blockCount();
+    auto successor = [this](BlockId b) { return fn_->block(b).successors[0]; };
+
+    // A block holding just a jump, with no copies on its edge, is branched through
+    auto copiesNothing = [this](BlockId from, BlockId to) {
+        const IRBlock& target = fn_->block(to);
+        const size_t edge = std::find(target.predecessors.begin(), target.predecessors.end(), from) - target.predecessors.begin();
+        for (ValueId phi : target.insts) {
+            const IRInst& inst = fn_->inst(phi);
+            if (inst.op != IROp::Phi) break;
+            if (!needsLocation(phi)) continue;
+            const ValueId operand = inst.operands[edge];
+            if (fn_->inst(operand).isRematerializable() || !(location_[operand] == location_[phi])) return false;
+        }
+        return true;
+    };
+    skipped_.assign(blocks, false);
+    for (BlockId b : order_) {
+        const IRBlock& block = fn_->block(b);
+        skipped_[b] = b != fn_->entry() && block.insts.size() == 1 && fn_->inst(block.insts[0]).op == IROp::Jump &&
+                      copiesNothing(b, block.successors[0]);
+    }
+    // A cycle of such blocks is an empty endless loop; one of them stays
+    for (BlockId b : order_) {
+        BlockId t = b;
+        for (size_t steps = 0; skipped_[t] && steps <= blocks; ++steps) t = successor(t);
+        if (skipped_[t]) skipped_[b] = false;
+    }
+
+    resolved_.assign(blocks, NoBlock);
+    for (BlockId b : order_) {
+        BlockId t = b;
+        while (skipped_[t]) t = successor(t);
+        resolved_[b] = t;
+    }
+    next_.assign(blocks, NoBlock);
+    BlockId following = NoBlock;
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        if (skipped_[*it]) continue;
+        next_[*it] = following;
+        following = *it;
+    }
+
+    // A block needs a label unless it is only entered by falling into it
+    std::vector<uint32_t> edges(blocks, 0);
+    std::vector<BlockId> from(blocks, NoBlock);
+    for (BlockId b : order_) {
+        if (skipped_[b]) continue;
+        for (BlockId succ : fn_->block(b).successors) {
+            ++edges[resolved_[succ]];
+            from[resolved_[succ]] = b;
+        }
+    }
+    needsLabel_.assign(blocks, false);
+    for (BlockId b : order_) {
+        if (skipped_[b] || b == fn_->entry()) continue;
+        bool fallsIn = false;
+        if (edges[b] == 1 && next_[from[b]] == b) {
+            const IROp op = fn_->inst(fn_->terminator(from[b])).op;
+            fallsIn = op == IROp::Jump || op == IROp::Branch;
+        }
+        needsLabel_[b] = !fallsIn;
+    }
+}
+
+// --- Emission ---
+
+void IRSelector::emitPrologue() {
+    if (!hasFrame_) return;
+    out.sub_imm(SP, SP, frameSize_, "Allocate stack frame");
+    out.stp(X29, X30, SP, frameSize_ - 16, "Save FP/LR at top of frame");
+    out.add(X29, SP, frameSize_ - 16, "Set up frame pointer");
+    for (size_t i = 0; i < calleeSaved_.size(); ++i) {
+        out.str(calleeSaved_[i], X29, -8 * static_cast<int>(i + 1), [&] { return "Save callee-saved register " + out.regName(calleeSaved_[i]); });
+    }
+}
+
+void IRSelector::releaseFrame() {
+    if (!hasFrame_) return;
+    for (size_t i = calleeSaved_.size(); i-- > 0;) {
+        out.ldr(calleeSaved_[i], X29, -8 * static_cast<int>(i + 1), [&] { return "Restore callee-saved register " + out.regName(calleeSaved_[i]); });
+    }
+    out.ldp(X29, X30, SP, frameSize_ - 16, "Restore FP/LR");
+    out.add(SP, SP, frameSize_, "Deallocate stack frame");
+}
+
+void IRSelector::emitEpilogue() {
+    // Without a frame every return is its own ret, and a function that only
+    // tail-calls or loops never gets here
+    if (!returnLabel_.isValid() && !fallsIntoEpilogue_) {
+        return;
+    }
+    if (returnLabel_.isValid()) {
+        out.setPendingLabel(returnLabel_);
+    }
+    releaseFrame();
+    out.ret("Return from function");
+}
+
+void IRSelector::emitBlock(BlockId block) {
+    if (needsLabel_[block]) {
+        out.setPendingLabel(label(block));
+    }
+    for (ValueId v : fn_->block(block).insts) {
+        const IRInst& inst = fn_->inst(v);
+        switch (inst.op) {
+            case IROp::Jump:   emitJumpTo(block, fn_->block(block).successors[0]); break;
+            case IROp::Branch: emitBranch(block, inst); break;
+            case IROp::Switch: emitSwitch(block, inst); break;
+            case IROp::Return: emitReturn(block, inst); break;
+            default:
+                if (!folded_[v]) emitInstruction(v);
+                break;
+        }
+        releaseScratch();
+    }
+}
+
+void IRSelector::emitInstruction(ValueId value) {
+    const IRInst& inst = fn_->inst(value);
+    switch (inst.op) {
+        case IROp::Const:
+        case IROp::StringAddr:
+        case IROp::GlobalAddr:
+        case IROp::Phi:
+            return;
+        case IROp::Arg: {
+            // Parameters leave x0-x7 straight away, so calls may reuse them
+            const uint32_t param = X0 + static_cast<uint32_t>(inst.imm);
+            if (location_[value].kind == Location::Kind::Register) {
+                out.mov(location_[value].index, param, [&] { return "Parameter " + std::to_string(inst.imm); });
+            } else if (location_[value].kind == Location::Kind::Stack) {
+                out.str(param, X29, slotOffset(location_[value].index), [&] { return "Parameter " + std::to_string(inst.imm); });
+            }
+            return;
+        }
+        case IROp::Neg:
+        case IROp::Not: {
+            const uint32_t operand = operandRegister(inst.operands[0]);
+            const uint32_t rd = resultRegister(value);
+            if (inst.op == IROp::Neg) {
+                out.neg(rd, operand);
+            } else {
+                out.mvn(rd, operand);
+            }
+            storeResult(value, rd);
+            return;
+        }
+        case IROp::Load:
+        case IROp::Store: {
+            const ValueId address = inst.operands[0];
+            const IRInst& addressInst = fn_->inst(address);
+            uint32_t base;
+            int64_t offset = 0;
+            ValueId folded;
+            if (addressInst.op == IROp::GlobalAddr && addressInst.imm * 8 <= 32760) {
+                base = X28;
+                offset = addressInst.imm * 8;
+            } else if (folded_[address] && addressOffset(address, folded, offset)) {
+                base = operandRegister(folded);
+            } else {
+                base = operandRegister(address);
+            }
+            if (inst.op == IROp::Store) {
+                out.str(operandRegister(inst.operands[1]), base, static_cast<int32_t>(offset));
+            } else {
+                const uint32_t rd = resultRegister(value);
+                out.ldr(rd, base, static_cast<int32_t>(offset));
+                storeResult(value, rd);
+            }
+            return;
+        }
+        case IROp::Call:
+            emitCall(inst);
+            if (location_[value].kind == Location::Kind::Register) {
+                out.mov(location_[value].index, X0, [&] { return "Result of " + SymbolTable::getInstance().name(inst.callee); });
+            } else if (location_[value].kind == Location::Kind::Stack) {
+                out.str(X0, X29, slotOffset(location_[value].index), [&] { return "Result of " + SymbolTable::getInstance().name(inst.callee); });
+            }
+            return;
+        default:
+            if (inst.isRelation()) {
+                const uint32_t cond = emitCompare(inst);
+                const uint32_t rd = resultRegister(value);
+                out.csetm(rd, cond, [&] { return "TRUE (-1) if " + AArch64Instructions::conditionName(cond); });
+                storeResult(value, rd);
+            } else {
+                emitBinary(value);
+            }
+            return;
+    }
+}
+
+void IRSelector::emitBinary(ValueId value) {
+    const IRInst& inst = fn_->inst(value);
+    const ValueId lhs = inst.operands[0];
+    const ValueId rhs = inst.operands[1];
+    int64_t k;
+
+    // Adds and subtracts of a small constant take it as an immediate
+    if ((inst.op == IROp::Add || inst.op == IROp::Sub) && shifted_[value] == NoValue) {
+        ValueId other = NoValue;
+        if (isConstant(rhs, k) && k >= -4095 && k <= 4095) {
+            other = lhs;
+        } else if (inst.op == IROp::Add && isConstant(lhs, k) && k >= -4095 && k <= 4095) {
+            other = rhs;
+        }
+        if (other != NoValue) {
+            if (inst.op == IROp::Sub) k = -k;
+            const uint32_t rn = operandRegister(other);
+            const uint32_t rd = resultRegister(value);
+            if (k >= 0) {
+                out.add(rd, rn, static_cast<uint32_t>(k));
+            } else {
+                out.sub_imm(rd, rn, static_cast<uint32_t>(-k), "");
+            }
+            storeResult(value, rd);
+            return;
+        }
+    }
+
+    // Shifts by a constant are an add of the shifted value to zero
+    if ((inst.op == IROp::Shl || inst.op == IROp::Shr) && isConstant(rhs, k) && k >= 0 && k < 64) {
+        const uint32_t rm = operandRegister(lhs);
+        const uint32_t rd = resultRegister(value);
+        out.add(rd, XZR, rm, inst.op == IROp::Shl ? AArch64Instructions::LSL : AArch64Instructions::LSR, static_cast<uint32_t>(k));
+        storeResult(value, rd);
+        return;
+    }
+
+    if (inst.op == IROp::Add && shifted_[value] != NoValue) {
+        const IRInst& shift = fn_->inst(shifted_[value]);
+        const uint32_t rn = operandRegister(lhs == shifted_[value] ? rhs : lhs);
+        const uint32_t rm = operandRegister(shift.operands[0]);
+        isConstant(shift.operands[1], k);
+        const uint32_t rd = resultRegister(value);
+        out.add(rd, rn, rm, AArch64Instructions::LSL, static_cast<uint32_t>(k));
+        storeResult(value, rd);
+        return;
+    }
+
+    const uint32_t rn = operandRegister(lhs);
+    const uint32_t rm = operandRegister(rhs);
+    const uint32_t rd = resultRegister(value);
+    switch (inst.op) {
+        case IROp::Add: out.add(rd, rn, rm, AArch64Instructions::LSL, 0); break;
+        case IROp::Sub: out.sub(rd, rn, rm, ""); break;
+        case IROp::Mul: out.mul(rd, rn, rm); break;
+        case IROp::Div: out.sdiv(rd, rn, rm); break;
+        case IROp::Rem: {
+            const uint32_t quotient = acquireScratch();
+            out.sdiv(quotient, rn, rm);
+            out.msub(rd, quotient, rm, rn, "Remainder");
+            break;
+        }
+        case IROp::And: out.and_op(rd, rn, rm); break;
+        case IROp::Or:  out.orr(rd, rn, rm); break;
+        case IROp::Shl: out.lslv(rd, rn, rm, ""); break;
+        case IROp::Shr: out.lsrv(rd, rn, rm, ""); break;
+        default:
+            throw std::runtime_error(std::string("IRSelector: unexpected ") + irOpName(inst.op));
+    }
+    storeResult(value, rd);
+}
+
+uint32_t IRSelector::emitCompare(const IRInst& relation) {
+    const uint32_t cond = conditionOf(relation.op);
+    int64_t k;
+    if (isConstant(relation.operands[1], k) && isImm12(k)) {
+        out.cmp_imm(operandRegister(relation.operands[0]), static_cast<uint32_t>(k), "Compare with constant");
+        return cond;
+    }
+    if (isConstant(relation.operands[0], k) && isImm12(k)) {
+        // k < E is E > k: compare the other way round and mirror the condition
+        out.cmp_imm(operandRegister(relation.operands[1]), static_cast<uint32_t>(k), "Compare with constant");
+        return mirrored(cond);
+    }
+    const uint32_t rn = operandRegister(relation.operands[0]);
+    out.cmp(rn, operandRegister(relation.operands[1]), "Compare");
+    return cond;
+}
+
+void IRSelector::emitCall(const IRInst& inst) {
+    // No allocated register is an argument register, so the arguments go straight in
+    for (size_t i = 0; i < inst.operands.size(); ++i) {
+        moveInto(X0 + static_cast<uint32_t>(i), inst.operands[i]);
+        releaseScratch();
+    }
+    const std::string& name = SymbolTable::getInstance().name(inst.callee);
+    out.bl(name, [&] { return "Call " + name; });
+}
+
+void IRSelector::emitJumpTo(BlockId from, BlockId to) {
+    emitPhiMoves(from, to);
+    const BlockId target = resolved_[to];
+    if (target != next_[from]) {
+        out.b(label(target));
+    }
+}
+
+void IRSelector::emitBranch(BlockId block, const IRInst& inst) {
+    const IRBlock& irBlock = fn_->block(block);
+    const BlockId ifTrue = resolved_[irBlock.successors[0]];
+    const BlockId ifFalse = resolved_[irBlock.successors[1]];
+    const BlockId next = next_[block];
+    if (ifTrue == ifFalse) {
+        if (ifTrue != next) out.b(label(ifTrue));
+        return;
+    }
+    if (ifTrue == next) {
+        emitConditionalBranch(inst.operands[0], false, label(ifFalse));
+    } else {
+        emitConditionalBranch(inst.operands[0], true, label(ifTrue));
+        if (ifFalse != next) out.b(label(ifFalse));
+    }
+}
+
+void IRSelector::emitConditionalBranch(ValueId condition, bool branchIfTrue, AArch64Instructions::Label target) {
+    const IRInst& inst = fn_->inst(condition);
+    if (!folded_[condition]) {
+        // Any other value is true when it is not zero
+        const uint32_t reg = operandRegister(condition);
+        if (branchIfTrue) {
+            out.cbnz(reg, target, "Branch if condition is true");
+        } else {
+            out.cbz(reg, target, "Branch if condition is false");
+        }
+        return;
+    }
+
+    int64_t k;
+    if (isConstant(inst.operands[1], k) && k == 0) {
+        if (inst.op == IROp::Eq || inst.op == IROp::Ne) {
+            const uint32_t reg = operandRegister(inst.operands[0]);
+            if ((inst.op == IROp::Eq) == branchIfTrue) {
+                out.cbz(reg, target, "Branch if zero");
+            } else {
+                out.cbnz(reg, target, "Branch if not zero");
+            }
+            return;
+        }
+        if (inst.op == IROp::Lt || inst.op == IROp::Ge) {
+            // The sign bit alone decides a comparison with zero
+            const uint32_t reg = operandRegister(inst.operands[0]);
+            if ((inst.op == IROp::Lt) == branchIfTrue) {
+                out.tbnz(reg, 63, target, "Branch if negative");
+            } else {
+                out.tbz(reg, 63, target, "Branch if not negative");
+            }
+            return;
+        }
+    }
+    const uint32_t cond = emitCompare(inst);
+    out.bcond(branchIfTrue ? cond : cond ^ 1, target);
+}
+
+void IRSelector::emitSwitch(BlockId block, const IRInst& inst) {
+    // The dispatch code of the AST code generator takes the value in X0
+    moveInto(X0, inst.operands[0]);
+    releaseScratch();
+
+    const IRBlock& irBlock = fn_->block(block);
+    const std::vector<int64_t>& values = fn_->switchCases[inst.imm];
+    std::vector<StatementCodeGenerator::CaseTarget> cases;
+    for (size_t i = 0; i < values.size(); ++i) {
+        cases.push_back({values[i], label(resolved_[irBlock.successors[i + 1]])});
+    }
+    codeGen.statementGenerator->generateBinarySearchTree(cases, label(resolved_[irBlock.successors[0]]));
+}
+
+void IRSelector::emitReturn(BlockId block, const IRInst& inst) {
+    if (!inst.operands.empty() && folded_[inst.operands[0]]) {
+        // Tail call: new arguments in place, frame released, back to the entry point
+        const IRInst& call = fn_->inst(inst.operands[0]);
+        for (size_t i = 0; i < call.operands.size(); ++i) {
+            moveInto(X0 + static_cast<uint32_t>(i), call.operands[i]);
+            releaseScratch();
+        }
+        releaseFrame();
+        out.b(fn_->name, "Tail call optimization");
+        return;
+    }
+
+    if (!inst.operands.empty()) {
+        moveInto(X0, inst.operands[0]);
+    }
+    if (!hasFrame_) {
+        out.ret("Return from function");
+    } else if (next_[block] == NoBlock) {
+        fallsIntoEpilogue_ = true;
+    } else {
+        if (!returnLabel_.isValid()) {
+            returnLabel_ = codeGen.labelManager.generateLabel("return");
+        }
+        out.b(returnLabel_, "Branch to function epilogue");
+    }
+}
+
+void IRSelector::emitPhiMoves(BlockId from, BlockId to) {
+    const IRBlock& target = fn_->block(to);
+    const size_t edge = std::find(target.predecessors.begin(), target.predecessors.end(), from) - target.predecessors.begin();
+
+    // Source kind None means the value is rebuilt rather than copied
+    struct Move {
+        Location destination;
+        Location source;
+        ValueId value;
+    };
+    std::vector<Move> moves;
+    for (ValueId phi : target.insts) {
+        const IRInst& inst = fn_->inst(phi);
+        if (inst.op != IROp::Phi) break;
+        if (!needsLocation(phi)) continue;
+        const ValueId operand = inst.operands[edge];
+        const Location source = fn_->inst(operand).isRematerializable() ? Location() : location_[operand];
+        if (source.kind != Location::Kind::None && source == location_[phi]) continue;
+        moves.push_back({location_[phi], source, operand});
+    }
+
+    uint32_t temp = NoRegister;   // For stack to stack copies
+    uint32_t parked = NoRegister; // Holds a destination's old value to break a cycle
+    auto copy = [&](const Location& destination, const Location& source, ValueId value) {
+        const bool toStack = destination.kind == Location::Kind::Stack;
+        uint32_t reg = toStack ? NoRegister : destination.index;
+        if (toStack && source.kind == Location::Kind::Register) {
+            out.str(source.index, X29, slotOffset(destination.index));
+            return;
+        }
+        if (toStack) {
+            if (temp == NoRegister) temp = acquireScratch();
+            reg = temp;
+        }
+        if (source.kind == Location::Kind::None) {
+            materialize(reg, value);
+        } else if (source.kind == Location::Kind::Register) {
+            out.mov(reg, source.index);
+        } else {
+            out.ldr(reg, X29, slotOffset(source.index));
+        }
+        if (toStack) {
+            out.str(reg, X29, slotOffset(destination.index));
+        }
+    };
+
+    while (!moves.empty()) {
+        // A copy is safe once no other pending copy still reads its destination
+        size_t ready = moves.size();
+        for (size_t i = 0; i < moves.size() && ready == moves.size(); ++i) {
+            bool read = false;
+            for (size_t j = 0; j < moves.size() && !read; ++j) {
+                read = j != i && moves[j].source.kind != Location::Kind::None && moves[j].source == moves[i].destination;
+            }
+            if (!read) ready = i;
+        }
+        if (ready == moves.size()) {
+            if (parked == NoRegister) parked = acquireScratch();
+            const Location saved = moves[0].destination;
+            const Location parkedLocation{Location::Kind::Register, parked};
+            copy(parkedLocation, saved, NoValue);
+            for (Move& move : moves) {
+                if (move.source.kind != Location::Kind::None && move.source == saved) move.source = parkedLocation;
+            }
+            continue;
+        }
+        copy(moves[ready].destination, moves[ready].source, moves[ready].value);
+        moves.erase(moves.begin() + ready);
+        ++stats_.phiMoves;
+    }
+}
+
+// --- Values and registers ---
+
+bool IRSelector::isConstant(ValueId value, int64_t& constant) const {
+    const IRInst& inst = fn_->inst(value);
+    if (inst.op != IROp::Const) return false;
+    constant = inst.imm;
+    return true;
+}
+
+int IRSelector::slotOffset(uint32_t slot) const {
+    return -8 * static_cast<int>(calleeSaved_.size() + slot + 1);
+}
+
+uint32_t IRSelector::acquireScratch() {
+    const uint32_t reg = codeGen.scratchAllocator.acquire();
+    scratch_.push_back(reg);
+    return reg;
+}
+
+void IRSelector::releaseScratch() {
+    for (uint32_t reg : scratch_) {
+        codeGen.scratchAllocator.release(reg);
+    }
+    scratch_.clear();
+}
+
+void IRSelector::materialize(uint32_t reg, ValueId value) {
+    const IRInst& inst = fn_->inst(value);
+    switch (inst.op) {
+        case IROp::Const:
+            out.loadImmediate(reg, inst.imm);
+            break;
+        case IROp::StringAddr:
+            out.adr(reg, ".L.str" + std::to_string(stringPoolIndex_[inst.imm]), "Load string literal address");
+            break;
+        case IROp::GlobalAddr:
+            if (inst.imm * 8 <= 4095) {
+                out.add(reg, X28, static_cast<uint32_t>(inst.imm * 8), "Address of global");
+            } else {
+                out.loadImmediate(reg, inst.imm * 8);
+                out.add(reg, X28, reg, AArch64Instructions::LSL, 0, "Address of global");
+            }
+            break;
+        default:
+            throw std::runtime_error(std::string("IRSelector: cannot rebuild ") + irOpName(inst.op));
+    }
+}
+
+uint32_t IRSelector::operandRegister(ValueId value) {
+    if (fn_->inst(value).isRematerializable()) {
+        const uint32_t reg = acquireScratch();
+        materialize(reg, value);
+        return reg;
+    }
+    const Location& location = location_[value];
+    if (location.kind == Location::Kind::Register) {
+        return location.index;
+    }
+    if (location.kind == Location::Kind::None) {
+        throw std::runtime_error("IRSelector: %" + std::to_string(value) + " in " + fn_->name + " has no location");
+    }
+    const uint32_t reg = acquireScratch();
+    out.ldr(reg, X29, slotOffset(location.index), "Reload spilled value");
+    return reg;
+}
+
+void IRSelector::moveInto(uint32_t reg, ValueId value) {
+    if (fn_->inst(value).isRematerializable()) {
+        materialize(reg, value);
+    } else if (location_[value].kind == Location::Kind::Stack) {
+        out.ldr(reg, X29, slotOffset(location_[value].index), "Reload spilled value");
+    } else if (operandRegister(value) != reg) {
+        out.mov(reg, location_[value].index);
+    }
+}
+
+uint32_t IRSelector::resultRegister(ValueId value) {
+    const Location& location = location_[value];
+    return location.kind == Location::Kind::Register ? location.index : acquireScratch();
+}
+
+void IRSelector::storeResult(ValueId value, uint32_t reg) {
+    const Location& location = location_[value];
+    if (location.kind == Location::Kind::Stack) {
+        out.str(reg, X29, slotOffset(location.index), "Spill");
+    }
+}
+
+AArch64Instructions::Label IRSelector::label(BlockId block) {
+    if (!labels_[block].isValid()) {
+        labels_[block] = codeGen.labelManager.generateLabel("block");
+    }
+    return labels_[block];
+}
@@ -0,0 +1,138 @@
+// IRSelector.h
+#ifndef IR_SELECTOR_H
+#define IR_SELECTOR_H
+
+#include "AArch64Instructions.h"
+#include "IR.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CodeGenerator;
+
+/**
+ * @class IRSelector
+ * @brief Emits AArch64 code for an IRFunction into a CodeGenerator's buffer.
+ *
+ * Blocks are laid out in reverse postorder after splitting critical edges, so
+ * phi copies always sit at the end of a block that jumps. A few patterns are
+ * folded into their single user: a shift by a constant into an add, a
+ * constant offset into a load or store, and a relation into the branch that
+ * tests it. Every other value gets a live interval over the layout and a
+ * register from linear scan; values live across a call only get callee-saved
+ * registers. Constants and addresses are rebuilt at each use instead.
+ *
+ * The frame keeps the AST code generator's shape (FP/LR at the top, x29
+ * pointing at them, callee-saved registers and spill slots below) and is left
+ * out of leaf functions that need none of it.
+ */
+class IRSelector {
+public:
+    struct Statistics {
+        size_t functions = 0;  // Functions emitted from the IR
+        size_t values = 0;     // Instructions in those functions
+        size_t registers = 0;  // Live intervals given a register
+        size_t spilled = 0;    // Live intervals kept in a stack slot
+        size_t phiMoves = 0;   // Copies emitted for phis
+    };
+
+    explicit IRSelector(CodeGenerator& codeGenerator);
+
+    /**
+     * @brief Emits @p function, which may be changed by edge splitting.
+     * @return False, having emitted nothing, if the frame would be too large
+     *         for the offsets used; the caller then falls back.
+     */
+    bool select(IRFunction& function);
+
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    CodeGenerator& codeGen;
+    AArch64Instructions& out;
+    Statistics stats_;
+
+    // Where a value lives between the instruction defining it and its last use
+    struct Location {
+        enum class Kind : uint8_t { None, Register, Stack };
+        Kind kind = Kind::None;
+        uint32_t index = 0; // Register number, or spill slot
+
+        bool operator==(const Location& other) const { return kind == other.kind && index == other.index; }
+    };
+
+    IRFunction* fn_ = nullptr;
+
+    // Layout
+    std::vector<BlockId> order_;
+    std::vector<bool> skipped_;        // Blocks that only jump on, without copies
+    std::vector<BlockId> resolved_;    // Block a branch to each block really goes to
+    std::vector<BlockId> next_;        // Block emitted after each one, or NoBlock
+    std::vector<bool> needsLabel_;
+    std::vector<AArch64Instructions::Label> labels_;
+    AArch64Instructions::Label returnLabel_;
+    bool fallsIntoEpilogue_ = false;   // The last block emitted returns by falling through
+
+    // Per value
+    std::vector<uint32_t> uses_;
+    std::vector<bool> folded_;         // Emitted as part of its only user
+    std::vector<ValueId> shifted_;     // For an add: its operand folded as a shifted register
+    std::vector<uint32_t> position_;
+    std::vector<uint32_t> start_, end_;
+    std::vector<bool> crossesCall_;
+    std::vector<uint32_t> phiEnd_;     // For a phi: its last use, before the copies into it
+    std::vector<ValueId> hint_;        // A phi the value flows into
+    std::vector<Location> location_;
+
+    // Per block
+    std::vector<uint32_t> blockStart_, blockEnd_;
+
+    // Frame
+    bool hasFrame_ = false;
+    int frameSize_ = 0;
+    std::vector<uint32_t> calleeSaved_;
+    uint32_t spillSlots_ = 0;
+    std::vector<size_t> stringPoolIndex_;
+
+    std::vector<uint32_t> scratch_;    // Scratch registers taken by the instruction being emitted
+
+    // --- Analysis ---
+    void chooseFolds();
+    bool addressOffset(ValueId address, ValueId& base, int64_t& offset) const;
+    void collectOperands(ValueId value, std::vector<ValueId>& operands) const;
+    bool needsLocation(ValueId value) const;
+    void buildIntervals();
+    void allocateRegisters();
+    uint32_t sharedPhiRegister(ValueId value, const std::vector<uint8_t>& taken) const;
+    void planLayout();
+
+    // --- Emission ---
+    void emitPrologue();
+    void emitEpilogue();
+    void emitBlock(BlockId block);
+    void emitInstruction(ValueId value);
+    void emitBinary(ValueId value);
+    void emitCall(const IRInst& inst);
+    void emitBranch(BlockId block, const IRInst& inst);
+    void emitConditionalBranch(ValueId condition, bool branchIfTrue, AArch64Instructions::Label target);
+    void emitSwitch(BlockId block, const IRInst& inst);
+    void emitReturn(BlockId block, const IRInst& inst);
+    void emitJumpTo(BlockId from, BlockId to);
+    void emitPhiMoves(BlockId from, BlockId to);
+    void releaseFrame();
+    uint32_t emitCompare(const IRInst& relation);
+
+    // --- Values and registers ---
+    bool isConstant(ValueId value, int64_t& constant) const;
+    int slotOffset(uint32_t slot) const;
+    uint32_t acquireScratch();
+    void releaseScratch();
+    void materialize(uint32_t reg, ValueId value);
+    uint32_t operandRegister(ValueId value);
+    void moveInto(uint32_t reg, ValueId value);
+    uint32_t resultRegister(ValueId value);
+    void storeResult(ValueId value, uint32_t reg);
+    AArch64Instructions::Label label(BlockId block);
+};
+
+#endif // IR_SELECTOR_H
@@ -0,0 +1,281 @@
+#include "JITExecutor.h"
+#include "JitRuntime.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+// ldr x16, #8 ; br x16 ; .quad <address>
+const uint32_t VENEER_LDR_X16 = 0x58000050;
+const uint32_t VENEER_BR_X16 = 0xD61F0200;
+const size_t VENEER_SIZE = 16;
+const uint32_t NOP = 0xD503201F;
+
+// Entry trampoline: stp x29, x30, [sp, #-32]! ; mov x29, sp ; str x28, [sp, #16] ;
+// ldr x28, <globals> ; bl <entry> ; ldr x28, [sp, #16] ; ldp x29, x30, [sp], #32 ;
+// ret ; .quad <globals>
+const uint32_t TRAMPOLINE[] = {0xA9BE7BFD, 0x910003FD, 0xF9000BFC, 0x580000BC,
+                               0x94000000, 0xF9400BFC, 0xA8C27BFD, 0xD65F03C0};
+const size_t TRAMPOLINE_CALL = 16;
+const size_t TRAMPOLINE_SIZE = sizeof(TRAMPOLINE) + 8;
+const std::string STRING_LABEL_PREFIX = ".L.str";
+const std::string GLOBALS_LABEL = ".L.globals";
+
+bool isCallOrJump(uint32_t encoding) {
+    uint32_t opcode = encoding & 0xFC000000;
+    return opcode == 0x94000000 || opcode == 0x14000000; // BL / B
+}
+
+bool isAdr(uint32_t encoding) {
+    return (encoding & 0x9F000000) == 0x10000000;
+}
+
+// jmp qword ptr [rip + 0] ; .quad <address> ; padding to 16 bytes
+const uint8_t X86_VENEER_JMP[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+const uint8_t X86_INT3 = 0xCC;
+
+size_t stringIndex(const std::string& label, size_t poolSize) {
+    size_t index = std::stoul(label.substr(STRING_LABEL_PREFIX.size()));
+    if (index >= poolSize) {
+        throw std::runtime_error("JIT: unknown string literal '" + label + "'");
+    }
+    return index;
+}
+
+bool isStringLabel(const std::string& label) {
+    return label.rfind(STRING_LABEL_PREFIX, 0) == 0;
+}
+} // namespace
+
+void JITExecutor::patchWord(std::vector<uint8_t>& image, size_t offset, uint32_t word) {
+    image[offset] = static_cast<uint8_t>(word & 0xFF);
+    image[offset + 1] = static_cast<uint8_t>((word >> 8) & 0xFF);
+    image[offset + 2] = static_cast<uint8_t>((word >> 16) & 0xFF);
+    image[offset + 3] = static_cast<uint8_t>((word >> 24) & 0xFF);
+}
+
+uint32_t JITExecutor::readWord(const std::vector<uint8_t>& image, size_t offset) {
+    return static_cast<uint32_t>(image[offset]) |
+           (static_cast<uint32_t>(image[offset + 1]) << 8) |
+           (static_cast<uint32_t>(image[offset + 2]) << 16) |
+           (static_cast<uint32_t>(image[offset + 3]) << 24);
+}
+
+void JITExecutor::reset() {
+    if (memory_.isAllocated()) {
+        memory_.deallocate();
+    }
+    veneers_.clear();
+    globals_.clear();
+    entry_ = nullptr;
+    trampoline_ = nullptr;
+}
+
+std::vector<size_t> JITExecutor::appendStringPool(std::vector<uint8_t>& image,
+                                                  const std::vector<std::string>& stringPool) {
+    // BCPL strings use 32-bit characters and a zero terminator.
+    std::vector<size_t> offsets(stringPool.size());
+    for (size_t i = 0; i < stringPool.size(); ++i) {
+        offsets[i] = image.size();
+        const std::string& s = stringPool[i];
+        image.resize(image.size() + (s.size() + 1) * 4, 0);
+        for (size_t c = 0; c < s.size(); ++c) {
+            patchWord(image, offsets[i] + c * 4, static_cast<uint8_t>(s[c]));
+        }
+    }
+    return offsets;
+}
+
+void JITExecutor::install(const std::vector<uint8_t>& image, size_t entryOffset) {
+    imageSize_ = image.size();
+    uint8_t* region = static_cast<uint8_t*>(memory_.allocate(imageSize_));
+    std::memcpy(region, image.data(), imageSize_);
+    memory_.makeExecutable();
+    __builtin___clear_cache(reinterpret_cast<char*>(region), reinterpret_cast<char*>(region + imageSize_));
+
+    entry_ = region + entryOffset;
+}
+
+void* JITExecutor::load(const AArch64Instructions& instructions,
+                        const std::vector<std::string>& stringPool,
+                        size_t entryOffset,
+                        size_t globalCount) {
+    reset();
+    target_ = TargetArch::AArch64;
+
+    const auto& instrs = instructions.getInstructions();
+    codeSize_ = instrs.size() * 4;
+    if (entryOffset >= codeSize_) {
+        throw std::runtime_error("JIT: entry point lies outside the generated code");
+    }
+
+    std::vector<uint8_t> image(codeSize_);
+    instructions.encodeToBuffer(image.data(), image.size());
+    globals_.assign(std::max<size_t>(globalCount, 1), 0);
+
+    // Collect the runtime symbols referenced by unresolved calls.
+    const auto& symbols = JitRuntime::getInstance().getSymbolTable();
+    std::vector<std::pair<size_t, uintptr_t>> runtimeCalls;
+    std::vector<std::pair<size_t, size_t>> stringRefs;
+
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        const auto& instr = instrs[i];
+        if (!instr.needsLabelResolution) continue;
+
+        const std::string& target = instructions.labelName(instr.target);
+        if (isCallOrJump(instr.encoding)) {
+            auto it = symbols.find(target);
+            if (it == symbols.end()) {
+                throw std::runtime_error("JIT: unresolved call target '" + target + "'");
+            }
+            runtimeCalls.emplace_back(i * 4, it->second);
+        } else if (isAdr(instr.encoding) && isStringLabel(target)) {
+            stringRefs.emplace_back(i * 4, stringIndex(target, stringPool.size()));
+        } else {
+            throw std::runtime_error("JIT: unresolved label '" + target + "'");
+        }
+    }
+
+    // Veneers are 8-byte aligned so the literal address can be loaded with ldr.
+    while (image.size() % 8 != 0) {
+        image.resize(image.size() + 4);
+        patchWord(image, image.size() - 4, NOP);
+    }
+    for (const auto& call : runtimeCalls) {
+        if (veneers_.count(call.second)) continue;
+        size_t veneerOffset = image.size();
+        image.resize(image.size() + VENEER_SIZE);
+        patchWord(image, veneerOffset, VENEER_LDR_X16);
+        patchWord(image, veneerOffset + 4, VENEER_BR_X16);
+        uint64_t address = call.second;
+        std::memcpy(image.data() + veneerOffset + 8, &address, sizeof(address));
+        veneers_[call.second] = veneerOffset;
+    }
+    for (const auto& call : runtimeCalls) {
+        int64_t delta = static_cast<int64_t>(veneers_[call.second]) - static_cast<int64_t>(call.first);
+        if (delta < -(1 << 27) || delta >= (1 << 27)) {
+            throw std::runtime_error("JIT: runtime call veneer out of BL range");
+        }
+        uint32_t word = readWord(image, call.first) & 0xFC000000;
+        patchWord(image, call.first, word | ((delta / 4) & 0x03FFFFFF));
+    }
+
+    // The veneers leave the image 8-byte aligned for the trampoline's literal
+    const size_t trampolineOffset = image.size();
+    image.resize(image.size() + TRAMPOLINE_SIZE);
+    for (size_t i = 0; i < sizeof(TRAMPOLINE) / 4; ++i) {
+        patchWord(image, trampolineOffset + i * 4, TRAMPOLINE[i]);
+    }
+    int64_t entryDelta = static_cast<int64_t>(entryOffset) - static_cast<int64_t>(trampolineOffset + TRAMPOLINE_CALL);
+    patchWord(image, trampolineOffset + TRAMPOLINE_CALL, 0x94000000 | ((entryDelta / 4) & 0x03FFFFFF));
+    uint64_t globalsAddress = reinterpret_cast<uintptr_t>(globals_.data());
+    std::memcpy(image.data() + trampolineOffset + sizeof(TRAMPOLINE), &globalsAddress, sizeof(globalsAddress));
+
+    std::vector<size_t> stringOffsets = appendStringPool(image, stringPool);
+    for (const auto& ref : stringRefs) {
+        int64_t delta = static_cast<int64_t>(stringOffsets[ref.second]) - static_cast<int64_t>(ref.first);
+        if (delta < -(1 << 20) || delta >= (1 << 20)) {
+            throw std::runtime_error("JIT: string literal out of ADR range");
+        }
+        uint32_t word = readWord(image, ref.first) & 0x9F00001F;
+        word |= static_cast<uint32_t>(delta & 0x3) << 29;
+        word |= static_cast<uint32_t>((delta >> 2) & 0x7FFFF) << 5;
+        patchWord(image, ref.first, word);
+    }
+
+    install(image, entryOffset);
+    trampoline_ = static_cast<uint8_t*>(memory_.getMemoryPointer()) + trampolineOffset;
+    return entry_;
+}
+
+void* JITExecutor::load(const X86_64Instructions& instructions,
+                        const std::vector<std::string>& stringPool,
+                        size_t entryOffset,
+                        size_t globalCount) {
+    using Fixup = X86_64Instructions::Fixup;
+
+    reset();
+    target_ = TargetArch::X86_64;
+
+    codeSize_ = instructions.codeSize();
+    if (entryOffset >= codeSize_) {
+        throw std::runtime_error("JIT: entry point lies outside the generated code");
+    }
+
+    std::vector<uint8_t> image(codeSize_);
+    instructions.encodeToBuffer(image.data(), image.size());
+
+    // The global vector must stay writable, so it lives outside the W^X image.
+    globals_.assign(std::max<size_t>(globalCount, 1), 0);
+
+    const auto& symbols = JitRuntime::getInstance().getSymbolTable();
+    std::vector<std::pair<size_t, uintptr_t>> runtimeCalls; // rel32 field offset, target
+    std::vector<std::pair<size_t, size_t>> stringRefs;      // rel32 field offset, string index
+
+    for (const auto& instr : instructions.getInstructions()) {
+        if (!instr.needsLabelResolution) continue;
+        size_t field = instr.address + instr.fixupOffset;
+
+        if (instr.fixup == Fixup::Abs64 && instr.targetLabel == GLOBALS_LABEL) {
+            uint64_t address = reinterpret_cast<uintptr_t>(globals_.data());
+            std::memcpy(image.data() + field, &address, sizeof(address));
+        } else if (instr.fixup == Fixup::Rel32 && isStringLabel(instr.targetLabel)) {
+            stringRefs.emplace_back(field, stringIndex(instr.targetLabel, stringPool.size()));
+        } else if (instr.fixup == Fixup::Rel32) {
+            auto it = symbols.find(instr.targetLabel);
+            if (it == symbols.end()) {
+                throw std::runtime_error("JIT: unresolved call target '" + instr.targetLabel + "'");
+            }
+            runtimeCalls.emplace_back(field, it->second);
+        } else {
+            throw std::runtime_error("JIT: unresolved label '" + instr.targetLabel + "'");
+        }
+    }
+
+    // Rel32 displacements are relative to the end of the 4-byte field, which
+    // is the end of the instruction for every form the encoder emits.
+    auto patchRel32 = [&image](size_t field, size_t target) {
+        int64_t delta = static_cast<int64_t>(target) - static_cast<int64_t>(field + 4);
+        patchWord(image, field, static_cast<uint32_t>(static_cast<int32_t>(delta)));
+    };
+
+    while (image.size() % 16 != 0) {
+        image.push_back(X86_INT3);
+    }
+    for (const auto& call : runtimeCalls) {
+        if (veneers_.count(call.second)) continue;
+        size_t veneerOffset = image.size();
+        image.insert(image.end(), std::begin(X86_VENEER_JMP), std::end(X86_VENEER_JMP));
+        uint64_t address = call.second;
+        image.resize(image.size() + sizeof(address));
+        std::memcpy(image.data() + veneerOffset + sizeof(X86_VENEER_JMP), &address, sizeof(address));
+        image.resize(veneerOffset + VENEER_SIZE, X86_INT3);
+        veneers_[call.second] = veneerOffset;
+    }
+    for (const auto& call : runtimeCalls) {
+        patchRel32(call.first, veneers_[call.second]);
+    }
+
+    std::vector<size_t> stringOffsets = appendStringPool(image, stringPool);
+    for (const auto& ref : stringRefs) {
+        patchRel32(ref.first, stringOffsets[ref.second]);
+    }
+
+    install(image, entryOffset);
+    return entry_;
+}
+
+bool JITExecutor::isNativeHost(TargetArch target) {
+    return target == hostTarget();
+}
+
+int64_t JITExecutor::run() const {
+    if (!entry_) {
+        throw std::runtime_error("JIT: no program loaded");
+    }
+    if (!isNativeHost(target_)) {
+        throw std::runtime_error(std::string("JIT: native execution of ") + targetName(target_) +
+                                 " code requires a matching host");
+    }
+    return reinterpret_cast<EntryPoint>(getNativeEntryPoint())();
+}
@@ -0,0 +1,131 @@
+#ifndef JIT_EXECUTOR_H
+#define JIT_EXECUTOR_H
+
+#include "AArch64Instructions.h"
+#include "X86_64Instructions.h"
+#include "JITMemoryManager.h"
+#include "Target.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class JITExecutor
+ * @brief Links generated AArch64 or x86-64 code into executable memory and runs it.
+ *
+ * The executor takes the instruction stream produced by the CodeGenerator
+ * (after computeAddresses() and resolveAllBranches()) and builds a single
+ * image laid out as:
+ *
+ *   [ code ][ runtime veneers ][ string pool ]
+ *
+ * - Branches to labels inside the program are already resolved by the
+ *   instruction stream.
+ * - Calls (bl/b) to symbols registered in JitRuntime are routed through
+ *   a 16-byte veneer (ldr x16, #8; br x16; .quad address), so the runtime
+ *   may live anywhere in the address space.
+ * - ADR references to string pool labels (.L.strN) are patched to point at
+ *   BCPL strings (32-bit characters, zero terminated) appended after the code.
+ *
+ * - The global vector lives outside the image, since it must stay
+ *   writable. Generated code addresses it from x28, which is callee-saved
+ *   on the host, so native runs enter through a trampoline after the
+ *   veneers. It saves x28, loads the vector's address into it and calls
+ *   the entry function.
+ *
+ * The image is copied into a JITMemoryManager region, flipped to
+ * read+execute (W^X), and the instruction cache is flushed before the
+ * entry point is handed out.
+ *
+ * x86-64 images use the same layout. Runtime calls (call rel32) are routed
+ * through 16-byte veneers (jmp [rip]; .quad address), RIP-relative lea of
+ * .L.strN is patched to the string pool, and movabs of .L.globals receives
+ * the address of a writable global vector owned by the executor.
+ */
+class JITExecutor {
+public:
+    using EntryPoint = int64_t (*)();
+
+    JITExecutor() = default;
+
+    JITExecutor(const JITExecutor&) = delete;
+    JITExecutor& operator=(const JITExecutor&) = delete;
+
+    /**
+     * @brief Links and loads a program into executable memory.
+     * @param instructions The finalized instruction stream.
+     * @param stringPool String literals referenced as .L.str<index>.
+     * @param entryOffset Byte offset of the entry function within the code.
+     * @param globalCount Number of words to reserve for the global vector.
+     * @return Pointer to the entry point in executable memory. Code entered
+     * there directly, as the simulator does, needs x28 set to getGlobals().
+     * @throws std::runtime_error if a reference cannot be resolved.
+     */
+    void* load(const AArch64Instructions& instructions,
+               const std::vector<std::string>& stringPool,
+               size_t entryOffset,
+               size_t globalCount);
+
+    /**
+     * @brief Links and loads an x86-64 program into executable memory.
+     * @param instructions The finalized instruction stream.
+     * @param stringPool String literals referenced as .L.str<index>.
+     * @param entryOffset Byte offset of the entry function within the code.
+     * @param globalCount Number of words to reserve for the global vector.
+     * @return Pointer to the entry point in executable memory.
+     * @throws std::runtime_error if a reference cannot be resolved.
+     */
+    void* load(const X86_64Instructions& instructions,
+               const std::vector<std::string>& stringPool,
+               size_t entryOffset,
+               size_t globalCount);
+
+    /**
+     * @brief Calls the loaded entry point.
+     * @return The value returned by the entry function.
+     * @throws std::runtime_error if the host cannot execute the loaded code.
+     */
+    int64_t run() const;
+
+    /**
+     * @brief Returns true when code for the given target can be executed natively on this host.
+     */
+    static bool isNativeHost(TargetArch target = TargetArch::AArch64);
+
+    void* getEntryPoint() const { return entry_; }
+    void* getNativeEntryPoint() const { return trampoline_ ? trampoline_ : entry_; }
+    const uint8_t* getImage() const { return static_cast<const uint8_t*>(memory_.getMemoryPointer()); }
+    size_t getImageSize() const { return imageSize_; }
+    size_t getMappedSize() const { return memory_.getSize(); }  // The image rounded up to whole pages
+    size_t getCodeSize() const { return codeSize_; }
+    size_t getVeneerCount() const { return veneers_.size(); }
+    TargetArch getTarget() const { return target_; }
+    int64_t* getGlobals() { return globals_.data(); }
+
+    /**
+     * @brief Byte offset of the veneer for a runtime symbol, keyed by symbol address.
+     */
+    const std::unordered_map<uintptr_t, size_t>& getVeneers() const { return veneers_; }
+
+private:
+    JITMemoryManager memory_;
+    void* entry_ = nullptr;
+    void* trampoline_ = nullptr; // AArch64 only: sets x28 and calls entry_
+    size_t imageSize_ = 0;
+    size_t codeSize_ = 0;
+    std::unordered_map<uintptr_t, size_t> veneers_;
+    TargetArch target_ = TargetArch::AArch64;
+    std::vector<int64_t> globals_;
+
+    void reset();
+    static std::vector<size_t> appendStringPool(std::vector<uint8_t>& image,
+                                                const std::vector<std::string>& stringPool);
+    void install(const std::vector<uint8_t>& image, size_t entryOffset);
+
+    static void patchWord(std::vector<uint8_t>& image, size_t offset, uint32_t word);
+    static uint32_t readWord(const std::vector<uint8_t>& image, size_t offset);
+};
+
+#endif // JIT_EXECUTOR_H
@@ -1,6 +1,8 @@
 #include "JitRuntime.h"
 #include <stdexcept>
 #include <cstring>
+#include <cctype>
+#include <cstdio>
 
 // Private Constructor: Initialize runtime context and I/O streams
 JitRuntime::JitRuntime() : currentInputStream(stdin), currentOutputStream(stdout) {
@@ -94,13 +96,15 @@ void bcpl_endread(JitRuntime* rt) {
 void bcpl_endwrite(JitRuntime* rt) {    if (rt->currentOutputStream && rt->currentOutputStream != stdout) {        rt->getContext()->c_fclose(rt->currentOutputStream);        rt->currentOutputStream = stdout;    }}void bcpl_writes(JitRuntime* rt, const uint32_t* s) {    for (size_t i = 0; s[i] != 0; ++i) {        rt->getContext()->c_wrch(s[i], rt->currentOutputStream);    }}void bcpl_writen(JitRuntime* rt, int64_t n) {    fprintf(rt->currentOutputStream, "%lld", n);}void bcpl_newline(JitRuntime* rt) { fputc('\n', rt->currentOutputStream); }void bcpl_finish(JitRuntime* rt) {    rt->getContext()->c_exit(0);}void bcpl_stop(int n) {    exit(n);}
 
 uintptr_t bcpl_vec(int size_in_words) {
+    // VEC n has elements 0 to n, so one more word than its upper bound
+    const size_t bytes = (static_cast<size_t>(size_in_words) + 1) * sizeof(int64_t);
     // Allocate memory for the vector (64-bit aligned)
-    void* mem = aligned_alloc(8, size_in_words * sizeof(int64_t));
+    void* mem = aligned_alloc(8, bytes);
     if (!mem) {
         throw std::runtime_error("Failed to allocate vector");
     }
     // Initialize to zero
-    memset(mem, 0, size_in_words * sizeof(int64_t));
+    memset(mem, 0, bytes);
     return reinterpret_cast<uintptr_t>(mem);
 }
 
@@ -120,6 +124,68 @@ uintptr_t bcpl_unpack_string(const char* utf8_str) {
     return reinterpret_cast<uintptr_t>(wide_str);
 }
 
+// JIT entry points
+void bcpl_jit_writes(const uint32_t* s) {
+    bcpl_writes(&JitRuntime::getInstance(), s);
+}
+
+void bcpl_jit_writen(int64_t n) {
+    bcpl_writen(&JitRuntime::getInstance(), n);
+}
+
+void bcpl_jit_newline() {
+    bcpl_newline(&JitRuntime::getInstance());
+}
+
+void bcpl_jit_finish() {
+    fflush(JitRuntime::getInstance().currentOutputStream);
+    bcpl_finish(&JitRuntime::getInstance());
+}
+
+void bcpl_jit_writef(const uint32_t* format, int64_t a1, int64_t a2, int64_t a3, int64_t a4, int64_t a5) {
+    JitRuntime& rt = JitRuntime::getInstance();
+    FILE* out = rt.currentOutputStream;
+    const int64_t values[] = {a1, a2, a3, a4, a5};
+    size_t next = 0;
+    for (size_t i = 0; format[i] != 0; ++i) {
+        if (format[i] != '%' || format[i + 1] == 0) {
+            rt.getContext()->c_wrch(format[i], out);
+            continue;
+        }
+        uint32_t spec = format[++i];
+        if (spec == '%') {
+            rt.getContext()->c_wrch('%', out);
+            continue;
+        }
+        spec = static_cast<uint32_t>(toupper(static_cast<int>(spec)));
+        int width = 0;
+        if (format[i + 1] >= '0' && format[i + 1] <= '9') {
+            width = static_cast<int>(format[++i] - '0');
+        }
+        const int64_t value = next < 5 ? values[next++] : 0;
+        switch (spec) {
+            case 'N':
+            case 'I':
+            case 'D':
+                fprintf(out, "%*lld", width, static_cast<long long>(value));
+                break;
+            case 'X':
+                fprintf(out, "%0*llX", width, static_cast<unsigned long long>(value));
+                break;
+            case 'C':
+                rt.getContext()->c_wrch(static_cast<uint32_t>(value), out);
+                break;
+            case 'S':
+                bcpl_writes(&rt, reinterpret_cast<const uint32_t*>(value));
+                break;
+            default:
+                rt.getContext()->c_wrch('%', out);
+                rt.getContext()->c_wrch(format[i], out);
+                break;
+        }
+    }
+}
+
 // Floating point operations
 double bcpl_float(int64_t n) {
     return static_cast<double>(n);
@@ -129,6 +129,16 @@ extern "C" {
     uintptr_t bcpl_vec(int size_in_words);
     uintptr_t bcpl_unpack_string(const char* utf8_str);
 
+    // JIT entry points: BCPL calling convention (arguments in x0-x7, no runtime pointer).
+    // These are the addresses registered for the names the code generator calls.
+    void bcpl_jit_writes(const uint32_t* s);
+    void bcpl_jit_writen(int64_t n);
+    void bcpl_jit_newline();
+    void bcpl_jit_finish();
+    // %N/%I/%D decimal, %X hex (each with an optional width digit), %C, %S and %%;
+    // up to five values, the most the SysV argument registers carry after the format
+    void bcpl_jit_writef(const uint32_t* format, int64_t a1, int64_t a2, int64_t a3, int64_t a4, int64_t a5);
+
     // Floating Point Conversions (as per BCPL float extension.md)
     double bcpl_float(int64_t n);
     int64_t bcpl_trunc(double f);
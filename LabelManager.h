@@ -1,15 +1,21 @@
 #ifndef LABEL_MANAGER_H
 #define LABEL_MANAGER_H
 
-#include <string>
-#include <unordered_map>
+#include "AArch64Instructions.h"
 #include <vector>
 #include <stdexcept>
-#include <mutex>
-#include <optional>
 
+/**
+ * Tracks the nested BCPL scopes of the function being generated and the
+ * labels their control flow needs. Labels are handles into the label table
+ * of the instruction buffer, so creating one costs no string work; they are
+ * bound with AArch64Instructions::setPendingLabel() and resolved by
+ * AArch64Instructions::resolveAllBranches().
+ */
 class LabelManager {
 public:
+    using Label = AArch64Instructions::Label;
+
     // BCPL-specific scope types
     enum class ScopeType {
         FUNCTION,     // For functions and routines
@@ -21,49 +27,31 @@ public:
 
     struct Scope {
         ScopeType type;
-        std::string endLabel;        // General end of scope
-        std::string resultisLabel;   // For VALOF RESULTIS
-        std::string repeatLabel;     // For REPEAT, REPEATWHILE, REPEATUNTIL
-        std::string endcaseLabel;    // For SWITCHON ENDCASE
-        std::unordered_map<std::string, size_t> localLabels;
-    };
-
-    struct Fixup {
-        size_t instructionAddress;
-        std::string labelName;
+        Label endLabel;        // General end of scope
+        Label resultisLabel;   // For VALOF RESULTIS
+        Label repeatLabel;     // For REPEAT, REPEATWHILE, REPEATUNTIL
+        Label endcaseLabel;    // For SWITCHON ENDCASE
     };
 
-    LabelManager() : label_counter_(0) {}
+    explicit LabelManager(AArch64Instructions& instructions) : instructions_(instructions) {}
 
     // Scope management
     void pushScope(ScopeType type);
     void popScope();
 
-    // Label generation and management
-    std::string generateLabel(const std::string& prefix);
-
-    void defineLabel(const std::string& label, size_t position);
-    void requestLabelFixup(const std::string& label, size_t instructionAddress);
-    std::vector<Fixup> getFixups();
+    // Label generation; @p prefix names the label in listings and must be a string literal
+    Label generateLabel(const char* prefix) { return instructions_.newLabel(prefix); }
 
     // BCPL-specific control flow label accessors
-    std::string getCurrentResultisLabel() const;
-    std::string getCurrentRepeatLabel() const;
-    std::string getCurrentEndcaseLabel() const;
-    std::string getCurrentEndLabel() const;
-    std::string getCurrentReturnLabel() const;
-
-    // Label resolution
-    std::optional<size_t> getLabelPosition(const std::string& label) const;
-    size_t getLabelAddress(const std::string& label) const;
+    Label getCurrentResultisLabel() const;
+    Label getCurrentRepeatLabel() const;
+    Label getCurrentEndcaseLabel() const;
+    Label getCurrentEndLabel() const;
+    Label getCurrentReturnLabel() const;
 
 private:
-    size_t label_counter_;
+    AArch64Instructions& instructions_;
     std::vector<Scope> scope_stack_;
-    std::unordered_map<std::string, size_t> global_labels_;
-    std::vector<Fixup> fixups_;
-
-    mutable std::mutex label_mutex_; // For thread safety
 };
 
-#endif // LABEL_MANAGER_H
\ No newline at end of file
+#endif // LABEL_MANAGER_H
@@ -1,10 +1,39 @@
 #include "Lexer.h"
-#include <unordered_map>
 #include <cctype>
+#include <charconv>
+#include <cstring>
 #include <stdexcept>
 
-// A map to associate BCPL keywords with their corresponding token types.
-const std::unordered_map<std::string, TokenType> keywords = {
+// SIMD block scanning needs the GCC/Clang bit builtins
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define LEXER_SIMD_AVX2 1
+#define LEXER_SIMD 1
+constexpr size_t BLOCK_BYTES = 32;
+constexpr unsigned BYTE_BITS = 1;
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define LEXER_SIMD_SSE2 1
+#define LEXER_SIMD 1
+constexpr size_t BLOCK_BYTES = 16;
+constexpr unsigned BYTE_BITS = 1;
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LEXER_SIMD_NEON 1
+#define LEXER_SIMD 1
+constexpr size_t BLOCK_BYTES = 16;
+constexpr unsigned BYTE_BITS = 4; // Narrowing shift leaves a nibble per byte
+#endif // Otherwise scan() is scalar only
+
+namespace {
+
+// Keywords, including the operators that are spelled as identifiers
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword KEYWORDS[] = {
     {"LET", TokenType::KwLet}, {"AND", TokenType::KwAnd}, {"BE", TokenType::KwBe},
     {"VEC", TokenType::KwVec}, {"IF", TokenType::KwIf}, {"THEN", TokenType::KwThen},
     {"UNLESS", TokenType::KwUnless}, {"TEST", TokenType::KwTest}, {"OR", TokenType::KwOr},
@@ -23,8 +52,220 @@ const std::unordered_map<std::string, TokenType> keywords = {
     {"REM", TokenType::OpRemainder}, {"EQV", TokenType::OpLogEqv}, {"NEQV", TokenType::OpLogNeqv}
 };
 
+constexpr size_t KEYWORD_SLOTS = 128;
+constexpr size_t KEYWORD_MIN_LENGTH = 2;
+constexpr size_t KEYWORD_MAX_LENGTH = 11;
+
+// Collision-free over KEYWORDS; the multipliers were found by search
+constexpr size_t keywordHash(std::string_view text) {
+    return (static_cast<unsigned char>(text[0]) + static_cast<unsigned char>(text[1]) * 13u +
+            static_cast<unsigned char>(text[text.size() - 1]) * 12u + text.size() * 7u) & (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable {
+    int8_t slots[KEYWORD_SLOTS]; // Index into KEYWORDS, or -1
+};
+
+// Built at compile time; a keyword that collides or falls outside the length
+// bounds makes this fail to compile, and the multipliers must be searched again
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table{};
+    for (size_t i = 0; i < KEYWORD_SLOTS; ++i) {
+        table.slots[i] = -1;
+    }
+    for (size_t i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); ++i) {
+        const std::string_view text = KEYWORDS[i].text;
+        if (text.size() < KEYWORD_MIN_LENGTH || text.size() > KEYWORD_MAX_LENGTH) {
+            throw std::logic_error("keyword length outside the hashed range");
+        }
+        const size_t slot = keywordHash(text);
+        if (table.slots[slot] != -1) {
+            throw std::logic_error("keyword hash collision");
+        }
+        table.slots[slot] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+
+// One probe and one comparison; returns Identifier for anything else
+TokenType keywordType(std::string_view text) {
+    if (text.size() < KEYWORD_MIN_LENGTH || text.size() > KEYWORD_MAX_LENGTH) {
+        return TokenType::Identifier;
+    }
+    const int8_t index = KEYWORD_TABLE.slots[keywordHash(text)];
+    if (index < 0 || KEYWORDS[index].text != text) {
+        return TokenType::Identifier;
+    }
+    return KEYWORDS[index].type;
+}
+
+// --- Block scanning ---
+//
+// scan() classifies a block of bytes at once: each SIMD path produces a mask
+// of the bytes that end the run and a mask of the newlines, with BYTE_BITS
+// mask bits per byte. The run ends at the first stop byte, and newlines up to
+// it are counted with popcount. The last partial block is scanned a byte at a
+// time, so reads never go past the end of the source.
+
+// The scalar definition of each class, used for the tail and as the fallback
+bool endsRun(char c, Lexer::CharClass cls) {
+    switch (cls) {
+        case Lexer::CharClass::Whitespace: return !(c == ' ' || (c >= '\t' && c <= '\r'));
+        case Lexer::CharClass::Identifier: return !(isalnum(static_cast<unsigned char>(c)) || c == '_');
+        case Lexer::CharClass::LineComment: return c == '\n' || c == '\0';
+        case Lexer::CharClass::BlockComment: return c == '*' || c == '\0';
+        case Lexer::CharClass::StringBody: return c == '"' || c == '*' || c == '\0';
+    }
+    return true;
+}
+
+
+#ifdef LEXER_SIMD
+// Whitespace and identifiers are matched by what they are, other runs by what ends them
+bool matchesClass(Lexer::CharClass cls) {
+    return cls == Lexer::CharClass::Whitespace || cls == Lexer::CharClass::Identifier;
+}
+#endif
+
+#if defined(LEXER_SIMD_AVX2)
+
+uint64_t blockMasks(const char* p, Lexer::CharClass cls, uint64_t& newlines) {
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto eq = [&](char v) { return _mm256_cmpeq_epi8(c, _mm256_set1_epi8(v)); };
+    auto between = [](__m256i x, char lo, char hi) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), x));
+    };
+    __m256i match;
+    switch (cls) {
+        case Lexer::CharClass::Whitespace: match = _mm256_or_si256(eq(' '), between(c, '\t', '\r')); break;
+        case Lexer::CharClass::Identifier: {
+            const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            match = _mm256_or_si256(_mm256_or_si256(between(lower, 'a', 'z'), between(c, '0', '9')), eq('_'));
+            break;
+        }
+        case Lexer::CharClass::LineComment: match = _mm256_or_si256(eq('\n'), eq('\0')); break;
+        case Lexer::CharClass::BlockComment: match = _mm256_or_si256(eq('*'), eq('\0')); break;
+        default: match = _mm256_or_si256(_mm256_or_si256(eq('"'), eq('*')), eq('\0')); break; // StringBody
+    }
+    newlines = static_cast<uint32_t>(_mm256_movemask_epi8(eq('\n')));
+    const uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+    return matchesClass(cls) ? ~mask & 0xFFFFFFFFu : mask;
+}
+
+#elif defined(LEXER_SIMD_SSE2)
+
+uint64_t blockMasks(const char* p, Lexer::CharClass cls, uint64_t& newlines) {
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto eq = [&](char v) { return _mm_cmpeq_epi8(c, _mm_set1_epi8(v)); };
+    auto between = [](__m128i x, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                             _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(hi + 1))));
+    };
+    __m128i match;
+    switch (cls) {
+        case Lexer::CharClass::Whitespace: match = _mm_or_si128(eq(' '), between(c, '\t', '\r')); break;
+        case Lexer::CharClass::Identifier: {
+            const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+            match = _mm_or_si128(_mm_or_si128(between(lower, 'a', 'z'), between(c, '0', '9')), eq('_'));
+            break;
+        }
+        case Lexer::CharClass::LineComment: match = _mm_or_si128(eq('\n'), eq('\0')); break;
+        case Lexer::CharClass::BlockComment: match = _mm_or_si128(eq('*'), eq('\0')); break;
+        default: match = _mm_or_si128(_mm_or_si128(eq('"'), eq('*')), eq('\0')); break; // StringBody
+    }
+    newlines = static_cast<uint32_t>(_mm_movemask_epi8(eq('\n')));
+    const uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+    return matchesClass(cls) ? ~mask & 0xFFFFu : mask;
+}
+
+#elif defined(LEXER_SIMD_NEON)
+
+// NEON has no movemask; narrowing each 16-bit lane by 4 keeps one nibble per byte
+uint64_t nibbleMask(uint8x16_t bytes) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4)), 0);
+}
+
+uint64_t blockMasks(const char* p, Lexer::CharClass cls, uint64_t& newlines) {
+    const uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    auto eq = [&](char v) { return vceqq_u8(c, vdupq_n_u8(static_cast<uint8_t>(v))); };
+    auto between = [](uint8x16_t x, char lo, char hi) {
+        return vandq_u8(vcgeq_u8(x, vdupq_n_u8(static_cast<uint8_t>(lo))), vcleq_u8(x, vdupq_n_u8(static_cast<uint8_t>(hi))));
+    };
+    uint8x16_t match;
+    switch (cls) {
+        case Lexer::CharClass::Whitespace: match = vorrq_u8(eq(' '), between(c, '\t', '\r')); break;
+        case Lexer::CharClass::Identifier: {
+            const uint8x16_t lower = vorrq_u8(c, vdupq_n_u8(0x20));
+            match = vorrq_u8(vorrq_u8(between(lower, 'a', 'z'), between(c, '0', '9')), eq('_'));
+            break;
+        }
+        case Lexer::CharClass::LineComment: match = vorrq_u8(eq('\n'), eq('\0')); break;
+        case Lexer::CharClass::BlockComment: match = vorrq_u8(eq('*'), eq('\0')); break;
+        default: match = vorrq_u8(vorrq_u8(eq('"'), eq('*')), eq('\0')); break; // StringBody
+    }
+    newlines = nibbleMask(eq('\n'));
+    const uint64_t mask = nibbleMask(match);
+    return matchesClass(cls) ? ~mask : mask;
+}
+
+#endif
+
+} // namespace
+
+// A run of bytes of one class starting at the current position
+struct Lexer::Run {
+    size_t length = 0;
+    uint32_t newlines = 0;
+    size_t lastNewline = 0; // Offset of the last newline in the run, when there is one
+};
+
+Lexer::Run Lexer::scan(CharClass cls) const {
+    const char* begin = source_code.data() + pos;
+    const size_t available = source_code.size() - pos;
+    Run run;
 
-void Lexer::init(const std::string& source) {
+#ifdef LEXER_SIMD
+    while (available - run.length >= BLOCK_BYTES) {
+        uint64_t newlines;
+        const uint64_t stop = blockMasks(begin + run.length, cls, newlines);
+        const size_t length = stop ? __builtin_ctzll(stop) / BYTE_BITS : BLOCK_BYTES;
+        const unsigned bits = static_cast<unsigned>(length * BYTE_BITS);
+        newlines &= bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        if (newlines) {
+            run.newlines += static_cast<uint32_t>(__builtin_popcountll(newlines) / BYTE_BITS);
+            run.lastNewline = run.length + (63 - __builtin_clzll(newlines)) / BYTE_BITS;
+        }
+        run.length += length;
+        if (length < BLOCK_BYTES) {
+            return run;
+        }
+    }
+#endif
+
+    while (run.length < available && !endsRun(begin[run.length], cls)) {
+        if (begin[run.length] == '\n') {
+            ++run.newlines;
+            run.lastNewline = run.length;
+        }
+        ++run.length;
+    }
+    return run;
+}
+
+void Lexer::consume(const Run& run) {
+    pos += run.length;
+    if (run.newlines) {
+        current_line += run.newlines;
+        current_col = static_cast<uint32_t>(run.length - run.lastNewline);
+    } else {
+        current_col += static_cast<uint32_t>(run.length);
+    }
+}
+
+void Lexer::init(std::string_view source) {
     source_code = source;
     pos = 0;
     current_line = 1;
@@ -55,24 +296,24 @@ char Lexer::advance() {
 }
 
 void Lexer::skipWhitespace() {
-    while (isspace(peek())) {
-        advance();
-    }
+    consume(scan(CharClass::Whitespace));
 }
 
 void Lexer::skipComments() {
     while (true) {
         if (peek() == '/' && peekNext() == '/') {
             // Single line comment
-            while (peek() != '\n' && peek() != '\0') {
-                advance();
-            }
+            consume(scan(CharClass::LineComment));
         } else if (peek() == '/' && peekNext() == '*') {
             // Multi-line comment
             advance(); // Consume '/'
             advance(); // Consume '*'
-            while (peek() != '\0' && (peek() != '*' || peekNext() != '/')) {
-                advance();
+            while (true) {
+                consume(scan(CharClass::BlockComment)); // Up to the next '*'
+                if (peek() == '\0' || peekNext() == '/') {
+                    break;
+                }
+                advance(); // A '*' that does not close the comment
             }
             if (peek() != '\0') {
                 advance(); // Consume '*'
@@ -85,36 +326,45 @@ void Lexer::skipComments() {
     }
 }
 
+Token Lexer::makeToken(TokenType type, size_t start, uint32_t start_col) const {
+    Token token;
+    token.type = type;
+    token.text = source_code.substr(start, pos - start);
+    token.line = current_line;
+    token.col = start_col;
+    return token;
+}
+
 Token Lexer::identifierOrKeyword() {
-    std::string text;
+    size_t start = pos;
     uint32_t start_col = current_col;
-    while (isalnum(peek()) || peek() == '_') {
-        text += advance();
-    }
+    consume(scan(CharClass::Identifier));
 
     // Check if the identifier is a keyword
-    auto it = keywords.find(text);
-    if (it != keywords.end()) {
-        return {it->second, text, 0, 0.0, current_line, start_col};
+    Token token = makeToken(TokenType::Identifier, start, start_col);
+    token.type = keywordType(token.text);
+    if (token.type == TokenType::Identifier) {
+        token.symbol = SymbolTable::getInstance().intern(token.text);
     }
-
-    return {TokenType::Identifier, text, 0, 0.0, current_line, start_col};
+    return token;
 }
 
 Token Lexer::number() {
-    std::string text;
+    size_t start = pos;
     uint32_t start_col = current_col;
     bool is_float = false;
     int base = 10;
+    size_t digits = pos;
 
     if (peek() == '#') {
-        text += advance();
+        advance();
         if (toupper(peek()) == 'X') {
-            text += advance();
+            advance();
             base = 16;
         } else {
             base = 8;
         }
+        digits = pos;
     }
 
     while (isalnum(peek()) || peek() == '.') {
@@ -122,156 +372,180 @@ Token Lexer::number() {
         if (c == '.') {
             if (is_float) break; // Can't have two decimal points
             is_float = true;
-            text += advance();
+            advance();
         } else if (toupper(c) == 'E' && is_float) {
             // Scientific notation part
-            text += advance();
+            advance();
             if (peek() == '+' || peek() == '-') {
-                text += advance();
+                advance();
             }
         } else if ((base == 10 && isdigit(c)) ||
                    (base == 8 && c >= '0' && c <= '7') ||
                    (base == 16 && isxdigit(c))) {
-            text += advance();
+            advance();
         } else {
             break;
         }
     }
-    
-    // Determine if it was a float literal based on presence of '.' or 'e'/'E'
-    is_float = (text.find('.') != std::string::npos || 
-                text.find('e') != std::string::npos ||
-                text.find('E') != std::string::npos);
 
+    // Values are converted in place; the digits are never copied out of the source
+    Token token = makeToken(is_float ? TokenType::FloatLiteral : TokenType::IntegerLiteral, start, start_col);
+    const char* first = source_code.data() + digits;
+    const char* last = source_code.data() + pos;
+    std::from_chars_result result;
     if (is_float) {
-        return {TokenType::FloatLiteral, text, 0, std::stod(text), current_line, start_col};
+        result = std::from_chars(first, last, token.float_val);
     } else {
-        std::string num_part = text;
-        if (base != 10) num_part = text.substr(1);
-        if (base == 16) num_part = text.substr(2);
-        return {TokenType::IntegerLiteral, text, std::stoll(num_part, nullptr, base), 0.0, current_line, start_col};
+        result = std::from_chars(first, last, token.int_val, base);
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("Lexer Error (line " + std::to_string(current_line) + "): number out of range: " +
+                                std::string(token.text));
     }
+    if (result.ec != std::errc()) {
+        throw std::invalid_argument("Lexer Error (line " + std::to_string(current_line) + "): malformed number: " +
+                                    std::string(token.text));
+    }
+    return token;
 }
 
 Token Lexer::stringLiteral() {
-    std::string text;
     uint32_t start_col = current_col;
     advance(); // Consume opening "
-    while (peek() != '"' && peek() != '\0') {
-        if (peek() == '*') { // Handle escape sequences
-            advance(); // consume '*'
-            char escaped = advance();
-            switch (tolower(escaped)) {
-                case 'n': text += '\n'; break;
-                case 't': text += '\t'; break;
-                case 's': text += ' '; break;
-                case 'b': text += '\b'; break;
-                case 'p': text += '\f'; break;
-                case 'c': text += '\r'; break;
-                case '"': text += '"'; break;
-                case '*': text += '*'; break;
-                default: text += escaped; // As per spec, unknown escapes are the char itself
-            }
-        } else {
-            text += advance();
+    size_t start = pos;
+    while (true) {
+        consume(scan(CharClass::StringBody));
+        if (peek() != '*') {
+            break; // Closing quote or end of input
         }
+        advance(); // Skip escape sequences; unescape() decodes them
+        advance();
     }
+    Token token = makeToken(TokenType::StringLiteral, start, start_col);
     advance(); // Consume closing "
-    return {TokenType::StringLiteral, text, 0, 0.0, current_line, start_col};
+    return token;
+}
+
+std::string Lexer::unescape(std::string_view text) {
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '*' || i + 1 == text.size()) {
+            result += text[i];
+            continue;
+        }
+        char escaped = text[++i];
+        switch (tolower(escaped)) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 's': result += ' '; break;
+            case 'b': result += '\b'; break;
+            case 'p': result += '\f'; break;
+            case 'c': result += '\r'; break;
+            case '"': result += '"'; break;
+            case '*': result += '*'; break;
+            default: result += escaped; // As per spec, unknown escapes are the char itself
+        }
+    }
+    return result;
 }
 
 Token Lexer::charLiteral() {
     uint32_t start_col = current_col;
     advance(); // Consume opening '
+    size_t start = pos;
     int64_t val = (int64_t)advance(); // Read the character
     if (peek() != '\'') {
       // Handle error, for now we assume valid syntax
     }
+    Token token = makeToken(TokenType::CharLiteral, start, start_col);
+    token.int_val = val;
     advance(); // Consume closing '
-    return {TokenType::CharLiteral, std::string(1, (char)val), val, 0.0, current_line, start_col};
+    return token;
 }
 
 Token Lexer::operatorOrDelimiter() {
+    size_t start = pos;
     uint32_t start_col = current_col;
     char c = advance();
     switch (c) {
-        case '(': return {TokenType::LParen, "(", 0, 0.0, current_line, start_col};
-        case ')': return {TokenType::RParen, ")", 0, 0.0, current_line, start_col};
-        case '{': return {TokenType::LBrace, "{", 0, 0.0, current_line, start_col};
-        case '}': return {TokenType::RBrace, "}", 0, 0.0, current_line, start_col};
-        case ',': return {TokenType::Comma, ",", 0, 0.0, current_line, start_col};
-        case ';': return {TokenType::Semicolon, ";", 0, 0.0, current_line, start_col};
-        case '!': return {TokenType::OpBang, "!", 0, 0.0, current_line, start_col};
-        case '@': return {TokenType::OpAt, "@", 0, 0.0, current_line, start_col};
-        case '&': return {TokenType::OpLogAnd, "&", 0, 0.0, current_line, start_col};
-        case '|': return {TokenType::OpLogOr, "|", 0, 0.0, current_line, start_col};
-        case '%': return {TokenType::OpCharSub, "%", 0, 0.0, current_line, start_col};
+        case '(': return makeToken(TokenType::LParen, start, start_col);
+        case ')': return makeToken(TokenType::RParen, start, start_col);
+        case '{': return makeToken(TokenType::LBrace, start, start_col);
+        case '}': return makeToken(TokenType::RBrace, start, start_col);
+        case ',': return makeToken(TokenType::Comma, start, start_col);
+        case ';': return makeToken(TokenType::Semicolon, start, start_col);
+        case '!': return makeToken(TokenType::OpBang, start, start_col);
+        case '@': return makeToken(TokenType::OpAt, start, start_col);
+        case '&': return makeToken(TokenType::OpLogAnd, start, start_col);
+        case '|': return makeToken(TokenType::OpLogOr, start, start_col);
+        case '%': return makeToken(TokenType::OpCharSub, start, start_col);
 
         case '+':
-            if (peek() == '.') { advance(); return {TokenType::OpFloatPlus, "+.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpPlus, "+", 0, 0.0, current_line, start_col};
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatPlus, start, start_col); }
+            return makeToken(TokenType::OpPlus, start, start_col);
         case '*':
-            if (peek() == '.') { advance(); return {TokenType::OpFloatMultiply, "*.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpMultiply, "*", 0, 0.0, current_line, start_col};
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatMultiply, start, start_col); }
+            return makeToken(TokenType::OpMultiply, start, start_col);
         case '/':
-            if (peek() == '.') { advance(); return {TokenType::OpFloatDivide, "/.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpDivide, "/", 0, 0.0, current_line, start_col};
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatDivide, start, start_col); }
+            return makeToken(TokenType::OpDivide, start, start_col);
 
         case '-':
-            if (peek() == '>') { advance(); return {TokenType::OpConditional, "->", 0, 0.0, current_line, start_col}; }
-            if (peek() == '.') { advance(); return {TokenType::OpFloatMinus, "-.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpMinus, "-", 0, 0.0, current_line, start_col};
+            if (peek() == '>') { advance(); return makeToken(TokenType::OpConditional, start, start_col); }
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatMinus, start, start_col); }
+            return makeToken(TokenType::OpMinus, start, start_col);
 
         case ':':
-            if (peek() == '=') { advance(); return {TokenType::OpAssign, ":=", 0, 0.0, current_line, start_col}; }
-            return {TokenType::Colon, ":", 0, 0.0, current_line, start_col};
+            if (peek() == '=') { advance(); return makeToken(TokenType::OpAssign, start, start_col); }
+            return makeToken(TokenType::Colon, start, start_col);
             
         case '~':
             if (peek() == '=') {
                 advance();
-                if (peek() == '.') { advance(); return {TokenType::OpFloatNe, "~=.", 0, 0.0, current_line, start_col}; }
-                return {TokenType::OpNe, "~=", 0, 0.0, current_line, start_col};
+                if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatNe, start, start_col); }
+                return makeToken(TokenType::OpNe, start, start_col);
             }
-            return {TokenType::OpLogNot, "~", 0, 0.0, current_line, start_col};
+            return makeToken(TokenType::OpLogNot, start, start_col);
             
         case '=':
-            if (peek() == '.') { advance(); return {TokenType::OpFloatEq, "=.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpEq, "=", 0, 0.0, current_line, start_col};
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatEq, start, start_col); }
+            return makeToken(TokenType::OpEq, start, start_col);
         
         case '<':
             if (peek() == '=') {
                 advance();
-                if (peek() == '.') { advance(); return {TokenType::OpFloatLe, "<=.", 0, 0.0, current_line, start_col}; }
-                return {TokenType::OpLe, "<=", 0, 0.0, current_line, start_col};
+                if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatLe, start, start_col); }
+                return makeToken(TokenType::OpLe, start, start_col);
             }
-            if (peek() == '<') { advance(); return {TokenType::OpLshift, "<<", 0, 0.0, current_line, start_col}; }
-            if (peek() == '.') { advance(); return {TokenType::OpFloatLt, "<.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpLt, "<", 0, 0.0, current_line, start_col};
+            if (peek() == '<') { advance(); return makeToken(TokenType::OpLshift, start, start_col); }
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatLt, start, start_col); }
+            return makeToken(TokenType::OpLt, start, start_col);
             
         case '>':
             if (peek() == '=') {
                 advance();
-                if (peek() == '.') { advance(); return {TokenType::OpFloatGe, ">=.", 0, 0.0, current_line, start_col}; }
-                return {TokenType::OpGe, ">=", 0, 0.0, current_line, start_col};
+                if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatGe, start, start_col); }
+                return makeToken(TokenType::OpGe, start, start_col);
             }
-            if (peek() == '>') { advance(); return {TokenType::OpRshift, ">>", 0, 0.0, current_line, start_col}; }
-            if (peek() == '.') { advance(); return {TokenType::OpFloatGt, ">.", 0, 0.0, current_line, start_col}; }
-            return {TokenType::OpGt, ">", 0, 0.0, current_line, start_col};
+            if (peek() == '>') { advance(); return makeToken(TokenType::OpRshift, start, start_col); }
+            if (peek() == '.') { advance(); return makeToken(TokenType::OpFloatGt, start, start_col); }
+            return makeToken(TokenType::OpGt, start, start_col);
 
         case '.':
-            if (peek() == '%') { advance(); return {TokenType::OpFloatVecSub, ".%", 0, 0.0, current_line, start_col}; }
+            if (peek() == '%') { advance(); return makeToken(TokenType::OpFloatVecSub, start, start_col); }
             // Fallthrough for '.' that might start a number like .5
             // This is handled by the number() function logic, so we shouldn't get here
             // unless it's an invalid use of '.'
-            return {TokenType::Illegal, ".", 0, 0.0, current_line, start_col};
+            return makeToken(TokenType::Illegal, start, start_col);
 
         case '$':
-            if (peek() == '(') { advance(); return {TokenType::LSection, "$(", 0, 0.0, current_line, start_col}; }
-            if (peek() == ')') { advance(); return {TokenType::RSection, "$)", 0, 0.0, current_line, start_col}; }
-            return {TokenType::Illegal, "$", 0, 0.0, current_line, start_col};
+            if (peek() == '(') { advance(); return makeToken(TokenType::LSection, start, start_col); }
+            if (peek() == ')') { advance(); return makeToken(TokenType::RSection, start, start_col); }
+            return makeToken(TokenType::Illegal, start, start_col);
 
         default:
-            return {TokenType::Illegal, std::string(1, c), 0, 0.0, current_line, start_col};
+            return makeToken(TokenType::Illegal, start, start_col);
     }
 }
 
@@ -281,7 +555,7 @@ Token Lexer::getNextToken() {
     skipComments();
 
     if (pos >= source_code.length()) {
-        return {TokenType::Eof, "", 0, 0.0, current_line, current_col};
+        return makeToken(TokenType::Eof, pos, current_col);
     }
 
     char current_char = peek();
@@ -302,6 +576,71 @@ Token Lexer::getNextToken() {
     return operatorOrDelimiter();
 }
 
+TokenStream Lexer::tokenize(std::string_view source) {
+    if (source.size() > UINT32_MAX) {
+        throw std::runtime_error("Lexer Error: source larger than 4GB");
+    }
+    init(source);
+    TokenStream stream;
+    stream.source_ = source;
+
+    // Roughly one token per six bytes of typical BCPL source
+    const size_t estimate = source.size() / 6 + 1;
+    stream.types_.reserve(estimate);
+    stream.offsets_.reserve(estimate);
+    stream.lengths_.reserve(estimate);
+    stream.values_.reserve(estimate);
+    stream.lines_.reserve(estimate);
+    stream.cols_.reserve(estimate);
+
+    Token token;
+    do {
+        token = getNextToken();
+        stream.push(token);
+    } while (token.type != TokenType::Eof);
+    return stream;
+}
+
+void TokenStream::push(const Token& token) {
+    types_.push_back(token.type);
+    offsets_.push_back(static_cast<uint32_t>(token.text.data() - source_.data()));
+    lengths_.push_back(static_cast<uint32_t>(token.text.size()));
+    int64_t value = token.int_val;
+    if (token.type == TokenType::FloatLiteral) {
+        std::memcpy(&value, &token.float_val, sizeof(value));
+    } else if (token.type == TokenType::Identifier) {
+        value = token.symbol;
+    }
+    values_.push_back(value);
+    lines_.push_back(token.line);
+    cols_.push_back(token.col);
+}
+
+double TokenStream::floatValue(size_t i) const {
+    if (types_[i] != TokenType::FloatLiteral) {
+        return 0.0;
+    }
+    double value;
+    std::memcpy(&value, &values_[i], sizeof(value));
+    return value;
+}
+
+SymbolId TokenStream::symbol(size_t i) const {
+    return types_[i] == TokenType::Identifier ? static_cast<SymbolId>(values_[i]) : SymbolTable::NoSymbol;
+}
+
+Token TokenStream::at(size_t i) const {
+    Token token;
+    token.type = types_[i];
+    token.text = text(i);
+    token.int_val = types_[i] == TokenType::Identifier || types_[i] == TokenType::FloatLiteral ? 0 : values_[i];
+    token.float_val = floatValue(i);
+    token.symbol = symbol(i);
+    token.line = lines_[i];
+    token.col = cols_[i];
+    return token;
+}
+
 std::string Token::tokenTypeToString(TokenType type) {
     switch (type) {
         case TokenType::Eof: return "Eof";
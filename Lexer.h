@@ -1,7 +1,9 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "SymbolTable.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
@@ -84,25 +86,80 @@ enum class TokenType {
     Illegal         // Represents an unrecognized token
 };
 
-// Represents a single token scanned from the source code.
+/**
+ * @brief A single token scanned from the source code.
+ *
+ * Tokens own no memory: text is a view into the source buffer the lexer was
+ * initialised with, which must outlive them. For string literals the view
+ * covers the characters between the quotes with their escapes still in place;
+ * Lexer::unescape() decodes them. Character literals carry their value in
+ * int_val, and identifiers their interned name in symbol.
+ */
 struct Token {
-    TokenType type;
-    std::string text;      // The actual text of the token (e.g., "myvar", "123")
-    int64_t int_val;       // For integer literals
-    double float_val;      // For floating-point literals
-    uint32_t line;         // Line number for error reporting
-    uint32_t col;          // Column number for error reporting
+    TokenType type = TokenType::Eof;
+    std::string_view text; // The source text of the token (e.g., "myvar", "123")
+    int64_t int_val = 0;   // For integer and character literals
+    double float_val = 0;  // For floating-point literals
+    SymbolId symbol = SymbolTable::NoSymbol; // For identifiers
+    uint32_t line = 1;     // Line number for error reporting
+    uint32_t col = 1;      // Column number for error reporting
 
     static std::string tokenTypeToString(TokenType type);
 };
 
+/**
+ * @class TokenStream
+ * @brief Every token of a source buffer, stored as parallel arrays.
+ *
+ * Lexer::tokenize() fills the stream in one tight loop before parsing starts;
+ * the parser then indexes into it, so lookahead is free and the lexer's state
+ * is not shared with the parser. Token i is described by the i-th entry of
+ * each array, and text is recovered from the source by offset and length.
+ * The last token is always Eof. Like Token, the stream views its source,
+ * which must outlive it.
+ */
+class TokenStream {
+public:
+    size_t size() const { return types_.size(); }
+
+    TokenType type(size_t i) const { return types_[i]; }
+    std::string_view text(size_t i) const { return source_.substr(offsets_[i], lengths_[i]); }
+    int64_t intValue(size_t i) const { return values_[i]; }
+    double floatValue(size_t i) const;
+    SymbolId symbol(size_t i) const;
+    uint32_t line(size_t i) const { return lines_[i]; }
+    uint32_t col(size_t i) const { return cols_[i]; }
+
+    /// Token i assembled from the arrays.
+    Token at(size_t i) const;
+
+private:
+    friend class Lexer;
+    void push(const Token& token);
+
+    std::string_view source_;
+    std::vector<TokenType> types_;
+    std::vector<uint32_t> offsets_;  // Of the token text within source_
+    std::vector<uint32_t> lengths_;
+    std::vector<int64_t> values_;    // Integer/character value, bits of a float, or an identifier's symbol
+    std::vector<uint32_t> lines_;
+    std::vector<uint32_t> cols_;
+};
+
 /**
  * @class Lexer
  * @brief A singleton class that performs lexical analysis on BCPL source code.
  *
- * The Lexer scans the input string and converts it into a sequence of tokens
+ * The Lexer scans the input text and converts it into a sequence of tokens
  * according to the BCPL language specification. It handles identifiers,
  * keywords, literals (integer, float, string, char), operators, and comments.
+ *
+ * The source is not copied: the lexer scans the caller's buffer (usually a
+ * memory-mapped SourceBuffer) and tokens refer back into it, so lexing makes
+ * no heap allocations. Whitespace, comment bodies, string bodies and
+ * identifiers are skipped 16 or 32 bytes at a time with SSE2/AVX2 or NEON
+ * where available, and keywords are recognised with a perfect hash. Every
+ * other identifier is interned in the SymbolTable as it is scanned.
  */
 class Lexer {
 public:
@@ -117,10 +174,11 @@ public:
     Lexer& operator=(const Lexer&) = delete;
 
     /**
-     * @brief Initializes the lexer with a new source code string.
-     * @param source The BCPL source code to be tokenized.
+     * @brief Initializes the lexer with a new source buffer.
+     * @param source The BCPL source code to be tokenized; it is not copied
+     * and must outlive the lexer's use of it and every token produced.
      */
-    void init(const std::string& source);
+    void init(std::string_view source);
 
     /**
      * @brief Scans and returns the next token from the source code.
@@ -128,11 +186,31 @@ public:
      */
     Token getNextToken();
 
+    /**
+     * @brief Scans the whole of @p source into a TokenStream.
+     * Leaves the lexer positioned at the end of @p source.
+     */
+    TokenStream tokenize(std::string_view source);
+
+    /**
+     * @brief Decodes the *-escapes (*n, *t, *s, *b, *p, *c, *", **) of the
+     * text of a string literal token.
+     */
+    static std::string unescape(std::string_view text);
+
+    /// Runs of characters the lexer skips a whole SIMD block at a time.
+    enum class CharClass { Whitespace, Identifier, LineComment, BlockComment, StringBody };
+
 private:
     Lexer() = default;
 
+    struct Run;
+    Run scan(CharClass cls) const;
+    void consume(const Run& run);
+
     void skipWhitespace();
     void skipComments();
+    Token makeToken(TokenType type, size_t start, uint32_t start_col) const;
     Token identifierOrKeyword();
     Token number();
     Token stringLiteral();
@@ -142,7 +220,7 @@ private:
     char peekNext() const;
     char advance();
 
-    std::string source_code;
+    std::string_view source_code;
     size_t pos = 0;
     uint32_t current_line = 1;
     uint32_t current_col = 1;
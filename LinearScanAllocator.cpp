@@ -0,0 +1,393 @@
+#include "LinearScanAllocator.h"
+#include "LoopOptimizer.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Loop depth beyond which the spill weight stops growing
+const int MaxWeightedDepth = 6;
+
+/**
+ * Walks a function body in code generation order, numbering variable
+ * references and calls, and records loop extents for the live-out fix-up.
+ */
+class IntervalBuilder {
+public:
+    explicit IntervalBuilder(const LinearScanAllocator::LocalFilter& isLocal) : isLocal_(isLocal) {}
+
+    void build(const FunctionDeclaration* function) {
+        SymbolTable& symbols = SymbolTable::getInstance();
+        for (const auto& param : function->params) {
+            reference(symbols.intern(param));
+        }
+        if (function->body_expr) {
+            visitExpression(function->body_expr.get());
+        } else if (function->body_stmt) {
+            visitNode(function->body_stmt.get());
+        }
+        extendAcrossLoops();
+        markCalls();
+    }
+
+    void scan(const Expression* expr) { visitExpression(expr); }
+
+    bool hasCalls() const { return !calls_.empty(); }
+
+    std::vector<LiveInterval> takeIntervals() { return std::move(intervals_); }
+
+private:
+    const LinearScanAllocator::LocalFilter& isLocal_;
+    std::vector<LiveInterval> intervals_;
+    SymbolMap<size_t> index_;
+    std::vector<int> calls_;
+    std::vector<std::pair<int, int>> loops_; // Innermost loops first
+    int point_ = 0;
+    int depth_ = 0;
+    bool hasGoto_ = false;
+
+    bool isLocal(SymbolId symbol) const { return !isLocal_ || isLocal_(symbol); }
+
+    LiveInterval* reference(SymbolId symbol) {
+        if (!isLocal(symbol)) {
+            return nullptr;
+        }
+        if (index_.insert(symbol, intervals_.size())) {
+            intervals_.push_back(LiveInterval{symbol});
+            intervals_.back().start = point_;
+        }
+        LiveInterval& interval = intervals_[*index_.find(symbol)];
+        interval.end = point_++;
+        double weight = 1.0;
+        for (int i = 0; i < std::min(depth_, MaxWeightedDepth); ++i) {
+            weight *= 10.0;
+        }
+        interval.spillWeight += weight;
+        return &interval;
+    }
+
+    void call() { calls_.push_back(point_++); }
+
+    void beginLoop(int& start) {
+        start = point_;
+        ++depth_;
+    }
+
+    void endLoop(int start) {
+        --depth_;
+        loops_.push_back({start, point_++});
+    }
+
+    void visitNode(const Node* node) {
+        if (!node) {
+            return;
+        }
+        if (auto expr = nodeCast<Expression>(node)) {
+            visitExpression(expr);
+        } else if (auto let = nodeCast<LetDeclaration>(node)) {
+            for (const auto& init : let->initializers) {
+                if (init.init) {
+                    visitExpression(init.init.get());
+                    reference(SymbolTable::getInstance().intern(init.name));
+                }
+            }
+        } else if (auto stmt = nodeCast<Statement>(node)) {
+            visitStatement(stmt);
+        }
+        // Nested function, global and manifest declarations own no locals here
+    }
+
+    void visitStatement(const Statement* node) {
+        if (auto compound = nodeCast<CompoundStatement>(node)) {
+            for (const auto& stmt : compound->statements) {
+                visitNode(stmt.get());
+            }
+        } else if (auto assign = nodeCast<Assignment>(node)) {
+            for (const auto& rhs : assign->rhs) {
+                visitExpression(rhs.get());
+            }
+            for (const auto& lhs : assign->lhs) {
+                if (auto var = nodeCast<VariableAccess>(lhs.get())) {
+                    reference(var->symbol);
+                } else {
+                    visitExpression(lhs.get());
+                }
+            }
+        } else if (auto routine = nodeCast<RoutineCall>(node)) {
+            visitExpression(routine->call_expression.get());
+        } else if (auto ifStmt = nodeCast<IfStatement>(node)) {
+            visitExpression(ifStmt->condition.get());
+            visitNode(ifStmt->then_statement.get());
+        } else if (auto testStmt = nodeCast<TestStatement>(node)) {
+            visitExpression(testStmt->condition.get());
+            visitNode(testStmt->then_statement.get());
+            visitNode(testStmt->else_statement.get());
+        } else if (auto whileStmt = nodeCast<WhileStatement>(node)) {
+            int start;
+            beginLoop(start);
+            visitNode(whileStmt->body.get());
+            visitExpression(whileStmt->condition.get()); // Tested at the bottom
+            endLoop(start);
+        } else if (auto repeatStmt = nodeCast<RepeatStatement>(node)) {
+            int start;
+            beginLoop(start);
+            visitNode(repeatStmt->body.get());
+            if (repeatStmt->condition) {
+                visitExpression(repeatStmt->condition.get());
+            }
+            endLoop(start);
+        } else if (auto forStmt = nodeCast<ForStatement>(node)) {
+            visitFor(forStmt);
+        } else if (auto switchStmt = nodeCast<SwitchonStatement>(node)) {
+            visitExpression(switchStmt->expression.get());
+            for (const auto& c : switchStmt->cases) {
+                visitNode(c.statement.get());
+            }
+            visitNode(switchStmt->default_case.get());
+        } else if (auto labeled = nodeCast<LabeledStatement>(node)) {
+            hasGoto_ = true;
+            visitNode(labeled->statement.get());
+        } else if (nodeCast<GotoStatement>(node)) {
+            hasGoto_ = true;
+        } else if (auto resultis = nodeCast<ResultisStatement>(node)) {
+            visitExpression(resultis->value.get());
+        } else if (auto declStmt = nodeCast<DeclarationStatement>(node)) {
+            visitNode(declStmt->declaration.get());
+        }
+    }
+
+    void visitFor(const ForStatement* node) {
+        const SymbolId var = SymbolTable::getInstance().intern(node->var_name);
+        visitExpression(node->from_expr.get());
+        reference(var);
+        visitExpression(node->to_expr.get());
+        const SymbolId limit = LinearScanAllocator::forLimitSymbol(node);
+        reference(limit);
+        int64_t step;
+        bool constantStep = LoopOptimizer::constantForStep(node, step);
+        SymbolId stepSymbol = SymbolTable::NoSymbol;
+        if (!constantStep) {
+            stepSymbol = LinearScanAllocator::forStepSymbol(node);
+            visitExpression(node->by_expr.get());
+            reference(stepSymbol);
+        }
+
+        int start;
+        beginLoop(start);
+        reference(var); // Loop test
+        reference(limit);
+        visitNode(node->body.get());
+        if (!constantStep) {
+            reference(stepSymbol);
+        }
+        reference(var); // Increment
+        endLoop(start);
+    }
+
+    void visitExpression(const Expression* node) {
+        if (!node) {
+            return;
+        }
+        if (auto var = nodeCast<VariableAccess>(node)) {
+            reference(var->symbol);
+        } else if (auto unary = nodeCast<UnaryOp>(node)) {
+            if (unary->op == TokenType::OpAt) {
+                if (auto var = nodeCast<VariableAccess>(unary->rhs.get())) {
+                    if (LiveInterval* interval = reference(var->symbol)) {
+                        interval->addressTaken = true;
+                    }
+                    return;
+                }
+            }
+            visitExpression(unary->rhs.get());
+        } else if (auto binary = nodeCast<BinaryOp>(node)) {
+            visitExpression(binary->left.get());
+            visitExpression(binary->right.get());
+        } else if (auto funcCall = nodeCast<FunctionCall>(node)) {
+            for (auto it = funcCall->arguments.rbegin(); it != funcCall->arguments.rend(); ++it) {
+                visitExpression(it->get());
+            }
+            // Only direct calls are generated, so the callee name is never a local
+            if (!nodeCast<VariableAccess>(funcCall->function.get())) {
+                visitExpression(funcCall->function.get());
+            }
+            call();
+        } else if (auto cond = nodeCast<ConditionalExpression>(node)) {
+            visitExpression(cond->condition.get());
+            visitExpression(cond->trueExpr.get());
+            visitExpression(cond->falseExpr.get());
+        } else if (auto valof = nodeCast<Valof>(node)) {
+            visitNode(valof->body.get());
+        } else if (auto vec = nodeCast<VectorConstructor>(node)) {
+            visitExpression(vec->size.get());
+            call(); // bcpl_vec
+        } else if (auto deref = nodeCast<DereferenceExpr>(node)) {
+            visitExpression(deref->pointer.get());
+        } else if (auto vecAccess = nodeCast<VectorAccess>(node)) {
+            visitExpression(vecAccess->index.get());
+            visitExpression(vecAccess->vector.get());
+        } else if (auto charAccess = nodeCast<CharacterAccess>(node)) {
+            visitExpression(charAccess->index.get());
+            visitExpression(charAccess->string.get());
+        }
+    }
+
+    // A value live on entry to a loop and referenced inside it must survive
+    // every iteration, so its interval is stretched to the loop end.
+    void extendAcrossLoops() {
+        if (hasGoto_) {
+            // Arbitrary jumps: treat the whole function as one loop
+            loops_.push_back({0, point_});
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto& loop : loops_) {
+                for (auto& interval : intervals_) {
+                    if (interval.start < loop.first && interval.end >= loop.first && interval.end < loop.second) {
+                        interval.end = loop.second;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    void markCalls() {
+        for (auto& interval : intervals_) {
+            auto it = std::upper_bound(calls_.begin(), calls_.end(), interval.start);
+            interval.crossesCall = it != calls_.end() && *it < interval.end;
+        }
+    }
+};
+
+} // namespace
+
+LinearScanAllocator::LinearScanAllocator(LocalFilter isLocal) : isLocal_(std::move(isLocal)) {
+}
+
+const std::vector<uint32_t>& LinearScanAllocator::calleeSavedPool() {
+    static const std::vector<uint32_t> pool = {19, 20, 21, 22, 23, 24, 25, 26, 27};
+    return pool;
+}
+
+const std::vector<uint32_t>& LinearScanAllocator::callerSavedPool() {
+    static const std::vector<uint32_t> pool = {8, 16, 17};
+    return pool;
+}
+
+SymbolId LinearScanAllocator::forLimitSymbol(const ForStatement* node) {
+    std::ostringstream name;
+    name << node->var_name << ".limit@" << static_cast<const void*>(node);
+    return SymbolTable::getInstance().intern(name.str());
+}
+
+SymbolId LinearScanAllocator::forStepSymbol(const ForStatement* node) {
+    std::ostringstream name;
+    name << node->var_name << ".step@" << static_cast<const void*>(node);
+    return SymbolTable::getInstance().intern(name.str());
+}
+
+bool LinearScanAllocator::containsCall(const Expression* expr) {
+    LocalFilter none;
+    IntervalBuilder builder(none);
+    builder.scan(expr);
+    return builder.hasCalls();
+}
+
+LinearScanAllocator::Allocation LinearScanAllocator::allocate(const FunctionDeclaration* function) {
+    IntervalBuilder builder(isLocal_);
+    builder.build(function);
+
+    Allocation allocation;
+    allocation.intervals = builder.takeIntervals();
+    std::stable_sort(allocation.intervals.begin(), allocation.intervals.end(),
+                     [](const LiveInterval& a, const LiveInterval& b) { return a.start < b.start; });
+    linearScan(allocation.intervals);
+
+    std::vector<bool> calleeUsed(32, false);
+    for (const auto& interval : allocation.intervals) {
+        ++stats_.intervals;
+        if (interval.isSpilled()) {
+            ++stats_.spilled;
+            continue;
+        }
+        ++stats_.allocated;
+        allocation.registers[interval.symbol] = interval.reg;
+        calleeUsed[interval.reg] = true;
+    }
+    for (uint32_t reg : calleeSavedPool()) {
+        if (calleeUsed[reg]) {
+            allocation.calleeSavedUsed.push_back(reg);
+        }
+    }
+    stats_.calleeSavedUsed += allocation.calleeSavedUsed.size();
+    return allocation;
+}
+
+void LinearScanAllocator::linearScan(std::vector<LiveInterval>& intervals) const {
+    std::vector<LiveInterval*> active; // Sorted by increasing end point
+    std::vector<bool> busy(32, false);
+
+    auto freeRegister = [&](const std::vector<uint32_t>& pool) -> uint32_t {
+        for (uint32_t reg : pool) {
+            if (!busy[reg]) {
+                return reg;
+            }
+        }
+        return NoRegister;
+    };
+    auto isCalleeSaved = [](uint32_t reg) { return reg >= 19 && reg <= 27; };
+    auto activate = [&](LiveInterval* interval) {
+        busy[interval->reg] = true;
+        auto pos = std::upper_bound(active.begin(), active.end(), interval,
+                                    [](const LiveInterval* a, const LiveInterval* b) { return a->end < b->end; });
+        active.insert(pos, interval);
+    };
+
+    for (auto& current : intervals) {
+        // Expire intervals that ended before this one starts
+        while (!active.empty() && active.front()->end < current.start) {
+            busy[active.front()->reg] = false;
+            active.erase(active.begin());
+        }
+
+        if (current.addressTaken) {
+            continue;
+        }
+
+        // Short intervals that see no call prefer the caller-saved registers,
+        // which need no prologue save; everything else needs a callee-saved one.
+        uint32_t reg = NoRegister;
+        if (!current.crossesCall) {
+            reg = freeRegister(callerSavedPool());
+        }
+        if (reg == NoRegister) {
+            reg = freeRegister(calleeSavedPool());
+        }
+        if (reg != NoRegister) {
+            current.reg = reg;
+            activate(&current);
+            continue;
+        }
+
+        // No register left: spill the cheapest usable candidate
+        auto victim = active.end();
+        for (auto it = active.begin(); it != active.end(); ++it) {
+            if (current.crossesCall && !isCalleeSaved((*it)->reg)) {
+                continue;
+            }
+            if (victim == active.end() || (*it)->spillWeight < (*victim)->spillWeight) {
+                victim = it;
+            }
+        }
+        if (victim == active.end() || (*victim)->spillWeight >= current.spillWeight) {
+            continue; // The current interval is the cheapest; it stays in memory
+        }
+        LiveInterval* evicted = *victim;
+        active.erase(victim);
+        current.reg = evicted->reg;
+        evicted->reg = NoRegister;
+        activate(&current);
+    }
+}
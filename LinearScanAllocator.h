@@ -0,0 +1,105 @@
+// LinearScanAllocator.h
+#ifndef LINEAR_SCAN_ALLOCATOR_H
+#define LINEAR_SCAN_ALLOCATOR_H
+
+#include "AST.h"
+#include "SymbolTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The live range of one local variable of a function.
+ *
+ * Program points number every variable reference and every call in the order
+ * the code generator emits them. A variable that is referenced inside a loop
+ * and live on entry to it is kept live up to the end of the loop, so the
+ * interval also covers the back edge.
+ */
+struct LiveInterval {
+    SymbolId symbol = SymbolTable::NoSymbol;
+    int start = -1;            // First program point (definition or use)
+    int end = -1;              // Last program point the value must survive to
+    double spillWeight = 0.0;  // Sum of 10^loopDepth over all references
+    bool crossesCall = false;  // A call lies strictly inside [start, end]
+    bool addressTaken = false; // @name is used, so the value must live in memory
+    uint32_t reg = 0xFFFFFFFF; // Assigned register, or 0xFFFFFFFF when spilled
+
+    bool isSpilled() const { return reg == 0xFFFFFFFF; }
+};
+
+/**
+ * @class LinearScanAllocator
+ * @brief Assigns registers to the locals of a function from their live intervals.
+ *
+ * Intervals are built by walking the function body once. Registers come from
+ * two pools: callee-saved x19-x27, which survive calls but must be saved in
+ * the prologue, and the caller-saved x8, x16 and x17, which the code
+ * generator never uses for temporaries and which are only clobbered by the
+ * call sequence itself. x0-x7 carry arguments and results and x9-x15 belong
+ * to the ScratchAllocator, so neither is handed out.
+ *
+ * Intervals are visited in order of their start point. When no register is
+ * free, the live interval with the lowest spill weight (the current one or
+ * an active one) is kept in its stack slot for the whole function.
+ */
+class LinearScanAllocator {
+public:
+    static constexpr uint32_t NoRegister = 0xFFFFFFFF;
+
+    /// Returns true when a name refers to a local (not a global, manifest or function).
+    using LocalFilter = std::function<bool(SymbolId)>;
+
+    struct Allocation {
+        SymbolMap<uint32_t> registers;                        // Locals held in registers
+        std::vector<uint32_t> calleeSavedUsed;                // To save in the prologue
+        std::vector<LiveInterval> intervals;                  // In order of start point
+    };
+
+    struct Statistics {
+        size_t intervals = 0;
+        size_t allocated = 0;
+        size_t spilled = 0;
+        size_t calleeSavedUsed = 0;
+
+        Statistics& operator+=(const Statistics& other) {
+            intervals += other.intervals;
+            allocated += other.allocated;
+            spilled += other.spilled;
+            calleeSavedUsed += other.calleeSavedUsed;
+            return *this;
+        }
+    };
+
+    explicit LinearScanAllocator(LocalFilter isLocal = nullptr);
+
+    /**
+     * @brief Computes live intervals for @p function and assigns registers.
+     */
+    Allocation allocate(const FunctionDeclaration* function);
+
+    /// Totals over every function allocated by this instance.
+    const Statistics& getStatistics() const { return stats_; }
+
+    /// Symbol of the hidden local holding the limit of a FOR loop.
+    static SymbolId forLimitSymbol(const ForStatement* node);
+
+    /// Symbol of the hidden local holding a FOR step that is not a constant.
+    static SymbolId forStepSymbol(const ForStatement* node);
+
+    /// Returns true when evaluating @p expr makes a call (so scratch registers die).
+    static bool containsCall(const Expression* expr);
+
+    static const std::vector<uint32_t>& calleeSavedPool();
+    static const std::vector<uint32_t>& callerSavedPool();
+
+private:
+    LocalFilter isLocal_;
+    Statistics stats_;
+
+    void linearScan(std::vector<LiveInterval>& intervals) const;
+};
+
+#endif // LINEAR_SCAN_ALLOCATOR_H
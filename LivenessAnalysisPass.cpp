@@ -1,222 +1,494 @@
 #include "LivenessAnalysisPass.h"
-#include "VariableVisitor.h"
-#include "ExpressionLivenessVisitor.h"
-#include "CFGBuilder.h" // Include CFGBuilder
-#include "Utils.h" // Include common utility functions
-#include <algorithm> // For std::set_union, std::set_difference
-#include <iostream> // For debugging
-#include <vector>
-#include <set>
-#include <map>
+#include "CFGBuilder.h"
+#include <algorithm>
+#include <deque>
 
-std::string LivenessAnalysisPass::getName() const {
-    return "Liveness Analysis Pass";
+namespace {
+
+// Calls fn on each direct child of node. Bodies of nested functions are not
+// children: they cannot see the enclosing function's locals.
+template <typename Fn>
+void forEachChild(const Node* node, Fn&& fn) {
+    switch (node->kind()) {
+        case NodeKind::UnaryOp:
+            fn(static_cast<const UnaryOp*>(node)->rhs.get());
+            break;
+        case NodeKind::BinaryOp: {
+            auto* binary = static_cast<const BinaryOp*>(node);
+            fn(binary->left.get());
+            fn(binary->right.get());
+            break;
+        }
+        case NodeKind::FunctionCall: {
+            auto* call = static_cast<const FunctionCall*>(node);
+            fn(call->function.get());
+            for (const auto& arg : call->arguments) fn(arg.get());
+            break;
+        }
+        case NodeKind::ConditionalExpression: {
+            auto* cond = static_cast<const ConditionalExpression*>(node);
+            fn(cond->condition.get());
+            fn(cond->trueExpr.get());
+            fn(cond->falseExpr.get());
+            break;
+        }
+        case NodeKind::VectorConstructor:
+            fn(static_cast<const VectorConstructor*>(node)->size.get());
+            break;
+        case NodeKind::Valof:
+            fn(static_cast<const Valof*>(node)->body.get());
+            break;
+        case NodeKind::DereferenceExpr:
+            fn(static_cast<const DereferenceExpr*>(node)->pointer.get());
+            break;
+        case NodeKind::VectorAccess: {
+            auto* access = static_cast<const VectorAccess*>(node);
+            fn(access->vector.get());
+            fn(access->index.get());
+            break;
+        }
+        case NodeKind::CharacterAccess: {
+            auto* access = static_cast<const CharacterAccess*>(node);
+            fn(access->string.get());
+            fn(access->index.get());
+            break;
+        }
+        case NodeKind::SwitchonStatement: {
+            auto* switchon = static_cast<const SwitchonStatement*>(node);
+            fn(switchon->expression.get());
+            for (const auto& scase : switchon->cases) fn(scase.statement.get());
+            fn(switchon->default_case.get());
+            break;
+        }
+        case NodeKind::RepeatStatement: {
+            auto* repeat = static_cast<const RepeatStatement*>(node);
+            fn(repeat->body.get());
+            fn(repeat->condition.get());
+            break;
+        }
+        case NodeKind::Assignment: {
+            auto* assign = static_cast<const Assignment*>(node);
+            for (const auto& expr : assign->lhs) fn(expr.get());
+            for (const auto& expr : assign->rhs) fn(expr.get());
+            break;
+        }
+        case NodeKind::RoutineCall:
+            fn(static_cast<const RoutineCall*>(node)->call_expression.get());
+            break;
+        case NodeKind::CompoundStatement:
+            for (const auto& stmt : static_cast<const CompoundStatement*>(node)->statements) fn(stmt.get());
+            break;
+        case NodeKind::IfStatement: {
+            auto* ifStmt = static_cast<const IfStatement*>(node);
+            fn(ifStmt->condition.get());
+            fn(ifStmt->then_statement.get());
+            break;
+        }
+        case NodeKind::TestStatement: {
+            auto* test = static_cast<const TestStatement*>(node);
+            fn(test->condition.get());
+            fn(test->then_statement.get());
+            fn(test->else_statement.get());
+            break;
+        }
+        case NodeKind::WhileStatement: {
+            auto* loop = static_cast<const WhileStatement*>(node);
+            fn(loop->condition.get());
+            fn(loop->body.get());
+            break;
+        }
+        case NodeKind::ForStatement: {
+            auto* loop = static_cast<const ForStatement*>(node);
+            fn(loop->from_expr.get());
+            fn(loop->to_expr.get());
+            fn(loop->by_expr.get());
+            fn(loop->body.get());
+            break;
+        }
+        case NodeKind::GotoStatement:
+            fn(static_cast<const GotoStatement*>(node)->label.get());
+            break;
+        case NodeKind::LabeledStatement:
+            fn(static_cast<const LabeledStatement*>(node)->statement.get());
+            break;
+        case NodeKind::DeclarationStatement:
+            fn(static_cast<const DeclarationStatement*>(node)->declaration.get());
+            break;
+        case NodeKind::ResultisStatement:
+            fn(static_cast<const ResultisStatement*>(node)->value.get());
+            break;
+        case NodeKind::LetDeclaration:
+            for (const auto& init : static_cast<const LetDeclaration*>(node)->initializers) fn(init.init.get());
+            break;
+        default:
+            // Leaves, operand-less jumps and declarations that bind no locals
+            break;
+    }
 }
 
-ProgramPtr LivenessAnalysisPass::apply(ProgramPtr program) {
-    std::cout << "\n=== Liveness Analysis Pass: Starting ===\n" << std::flush;
-    // Clear previous analysis results
-    liveInStatements.clear();
-    liveOutStatements.clear();
-    liveInExpressions.clear();
-    liveOutExpressions.clear();
-    liveInBlocks.clear();
-    liveOutBlocks.clear();
+// Calls fn with the symbol of every variable mentioned at or below node
+template <typename Fn>
+void forEachMention(const Node* node, Fn& fn) {
+    if (!node) return;
+    if (auto* var = nodeCast<VariableAccess>(node)) {
+        fn(var->symbol);
+        return;
+    }
+    if (auto* loop = nodeCast<ForStatement>(node)) {
+        fn(SymbolTable::getInstance().intern(loop->var_name));
+    }
+    forEachChild(node, [&fn](const Node* child) { forEachMention(child, fn); });
+}
 
-    CFGBuilder cfgBuilder;
-    // Build the CFG from the program. The CFGBuilder will populate its internal functionEntryBlocks map.
-    cfgBuilder.build(program); 
-    functionCFGs = cfgBuilder.getFunctionEntryBlocks(); // CRITICAL FIX: Populate functionCFGs
-
-    std::cout << "LivenessAnalysisPass: functionCFGs size: " << functionCFGs.size() << "\n" << std::flush;
-
-    // Perform iterative dataflow analysis on the CFG
-    bool changed = true;
-    int iteration = 0;
-    while (changed) {
-        changed = false;
-        iteration++;
-        std::cout << "\n--- Liveness Analysis Iteration " << iteration << " ---\n" << std::flush;
-
-        // Iterate over all functions
-        for (const auto& pair : functionCFGs) {
-            BasicBlock::Ptr entryBlock = pair.second;
-
-            // Collect all blocks in this function's CFG
-            std::vector<BasicBlock::Ptr> allBlocks;
-            std::set<BasicBlock::Ptr> visited;
-            std::vector<BasicBlock::Ptr> q;
-            q.push_back(entryBlock);
-            visited.insert(entryBlock);
-
-            while (!q.empty()) {
-                BasicBlock::Ptr current = q.back();
-                q.pop_back();
-                allBlocks.push_back(current);
-
-                for (const auto& succ : current->successors) {
-                    if (visited.find(succ) == visited.end()) {
-                        visited.insert(succ);
-                        q.push_back(succ);
+// The names a function binds, and the ones it must not treat as plain locals
+struct LocalCollector {
+    std::vector<SymbolId> declared; // In declaration order, repeats included
+    SymbolSet addressTaken;
+    SymbolSet nonLocal;             // GLOBAL, MANIFEST and function names declared inside
+
+    void declare(const std::string& name) { declared.push_back(SymbolTable::getInstance().intern(name)); }
+
+    void walk(const Node* node) {
+        if (!node) return;
+        SymbolTable& symbols = SymbolTable::getInstance();
+        switch (node->kind()) {
+            case NodeKind::UnaryOp: {
+                auto* unary = static_cast<const UnaryOp*>(node);
+                if (unary->op == TokenType::OpAt) {
+                    if (auto* var = nodeCast<VariableAccess>(unary->rhs.get())) {
+                        addressTaken.insert(var->symbol);
                     }
                 }
+                break;
             }
-
-            // Iterate over basic blocks in reverse topological order (or just reverse for simplicity for now)
-            // A proper reverse post-order traversal would be better for convergence.
-            std::reverse(allBlocks.begin(), allBlocks.end());
-
-            for (const auto& block : allBlocks) {
-                std::cout << "  Processing Block: " << block->toString() << "\n" << std::flush;
-                // Initialize live-in and live-out for this block if not already present
-                if (liveInBlocks.find(block.get()) == liveInBlocks.end()) {
-                    liveInBlocks[block.get()] = {};
+            case NodeKind::ForStatement:
+                declare(static_cast<const ForStatement*>(node)->var_name);
+                break;
+            case NodeKind::LetDeclaration:
+                for (const auto& init : static_cast<const LetDeclaration*>(node)->initializers) {
+                    declare(init.name);
+                }
+                break;
+            case NodeKind::GlobalDeclaration:
+                for (const auto& global : static_cast<const GlobalDeclaration*>(node)->globals) {
+                    nonLocal.insert(symbols.intern(global.name));
                 }
-                if (liveOutBlocks.find(block.get()) == liveOutBlocks.end()) {
-                    liveOutBlocks[block.get()] = {};
+                break;
+            case NodeKind::ManifestDeclaration:
+                for (const auto& manifest : static_cast<const ManifestDeclaration*>(node)->manifests) {
+                    nonLocal.insert(symbols.intern(manifest.name));
                 }
+                break;
+            case NodeKind::FunctionDeclaration:
+                nonLocal.insert(symbols.intern(static_cast<const FunctionDeclaration*>(node)->name));
+                break;
+            default:
+                break;
+        }
+        forEachChild(node, [this](const Node* child) { walk(child); });
+    }
+};
 
-                std::set<std::string> oldLiveIn = liveInBlocks[block.get()];
-                std::set<std::string> oldLiveOut = liveOutBlocks[block.get()];
+// Locals a statement reads before it writes them, and locals it overwrites.
+// A statement that heads a control construct contributes only the part it
+// evaluates itself; its bodies sit in blocks of their own.
+void statementEffects(const Statement* stmt, const SymbolMap<uint32_t>& index, BitVector& use, BitVector& def) {
+    auto mark = [&index](BitVector& bits) {
+        return [&index, &bits](SymbolId symbol) {
+            if (const uint32_t* i = index.find(symbol)) bits.set(*i);
+        };
+    };
+    auto markUse = mark(use);
+    auto usesIn = [&markUse](const Node* node) { forEachMention(node, markUse); };
 
-                // Compute Live-out[n] = Union (Live-in[s]) for all successors s of n
-                std::set<std::string> newLiveOut;
-                for (const auto& succ : block->successors) {
-                    newLiveOut = setUnion(newLiveOut, liveInBlocks[succ.get()]);
+    switch (stmt->kind()) {
+        case NodeKind::Assignment: {
+            auto* assign = static_cast<const Assignment*>(stmt);
+            for (const auto& expr : assign->rhs) usesIn(expr.get());
+            for (const auto& expr : assign->lhs) {
+                if (auto* var = nodeCast<VariableAccess>(expr.get())) {
+                    mark(def)(var->symbol);
+                } else {
+                    usesIn(expr.get());
                 }
-                liveOutBlocks[block.get()] = newLiveOut;
-
-                // Compute Live-in[n] = use[n] U (Live-out[n] - def[n])
-                // For basic blocks, use[n] is the union of used variables in the block
-                // and def[n] is the union of defined variables in the block.
-                // This needs to be computed by iterating through statements in the block.
-                std::set<std::string> blockUse;
-                std::set<std::string> blockDef;
-
-                // Iterate statements in reverse for use/def of a basic block
-                VariableVisitor visitor;
-                for (auto it = block->statements.rbegin(); it != block->statements.rend(); ++it) {
-                    visitor.clear();
-                    (*it)->accept(&visitor);
-                    std::set<std::string> stmtUse = visitor.getUsedVariables();
-                    std::set<std::string> stmtDef = visitor.getDefinedVariables();
-
-                    blockUse = setUnion(blockUse, setDifference(stmtUse, blockDef));
-                    blockDef = setUnion(blockDef, stmtDef);
+            }
+            break;
+        }
+        case NodeKind::DeclarationStatement: {
+            const Declaration* decl = static_cast<const DeclarationStatement*>(stmt)->declaration.get();
+            if (auto* let = nodeCast<LetDeclaration>(decl)) {
+                for (const auto& init : let->initializers) usesIn(init.init.get());
+                for (const auto& init : let->initializers) {
+                    mark(def)(SymbolTable::getInstance().intern(init.name));
                 }
+            }
+            break;
+        }
+        case NodeKind::IfStatement:
+            usesIn(static_cast<const IfStatement*>(stmt)->condition.get());
+            break;
+        case NodeKind::TestStatement:
+            usesIn(static_cast<const TestStatement*>(stmt)->condition.get());
+            break;
+        case NodeKind::WhileStatement:
+            usesIn(static_cast<const WhileStatement*>(stmt)->condition.get());
+            break;
+        case NodeKind::RepeatStatement:
+            usesIn(static_cast<const RepeatStatement*>(stmt)->condition.get());
+            break;
+        case NodeKind::SwitchonStatement:
+            usesIn(static_cast<const SwitchonStatement*>(stmt)->expression.get());
+            break;
+        case NodeKind::ForStatement: {
+            // The header both starts the loop and steps it, so the variable is
+            // used here rather than killed
+            auto* loop = static_cast<const ForStatement*>(stmt);
+            markUse(SymbolTable::getInstance().intern(loop->var_name));
+            usesIn(loop->from_expr.get());
+            usesIn(loop->to_expr.get());
+            usesIn(loop->by_expr.get());
+            break;
+        }
+        default:
+            usesIn(stmt);
+            break;
+    }
+}
 
-                liveInBlocks[block.get()] = setUnion(blockUse, setDifference(liveOutBlocks[block.get()], blockDef));
+} // namespace
+
+std::string LivenessAnalysisPass::getName() const {
+    return "Liveness Analysis Pass";
+}
 
-                printSet("  Block Use", blockUse);
-                printSet("  Block Def", blockDef);
-                printSet("  Block Live-In", liveInBlocks[block.get()]);
-                printSet("  Block Live-Out", liveOutBlocks[block.get()]);
+ProgramPtr LivenessAnalysisPass::apply(ProgramPtr program) {
+    functions_.clear();
+    positions_.clear();
+    details_.clear();
+    scratchFunction_ = UINT32_MAX;
+    programNames_.clear();
+    stats_ = Statistics();
 
-                if (liveInBlocks[block.get()] != oldLiveIn || liveOutBlocks[block.get()] != oldLiveOut) {
-                    changed = true;
-                }
-            }
+    SymbolTable& symbols = SymbolTable::getInstance();
+    for (const auto& decl : program->declarations) {
+        if (auto* globals = nodeCast<GlobalDeclaration>(decl.get())) {
+            for (const auto& global : globals->globals) programNames_.insert(symbols.intern(global.name));
+        } else if (auto* manifests = nodeCast<ManifestDeclaration>(decl.get())) {
+            for (const auto& manifest : manifests->manifests) programNames_.insert(symbols.intern(manifest.name));
+        } else if (auto* let = nodeCast<LetDeclaration>(decl.get())) {
+            for (const auto& init : let->initializers) programNames_.insert(symbols.intern(init.name));
+        } else if (auto* function = nodeCast<FunctionDeclaration>(decl.get())) {
+            programNames_.insert(symbols.intern(function->name));
         }
     }
 
-    // After convergence, propagate liveness information to individual statements and expressions
-    // This will require another pass over the CFG and AST.
-    std::cout << "\n--- Propagating Liveness to Statements and Expressions ---\n" << std::flush;
-    for (const auto& pair : functionCFGs) {
-        BasicBlock::Ptr entryBlock = pair.second;
-        std::vector<BasicBlock::Ptr> allBlocks;
-        std::set<BasicBlock::Ptr> visited;
-        std::vector<BasicBlock::Ptr> q;
-        q.push_back(entryBlock);
-        visited.insert(entryBlock);
-
-        while (!q.empty()) {
-            BasicBlock::Ptr current = q.back();
-            q.pop_back();
-            allBlocks.push_back(current);
-
-            // Propagate liveness from block to statements within the block
-            // Iterate statements in reverse order for backward propagation
-            std::set<std::string> currentLiveOut = liveOutBlocks[current.get()];
-            
-            for (auto it = current->statements.rbegin(); it != current->statements.rend(); ++it) {
-                Statement* stmt = *it; // Now it's a raw pointer
-                liveOutStatements[stmt] = currentLiveOut;
-                VariableVisitor varVisitor;
-                stmt->accept(&varVisitor);
-                std::set<std::string> stmtUse = varVisitor.getUsedVariables();
-                std::set<std::string> stmtDef = varVisitor.getDefinedVariables();
-                liveInStatements[stmt] = setUnion(stmtUse, setDifference(currentLiveOut, stmtDef));
-                currentLiveOut = liveInStatements[stmt]; // Live-in of current becomes live-out of previous
-
-                // Propagate to expressions within the statement
-                ExpressionLivenessVisitor exprVisitor(liveInExpressions, liveOutExpressions, liveInStatements, liveOutStatements, liveInStatements[stmt]);
-                stmt->accept(&exprVisitor);
-
-                // Debugging output for statements
-                std::cout << "\n--- Statement Liveness ---\n" << std::flush;
-                // std::cout << "Statement: " << stmt->toString() << "\n" << std::flush; // Removed: Statement does not have toString()
-                printSet("Live-In", liveInStatements[stmt]);
-                printSet("Live-Out", liveOutStatements[stmt]);
-                printSet("Use", stmtUse);
-                printSet("Def", stmtDef);
+    CFGBuilder cfgBuilder;
+    cfgBuilder.build(program);
+    auto cfgs = cfgBuilder.takeFunctionCFGs();
+    for (const auto& decl : program->declarations) {
+        if (auto* function = nodeCast<FunctionDeclaration>(decl.get())) {
+            auto cfg = cfgs.find(function->name);
+            if (cfg != cfgs.end()) {
+                analyse(function, std::move(cfg->second));
             }
         }
     }
 
-    std::cout << "\n=== Liveness Analysis Pass: Finished ===\n" << std::flush;
-    // Return the original program, as this pass only analyzes, not transforms.
-    return program; // Return the original program, as CFGBuilder now takes a const ref.
+    return program;
 }
 
-// --- Public Accessors ---
-const std::set<std::string>& LivenessAnalysisPass::getLiveIn(const Statement* stmt) const {
-    auto it = liveInStatements.find(stmt);
-    if (it != liveInStatements.end()) {
-        return it->second;
+void LivenessAnalysisPass::analyse(const FunctionDeclaration* decl, ControlFlowGraph cfg) {
+    Function function;
+    function.cfg = std::move(cfg);
+
+    // Number the locals; a name bound twice, or shared with a non-local, is pinned
+    LocalCollector locals;
+    for (const auto& param : decl->params) locals.declare(param);
+    locals.walk(decl->body_stmt.get());
+    locals.walk(decl->body_expr.get());
+
+    SymbolMap<uint32_t>& index = scratchIndex_;
+    index.clear();
+    scratchFunction_ = static_cast<uint32_t>(functions_.size());
+    SymbolSet repeated;
+    for (SymbolId symbol : locals.declared) {
+        if (!index.insert(symbol, static_cast<uint32_t>(function.variables.size()))) {
+            repeated.insert(symbol);
+            continue;
+        }
+        function.variables.push_back(symbol);
+        function.index.emplace_back(symbol, *index.find(symbol));
     }
-    static const std::set<std::string> emptySet;
-    return emptySet;
-}
+    std::sort(function.index.begin(), function.index.end());
 
-const std::set<std::string>& LivenessAnalysisPass::getLiveOut(const Statement* stmt) const {
-    auto it = liveOutStatements.find(stmt);
-    if (it != liveOutStatements.end()) {
-        return it->second;
+    const size_t width = function.variables.size();
+    function.pinned = BitVector(width);
+    for (uint32_t i = 0; i < width; ++i) {
+        SymbolId symbol = function.variables[i];
+        if (repeated.contains(symbol) || locals.addressTaken.contains(symbol) ||
+            locals.nonLocal.contains(symbol) || programNames_.contains(symbol)) {
+            function.pinned.set(i);
+        }
     }
-    static const std::set<std::string> emptySet;
-    return emptySet;
+
+    // Compute gen/kill for the blocks reachable from the entry
+    const uint32_t functionNumber = scratchFunction_;
+    const ControlFlowGraph& graph = function.cfg;
+    function.blocks.assign(graph.size(), BlockSets{BitVector(width), BitVector(width), BitVector(width), BitVector(width)});
+    BitVector use(width), def(width);
+    for (BlockId b : graph.reversePostorder()) {
+        const std::vector<Statement*>& statements = graph.block(b).statements;
+        BlockSets& sets = function.blocks[b];
+        for (uint32_t s = static_cast<uint32_t>(statements.size()); s-- > 0;) {
+            positions_[statements[s]] = Position{functionNumber, b, s};
+            use.clear();
+            def.clear();
+            statementEffects(statements[s], index, use, def);
+            sets.gen.subtract(def);
+            sets.gen.unionWith(use);
+            sets.kill.unionWith(def);
+        }
+    }
+
+    solve(function);
+
+    ++stats_.functions;
+    if (!graph.isStructured()) ++stats_.unstructured;
+    stats_.blocks += graph.reversePostorder().size();
+    stats_.variables += width;
+    functions_.push_back(std::move(function));
 }
 
-const std::set<std::string>& LivenessAnalysisPass::getLiveIn(const Expression* expr) const {
-    auto it = liveInExpressions.find(expr);
-    if (it != liveInExpressions.end()) {
-        return it->second;
+void LivenessAnalysisPass::solve(Function& function) {
+    const ControlFlowGraph& graph = function.cfg;
+    std::vector<BlockSets>& blocks = function.blocks;
+    const std::vector<BlockId>& rpo = graph.reversePostorder();
+
+    // Seeding in postorder visits successors before their predecessors, so
+    // only loop back edges make a block go round again
+    std::deque<BlockId> worklist(rpo.rbegin(), rpo.rend());
+    std::vector<bool> queued(graph.size(), false);
+    for (BlockId b : rpo) {
+        queued[b] = true;
+    }
+
+    while (!worklist.empty()) {
+        const BlockId b = worklist.front();
+        worklist.pop_front();
+        queued[b] = false;
+        ++stats_.blockVisits;
+
+        BlockSets& sets = blocks[b];
+        sets.liveOut.clear();
+        for (BlockId succ : graph.block(b).successors) {
+            sets.liveOut.unionWith(blocks[succ].liveIn);
+        }
+        if (sets.liveIn.assignTransfer(sets.gen, sets.liveOut, sets.kill)) {
+            for (BlockId pred : graph.block(b).predecessors) {
+                if (!queued[pred] && graph.isReachable(pred)) {
+                    queued[pred] = true;
+                    worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    for (BlockId b : rpo) {
+        blocks[b].liveIn.unionWith(function.pinned);
+        blocks[b].liveOut.unionWith(function.pinned);
     }
-    static const std::set<std::string> emptySet;
-    return emptySet;
 }
 
-const std::set<std::string>& LivenessAnalysisPass::getLiveOut(const Expression* expr) const {
-    auto it = liveOutExpressions.find(expr);
-    if (it != liveOutExpressions.end()) {
-        return it->second;
+const SymbolMap<uint32_t>& LivenessAnalysisPass::indexOf(uint32_t function) const {
+    if (scratchFunction_ != function) {
+        scratchIndex_.clear();
+        for (const auto& entry : functions_[function].index) {
+            scratchIndex_[entry.first] = entry.second;
+        }
+        scratchFunction_ = function;
     }
-    static const std::set<std::string> emptySet;
-    return emptySet;
+    return scratchIndex_;
 }
 
-// --- Helper for Set Operations ---
-std::set<std::string> LivenessAnalysisPass::setUnion(const std::set<std::string>& s1, const std::set<std::string>& s2) {
-    std::set<std::string> result;
-    std::set_union(s1.begin(), s1.end(), s2.begin(), s2.end(),
-                   std::inserter(result, result.begin()));
+const uint32_t* LivenessAnalysisPass::find(const Function& function, SymbolId var) const {
+    auto it = std::lower_bound(function.index.begin(), function.index.end(), std::make_pair(var, uint32_t(0)));
+    return it != function.index.end() && it->first == var ? &it->second : nullptr;
+}
+
+// Walks the block backwards from its live-out, once, on the first query in it
+const LivenessAnalysisPass::BlockDetail& LivenessAnalysisPass::detail(const Position& position) const {
+    const uint64_t key = (uint64_t(position.function) << 32) | position.block;
+    auto cached = details_.find(key);
+    if (cached != details_.end()) {
+        return cached->second;
+    }
+
+    const Function& function = functions_[position.function];
+    const std::vector<Statement*>& statements = function.cfg.block(position.block).statements;
+    const SymbolMap<uint32_t>& index = indexOf(position.function);
+    const size_t count = statements.size();
+    const size_t width = function.variables.size();
+
+    BlockDetail& result = details_[key];
+    result.liveIn.resize(count);
+    result.liveOut.resize(count);
+    BitVector live = function.blocks[position.block].liveOut;
+    BitVector use(width), def(width);
+    for (size_t s = count; s-- > 0;) {
+        result.liveOut[s] = live;
+        use.clear();
+        def.clear();
+        statementEffects(statements[s], index, use, def);
+        live.subtract(def);
+        live.unionWith(use);
+        live.unionWith(function.pinned);
+        result.liveIn[s] = live;
+    }
     return result;
 }
 
-std::set<std::string> LivenessAnalysisPass::setDifference(const std::set<std::string>& s1, const std::set<std::string>& s2) {
-    std::set<std::string> result;
-    std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(),
-                        std::inserter(result, result.begin()));
+std::set<SymbolId> LivenessAnalysisPass::toSymbols(const Function& function, const BitVector& bits) const {
+    std::set<SymbolId> result;
+    bits.forEach([&](size_t i) { result.insert(function.variables[i]); });
     return result;
 }
+
+// --- Public Accessors ---
+
+bool LivenessAnalysisPass::isLiveOut(const Statement* stmt, SymbolId var) const {
+    auto it = positions_.find(stmt);
+    if (it == positions_.end()) return true;
+    const Function& function = functions_[it->second.function];
+    const uint32_t* i = find(function, var);
+    if (!function.cfg.isStructured() || !i) return true;
+    return detail(it->second).liveOut[it->second.statement].test(*i);
+}
+
+bool LivenessAnalysisPass::isLiveIn(const Statement* stmt, SymbolId var) const {
+    auto it = positions_.find(stmt);
+    if (it == positions_.end()) return true;
+    const Function& function = functions_[it->second.function];
+    const uint32_t* i = find(function, var);
+    if (!function.cfg.isStructured() || !i) return true;
+    return detail(it->second).liveIn[it->second.statement].test(*i);
+}
+
+std::set<SymbolId> LivenessAnalysisPass::getLiveIn(const Statement* stmt) const {
+    auto it = positions_.find(stmt);
+    if (it == positions_.end()) return {};
+    const Function& function = functions_[it->second.function];
+    if (!function.cfg.isStructured()) {
+        return std::set<SymbolId>(function.variables.begin(), function.variables.end());
+    }
+    return toSymbols(function, detail(it->second).liveIn[it->second.statement]);
+}
+
+std::set<SymbolId> LivenessAnalysisPass::getLiveOut(const Statement* stmt) const {
+    auto it = positions_.find(stmt);
+    if (it == positions_.end()) return {};
+    const Function& function = functions_[it->second.function];
+    if (!function.cfg.isStructured()) {
+        return std::set<SymbolId>(function.variables.begin(), function.variables.end());
+    }
+    return toSymbols(function, detail(it->second).liveOut[it->second.statement]);
+}
@@ -3,42 +3,102 @@
 
 #include "OptimizationPass.h"
 #include "AST.h"
-#include "BasicBlock.h"
-#include "CFGBuilder.h"
+#include "BitVector.h"
+#include "ControlFlowGraph.h"
+#include "SymbolTable.h"
 
 #include <set>
-#include <map>
 #include <string>
-#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+/**
+ * @class LivenessAnalysisPass
+ * @brief Computes which locals are live before and after each statement.
+ *
+ * Every function gets its own dense numbering of the locals it declares
+ * (parameters, LET and FOR variables), and live sets are BitVectors over that
+ * numbering, kept per block alongside the function's ControlFlowGraph.
+ * gen/kill sets are computed per block and the backward dataflow problem is
+ * solved with a worklist seeded in the graph's cached postorder, so most
+ * blocks settle on their first visit. Per-statement sets are not stored: the first query in a block
+ * walks it backwards from its live-out and caches the result for that block.
+ *
+ * The answers are conservative. Any name a statement mentions inside a nested
+ * expression counts as a use, and only top-level assignments and declarations
+ * kill. A local whose address is taken, that is bound twice in the function or
+ * that shares its name with a global, manifest or function is live
+ * everywhere. Globals and other non-locals are not tracked. In a function whose control flow the CFG
+ * does not model (see ControlFlowGraph::isStructured), and for statements outside
+ * any analysed block, every local is reported live.
+ *
+ * This pass does not change the program.
+ */
 class LivenessAnalysisPass : public OptimizationPass {
 public:
     std::string getName() const override;
     ProgramPtr apply(ProgramPtr program) override;
 
-    // Public accessors for liveness information
-    const std::set<std::string>& getLiveIn(const Statement* stmt) const;
-    const std::set<std::string>& getLiveOut(const Statement* stmt) const;
-    const std::set<std::string>& getLiveIn(const Expression* expr) const;
-    const std::set<std::string>& getLiveOut(const Expression* expr) const;
+    /// True if @p var may be read after @p stmt runs without being written first.
+    bool isLiveOut(const Statement* stmt, SymbolId var) const;
+
+    /// True if @p var may be read by @p stmt or later without being written first.
+    bool isLiveIn(const Statement* stmt, SymbolId var) const;
+
+    // Live locals around a statement, by symbol
+    std::set<SymbolId> getLiveIn(const Statement* stmt) const;
+    std::set<SymbolId> getLiveOut(const Statement* stmt) const;
+
+    struct Statistics {
+        size_t functions = 0;
+        size_t unstructured = 0; // Functions answered conservatively
+        size_t blocks = 0;
+        size_t variables = 0;
+        size_t blockVisits = 0;  // Transfer functions evaluated by the worklist
+    };
+
+    const Statistics& getStatistics() const { return stats_; }
 
 private:
-    // Liveness information for basic blocks
-    std::map<BasicBlock*, std::set<std::string>> liveInBlocks;
-    std::map<BasicBlock*, std::set<std::string>> liveOutBlocks;
-
-    // Liveness information for individual statements and expressions
-    std::map<const Statement*, std::set<std::string>> liveInStatements;
-    std::map<const Statement*, std::set<std::string>> liveOutStatements;
-    std::map<const Expression*, std::set<std::string>> liveInExpressions;
-    std::map<const Expression*, std::set<std::string>> liveOutExpressions;
-
-    // Control Flow Graphs for each function
-    std::map<std::string, BasicBlock::Ptr> functionCFGs;
-
-    // Helper functions for set operations
-    std::set<std::string> setUnion(const std::set<std::string>& s1, const std::set<std::string>& s2);
-    std::set<std::string> setDifference(const std::set<std::string>& s1, const std::set<std::string>& s2);
+    struct BlockSets {
+        BitVector gen, kill, liveIn, liveOut;
+    };
+
+    struct Function {
+        ControlFlowGraph cfg;
+        std::vector<BlockSets> blocks;   // Indexed by BlockId
+        std::vector<SymbolId> variables; // Dense index -> symbol
+        std::vector<std::pair<SymbolId, uint32_t>> index; // Sorted by symbol
+        BitVector pinned;                // Address-taken locals, live everywhere
+    };
+
+    struct Position {
+        uint32_t function;
+        BlockId block;
+        uint32_t statement;
+    };
+
+    // Statement sets of one block, filled on the first query that lands in it
+    struct BlockDetail {
+        std::vector<BitVector> liveIn;
+        std::vector<BitVector> liveOut;
+    };
+
+    std::vector<Function> functions_;
+    std::unordered_map<const Statement*, Position> positions_;
+    mutable std::unordered_map<uint64_t, BlockDetail> details_;
+    mutable SymbolMap<uint32_t> scratchIndex_; // Dense index of one function's locals
+    mutable uint32_t scratchFunction_ = UINT32_MAX;
+    SymbolSet programNames_; // Globals, manifests and functions of the program
+    Statistics stats_;
+
+    void analyse(const FunctionDeclaration* decl, ControlFlowGraph cfg);
+    void solve(Function& function);
+    const SymbolMap<uint32_t>& indexOf(uint32_t function) const;
+    const uint32_t* find(const Function& function, SymbolId var) const;
+    const BlockDetail& detail(const Position& position) const;
+    std::set<SymbolId> toSymbols(const Function& function, const BitVector& bits) const;
 };
 
 #endif // LIVENESS_ANALYSIS_PASS_H
@@ -0,0 +1,81 @@
+#include "LoopOptimizer.h"
+
+// The loop queries of LoopOptimizer that look at nothing but the AST. They
+// live apart from the LICM code so that users need not link the optimizer.
+
+namespace {
+
+class ModifiedVariableCollector {
+public:
+    void collect(Statement* stmt) { visit(stmt); }
+    SymbolSet modifiedVariables;
+private:
+    void visit(Statement* node);
+};
+
+void ModifiedVariableCollector::visit(Statement* node) {
+    if (!node) return;
+    if (auto* n = nodeCast<Assignment>(node)) {
+        for (const auto& lhs_expr : n->lhs) {
+            if (auto* var = nodeCast<VariableAccess>(lhs_expr.get())) {
+                modifiedVariables.insert(var->symbol);
+            }
+        }
+    } else if (auto* n = nodeCast<CompoundStatement>(node)) {
+        for (const auto& s : n->statements) visit(static_cast<Statement*>(s.get()));
+    } else if (auto* n = nodeCast<IfStatement>(node)) {
+        visit(n->then_statement.get());
+    } else if (auto* n = nodeCast<TestStatement>(node)) {
+        visit(n->then_statement.get());
+        visit(n->else_statement.get());
+    } else if (auto* n = nodeCast<WhileStatement>(node)) {
+        visit(n->body.get());
+    } else if (auto* n = nodeCast<RepeatStatement>(node)) {
+        visit(n->body.get());
+    } else if (auto* n = nodeCast<ForStatement>(node)) {
+        modifiedVariables.insert(SymbolTable::getInstance().intern(n->var_name));
+        visit(n->body.get());
+    } else if (auto* n = nodeCast<SwitchonStatement>(node)) {
+        for (const auto& scase : n->cases) visit(scase.statement.get());
+        visit(n->default_case.get());
+    } else if (auto* n = nodeCast<LabeledStatement>(node)) {
+        visit(n->statement.get());
+    } else if (auto* n = nodeCast<DeclarationStatement>(node)) {
+        // A LET in the body binds a fresh variable on every iteration
+        if (auto* let = nodeCast<LetDeclaration>(n->declaration.get())) {
+            for (const auto& init : let->initializers) modifiedVariables.insert(SymbolTable::getInstance().intern(init.name));
+        }
+    }
+}
+
+} // end anonymous namespace
+
+namespace LoopOptimizer {
+
+SymbolSet modifiedVariables(Statement* body) {
+    ModifiedVariableCollector collector;
+    collector.collect(body);
+    return std::move(collector.modifiedVariables);
+}
+
+bool constantForStep(const ForStatement* loop, int64_t& step) {
+    if (!loop->by_expr) {
+        step = 1;
+        return true;
+    }
+    if (auto num = nodeCast<NumberLiteral>(loop->by_expr.get())) {
+        step = num->value;
+        return true;
+    }
+    if (auto unary = nodeCast<UnaryOp>(loop->by_expr.get())) {
+        if (unary->op == TokenType::OpMinus) {
+            if (auto num = nodeCast<NumberLiteral>(unary->rhs.get())) {
+                step = -static_cast<int64_t>(num->value);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace LoopOptimizer
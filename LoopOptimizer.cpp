@@ -1,104 +1,68 @@
 #include "LoopOptimizer.h"
 #include "Optimizer.h"
-#include <set>
 #include <vector>
 
 namespace { // Anonymous namespace to keep helper classes internal to this file
 
-// (ModifiedVariableCollector is unchanged)
-class ModifiedVariableCollector {
-public:
-    void collect(Statement* stmt, const std::string& loop_var) {
-        modifiedVariables.insert(loop_var);
-        visit(stmt);
-    }
-    std::set<std::string> modifiedVariables;
-private:
-    void visit(Statement* node);
-};
-
-void ModifiedVariableCollector::visit(Statement* node) {
-    if (!node) return;
-    if (auto* n = dynamic_cast<Assignment*>(node)) {
-        for (const auto& lhs_expr : n->lhs) {
-            if (auto* var = dynamic_cast<VariableAccess*>(lhs_expr.get())) {
-                modifiedVariables.insert(var->name);
-            }
-        }
-    } else if (auto* n = dynamic_cast<CompoundStatement*>(node)) {
-        for (const auto& s : n->statements) visit(static_cast<Statement*>(s.get()));
-    } else if (auto* n = dynamic_cast<IfStatement*>(node)) {
-        visit(n->then_statement.get());
-    } else if (auto* n = dynamic_cast<TestStatement*>(node)) {
-        visit(n->then_statement.get());
-        visit(n->else_statement.get());
-    } else if (auto* n = dynamic_cast<WhileStatement*>(node)) {
-        visit(n->body.get());
-    } else if (auto* n = dynamic_cast<ForStatement*>(node)) {
-        modifiedVariables.insert(n->var_name);
-        visit(n->body.get());
-    } else if (auto* n = dynamic_cast<LabeledStatement*>(node)) {
-        visit(n->statement.get());
-    }
-}
-
-
 // --- HoistingOptimizer with corrections ---
+// Edits the loop body in place; an invariant expression is moved into a
+// hoisted LET and its slot is refilled with a read of the temporary.
 class HoistingOptimizer {
 public:
-    HoistingOptimizer(Optimizer* optimizer, const std::set<std::string>& modified, const std::string& loop_var)
+    HoistingOptimizer(Optimizer* optimizer, const SymbolSet& modified, const std::string& loop_var)
         : main_optimizer(optimizer), modifiedVariables(modified), loopVarName(loop_var) {}
 
-    StmtPtr transform(Statement* stmt) { return visit(stmt); }
+    void transform(StmtPtr& stmt) { visit(stmt); }
     std::vector<DeclPtr> getHoistedDecls() { return std::move(hoistedDeclarations); }
 
 private:
     Optimizer* main_optimizer;
-    const std::set<std::string>& modifiedVariables;
+    const SymbolSet& modifiedVariables;
     const std::string& loopVarName;
     std::vector<DeclPtr> hoistedDeclarations;
     int tempVarCounter = 0;
 
     bool isInvariant(Expression* expr);
     std::string generateTempVarName();
-    ExprPtr hoistIfInvariant(ExprPtr expr);
+    void hoistIfInvariant(ExprPtr& expr);
 
     // Expression Visitors
-    ExprPtr visit(Expression* node);
-    ExprPtr visit(UnaryOp* node);
-    ExprPtr visit(BinaryOp* node);
-    ExprPtr visit(FunctionCall* node);
+    void visit(ExprPtr& slot);
+    void visit(UnaryOp* node);
+    void visit(BinaryOp* node);
+    void visit(FunctionCall* node);
 
     // Statement Visitors
-    StmtPtr visit(Statement* node);
-    StmtPtr visit(Assignment* node);
-    StmtPtr visit(CompoundStatement* node);
-    StmtPtr visit(RoutineCall* node);
-    StmtPtr visit(IfStatement* node);
-    StmtPtr visit(TestStatement* node);
-    StmtPtr visit(ForStatement* node);
-    StmtPtr visit(LabeledStatement* node);
+    template <typename Slot>
+    void visitStatement(Slot& slot);
+    void visit(StmtPtr& slot) { visitStatement(slot); }
+    void visit(Assignment* node);
+    void visit(CompoundStatement* node);
+    void visit(RoutineCall* node);
+    void visit(IfStatement* node);
+    void visit(TestStatement* node);
+    void visit(LabeledStatement* node);
     // FIX: Added missing declaration for WhileStatement visitor
-    StmtPtr visit(WhileStatement* node);
+    void visit(WhileStatement* node);
 };
 
 bool HoistingOptimizer::isInvariant(Expression* expr) {
     if (!expr) return true;
-    if (dynamic_cast<NumberLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) ||
-        dynamic_cast<StringLiteral*>(expr) || dynamic_cast<CharLiteral*>(expr)) {
+    if (nodeCast<NumberLiteral>(expr) || nodeCast<FloatLiteral>(expr) ||
+        nodeCast<StringLiteral>(expr) || nodeCast<CharLiteral>(expr)) {
         return true;
     }
-    if (auto* var = dynamic_cast<VariableAccess*>(expr)) {
-        return modifiedVariables.find(var->name) == modifiedVariables.end();
+    if (auto* var = nodeCast<VariableAccess>(expr)) {
+        return !modifiedVariables.contains(var->symbol);
     }
-    if (auto* op = dynamic_cast<UnaryOp*>(expr)) {
+    if (auto* op = nodeCast<UnaryOp>(expr)) {
         return isInvariant(op->rhs.get());
     }
-    if (auto* op = dynamic_cast<BinaryOp*>(expr)) {
+    if (auto* op = nodeCast<BinaryOp>(expr)) {
         return isInvariant(op->left.get()) && isInvariant(op->right.get());
     }
-    if (auto* call = dynamic_cast<FunctionCall*>(expr)) {
-        if (auto* func_var = dynamic_cast<VariableAccess*>(call->function.get())) {
+    if (auto* call = nodeCast<FunctionCall>(expr)) {
+        if (auto* func_var = nodeCast<VariableAccess>(call->function.get())) {
             const std::string& name = func_var->name;
             if (name == "WRITES" || name == "WRITEN" || name == "NEWLINE" || name == "FINISH" || name == "READN") {
                 return false;
@@ -116,11 +80,11 @@ std::string HoistingOptimizer::generateTempVarName() {
     return "_licm_temp_" + std::to_string(tempVarCounter++);
 }
 
-ExprPtr HoistingOptimizer::hoistIfInvariant(ExprPtr expr) {
+void HoistingOptimizer::hoistIfInvariant(ExprPtr& expr) {
     if (isInvariant(expr.get())) {
-        if (dynamic_cast<NumberLiteral*>(expr.get()) ||
-            dynamic_cast<VariableAccess*>(expr.get())) {
-            return expr;
+        if (nodeCast<NumberLiteral>(expr.get()) ||
+            nodeCast<VariableAccess>(expr.get())) {
+            return;
         }
         std::string temp_name = generateTempVarName();
         // FIX: Construct the vector and its contents correctly to avoid copying a unique_ptr.
@@ -128,114 +92,101 @@ ExprPtr HoistingOptimizer::hoistIfInvariant(ExprPtr expr) {
         inits.emplace_back(LetDeclaration::VarInit{temp_name, std::move(expr)});
         hoistedDeclarations.push_back(std::make_unique<LetDeclaration>(std::move(inits)));
         
-        return std::make_unique<VariableAccess>(temp_name);
+        expr = std::make_unique<VariableAccess>(temp_name);
     }
-    return expr;
 }
 
-ExprPtr HoistingOptimizer::visit(Expression* node) {
-    if (!node) return nullptr;
+void HoistingOptimizer::visit(ExprPtr& slot) {
+    Expression* node = slot.get();
+    if (!node) return;
     
     // Dispatch to a specific visitor if one exists.
-    if (auto* n = dynamic_cast<BinaryOp*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<UnaryOp*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<FunctionCall*>(node)) return visit(n);
-    
-    // For leaf nodes (literals, variables), just run the main optimizer's visit.
-    return main_optimizer->visit(node);
+    switch (node->kind()) {
+        case NodeKind::BinaryOp: visit(static_cast<BinaryOp*>(node)); break;
+        case NodeKind::UnaryOp: visit(static_cast<UnaryOp*>(node)); break;
+        case NodeKind::FunctionCall: visit(static_cast<FunctionCall*>(node)); break;
+        default:
+            // For leaf nodes (literals, variables), just run the main optimizer.
+            main_optimizer->mutate(slot);
+            return;
+    }
+    hoistIfInvariant(slot);
 }
 
-ExprPtr HoistingOptimizer::visit(UnaryOp* node) {
-    auto new_rhs = visit(node->rhs.get());
-    auto current_expr = std::make_unique<UnaryOp>(node->op, std::move(new_rhs));
-    return hoistIfInvariant(std::move(current_expr));
+void HoistingOptimizer::visit(UnaryOp* node) {
+    visit(node->rhs);
 }
 
-ExprPtr HoistingOptimizer::visit(BinaryOp* node) {
-    auto new_left = visit(node->left.get());
-    auto new_right = visit(node->right.get());
-    auto current_expr = std::make_unique<BinaryOp>(node->op, std::move(new_left), std::move(new_right));
-    return hoistIfInvariant(std::move(current_expr));
+void HoistingOptimizer::visit(BinaryOp* node) {
+    visit(node->left);
+    visit(node->right);
 }
 
-ExprPtr HoistingOptimizer::visit(FunctionCall* node) {
-    std::vector<ExprPtr> new_args;
-    for (const auto& arg : node->arguments) {
-        new_args.push_back(visit(arg.get()));
+void HoistingOptimizer::visit(FunctionCall* node) {
+    for (auto& arg : node->arguments) {
+        visit(arg);
     }
-    auto new_func = visit(node->function.get());
-    auto current_expr = std::make_unique<FunctionCall>(std::move(new_func), std::move(new_args));
-    return hoistIfInvariant(std::move(current_expr));
+    visit(node->function);
 }
 
-StmtPtr HoistingOptimizer::visit(Statement* node) {
-    if (!node) return nullptr;
-    if (auto* n = dynamic_cast<Assignment*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<CompoundStatement*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<IfStatement*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<TestStatement*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<WhileStatement*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<ForStatement*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<RoutineCall*>(node)) return visit(n);
-    if (auto* n = dynamic_cast<LabeledStatement*>(node)) return visit(n);
-    return main_optimizer->visit(node);
+template <typename Slot>
+void HoistingOptimizer::visitStatement(Slot& slot) {
+    auto* node = static_cast<Statement*>(slot.get());
+    if (!node) return;
+    switch (node->kind()) {
+        case NodeKind::Assignment: return visit(static_cast<Assignment*>(node));
+        case NodeKind::CompoundStatement: return visit(static_cast<CompoundStatement*>(node));
+        case NodeKind::IfStatement: return visit(static_cast<IfStatement*>(node));
+        case NodeKind::TestStatement: return visit(static_cast<TestStatement*>(node));
+        case NodeKind::WhileStatement: return visit(static_cast<WhileStatement*>(node));
+        case NodeKind::RoutineCall: return visit(static_cast<RoutineCall*>(node));
+        case NodeKind::LabeledStatement: return visit(static_cast<LabeledStatement*>(node));
+        default: break;
+    }
+    // Nested FOR loops are processed by the main optimizer too
+    main_optimizer->mutate(slot);
 }
 
-StmtPtr HoistingOptimizer::visit(Assignment* node) {
+void HoistingOptimizer::visit(Assignment* node) {
     // FIX: Correctly loop through the 'rhs' vector.
-    std::vector<ExprPtr> new_rhs;
-    for (const auto& expr : node->rhs) {
-        new_rhs.push_back(visit(expr.get()));
+    for (auto& expr : node->rhs) {
+        visit(expr);
     }
     
-    // LHS is not optimized for hoisting, just rebuilt.
-    std::vector<ExprPtr> new_lhs;
-    for (const auto& expr : node->lhs) {
-        new_lhs.push_back(main_optimizer->visit(expr.get()));
+    // LHS is not optimized for hoisting, just folded.
+    for (auto& expr : node->lhs) {
+        main_optimizer->mutate(expr);
     }
-    
-    return std::make_unique<Assignment>(std::move(new_lhs), std::move(new_rhs));
 }
 
-StmtPtr HoistingOptimizer::visit(CompoundStatement* node) {
-    std::vector<std::unique_ptr<Node>> new_stmts;
-    for (const auto& stmt : node->statements) {
-        new_stmts.push_back(visit(static_cast<Statement*>(stmt.get())));
+void HoistingOptimizer::visit(CompoundStatement* node) {
+    for (auto& stmt : node->statements) {
+        visitStatement(stmt);
     }
-    return std::make_unique<CompoundStatement>(std::move(new_stmts));
 }
 
-StmtPtr HoistingOptimizer::visit(RoutineCall* node) {
-    auto new_call_expr = visit(node->call_expression.get());
-    return std::make_unique<RoutineCall>(std::move(new_call_expr));
+void HoistingOptimizer::visit(RoutineCall* node) {
+    visit(node->call_expression);
 }
 
-StmtPtr HoistingOptimizer::visit(IfStatement* node) {
-    auto new_cond = visit(node->condition.get());
-    auto new_then = visit(node->then_statement.get());
-    return std::make_unique<IfStatement>(std::move(new_cond), std::move(new_then));
+void HoistingOptimizer::visit(IfStatement* node) {
+    visit(node->condition);
+    visit(node->then_statement);
 }
 
-StmtPtr HoistingOptimizer::visit(TestStatement* node) {
-    auto new_cond = visit(node->condition.get());
-    auto new_then = visit(node->then_statement.get());
-    auto new_else = node->else_statement ? visit(node->else_statement.get()) : nullptr;
-    return std::make_unique<TestStatement>(std::move(new_cond), std::move(new_then), std::move(new_else));
+void HoistingOptimizer::visit(TestStatement* node) {
+    visit(node->condition);
+    visit(node->then_statement);
+    visit(node->else_statement);
 }
 
-StmtPtr HoistingOptimizer::visit(WhileStatement* node) {
-    auto new_cond = visit(node->condition.get());
-    auto new_body = visit(node->body.get());
-    return std::make_unique<WhileStatement>(std::move(new_cond), std::move(new_body));
-}
-
-StmtPtr HoistingOptimizer::visit(ForStatement* node) {
-    return LoopOptimizer::process(node, main_optimizer);
+void HoistingOptimizer::visit(WhileStatement* node) {
+    visit(node->condition);
+    visit(node->body);
 }
     
-StmtPtr HoistingOptimizer::visit(LabeledStatement* node) {
-    auto new_stmt = visit(node->statement.get());
-    return std::make_unique<LabeledStatement>(node->name, std::move(new_stmt));
+void HoistingOptimizer::visit(LabeledStatement* node) {
+    visit(node->statement);
 }
 
 } // end anonymous namespace
@@ -243,29 +194,27 @@ StmtPtr HoistingOptimizer::visit(LabeledStatement* node) {
 namespace LoopOptimizer {
 
 StmtPtr process(ForStatement* loop, Optimizer* optimizer) {
-    ExprPtr new_from = optimizer->visit(loop->from_expr.get());
-    ExprPtr new_to = optimizer->visit(loop->to_expr.get());
-    ExprPtr new_by = loop->by_expr ? optimizer->visit(loop->by_expr.get()) : nullptr;
-
-    ModifiedVariableCollector collector;
-    collector.collect(loop->body.get(), loop->var_name);
+    optimizer->mutate(loop->from_expr);
+    optimizer->mutate(loop->to_expr);
+    optimizer->mutate(loop->by_expr);
 
-    HoistingOptimizer hoister(optimizer, collector.modifiedVariables, loop->var_name);
-    StmtPtr new_body = hoister.transform(loop->body.get());
+    SymbolSet modified = modifiedVariables(loop->body.get());
+    modified.insert(SymbolTable::getInstance().intern(loop->var_name));
 
-    auto new_loop = std::make_unique<ForStatement>(
-        loop->var_name, std::move(new_from), std::move(new_to), std::move(new_by), std::move(new_body)
-    );
+    HoistingOptimizer hoister(optimizer, modified, loop->var_name);
+    hoister.transform(loop->body);
 
     auto hoisted_decls = hoister.getHoistedDecls();
     if (hoisted_decls.empty()) {
-        return new_loop;
+        return nullptr;
     } else {
         std::vector<std::unique_ptr<Node>> final_statements;
         for (auto& decl : hoisted_decls) {
             final_statements.push_back(std::make_unique<DeclarationStatement>(std::move(decl)));
         }
-        final_statements.push_back(std::move(new_loop));
+        final_statements.push_back(std::make_unique<ForStatement>(
+            loop->var_name, std::move(loop->from_expr), std::move(loop->to_expr),
+            std::move(loop->by_expr), std::move(loop->body)));
         return std::make_unique<CompoundStatement>(std::move(final_statements));
     }
 }
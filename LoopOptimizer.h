@@ -2,7 +2,10 @@
 #define LOOPOPTIMIZER_H
 
 #include "AST.h"
+#include "SymbolTable.h"
+#include <cstdint>
 #include <memory>
+#include <string>
 
 // Forward declaration to avoid circular include with Optimizer.h
 class Optimizer;
@@ -12,21 +15,37 @@ class Optimizer;
  * @brief A dedicated helper for performing loop-invariant code motion (LICM).
  *
  * This encapsulates all logic for analyzing a loop body, identifying
- * invariant expressions, and hoisting them out of the loop.
+ * invariant expressions, and hoisting them out of the loop. The queries
+ * that only read the AST (modifiedVariables, constantForStep) are defined
+ * in LoopAnalysis.cpp, which does not depend on the Optimizer.
  */
 namespace LoopOptimizer {
     /**
-     * @brief Processes a ForStatement to apply LICM.
+     * @brief Processes a ForStatement to apply LICM, editing it in place.
      * @param loop The ForStatement node to optimize.
      * @param optimizer A pointer to the main Optimizer instance, used to
      * optimize sub-expressions (like loop bounds) and access
      * shared state (like manifest constants).
-     * @return A new StmtPtr. If code was hoisted, this will be a
-     * CompoundStatement containing the hoisted declarations followed
-     * by the optimized loop. Otherwise, it will be the optimized
-     * ForStatement itself.
+     * @return The loop's replacement if code was hoisted: a CompoundStatement
+     * containing the hoisted declarations followed by the loop. Otherwise
+     * nullptr, and the optimized loop stays where it was.
      */
     StmtPtr process(ForStatement* loop, Optimizer* optimizer);
+
+    /**
+     * @brief Collects the names a loop body may change: variables it assigns,
+     * and those bound by its LETs and nested FOR loops.
+     * @param body The loop body. Expressions are not entered, so a VALOF
+     * inside one is not scanned.
+     * @return The interned names, not including the loop's own variable.
+     */
+    SymbolSet modifiedVariables(Statement* body);
+
+    /**
+     * @brief Returns true and sets @p step when the FOR step is a literal
+     * (BY omitted, BY n or BY -n). Other steps are kept in a hidden local.
+     */
+    bool constantForStep(const ForStatement* loop, int64_t& step);
 }
 
 #endif // LOOPOPTIMIZER_H
@@ -9,7 +9,8 @@
  * @brief Base interface for all optimization passes.
  * 
  * This abstract class defines the interface that all optimization passes must implement.
- * Each pass takes a Program AST and returns an optimized version of it.
+ * Each pass takes a Program AST and returns an optimized version of it, normally
+ * the same tree edited in place (see ASTMutator).
  */
 class OptimizationPass {
 public:
@@ -18,15 +19,40 @@ public:
     /**
      * @brief Apply this optimization pass to the given program.
      * @param program The AST to optimize
-     * @return A new optimized AST
+     * @return The optimized AST
      */
     virtual ProgramPtr apply(ProgramPtr program) = 0;
+
+    /**
+     * @brief Whether the last apply() changed the program.
+     * Analysis passes never do; transforming passes set this as they run.
+     */
+    bool hasChanged() const { return changed; }
+
+    /**
+     * @brief Whether this pass can run on one top-level declaration at a time.
+     * Such passes look at nothing outside the declaration they are given and
+     * keep no state between declarations, so the PassManager may repeat them
+     * per function and run them on several functions at once, with one
+     * instance per thread.
+     */
+    virtual bool isFunctionPass() const { return false; }
+
+    /**
+     * @brief Apply this pass to a single top-level function or LET declaration.
+     * Only called when isFunctionPass() is true.
+     * @return True if the declaration changed
+     */
+    virtual bool applyToDeclaration(Declaration* declaration) { return false; }
     
     /**
      * @brief Get the name of this optimization pass.
      * @return A string describing this pass
      */
     virtual std::string getName() const = 0;
+
+protected:
+    bool changed = false;
 };
 
 #endif // OPTIMIZATION_PASS_H
\ No newline at end of file
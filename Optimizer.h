@@ -2,11 +2,12 @@
 #define OPTIMIZER_H
 
 #include "AST.h"
+#include "ASTMutator.h"
 #include "PassManager.h"
+#include "SymbolTable.h"
 #include "LivenessAnalysisPass.h" // Include the new LivenessAnalysisPass
 #include <memory>
 #include <set>
-#include <unordered_map>
 
 /**
  * @class Optimizer
@@ -19,9 +20,9 @@
  * This class retains the singleton pattern and visitor methods for compatibility
  * with existing code (like LoopOptimizer) but now uses passes for the main optimization.
  */
-class Optimizer {
+class Optimizer : public ASTMutator<Optimizer> {
 public:
-    std::unordered_map<std::string, int64_t> manifests;
+    SymbolMap<int64_t> manifests; // Keyed on the interned names of the constants
 
     static Optimizer& getInstance() {
         static Optimizer instance;
@@ -38,55 +39,31 @@ public:
      */
     ProgramPtr optimize(ProgramPtr ast);
 
-    // Visitor methods retained for compatibility with existing code (e.g., LoopOptimizer)
-    ExprPtr visit(Expression* node);
-    StmtPtr visit(Statement* node);
-    DeclPtr visit(Declaration* node);
+    /**
+     * @brief Set how many threads run the function pass groups (default 1).
+     * Parallel runs are opt-in: see PassManager for what they do not guarantee.
+     */
+    void setThreadCount(unsigned threads) { passManager.setThreadCount(threads); }
+
+    // In-place folding retained for compatibility with existing code (e.g., LoopOptimizer)
+    using ASTMutator<Optimizer>::mutate;
 
 private:
+    friend class ASTMutator<Optimizer>;
+    using ASTMutator<Optimizer>::rewrite;
+
     Optimizer();
     PassManager passManager;
 
     void setupDefaultPasses();
 
-    // Expression visitors - kept for compatibility with LoopOptimizer
-    ExprPtr visit(NumberLiteral* node);
-    ExprPtr visit(FloatLiteral* node);
-    ExprPtr visit(StringLiteral* node);
-    ExprPtr visit(CharLiteral* node);
-    ExprPtr visit(VariableAccess* node);
-    ExprPtr visit(UnaryOp* node);
-    ExprPtr visit(BinaryOp* node);
-    ExprPtr visit(FunctionCall* node);
-    ExprPtr visit(ConditionalExpression* node);
-    ExprPtr visit(Valof* node);
-    ExprPtr visit(VectorConstructor* node);
-    ExprPtr visit(VectorAccess* node);
-    
-    // Statement visitors - kept for compatibility with LoopOptimizer
-    StmtPtr visit(Assignment* node);
-    StmtPtr visit(RoutineCall* node);
-    StmtPtr visit(CompoundStatement* node);
-    StmtPtr visit(IfStatement* node);
-    StmtPtr visit(TestStatement* node);
-    StmtPtr visit(WhileStatement* node);
-    StmtPtr visit(ForStatement* node);
-    StmtPtr visit(GotoStatement* node);
-    StmtPtr visit(LabeledStatement* node);
-    StmtPtr visit(ReturnStatement* node);
-    StmtPtr visit(FinishStatement* node);
-    StmtPtr visit(ResultisStatement* node);
-    StmtPtr visit(RepeatStatement* node);
-    StmtPtr visit(SwitchonStatement* node);
-    StmtPtr visit(EndcaseStatement* node);
-    StmtPtr visit(DeclarationStatement* node);
-    
-    // Declaration visitors - kept for compatibility with LoopOptimizer
-    DeclPtr visit(LetDeclaration* node);
-    DeclPtr visit(FunctionDeclaration* node);
-    
-    // Top-level visitor - kept for compatibility with LoopOptimizer
-    ProgramPtr visit(Program* node);
+    // Folding and loop handling used by LoopOptimizer; ASTMutator walks the rest
+    ExprPtr rewrite(VariableAccess* node);
+    ExprPtr rewrite(BinaryOp* node);
+    ExprPtr rewrite(ConditionalExpression* node);
+    StmtPtr rewrite(IfStatement* node);
+    StmtPtr rewrite(TestStatement* node);
+    StmtPtr rewrite(ForStatement* node);
 };
 
 #endif // OPTIMIZER_H
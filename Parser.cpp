@@ -28,19 +28,18 @@ namespace {
 }
 
 int Parser::getTokenPrecedence() {
-    if (PrecedenceMap.count(currentToken.type)) {
-        return PrecedenceMap.at(currentToken.type);
+    if (PrecedenceMap.count(current())) {
+        return PrecedenceMap.at(current());
     }
     return -1;
 }
 
-ProgramPtr Parser::parse(const std::string& source) {
-    lexer.init(source);
-    advanceTokens();
-    advanceTokens();
+ProgramPtr Parser::parse(std::string_view source) {
+    tokens = lexer.tokenize(source);
+    cursor = 0;
 
     std::vector<DeclPtr> declarations;
-    while (currentToken.type != TokenType::Eof) {
+    while (current() != TokenType::Eof) {
         // Top-level must be declarations in BCPL
         declarations.push_back(parseDeclaration());
     }
@@ -49,13 +48,14 @@ ProgramPtr Parser::parse(const std::string& source) {
 }
 
 void Parser::advanceTokens() {
-    currentToken = peekToken;
-    peekToken = lexer.getNextToken();
+    if (cursor + 1 < tokens.size()) { // Stays on the final Eof
+        ++cursor;
+    }
 }
 
 void Parser::expect(TokenType type, const std::string& message) {
-    if (currentToken.type != type) {
-        throw std::runtime_error("Parser Error (line " + std::to_string(currentToken.line) + "): " + message);
+    if (current() != type) {
+        throw std::runtime_error("Parser Error (line " + std::to_string(tokens.line(cursor)) + "): " + message);
     }
     advanceTokens();
 }
@@ -63,11 +63,11 @@ void Parser::expect(TokenType type, const std::string& message) {
 // --- Declaration Parsing ---
 
 DeclPtr Parser::parseDeclaration() {
-    if (currentToken.type == TokenType::KwLet) {
+    if (current() == TokenType::KwLet) {
         return parseLetDeclaration();
-    } else if (currentToken.type == TokenType::KwGlobal) {
+    } else if (current() == TokenType::KwGlobal) {
         return parseGlobalDeclaration();
-    } else if (currentToken.type == TokenType::KwManifest) {
+    } else if (current() == TokenType::KwManifest) {
         return parseManifestDeclaration();
     }
     throw std::runtime_error("Parser Error: Expected top-level declaration (LET, GLOBAL, etc).");
@@ -76,19 +76,19 @@ DeclPtr Parser::parseDeclaration() {
 DeclPtr Parser::parseLetDeclaration() {
     expect(TokenType::KwLet, "Expected 'LET'");
 
-    std::string name = currentToken.text;
+    std::string name(tokens.text(cursor));
     expect(TokenType::Identifier, "Expected identifier after 'LET'");
 
-    if (currentToken.type == TokenType::LParen) {
+    if (current() == TokenType::LParen) {
         return parseFunctionOrRoutineDeclaration(name);
     }
 
     std::vector<LetDeclaration::VarInit> initializers;
     initializers.push_back({name, nullptr});
 
-    while (currentToken.type == TokenType::Comma) {
+    while (current() == TokenType::Comma) {
         advanceTokens();
-        initializers.push_back({currentToken.text, nullptr});
+        initializers.push_back({std::string(tokens.text(cursor)), nullptr});
         expect(TokenType::Identifier, "Expected identifier in declaration list.");
     }
 
@@ -96,7 +96,7 @@ DeclPtr Parser::parseLetDeclaration() {
 
     for (auto& init : initializers) {
         init.init = parseExpression();
-        if (currentToken.type != TokenType::Comma) break;
+        if (current() != TokenType::Comma) break;
         advanceTokens();
     }
 
@@ -107,14 +107,14 @@ DeclPtr Parser::parseGlobalDeclaration() {
     expect(TokenType::KwGlobal, "Expected 'GLOBAL'");
     expect(TokenType::LSection, "Expected '$(' after 'GLOBAL'");
     std::vector<GlobalDeclaration::Global> globals;
-    while (currentToken.type != TokenType::RSection) {
-        std::string name = currentToken.text;
+    while (current() != TokenType::RSection) {
+        std::string name(tokens.text(cursor));
         expect(TokenType::Identifier, "Expected identifier in global declaration");
         expect(TokenType::Colon, "Expected ':' after identifier in global declaration");
-        int size = currentToken.int_val;
+        int size = tokens.intValue(cursor);
         expect(TokenType::IntegerLiteral, "Expected integer literal for size in global declaration");
         globals.push_back({name, size});
-        if (currentToken.type == TokenType::Semicolon) advanceTokens();
+        if (current() == TokenType::Semicolon) advanceTokens();
     }
     expect(TokenType::RSection, "Expected '$)' after global declarations");
     return std::make_unique<GlobalDeclaration>(std::move(globals));
@@ -124,15 +124,15 @@ DeclPtr Parser::parseManifestDeclaration() {
     expect(TokenType::KwManifest, "Expected 'MANIFEST'");
     expect(TokenType::LSection, "Expected '$(' after 'MANIFEST'");
     std::vector<ManifestDeclaration::Manifest> manifests;
-    while (currentToken.type != TokenType::RSection) {
-        std::string name = currentToken.text;
+    while (current() != TokenType::RSection) {
+        std::string name(tokens.text(cursor));
         expect(TokenType::Identifier, "Expected identifier in manifest declaration");
         expect(TokenType::OpEq, "Expected '=' after identifier in manifest declaration");
-        int value = currentToken.int_val;
+        int value = tokens.intValue(cursor);
         expect(TokenType::IntegerLiteral, "Expected integer literal for value in manifest declaration");
         manifests.push_back({name, value});
 
-        if (currentToken.type == TokenType::Semicolon) {
+        if (current() == TokenType::Semicolon) {
             advanceTokens();
         }
     }
@@ -144,12 +144,12 @@ DeclPtr Parser::parseFunctionOrRoutineDeclaration(const std::string& name) {
     expect(TokenType::LParen, "Expected '(' for function declaration.");
 
     std::vector<std::string> params;
-    if (currentToken.type != TokenType::RParen) {
-        params.push_back(currentToken.text);
+    if (current() != TokenType::RParen) {
+        params.emplace_back(tokens.text(cursor));
         expect(TokenType::Identifier, "Expected parameter name.");
-        while(currentToken.type == TokenType::Comma) {
+        while(current() == TokenType::Comma) {
             advanceTokens();
-            params.push_back(currentToken.text);
+            params.emplace_back(tokens.text(cursor));
             expect(TokenType::Identifier, "Expected parameter name.");
         }
     }
@@ -158,13 +158,13 @@ DeclPtr Parser::parseFunctionOrRoutineDeclaration(const std::string& name) {
     ExprPtr body_expr = nullptr;
     StmtPtr body_stmt = nullptr;
 
-    if (currentToken.type == TokenType::OpEq) {
+    if (current() == TokenType::OpEq) {
         advanceTokens();
         body_expr = parseExpression();
-    } else if (currentToken.type == TokenType::KwBe) {
+    } else if (current() == TokenType::KwBe) {
         advanceTokens();
         body_stmt = parseStatement();
-    } else if (currentToken.type == TokenType::KwValof) {
+    } else if (current() == TokenType::KwValof) {
         advanceTokens();
         body_expr = parseValofExpression();
     } else {
@@ -185,7 +185,7 @@ StmtPtr Parser::parseStatement() {
 
     // Step 2: Check if the statement is followed by a REPEAT modifier.
     // This version checks for combined tokens like REPEATWHILE.
-    switch (currentToken.type) {
+    switch (current()) {
         case TokenType::KwRepeat:
             // Case: C REPEAT (infinite loop)
             advanceTokens(); // Consume 'REPEAT'
@@ -216,7 +216,7 @@ StmtPtr Parser::parseStatement() {
 
 // This function parses any statement that is NOT a postfix-repeat loop.
 StmtPtr Parser::parseSimpleStatement() {
-    switch (currentToken.type) {
+    switch (current()) {
         case TokenType::KwLet:
             return std::make_unique<DeclarationStatement>(parseLetDeclaration());
         case TokenType::KwIf:
@@ -254,8 +254,8 @@ StmtPtr Parser::parseSimpleStatement() {
         case TokenType::LBrace:
             return parseCompoundStatement();
         case TokenType::Identifier: {
-            if (peekToken.type == TokenType::Colon) {
-                std::string label_name = currentToken.text;
+            if (peek() == TokenType::Colon) {
+                std::string label_name(tokens.text(cursor));
                 advanceTokens(); // consume identifier
                 advanceTokens(); // consume ':'
                 return std::make_unique<LabeledStatement>(label_name, parseStatement());
@@ -269,22 +269,22 @@ StmtPtr Parser::parseSimpleStatement() {
 
 
 StmtPtr Parser::parseCompoundStatement() {
-    expect(currentToken.type == TokenType::LSection || currentToken.type == TokenType::LBrace ? currentToken.type : TokenType::LSection, "Expected '$(' or '{' to start a block.");
+    expect(current() == TokenType::LSection || current() == TokenType::LBrace ? current() : TokenType::LSection, "Expected '$(' or '{' to start a block.");
 
     std::vector<std::unique_ptr<Node>> statements;
-    while(currentToken.type != TokenType::RSection && currentToken.type != TokenType::RBrace && currentToken.type != TokenType::Eof) {
+    while(current() != TokenType::RSection && current() != TokenType::RBrace && current() != TokenType::Eof) {
         statements.push_back(std::move(parseStatement()));
-        if(currentToken.type == TokenType::Semicolon) {
+        if(current() == TokenType::Semicolon) {
             advanceTokens();
         }
     }
 
-    expect(currentToken.type == TokenType::RSection || currentToken.type == TokenType::RBrace ? currentToken.type : TokenType::RSection, "Expected '$)' or '}' to end a block.");
+    expect(current() == TokenType::RSection || current() == TokenType::RBrace ? current() : TokenType::RSection, "Expected '$)' or '}' to end a block.");
     return std::make_unique<CompoundStatement>(std::move(statements));
 }
 
 StmtPtr Parser::parseIfStatement() {
-    TokenType type = currentToken.type; // IF or UNLESS
+    TokenType type = current(); // IF or UNLESS
     advanceTokens();
     ExprPtr condition = parseExpression();
     expect(TokenType::KwThen, "Expected 'THEN' after condition.");
@@ -298,7 +298,7 @@ StmtPtr Parser::parseIfStatement() {
 }
 
 StmtPtr Parser::parseWhileStatement() {
-    TokenType type = currentToken.type; // WHILE or UNTIL
+    TokenType type = current(); // WHILE or UNTIL
     advanceTokens();
     ExprPtr condition = parseExpression();
     expect(TokenType::KwDo, "Expected 'DO' in loop.");
@@ -313,14 +313,14 @@ StmtPtr Parser::parseWhileStatement() {
 
 StmtPtr Parser::parseForStatement() {
     expect(TokenType::KwFor, "Expected 'FOR'");
-    std::string var_name = currentToken.text;
+    std::string var_name(tokens.text(cursor));
     expect(TokenType::Identifier, "Expected identifier for loop variable.");
     expect(TokenType::OpEq, "Expected '=' in FOR loop.");
     ExprPtr from_expr = parseExpression();
     expect(TokenType::KwTo, "Expected 'TO' in FOR loop.");
     ExprPtr to_expr = parseExpression();
     ExprPtr by_expr = nullptr;
-    if (currentToken.type == TokenType::KwBy) {
+    if (current() == TokenType::KwBy) {
         advanceTokens();
         by_expr = parseExpression();
     }
@@ -336,7 +336,7 @@ StmtPtr Parser::parseTestStatement() {
     expect(TokenType::KwThen, "Expected 'THEN' after condition.");
     StmtPtr then_stmt = parseStatement();
     StmtPtr else_stmt = nullptr;
-    if (currentToken.type == TokenType::KwOr) {
+    if (current() == TokenType::KwOr) {
         advanceTokens();
         else_stmt = parseStatement();
     }
@@ -358,18 +358,18 @@ StmtPtr Parser::parseSwitchonStatement() {
     std::vector<SwitchonStatement::SwitchCase> cases;
     StmtPtr default_case = nullptr;
 
-    while (currentToken.type != TokenType::RSection && currentToken.type != TokenType::Eof) {
-        if (currentToken.type == TokenType::KwCase) {
+    while (current() != TokenType::RSection && current() != TokenType::Eof) {
+        if (current() == TokenType::KwCase) {
             advanceTokens();
-            if (currentToken.type != TokenType::IntegerLiteral) {
+            if (current() != TokenType::IntegerLiteral) {
                 throw std::runtime_error("Parser Error: Expected integer literal for case value.");
             }
-            int case_val = currentToken.int_val;
+            int case_val = tokens.intValue(cursor);
             advanceTokens();
             expect(TokenType::Colon, "Expected ':' after case value.");
             StmtPtr case_stmt = parseStatement();
             cases.push_back({case_val, generate_label(), std::move(case_stmt)});
-        } else if (currentToken.type == TokenType::KwDefault) {
+        } else if (current() == TokenType::KwDefault) {
             advanceTokens();
             expect(TokenType::Colon, "Expected ':' after 'DEFAULT'.");
             default_case = parseStatement();
@@ -391,19 +391,19 @@ StmtPtr Parser::parseResultisStatement() {
 StmtPtr Parser::parseExpressionStatement() {
     ExprPtr expr = parseExpression();
 
-    if (auto* call = dynamic_cast<FunctionCall*>(expr.get())) {
+    if (auto* call = nodeCast<FunctionCall>(expr.get())) {
         // If it's a function call and not part of an assignment, it's a routine call.
-        if (currentToken.type != TokenType::OpAssign) {
+        if (current() != TokenType::OpAssign) {
              return std::make_unique<RoutineCall>(std::move(expr));
         }
     }
 
     // Must be an assignment
-    if(currentToken.type == TokenType::OpAssign || currentToken.type == TokenType::Comma) {
+    if(current() == TokenType::OpAssign || current() == TokenType::Comma) {
         std::vector<ExprPtr> lhs_list;
         lhs_list.push_back(std::move(expr));
 
-        while(currentToken.type == TokenType::Comma) {
+        while(current() == TokenType::Comma) {
             advanceTokens();
             // In a multi-assignment, the LHS can only be simple names/accesses
             lhs_list.push_back(parsePrimaryExpression());
@@ -413,7 +413,7 @@ StmtPtr Parser::parseExpressionStatement() {
 
         std::vector<ExprPtr> rhs_list;
         rhs_list.push_back(parseExpression());
-        while(currentToken.type == TokenType::Comma) {
+        while(current() == TokenType::Comma) {
             advanceTokens();
             rhs_list.push_back(parseExpression());
         }
@@ -431,7 +431,7 @@ ExprPtr Parser::parseExpression(int precedence) {
 
     while (true) {
         // Handle conditional expression separately as it's right-associative and has special syntax
-        if (currentToken.type == TokenType::OpConditional) {
+        if (current() == TokenType::OpConditional) {
             advanceTokens();
             ExprPtr true_expr = parseExpression();
             expect(TokenType::Comma, "Expected ',' in conditional expression");
@@ -445,7 +445,7 @@ ExprPtr Parser::parseExpression(int precedence) {
             break;
         }
 
-        TokenType op = currentToken.type;
+        TokenType op = current();
         advanceTokens();
 
         if (op == TokenType::OpBang) { // Vector access V!E
@@ -464,27 +464,27 @@ ExprPtr Parser::parseExpression(int precedence) {
 
 ExprPtr Parser::parsePrimaryExpression() {
     ExprPtr expr;
-    if (currentToken.type == TokenType::OpAt || currentToken.type == TokenType::OpLogNot || currentToken.type == TokenType::OpMinus) {
+    if (current() == TokenType::OpAt || current() == TokenType::OpLogNot || current() == TokenType::OpMinus) {
         expr = parseUnary();
     } else {
-        switch (currentToken.type) {
+        switch (current()) {
             case TokenType::Identifier:
                 expr = parseIdentifierExpression();
                 break;
             case TokenType::IntegerLiteral:
-                expr = std::make_unique<NumberLiteral>(currentToken.int_val);
+                expr = std::make_unique<NumberLiteral>(tokens.intValue(cursor));
                 advanceTokens();
                 break;
             case TokenType::FloatLiteral:
-                expr = std::make_unique<FloatLiteral>(currentToken.float_val);
+                expr = std::make_unique<FloatLiteral>(tokens.floatValue(cursor));
                 advanceTokens();
                 break;
             case TokenType::StringLiteral:
-                expr = std::make_unique<StringLiteral>(currentToken.text);
+                expr = std::make_unique<StringLiteral>(Lexer::unescape(tokens.text(cursor)));
                 advanceTokens();
                 break;
             case TokenType::CharLiteral:
-                 expr = std::make_unique<CharLiteral>(currentToken.int_val);
+                 expr = std::make_unique<CharLiteral>(tokens.intValue(cursor));
                  advanceTokens();
                  break;
             case TokenType::LParen:
@@ -505,13 +505,13 @@ ExprPtr Parser::parsePrimaryExpression() {
                  expr = std::make_unique<NumberLiteral>(0);
                  break;
             default:
-                throw std::runtime_error("Parser Error (line " + std::to_string(currentToken.line) + "): Unexpected token in expression: " + currentToken.text);
+                throw std::runtime_error("Parser Error (line " + std::to_string(tokens.line(cursor)) + "): Unexpected token in expression: " + std::string(tokens.text(cursor)));
         }
     }
 
     // After parsing a primary expression, check if it's a function call.
     // This handles cases like (f(x))(y)
-    while (currentToken.type == TokenType::LParen) {
+    while (current() == TokenType::LParen) {
         expr = parseFunctionCall(std::move(expr));
     }
 
@@ -519,7 +519,7 @@ ExprPtr Parser::parsePrimaryExpression() {
 }
 
 ExprPtr Parser::parseUnary() {
-    TokenType op = currentToken.type;
+    TokenType op = current();
     advanceTokens();
     // Use a high precedence (e.g., 7) for the operand of a unary operator.
     ExprPtr rhs = parseExpression(7);
@@ -527,9 +527,10 @@ ExprPtr Parser::parseUnary() {
 }
 
 ExprPtr Parser::parseIdentifierExpression() {
-    std::string name = currentToken.text;
+    std::string name(tokens.text(cursor));
+    SymbolId symbol = tokens.symbol(cursor);
     advanceTokens();
-    return std::make_unique<VariableAccess>(name);
+    return std::make_unique<VariableAccess>(std::move(name), symbol);
 }
 
 ExprPtr Parser::parseParenExpression() {
@@ -542,10 +543,10 @@ ExprPtr Parser::parseParenExpression() {
 ExprPtr Parser::parseFunctionCall(ExprPtr function_expr) {
     expect(TokenType::LParen, "Expected '(' for function call.");
     std::vector<ExprPtr> args;
-    if (currentToken.type != TokenType::RParen) {
+    if (current() != TokenType::RParen) {
         while (true) {
             args.push_back(parseExpression());
-            if (currentToken.type == TokenType::RParen) break;
+            if (current() == TokenType::RParen) break;
             expect(TokenType::Comma, "Expected ',' or ')' in argument list.");
         }
     }
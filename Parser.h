@@ -10,9 +10,10 @@
  * @class Parser
  * @brief A singleton class that constructs an Abstract Syntax Tree (AST) from a token stream.
  *
- * This is a recursive descent parser. It processes the token stream from the Lexer
- * and builds a hierarchical representation of the source code according to the
- * BCPL grammar. The final output is a complete AST, ready for the code generator.
+ * This is a recursive descent parser. The Lexer first tokenizes the whole source
+ * into a TokenStream, which the parser walks by index, and the parser builds a
+ * hierarchical representation of the source code according to the BCPL
+ * grammar. The final output is a complete AST, ready for the code generator.
  */
 class Parser {
 public:
@@ -28,25 +29,30 @@ public:
 
     /**
      * @brief Parses a complete BCPL source file.
-     * @param source The BCPL source code as a string.
+     * @param source The BCPL source code; tokens view it, so it must stay
+     * alive until parse() returns. The AST keeps copies of the names it needs.
      * @return A unique_ptr to the root Program node of the generated AST.
      * @throws std::runtime_error on a syntax error.
      */
-    ProgramPtr parse(const std::string& source);
+    ProgramPtr parse(std::string_view source);
 
 private:
     Parser() : lexer(Lexer::getInstance()) {}
 
     // --- Parser State ---
     Lexer& lexer;
-    Token currentToken;
-    Token peekToken;
-    StmtPtr lastStatement; // Buffer for the most recently parsed statement
+    TokenStream tokens;   // The whole file, tokenized before parsing starts
+    size_t cursor = 0;    // Index of the current token
 
 
 
     // --- Utility Methods ---
     void advanceTokens();
+    TokenType current() const { return tokens.type(cursor); }
+    // Type of the token @p ahead places after the current one (Eof past the end)
+    TokenType peek(size_t ahead = 1) const {
+        return cursor + ahead < tokens.size() ? tokens.type(cursor + ahead) : TokenType::Eof;
+    }
     void expect(TokenType type, const std::string& message);
 
     // --- Parsing Methods for different grammar rules ---
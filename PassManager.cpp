@@ -1,22 +1,191 @@
 #include "PassManager.h"
+#include "SymbolTable.h"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using PassList = std::vector<std::unique_ptr<OptimizationPass>>;
+
+// Runs the passes in turn on one declaration until each has run once since the
+// last change, or maxIterations rounds have been run.
+void settle(PassList& passes, Declaration* declaration, unsigned maxIterations, PassManager::Statistics& stats) {
+    const size_t count = passes.size();
+    size_t sinceChange = 0;
+    for (unsigned round = 0; round < maxIterations; ++round) {
+        ++stats.rounds;
+        for (auto& pass : passes) {
+            if (sinceChange == count) {
+                return;
+            }
+            ++stats.passRuns;
+            if (pass->applyToDeclaration(declaration)) {
+                ++stats.changedRuns;
+                sinceChange = 0; // The pass that changed it runs again too
+            } else {
+                ++sinceChange;
+            }
+        }
+        if (sinceChange >= count) {
+            return;
+        }
+    }
+    ++stats.capped;
+}
+
+// Calls work(item, worker) once for every item in [0, items) on `workers`
+// threads, the calling thread being worker 0. Each worker starts with a
+// contiguous share of the items and takes them from the front; a worker whose
+// share is used up steals from the back of the others'.
+template <typename Work>
+void runWorkStealing(size_t items, unsigned workers, Work work) {
+    struct Share {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+    std::vector<Share> shares(workers);
+    for (size_t i = 0; i < items; ++i) {
+        shares[i * workers / items].items.push_back(i);
+    }
+
+    auto next = [&shares, workers](unsigned self, size_t& item) {
+        for (unsigned k = 0; k < workers; ++k) {
+            Share& share = shares[(self + k) % workers];
+            std::lock_guard<std::mutex> lock(share.mutex);
+            if (share.items.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                item = share.items.front();
+                share.items.pop_front();
+            } else {
+                item = share.items.back();
+                share.items.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    auto run = [&next, &work](unsigned self) {
+        size_t item;
+        while (next(self, item)) {
+            work(item, self);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < workers; ++w) {
+        threads.emplace_back(run, w);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
 
 void PassManager::addPass(std::unique_ptr<OptimizationPass> pass) {
     if (LivenessAnalysisPass* liveness = dynamic_cast<LivenessAnalysisPass*>(pass.get())) {
         livenessAnalysisPass = liveness;
     }
-    passes.push_back(std::move(pass));
+    Stage stage;
+    stage.pass = std::move(pass);
+    stages.push_back(std::move(stage));
+}
+
+void PassManager::addFunctionPassGroup(std::vector<PassFactory> factories, unsigned maxIterations) {
+    if (factories.empty() || maxIterations == 0) {
+        throw std::runtime_error("PassManager: a function pass group needs passes and at least one iteration");
+    }
+    Stage stage;
+    stage.group = std::make_unique<FunctionPassGroup>(FunctionPassGroup{std::move(factories), maxIterations});
+    stages.push_back(std::move(stage));
 }
 
 ProgramPtr PassManager::optimize(ProgramPtr program) {
     ProgramPtr current = std::move(program);
-    
-    for (const auto& pass : passes) {
-        current = pass->apply(std::move(current));
+    stats = Statistics();
+
+    for (const auto& stage : stages) {
+        if (stage.group) {
+            runGroup(*stage.group, current.get());
+        } else {
+            current = stage.pass->apply(std::move(current));
+        }
     }
-    
+
     return current;
 }
 
+void PassManager::runGroup(const FunctionPassGroup& group, Program* program) {
+    std::vector<Declaration*> declarations;
+    for (const auto& decl : program->declarations) {
+        if (isNode<FunctionDeclaration>(decl.get()) || isNode<LetDeclaration>(decl.get())) {
+            declarations.push_back(decl.get());
+        }
+    }
+    stats.declarations += declarations.size();
+    if (declarations.empty()) {
+        return;
+    }
+
+    const unsigned workers = static_cast<unsigned>(std::min<size_t>(std::max(threadCount, 1u), declarations.size()));
+
+    // Every worker gets its own passes, so no pass instance is shared between threads
+    std::vector<PassList> passes(workers);
+    for (PassList& list : passes) {
+        for (const auto& factory : group.factories) {
+            list.push_back(factory());
+            if (!list.back()->isFunctionPass()) {
+                throw std::runtime_error("PassManager: " + list.back()->getName() + " cannot run per function");
+            }
+        }
+    }
+
+    if (workers == 1) {
+        for (Declaration* declaration : declarations) {
+            settle(passes[0], declaration, group.maxIterations, stats);
+        }
+        return;
+    }
+
+    std::vector<Statistics> workerStats(workers);
+    std::vector<std::exception_ptr> errors(declarations.size());
+    {
+        SymbolTable::Concurrent sharedSymbols;
+        runWorkStealing(declarations.size(), workers, [&](size_t item, unsigned worker) {
+            try {
+                settle(passes[worker], declarations[item], group.maxIterations, workerStats[worker]);
+            } catch (...) {
+                errors[item] = std::current_exception();
+            }
+        });
+    }
+
+    // Report the error of the first failing declaration, whichever thread saw it
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    for (const Statistics& worker : workerStats) {
+        stats.rounds += worker.rounds;
+        stats.passRuns += worker.passRuns;
+        stats.changedRuns += worker.changedRuns;
+        stats.capped += worker.capped;
+    }
+}
+
 size_t PassManager::getPassCount() const {
-    return passes.size();
-}
\ No newline at end of file
+    size_t count = 0;
+    for (const auto& stage : stages) {
+        count += stage.group ? stage.group->factories.size() : 1;
+    }
+    return count;
+}
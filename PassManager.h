@@ -4,44 +4,102 @@
 #include "OptimizationPass.h"
 #include "AST.h"
 #include "LivenessAnalysisPass.h"
+#include <functional>
 #include <vector>
 #include <memory>
 
 /**
  * @class PassManager
  * @brief Manages and sequences optimization passes.
- * 
- * The PassManager maintains a collection of optimization passes and applies them
- * in sequence to a program AST. It provides a simple interface for registering
- * new passes and running the complete optimization pipeline.
+ *
+ * The PassManager keeps an ordered list of stages and applies them to a
+ * program AST. A stage is either a single pass run once over the whole
+ * program, or a group of function passes (see OptimizationPass::isFunctionPass)
+ * that is repeated on each top-level function and LET declaration until a
+ * full round of the group leaves it unchanged, or the iteration cap is hit.
+ * Declarations that stop changing are not visited again.
+ *
+ * With more than one thread, a group's declarations are shared out to a
+ * work-stealing pool and each worker runs its own instances of the group's
+ * passes. Declarations are edited in place and never reordered, so the trees
+ * do not depend on the schedule. Names a worker interns are another matter:
+ * they get SymbolIds in the order the workers happen to reach them, and so
+ * does anything keyed or ordered by SymbolId. Parallel runs are therefore
+ * opt-in, and the default is one thread. Whole-program passes such as
+ * inlining run on the calling thread between groups and act as barriers.
  */
 class PassManager {
 public:
+    /// Makes one instance of a function pass; called once per worker thread.
+    using PassFactory = std::function<std::unique_ptr<OptimizationPass>()>;
+
+    static constexpr unsigned DefaultMaxIterations = 4;
+
     /**
      * @brief Register an optimization pass to be run.
      * @param pass The optimization pass to add to the pipeline
      */
     void addPass(std::unique_ptr<OptimizationPass> pass);
-    
+
+    /**
+     * @brief Register function passes to be iterated to a fixed point per declaration.
+     * @param factories One factory per pass, in the order the passes run
+     * @param maxIterations The most rounds of the group run on one declaration
+     */
+    void addFunctionPassGroup(std::vector<PassFactory> factories, unsigned maxIterations = DefaultMaxIterations);
+
     /**
-     * @brief Apply all registered passes to the program in sequence.
+     * @brief Apply all registered stages to the program in sequence.
      * @param program The program AST to optimize
      * @return The optimized program AST
      */
     ProgramPtr optimize(ProgramPtr program);
-    
+
+    /**
+     * @brief Set how many threads run function pass groups (default 1).
+     * @param threads 0 or 1 runs every group on the calling thread
+     */
+    void setThreadCount(unsigned threads) { threadCount = threads; }
+    unsigned getThreadCount() const { return threadCount; }
+
     /**
      * @brief Get the number of registered passes.
-     * @return The number of passes in the pipeline
+     * @return The number of passes in the pipeline, counting each member of a group
      */
     size_t getPassCount() const;
-    
+
+    struct Statistics {
+        size_t declarations = 0;   // Declarations handed to function pass groups
+        size_t rounds = 0;         // Rounds of a group run on a declaration
+        size_t passRuns = 0;       // Single function passes applied to a declaration
+        size_t changedRuns = 0;    // Of which changed the declaration
+        size_t capped = 0;         // Declarations still changing when the cap was hit
+    };
+
+    /// Counts for the last optimize() call.
+    const Statistics& getStatistics() const { return stats; }
+
 private:
-    std::vector<std::unique_ptr<OptimizationPass>> passes;
+    struct FunctionPassGroup {
+        std::vector<PassFactory> factories;
+        unsigned maxIterations;
+    };
+
+    // Exactly one of pass and group is set
+    struct Stage {
+        std::unique_ptr<OptimizationPass> pass;
+        std::unique_ptr<FunctionPassGroup> group;
+    };
+
+    std::vector<Stage> stages;
+    unsigned threadCount = 1;
+    Statistics stats;
     LivenessAnalysisPass* livenessAnalysisPass = nullptr; // Pointer to the LivenessAnalysisPass instance
 
+    void runGroup(const FunctionPassGroup& group, Program* program);
+
 public:
     LivenessAnalysisPass* getLivenessAnalysisPass() const { return livenessAnalysisPass; }
 };
 
-#endif // PASS_MANAGER_H
\ No newline at end of file
+#endif // PASS_MANAGER_H
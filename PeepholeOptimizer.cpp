@@ -0,0 +1,711 @@
+#include "PeepholeOptimizer.h"
+#include <algorithm>
+#include <set>
+#include <utility>
+
+namespace {
+
+const uint32_t ZR = 31;                      // XZR or SP, depending on the operand
+const uint64_t FLAGS = 1ULL << 32;           // NZCV, tracked like a register
+const uint64_t ALL_REGISTERS = (1ULL << 31) - 1;
+const uint64_t RETURN_REGISTERS = 1ULL | (((1ULL << 12) - 1) << 19); // x0, x19-x30
+const int MAX_ROUNDS = 8;
+const size_t LIVENESS_BUDGET = 512;          // Instructions visited before assuming live
+const size_t NO_TARGET = static_cast<size_t>(-1);
+
+enum class Kind {
+    Plain,      // Data processing
+    Move,       // mov xd, xm (ORR alias)
+    MoveWide,   // movz/movn/movk
+    Load,       // 64-bit ldr/ldur
+    Store,      // 64-bit str/stur
+    LoadPair,
+    StorePair,
+    Branch,
+    CondBranch,
+    Call,
+    Return,
+    Barrier     // Anything the pass does not understand
+};
+
+enum class Format { None, Reg3, Reg4, Imm, Mem, MemPair, CompareBranch };
+
+/**
+ * Register effects of one encoded instruction. Register 31 never appears in
+ * the read/write masks: as XZR it carries no value and SP is never rewritten.
+ */
+struct Decoded {
+    Kind kind = Kind::Barrier;
+    Format format = Format::None;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint32_t rd = ZR;           // Destination, or the transfer register of a load/store
+    uint32_t rn = ZR;
+    uint32_t rm = ZR;
+    int64_t imm = 0;
+    bool pure = false;          // No effect other than writing its destination
+    uint32_t sourceFields[3] = {};  // Bit positions of renamable source registers
+    int sourceFieldCount = 0;
+
+    void addSources(std::initializer_list<uint32_t> shifts) {
+        for (uint32_t shift : shifts) {
+            sourceFields[sourceFieldCount++] = shift;
+        }
+    }
+};
+
+uint64_t bit(uint32_t reg) {
+    return reg == ZR ? 0 : 1ULL << reg;
+}
+
+uint32_t field(uint32_t encoding, uint32_t shift) {
+    return (encoding >> shift) & 0x1F;
+}
+
+int64_t signExtend(uint32_t value, int bits) {
+    int64_t shifted = static_cast<int64_t>(value) << (64 - bits);
+    return shifted >> (64 - bits);
+}
+
+Decoded decode(uint32_t enc) {
+    Decoded d;
+    const uint32_t rd = field(enc, 0);
+    const uint32_t rn = field(enc, 5);
+    const uint32_t rm = field(enc, 16);
+    const uint32_t ra = field(enc, 10);
+    d.rd = rd;
+    d.rn = rn;
+    d.rm = rm;
+
+    const uint32_t shiftedRegister = enc & 0xFF200000;
+    if (shiftedRegister == 0xAA000000 || shiftedRegister == 0x8A000000 || shiftedRegister == 0xCA000000 ||
+        shiftedRegister == 0x8B000000 || shiftedRegister == 0xCB000000 ||
+        shiftedRegister == 0xAB000000 || shiftedRegister == 0xEB000000 || shiftedRegister == 0xAA200000) {
+        // ORR/AND/EOR/ADD/SUB/ADDS/SUBS/ORN (shifted register)
+        const bool setsFlags = shiftedRegister == 0xAB000000 || shiftedRegister == 0xEB000000;
+        const bool unshifted = (enc & 0x00C0FC00) == 0;
+        d.kind = (shiftedRegister == 0xAA000000 && rn == ZR && unshifted) ? Kind::Move : Kind::Plain;
+        d.format = Format::Reg3;
+        d.reads = bit(rn) | bit(rm);
+        d.writes = bit(rd) | (setsFlags ? FLAGS : 0);
+        d.pure = !setsFlags && rd != ZR;
+        if (unshifted) {
+            d.addSources({5, 16});
+        }
+    } else if ((enc & 0x7FE00000) == 0x1AC00000) {
+        // Data processing (2 source): udiv/sdiv/lslv/lsrv/asrv
+        d.kind = Kind::Plain;
+        d.format = Format::Reg3;
+        d.reads = bit(rn) | bit(rm);
+        d.writes = bit(rd);
+        d.pure = true;
+        d.addSources({5, 16});
+    } else if ((enc & 0xFFE00000) == 0x9B000000) {
+        // madd/msub (mul is madd with xzr)
+        d.kind = Kind::Plain;
+        d.format = Format::Reg4;
+        d.reads = bit(rn) | bit(rm) | bit(ra);
+        d.writes = bit(rd);
+        d.pure = true;
+        d.addSources({5, 16, 10});
+    } else if ((enc & 0x7F000000) == 0x11000000 || (enc & 0x7F000000) == 0x51000000) {
+        // add/sub (immediate); register 31 is SP here
+        d.kind = Kind::Plain;
+        d.format = Format::Imm;
+        d.imm = static_cast<int64_t>((enc >> 10) & 0xFFF) << ((enc & (1U << 22)) ? 12 : 0);
+        d.reads = bit(rn);
+        d.writes = bit(rd);
+        d.pure = (enc & 0x80000000) && rd != ZR;
+        if ((enc & 0x80000000) && rd != ZR && rn != ZR) {
+            d.addSources({5});
+        }
+    } else if ((enc & 0x7F000000) == 0x31000000 || (enc & 0x7F000000) == 0x71000000) {
+        // adds/subs (immediate), e.g. cmp xn, #imm
+        d.kind = Kind::Plain;
+        d.format = Format::Imm;
+        d.imm = static_cast<int64_t>((enc >> 10) & 0xFFF) << ((enc & (1U << 22)) ? 12 : 0);
+        d.reads = bit(rn);
+        d.writes = bit(rd) | FLAGS;
+    } else if ((enc & 0x7F800000) == 0x52800000 || (enc & 0x7F800000) == 0x12800000) {
+        // movz/movn
+        d.kind = Kind::MoveWide;
+        d.imm = static_cast<int64_t>((enc >> 5) & 0xFFFF) << (16 * ((enc >> 21) & 3));
+        d.writes = bit(rd);
+        d.pure = true;
+    } else if ((enc & 0x7F800000) == 0x72800000) {
+        // movk keeps the other bits of rd
+        d.kind = Kind::MoveWide;
+        d.reads = bit(rd);
+        d.writes = bit(rd);
+        d.pure = true;
+    } else if ((enc & 0x1F800000) == 0x13000000) {
+        // Bitfield moves (lsl/lsr/asr immediate aliases)
+        d.kind = Kind::Plain;
+        d.reads = bit(rn);
+        d.writes = bit(rd);
+        d.pure = true;
+    } else if ((enc & 0x1FE00000) == 0x1A800000) {
+        // Conditional select (cset is csinc xd, xzr, xzr, invert(cond))
+        d.kind = Kind::Plain;
+        d.reads = bit(rn) | bit(rm) | FLAGS;
+        d.writes = bit(rd);
+        d.pure = true;
+    } else if (enc == 0xD503201F) {
+        // nop, e.g. holding a label
+        d.kind = Kind::Plain;
+    } else if ((enc & 0x9F000000) == 0x10000000) {
+        // adr
+        d.kind = Kind::Plain;
+        d.writes = bit(rd);
+        d.pure = true;
+    } else if ((enc & 0xFFC00000) == 0xF9400000 || (enc & 0xFFE00C00) == 0xF8400000) {
+        d.kind = Kind::Load;
+        d.format = Format::Mem;
+        d.imm = (enc & 0x01000000) ? static_cast<int64_t>((enc >> 10) & 0xFFF) * 8
+                                   : signExtend((enc >> 12) & 0x1FF, 9);
+        d.reads = bit(rn);
+        d.writes = bit(rd);
+        d.addSources({5});
+    } else if ((enc & 0xFFC00000) == 0xF9000000 || (enc & 0xFFE00C00) == 0xF8000000) {
+        d.kind = Kind::Store;
+        d.format = Format::Mem;
+        d.imm = (enc & 0x01000000) ? static_cast<int64_t>((enc >> 10) & 0xFFF) * 8
+                                   : signExtend((enc >> 12) & 0x1FF, 9);
+        d.reads = bit(rn) | bit(rd);
+        d.addSources({0, 5});
+    } else if ((enc & 0xFFC00000) == 0xA9400000) {
+        d.kind = Kind::LoadPair;
+        d.format = Format::MemPair;
+        d.rm = ra; // Second transfer register
+        d.imm = signExtend((enc >> 15) & 0x7F, 7) * 8;
+        d.reads = bit(rn);
+        d.writes = bit(rd) | bit(ra);
+        d.addSources({5});
+    } else if ((enc & 0xFFC00000) == 0xA9000000) {
+        d.kind = Kind::StorePair;
+        d.format = Format::MemPair;
+        d.rm = ra;
+        d.imm = signExtend((enc >> 15) & 0x7F, 7) * 8;
+        d.reads = bit(rn) | bit(rd) | bit(ra);
+        d.addSources({0, 10, 5});
+    } else if ((enc & 0xFC000000) == 0x14000000) {
+        d.kind = Kind::Branch;
+    } else if ((enc & 0xFC000000) == 0x94000000) {
+        // Calls may read anything: generated functions take their
+        // arguments in x0-x7 but do not follow the AAPCS64 strictly.
+        d.kind = Kind::Call;
+        d.reads = ALL_REGISTERS;
+        d.writes = bit(0) | bit(30) | FLAGS;
+    } else if ((enc & 0xFF000010) == 0x54000000) {
+        d.kind = Kind::CondBranch;
+        d.reads = FLAGS;
+    } else if ((enc & 0x7E000000) == 0x34000000) {
+        // cbz/cbnz
+        d.kind = Kind::CondBranch;
+        d.format = Format::CompareBranch;
+        d.reads = bit(rd);
+        d.addSources({0});
+    } else if ((enc & 0x7E000000) == 0x36000000) {
+        // tbz/tbnz
+        d.kind = Kind::CondBranch;
+        d.reads = bit(rd);
+    } else if ((enc & 0xFFFFFC1F) == 0xD65F0000) {
+        d.kind = Kind::Return;
+        d.reads = RETURN_REGISTERS | bit(rn);
+    }
+    return d;
+}
+
+/**
+ * Renames every renamable source operand equal to @p from. Fails, leaving
+ * the instruction untouched, if @p from is also read through another field.
+ */
+bool renameSource(AArch64Instructions::Instruction& instr, uint32_t from, uint32_t to) {
+    const Decoded d = decode(instr.encoding);
+    uint32_t encoding = instr.encoding;
+    for (int i = 0; i < d.sourceFieldCount; ++i) {
+        const uint32_t shift = d.sourceFields[i];
+        if (field(encoding, shift) == from) {
+            encoding = (encoding & ~(0x1FU << shift)) | (to << shift);
+        }
+    }
+    if (decode(encoding).reads & bit(from)) {
+        return false;
+    }
+    instr.encoding = encoding;
+    return true;
+}
+
+AArch64Instructions::Instruction makeMove(const AArch64Instructions::Instruction& original,
+                                          uint32_t rd, uint32_t rm) {
+    AArch64Instructions::Instruction instr = original;
+    instr.encoding = 0xAA0003E0 | (rm << 16) | rd;
+    instr.needsLabelResolution = false;
+    instr.target = AArch64Instructions::NoLabel;
+    return instr;
+}
+
+bool endsBlock(Kind kind) {
+    return kind == Kind::Branch || kind == Kind::CondBranch || kind == Kind::Call ||
+           kind == Kind::Return || kind == Kind::Barrier;
+}
+
+} // namespace
+
+PeepholeOptimizer::PeepholeOptimizer(std::vector<Instruction>& instructions)
+    : instructions_(instructions) {}
+
+size_t PeepholeOptimizer::run() {
+    stats_ = Statistics();
+    stats_.instructionsBefore = instructions_.size();
+
+    for (int round = 0; round < MAX_ROUNDS; ++round) {
+        removed_.assign(instructions_.size(), false);
+        rebuildLabelIndex();
+
+        bool changed = false;
+        for (size_t i = 0; i < instructions_.size(); ++i) {
+            if (removed_[i]) {
+                continue;
+            }
+            // The first rewrite that matches wins; the others get another
+            // chance on the next round.
+            if (removeSelfMove(i) || foldImmediate(i) || fuseCompareBranch(i) ||
+                forwardStoredValue(i) || removeBranchToNext(i) || pairLoadStore(i)) {
+                changed = true;
+            }
+            if (!removed_[i] && propagateCopy(i)) {
+                changed = true;
+            }
+            if (!removed_[i] && removeDeadDefinition(i)) {
+                changed = true;
+            }
+        }
+
+        compact();
+        if (!changed) {
+            break;
+        }
+    }
+
+    stats_.instructionsAfter = instructions_.size();
+    return stats_.removed();
+}
+
+size_t PeepholeOptimizer::next(size_t index) const {
+    size_t i = index + 1;
+    while (i < instructions_.size() && removed_[i]) {
+        ++i;
+    }
+    return i;
+}
+
+bool PeepholeOptimizer::remove(size_t index) {
+    Instruction& instr = instructions_[index];
+    if (instr.hasLabel()) {
+        // Move the label down so branches to it still land on the same code
+        size_t following = next(index);
+        if (following >= instructions_.size() || instructions_[following].hasLabel()) {
+            return false;
+        }
+        instructions_[following].label = instr.label;
+        labelIndex_[instr.label] = following;
+        instr.label = AArch64Instructions::NoLabel;
+    }
+    removed_[index] = true;
+    return true;
+}
+
+void PeepholeOptimizer::rebuildLabelIndex() {
+    labelIndex_.clear();
+    for (size_t i = 0; i < instructions_.size(); ++i) {
+        const uint32_t label = instructions_[i].label;
+        if (label != AArch64Instructions::NoLabel) {
+            if (label >= labelIndex_.size()) {
+                labelIndex_.resize(label + 1, NO_TARGET);
+            }
+            labelIndex_[label] = i;
+        }
+    }
+}
+
+size_t PeepholeOptimizer::branchTarget(const Instruction& instr) const {
+    if (!instr.needsLabelResolution || instr.target >= labelIndex_.size()) {
+        return NO_TARGET;
+    }
+    return labelIndex_[instr.target];
+}
+
+void PeepholeOptimizer::compact() {
+    size_t out = 0;
+    for (size_t i = 0; i < instructions_.size(); ++i) {
+        if (!removed_[i]) {
+            if (out != i) {
+                instructions_[out] = std::move(instructions_[i]);
+            }
+            ++out;
+        }
+    }
+    instructions_.resize(out);
+    removed_.assign(out, false);
+}
+
+bool PeepholeOptimizer::isLiveFrom(size_t start, uint64_t registers) const {
+    std::vector<std::pair<size_t, uint64_t>> worklist{{start, registers}};
+    std::set<std::pair<size_t, uint64_t>> visited;
+    size_t budget = LIVENESS_BUDGET;
+
+    while (!worklist.empty()) {
+        auto [i, live] = worklist.back();
+        worklist.pop_back();
+
+        while (true) {
+            while (i < instructions_.size() && removed_[i]) {
+                ++i;
+            }
+            if (i >= instructions_.size() || budget-- == 0) {
+                return true;
+            }
+            if (!visited.insert({i, live}).second) {
+                break;
+            }
+
+            const Instruction& instr = instructions_[i];
+            const Decoded d = decode(instr.encoding);
+            if ((d.reads & live) || d.kind == Kind::Barrier) {
+                return true;
+            }
+            live &= ~d.writes;
+            if (live == 0 || d.kind == Kind::Return) {
+                break;
+            }
+
+            if (d.kind == Kind::Branch || d.kind == Kind::CondBranch) {
+                const size_t target = branchTarget(instr);
+                if (target == NO_TARGET) {
+                    return true;
+                }
+                if (d.kind == Kind::Branch) {
+                    i = target;
+                    continue;
+                }
+                worklist.emplace_back(target, live);
+            }
+            ++i;
+        }
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::isLiveAfter(size_t index, uint64_t registers) const {
+    const Instruction& instr = instructions_[index];
+    const Decoded d = decode(instr.encoding);
+    if (d.kind == Kind::Return || d.kind == Kind::Barrier) {
+        return true;
+    }
+    if (d.kind == Kind::Branch || d.kind == Kind::CondBranch) {
+        const size_t target = branchTarget(instr);
+        if (target == NO_TARGET) {
+            return true;
+        }
+        if (isLiveFrom(target, registers)) {
+            return true;
+        }
+        if (d.kind == Kind::Branch) {
+            return false;
+        }
+    }
+    return isLiveFrom(next(index), registers);
+}
+
+bool PeepholeOptimizer::removeSelfMove(size_t index) {
+    const Decoded d = decode(instructions_[index].encoding);
+    if (d.kind != Kind::Move || d.rd != d.rm || !remove(index)) {
+        return false;
+    }
+    stats_.selfMoves++;
+    return true;
+}
+
+bool PeepholeOptimizer::foldImmediate(size_t index) {
+    // movz xA, #imm; cmp/add/sub ..., xA  ->  cmp/add/sub ..., #imm
+    const uint32_t movz = instructions_[index].encoding;
+    if ((movz & 0xFF800000) != 0xD2800000) {
+        return false;
+    }
+    const Decoded constant = decode(movz);
+    const uint32_t reg = constant.rd;
+    const uint32_t imm = static_cast<uint32_t>(constant.imm);
+    if (reg == ZR || constant.imm > 0xFFF) {
+        return false;
+    }
+
+    const size_t user = next(index);
+    if (user >= instructions_.size() || instructions_[user].hasLabel()) {
+        return false;
+    }
+    Instruction& instr = instructions_[user];
+    const uint32_t enc = instr.encoding;
+    if ((enc & 0x00C0FC00) != 0) {
+        return false; // Shifted register operand
+    }
+
+    const uint32_t op = enc & 0xFF200000;
+    const uint32_t rd = field(enc, 0);
+    const uint32_t rn = field(enc, 5);
+    const uint32_t rm = field(enc, 16);
+    uint32_t folded;
+    if (op == 0xEB000000 && rd == ZR && rm == reg && rn != reg && rn != ZR) {
+        folded = 0xF100001F | (imm << 10) | (rn << 5);
+    } else if (op == 0xCB000000 && rm == reg && rn != reg && rn != ZR && rd != ZR) {
+        folded = 0xD1000000 | (imm << 10) | (rn << 5) | rd;
+    } else if (op == 0x8B000000 && (rn == reg) != (rm == reg) && rd != ZR) {
+        const uint32_t other = rn == reg ? rm : rn;
+        if (other == ZR) {
+            return false;
+        }
+        folded = 0x91000000 | (imm << 10) | (other << 5) | rd;
+    } else {
+        return false;
+    }
+
+    // The constant must not be needed once the user has consumed it
+    if (!(decode(enc).writes & bit(reg)) && isLiveAfter(user, bit(reg))) {
+        return false;
+    }
+
+    instr.encoding = folded;
+    remove(index);
+    stats_.foldedImmediates++;
+    return true;
+}
+
+bool PeepholeOptimizer::propagateCopy(size_t index) {
+    // mov xD, xS; ... use xD ...  ->  mov xD, xS; ... use xS ...
+    const Decoded move = decode(instructions_[index].encoding);
+    if (move.kind != Kind::Move) {
+        return false;
+    }
+    const uint32_t dst = move.rd;
+    const uint32_t src = move.rm;
+    if (dst == src || dst == ZR || src == ZR) {
+        return false;
+    }
+
+    bool changed = false;
+    for (size_t i = next(index); i < instructions_.size(); i = next(i)) {
+        Instruction& instr = instructions_[i];
+        if (instr.hasLabel()) {
+            break;
+        }
+        Decoded d = decode(instr.encoding);
+        if (d.reads & bit(dst)) {
+            if (!renameSource(instr, dst, src)) {
+                break;
+            }
+            stats_.propagatedCopies++;
+            changed = true;
+            d = decode(instr.encoding);
+        }
+        if ((d.writes & (bit(dst) | bit(src))) || endsBlock(d.kind)) {
+            break;
+        }
+    }
+    return changed;
+}
+
+bool PeepholeOptimizer::removeDeadDefinition(size_t index) {
+    const Decoded d = decode(instructions_[index].encoding);
+    if (!d.pure || d.writes == 0 || isLiveAfter(index, d.writes) || !remove(index)) {
+        return false;
+    }
+    stats_.deadDefinitions++;
+    return true;
+}
+
+bool PeepholeOptimizer::forwardStoredValue(size_t index) {
+    // str/ldr xV, [xB, #o]; ...; ldr xT, [xB, #o]  ->  ...; mov xT, xV
+    const Decoded first = decode(instructions_[index].encoding);
+    if (first.kind != Kind::Store && first.kind != Kind::Load) {
+        return false;
+    }
+    const uint32_t value = first.rd;
+    const uint32_t base = first.rn;
+    const int64_t offset = first.imm;
+    if (value == ZR || base == ZR || (first.kind == Kind::Load && value == base)) {
+        return false;
+    }
+
+    for (size_t i = next(index); i < instructions_.size(); i = next(i)) {
+        Instruction& instr = instructions_[i];
+        if (instr.hasLabel()) {
+            break;
+        }
+        const Decoded d = decode(instr.encoding);
+        if (d.kind == Kind::Load && d.rn == base && d.imm == offset) {
+            if (d.rd == value) {
+                if (!remove(i)) {
+                    return false;
+                }
+            } else {
+                instr = makeMove(instr, d.rd, value);
+            }
+            stats_.redundantLoads++;
+            return true;
+        }
+        if ((d.writes & (bit(value) | bit(base))) || endsBlock(d.kind)) {
+            break;
+        }
+        if (d.kind == Kind::Store || d.kind == Kind::StorePair) {
+            // Only stores to disjoint slots off the same base are known not to alias
+            const int64_t size = d.kind == Kind::StorePair ? 16 : 8;
+            if (d.rn != base || (d.imm < offset + 8 && offset < d.imm + size)) {
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+bool PeepholeOptimizer::pairLoadStore(size_t index) {
+    const size_t second = next(index);
+    if (second >= instructions_.size() || instructions_[second].hasLabel() ||
+        !canCombineLoadStore(instructions_[index], instructions_[second])) {
+        return false;
+    }
+    instructions_[index] = combineLoadStore(instructions_[index], instructions_[second]);
+    removed_[second] = true;
+    stats_.pairedLoadStores++;
+    return true;
+}
+
+bool PeepholeOptimizer::removeBranchToNext(size_t index) {
+    const Instruction& instr = instructions_[index];
+    const Kind kind = decode(instr.encoding).kind;
+    if ((kind != Kind::Branch && kind != Kind::CondBranch) || !instr.needsLabelResolution) {
+        return false;
+    }
+    if (index > 0) {
+        // A branch straight after an unconditional transfer may be a jump
+        // table entry reached by a computed jump; it must keep its slot.
+        size_t previous = index;
+        while (previous > 0 && removed_[--previous]) {
+        }
+        const Kind previousKind = decode(instructions_[previous].encoding).kind;
+        if (!removed_[previous] && (previousKind == Kind::Branch || previousKind == Kind::Return ||
+                                    previousKind == Kind::Barrier)) {
+            return false;
+        }
+    }
+    const size_t following = next(index);
+    if (following >= instructions_.size() || !instructions_[following].hasLabel() ||
+        instructions_[following].label != instr.target || !remove(index)) {
+        return false;
+    }
+    stats_.branchesToNext++;
+    return true;
+}
+
+bool PeepholeOptimizer::fuseCompareBranch(size_t index) {
+    // cset xD, c; [neg xD, xD;] cbz xD, L           ->  b.!c L
+    // cset xD, c; [neg xD, xD;] cmp xD, xzr; b.eq L  ->  b.!c L
+    // csetm xD, c stands in for cset and neg alike
+    const uint32_t cset = instructions_[index].encoding;
+    if ((cset & 0xFFFF0FE0) != 0x9A9F07E0 && (cset & 0xFFFF0FE0) != 0xDA9F03E0) {
+        return false;
+    }
+    const uint32_t reg = field(cset, 0);
+    const uint32_t cond = ((cset >> 12) & 0xF) ^ 1;
+    if (reg == ZR || cond >= AArch64Instructions::AL) {
+        return false;
+    }
+
+    auto following = [this](size_t i) -> size_t {
+        size_t n = next(i);
+        return (n < instructions_.size() && !instructions_[n].hasLabel()) ? n : NO_TARGET;
+    };
+
+    size_t branch = following(index);
+    if (branch == NO_TARGET) {
+        return false;
+    }
+    if (instructions_[branch].encoding == (0xCB0003E0 | (reg << 16) | reg)) { // neg xD, xD
+        branch = following(branch);
+        if (branch == NO_TARGET) {
+            return false;
+        }
+    }
+
+    uint32_t branchCond;
+    uint64_t mustBeDead = bit(reg);
+    const uint32_t enc = instructions_[branch].encoding;
+    if ((enc & 0x7E00001F) == (0x34000000 | reg)) {
+        branchCond = (enc & 0x01000000) ? cond : cond ^ 1; // cbnz : cbz
+    } else if (enc == (0xEB1F001F | (reg << 5))) {         // cmp xD, xzr
+        branch = following(branch);
+        if (branch == NO_TARGET) {
+            return false;
+        }
+        const uint32_t bcond = instructions_[branch].encoding;
+        if ((bcond & 0xFF000010) != 0x54000000 ||
+            ((bcond & 0xF) != AArch64Instructions::EQ && (bcond & 0xF) != AArch64Instructions::NE)) {
+            return false;
+        }
+        branchCond = (bcond & 0xF) == AArch64Instructions::NE ? cond : cond ^ 1;
+        mustBeDead |= FLAGS; // The flags would now come from the earlier compare
+    } else {
+        return false;
+    }
+
+    const Instruction& original = instructions_[branch];
+    if (!original.needsLabelResolution || isLiveAfter(branch, mustBeDead)) {
+        return false;
+    }
+
+    Instruction fused = original;
+    fused.encoding = 0x54000000 | branchCond;
+    fused.label = instructions_[index].label;
+    for (size_t i = next(index); i <= branch; i = next(i)) {
+        removed_[i] = true;
+    }
+    instructions_[index] = fused;
+    stats_.fusedCompareBranches++;
+    return true;
+}
+
+bool PeepholeOptimizer::canCombineLoadStore(const Instruction& first, const Instruction& second) {
+    const Decoded a = decode(first.encoding);
+    const Decoded b = decode(second.encoding);
+    if (a.kind != b.kind || (a.kind != Kind::Load && a.kind != Kind::Store) || a.rn != b.rn) {
+        return false;
+    }
+    const int64_t low = std::min(a.imm, b.imm);
+    if (std::max(a.imm, b.imm) - low != 8 || low % 8 != 0 || low < -512 || low > 504) {
+        return false;
+    }
+    if (a.kind == Kind::Load) {
+        // ldp needs distinct targets, and the first load must leave the base intact
+        if (a.rd == b.rd || a.rd == a.rn || a.rd == ZR || b.rd == ZR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PeepholeOptimizer::Instruction PeepholeOptimizer::combineLoadStore(const Instruction& first, const Instruction& second) {
+    const Decoded a = decode(first.encoding);
+    const Decoded b = decode(second.encoding);
+    const bool firstIsLow = a.imm < b.imm;
+    const uint32_t low = firstIsLow ? a.rd : b.rd;
+    const uint32_t high = firstIsLow ? b.rd : a.rd;
+    const int64_t offset = std::min(a.imm, b.imm);
+    const bool load = a.kind == Kind::Load;
+
+    Instruction pair = first;
+    pair.encoding = (load ? 0xA9400000 : 0xA9000000) | ((static_cast<uint32_t>(offset / 8) & 0x7F) << 15) |
+                    (high << 10) | (a.rn << 5) | low;
+    if (pair.comment == AArch64Instructions::NoComment) {
+        pair.comment = second.comment;
+    }
+    return pair;
+}
@@ -0,0 +1,106 @@
+// PeepholeOptimizer.h
+#ifndef PEEPHOLE_OPTIMIZER_H
+#define PEEPHOLE_OPTIMIZER_H
+
+#include "AArch64Instructions.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class PeepholeOptimizer
+ * @brief Pattern-driven clean-up of the generated AArch64 instruction stream.
+ *
+ * The pass runs after code generation and before branch resolution, while
+ * branches still name their targets by label, so instructions can be removed
+ * or rewritten without patching offsets. The patterns are:
+ *
+ *   - self moves            mov x0, x0                      -> (removed)
+ *   - copy propagation      mov x13, x0; mul x0, x13, x1    -> mul x0, x0, x1
+ *   - dead definitions      mov x0, x26; mov x0, x27        -> mov x0, x27
+ *   - immediate folding     movz x0, #1; sub x0, x15, x0    -> sub x0, x15, #1
+ *   - redundant loads       str x0, [x29, #-16]; ldr x26, [x29, #-16]
+ *                                                           -> str ...; mov x26, x0
+ *   - load/store pairing    str x0, [x29, #-24]; str x1, [x29, #-16]
+ *                                                           -> stp x0, x1, [x29, #-24]
+ *   - branch to next        b L; L: ...                     -> L: ...
+ *   - compare/branch fusion cset x0, eq; neg x0, x0; cbz x0, L
+ *                                                           -> b.ne L
+ *
+ * A labeled instruction starts a basic block and is never deleted (its label
+ * may move to the following instruction when that one has none). Registers
+ * are only considered dead when every path from the point in question writes
+ * them before reading them; calls are assumed to read every register and
+ * returns to read x0 and the callee-saved registers, so the pass stays safe
+ * for code that does not follow the AAPCS64 strictly. Unknown encodings stop
+ * every pattern.
+ */
+class PeepholeOptimizer {
+public:
+    using Instruction = AArch64Instructions::Instruction;
+
+    /// Hit counts per pattern, plus the instruction count before and after.
+    struct Statistics {
+        size_t selfMoves = 0;
+        size_t propagatedCopies = 0;
+        size_t deadDefinitions = 0;
+        size_t foldedImmediates = 0;
+        size_t redundantLoads = 0;
+        size_t pairedLoadStores = 0;
+        size_t branchesToNext = 0;
+        size_t fusedCompareBranches = 0;
+        size_t instructionsBefore = 0;
+        size_t instructionsAfter = 0;
+
+        size_t removed() const { return instructionsBefore - instructionsAfter; }
+    };
+
+    explicit PeepholeOptimizer(std::vector<Instruction>& instructions);
+
+    /**
+     * @brief Applies every pattern until none matches.
+     * @return Number of instructions removed.
+     */
+    size_t run();
+
+    const Statistics& getStatistics() const { return stats_; }
+
+    /**
+     * @brief Checks whether two adjacent 64-bit loads (or stores) from the same
+     * base register can be merged into a single ldp (or stp).
+     */
+    static bool canCombineLoadStore(const Instruction& first, const Instruction& second);
+
+    /**
+     * @brief Builds the ldp/stp that replaces two instructions accepted by
+     * canCombineLoadStore(). The label and comment of @p first are kept.
+     */
+    static Instruction combineLoadStore(const Instruction& first, const Instruction& second);
+
+private:
+    std::vector<Instruction>& instructions_;
+    std::vector<bool> removed_;
+    std::vector<size_t> labelIndex_; // Instruction index per label id
+    Statistics stats_;
+
+    size_t next(size_t index) const;
+    bool remove(size_t index);
+    void rebuildLabelIndex();
+    size_t branchTarget(const Instruction& instr) const; // -1 unless the target is in this code
+    void compact();
+
+    bool isLiveFrom(size_t start, uint64_t registers) const;
+    bool isLiveAfter(size_t index, uint64_t registers) const;
+
+    // Patterns; each returns true when it changed the stream at @p index
+    bool removeSelfMove(size_t index);
+    bool foldImmediate(size_t index);
+    bool propagateCopy(size_t index);
+    bool removeDeadDefinition(size_t index);
+    bool forwardStoredValue(size_t index);
+    bool pairLoadStore(size_t index);
+    bool removeBranchToNext(size_t index);
+    bool fuseCompareBranch(size_t index);
+};
+
+#endif // PEEPHOLE_OPTIMIZER_H
@@ -8,6 +8,18 @@ std::string Preprocessor::process(const std::filesystem::path& main_file) {
     return process_internal(main_file, included_files);
 }
 
+SourceBuffer Preprocessor::load(const std::filesystem::path& main_file) {
+    SourceBuffer source = SourceBuffer::map(main_file);
+    std::string_view text = source.text();
+
+    // Directives are recognised at the start of a line, as in process_internal()
+    bool hasDirective = text.rfind("GET", 0) == 0 || text.find("\nGET") != std::string_view::npos;
+    if (!hasDirective) {
+        return source;
+    }
+    return SourceBuffer(process(main_file));
+}
+
 std::string Preprocessor::process_internal(const std::filesystem::path& file_path, std::set<std::filesystem::path>& included_files) {
     std::cerr << "Preprocessor: Processing file: " << file_path << std::endl; // DEBUG
     if (included_files.count(file_path)) {
@@ -2,6 +2,7 @@
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
 
+#include "SourceBuffer.h"
 #include <string>
 #include <set>
 #include <filesystem>
@@ -18,6 +19,13 @@ public:
 
     std::string process(const std::filesystem::path& main_file);
 
+    /**
+     * Returns the source of @p main_file ready for the lexer. A file without
+     * GET directives is memory-mapped and used as it is; otherwise the
+     * expanded text from process() is returned.
+     */
+    SourceBuffer load(const std::filesystem::path& main_file);
+
 private:
     Preprocessor() = default;
     std::string process_internal(const std::filesystem::path& file_path, std::set<std::filesystem::path>& included_files);
@@ -1,89 +1,47 @@
 #ifndef REGISTER_MANAGER_H
 #define REGISTER_MANAGER_H
 
+#include "LinearScanAllocator.h"
+#include "SymbolTable.h"
 #include <cstdint>
 #include <vector>
-#include <string>
-#include <unordered_map>
-#include <set>
-#include <list>
 
 class AArch64Instructions; // Forward declaration
 
+/**
+ * Holds the register assignment of the function being compiled and emits the
+ * moves between a local's home (register or stack slot) and the accumulator.
+ * Assignments are computed up front by the LinearScanAllocator, so a local
+ * has a single home for the whole function and no spill or reload code is
+ * needed at control-flow joins.
+ */
 class RegisterManager {
 public:
     RegisterManager(AArch64Instructions& instructions);
 
-    // Acquires a register for a variable. Spills if necessary.
-    uint32_t acquireRegister(const std::string& varName, int stackOffset);
+    // Installs the allocation for the function about to be generated.
+    void setAllocation(LinearScanAllocator::Allocation allocation);
 
-    // Releases a register, potentially spilling its value to memory.
-    void releaseRegister(uint32_t reg);
+    // Gets the register holding a variable, or 0xFFFFFFFF if it lives on the stack.
+    uint32_t getVariableRegister(SymbolId var) const;
 
-    // Releases a register without spilling its value to memory.
-    void releaseRegisterWithoutSpill(uint32_t reg);
+    // Copies a variable from its home into dest.
+    void loadVariable(SymbolId var, int stackOffset, uint32_t dest);
 
-    // Removes a variable from its assigned register without spilling.
-    void removeVariableFromRegister(const std::string& varName);
+    // Copies src into a variable's home.
+    void storeVariable(SymbolId var, int stackOffset, uint32_t src);
 
-    // Re-establishes a variable-to-register mapping without loading from stack.
-    void reassignRegister(const std::string& varName, uint32_t reg, int stackOffset);
+    // Callee-saved registers the current function writes, in ascending order.
+    const std::vector<uint32_t>& getCalleeSavedRegisters() const { return allocation_.calleeSavedUsed; }
 
-    // Gets the register holding a variable, or 0xFFFFFFFF if not in a register.
-    uint32_t getVariableRegister(const std::string& varName) const;
+    const LinearScanAllocator::Allocation& getAllocation() const { return allocation_; }
 
-    // Marks a variable's register as dirty (modified in register, needs to be written back to memory).
-    void markDirty(const std::string& varName);
-
-    // Spills all dirty registers to memory.
-    void spillAllDirtyRegisters();
-
-    // Spills a specific register to memory.
-    void spillRegister(uint32_t reg);
-
-    // Gets all currently used registers (including those holding variables).
-    const std::set<uint32_t>& getUsedRegisters() const { return used_regs_; }
-
-    // Gets the variable name associated with a register.
-    std::string getVariableName(uint32_t reg) const;
-
-    // Acquires a register for a variable without loading its value from stack.
-    uint32_t acquireRegisterForInit(const std::string& varName, int stackOffset);
-
-    // Assigns a specific register to a parameter, assuming it's already in that register.
-    void assignParameterRegister(const std::string& varName, uint32_t reg, int stackOffset);
-
-    // Clears all register allocations (e.g., at function exit).
+    // Clears the allocation (e.g., at function exit).
     void clear();
 
 private:
     AArch64Instructions& instructions_;
-
-    // Available general-purpose registers (excluding special ones like SP, FP, LR, XZR, X28 (global pointer))
-    std::vector<uint32_t> available_regs_;
-    std::set<uint32_t> used_regs_; // All registers currently in use
-
-    // Map from variable name to the register it's currently in
-    std::unordered_map<std::string, uint32_t> var_to_reg_;
-    // Map from register to the variable it holds
-    std::unordered_map<uint32_t, std::string> reg_to_var_;
-    // Map from variable name to its stack offset
-    std::unordered_map<std::string, int> var_to_stack_offset_;
-    // Set of registers whose values are dirty (modified in register, not yet in memory)
-    std::set<uint32_t> dirty_regs_;
-
-    // For LRU spilling strategy
-    std::list<uint32_t> lru_list_; // Front is most recently used, back is least recently used
-    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> lru_map_;
-
-    // Helper to find a free register
-    uint32_t findFreeRegister();
-
-    // Helper to find and assign a register without loading a value.
-    uint32_t findAndAssignRegister(const std::string& varName, int stackOffset);
-
-    // Helper to update LRU list
-    void touchRegister(uint32_t reg);
+    LinearScanAllocator::Allocation allocation_;
 };
 
-#endif // REGISTER_MANAGER_H
\ No newline at end of file
+#endif // REGISTER_MANAGER_H
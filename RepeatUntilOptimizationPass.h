@@ -3,7 +3,8 @@
 
 #include "OptimizationPass.h"
 #include "AST.h"
-#include <unordered_map>
+#include "ASTMutator.h"
+#include "SymbolTable.h"
 #include <memory>
 
 /**
@@ -14,57 +15,24 @@
  * - REPEAT <body> UNTIL <true>  => <body>
  * - REPEAT <body> UNTIL <false> => WHILE <true> DO <body>
  */
-class RepeatUntilOptimizationPass : public OptimizationPass {
+class RepeatUntilOptimizationPass : public OptimizationPass, private ASTMutator<RepeatUntilOptimizationPass> {
 public:
-    RepeatUntilOptimizationPass(std::unordered_map<std::string, int64_t>& manifests);
+    RepeatUntilOptimizationPass(SymbolMap<int64_t>& manifests);
 
     ProgramPtr apply(ProgramPtr program) override;
     std::string getName() const override;
+    bool isFunctionPass() const override { return true; }
+    bool applyToDeclaration(Declaration* declaration) override;
 
 private:
-    std::unordered_map<std::string, int64_t>& manifests;
+    friend class ASTMutator<RepeatUntilOptimizationPass>;
+    using ASTMutator<RepeatUntilOptimizationPass>::rewrite;
 
-    // Visitor pattern methods
-    ExprPtr visit(Expression* node);
-    StmtPtr visit(Statement* node);
-    DeclPtr visit(Declaration* node);
-    ProgramPtr visit(Program* node);
+    SymbolMap<int64_t>& manifests;
 
-    // Expression visitors (mostly pass-through)
-    ExprPtr visit(NumberLiteral* node);
-    ExprPtr visit(FloatLiteral* node);
-    ExprPtr visit(StringLiteral* node);
-    ExprPtr visit(CharLiteral* node);
-    ExprPtr visit(VariableAccess* node);
-    ExprPtr visit(UnaryOp* node);
-    ExprPtr visit(BinaryOp* node);
-    ExprPtr visit(FunctionCall* node);
-    ExprPtr visit(ConditionalExpression* node);
-    ExprPtr visit(Valof* node);
-    ExprPtr visit(VectorConstructor* node);
-    ExprPtr visit(VectorAccess* node);
-
-    // Statement visitors
-    StmtPtr visit(Assignment* node);
-    StmtPtr visit(RoutineCall* node);
-    StmtPtr visit(CompoundStatement* node);
-    StmtPtr visit(IfStatement* node);
-    StmtPtr visit(TestStatement* node);
-    StmtPtr visit(WhileStatement* node);
-    StmtPtr visit(ForStatement* node);
-    StmtPtr visit(GotoStatement* node);
-    StmtPtr visit(LabeledStatement* node);
-    StmtPtr visit(ReturnStatement* node);
-    StmtPtr visit(FinishStatement* node);
-    StmtPtr visit(ResultisStatement* node);
-    StmtPtr visit(RepeatStatement* node); // Key optimization logic is here
-    StmtPtr visit(SwitchonStatement* node);
-    StmtPtr visit(EndcaseStatement* node);
-    StmtPtr visit(DeclarationStatement* node);
-
-    // Declaration visitors
-    DeclPtr visit(LetDeclaration* node);
-    DeclPtr visit(FunctionDeclaration* node);
+    // Manifest constants are substituted so that loop conditions can fold
+    ExprPtr rewrite(VariableAccess* node);
+    StmtPtr rewrite(RepeatStatement* node); // Key optimization logic is here
 };
 
 #endif // REPEAT_UNTIL_OPTIMIZATION_PASS_H
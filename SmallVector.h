@@ -0,0 +1,67 @@
+// SmallVector.h
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class SmallVector
+ * @brief A vector of trivially copyable values that holds its first N inline.
+ *
+ * Most CFG blocks have one or two edges each way, so keeping those in the
+ * block itself avoids a heap allocation per edge list. Past N elements the
+ * values move to an ordinary std::vector.
+ */
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only holds trivially copyable values");
+
+public:
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T* data() { return size_ <= N ? inline_ : heap_.data(); }
+    const T* data() const { return size_ <= N ? inline_ : heap_.data(); }
+
+    T* begin() { return data(); }
+    T* end() { return data() + size_; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size_; }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    void push_back(const T& value) {
+        if (size_ < N) {
+            inline_[size_] = value;
+        } else {
+            if (size_ == N) {
+                heap_.assign(inline_, inline_ + N);
+            }
+            heap_.push_back(value);
+        }
+        ++size_;
+    }
+
+    bool contains(const T& value) const {
+        for (const T& element : *this) {
+            if (element == value) return true;
+        }
+        return false;
+    }
+
+    void clear() {
+        heap_.clear();
+        size_ = 0;
+    }
+
+private:
+    T inline_[N] = {};
+    std::vector<T> heap_; // All the elements once there are more than N
+    uint32_t size_ = 0;
+};
+
+#endif // SMALL_VECTOR_H
@@ -0,0 +1,102 @@
+#include "SourceBuffer.h"
+#include <stdexcept>
+#include <utility>
+
+// Platform-specific includes
+#ifdef _WIN32
+    #include <fstream>
+    #include <sstream>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+SourceBuffer::SourceBuffer(std::string text)
+    : owned_(std::move(text)) {
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : data_(other.data_), size_(other.size_), mapped_(other.mapped_), owned_(std::move(other.owned_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = false;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        owned_ = std::move(other.owned_);
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() {
+    unmap();
+}
+
+#ifdef _WIN32
+
+// Without a POSIX mmap the file is read into memory instead
+SourceBuffer SourceBuffer::map(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open source file '" + path.string() + "'");
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return SourceBuffer(contents.str());
+}
+
+void SourceBuffer::unmap() {
+}
+
+#else
+
+SourceBuffer SourceBuffer::map(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open source file '" + path.string() + "': " + strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Could not stat source file '" + path.string() + "': " + error);
+    }
+
+    SourceBuffer buffer;
+    if (info.st_size > 0) { // mmap rejects empty mappings; an empty file has empty text
+        void* ptr = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            std::string error = strerror(errno);
+            close(fd);
+            throw std::runtime_error("Could not map source file '" + path.string() + "': " + error);
+        }
+        buffer.data_ = static_cast<const char*>(ptr);
+        buffer.size_ = static_cast<size_t>(info.st_size);
+        buffer.mapped_ = true;
+    }
+    close(fd); // The mapping stays valid without the descriptor
+    return buffer;
+}
+
+void SourceBuffer::unmap() {
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+    }
+}
+
+#endif
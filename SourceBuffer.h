@@ -0,0 +1,46 @@
+// SourceBuffer.h
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/**
+ * @class SourceBuffer
+ * @brief Read-only BCPL source text, memory-mapped from a file or held in a string.
+ *
+ * The Lexer scans this text in place and its tokens are views into it, so a
+ * SourceBuffer must outlive the parse of its text. Mapping a file avoids
+ * reading multi-megabyte generated sources into a std::string first; text
+ * produced by the Preprocessor (after GET expansion) is owned instead.
+ */
+class SourceBuffer {
+public:
+    /// Maps @p path read-only. Throws std::runtime_error when it cannot be opened.
+    static SourceBuffer map(const std::filesystem::path& path);
+
+    /// Takes ownership of text that was built in memory.
+    explicit SourceBuffer(std::string text);
+
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    std::string_view text() const { return mapped_ ? std::string_view(data_, size_) : std::string_view(owned_); }
+    bool isMapped() const { return mapped_; }
+
+private:
+    SourceBuffer() = default;
+    void unmap();
+
+    const char* data_ = nullptr; // Mapped file contents
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string owned_;          // Text that is not mapped
+};
+
+#endif // SOURCE_BUFFER_H
@@ -0,0 +1,264 @@
+#include "SparseConditionalConstantPropagation.h"
+#include <limits>
+
+bool SparseConditionalConstantPropagation::run(IRFunction& function) {
+    fn_ = &function;
+    lattice_.assign(function.valueCount(), Lattice());
+    users_.assign(function.valueCount(), {});
+    reachable_.assign(function.blockCount(), false);
+    executable_.assign(function.blockCount(), {});
+    edgeWork_.clear();
+    valueWork_.clear();
+
+    for (BlockId b = 0; b < function.blockCount(); ++b) {
+        executable_[b].assign(function.block(b).predecessors.size(), false);
+    }
+    for (ValueId v = 0; v < function.valueCount(); ++v) {
+        const IRInst& inst = function.inst(v);
+        if (inst.isRemoved()) continue;
+        for (ValueId operand : inst.operands) {
+            users_[operand].push_back(v);
+        }
+    }
+
+    propagate();
+    const bool changed = rewrite();
+    fn_ = nullptr;
+    return changed;
+}
+
+void SparseConditionalConstantPropagation::propagate() {
+    reachable_[fn_->entry()] = true;
+    for (ValueId v : fn_->block(fn_->entry()).insts) {
+        visit(v);
+    }
+
+    while (!edgeWork_.empty() || !valueWork_.empty()) {
+        if (!edgeWork_.empty()) {
+            const BlockId to = edgeWork_.back().second;
+            edgeWork_.pop_back();
+
+            // A block is evaluated in full when first reached; later edges only add phi operands
+            const bool first = !reachable_[to];
+            reachable_[to] = true;
+            for (ValueId v : fn_->block(to).insts) {
+                if (!first && fn_->inst(v).op != IROp::Phi) break;
+                visit(v);
+            }
+            continue;
+        }
+
+        const ValueId v = valueWork_.back();
+        valueWork_.pop_back();
+        if (reachable_[fn_->inst(v).block]) {
+            visit(v);
+        }
+    }
+}
+
+void SparseConditionalConstantPropagation::markEdge(BlockId from, BlockId to) {
+    const IRBlock& target = fn_->block(to);
+    bool marked = false;
+    for (size_t i = 0; i < target.predecessors.size(); ++i) {
+        if (target.predecessors[i] == from && !executable_[to][i]) {
+            executable_[to][i] = true;
+            marked = true;
+        }
+    }
+    if (marked) {
+        edgeWork_.emplace_back(from, to);
+    }
+}
+
+void SparseConditionalConstantPropagation::visit(ValueId value) {
+    const IRInst& inst = fn_->inst(value);
+    if (inst.isTerminator()) {
+        visitTerminator(inst);
+        return;
+    }
+
+    if (inst.op == IROp::Phi) {
+        // Only the edges known to run contribute
+        Lattice result;
+        const std::vector<bool>& executable = executable_[inst.block];
+        for (size_t i = 0; i < inst.operands.size(); ++i) {
+            if (executable[i]) result = meet(result, lattice_[inst.operands[i]]);
+        }
+        lower(value, result);
+        return;
+    }
+    lower(value, evaluate(inst));
+}
+
+void SparseConditionalConstantPropagation::visitTerminator(const IRInst& inst) {
+    const IRBlock& block = fn_->block(inst.block);
+    switch (inst.op) {
+        case IROp::Jump:
+            markEdge(inst.block, block.successors[0]);
+            break;
+        case IROp::Branch:
+        case IROp::Switch: {
+            const Lattice& condition = lattice_[inst.operands[0]];
+            if (condition.state == Lattice::State::Constant) {
+                markEdge(inst.block, takenSuccessor(inst.block));
+            } else if (condition.state == Lattice::State::Varying) {
+                for (BlockId succ : block.successors) {
+                    markEdge(inst.block, succ);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+SparseConditionalConstantPropagation::Lattice
+SparseConditionalConstantPropagation::evaluate(const IRInst& inst) const {
+    Lattice result;
+    if (inst.op == IROp::Const) {
+        result.state = Lattice::State::Constant;
+        result.value = inst.imm;
+        return result;
+    }
+
+    // Arguments, addresses, loads and calls are never known here
+    if (!inst.isPure() || inst.op == IROp::Load || inst.operands.empty()) {
+        result.state = Lattice::State::Varying;
+        return result;
+    }
+
+    const Lattice& lhs = lattice_[inst.operands[0]];
+    const Lattice& rhs = inst.operands.size() > 1 ? lattice_[inst.operands[1]] : lhs;
+    if (lhs.state == Lattice::State::Varying || rhs.state == Lattice::State::Varying) {
+        result.state = Lattice::State::Varying;
+    } else if (lhs.state == Lattice::State::Constant && rhs.state == Lattice::State::Constant) {
+        result.state = fold(inst.op, lhs.value, rhs.value, result.value) ? Lattice::State::Constant
+                                                                          : Lattice::State::Varying;
+    }
+    return result;
+}
+
+void SparseConditionalConstantPropagation::lower(ValueId value, const Lattice& result) {
+    if (lattice_[value] == result) return;
+    lattice_[value] = result;
+    for (ValueId user : users_[value]) {
+        valueWork_.push_back(user);
+    }
+}
+
+BlockId SparseConditionalConstantPropagation::takenSuccessor(BlockId block) const {
+    const ValueId last = fn_->terminator(block);
+    if (last == NoValue) return NoBlock;
+    const IRInst& inst = fn_->inst(last);
+    if (inst.op != IROp::Branch && inst.op != IROp::Switch) return NoBlock;
+    const Lattice& condition = lattice_[inst.operands[0]];
+    if (condition.state != Lattice::State::Constant) return NoBlock;
+
+    const IRBlock& irBlock = fn_->block(block);
+    if (inst.op == IROp::Branch) {
+        return irBlock.successors[condition.value != 0 ? 0 : 1];
+    }
+    const std::vector<int64_t>& cases = fn_->switchCases[inst.imm];
+    for (size_t i = 0; i < cases.size(); ++i) {
+        if (cases[i] == condition.value) return irBlock.successors[i + 1];
+    }
+    return irBlock.successors[0];
+}
+
+bool SparseConditionalConstantPropagation::rewrite() {
+    bool changed = false;
+
+    // Branches first, while the conditions they test are still in place
+    for (BlockId b = 0; b < fn_->blockCount(); ++b) {
+        if (!reachable_[b]) continue;
+        const BlockId taken = takenSuccessor(b);
+        if (taken != NoBlock) {
+            fn_->foldTerminator(b, taken);
+            ++stats_.branches;
+            changed = true;
+        }
+    }
+
+    // Creating constants grows the instruction arena, so nothing is held by reference
+    const size_t count = fn_->valueCount();
+    std::vector<ValueId> replacement(count, NoValue);
+    for (ValueId v = 0; v < count; ++v) {
+        if (fn_->inst(v).isRemoved() || fn_->inst(v).op == IROp::Const) continue;
+        if (!reachable_[fn_->inst(v).block] || lattice_[v].state != Lattice::State::Constant) continue;
+        replacement[v] = fn_->constant(lattice_[v].value);
+        ++stats_.constants;
+    }
+    for (ValueId v = 0; v < fn_->valueCount(); ++v) {
+        IRInst& inst = fn_->inst(v);
+        if (inst.isRemoved()) continue;
+        for (ValueId& operand : inst.operands) {
+            if (operand < count && replacement[operand] != NoValue) operand = replacement[operand];
+        }
+    }
+    for (ValueId v = 0; v < count; ++v) {
+        if (replacement[v] != NoValue) {
+            fn_->remove(v);
+            changed = true;
+        }
+    }
+
+    size_t blocks = 0;
+    for (BlockId b = 0; b < fn_->blockCount(); ++b) {
+        if (!fn_->block(b).insts.empty()) ++blocks;
+    }
+    if (fn_->removeUnreachableBlocks()) {
+        for (BlockId b = 0; b < fn_->blockCount(); ++b) {
+            if (!fn_->block(b).insts.empty()) --blocks;
+        }
+        stats_.blocks += blocks;
+        changed = true;
+    }
+    if (changed) {
+        fn_->removeTrivialPhis();
+        fn_->removeDeadValues();
+    }
+    return changed;
+}
+
+SparseConditionalConstantPropagation::Lattice
+SparseConditionalConstantPropagation::meet(const Lattice& a, const Lattice& b) {
+    if (a.state == Lattice::State::Unknown) return b;
+    if (b.state == Lattice::State::Unknown || a == b) return a;
+    Lattice varying;
+    varying.state = Lattice::State::Varying;
+    return varying;
+}
+
+bool SparseConditionalConstantPropagation::fold(IROp op, int64_t lhs, int64_t rhs, int64_t& result) {
+    // Arithmetic wraps like the machine's; BCPL truth is all ones
+    const uint64_t a = static_cast<uint64_t>(lhs);
+    const uint64_t b = static_cast<uint64_t>(rhs);
+    switch (op) {
+        case IROp::Neg: result = static_cast<int64_t>(0 - a); return true;
+        case IROp::Not: result = static_cast<int64_t>(~a); return true;
+        case IROp::Add: result = static_cast<int64_t>(a + b); return true;
+        case IROp::Sub: result = static_cast<int64_t>(a - b); return true;
+        case IROp::Mul: result = static_cast<int64_t>(a * b); return true;
+        case IROp::Div:
+        case IROp::Rem:
+            // Left to run time, which decides what these mean
+            if (rhs == 0 || (lhs == std::numeric_limits<int64_t>::min() && rhs == -1)) return false;
+            result = op == IROp::Div ? lhs / rhs : lhs % rhs;
+            return true;
+        case IROp::And: result = static_cast<int64_t>(a & b); return true;
+        case IROp::Or:  result = static_cast<int64_t>(a | b); return true;
+        case IROp::Shl:
+        case IROp::Shr:
+            if (rhs < 0 || rhs > 63) return false;
+            result = static_cast<int64_t>(op == IROp::Shl ? a << rhs : a >> rhs);
+            return true;
+        case IROp::Eq: result = lhs == rhs ? -1 : 0; return true;
+        case IROp::Ne: result = lhs != rhs ? -1 : 0; return true;
+        case IROp::Lt: result = lhs < rhs ? -1 : 0; return true;
+        case IROp::Gt: result = lhs > rhs ? -1 : 0; return true;
+        case IROp::Le: result = lhs <= rhs ? -1 : 0; return true;
+        case IROp::Ge: result = lhs >= rhs ? -1 : 0; return true;
+        default:       return false;
+    }
+}
@@ -0,0 +1,76 @@
+// SparseConditionalConstantPropagation.h
+#ifndef SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
+#define SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
+
+#include "IR.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @class SparseConditionalConstantPropagation
+ * @brief Finds the IR values that are constant on every path that can run,
+ *        and the branches that can only go one way.
+ *
+ * This is Wegman and Zadeck's algorithm: every value starts out unknown and
+ * only moves down to one constant, then to varying, while two worklists
+ * follow the SSA uses of changed values and the CFG edges found executable.
+ * A branch on a constant marks only the edge it takes, so a phi merging a
+ * constant with a value from a dead arm stays constant, and a loop entered
+ * with constants keeps them if its body cannot change them.
+ *
+ * Since locals are SSA values, a LET assigned a constant, a VALOF whose every
+ * RESULTIS gives one value, and the bounds of a FOR are all seen through.
+ * Constant values are then replaced by constants, branches and switches on
+ * them become jumps, and the blocks no executable edge reaches are removed.
+ */
+class SparseConditionalConstantPropagation {
+public:
+    struct Statistics {
+        size_t constants = 0;  // Values replaced by a constant
+        size_t branches = 0;   // Branches and switches turned into jumps
+        size_t blocks = 0;     // Blocks removed as unreachable
+    };
+
+    /// Propagates constants through @p function in place; returns true if it changed anything.
+    bool run(IRFunction& function);
+
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    // Unknown until some executable path defines the value; Varying once two
+    // different constants, or a value not known at compile time, reach it
+    struct Lattice {
+        enum class State : uint8_t { Unknown, Constant, Varying };
+        State state = State::Unknown;
+        int64_t value = 0;
+
+        bool operator==(const Lattice& other) const {
+            return state == other.state && (state != State::Constant || value == other.value);
+        }
+    };
+
+    Statistics stats_;
+    IRFunction* fn_ = nullptr;
+    std::vector<Lattice> lattice_;
+    std::vector<std::vector<ValueId>> users_;
+    std::vector<bool> reachable_;                  // Blocks an executable edge leads to
+    std::vector<std::vector<bool>> executable_;    // Per block, per predecessor edge
+    std::vector<std::pair<BlockId, BlockId>> edgeWork_;
+    std::vector<ValueId> valueWork_;
+
+    void propagate();
+    void markEdge(BlockId from, BlockId to);
+    void visit(ValueId value);
+    void visitTerminator(const IRInst& inst);
+    Lattice evaluate(const IRInst& inst) const;
+    void lower(ValueId value, const Lattice& result);
+    BlockId takenSuccessor(BlockId block) const;
+    bool rewrite();
+
+    static Lattice meet(const Lattice& a, const Lattice& b);
+    static bool fold(IROp op, int64_t lhs, int64_t rhs, int64_t& result);
+};
+
+#endif // SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
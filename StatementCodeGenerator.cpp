@@ -1,26 +1,30 @@
 #include "StatementCodeGenerator.h"
 #include "CodeGenerator.h"
+#include "ExpressionCodeGenerator.h"
 #include "AST.h"
 #include "StringAccess.h"
 #include "VectorAllocationVisitor.h"
+#include "LoopOptimizer.h"
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
 #include <algorithm>
+#include <limits>
 
 StatementCodeGenerator::StatementCodeGenerator(CodeGenerator& codeGenerator) : codeGen(codeGenerator) {
 }
 
 void StatementCodeGenerator::visitManifestDeclaration(const ManifestDeclaration* node) {
     for (const auto& manifest : node->manifests) {
-        codeGen.manifestConstants[manifest.name] = manifest.value;
+        codeGen.manifestConstants[SymbolTable::getInstance().intern(manifest.name)] = manifest.value;
     }
 }
 
 void StatementCodeGenerator::visitGlobalDeclaration(const GlobalDeclaration* node) {
     for (const auto& global : node->globals) {
-        codeGen.globals[global.name] = codeGen.globals.size();
+        size_t index = codeGen.globals.size();
+        codeGen.globals[SymbolTable::getInstance().intern(global.name)] = index;
     }
 }
 
@@ -31,10 +35,19 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
     codeGen.currentFunctionName = node->name; // Set current function name
     codeGen.labelManager.pushScope(LabelManager::ScopeType::FUNCTION);
     auto returnLabel = codeGen.labelManager.getCurrentReturnLabel();
-    std::cout << "Generated return label: " << returnLabel << std::endl;
+    std::cout << "Generated return label: " << codeGen.instructions.labelName(returnLabel) << std::endl;
 
     // Store function address in the functions map - CRITICAL FIX
-    codeGen.functions[node->name] = codeGen.instructions.getCurrentAddress();
+    codeGen.functions[SymbolTable::getInstance().intern(node->name)] = codeGen.instructions.getCurrentAddress();
+
+    // Assign registers to the locals from their live intervals
+    LinearScanAllocator allocator([this](SymbolId symbol) {
+        return !codeGen.manifestConstants.contains(symbol) && !codeGen.globals.contains(symbol) &&
+               !codeGen.functions.contains(symbol);
+    });
+    codeGen.registerManager.setAllocation(allocator.allocate(node));
+    codeGen.allocatorStats += allocator.getStatistics();
+    codeGen.tailCallFrameReleases.clear();
 
     // First pass to collect vector allocations
     VectorAllocationVisitor vecVisitor;
@@ -43,37 +56,44 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
 
     // Generate function label and record position
     codeGen.instructions.setPendingLabel(node->name);
-    codeGen.labelManager.defineLabel(node->name, codeGen.instructions.getCurrentAddress());
     // codeGen.addToListing(node->name + ":", "Function entry point"); // Removed addToListing
 
     // PROLOGUE:
     // Placeholder for stack frame allocation. This instruction will be back-patched.
     size_t prologueSubInstructionIndex = codeGen.instructions.size();
-    codeGen.instructions.sub(codeGen.SP, codeGen.SP, 0, "Allocate stack frame (placeholder)"); // This will be back-patched with total_frame_size
+    codeGen.instructions.sub_imm(codeGen.SP, codeGen.SP, 0, "Allocate stack frame (placeholder)"); // This will be back-patched with total_frame_size
 
     // Save FP/LR at the top of the allocated frame (offset from the new SP)
     size_t stpInstructionIndex = codeGen.instructions.size(); // Need to back-patch this offset
     codeGen.instructions.stp(codeGen.X29, codeGen.X30, codeGen.SP, 0, "Save FP/LR at top of frame (placeholder offset)"); // Offset will be back-patched
 
+    size_t framePointerInstructionIndex = codeGen.instructions.size(); // Back-patched to point at the saved FP/LR
     codeGen.instructions.mov(codeGen.X29, codeGen.SP, "Set up frame pointer");
     // codeGen.addToListing("mov x29, sp", "Set up frame pointer"); // Removed addToListing
 
     // Save callee-saved registers
     codeGen.saveCalleeSavedRegisters();
 
-    // Allocate space for parameters on the stack and potentially load them into registers
+    // Move parameters from X0-X7 to their homes, so the argument registers are
+    // free for calls made by the body
     for (size_t i = 0; i < node->params.size(); i++) {
-        int offset = codeGen.allocateLocal(node->params[i]); // Allocate stack space
-        // For now, parameters are always loaded into X0, X1, X2...
-        // The RegisterManager will handle keeping them in registers if needed later.
-        // We still need to store them to their stack home for consistency and potential spills.
-        codeGen.registerManager.assignParameterRegister(node->params[i], codeGen.X0 + i, offset);
-        codeGen.registerManager.markDirty(node->params[i]);
+        SymbolId param = SymbolTable::getInstance().intern(node->params[i]);
+        int offset = codeGen.allocateLocal(param); // Allocate stack space
+        if (i < 8) {
+            codeGen.registerManager.storeVariable(param, offset, codeGen.X0 + i);
+        } else {
+            // The caller left the rest at its SP, which is just above the saved FP/LR
+            uint32_t reg = codeGen.scratchAllocator.acquire();
+            codeGen.instructions.ldr(reg, codeGen.X29, 16 + static_cast<int32_t>(i - 8) * 8,
+                                     [&] { return "Load stack parameter " + node->params[i]; });
+            codeGen.registerManager.storeVariable(param, offset, reg);
+            codeGen.scratchAllocator.release(reg);
+        }
     }
 
     // Visit function body
     if (node->body_expr) {
-        if (auto valof = dynamic_cast<const Valof*>(node->body_expr.get())) {
+        if (auto valof = nodeCast<Valof>(node->body_expr.get())) {
             codeGen.visitStatement(valof->body.get());
         } else {
             codeGen.visitExpression(node->body_expr.get());
@@ -84,10 +104,6 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
 
     // Define the return label here, before the epilogue.
     codeGen.instructions.setPendingLabel(returnLabel);
-    codeGen.labelManager.defineLabel(returnLabel, codeGen.instructions.getCurrentAddress());
-
-    // Spill all dirty registers before function exit
-    codeGen.registerManager.spillAllDirtyRegisters();
 
     // Calculate total additional stack space needed (beyond the initial 16 bytes for FP/LR).
     // currentLocalVarOffset is negative, so -currentLocalVarOffset gives positive size.
@@ -102,7 +118,7 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
     for (const auto& vec : codeGen.vectorAllocations) {
         // This is not quite right, as the size can be an expression.
         // For now, we'll assume it's a number literal.
-        if (auto size = dynamic_cast<const NumberLiteral*>(vec->size.get())) {
+        if (auto size = nodeCast<NumberLiteral>(vec->size.get())) {
             total_frame_size += (size->value + 1) * 8;
         }
     }
@@ -114,13 +130,25 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
     // Back-patch the prologue with the correct frame size
     if (aligned_total_frame_size > 0) {
         codeGen.instructions.at(prologueSubInstructionIndex).encoding |= (aligned_total_frame_size << 10);
-        codeGen.instructions.at(prologueSubInstructionIndex).assembly = "sub sp, sp, #" + std::to_string(aligned_total_frame_size);
         // codeGen.addToListing("sub sp, sp, #" + std::to_string(aligned_total_frame_size)); // Removed addToListing
         // codeGen.addToListing("sub sp, sp, #" + std::to_string(aligned_total_frame_size)); // Removed addToListing
 
         // Back-patch the STP instruction with the correct offset
-        codeGen.instructions.at(stpInstructionIndex).encoding |= ((aligned_total_frame_size - 16) / 8) << 10; // Offset is in multiples of 8 bytes
-        codeGen.instructions.at(stpInstructionIndex).assembly = "stp x29, x30, [sp, #" + std::to_string(aligned_total_frame_size - 16) + "]";
+        codeGen.instructions.at(stpInstructionIndex).encoding |= (((aligned_total_frame_size - 16) / 8) & 0x7F) << 15; // Offset is in multiples of 8 bytes
+
+        // Point the frame pointer at the saved FP/LR so locals (negative offsets) stay inside the frame
+        codeGen.instructions.at(framePointerInstructionIndex).encoding = 0x91000000 | ((aligned_total_frame_size - 16) << 10) | (codeGen.SP << 5) | codeGen.X29;
+
+        // Tail calls release the frame before branching back to the entry point
+        for (size_t i = 0; i < codeGen.tailCallFrameReleases.size(); i++) {
+            AArch64Instructions release;
+            release.ldp(codeGen.X29, codeGen.X30, codeGen.SP, aligned_total_frame_size - 16, "Restore FP/LR");
+            release.add(codeGen.SP, codeGen.SP, aligned_total_frame_size, "Deallocate stack frame");
+            size_t index = codeGen.tailCallFrameReleases[i];
+            for (size_t j = 0; j < 2; j++) {
+                codeGen.instructions.at(index + j).encoding = release.getInstructions()[j].encoding;
+            }
+        }
     } else {
         // If no additional stack space is needed, remove the sub instruction
         codeGen.instructions.getInstructions().erase(codeGen.instructions.getInstructions().begin() + prologueSubInstructionIndex);
@@ -146,6 +174,7 @@ void StatementCodeGenerator::visitFunctionDeclaration(const FunctionDeclaration*
 
     codeGen.labelManager.popScope();
     codeGen.vectorAllocations.clear();
+    codeGen.registerManager.clear();
 }
 
 void StatementCodeGenerator::visitLetDeclaration(const LetDeclaration* node) {
@@ -154,10 +183,10 @@ void StatementCodeGenerator::visitLetDeclaration(const LetDeclaration* node) {
         if (init.init) {
             // Evaluate expression, result is in X0
             codeGen.visitExpression(init.init.get());
-            // For now, just allocate local storage but don't do register allocation
-            int offset = codeGen.allocateLocal(init.name);
-            // Store to local variable
-            codeGen.instructions.str(codeGen.X0, codeGen.X29, offset, "Store local " + init.name);
+            SymbolId var = SymbolTable::getInstance().intern(init.name);
+            int offset = codeGen.allocateLocal(var);
+            // Store to the local's register or stack slot
+            codeGen.registerManager.storeVariable(var, offset, codeGen.X0);
         }
     }
 }
@@ -172,19 +201,14 @@ void StatementCodeGenerator::visitCompoundStatement(const CompoundStatement* nod
 void StatementCodeGenerator::visitIfStatement(const IfStatement* node) {
     auto skipLabel = codeGen.labelManager.generateLabel("if_end");
 
-    // First, evaluate the condition. The result (TRUE or FALSE) will be in X0.
-    codeGen.visitExpression(node->condition.get());
-
-    // Now, use the highly efficient "Compare and Branch if Zero" instruction.
-    // This will branch to the end label if X0 is 0 (FALSE).
-    codeGen.instructions.cbz(codeGen.X0, skipLabel, "Branch if condition is false");
+    // Branch straight on the condition's flags to the end label if it is FALSE.
+    codeGen.expressionGenerator->generateCondition(node->condition.get(), false, skipLabel);
 
     // Generate the 'then' block code
     codeGen.visitStatement(node->then_statement.get());
 
     // Define the label that the branch skips to
     codeGen.instructions.setPendingLabel(skipLabel);
-    codeGen.labelManager.defineLabel(skipLabel, codeGen.instructions.getCurrentAddress());
 }
 
 void StatementCodeGenerator::visitTestStatement(const TestStatement* node) {
@@ -192,25 +216,19 @@ void StatementCodeGenerator::visitTestStatement(const TestStatement* node) {
     auto endLabel = codeGen.labelManager.generateLabel("test_end");
 
     // Evaluate condition
-    codeGen.visitExpression(node->condition.get());
-    codeGen.instructions.cmp(codeGen.X0, 0);
-    codeGen.labelManager.requestLabelFixup(elseLabel, codeGen.instructions.getCurrentAddress());
-    codeGen.instructions.beq(elseLabel);
+    codeGen.expressionGenerator->generateCondition(node->condition.get(), false, elseLabel);
 
     // Generate then branch
     codeGen.visitStatement(node->then_statement.get());
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
     codeGen.instructions.b(endLabel);
 
     // Generate else branch
     codeGen.instructions.setPendingLabel(elseLabel);
-    codeGen.labelManager.defineLabel(elseLabel, codeGen.instructions.getCurrentAddress());
     if (node->else_statement) {
         codeGen.visitStatement(node->else_statement.get());
     }
 
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
 }
 
 void StatementCodeGenerator::visitWhileStatement(const WhileStatement* node) {
@@ -218,25 +236,22 @@ void StatementCodeGenerator::visitWhileStatement(const WhileStatement* node) {
 
     auto startLabel = codeGen.labelManager.getCurrentRepeatLabel();
     auto endLabel = codeGen.labelManager.getCurrentEndLabel();
+    auto bodyLabel = codeGen.labelManager.generateLabel("loop_body");
 
-    // Loop start
-    codeGen.instructions.setPendingLabel(startLabel);
-    codeGen.labelManager.defineLabel(startLabel, codeGen.instructions.getCurrentAddress());
-
-    // Evaluate condition
-    codeGen.visitExpression(node->condition.get());
-    codeGen.instructions.cmp(codeGen.X0, 0); // Compare result with 0 (BCPL false)
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
-    codeGen.instructions.beq(endLabel); // Branch if condition is 0 (false) to end
+    // The test sits at the bottom, so each iteration takes a single branch.
+    // LOOP continues at the test (startLabel).
+    codeGen.instructions.b(startLabel, "Enter loop at its test");
 
     // Generate loop body
+    codeGen.instructions.setPendingLabel(bodyLabel);
     codeGen.visitStatement(node->body.get());
-    codeGen.labelManager.requestLabelFixup(startLabel, codeGen.instructions.getCurrentAddress());
-    codeGen.instructions.b(startLabel);
+
+    // Loop test: branch back while the condition is TRUE
+    codeGen.instructions.setPendingLabel(startLabel);
+    codeGen.expressionGenerator->generateCondition(node->condition.get(), true, bodyLabel);
 
     // Loop end
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
 
     codeGen.labelManager.popScope();
 }
@@ -245,54 +260,94 @@ void StatementCodeGenerator::visitForStatement(const ForStatement* node) {
     codeGen.labelManager.pushScope(LabelManager::ScopeType::LOOP);
     auto startLabel = codeGen.labelManager.getCurrentRepeatLabel();
     auto endLabel = codeGen.labelManager.getCurrentEndLabel();
+    RegisterManager& regs = codeGen.registerManager;
 
-    // --- SETUP: Use registers for loop variables ---
-    // 1. Initialize 'i' in a register
+    // --- SETUP: the loop variable, limit and step live wherever the allocator put them ---
+    // 1. Initialize 'i'
+    const SymbolId var = SymbolTable::getInstance().intern(node->var_name);
     codeGen.visitExpression(node->from_expr.get()); // from_expr result in x0
-    int i_offset = codeGen.allocateLocal(node->var_name);
-    uint32_t i_reg = codeGen.registerManager.acquireRegisterForInit(node->var_name, i_offset);
-    codeGen.instructions.mov(i_reg, codeGen.X0, "Initialize loop var " + node->var_name + " in " + codeGen.instructions.regName(i_reg));
-    codeGen.registerManager.markDirty(node->var_name);
+    int i_offset = codeGen.allocateLocal(var);
+    regs.storeVariable(var, i_offset, codeGen.X0);
 
-    // 2. Store the 'to' value in a register
+    // 2. Evaluate the 'to' value once into a hidden local
+    const SymbolId limit = LinearScanAllocator::forLimitSymbol(node);
     codeGen.visitExpression(node->to_expr.get()); // to_expr result in x0
-    uint32_t to_reg = codeGen.scratchAllocator.acquire();
-    codeGen.instructions.mov(to_reg, codeGen.X0, "Move 'to' value into " + codeGen.instructions.regName(to_reg));
-
-    // 3. Store the 'by' value in a register
-    uint32_t by_reg = codeGen.scratchAllocator.acquire();
-    if (node->by_expr) {
+    int limit_offset = codeGen.allocateLocal(limit);
+    regs.storeVariable(limit, limit_offset, codeGen.X0);
+
+    // 3. A literal 'by' value is folded into the increment; anything else is
+    //    evaluated once into another hidden local
+    int64_t step = 0;
+    bool constantStep = LoopOptimizer::constantForStep(node, step);
+    SymbolId stepSymbol = SymbolTable::NoSymbol;
+    int step_offset = 0;
+    if (!constantStep) {
+        stepSymbol = LinearScanAllocator::forStepSymbol(node);
         codeGen.visitExpression(node->by_expr.get());
-    } else {
-        codeGen.instructions.loadImmediate(codeGen.X0, 1);
+        step_offset = codeGen.allocateLocal(stepSymbol);
+        regs.storeVariable(stepSymbol, step_offset, codeGen.X0);
     }
-    codeGen.instructions.mov(by_reg, codeGen.X0, "Move 'by' value into " + codeGen.instructions.regName(by_reg));
+
+    // Locals that were spilled are brought into scratch registers around each use
+    auto materialize = [&](SymbolId symbol, int offset) {
+        uint32_t reg = regs.getVariableRegister(symbol);
+        if (reg != 0xFFFFFFFF) {
+            return std::make_pair(reg, false);
+        }
+        reg = codeGen.scratchAllocator.acquire();
+        regs.loadVariable(symbol, offset, reg);
+        return std::make_pair(reg, true);
+    };
 
     // --- LOOP START ---
     codeGen.instructions.setPendingLabel(startLabel);
-    codeGen.labelManager.defineLabel(startLabel, codeGen.instructions.getCurrentAddress());
 
-    // --- CONDITION: Compare registers directly ---
-    codeGen.instructions.cmp(i_reg, to_reg);
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
-    codeGen.instructions.bgt(endLabel); // Exit if i > to
+    // --- CONDITION ---
+    auto i_val = materialize(var, i_offset);
+    auto limit_val = materialize(limit, limit_offset);
+    codeGen.instructions.cmp(i_val.first, limit_val.first);
+    if (i_val.second) {
+        codeGen.scratchAllocator.release(i_val.first);
+    }
+    if (limit_val.second) {
+        codeGen.scratchAllocator.release(limit_val.first);
+    }
+    if (constantStep && step < 0) {
+        codeGen.instructions.blt(endLabel); // Exit if i < to when counting down
+    } else {
+        codeGen.instructions.bgt(endLabel); // Exit if i > to
+    }
 
     // --- BODY ---
     codeGen.visitStatement(node->body.get());
 
-    // --- INCREMENT: Use registers directly ---
-    codeGen.instructions.add(i_reg, i_reg, by_reg, AArch64Instructions::LSL, 0, "Increment " + node->var_name);
-    codeGen.registerManager.markDirty(node->var_name); // 'i' has changed
-    codeGen.labelManager.requestLabelFixup(startLabel, codeGen.instructions.getCurrentAddress());
+    // --- INCREMENT ---
+    i_val = materialize(var, i_offset);
+    if (constantStep && step >= 0 && step <= 4095) {
+        codeGen.instructions.add(i_val.first, i_val.first, static_cast<uint32_t>(step), [&] { return "Increment " + node->var_name; });
+    } else if (constantStep && step < 0 && step >= -4095) {
+        codeGen.instructions.sub_imm(i_val.first, i_val.first, static_cast<uint32_t>(-step), [&] { return "Decrement " + node->var_name; });
+    } else {
+        std::pair<uint32_t, bool> step_val;
+        if (constantStep) {
+            step_val = std::make_pair(codeGen.scratchAllocator.acquire(), true);
+            codeGen.instructions.loadImmediate(step_val.first, step, "Load step");
+        } else {
+            step_val = materialize(stepSymbol, step_offset);
+        }
+        codeGen.instructions.add(i_val.first, i_val.first, step_val.first, AArch64Instructions::LSL, 0, [&] { return "Increment " + node->var_name; });
+        if (step_val.second) {
+            codeGen.scratchAllocator.release(step_val.first);
+        }
+    }
+    if (i_val.second) {
+        regs.storeVariable(var, i_offset, i_val.first);
+        codeGen.scratchAllocator.release(i_val.first);
+    }
     codeGen.instructions.b(startLabel);
 
     // --- LOOP END ---
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
-
-    // Release scratch registers used for 'to' and 'by'
-    codeGen.scratchAllocator.release(to_reg);
-    codeGen.scratchAllocator.release(by_reg);
 
     codeGen.labelManager.popScope();
 }
@@ -301,35 +356,44 @@ void StatementCodeGenerator::visitSwitchonStatement(const SwitchonStatement* nod
     codeGen.labelManager.pushScope(LabelManager::ScopeType::SWITCHON);
 
     auto endLabel = codeGen.labelManager.getCurrentEndLabel();
-    auto defaultLabel = codeGen.labelManager.generateLabel("switch_default");
+    // Without a DEFAULT, values that match no case leave the switch directly
+    auto defaultLabel = node->default_case ? codeGen.labelManager.generateLabel("switch_default") : endLabel;
 
     // Evaluate switch expression. Value is now in X0.
     codeGen.visitExpression(node->expression.get());
 
-    // The value is in X0. We pass it directly to the search functions.
-    // This removes the store/load inefficiency and the garbage ldr.
-    if (node->cases.size() > 0 && isSmallDenseRange(node->cases)) {
-        generateJumpTable(node->cases, defaultLabel);
-    } else {
-        generateBinarySearchTree(node->cases, defaultLabel);
+    // Sort the cases by value; the first of several equal values wins.
+    std::vector<LabelManager::Label> caseLabels;
+    std::vector<CaseTarget> targets;
+    for (const auto& caseStmt : node->cases) {
+        caseLabels.push_back(codeGen.labelManager.generateLabel("case"));
+        targets.push_back({caseStmt.value, caseLabels.back()});
     }
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](const CaseTarget& a, const CaseTarget& b) { return a.value < b.value; });
+    targets.erase(std::unique(targets.begin(), targets.end(),
+                              [](const CaseTarget& a, const CaseTarget& b) { return a.value == b.value; }),
+                  targets.end());
 
-    // Generate case bodies using the correct labels from the AST.
-    for (const auto& caseStmt : node->cases) {
-        codeGen.instructions.setPendingLabel(caseStmt.label);
-        codeGen.labelManager.defineLabel(caseStmt.label, codeGen.instructions.getCurrentAddress());
+    // The value is in X0. We pass it directly to the search functions.
+    generateBinarySearchTree(targets, defaultLabel);
+
+    // Generate case bodies at the labels the dispatch code branches to.
+    for (size_t i = 0; i < node->cases.size(); ++i) {
+        const auto& caseStmt = node->cases[i];
+        codeGen.instructions.setPendingLabel(caseLabels[i]);
         codeGen.visitStatement(caseStmt.statement.get());
 
         // Only emit a branch to end of switch if the case body doesn't end with ENDCASE
         // This requires inspecting the last statement of the case body.
         bool endsWithEndcase = false;
-        if (auto compoundStmt = dynamic_cast<const CompoundStatement*>(caseStmt.statement.get())) {
+        if (auto compoundStmt = nodeCast<CompoundStatement>(caseStmt.statement.get())) {
             if (!compoundStmt->statements.empty()) {
-                if (dynamic_cast<const EndcaseStatement*>(compoundStmt->statements.back().get())) {
+                if (nodeCast<EndcaseStatement>(compoundStmt->statements.back().get())) {
                     endsWithEndcase = true;
                 }
             }
-        } else if (dynamic_cast<const EndcaseStatement*>(caseStmt.statement.get())) {
+        } else if (nodeCast<EndcaseStatement>(caseStmt.statement.get())) {
             endsWithEndcase = true;
         }
 
@@ -339,22 +403,19 @@ void StatementCodeGenerator::visitSwitchonStatement(const SwitchonStatement* nod
     }
 
     // Default case
-    codeGen.instructions.setPendingLabel(defaultLabel);
-    codeGen.labelManager.defineLabel(defaultLabel, codeGen.instructions.getCurrentAddress());
     if (node->default_case) {
+        codeGen.instructions.setPendingLabel(defaultLabel);
         codeGen.visitStatement(node->default_case.get());
     }
 
     // End of switch
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
 
     codeGen.labelManager.popScope();
 }
 
 void StatementCodeGenerator::visitGotoStatement(const GotoStatement* node) {
-    if (auto label = dynamic_cast<const VariableAccess*>(node->label.get())) {
-        codeGen.labelManager.requestLabelFixup(label->name, codeGen.instructions.getCurrentAddress());
+    if (auto label = nodeCast<VariableAccess>(node->label.get())) {
         codeGen.instructions.b(label->name);
     } else {
         throw std::runtime_error("GOTO requires a label");
@@ -363,39 +424,30 @@ void StatementCodeGenerator::visitGotoStatement(const GotoStatement* node) {
 
 void StatementCodeGenerator::visitLabeledStatement(const LabeledStatement* node) {
     codeGen.instructions.setPendingLabel(node->name);
-    codeGen.labelManager.defineLabel(node->name, codeGen.instructions.getCurrentAddress());
     codeGen.visitStatement(node->statement.get());
 }
 
 void StatementCodeGenerator::visitAssignment(const Assignment* node) {
     codeGen.visitExpression(node->rhs[0].get());
 
-    if (auto num_lit = dynamic_cast<const NumberLiteral*>(node->lhs[0].get())) {
+    if (auto num_lit = nodeCast<NumberLiteral>(node->lhs[0].get())) {
         throw std::runtime_error("Cannot assign to a number literal.");
-    } else if (auto var = dynamic_cast<const VariableAccess*>(node->lhs[0].get())) {
-        if (auto it = codeGen.manifestConstants.find(var->name); it != codeGen.manifestConstants.end()) {
+    } else if (auto var = nodeCast<VariableAccess>(node->lhs[0].get())) {
+        if (codeGen.manifestConstants.contains(var->symbol)) {
             throw std::runtime_error("Cannot assign to manifest constant: " + var->name);
-        } else if (auto it = codeGen.globals.find(var->name); it != codeGen.globals.end()) {
-            codeGen.instructions.str(codeGen.X0, codeGen.X28, it->second * 8, "Store to global " + var->name);
+        } else if (const size_t* global = codeGen.globals.find(var->symbol)) {
+            codeGen.instructions.str(codeGen.X0, codeGen.X28, *global * 8, [&] { return "Store to global " + var->name; });
         } else {
-            // uint32_t reg = codeGen.registerManager.getVariableRegister(var->name);
-            // if (reg == 0xFFFFFFFF) {
-            //     int offset = codeGen.getLocalOffset(var->name);
-            //     reg = codeGen.registerManager.acquireRegisterForInit(var->name, offset);
-            // }
-            // codeGen.instructions.mov(reg, codeGen.X0, "Assign value to " + var->name + " in " + codeGen.instructions.regName(reg));
-            int offset = codeGen.getLocalOffset(var->name);
-            codeGen.instructions.str(codeGen.X0, codeGen.X29, offset, "Store to local var " + var->name);
-            // After storing to memory, remove any stale copies from the register map.
-            codeGen.registerManager.removeVariableFromRegister(var->name);
+            int offset = codeGen.getLocalOffset(var->symbol);
+            codeGen.registerManager.storeVariable(var->symbol, offset, codeGen.X0);
         }
-    } else if (auto deref = dynamic_cast<const DereferenceExpr*>(node->lhs[0].get())) {
+    } else if (auto deref = nodeCast<DereferenceExpr>(node->lhs[0].get())) {
         uint32_t valueReg = codeGen.scratchAllocator.acquire();
         codeGen.instructions.mov(valueReg, codeGen.X0, "Save RHS value for dereference assignment");
         codeGen.visitExpression(deref->pointer.get());
         codeGen.instructions.str(valueReg, codeGen.X0, 0, "Store to computed address");
         codeGen.scratchAllocator.release(valueReg);
-    } else if (auto vecAccess = dynamic_cast<const VectorAccess*>(node->lhs[0].get())) {
+    } else if (auto vecAccess = nodeCast<VectorAccess>(node->lhs[0].get())) {
         uint32_t valueReg = codeGen.scratchAllocator.acquire();
         codeGen.instructions.mov(valueReg, codeGen.X0, "Save RHS value for vector assignment");
         codeGen.visitExpression(vecAccess->index.get());
@@ -409,7 +461,7 @@ void StatementCodeGenerator::visitAssignment(const Assignment* node) {
         codeGen.scratchAllocator.release(vectorBaseReg);
         codeGen.scratchAllocator.release(indexReg);
         codeGen.scratchAllocator.release(valueReg);
-    } else if (auto charAccess = dynamic_cast<const CharacterAccess*>(node->lhs[0].get())) {
+    } else if (auto charAccess = nodeCast<CharacterAccess>(node->lhs[0].get())) {
         uint32_t valueReg = codeGen.scratchAllocator.acquire();
         codeGen.instructions.mov(valueReg, codeGen.X0, "Save RHS value for character assignment");
         codeGen.visitExpression(charAccess->index.get());
@@ -429,8 +481,8 @@ void StatementCodeGenerator::visitAssignment(const Assignment* node) {
 }
 
 void StatementCodeGenerator::visitRoutineCall(const RoutineCall* node) {
-    if (auto funcCall = dynamic_cast<const FunctionCall*>(node->call_expression.get())) {
-        if (auto funcVar = dynamic_cast<const VariableAccess*>(funcCall->function.get())) {
+    if (auto funcCall = nodeCast<FunctionCall>(node->call_expression.get())) {
+        if (auto funcVar = nodeCast<VariableAccess>(funcCall->function.get())) {
             if (funcVar->name == "WRITES") {
                 codeGen.visitExpression(funcCall->arguments[0].get());
                 codeGen.instructions.bl("writes", "Call writes");
@@ -443,13 +495,13 @@ void StatementCodeGenerator::visitRoutineCall(const RoutineCall* node) {
                 // This is a temporary simplification and not fully ABI compliant for multiple args
                 size_t argsBytes = funcCall->arguments.size() * 8;
                 if (argsBytes > 0) {
-                    codeGen.instructions.sub(codeGen.SP, codeGen.SP, argsBytes, "Allocate space for WRITEF arguments");
+                    codeGen.instructions.sub_imm(codeGen.SP, codeGen.SP, argsBytes, "Allocate space for WRITEF arguments");
                 }
 
                 // Evaluate arguments and store them on the stack in reverse order
                 for (size_t i = 0; i < funcCall->arguments.size(); ++i) {
                     codeGen.visitExpression(funcCall->arguments[funcCall->arguments.size() - 1 - i].get()); // Result in X0
-                    codeGen.instructions.str(codeGen.X0, codeGen.SP, i * 8, "Store WRITEF argument " + std::to_string(funcCall->arguments.size() - 1 - i));
+                    codeGen.instructions.str(codeGen.X0, codeGen.SP, i * 8, [&] { return "Store WRITEF argument " + std::to_string(funcCall->arguments.size() - 1 - i); });
                 }
 
                 // Load format string into X0, first argument into X1
@@ -474,37 +526,8 @@ void StatementCodeGenerator::visitRoutineCall(const RoutineCall* node) {
             } else if (funcVar->name == "FINISH") {
                 codeGen.instructions.bl("finish", "Call finish");
             } else {
-                // Regular function call
-                codeGen.saveCallerSavedRegisters();
-
-                // Evaluate arguments and push them onto the stack in reverse order
-                size_t argsBytes = funcCall->arguments.size() * 8;
-                if (argsBytes > 0) {
-                    codeGen.instructions.sub(codeGen.SP, codeGen.SP, argsBytes, "Allocate space for outgoing arguments");
-                }
-
-                for (size_t i = 0; i < funcCall->arguments.size(); ++i) {
-                    codeGen.visitExpression(funcCall->arguments[i].get()); // Result in X0
-                    codeGen.instructions.str(codeGen.X0, codeGen.SP, i * 8, "Store argument " + std::to_string(i));
-                }
-
-                // Load arguments into registers (x0, x1, x2...) from the stack
-                // Only load up to 8 arguments into registers as per AArch64 ABI
-                for (size_t i = 0; i < std::min((size_t)8, funcCall->arguments.size()); ++i) {
-                    codeGen.instructions.ldr(codeGen.X0 + i, codeGen.SP, i * 8, "Load parameter into register");
-                }
-
-                if (auto it = codeGen.functions.find(funcVar->name); it != codeGen.functions.end()) {
-                    codeGen.instructions.bl(funcVar->name, "Call routine " + funcVar->name);
-                } else {
-                    throw std::runtime_error("Unknown routine: " + funcVar->name);
-                }
-
-                // Deallocate arguments pushed for this call
-                if (argsBytes > 0) {
-                    codeGen.instructions.add(codeGen.SP, codeGen.SP, argsBytes, "Deallocate outgoing arguments");
-                }
-                codeGen.restoreCallerSavedRegisters();
+                // Regular routine call: the same calling sequence as a function call, result ignored
+                codeGen.expressionGenerator->visitFunctionCall(funcCall);
             }
         }
     }
@@ -519,42 +542,22 @@ void StatementCodeGenerator::visitReturnStatement(const ReturnStatement* node) {
 
 void StatementCodeGenerator::visitResultisStatement(const ResultisStatement* node) {
     // Check for a potential tail call: RESULTIS MyFunction(...)
-    if (auto call = dynamic_cast<const FunctionCall*>(node->value.get())) {
-        if (auto funcVar = dynamic_cast<const VariableAccess*>(call->function.get())) {
-            // Check if it's a direct recursive call
-            if (funcVar->name == codeGen.currentFunctionName) {
-
-                // --- FINAL, CORRECTED TAIL CALL LOGIC ---
-                // This logic is now specific to the 2-argument FACT_TAIL case to ensure correctness.
-                if (call->arguments.size() == 2) {
-
-                    // 1. Save original arguments N (from X0) and ACCUMULATOR (from X1)
-                    //    to scratch registers so they don't get overwritten during calculations.
-                    uint32_t reg_N_orig = codeGen.scratchAllocator.acquire();
-                    codeGen.instructions.mov(reg_N_orig, codeGen.X0, "Save original N");
-
-                    uint32_t reg_ACC_orig = codeGen.scratchAllocator.acquire();
-                    codeGen.instructions.mov(reg_ACC_orig, codeGen.X1, "Save original ACCUMULATOR");
-
-                    // 2. Calculate the NEW second argument (N * ACCUMULATOR) and place it directly into X1.
-                    //    This uses the saved original values.
-                    codeGen.instructions.mul(codeGen.X1, reg_N_orig, reg_ACC_orig, "Calculate new accumulator");
-
-                    // 3. Calculate the NEW first argument (N - 1) and place it directly into X0.
-                    //    This also uses the saved original N.
-                    codeGen.instructions.sub_imm(codeGen.X0, reg_N_orig, 1, "Calculate new N");
-
-                    // 4. Release the scratch registers.
-                    codeGen.scratchAllocator.release(reg_N_orig);
-                    codeGen.scratchAllocator.release(reg_ACC_orig);
-
-                } else {
-                    // Fail explicitly if a different number of arguments is used,
-                    // as the generic logic is not yet robust.
-                    throw std::runtime_error("Tail-call optimization for this number of arguments is not yet implemented.");
-                }
-
-                // 5. Jump to the beginning of the current function with X0 and X1 correctly set.
+    if (auto call = nodeCast<FunctionCall>(node->value.get())) {
+        if (auto funcVar = nodeCast<VariableAccess>(call->function.get())) {
+            // Check if it's a direct recursive call with register-only arguments
+            if (funcVar->name == codeGen.currentFunctionName && call->arguments.size() <= 8) {
+                // 1. Evaluate the new arguments into X0-X7 as for a normal call, parking
+                //    any that a later call would clobber. The parameters still hold
+                //    the old values while this happens.
+                codeGen.expressionGenerator->evaluateArguments(call->arguments);
+
+                // 2. Release this frame; the ldp/add offsets are back-patched with the frame size.
+                codeGen.restoreCalleeSavedRegisters();
+                codeGen.tailCallFrameReleases.push_back(codeGen.instructions.size());
+                codeGen.instructions.ldp(codeGen.X29, codeGen.X30, codeGen.SP, 0, "Restore FP/LR (placeholder offset)");
+                codeGen.instructions.add(codeGen.SP, codeGen.SP, 0, "Deallocate stack frame (placeholder)");
+
+                // 3. Jump to the entry point, which sets up a fresh frame and moves the arguments home.
                 codeGen.instructions.b(codeGen.currentFunctionName, "Tail call optimization");
                 return; // Skip normal epilogue generation for this path.
             }
@@ -563,14 +566,6 @@ void StatementCodeGenerator::visitResultisStatement(const ResultisStatement* nod
 
     // --- Original logic for a normal, non-tail-call RESULTIS ---
     codeGen.visitExpression(node->value.get());
-
-    if (auto var_access = dynamic_cast<const VariableAccess*>(node->value.get())) {
-        uint32_t reg = codeGen.registerManager.getVariableRegister(var_access->name);
-        if (reg != 0xFFFFFFFF) {
-            codeGen.registerManager.releaseRegisterWithoutSpill(reg);
-        }
-    }
-
     codeGen.instructions.b(codeGen.labelManager.getCurrentReturnLabel(), "Branch to function epilogue after RESULTIS");
 }
 
@@ -581,13 +576,11 @@ void StatementCodeGenerator::visitResultisStatement(const ResultisStatement* nod
 
 void StatementCodeGenerator::visitBreakStatement(const BreakStatement* node) {
     auto endLabel = codeGen.labelManager.getCurrentEndLabel();
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
     codeGen.instructions.b(endLabel, "Break from current construct");
 }
 
 void StatementCodeGenerator::visitLoopStatement(const LoopStatement* node) {
     auto startLabel = codeGen.labelManager.getCurrentRepeatLabel();
-    codeGen.labelManager.requestLabelFixup(startLabel, codeGen.instructions.getCurrentAddress());
     codeGen.instructions.b(startLabel, "Loop back");
 }
 
@@ -598,7 +591,6 @@ void StatementCodeGenerator::visitRepeatStatement(const RepeatStatement* node) {
 
     // Define the start label for the loop
     codeGen.instructions.setPendingLabel(startLabel);
-    codeGen.labelManager.defineLabel(startLabel, codeGen.instructions.getCurrentAddress());
 
     // Generate code for the loop body
     codeGen.visitStatement(node->body.get());
@@ -616,9 +608,7 @@ void StatementCodeGenerator::visitRepeatStatement(const RepeatStatement* node) {
             // The loop continues if the condition is TRUE (-1).
             // So, we branch to the start if the condition is NOT FALSE (0).
             assert(node->condition && "REPEATWHILE must have a condition");
-            codeGen.visitExpression(node->condition.get()); // Result in X0
-            codeGen.instructions.cmp(codeGen.X0, 0); // Compare with 0 (FALSE)
-            codeGen.instructions.bne(startLabel, "Branch if true (not zero)"); // Branch if not equal to 0
+            codeGen.expressionGenerator->generateCondition(node->condition.get(), true, startLabel);
             break;
 
         case RepeatStatement::LoopType::repeatuntil:
@@ -626,28 +616,25 @@ void StatementCodeGenerator::visitRepeatStatement(const RepeatStatement* node) {
             // The loop continues if the condition is FALSE (0).
             // So, we branch to the start if the condition is FALSE (0).
             assert(node->condition && "REPEATUNTIL must have a condition");
-            codeGen.visitExpression(node->condition.get()); // Result in X0
-            codeGen.instructions.cmp(codeGen.X0, 0); // Compare with 0 (FALSE)
-            codeGen.instructions.beq(startLabel, "Branch if false (zero)"); // Branch if equal to 0
+            codeGen.expressionGenerator->generateCondition(node->condition.get(), false, startLabel);
             break;
     }
 
     // Define the end label for BREAK statements
     codeGen.instructions.setPendingLabel(endLabel);
-    codeGen.labelManager.defineLabel(endLabel, codeGen.instructions.getCurrentAddress());
 
     codeGen.labelManager.popScope();
 }
 
 
 void StatementCodeGenerator::visitEndcaseStatement(const EndcaseStatement* node) {
-    // TODO: Move implementation from CodeGenerator.cpp
+    auto endcaseLabel = codeGen.labelManager.getCurrentEndcaseLabel();
+    codeGen.instructions.b(endcaseLabel, "ENDCASE");
 }
 
 void StatementCodeGenerator::visitFinishStatement(const FinishStatement* node) {
     // This typically exits the current loop or function. For now, we'll treat it like a break.
     auto endLabel = codeGen.labelManager.getCurrentEndLabel();
-    codeGen.labelManager.requestLabelFixup(endLabel, codeGen.instructions.getCurrentAddress());
     codeGen.instructions.b(endLabel, "Finish current construct");
 }
 
@@ -657,19 +644,154 @@ void StatementCodeGenerator::visitDeclarationStatement(const DeclarationStatemen
 }
 
 // Helper methods for switch statement generation
-void StatementCodeGenerator::generateJumpTable(const std::vector<SwitchonStatement::SwitchCase>& cases, const std::string& defaultLabel) {
-    // TODO: Move implementation from CodeGenerator.cpp
+
+// Smallest number of cases worth a jump table, and the limits on its size.
+// A table costs one word per value in its range, so it must also be dense.
+static constexpr size_t MIN_JUMP_TABLE_CASES = 4;
+static constexpr int64_t MAX_JUMP_TABLE_RANGE = 4096;
+static constexpr int64_t MIN_JUMP_TABLE_DENSITY_PERCENT = 40;
+
+// Up to this many single values are tested one after another rather than split further
+static constexpr size_t MAX_LINEAR_CASES = 3;
+
+void StatementCodeGenerator::compareSwitchValue(int64_t value) {
+    if (value >= 0 && value <= 4095) {
+        codeGen.instructions.cmp_imm(AArch64Instructions::X0, static_cast<uint32_t>(value), [&] { return "CASE " + std::to_string(value); });
+    } else {
+        uint32_t reg = codeGen.scratchAllocator.acquire();
+        codeGen.instructions.loadImmediate(reg, value);
+        codeGen.instructions.cmp(AArch64Instructions::X0, reg, [&] { return "CASE " + std::to_string(value); });
+        codeGen.scratchAllocator.release(reg);
+    }
+}
+
+void StatementCodeGenerator::generateJumpTable(const std::vector<CaseTarget>& cases, const CaseCluster& cluster, bool needsBoundsCheck, LabelManager::Label defaultLabel) {
+    const int64_t low = cases[cluster.first].value;
+    const int64_t high = cases[cluster.last].value;
+    auto tableLabel = codeGen.labelManager.generateLabel("jump_table");
+
+    // Rebase the value so the table starts at index 0
+    if (low > 0 && low <= 4095) {
+        codeGen.instructions.sub_imm(AArch64Instructions::X0, AArch64Instructions::X0, static_cast<uint32_t>(low), "Rebase switch value");
+    } else if (low != 0) {
+        uint32_t reg = codeGen.scratchAllocator.acquire();
+        codeGen.instructions.loadImmediate(reg, low);
+        codeGen.instructions.sub_reg(AArch64Instructions::X0, AArch64Instructions::X0, reg, "Rebase switch value");
+        codeGen.scratchAllocator.release(reg);
+    }
+
+    // An unsigned compare also catches values below the table, which wrapped around
+    if (needsBoundsCheck) {
+        codeGen.instructions.cmp_imm(AArch64Instructions::X0, static_cast<uint32_t>(high - low), "Jump table bounds");
+        codeGen.instructions.bhi(defaultLabel, "Outside the table");
+    }
+
+    uint32_t reg = codeGen.scratchAllocator.acquire();
+    codeGen.instructions.adr(reg, tableLabel, "Jump table base");
+    codeGen.instructions.add(reg, reg, AArch64Instructions::X0, AArch64Instructions::LSL, 2, "Index the table");
+    codeGen.instructions.br(reg, "Dispatch through jump table");
+    codeGen.scratchAllocator.release(reg);
+
+    // One branch per value in the range; holes go to the default
+    codeGen.instructions.setPendingLabel(tableLabel);
+    size_t next = cluster.first;
+    for (int64_t value = low; value <= high; ++value) {
+        if (cases[next].value == value) {
+            codeGen.instructions.b(cases[next].label, [&] { return "CASE " + std::to_string(value); });
+            ++next;
+        } else {
+            codeGen.instructions.b(defaultLabel, [&] { return "No CASE " + std::to_string(value); });
+        }
+    }
+}
+
+void StatementCodeGenerator::generateBinarySearchTree(const std::vector<CaseTarget>& cases, LabelManager::Label defaultLabel) {
+    if (cases.empty()) {
+        codeGen.instructions.b(defaultLabel, "SWITCHON without cases");
+        return;
+    }
+    std::vector<CaseCluster> clusters = clusterCases(cases);
+    generateBinarySearchNode(cases, clusters, 0, clusters.size() - 1,
+                             std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), false, defaultLabel);
 }
 
-void StatementCodeGenerator::generateBinarySearchTree(const std::vector<SwitchonStatement::SwitchCase>& cases, const std::string& defaultLabel) {
-    // TODO: Move implementation from CodeGenerator.cpp
+void StatementCodeGenerator::generateBinarySearchNode(const std::vector<CaseTarget>& cases, const std::vector<CaseCluster>& clusters, size_t start, size_t end,
+                                                      int64_t lowBound, int64_t highBound, bool flagsHoldLowBound, LabelManager::Label defaultLabel) {
+    // The switch value is known to lie in [lowBound, highBound] here. When
+    // flagsHoldLowBound is set, the flags still hold its comparison with lowBound.
+    const size_t count = end - start + 1;
+
+    if (count == 1 && clusters[start].isTable) {
+        const bool needsBoundsCheck = lowBound < cases[clusters[start].first].value ||
+                                      highBound > cases[clusters[start].last].value;
+        generateJumpTable(cases, clusters[start], needsBoundsCheck, defaultLabel);
+        return;
+    }
+
+    bool allSingle = true;
+    for (size_t i = start; i <= end; ++i) {
+        allSingle = allSingle && !clusters[i].isTable;
+    }
+    if (allSingle && count <= MAX_LINEAR_CASES) {
+        if (count == 1 && lowBound == highBound) {
+            // Only one value can reach this point
+            codeGen.instructions.b(cases[clusters[start].first].label, [&] { return "CASE " + std::to_string(lowBound); });
+            return;
+        }
+        for (size_t i = start; i <= end; ++i) {
+            const CaseTarget& target = cases[clusters[i].first];
+            if (i != start || !flagsHoldLowBound || target.value != lowBound) {
+                compareSwitchValue(target.value);
+            }
+            codeGen.instructions.beq(target.label);
+        }
+        codeGen.instructions.b(defaultLabel, "No matching CASE");
+        return;
+    }
+
+    // Split at the middle cluster: values below its first case go left
+    const size_t mid = start + count / 2;
+    const int64_t pivot = cases[clusters[mid].first].value;
+    auto leftLabel = codeGen.labelManager.generateLabel("switch_lower");
+
+    compareSwitchValue(pivot);
+    codeGen.instructions.blt(leftLabel, [&] { return "Below " + std::to_string(pivot); });
+    generateBinarySearchNode(cases, clusters, mid, end, pivot, highBound, true, defaultLabel);
+
+    codeGen.instructions.setPendingLabel(leftLabel);
+    generateBinarySearchNode(cases, clusters, start, mid - 1, lowBound, pivot - 1, false, defaultLabel);
 }
 
-void StatementCodeGenerator::generateBinarySearchNode(const std::vector<SwitchonStatement::SwitchCase>& cases, size_t start, size_t end, const std::string& defaultLabel) {
-    // TODO: Move implementation from CodeGenerator.cpp
+std::vector<StatementCodeGenerator::CaseCluster> StatementCodeGenerator::clusterCases(const std::vector<CaseTarget>& cases) {
+    // Partition the sorted cases into the fewest clusters, where a cluster is a
+    // single value or a range dense enough for a jump table.
+    const size_t n = cases.size();
+    std::vector<size_t> best(n + 1, std::numeric_limits<size_t>::max());
+    std::vector<size_t> split(n + 1, 0);
+    best[0] = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (best[j] + 1 < best[i] && (i - j == 1 || isSmallDenseRange(cases, j, i - 1))) {
+                best[i] = best[j] + 1;
+                split[i] = j;
+            }
+        }
+    }
+
+    std::vector<CaseCluster> clusters;
+    for (size_t i = n; i > 0; i = split[i]) {
+        clusters.push_back({split[i], i - 1, i - 1 > split[i]});
+    }
+    std::reverse(clusters.begin(), clusters.end());
+    return clusters;
 }
 
-bool StatementCodeGenerator::isSmallDenseRange(const std::vector<SwitchonStatement::SwitchCase>& cases) {
-    // TODO: Move implementation from CodeGenerator.cpp
-    return false;
+bool StatementCodeGenerator::isSmallDenseRange(const std::vector<CaseTarget>& cases, size_t first, size_t last) {
+    const size_t count = last - first + 1;
+    if (count < MIN_JUMP_TABLE_CASES) {
+        return false;
+    }
+    const int64_t range = cases[last].value - cases[first].value + 1;
+    return range <= MAX_JUMP_TABLE_RANGE &&
+           static_cast<int64_t>(count) * 100 >= range * MIN_JUMP_TABLE_DENSITY_PERCENT;
 }
@@ -7,6 +7,7 @@
 #include "LabelManager.h"
 #include "ScratchAllocator.h"
 #include "RegisterManager.h"
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -43,14 +44,32 @@ public:
     void visitFinishStatement(const FinishStatement* node);
     void visitDeclarationStatement(const DeclarationStatement* node);
 
+    // The IR selector dispatches SWITCHON through the same case clustering
+    friend class IRSelector;
+
 private:
     CodeGenerator& codeGen;
     
-    // Helper methods for switch statement generation
-    void generateJumpTable(const std::vector<SwitchonStatement::SwitchCase>& cases, const std::string& defaultLabel);
-    void generateBinarySearchTree(const std::vector<SwitchonStatement::SwitchCase>& cases, const std::string& defaultLabel);
-    void generateBinarySearchNode(const std::vector<SwitchonStatement::SwitchCase>& cases, size_t start, size_t end, const std::string& defaultLabel);
-    bool isSmallDenseRange(const std::vector<SwitchonStatement::SwitchCase>& cases);
+    // Helper methods for switch statement generation.
+    // Cases are sorted by value and split into clusters: runs dense enough for
+    // a jump table, and single values. A balanced compare tree over the
+    // clusters picks the one to dispatch through.
+    struct CaseTarget {
+        int64_t value;
+        LabelManager::Label label;
+    };
+    struct CaseCluster {
+        size_t first; // Index of the first case in the cluster
+        size_t last;  // Index of the last case in the cluster
+        bool isTable;
+    };
+    std::vector<CaseCluster> clusterCases(const std::vector<CaseTarget>& cases);
+    void generateJumpTable(const std::vector<CaseTarget>& cases, const CaseCluster& cluster, bool needsBoundsCheck, LabelManager::Label defaultLabel);
+    void generateBinarySearchTree(const std::vector<CaseTarget>& cases, LabelManager::Label defaultLabel);
+    void generateBinarySearchNode(const std::vector<CaseTarget>& cases, const std::vector<CaseCluster>& clusters, size_t start, size_t end,
+                                  int64_t lowBound, int64_t highBound, bool flagsHoldLowBound, LabelManager::Label defaultLabel);
+    bool isSmallDenseRange(const std::vector<CaseTarget>& cases, size_t first, size_t last);
+    void compareSwitchValue(int64_t value);
 };
 
 #endif // STATEMENTCODEGENERATOR_H
\ No newline at end of file
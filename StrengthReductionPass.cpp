@@ -0,0 +1,536 @@
+#include "StrengthReductionPass.h"
+#include "LoopOptimizer.h"
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// V!I addresses V + I*8 in every code generator
+constexpr int64_t WordShift = 3;
+
+ExprPtr number(int64_t value) {
+    return std::make_unique<NumberLiteral>(value);
+}
+
+ExprPtr variable(const std::string& name) {
+    return std::make_unique<VariableAccess>(name);
+}
+
+StmtPtr let(const std::string& name, ExprPtr value) {
+    std::vector<LetDeclaration::VarInit> inits;
+    inits.push_back(LetDeclaration::VarInit{name, std::move(value)});
+    return std::make_unique<DeclarationStatement>(std::make_unique<LetDeclaration>(std::move(inits)));
+}
+
+// left op right for +, -, * and <<, folding literals so the setup stays small.
+// Operands are pure, so dropping one multiplied by 0 is safe.
+ExprPtr arithmetic(TokenType op, ExprPtr left, ExprPtr right) {
+    auto* l = nodeCast<NumberLiteral>(left.get());
+    auto* r = nodeCast<NumberLiteral>(right.get());
+    if (l && r) {
+        const uint64_t a = static_cast<uint64_t>(l->value);
+        const uint64_t b = static_cast<uint64_t>(r->value);
+        switch (op) {
+            case TokenType::OpPlus:     return number(static_cast<int64_t>(a + b));
+            case TokenType::OpMinus:    return number(static_cast<int64_t>(a - b));
+            case TokenType::OpMultiply: return number(static_cast<int64_t>(a * b));
+            case TokenType::OpLshift:   if (b < 64) return number(static_cast<int64_t>(a << b)); break;
+            default: break;
+        }
+    }
+    if (r && r->value == 0 && (op == TokenType::OpPlus || op == TokenType::OpMinus || op == TokenType::OpLshift)) {
+        return left;
+    }
+    if (l && l->value == 0 && op == TokenType::OpPlus) return right;
+    if (op == TokenType::OpMultiply) {
+        if ((l && l->value == 0) || (r && r->value == 0)) return number(0);
+        if (r && r->value == 1) return left;
+        if (l && l->value == 1) return right;
+    }
+    return std::make_unique<BinaryOp>(op, std::move(left), std::move(right));
+}
+
+constexpr size_t NoNumber = static_cast<size_t>(-1);
+
+// The structure of an expression over the numbers of its operands, so equal
+// ones compare equal without being printed
+struct ExprKey {
+    NodeKind kind;
+    TokenType op;
+    int64_t imm;  // The value of a literal; the symbol of a variable or a vector base
+    size_t lhs;
+    size_t rhs;
+
+    bool operator==(const ExprKey& other) const {
+        return kind == other.kind && op == other.op && imm == other.imm && lhs == other.lhs && rhs == other.rhs;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey& key) const {
+        size_t hash = std::hash<int64_t>()(key.imm);
+        hash = hash * 31 + static_cast<size_t>(key.kind);
+        hash = hash * 31 + static_cast<size_t>(key.op);
+        hash = hash * 31 + key.lhs;
+        hash = hash * 31 + key.rhs;
+        return hash;
+    }
+};
+
+// Numbers invariant expressions by structure, so equal ones share a variable
+class ExprNumbering {
+public:
+    size_t numberOf(const Expression* expr) {
+        ExprKey key{NodeKind::NumberLiteral, TokenType::Eof, 0, NoNumber, NoNumber};
+        if (auto* num = nodeCast<NumberLiteral>(expr)) {
+            key.imm = num->value;
+        } else if (auto* chr = nodeCast<CharLiteral>(expr)) {
+            key.imm = static_cast<int64_t>(chr->value);
+        } else if (auto* var = nodeCast<VariableAccess>(expr)) {
+            key.kind = NodeKind::VariableAccess;
+            key.imm = var->symbol;
+        } else if (auto* unary = nodeCast<UnaryOp>(expr)) {
+            key.kind = NodeKind::UnaryOp;
+            key.op = unary->op;
+            key.lhs = numberOf(unary->rhs.get());
+        } else {
+            auto* binary = static_cast<const BinaryOp*>(expr);
+            key.kind = NodeKind::BinaryOp;
+            key.op = binary->op;
+            key.lhs = numberOf(binary->left.get());
+            key.rhs = numberOf(binary->right.get());
+        }
+        return numbers.emplace(key, numbers.size()).first->second;
+    }
+
+private:
+    std::unordered_map<ExprKey, size_t, ExprKeyHash> numbers;
+};
+
+int64_t signOf(int64_t value) {
+    return value > 0 ? 1 : value < 0 ? -1 : 0;
+}
+
+// What a loop body, or a loop bound, does that limits the rewrite
+class LoopScanner : private ASTMutator<LoopScanner> {
+public:
+    explicit LoopScanner(SymbolId symbol) : symbol(symbol) {}
+
+    bool blocked = false;  // LOOP skips the additions, a label lets GOTO skip the setup, VALOF hides stores
+    bool exits = false;    // May leave the loop before the limit
+    bool calls = false;
+    size_t mentions = 0;   // Reads of the variable
+
+    template <typename Slot>
+    void scan(Slot& slot) { mutate(slot); }
+
+private:
+    friend class ASTMutator<LoopScanner>;
+    using ASTMutator<LoopScanner>::rewrite;
+
+    SymbolId symbol;
+
+    StmtPtr rewrite(LoopStatement*) { blocked = true; return nullptr; }
+    StmtPtr rewrite(LabeledStatement* node) { blocked = true; mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(Valof*) { blocked = true; return nullptr; }
+    StmtPtr rewrite(BreakStatement*) { exits = true; return nullptr; }
+    StmtPtr rewrite(ReturnStatement*) { exits = true; return nullptr; }
+    StmtPtr rewrite(FinishStatement*) { exits = true; return nullptr; }
+    StmtPtr rewrite(EndcaseStatement*) { exits = true; return nullptr; }
+    StmtPtr rewrite(GotoStatement* node) { exits = true; mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(ResultisStatement* node) { exits = true; mutateChildren(node); return nullptr; }
+    ExprPtr rewrite(FunctionCall* node) { calls = true; mutateChildren(node); return nullptr; }
+
+    ExprPtr rewrite(VariableAccess* node) {
+        if (node->symbol == symbol) ++mentions;
+        return nullptr;
+    }
+};
+
+// The names a function binds, and the ones it must not treat as its own
+class LocalScanner : private ASTMutator<LocalScanner> {
+public:
+    std::vector<std::string> names;  // In binding order, repeats included
+    SymbolSet addressTaken;
+    SymbolSet nonLocal;  // GLOBAL, MANIFEST and function names declared inside
+
+    void scan(FunctionDeclaration* node) {
+        for (const auto& param : node->params) bind(param);
+        mutateChildren(node);
+    }
+
+private:
+    friend class ASTMutator<LocalScanner>;
+    using ASTMutator<LocalScanner>::rewrite;
+
+    void bind(const std::string& name) {
+        names.push_back(name);
+    }
+
+    void rewrite(LetDeclaration* node) {
+        for (const auto& init : node->initializers) bind(init.name);
+        mutateChildren(node);
+    }
+
+    // Nested functions cannot see these locals
+    void rewrite(FunctionDeclaration* node) {
+        nonLocal.insert(SymbolTable::getInstance().intern(node->name));
+    }
+
+    StmtPtr rewrite(ForStatement* node) {
+        bind(node->var_name);
+        mutateChildren(node);
+        return nullptr;
+    }
+
+    StmtPtr rewrite(DeclarationStatement* node) {
+        SymbolTable& symbols = SymbolTable::getInstance();
+        if (auto* globals = nodeCast<GlobalDeclaration>(node->declaration.get())) {
+            for (const auto& global : globals->globals) nonLocal.insert(symbols.intern(global.name));
+        } else if (auto* manifests = nodeCast<ManifestDeclaration>(node->declaration.get())) {
+            for (const auto& manifest : manifests->manifests) nonLocal.insert(symbols.intern(manifest.name));
+        }
+        mutateChildren(node);
+        return nullptr;
+    }
+
+    ExprPtr rewrite(UnaryOp* node) {
+        if (node->op == TokenType::OpAt) {
+            if (auto* var = nodeCast<VariableAccess>(node->rhs.get())) addressTaken.insert(var->symbol);
+        }
+        mutateChildren(node);
+        return nullptr;
+    }
+};
+
+// Replaces the loop variable in an induction variable's value, refolding
+// the literals that result
+class Substituter : private ASTMutator<Substituter> {
+public:
+    Substituter(SymbolId symbol, const Expression* replacement) : symbol(symbol), replacement(replacement) {}
+
+    ExprPtr apply(const Expression* expr) {
+        ExprPtr copy = expr->cloneExpr();
+        mutate(copy);
+        return copy;
+    }
+
+private:
+    friend class ASTMutator<Substituter>;
+    using ASTMutator<Substituter>::rewrite;
+
+    SymbolId symbol;
+    const Expression* replacement;
+
+    ExprPtr rewrite(VariableAccess* node) {
+        return node->symbol == symbol ? replacement->cloneExpr() : nullptr;
+    }
+
+    ExprPtr rewrite(BinaryOp* node) {
+        mutateChildren(node);
+        if (!nodeCast<NumberLiteral>(node->left.get()) && !nodeCast<NumberLiteral>(node->right.get())) return nullptr;
+        return arithmetic(node->op, std::move(node->left), std::move(node->right));
+    }
+};
+
+// A variable stepped by a fixed amount on each iteration
+struct InductionVariable {
+    std::string name;
+    SymbolId symbol;
+    ExprPtr value;      // Its value on an iteration, in terms of the loop variable
+    ExprPtr stride;     // A literal or a variable set before the loop
+    int64_t direction;  // The sign of the stride, or 0 if it is not known
+    bool pointer;
+};
+
+// Rewrites the body of one FOR loop, collecting the induction variables it
+// needs; the first is the loop variable itself
+class LoopReducer : private ASTMutator<LoopReducer> {
+public:
+    LoopReducer(const ForStatement* loop, SymbolId loopVar, int64_t step, const SymbolSet& modified,
+                SymbolSet& locals, size_t& temps)
+        : modified(modified), locals(locals), temps(temps) {
+        variables.push_back({loop->var_name, loopVar, variable(loop->var_name), number(step), signOf(step), false});
+    }
+
+    std::vector<InductionVariable> variables;
+    std::vector<StmtPtr> strides;  // LETs for strides that are not literals or variables
+    size_t products = 0;
+    size_t pointers = 0;
+
+    void reduce(StmtPtr& body) { mutate(body); }
+
+    std::string newTemp() {
+        std::string name = "_sr_temp_" + std::to_string(temps++);
+        locals.insert(SymbolTable::getInstance().intern(name));
+        return name;
+    }
+
+private:
+    friend class ASTMutator<LoopReducer>;
+    using ASTMutator<LoopReducer>::rewrite;
+
+    const SymbolSet& modified;
+    SymbolSet& locals;
+    size_t& temps;
+    ExprNumbering numbering;
+    std::unordered_map<ExprKey, size_t, ExprKeyHash> derived;  // Index into variables
+
+    bool invariant(const Expression* expr) const {
+        switch (expr->kind()) {
+            case NodeKind::NumberLiteral:
+            case NodeKind::CharLiteral:
+                return true;
+            case NodeKind::VariableAccess: {
+                auto* var = static_cast<const VariableAccess*>(expr);
+                return locals.contains(var->symbol) && !modified.contains(var->symbol);
+            }
+            case NodeKind::UnaryOp: {
+                auto* unary = static_cast<const UnaryOp*>(expr);
+                return (unary->op == TokenType::OpMinus || unary->op == TokenType::OpLogNot) &&
+                       invariant(unary->rhs.get());
+            }
+            case NodeKind::BinaryOp: {
+                // No division, which could trap if hoisted past the test that guards it
+                auto* binary = static_cast<const BinaryOp*>(expr);
+                switch (binary->op) {
+                    case TokenType::OpPlus:
+                    case TokenType::OpMinus:
+                    case TokenType::OpMultiply:
+                    case TokenType::OpLshift:
+                    case TokenType::OpRshift:
+                    case TokenType::OpLogAnd:
+                    case TokenType::OpLogOr:
+                        return invariant(binary->left.get()) && invariant(binary->right.get());
+                    default:
+                        return false;
+                }
+            }
+            default:
+                return false;
+        }
+    }
+
+    // The loop variable or a product of it
+    const InductionVariable* counterOf(const Expression* expr) const {
+        auto* var = nodeCast<VariableAccess>(expr);
+        if (!var) return nullptr;
+        for (const auto& iv : variables) {
+            if (!iv.pointer && iv.symbol == var->symbol) return &iv;
+        }
+        return nullptr;
+    }
+
+    ExprPtr strideOf(ExprPtr stride) {
+        if (nodeCast<NumberLiteral>(stride.get()) || nodeCast<VariableAccess>(stride.get())) return stride;
+        std::string name = newTemp();
+        strides.push_back(let(name, std::move(stride)));
+        return variable(name);
+    }
+
+    const std::string& derive(const ExprKey& key, ExprPtr value, ExprPtr stride, int64_t direction, bool pointer) {
+        auto [it, inserted] = derived.emplace(key, variables.size());
+        if (inserted) {
+            std::string name = newTemp();
+            const SymbolId symbol = SymbolTable::getInstance().intern(name);
+            variables.push_back({std::move(name), symbol, std::move(value), strideOf(std::move(stride)), direction, pointer});
+        }
+        return variables[it->second].name;
+    }
+
+    ExprPtr rewrite(BinaryOp* node) {
+        mutateChildren(node);
+        if (node->op != TokenType::OpMultiply) return nullptr;
+        const std::string& loopVar = variables[0].name;
+        auto* left = nodeCast<VariableAccess>(node->left.get());
+        auto* right = nodeCast<VariableAccess>(node->right.get());
+        const Expression* factor = nullptr;
+        if (left && left->symbol == variables[0].symbol && invariant(node->right.get())) {
+            factor = node->right.get();
+        } else if (right && right->symbol == variables[0].symbol && invariant(node->left.get())) {
+            factor = node->left.get();
+        } else {
+            return nullptr;
+        }
+
+        const size_t before = variables.size();
+        int64_t direction = 0;
+        if (auto* num = nodeCast<NumberLiteral>(factor)) direction = signOf(num->value) * variables[0].direction;
+        const ExprKey key{NodeKind::BinaryOp, TokenType::OpMultiply, 0, 0, numbering.numberOf(factor)};
+        const std::string& name = derive(key,
+                                         arithmetic(TokenType::OpMultiply, variable(loopVar), factor->cloneExpr()),
+                                         arithmetic(TokenType::OpMultiply, factor->cloneExpr(), variables[0].stride->cloneExpr()),
+                                         direction, false);
+        if (variables.size() != before) ++products;
+        return variable(name);
+    }
+
+    ExprPtr rewrite(VectorAccess* node) {
+        mutateChildren(node);
+        auto* base = nodeCast<VariableAccess>(node->vector.get());
+        if (!base || !invariant(base)) return nullptr;
+
+        // V!(X), V!(X + c), V!(X - c), V!(X + E) and V!(E + X)
+        const Expression* index = node->index.get();
+        const InductionVariable* counter = counterOf(index);
+        const Expression* extra = nullptr;
+        int64_t offset = 0;
+        if (!counter) {
+            auto* sum = nodeCast<BinaryOp>(index);
+            if (!sum || (sum->op != TokenType::OpPlus && sum->op != TokenType::OpMinus)) return nullptr;
+            const Expression* other = nullptr;
+            if ((counter = counterOf(sum->left.get()))) {
+                other = sum->right.get();
+            } else if (sum->op == TokenType::OpPlus && (counter = counterOf(sum->right.get()))) {
+                other = sum->left.get();
+            } else {
+                return nullptr;
+            }
+            if (auto* num = nodeCast<NumberLiteral>(other)) {
+                offset = sum->op == TokenType::OpPlus ? num->value : -num->value;
+            } else if (sum->op == TokenType::OpPlus && invariant(other)) {
+                extra = other;
+            } else {
+                return nullptr;
+            }
+        }
+
+        ExprPtr scaled = counter->value->cloneExpr();
+        if (extra) scaled = arithmetic(TokenType::OpPlus, std::move(scaled), extra->cloneExpr());
+        ExprPtr value = arithmetic(TokenType::OpPlus, variable(base->name),
+                                   arithmetic(TokenType::OpLshift, std::move(scaled), number(WordShift)));
+        ExprPtr stride = arithmetic(TokenType::OpLshift, counter->stride->cloneExpr(), number(WordShift));
+        const ExprKey key{NodeKind::VectorAccess, TokenType::Eof, base->symbol,
+                          static_cast<size_t>(counter - variables.data()), extra ? numbering.numberOf(extra) : NoNumber};
+
+        const size_t before = variables.size();
+        const std::string& name = derive(key, std::move(value), std::move(stride), counter->direction, true);
+        if (variables.size() != before) ++pointers;
+        return std::make_unique<VectorAccess>(variable(name), number(offset));
+    }
+};
+
+StmtPtr block(StmtPtr body, std::vector<StmtPtr> tail) {
+    std::vector<std::unique_ptr<Node>> statements;
+    statements.push_back(std::move(body));
+    for (auto& stmt : tail) statements.push_back(std::move(stmt));
+    return std::make_unique<CompoundStatement>(std::move(statements));
+}
+
+} // namespace
+
+std::string StrengthReductionPass::getName() const {
+    return "Strength Reduction Pass";
+}
+
+ProgramPtr StrengthReductionPass::apply(ProgramPtr program) {
+    stats_ = Statistics();
+    programNames_.clear();
+    temps_ = 0;
+
+    SymbolTable& symbols = SymbolTable::getInstance();
+    for (const auto& decl : program->declarations) {
+        if (auto* globals = nodeCast<GlobalDeclaration>(decl.get())) {
+            for (const auto& global : globals->globals) programNames_.insert(symbols.intern(global.name));
+        } else if (auto* manifests = nodeCast<ManifestDeclaration>(decl.get())) {
+            for (const auto& manifest : manifests->manifests) programNames_.insert(symbols.intern(manifest.name));
+        } else if (auto* let = nodeCast<LetDeclaration>(decl.get())) {
+            for (const auto& init : let->initializers) programNames_.insert(symbols.intern(init.name));
+        } else if (auto* function = nodeCast<FunctionDeclaration>(decl.get())) {
+            programNames_.insert(symbols.intern(function->name));
+        }
+    }
+
+    mutate(program.get());
+    changed = stats_.loops > 0;
+    return program;
+}
+
+void StrengthReductionPass::rewrite(FunctionDeclaration* node) {
+    LocalScanner scanner;
+    scanner.scan(node);
+
+    SymbolSet outer;
+    std::swap(outer, locals_);
+    SymbolTable& symbols = SymbolTable::getInstance();
+    for (const auto& name : scanner.names) {
+        const SymbolId symbol = symbols.intern(name);
+        if (!scanner.addressTaken.contains(symbol) && !scanner.nonLocal.contains(symbol) &&
+            !programNames_.contains(symbol)) {
+            locals_.insert(symbol);
+        }
+    }
+
+    mutateChildren(node);
+    std::swap(outer, locals_);
+}
+
+StmtPtr StrengthReductionPass::rewrite(ForStatement* node) {
+    // Inner loops first, so their setup is reduced along with this body
+    mutateChildren(node);
+
+    int64_t step;
+    if (!LoopOptimizer::constantForStep(node, step) || step == 0) return nullptr;
+
+    const SymbolId loopVar = SymbolTable::getInstance().intern(node->var_name);
+    LoopScanner body(loopVar);
+    body.scan(node->body);
+    LoopScanner bounds(loopVar);
+    bounds.scan(node->from_expr);
+    bounds.scan(node->to_expr);
+    if (body.blocked || bounds.blocked || bounds.calls || bounds.mentions > 0) return nullptr;
+
+    SymbolSet modified = LoopOptimizer::modifiedVariables(node->body.get());
+    if (!modified.insert(loopVar)) return nullptr;
+
+    LoopReducer reducer(node, loopVar, step, modified, locals_, temps_);
+    reducer.reduce(node->body);
+    if (reducer.variables.size() == 1) return nullptr;
+
+    std::vector<std::unique_ptr<Node>> statements;
+    const Expression* start = node->from_expr.get();
+    if (!nodeCast<NumberLiteral>(start) && !nodeCast<VariableAccess>(start)) {
+        std::string name = reducer.newTemp();
+        statements.push_back(let(name, std::move(node->from_expr)));
+        node->from_expr = variable(name);
+        start = node->from_expr.get();
+    }
+    for (auto& stmt : reducer.strides) statements.push_back(std::move(stmt));
+
+    std::vector<StmtPtr> steps;
+    const InductionVariable* control = nullptr;
+    for (size_t i = 1; i < reducer.variables.size(); ++i) {
+        const InductionVariable& iv = reducer.variables[i];
+        statements.push_back(let(iv.name, Substituter(loopVar, start).apply(iv.value.get())));
+
+        std::vector<ExprPtr> lhs;
+        std::vector<ExprPtr> rhs;
+        lhs.push_back(variable(iv.name));
+        rhs.push_back(arithmetic(TokenType::OpPlus, variable(iv.name), iv.stride->cloneExpr()));
+        steps.push_back(std::make_unique<Assignment>(std::move(lhs), std::move(rhs)));
+        if (!control && iv.pointer && iv.direction != 0) control = &iv;
+    }
+
+    LoopScanner rest(loopVar);
+    rest.scan(node->body);
+    if (control && rest.mentions == 0 && !body.exits) {
+        // The pointer passes its value at the limit exactly when the counter would
+        std::string end = reducer.newTemp();
+        statements.push_back(let(end, Substituter(loopVar, node->to_expr.get()).apply(control->value.get())));
+        ExprPtr test = std::make_unique<BinaryOp>(control->direction > 0 ? TokenType::OpLe : TokenType::OpGe,
+                                                  variable(control->name), variable(end));
+        statements.push_back(std::make_unique<WhileStatement>(std::move(test), block(std::move(node->body), std::move(steps))));
+        ++stats_.counters;
+    } else {
+        statements.push_back(std::make_unique<ForStatement>(
+            node->var_name, std::move(node->from_expr), std::move(node->to_expr), std::move(node->by_expr),
+            block(std::move(node->body), std::move(steps))));
+    }
+
+    ++stats_.loops;
+    stats_.products += reducer.products;
+    stats_.pointers += reducer.pointers;
+    return std::make_unique<CompoundStatement>(std::move(statements));
+}
@@ -0,0 +1,61 @@
+#ifndef STRENGTH_REDUCTION_PASS_H
+#define STRENGTH_REDUCTION_PASS_H
+
+#include "OptimizationPass.h"
+#include "AST.h"
+#include "ASTMutator.h"
+#include "SymbolTable.h"
+#include <cstddef>
+#include <memory>
+
+/**
+ * @class StrengthReductionPass
+ * @brief Replaces multiplies and vector indexing by the variable of a FOR loop
+ * with induction variables that are stepped by adding.
+ *
+ * A loop qualifies when its step is a constant, its body does not assign the
+ * loop variable, and the body has no LOOP, label or VALOF that could skip the
+ * additions made at its end. Within it, with K, V and E invariant:
+ * 1. I*K becomes a temporary set to a*K before the loop, where a is the
+ *    initial value, and increased by K times the step on each iteration.
+ * 2. V!(X), V!(X+c) and V!(X+E), where X is I or such a product, become P!c
+ *    for a pointer P into V that is increased by the scaled stride instead.
+ *    Accesses that differ only in c share one pointer.
+ * 3. When nothing but these accesses used I and the body never leaves the
+ *    loop early, the counter goes: the loop becomes a WHILE comparing a
+ *    pointer with its value at the limit.
+ *
+ * Invariant names are locals of the enclosing function that share no name
+ * with a global, whose address is never taken and which the loop does not
+ * change; LoopOptimizer supplies the names a body changes. Inner loops are
+ * reduced first, so the setup of an inner loop is itself reduced by the loop
+ * around it.
+ */
+class StrengthReductionPass : public OptimizationPass, private ASTMutator<StrengthReductionPass> {
+public:
+    ProgramPtr apply(ProgramPtr program) override;
+    std::string getName() const override;
+
+    struct Statistics {
+        size_t loops = 0;     // FOR loops given induction variables
+        size_t pointers = 0;  // Pointers stepped through a vector instead of indexing it
+        size_t products = 0;  // Products of a loop variable kept up to date by adding
+        size_t counters = 0;  // Loops whose variable was replaced by a pointer
+    };
+
+    const Statistics& getStatistics() const { return stats_; }
+
+private:
+    friend class ASTMutator<StrengthReductionPass>;
+    using ASTMutator<StrengthReductionPass>::rewrite;
+
+    Statistics stats_;
+    SymbolSet programNames_; // Globals, manifests and functions of the program
+    SymbolSet locals_;       // Locals of the function being walked that only it can change
+    size_t temps_ = 0;       // Temporaries named so far; names are unique in the program
+
+    void rewrite(FunctionDeclaration* node);
+    StmtPtr rewrite(ForStatement* node);
+};
+
+#endif // STRENGTH_REDUCTION_PASS_H
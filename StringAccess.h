@@ -8,8 +8,9 @@ public:
     ExprPtr string;
     ExprPtr index;
 
+    // Same shape as S%I, so it shares CharacterAccess's kind
     StringAccess(ExprPtr string, ExprPtr index)
-        : string(std::move(string)), index(std::move(index)) {}
+        : Expression(NodeKind::CharacterAccess), string(std::move(string)), index(std::move(index)) {}
 };
 
 #endif // STRING_ACCESS_H
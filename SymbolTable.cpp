@@ -0,0 +1,87 @@
+#include "SymbolTable.h"
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 1024;
+
+} // namespace
+
+SymbolTable::SymbolTable() : slots_(INITIAL_SLOTS, NoSymbol) {
+}
+
+// FNV-1a; identifiers are short, so this beats anything with a setup cost
+uint64_t SymbolTable::hash(std::string_view name) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : name) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Linear probing; returns the slot holding name, or the empty slot where it belongs
+size_t SymbolTable::probe(std::string_view name, uint64_t h) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+        SymbolId id = slots_[slot];
+        if (id == NoSymbol || (hashes_[id] == h && names_[id] == name)) {
+            return slot;
+        }
+    }
+}
+
+SymbolId SymbolTable::intern(std::string_view name) {
+    if (concurrent_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return internUnlocked(name);
+    }
+    return internUnlocked(name);
+}
+
+SymbolId SymbolTable::internUnlocked(std::string_view name) {
+    const uint64_t h = hash(name);
+    size_t slot = probe(name, h);
+    if (slots_[slot] != NoSymbol) {
+        return slots_[slot];
+    }
+
+    const SymbolId id = static_cast<SymbolId>(names_.size());
+    names_.emplace_back(name);
+    hashes_.push_back(h);
+    slots_[slot] = id;
+
+    // Keep the table at most half full so probe sequences stay short
+    if (names_.size() * 2 > slots_.size()) {
+        grow();
+    }
+    return id;
+}
+
+SymbolId SymbolTable::lookup(std::string_view name) const {
+    if (concurrent_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return slots_[probe(name, hash(name))];
+    }
+    return slots_[probe(name, hash(name))];
+}
+
+const std::string& SymbolTable::name(SymbolId id) const {
+    if (concurrent_) {
+        // The string never moves, but indexing the deque races with its growth
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_[id];
+    }
+    return names_[id];
+}
+
+void SymbolTable::grow() {
+    slots_.assign(slots_.size() * 2, NoSymbol);
+    const size_t mask = slots_.size() - 1;
+    for (SymbolId id = 0; id < names_.size(); ++id) {
+        size_t slot = hashes_[id] & mask;
+        while (slots_[slot] != NoSymbol) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = id;
+    }
+}
@@ -0,0 +1,176 @@
+// SymbolTable.h
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Dense identifier of an interned name; the first name interned is 0.
+using SymbolId = uint32_t;
+
+/**
+ * @class SymbolTable
+ * @brief A singleton interning every identifier name to a dense SymbolId.
+ *
+ * The lexer interns each identifier as it scans it, so the parser, the
+ * optimizer and the code generators compare and index names by ID instead of
+ * hashing strings. IDs are handed out in order and never reused; names stay
+ * interned for the life of the process, so an ID is valid across
+ * compilations. Names are looked up in an open-addressed table of IDs.
+ *
+ * The table is not locked by default. While a Concurrent guard is alive,
+ * intern, lookup and name take a mutex so that optimizer worker threads can
+ * share it; IDs handed out during that time follow the order threads ask.
+ */
+class SymbolTable {
+public:
+    static constexpr SymbolId NoSymbol = 0xFFFFFFFF;
+
+    static SymbolTable& getInstance() {
+        static SymbolTable instance;
+        return instance;
+    }
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    /// Returns the ID of @p name, interning it first if it is new.
+    SymbolId intern(std::string_view name);
+
+    /// Returns the ID of @p name, or NoSymbol if it has never been interned.
+    SymbolId lookup(std::string_view name) const;
+
+    /// The text of an interned name; the reference stays valid.
+    const std::string& name(SymbolId id) const;
+
+    /// Number of names interned so far, and one past the largest ID.
+    size_t size() const { return names_.size(); }
+
+    /**
+     * @brief Makes the table safe to use from several threads until destroyed.
+     * Create and destroy it on the main thread, before the workers start and
+     * after they have been joined.
+     */
+    class Concurrent {
+    public:
+        Concurrent() { ++getInstance().concurrent_; }
+        ~Concurrent() { --getInstance().concurrent_; }
+
+        Concurrent(const Concurrent&) = delete;
+        Concurrent& operator=(const Concurrent&) = delete;
+    };
+
+private:
+    SymbolTable();
+
+    SymbolId internUnlocked(std::string_view name);
+    static uint64_t hash(std::string_view name);
+    size_t probe(std::string_view name, uint64_t hash) const;
+    void grow();
+
+    std::deque<std::string> names_; // Indexed by ID; a deque so references survive growth
+    std::vector<uint64_t> hashes_;  // Indexed by ID, to rehash without rescanning names
+    std::vector<SymbolId> slots_;   // Power-of-two table of IDs, NoSymbol when empty
+    mutable std::mutex mutex_;
+    unsigned concurrent_ = 0;       // Live Concurrent guards
+};
+
+/**
+ * @class SymbolMap
+ * @brief A map from SymbolId to T stored as a flat vector indexed by ID.
+ *
+ * Lookups are a bounds check and an index. The vector grows to the largest ID
+ * inserted; clear() only touches the entries that were set, so one map can
+ * be reused cheaply for every function of a program.
+ */
+template <typename T>
+class SymbolMap {
+public:
+    bool contains(SymbolId id) const { return id < present_.size() && present_[id]; }
+
+    /// The value of @p id, or nullptr if it has none.
+    T* find(SymbolId id) { return contains(id) ? &values_[id] : nullptr; }
+    const T* find(SymbolId id) const { return contains(id) ? &values_[id] : nullptr; }
+
+    /// Sets the value of @p id unless it already has one; returns true if it was set.
+    bool insert(SymbolId id, T value) {
+        if (contains(id)) {
+            return false;
+        }
+        (*this)[id] = std::move(value);
+        return true;
+    }
+
+    /// The value of @p id, default-constructed first if it has none.
+    T& operator[](SymbolId id) {
+        if (id >= present_.size()) {
+            present_.resize(id + 1, false);
+            values_.resize(id + 1);
+        }
+        if (!present_[id]) {
+            present_[id] = true;
+            keys_.push_back(id);
+        }
+        return values_[id];
+    }
+
+    /// IDs that have a value, in the order they were first set.
+    const std::vector<SymbolId>& keys() const { return keys_; }
+    size_t size() const { return keys_.size(); }
+    bool empty() const { return keys_.empty(); }
+
+    void clear() {
+        for (SymbolId id : keys_) {
+            present_[id] = false;
+            values_[id] = T();
+        }
+        keys_.clear();
+    }
+
+private:
+    std::vector<T> values_;
+    std::vector<bool> present_;
+    std::vector<SymbolId> keys_;
+};
+
+/**
+ * @class SymbolSet
+ * @brief A set of SymbolIds stored as one bit per ID.
+ */
+class SymbolSet {
+public:
+    bool contains(SymbolId id) const { return id < bits_.size() && bits_[id]; }
+
+    /// Adds @p id; returns true if it was not already present.
+    bool insert(SymbolId id) {
+        if (id >= bits_.size()) {
+            bits_.resize(id + 1, false);
+        }
+        if (bits_[id]) {
+            return false;
+        }
+        bits_[id] = true;
+        ++size_;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear() {
+        bits_.clear();
+        size_ = 0;
+    }
+
+private:
+    std::vector<bool> bits_;
+    size_t size_ = 0;
+};
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,25 @@
+#include "Target.h"
+#include "CodeGenerator.h"
+#include "X86_64CodeGenerator.h"
+#include <stdexcept>
+
+TargetArch parseTarget(const std::string& name) {
+    if (name == "aarch64" || name == "arm64") {
+        return TargetArch::AArch64;
+    }
+    if (name == "x86_64" || name == "x86-64" || name == "amd64") {
+        return TargetArch::X86_64;
+    }
+    if (name == "host" || name == "native") {
+        return hostTarget();
+    }
+    throw std::runtime_error("Unknown target '" + name + "' (expected aarch64, x86_64 or host)");
+}
+
+std::unique_ptr<TargetCodeGenerator> createCodeGenerator(TargetArch target) {
+    switch (target) {
+        case TargetArch::AArch64: return std::make_unique<CodeGenerator>();
+        case TargetArch::X86_64: return std::make_unique<X86_64CodeGenerator>();
+    }
+    throw std::runtime_error("No code generator for target");
+}
@@ -0,0 +1,99 @@
+// Target.h
+#ifndef TARGET_H
+#define TARGET_H
+
+#include "AST.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class JITExecutor;
+
+/**
+ * Instruction set architectures the back end can emit code for.
+ */
+enum class TargetArch {
+    AArch64,
+    X86_64
+};
+
+/**
+ * @brief Returns the architecture of the machine the compiler is running on.
+ */
+inline TargetArch hostTarget() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return TargetArch::X86_64;
+#else
+    return TargetArch::AArch64;
+#endif
+}
+
+/**
+ * @brief Parses a --target name ("aarch64", "arm64", "x86_64", "x86-64", "host").
+ * @throws std::runtime_error for an unknown target name.
+ */
+TargetArch parseTarget(const std::string& name);
+
+/**
+ * @brief Returns the canonical name of a target ("aarch64" or "x86_64").
+ */
+inline const char* targetName(TargetArch target) {
+    return target == TargetArch::X86_64 ? "x86_64" : "aarch64";
+}
+
+/**
+ * @class TargetCodeGenerator
+ * @brief Interface implemented by each back end.
+ *
+ * A target code generator lowers the (optionally optimized) AST to machine
+ * code for one architecture and knows how to hand its output to the JIT
+ * loader. The front end and optimizer are shared by all targets.
+ */
+class TargetCodeGenerator {
+public:
+    virtual ~TargetCodeGenerator() = default;
+
+    /**
+     * @brief Generates code for a whole program.
+     * @return Byte offset of the START function within the generated code.
+     */
+    virtual uintptr_t compile(ProgramPtr program) = 0;
+
+    /**
+     * @brief Prints the generated assembly listing to stdout.
+     */
+    virtual void printAsm() const = 0;
+
+    /**
+     * @brief Keeps the annotations printAsm() shows, such as instruction
+     * comments. Must be called before compile(); off by default.
+     */
+    virtual void setListingEnabled(bool enabled) {}
+
+    /**
+     * @brief Generates functions through the SSA IR where it covers them,
+     * instead of straight from the AST. Must be called before compile(); off
+     * by default, and ignored by targets without an IR selector.
+     */
+    virtual void setIRSelectionEnabled(bool enabled) {}
+
+    /**
+     * @brief Prints back-end statistics (e.g. peephole pattern hits) to stdout.
+     */
+    virtual void printStatistics() const {}
+
+    /**
+     * @brief Links the generated code into the executor's executable memory.
+     * @return Pointer to the entry point.
+     */
+    virtual void* load(JITExecutor& executor, uintptr_t entryOffset) const = 0;
+
+    virtual TargetArch getTarget() const = 0;
+};
+
+/**
+ * @brief Creates the code generator for the given target.
+ */
+std::unique_ptr<TargetCodeGenerator> createCodeGenerator(TargetArch target);
+
+#endif // TARGET_H
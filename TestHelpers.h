@@ -0,0 +1,48 @@
+// TestHelpers.h
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "AST.h"
+#include "OptimizationPass.h"
+#include "Parser.h"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * AST lookups shared by the test programs. Only the tests include this
+ * header; a lookup that fails throws, which fails the test.
+ */
+
+inline const FunctionDeclaration* findFunction(const ProgramPtr& program, const std::string& name) {
+    for (const auto& decl : program->declarations) {
+        if (auto function = nodeCast<FunctionDeclaration>(decl.get())) {
+            if (function->name == name) {
+                return function;
+            }
+        }
+    }
+    throw std::runtime_error("Function not found: " + name);
+}
+
+// The statements of a function's block, or of its VALOF body
+inline const std::vector<std::unique_ptr<Node>>& bodyOf(const ProgramPtr& program, const std::string& name) {
+    const FunctionDeclaration* function = findFunction(program, name);
+    const Node* body = function->body_expr ? static_cast<const Node*>(function->body_expr.get()) : function->body_stmt.get();
+    if (auto valof = nodeCast<Valof>(body)) {
+        body = valof->body.get();
+    }
+    auto block = nodeCast<CompoundStatement>(body);
+    if (!block) {
+        throw std::runtime_error("No block in " + name);
+    }
+    return block->statements;
+}
+
+// Parses source and runs one pass over it
+inline ProgramPtr applyPass(const std::string& source, OptimizationPass& pass) {
+    return pass.apply(Parser::getInstance().parse(source));
+}
+
+#endif // TEST_HELPERS_H
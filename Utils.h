@@ -1,17 +1,18 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include "SymbolTable.h"
 #include <iostream>
 #include <set>
 #include <string>
 
-// Helper to print a set of strings
-inline void printSet(const std::string& name, const std::set<std::string>& s) {
+// Helper to print a set of interned variable names
+inline void printSet(const std::string& name, const std::set<SymbolId>& s) {
     std::cout << "  " << name << ": {";
     bool first = true;
-    for (const auto& var : s) {
+    for (SymbolId var : s) {
         if (!first) std::cout << ", ";
-        std::cout << var;
+        std::cout << SymbolTable::getInstance().name(var);
         first = false;
     }
     std::cout << "}\n" << std::flush;
@@ -9,25 +9,25 @@ public:
     std::vector<const VectorConstructor*> allocations;
 
     void visit(const Node* node) {
-        if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(node)) {
+        if (auto funcDecl = nodeCast<FunctionDeclaration>(node)) {
             if (funcDecl->body_expr) {
                 visit(funcDecl->body_expr.get());
             } else if (funcDecl->body_stmt) {
                 visit(funcDecl->body_stmt.get());
             }
-        } else if (auto valof = dynamic_cast<const Valof*>(node)) {
+        } else if (auto valof = nodeCast<Valof>(node)) {
             visit(valof->body.get());
-        } else if (auto compound = dynamic_cast<const CompoundStatement*>(node)) {
+        } else if (auto compound = nodeCast<CompoundStatement>(node)) {
             for (const auto& stmt : compound->statements) {
                 visit(stmt.get());
             }
-        } else if (auto let = dynamic_cast<const LetDeclaration*>(node)) {
+        } else if (auto let = nodeCast<LetDeclaration>(node)) {
             for (const auto& init : let->initializers) {
                 if (init.init) {
                     visit(init.init.get());
                 }
             }
-        } else if (auto vec = dynamic_cast<const VectorConstructor*>(node)) {
+        } else if (auto vec = nodeCast<VectorConstructor>(node)) {
             allocations.push_back(vec);
         }
     }
@@ -0,0 +1,963 @@
+#include "X86_64CodeGenerator.h"
+#include "JITExecutor.h"
+#include "JitRuntime.h"
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+const char* const X86_64CodeGenerator::GLOBALS_LABEL = ".L.globals";
+
+namespace {
+// SysV integer argument registers, in order
+const uint32_t ARG_REGS[] = {
+    X86_64Instructions::RDI, X86_64Instructions::RSI, X86_64Instructions::RDX,
+    X86_64Instructions::RCX, X86_64Instructions::R8, X86_64Instructions::R9
+};
+const size_t NUM_ARG_REGS = 6;
+
+// Library routines that are called by their BCPL names but registered in
+// JitRuntime under their runtime names (see StatementCodeGenerator::visitRoutineCall).
+const std::unordered_map<std::string, std::string> RUNTIME_ALIASES = {
+    {"WRITES", "writes"},
+    {"WRITEN", "writen"},
+    {"NEWLINE", "newline"},
+    {"FINISH", "finish"},
+    {"WRITEF", "writef"}
+};
+} // namespace
+
+uintptr_t X86_64CodeGenerator::compile(ProgramPtr program) {
+    // Reset state for a new compilation
+    instructions.clear();
+    stringPool.clear();
+    localVars.clear();
+    globals.clear();
+    manifestConstants.clear();
+    functions.clear();
+    functionNames.clear();
+    staticInitializers.clear();
+    loopStack.clear();
+    switchEndStack.clear();
+    valofEndStack.clear();
+    labelCounter = 0;
+
+    visitProgram(program.get());
+
+    const size_t* start = functions.find(SymbolTable::getInstance().intern("START"));
+    if (!start) {
+        throw std::runtime_error("No START function found");
+    }
+
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+    return *start;
+}
+
+void X86_64CodeGenerator::printAsm() const {
+    std::cout << "\n;------------ Generated x86-64 Assembly ------------\n\n";
+    for (const auto& instr : instructions.getInstructions()) {
+        if (instr.hasLabel) {
+            std::cout << instr.label << ":\n";
+            continue;
+        }
+        std::cout << "  " << std::hex << std::setw(6) << std::setfill('0') << instr.address << "  ";
+        std::string hexBytes;
+        for (uint8_t byte : instr.bytes) {
+            static const char* digits = "0123456789abcdef";
+            hexBytes += digits[byte >> 4];
+            hexBytes += digits[byte & 0xF];
+        }
+        std::cout << std::left << std::setw(22) << std::setfill(' ') << hexBytes << std::right << std::dec;
+        std::cout << std::left << std::setw(36) << instr.assembly << std::right;
+        if (!instr.comment.empty()) {
+            std::cout << "; " << instr.comment;
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\n;------------ End of Assembly ------------\n\n";
+}
+
+void* X86_64CodeGenerator::load(JITExecutor& executor, uintptr_t entryOffset) const {
+    return executor.load(instructions, stringPool, entryOffset, globals.size());
+}
+
+// --- Helpers ---
+
+std::string X86_64CodeGenerator::newLabel(const std::string& prefix) {
+    return ".L" + prefix + "_" + std::to_string(labelCounter++);
+}
+
+std::string X86_64CodeGenerator::userLabel(const std::string& name) const {
+    // Source labels are local to their function; function names are global labels.
+    return currentFunctionName + "." + name;
+}
+
+int X86_64CodeGenerator::allocateLocal(SymbolId var) {
+    if (const int* offset = localVars.find(var)) {
+        return *offset;
+    }
+    currentLocalVarOffset -= 8;
+    localVars[var] = currentLocalVarOffset;
+    return currentLocalVarOffset;
+}
+
+void X86_64CodeGenerator::pushRax(const std::string& comment) {
+    instructions.push(X::RAX, comment);
+    ++stackDepth;
+}
+
+void X86_64CodeGenerator::popReg(uint32_t reg, const std::string& comment) {
+    instructions.pop(reg, comment);
+    --stackDepth;
+}
+
+void X86_64CodeGenerator::dropSlots(int slots, const std::string& comment) {
+    if (slots > 0) {
+        instructions.add_imm(X::RSP, slots * 8, comment);
+        stackDepth -= slots;
+    }
+}
+
+// Condition that holds after cmp lhs, rhs when the relation is true
+static bool relationalCondition(TokenType op, X86_64Instructions::Condition& cond) {
+    switch (op) {
+        case TokenType::OpEq: cond = X86_64Instructions::E; return true;
+        case TokenType::OpNe: cond = X86_64Instructions::NE; return true;
+        case TokenType::OpLt: cond = X86_64Instructions::L; return true;
+        case TokenType::OpGt: cond = X86_64Instructions::G; return true;
+        case TokenType::OpLe: cond = X86_64Instructions::LE; return true;
+        case TokenType::OpGe: cond = X86_64Instructions::GE; return true;
+        default: return false;
+    }
+}
+
+// True when expr always yields TRUE (-1) or FALSE (0), as in the AArch64 back end
+static bool isTruthValue(const Expression* expr) {
+    if (auto number = nodeCast<NumberLiteral>(expr)) {
+        return number->value == 0 || number->value == -1;
+    }
+    if (auto binary = nodeCast<BinaryOp>(expr)) {
+        X86_64Instructions::Condition cond;
+        if (relationalCondition(binary->op, cond)) {
+            return true;
+        }
+        return (binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+               isTruthValue(binary->left.get()) && isTruthValue(binary->right.get());
+    }
+    if (auto unary = nodeCast<UnaryOp>(expr)) {
+        return unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get());
+    }
+    return false;
+}
+
+void X86_64CodeGenerator::emitBranch(const Expression* condition, bool branchIfTrue, const std::string& label) {
+    if (auto binary = nodeCast<BinaryOp>(condition)) {
+        X86_64Instructions::Condition cond;
+        if (relationalCondition(binary->op, cond)) {
+            visitExpression(binary->left.get());
+            pushRax("Save LHS");
+            visitExpression(binary->right.get());
+            instructions.mov(X::RCX, X::RAX, "RHS");
+            popReg(X::RAX, "Restore LHS");
+            instructions.cmp(X::RAX, X::RCX, "Compare");
+            // Condition codes come in pairs that differ in the low bit
+            instructions.jcc(branchIfTrue ? cond : static_cast<X86_64Instructions::Condition>(cond ^ 1), label);
+            return;
+        }
+        // & and | between truth values short-circuit in a conditional context
+        if ((binary->op == TokenType::OpLogAnd || binary->op == TokenType::OpLogOr) &&
+            isTruthValue(binary->left.get()) && isTruthValue(binary->right.get())) {
+            const bool isAnd = binary->op == TokenType::OpLogAnd;
+            if (isAnd != branchIfTrue) {
+                emitBranch(binary->left.get(), branchIfTrue, label);
+                emitBranch(binary->right.get(), branchIfTrue, label);
+            } else {
+                auto skipLabel = newLabel(isAnd ? "and_false" : "or_true");
+                emitBranch(binary->left.get(), !branchIfTrue, skipLabel);
+                emitBranch(binary->right.get(), branchIfTrue, label);
+                instructions.defineLabel(skipLabel);
+            }
+            return;
+        }
+    }
+    if (auto unary = nodeCast<UnaryOp>(condition)) {
+        if (unary->op == TokenType::OpLogNot && isTruthValue(unary->rhs.get())) {
+            emitBranch(unary->rhs.get(), !branchIfTrue, label);
+            return;
+        }
+    }
+
+    visitExpression(condition);
+    instructions.test(X::RAX, X::RAX, "Test condition");
+    if (branchIfTrue) {
+        instructions.jcc(X::NE, label, "Branch if condition is true");
+    } else {
+        instructions.jcc(X::E, label, "Branch if condition is false");
+    }
+}
+
+void X86_64CodeGenerator::emitCompare(X86_64Instructions::Condition cond) {
+    // BCPL truth values: TRUE is -1, FALSE is 0
+    instructions.cmp(X::RAX, X::RCX, "Compare");
+    instructions.setcc(cond, X::RAX);
+    instructions.movzx8(X::RAX, X::RAX);
+    instructions.neg(X::RAX, "Convert 1 to -1 for true");
+}
+
+std::string X86_64CodeGenerator::runtimeSymbolFor(const std::string& name) const {
+    const auto& symbols = JitRuntime::getInstance().getSymbolTable();
+    if (auto alias = RUNTIME_ALIASES.find(name); alias != RUNTIME_ALIASES.end() && symbols.count(alias->second)) {
+        return alias->second;
+    }
+    if (symbols.count(name)) {
+        return name;
+    }
+    return "";
+}
+
+// --- Dispatch ---
+
+void X86_64CodeGenerator::visitProgram(const Program* node) {
+    // First pass: collect globals, manifests and function names so that
+    // functions may be called before they are defined.
+    SymbolTable& symbols = SymbolTable::getInstance();
+    for (const auto& decl : node->declarations) {
+        if (auto globalDecl = nodeCast<GlobalDeclaration>(decl.get())) {
+            for (const auto& global : globalDecl->globals) {
+                globals.insert(symbols.intern(global.name), globals.size());
+            }
+        } else if (auto manifestDecl = nodeCast<ManifestDeclaration>(decl.get())) {
+            for (const auto& manifest : manifestDecl->manifests) {
+                manifestConstants[symbols.intern(manifest.name)] = manifest.value;
+            }
+        } else if (auto funcDecl = nodeCast<FunctionDeclaration>(decl.get())) {
+            functionNames.insert(symbols.intern(funcDecl->name));
+        } else if (auto letDecl = nodeCast<LetDeclaration>(decl.get())) {
+            // Top-level variables take global slots after the GLOBALs
+            for (const auto& init : letDecl->initializers) {
+                globals.insert(symbols.intern(init.name), globals.size());
+                if (init.init) {
+                    staticInitializers.push_back(&init);
+                }
+            }
+        }
+    }
+
+    // Second pass: generate code for functions
+    for (const auto& decl : node->declarations) {
+        visitDeclaration(decl.get());
+    }
+}
+
+void X86_64CodeGenerator::visitDeclaration(const Declaration* decl) {
+    if (!decl) throw std::runtime_error("x86-64: unsupported declaration");
+    switch (decl->kind()) {
+        case NodeKind::FunctionDeclaration:
+            if (!currentFunctionName.empty()) {
+                throw std::runtime_error("x86-64: nested function declarations are not supported");
+            }
+            visitFunctionDeclaration(static_cast<const FunctionDeclaration*>(decl));
+            break;
+        case NodeKind::LetDeclaration:
+            // Top-level variables are global slots, initialized on entry to START
+            if (!currentFunctionName.empty()) {
+                visitLetDeclaration(static_cast<const LetDeclaration*>(decl));
+            }
+            break;
+        case NodeKind::GlobalDeclaration:
+        case NodeKind::ManifestDeclaration:
+        case NodeKind::GetDirective:
+            // Collected in visitProgram / handled by the preprocessor
+            break;
+        default:
+            throw std::runtime_error("x86-64: unsupported declaration");
+    }
+}
+
+void X86_64CodeGenerator::visitStatement(const Statement* stmt) {
+    if (!stmt) throw std::runtime_error("x86-64: unsupported statement");
+    switch (stmt->kind()) {
+        case NodeKind::CompoundStatement:
+            for (const auto& child : static_cast<const CompoundStatement*>(stmt)->statements) {
+                if (auto childStmt = nodeCast<Statement>(child.get())) {
+                    visitStatement(childStmt);
+                } else if (auto childDecl = nodeCast<Declaration>(child.get())) {
+                    visitDeclaration(childDecl);
+                }
+            }
+            break;
+        case NodeKind::DeclarationStatement:
+            visitDeclaration(static_cast<const DeclarationStatement*>(stmt)->declaration.get());
+            break;
+        case NodeKind::Assignment:
+            visitAssignment(static_cast<const Assignment*>(stmt));
+            break;
+        case NodeKind::RoutineCall:
+            visitExpression(static_cast<const RoutineCall*>(stmt)->call_expression.get());
+            break;
+        case NodeKind::IfStatement:
+            visitIfStatement(static_cast<const IfStatement*>(stmt));
+            break;
+        case NodeKind::TestStatement:
+            visitTestStatement(static_cast<const TestStatement*>(stmt));
+            break;
+        case NodeKind::WhileStatement:
+            visitWhileStatement(static_cast<const WhileStatement*>(stmt));
+            break;
+        case NodeKind::RepeatStatement:
+            visitRepeatStatement(static_cast<const RepeatStatement*>(stmt));
+            break;
+        case NodeKind::ForStatement:
+            visitForStatement(static_cast<const ForStatement*>(stmt));
+            break;
+        case NodeKind::SwitchonStatement:
+            visitSwitchonStatement(static_cast<const SwitchonStatement*>(stmt));
+            break;
+        case NodeKind::ResultisStatement:
+            visitResultisStatement(static_cast<const ResultisStatement*>(stmt));
+            break;
+        case NodeKind::ReturnStatement:
+            instructions.jmp(returnLabel, "RETURN");
+            break;
+        case NodeKind::BreakStatement:
+            if (loopStack.empty()) throw std::runtime_error("BREAK outside of a loop");
+            instructions.jmp(loopStack.back().breakLabel, "BREAK");
+            break;
+        case NodeKind::LoopStatement:
+            if (loopStack.empty()) throw std::runtime_error("LOOP outside of a loop");
+            instructions.jmp(loopStack.back().continueLabel, "LOOP");
+            break;
+        case NodeKind::EndcaseStatement:
+            if (switchEndStack.empty()) throw std::runtime_error("ENDCASE outside of SWITCHON");
+            instructions.jmp(switchEndStack.back(), "ENDCASE");
+            break;
+        case NodeKind::FinishStatement:
+            emitCall(runtimeSymbolFor("FINISH"), {}, nullptr);
+            break;
+        case NodeKind::GotoStatement: {
+            auto label = nodeCast<VariableAccess>(static_cast<const GotoStatement*>(stmt)->label.get());
+            if (!label) throw std::runtime_error("GOTO requires a label");
+            instructions.jmp(userLabel(label->name), "GOTO " + label->name);
+            break;
+        }
+        case NodeKind::LabeledStatement: {
+            auto labeled = static_cast<const LabeledStatement*>(stmt);
+            instructions.defineLabel(userLabel(labeled->name));
+            visitStatement(labeled->statement.get());
+            break;
+        }
+        default:
+            throw std::runtime_error("x86-64: unsupported statement");
+    }
+}
+
+void X86_64CodeGenerator::visitExpression(const Expression* expr) {
+    if (!expr) throw std::runtime_error("x86-64: unsupported expression");
+    switch (expr->kind()) {
+        case NodeKind::NumberLiteral:
+            instructions.loadImmediate(X::RAX, static_cast<const NumberLiteral*>(expr)->value, "Load number literal");
+            break;
+        case NodeKind::CharLiteral:
+            instructions.loadImmediate(X::RAX, static_cast<const CharLiteral*>(expr)->value, "Load char literal");
+            break;
+        case NodeKind::StringLiteral: {
+            std::string label = ".L.str" + std::to_string(stringPool.size());
+            stringPool.push_back(static_cast<const StringLiteral*>(expr)->value);
+            instructions.leaRip(X::RAX, label, "Load string literal address");
+            break;
+        }
+        case NodeKind::VariableAccess:
+            visitVariableAccess(static_cast<const VariableAccess*>(expr));
+            break;
+        case NodeKind::UnaryOp:
+            visitUnaryOp(static_cast<const UnaryOp*>(expr));
+            break;
+        case NodeKind::BinaryOp:
+            visitBinaryOp(static_cast<const BinaryOp*>(expr));
+            break;
+        case NodeKind::FunctionCall:
+            visitFunctionCall(static_cast<const FunctionCall*>(expr));
+            break;
+        case NodeKind::ConditionalExpression:
+            visitConditionalExpression(static_cast<const ConditionalExpression*>(expr));
+            break;
+        case NodeKind::Valof:
+            visitValof(static_cast<const Valof*>(expr));
+            break;
+        case NodeKind::VectorConstructor:
+            visitVectorConstructor(static_cast<const VectorConstructor*>(expr));
+            break;
+        case NodeKind::DereferenceExpr:
+            visitExpression(static_cast<const DereferenceExpr*>(expr)->pointer.get());
+            instructions.load(X::RAX, X::RAX, 0, "Indirection");
+            break;
+        case NodeKind::VectorAccess: {
+            auto vecAccess = static_cast<const VectorAccess*>(expr);
+            visitExpression(vecAccess->vector.get());
+            pushRax("Save vector base");
+            visitExpression(vecAccess->index.get());
+            instructions.mov(X::RCX, X::RAX);
+            popReg(X::RAX, "Restore vector base");
+            instructions.loadIndexed(X::RAX, X::RAX, X::RCX, 8, "Load vector element");
+            break;
+        }
+        case NodeKind::CharacterAccess: {
+            auto charAccess = static_cast<const CharacterAccess*>(expr);
+            visitExpression(charAccess->string.get());
+            pushRax("Save string base");
+            visitExpression(charAccess->index.get());
+            instructions.mov(X::RCX, X::RAX);
+            popReg(X::RAX, "Restore string base");
+            instructions.load32Indexed(X::RAX, X::RAX, X::RCX, 4, "Load character (4-byte chars)");
+            break;
+        }
+        case NodeKind::FloatLiteral:
+            throw std::runtime_error("x86-64: floating-point expressions are not supported");
+        default:
+            throw std::runtime_error("x86-64: unsupported expression");
+    }
+}
+
+// --- Declarations ---
+
+void X86_64CodeGenerator::visitFunctionDeclaration(const FunctionDeclaration* node) {
+    currentFunctionName = node->name;
+    returnLabel = newLabel("return");
+    localVars.clear();
+    currentLocalVarOffset = 0;
+    stackDepth = 0;
+
+    SymbolTable& symbols = SymbolTable::getInstance();
+    functions[symbols.intern(node->name)] = instructions.getCurrentAddress();
+    instructions.defineLabel(node->name);
+
+    // PROLOGUE: the frame size is back-patched once all locals are known.
+    instructions.push(X::RBP, "Save caller frame pointer");
+    instructions.mov(X::RBP, X::RSP, "Set up frame pointer");
+    size_t frameInstructionIndex = instructions.size();
+    instructions.sub_imm32(X::RSP, 0, "Allocate stack frame (placeholder)");
+
+    // Give every parameter a home in the frame.
+    for (size_t i = 0; i < node->params.size(); ++i) {
+        int offset = allocateLocal(symbols.intern(node->params[i]));
+        if (i < NUM_ARG_REGS) {
+            instructions.store(X::RBP, offset, ARG_REGS[i], "Store parameter " + node->params[i]);
+        } else {
+            instructions.load(X::RAX, X::RBP, static_cast<int32_t>(16 + 8 * (i - NUM_ARG_REGS)), "Load stack parameter " + node->params[i]);
+            instructions.store(X::RBP, offset, X::RAX, "Store parameter " + node->params[i]);
+        }
+    }
+
+    if (node->name == "START") {
+        for (const LetDeclaration::VarInit* init : staticInitializers) {
+            visitExpression(init->init.get());
+            instructions.movabs(X::R11, GLOBALS_LABEL, "Global vector");
+            instructions.store(X::R11, static_cast<int32_t>(*globals.find(symbols.intern(init->name)) * 8), X::RAX,
+                               "Initialize static " + init->name);
+        }
+    }
+
+    // Body
+    if (node->body_expr) {
+        if (auto valof = nodeCast<Valof>(node->body_expr.get())) {
+            // RESULTIS in the outermost VALOF returns straight from the function.
+            valofEndStack.push_back(returnLabel);
+            visitStatement(valof->body.get());
+            valofEndStack.pop_back();
+        } else {
+            visitExpression(node->body_expr.get());
+        }
+    } else if (node->body_stmt) {
+        visitStatement(node->body_stmt.get());
+    }
+
+    // EPILOGUE
+    instructions.defineLabel(returnLabel);
+    instructions.leave("Restore stack and frame pointers");
+    instructions.ret("Return from function");
+
+    int frameSize = (-currentLocalVarOffset + 15) & ~15;
+    instructions.patchImm32(frameInstructionIndex, frameSize);
+    instructions.at(frameInstructionIndex).assembly = "sub rsp, " + std::to_string(frameSize);
+    instructions.at(frameInstructionIndex).comment = "Allocate stack frame";
+
+    currentFunctionName.clear();
+}
+
+void X86_64CodeGenerator::visitLetDeclaration(const LetDeclaration* node) {
+    for (const auto& init : node->initializers) {
+        if (init.init) {
+            visitExpression(init.init.get());
+            int offset = allocateLocal(SymbolTable::getInstance().intern(init.name));
+            instructions.store(X::RBP, offset, X::RAX, "Store local " + init.name);
+        } else {
+            allocateLocal(SymbolTable::getInstance().intern(init.name));
+        }
+    }
+}
+
+// --- Statements ---
+
+void X86_64CodeGenerator::visitAssignment(const Assignment* node) {
+    if (node->lhs.size() != node->rhs.size()) {
+        throw std::runtime_error("Assignment has mismatched left and right hand sides");
+    }
+    if (node->lhs.size() == 1) {
+        visitExpression(node->rhs[0].get());
+        emitStore(node->lhs[0].get());
+        return;
+    }
+
+    // Parallel assignment: evaluate every right hand side before storing any.
+    for (const auto& rhs : node->rhs) {
+        visitExpression(rhs.get());
+        pushRax("Save assigned value");
+    }
+    for (size_t i = node->lhs.size(); i-- > 0;) {
+        popReg(X::RAX, "Restore assigned value");
+        emitStore(node->lhs[i].get());
+    }
+}
+
+void X86_64CodeGenerator::emitStore(const Expression* lhs) {
+    // The value to store is in rax.
+    if (auto var = nodeCast<VariableAccess>(lhs)) {
+        if (const int* offset = localVars.find(var->symbol)) {
+            instructions.store(X::RBP, *offset, X::RAX, "Store to local var " + var->name);
+        } else if (manifestConstants.contains(var->symbol)) {
+            throw std::runtime_error("Cannot assign to manifest constant: " + var->name);
+        } else if (const size_t* global = globals.find(var->symbol)) {
+            instructions.movabs(X::R11, GLOBALS_LABEL, "Global vector");
+            instructions.store(X::R11, static_cast<int32_t>(*global * 8), X::RAX, "Store to global " + var->name);
+        } else {
+            throw std::runtime_error("Unknown variable: " + var->name);
+        }
+    } else if (auto deref = nodeCast<DereferenceExpr>(lhs)) {
+        pushRax("Save value");
+        visitExpression(deref->pointer.get());
+        instructions.mov(X::RCX, X::RAX);
+        popReg(X::RAX, "Restore value");
+        instructions.store(X::RCX, 0, X::RAX, "Store through pointer");
+    } else if (auto unary = nodeCast<UnaryOp>(lhs); unary && unary->op == TokenType::OpBang) {
+        pushRax("Save value");
+        visitExpression(unary->rhs.get());
+        instructions.mov(X::RCX, X::RAX);
+        popReg(X::RAX, "Restore value");
+        instructions.store(X::RCX, 0, X::RAX, "Store through pointer");
+    } else if (auto vecAccess = nodeCast<VectorAccess>(lhs)) {
+        pushRax("Save value");
+        visitExpression(vecAccess->vector.get());
+        pushRax("Save vector base");
+        visitExpression(vecAccess->index.get());
+        instructions.mov(X::RCX, X::RAX);
+        popReg(X::RDX, "Restore vector base");
+        popReg(X::RAX, "Restore value");
+        instructions.storeIndexed(X::RDX, X::RCX, 8, X::RAX, "Store vector element");
+    } else if (auto charAccess = nodeCast<CharacterAccess>(lhs)) {
+        pushRax("Save value");
+        visitExpression(charAccess->string.get());
+        pushRax("Save string base");
+        visitExpression(charAccess->index.get());
+        instructions.mov(X::RCX, X::RAX);
+        popReg(X::RDX, "Restore string base");
+        popReg(X::RAX, "Restore value");
+        instructions.store32Indexed(X::RDX, X::RCX, 4, X::RAX, "Store character (4-byte chars)");
+    } else {
+        throw std::runtime_error("Unsupported LHS in assignment.");
+    }
+}
+
+void X86_64CodeGenerator::visitIfStatement(const IfStatement* node) {
+    auto endLabel = newLabel("if_end");
+    emitBranch(node->condition.get(), false, endLabel);
+    visitStatement(node->then_statement.get());
+    instructions.defineLabel(endLabel);
+}
+
+void X86_64CodeGenerator::visitTestStatement(const TestStatement* node) {
+    auto elseLabel = newLabel("test_else");
+    auto endLabel = newLabel("test_end");
+    emitBranch(node->condition.get(), false, elseLabel);
+    visitStatement(node->then_statement.get());
+    instructions.jmp(endLabel);
+    instructions.defineLabel(elseLabel);
+    if (node->else_statement) {
+        visitStatement(node->else_statement.get());
+    }
+    instructions.defineLabel(endLabel);
+}
+
+void X86_64CodeGenerator::visitWhileStatement(const WhileStatement* node) {
+    auto startLabel = newLabel("while_start");
+    auto endLabel = newLabel("while_end");
+    loopStack.push_back({startLabel, endLabel});
+
+    instructions.defineLabel(startLabel);
+    emitBranch(node->condition.get(), false, endLabel);
+    visitStatement(node->body.get());
+    instructions.jmp(startLabel);
+    instructions.defineLabel(endLabel);
+
+    loopStack.pop_back();
+}
+
+void X86_64CodeGenerator::visitRepeatStatement(const RepeatStatement* node) {
+    auto startLabel = newLabel("repeat_start");
+    auto testLabel = newLabel("repeat_test");
+    auto endLabel = newLabel("repeat_end");
+    loopStack.push_back({testLabel, endLabel});
+
+    instructions.defineLabel(startLabel);
+    visitStatement(node->body.get());
+    instructions.defineLabel(testLabel);
+
+    switch (node->loopType) {
+        case RepeatStatement::LoopType::repeat:
+            instructions.jmp(startLabel, "Infinite repeat loop");
+            break;
+        case RepeatStatement::LoopType::repeatwhile:
+            emitBranch(node->condition.get(), true, startLabel);
+            break;
+        case RepeatStatement::LoopType::repeatuntil:
+            emitBranch(node->condition.get(), false, startLabel);
+            break;
+    }
+
+    instructions.defineLabel(endLabel);
+    loopStack.pop_back();
+}
+
+void X86_64CodeGenerator::visitForStatement(const ForStatement* node) {
+    auto startLabel = newLabel("for_start");
+    auto nextLabel = newLabel("for_next");
+    auto endLabel = newLabel("for_end");
+
+    // BCPL requires the step to be a constant; its sign selects the exit test.
+    int64_t step = 1;
+    bool constantStep = true;
+    if (node->by_expr) {
+        if (auto num = nodeCast<NumberLiteral>(node->by_expr.get())) {
+            step = num->value;
+        } else if (auto unary = nodeCast<UnaryOp>(node->by_expr.get());
+                   unary && unary->op == TokenType::OpMinus && nodeCast<NumberLiteral>(unary->rhs.get())) {
+            step = -static_cast<const NumberLiteral*>(unary->rhs.get())->value;
+        } else {
+            constantStep = false;
+        }
+    }
+
+    visitExpression(node->from_expr.get());
+    SymbolTable& symbols = SymbolTable::getInstance();
+    int varOffset = allocateLocal(symbols.intern(node->var_name));
+    instructions.store(X::RBP, varOffset, X::RAX, "Initialize loop var " + node->var_name);
+
+    visitExpression(node->to_expr.get());
+    int limitOffset = allocateLocal(symbols.intern(newLabel(node->var_name + ".limit")));
+    instructions.store(X::RBP, limitOffset, X::RAX, "Save loop limit");
+
+    int stepOffset = 0;
+    if (!constantStep) {
+        visitExpression(node->by_expr.get());
+        stepOffset = allocateLocal(symbols.intern(newLabel(node->var_name + ".step")));
+        instructions.store(X::RBP, stepOffset, X::RAX, "Save loop step");
+    }
+
+    loopStack.push_back({nextLabel, endLabel});
+
+    instructions.defineLabel(startLabel);
+    instructions.load(X::RAX, X::RBP, varOffset, "Load " + node->var_name);
+    instructions.load(X::RCX, X::RBP, limitOffset, "Load loop limit");
+    instructions.cmp(X::RAX, X::RCX);
+    instructions.jcc(step < 0 ? X::L : X::G, endLabel, "Exit when past the limit");
+
+    visitStatement(node->body.get());
+
+    instructions.defineLabel(nextLabel);
+    instructions.load(X::RAX, X::RBP, varOffset, "Load " + node->var_name);
+    if (constantStep && step >= INT32_MIN && step <= INT32_MAX) {
+        instructions.add_imm(X::RAX, static_cast<int32_t>(step), "Increment " + node->var_name);
+    } else {
+        if (constantStep) {
+            instructions.loadImmediate(X::RCX, step);
+        } else {
+            instructions.load(X::RCX, X::RBP, stepOffset, "Load loop step");
+        }
+        instructions.add(X::RAX, X::RCX, "Increment " + node->var_name);
+    }
+    instructions.store(X::RBP, varOffset, X::RAX, "Store " + node->var_name);
+    instructions.jmp(startLabel);
+    instructions.defineLabel(endLabel);
+
+    loopStack.pop_back();
+}
+
+void X86_64CodeGenerator::visitSwitchonStatement(const SwitchonStatement* node) {
+    auto endLabel = newLabel("switch_end");
+    auto defaultLabel = newLabel("switch_default");
+    switchEndStack.push_back(endLabel);
+
+    visitExpression(node->expression.get());
+
+    std::vector<std::string> caseLabels;
+    for (const auto& caseStmt : node->cases) {
+        caseLabels.push_back(newLabel("case"));
+        instructions.cmp_imm(X::RAX, caseStmt.value, "CASE " + std::to_string(caseStmt.value));
+        instructions.jcc(X::E, caseLabels.back());
+    }
+    instructions.jmp(defaultLabel);
+
+    // Case bodies branch to the end of the switch, as in the AArch64 back end.
+    for (size_t i = 0; i < node->cases.size(); ++i) {
+        instructions.defineLabel(caseLabels[i]);
+        visitStatement(node->cases[i].statement.get());
+        instructions.jmp(endLabel, "Branch to end of switch");
+    }
+
+    instructions.defineLabel(defaultLabel);
+    if (node->default_case) {
+        visitStatement(node->default_case.get());
+    }
+    instructions.defineLabel(endLabel);
+
+    switchEndStack.pop_back();
+}
+
+void X86_64CodeGenerator::visitResultisStatement(const ResultisStatement* node) {
+    visitExpression(node->value.get());
+    const std::string& target = valofEndStack.empty() ? returnLabel : valofEndStack.back();
+    instructions.jmp(target, "RESULTIS");
+}
+
+// --- Expressions ---
+
+void X86_64CodeGenerator::visitVariableAccess(const VariableAccess* node) {
+    if (const int* offset = localVars.find(node->symbol)) {
+        instructions.load(X::RAX, X::RBP, *offset, "Load local " + node->name);
+    } else if (const int64_t* manifest = manifestConstants.find(node->symbol)) {
+        instructions.loadImmediate(X::RAX, *manifest, "Load manifest constant " + node->name);
+    } else if (const size_t* global = globals.find(node->symbol)) {
+        instructions.movabs(X::R11, GLOBALS_LABEL, "Global vector");
+        instructions.load(X::RAX, X::R11, static_cast<int32_t>(*global * 8), "Load global " + node->name);
+    } else if (functionNames.contains(node->symbol)) {
+        instructions.leaRip(X::RAX, node->name, "Address of function " + node->name);
+    } else {
+        throw std::runtime_error("Unknown variable: " + node->name);
+    }
+}
+
+void X86_64CodeGenerator::emitAddress(const Expression* node) {
+    if (auto var = nodeCast<VariableAccess>(node)) {
+        if (const int* offset = localVars.find(var->symbol)) {
+            instructions.lea(X::RAX, X::RBP, *offset, "Address of local " + var->name);
+        } else if (const size_t* global = globals.find(var->symbol)) {
+            instructions.movabs(X::R11, GLOBALS_LABEL, "Global vector");
+            instructions.lea(X::RAX, X::R11, static_cast<int32_t>(*global * 8), "Address of global " + var->name);
+        } else {
+            throw std::runtime_error("@ operator requires addressable operand: " + var->name);
+        }
+    } else if (auto vecAccess = nodeCast<VectorAccess>(node)) {
+        visitExpression(vecAccess->vector.get());
+        pushRax("Save vector base");
+        visitExpression(vecAccess->index.get());
+        instructions.mov(X::RCX, X::RAX);
+        popReg(X::RAX, "Restore vector base");
+        instructions.leaIndexed(X::RAX, X::RAX, X::RCX, 8, "Address of vector element");
+    } else if (auto deref = nodeCast<DereferenceExpr>(node)) {
+        visitExpression(deref->pointer.get());
+    } else {
+        throw std::runtime_error("@ operator requires addressable operand");
+    }
+}
+
+void X86_64CodeGenerator::visitUnaryOp(const UnaryOp* node) {
+    if (node->op == TokenType::OpAt) {
+        emitAddress(node->rhs.get());
+        return;
+    }
+
+    visitExpression(node->rhs.get());
+    switch (node->op) {
+        case TokenType::OpLogNot:
+            instructions.not_op(X::RAX, "Logical NOT");
+            break;
+        case TokenType::OpMinus:
+            instructions.neg(X::RAX, "Arithmetic negation");
+            break;
+        case TokenType::OpBang:
+            instructions.load(X::RAX, X::RAX, 0, "Indirection");
+            break;
+        default:
+            throw std::runtime_error("Unknown unary operator");
+    }
+}
+
+void X86_64CodeGenerator::visitBinaryOp(const BinaryOp* node) {
+    // LHS ends up in rax and RHS in rcx.
+    visitExpression(node->left.get());
+    pushRax("Save LHS");
+    visitExpression(node->right.get());
+    instructions.mov(X::RCX, X::RAX, "RHS");
+    popReg(X::RAX, "Restore LHS");
+
+    switch (node->op) {
+        case TokenType::OpPlus:
+            instructions.add(X::RAX, X::RCX, "Addition");
+            break;
+        case TokenType::OpMinus:
+            instructions.sub(X::RAX, X::RCX, "Subtraction");
+            break;
+        case TokenType::OpMultiply:
+            instructions.imul(X::RAX, X::RCX, "Multiplication");
+            break;
+        case TokenType::OpDivide:
+            instructions.cqo();
+            instructions.idiv(X::RCX, "Signed Division");
+            break;
+        case TokenType::OpRemainder:
+            instructions.cqo();
+            instructions.idiv(X::RCX, "Signed Division");
+            instructions.mov(X::RAX, X::RDX, "Remainder");
+            break;
+
+        // Comparisons (result -1 for true, 0 for false)
+        case TokenType::OpEq: emitCompare(X::E); break;
+        case TokenType::OpNe: emitCompare(X::NE); break;
+        case TokenType::OpLt: emitCompare(X::L); break;
+        case TokenType::OpGt: emitCompare(X::G); break;
+        case TokenType::OpLe: emitCompare(X::LE); break;
+        case TokenType::OpGe: emitCompare(X::GE); break;
+
+        // Logical operations (bitwise)
+        case TokenType::OpLogAnd:
+            instructions.and_op(X::RAX, X::RCX, "Bitwise AND");
+            break;
+        case TokenType::OpLogOr:
+            instructions.or_op(X::RAX, X::RCX, "Bitwise OR");
+            break;
+        case TokenType::OpLogEqv:
+            instructions.xor_op(X::RAX, X::RCX);
+            instructions.not_op(X::RAX, "Bitwise EQV");
+            break;
+        case TokenType::OpLogNeqv:
+            instructions.xor_op(X::RAX, X::RCX, "Bitwise NEQV");
+            break;
+        case TokenType::OpLshift:
+            instructions.shl_cl(X::RAX, "Logical Left Shift");
+            break;
+        case TokenType::OpRshift:
+            instructions.shr_cl(X::RAX, "Logical Right Shift");
+            break;
+
+        default:
+            throw std::runtime_error("Unsupported binary operator: " + Token::tokenTypeToString(node->op));
+    }
+}
+
+void X86_64CodeGenerator::visitFunctionCall(const FunctionCall* node) {
+    std::vector<const Expression*> arguments;
+    for (const auto& arg : node->arguments) {
+        arguments.push_back(arg.get());
+    }
+
+    if (auto funcVar = nodeCast<VariableAccess>(node->function.get())) {
+        bool isVariable = localVars.contains(funcVar->symbol) || globals.contains(funcVar->symbol);
+        if (!isVariable) {
+            if (functionNames.contains(funcVar->symbol)) {
+                emitCall(funcVar->name, arguments, nullptr);
+                return;
+            }
+            std::string symbol = runtimeSymbolFor(funcVar->name);
+            if (symbol.empty()) {
+                throw std::runtime_error("Unknown function: " + funcVar->name);
+            }
+            if (funcVar->name == "WRITEF" && arguments.size() > 6) {
+                throw std::runtime_error("x86-64: WRITEF takes at most five values after the format");
+            }
+            emitCall(symbol, arguments, nullptr);
+            return;
+        }
+    }
+
+    // Indirect call through a computed function value
+    emitCall("", arguments, node->function.get());
+}
+
+void X86_64CodeGenerator::emitCall(const std::string& callee, const std::vector<const Expression*>& arguments,
+                                   const Expression* indirectTarget) {
+    if (callee.empty() && !indirectTarget) {
+        throw std::runtime_error("x86-64: call has no target");
+    }
+
+    int stackArgs = arguments.size() > NUM_ARG_REGS ? static_cast<int>(arguments.size() - NUM_ARG_REGS) : 0;
+    int targetSlot = indirectTarget ? 1 : 0;
+
+    // rsp must be 16-byte aligned at the call instruction.
+    int padding = (stackDepth + stackArgs + targetSlot) % 2;
+    if (padding) {
+        instructions.sub_imm(X::RSP, 8, "Align stack for call");
+        ++stackDepth;
+    }
+
+    if (indirectTarget) {
+        visitExpression(indirectTarget);
+        pushRax("Save call target");
+    }
+
+    // Push arguments last-to-first so the first argument ends up on top and
+    // stack arguments are already in SysV order once the register ones are popped.
+    for (size_t i = arguments.size(); i-- > 0;) {
+        visitExpression(arguments[i]);
+        pushRax("Argument " + std::to_string(i));
+    }
+    for (size_t i = 0; i < std::min(arguments.size(), NUM_ARG_REGS); ++i) {
+        popReg(ARG_REGS[i], "Argument " + std::to_string(i) + " to " + X::regName(ARG_REGS[i]));
+    }
+
+    if (indirectTarget) {
+        instructions.load(X::R11, X::RSP, stackArgs * 8, "Load call target");
+        instructions.call_reg(X::R11, "Indirect call");
+    } else {
+        instructions.call(callee, "Call " + callee);
+    }
+
+    dropSlots(stackArgs + targetSlot + padding, "Pop call arguments");
+}
+
+void X86_64CodeGenerator::visitConditionalExpression(const ConditionalExpression* node) {
+    auto elseLabel = newLabel("cond_else");
+    auto endLabel = newLabel("cond_end");
+
+    emitBranch(node->condition.get(), false, elseLabel);
+    visitExpression(node->trueExpr.get());
+    instructions.jmp(endLabel);
+    instructions.defineLabel(elseLabel);
+    visitExpression(node->falseExpr.get());
+    instructions.defineLabel(endLabel);
+}
+
+void X86_64CodeGenerator::visitValof(const Valof* node) {
+    auto endLabel = newLabel("valof_end");
+    valofEndStack.push_back(endLabel);
+    visitStatement(node->body.get());
+    valofEndStack.pop_back();
+    instructions.defineLabel(endLabel);
+}
+
+void X86_64CodeGenerator::visitVectorConstructor(const VectorConstructor* node) {
+    std::string symbol = runtimeSymbolFor("bcpl_vec");
+    if (symbol.empty()) {
+        throw std::runtime_error("Runtime function bcpl_vec is not registered");
+    }
+    // VEC n has elements 0..n
+    visitExpression(node->size.get());
+    instructions.add_imm(X::RAX, 1, "VEC n has n+1 elements");
+    int padding = stackDepth % 2;
+    if (padding) {
+        instructions.sub_imm(X::RSP, 8, "Align stack for call");
+        ++stackDepth;
+    }
+    instructions.mov(X::RDI, X::RAX);
+    instructions.call(symbol, "Allocate vector on heap");
+    dropSlots(padding, "Pop alignment padding");
+}
@@ -0,0 +1,124 @@
+// X86_64CodeGenerator.h
+#ifndef X86_64_CODEGENERATOR_H
+#define X86_64_CODEGENERATOR_H
+
+#include "AST.h"
+#include "SymbolTable.h"
+#include "Target.h"
+#include "X86_64Instructions.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class X86_64CodeGenerator
+ * @brief Lowers the BCPL AST to System V x86-64 machine code.
+ *
+ * The generator uses an accumulator model: every expression leaves its value
+ * in rax, and intermediate values are pushed on the machine stack. The number
+ * of pushed temporaries is tracked at compile time so that rsp is 16-byte
+ * aligned at every call, as the SysV ABI requires.
+ *
+ * Frame layout (rbp-relative):
+ *   [rbp + 16 + 8*(i-6)]  incoming stack arguments (parameters 7 and up)
+ *   [rbp + 8]             return address
+ *   [rbp]                 saved rbp
+ *   [rbp - 8*k]           parameters and locals
+ *
+ * Globals live in a writable vector provided by the JIT loader; its address
+ * is materialized with a movabs of the .L.globals label. Top-level LET
+ * variables take slots after the GLOBALs and are initialized on entry to START.
+ *
+ * Not supported, and rejected with a runtime_error naming the construct:
+ * floating-point expressions, nested function declarations, and WRITEF with
+ * more than five values (the runtime formatter takes five).
+ */
+class X86_64CodeGenerator : public TargetCodeGenerator {
+public:
+    X86_64CodeGenerator() = default;
+
+    uintptr_t compile(ProgramPtr program) override;
+    void printAsm() const override;
+    void* load(JITExecutor& executor, uintptr_t entryOffset) const override;
+    TargetArch getTarget() const override { return TargetArch::X86_64; }
+
+    const X86_64Instructions& getInstructions() const { return instructions; }
+    const std::vector<std::string>& getStringPool() const { return stringPool; }
+    size_t getGlobalCount() const { return globals.size(); }
+
+    static const char* const GLOBALS_LABEL;
+
+private:
+    using X = X86_64Instructions;
+
+    X86_64Instructions instructions;
+    std::vector<std::string> stringPool;
+
+    // Keyed on the interned names of the identifiers
+    SymbolMap<int> localVars;
+    SymbolMap<size_t> globals;
+    SymbolMap<int64_t> manifestConstants;
+    SymbolMap<size_t> functions;
+    SymbolSet functionNames;
+    std::vector<const LetDeclaration::VarInit*> staticInitializers; // Top-level LETs, run by START
+
+    std::string currentFunctionName;
+    std::string returnLabel;
+    int currentLocalVarOffset = 0;
+    int stackDepth = 0; // Temporaries pushed since the frame was set up (8-byte slots)
+    int labelCounter = 0;
+
+    struct LoopLabels {
+        std::string continueLabel;
+        std::string breakLabel;
+    };
+    std::vector<LoopLabels> loopStack;
+    std::vector<std::string> switchEndStack;
+    std::vector<std::string> valofEndStack;
+
+    // AST visitors
+    void visitProgram(const Program* node);
+    void visitDeclaration(const Declaration* node);
+    void visitStatement(const Statement* node);
+    void visitExpression(const Expression* node);
+
+    // Declarations
+    void visitFunctionDeclaration(const FunctionDeclaration* node);
+    void visitLetDeclaration(const LetDeclaration* node);
+
+    // Statements
+    void visitAssignment(const Assignment* node);
+    void visitIfStatement(const IfStatement* node);
+    void visitTestStatement(const TestStatement* node);
+    void visitWhileStatement(const WhileStatement* node);
+    void visitRepeatStatement(const RepeatStatement* node);
+    void visitForStatement(const ForStatement* node);
+    void visitSwitchonStatement(const SwitchonStatement* node);
+    void visitResultisStatement(const ResultisStatement* node);
+
+    // Expressions
+    void visitVariableAccess(const VariableAccess* node);
+    void visitUnaryOp(const UnaryOp* node);
+    void visitBinaryOp(const BinaryOp* node);
+    void visitFunctionCall(const FunctionCall* node);
+    void visitConditionalExpression(const ConditionalExpression* node);
+    void visitValof(const Valof* node);
+    void visitVectorConstructor(const VectorConstructor* node);
+
+    // Helpers
+    std::string newLabel(const std::string& prefix);
+    std::string userLabel(const std::string& name) const;
+    int allocateLocal(SymbolId var);
+    void pushRax(const std::string& comment = "");
+    void popReg(uint32_t reg, const std::string& comment = "");
+    void dropSlots(int slots, const std::string& comment = "");
+    void emitBranch(const Expression* condition, bool branchIfTrue, const std::string& label);
+    void emitCompare(X86_64Instructions::Condition cond);
+    void emitAddress(const Expression* node);
+    void emitStore(const Expression* lhs);
+    void emitCall(const std::string& callee, const std::vector<const Expression*>& arguments,
+                  const Expression* indirectTarget);
+    std::string runtimeSymbolFor(const std::string& name) const;
+};
+
+#endif // X86_64_CODEGENERATOR_H
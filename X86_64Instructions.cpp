@@ -0,0 +1,523 @@
+#include "X86_64Instructions.h"
+#include <stdexcept>
+#include <sstream>
+#include <map>
+
+// Define static members
+const uint32_t X86_64Instructions::RAX;
+const uint32_t X86_64Instructions::RCX;
+const uint32_t X86_64Instructions::RDX;
+const uint32_t X86_64Instructions::RSP;
+const uint32_t X86_64Instructions::RBP;
+const uint32_t X86_64Instructions::RSI;
+const uint32_t X86_64Instructions::RDI;
+const uint32_t X86_64Instructions::R8;
+const uint32_t X86_64Instructions::R9;
+const uint32_t X86_64Instructions::R11;
+
+namespace {
+bool fitsInt8(int64_t value) {
+    return value >= -128 && value <= 127;
+}
+
+bool fitsInt32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+} // namespace
+
+void X86_64Instructions::addInstruction(Instruction instr) {
+    instr.address = codeSize_;
+    codeSize_ += instr.bytes.size();
+    instructions.push_back(std::move(instr));
+}
+
+void X86_64Instructions::emit(std::vector<uint8_t> bytes, const std::string& assembly, const std::string& comment) {
+    Instruction instr;
+    instr.bytes = std::move(bytes);
+    instr.assembly = assembly;
+    instr.comment = comment;
+    addInstruction(std::move(instr));
+}
+
+void X86_64Instructions::emitLabelRef(std::vector<uint8_t> bytes, Fixup fixup, const std::string& label,
+                                      const std::string& assembly, const std::string& comment) {
+    Instruction instr;
+    instr.fixupOffset = bytes.size() - (fixup == Fixup::Abs64 ? 8 : 4);
+    instr.bytes = std::move(bytes);
+    instr.assembly = assembly;
+    instr.comment = comment;
+    instr.needsLabelResolution = true;
+    instr.targetLabel = label;
+    instr.fixup = fixup;
+    addInstruction(std::move(instr));
+}
+
+void X86_64Instructions::defineLabel(const std::string& label) {
+    Instruction instr;
+    instr.hasLabel = true;
+    instr.label = label;
+    addInstruction(std::move(instr));
+}
+
+// --- Encoding helpers ---
+
+uint8_t X86_64Instructions::rex(bool w, uint32_t reg, uint32_t index, uint32_t base) {
+    return static_cast<uint8_t>(0x40 | (w ? 0x08 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3));
+}
+
+void X86_64Instructions::appendImm32(std::vector<uint8_t>& out, int32_t value) {
+    uint32_t v = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>((v >> (i * 8)) & 0xFF));
+    }
+}
+
+void X86_64Instructions::appendMemory(std::vector<uint8_t>& out, uint32_t reg, uint32_t base, int32_t disp) {
+    uint8_t r = reg & 7;
+    uint8_t b = base & 7;
+    uint8_t mod;
+    // [rbp]/[r13] have no disp-less form; [rsp]/[r12] need a SIB byte.
+    if (disp == 0 && b != 5) {
+        mod = 0;
+    } else if (fitsInt8(disp)) {
+        mod = 1;
+    } else {
+        mod = 2;
+    }
+    out.push_back(static_cast<uint8_t>((mod << 6) | (r << 3) | b));
+    if (b == 4) {
+        out.push_back(0x24);
+    }
+    if (mod == 1) {
+        out.push_back(static_cast<uint8_t>(static_cast<int8_t>(disp)));
+    } else if (mod == 2) {
+        appendImm32(out, disp);
+    }
+}
+
+void X86_64Instructions::appendIndexed(std::vector<uint8_t>& out, uint32_t reg, uint32_t base, uint32_t index, uint32_t scale) {
+    if (index == RSP) {
+        throw std::runtime_error("x86-64: rsp cannot be used as an index register");
+    }
+    uint8_t ss;
+    switch (scale) {
+        case 1: ss = 0; break;
+        case 2: ss = 1; break;
+        case 4: ss = 2; break;
+        case 8: ss = 3; break;
+        default: throw std::runtime_error("x86-64: invalid index scale " + std::to_string(scale));
+    }
+    uint8_t mod = (base & 7) == 5 ? 1 : 0;
+    out.push_back(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | 4));
+    out.push_back(static_cast<uint8_t>((ss << 6) | ((index & 7) << 3) | (base & 7)));
+    if (mod == 1) {
+        out.push_back(0);
+    }
+}
+
+std::string X86_64Instructions::memoryOperand(uint32_t base, int32_t disp) {
+    std::string s = "[" + regName(base);
+    if (disp > 0) {
+        s += " + " + std::to_string(disp);
+    } else if (disp < 0) {
+        s += " - " + std::to_string(-static_cast<int64_t>(disp));
+    }
+    return s + "]";
+}
+
+std::string X86_64Instructions::indexedOperand(uint32_t base, uint32_t index, uint32_t scale) {
+    return "[" + regName(base) + " + " + regName(index) + "*" + std::to_string(scale) + "]";
+}
+
+void X86_64Instructions::aluReg(uint8_t opcode, const char* mnemonic, uint32_t dst, uint32_t src, const std::string& comment) {
+    emit({rex(true, src, 0, dst), opcode, static_cast<uint8_t>(0xC0 | ((src & 7) << 3) | (dst & 7))},
+         std::string(mnemonic) + " " + regName(dst) + ", " + regName(src), comment);
+}
+
+void X86_64Instructions::aluImm(uint32_t ext, const char* mnemonic, uint32_t dst, int32_t imm, bool forceImm32, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, 0, 0, dst)};
+    uint8_t modrm = static_cast<uint8_t>(0xC0 | (ext << 3) | (dst & 7));
+    if (!forceImm32 && fitsInt8(imm)) {
+        bytes.push_back(0x83);
+        bytes.push_back(modrm);
+        bytes.push_back(static_cast<uint8_t>(static_cast<int8_t>(imm)));
+    } else {
+        bytes.push_back(0x81);
+        bytes.push_back(modrm);
+        appendImm32(bytes, imm);
+    }
+    emit(std::move(bytes), std::string(mnemonic) + " " + regName(dst) + ", " + std::to_string(imm), comment);
+}
+
+void X86_64Instructions::unary(uint8_t opcode, uint32_t ext, const char* mnemonic, uint32_t reg, const std::string& comment) {
+    emit({rex(true, 0, 0, reg), opcode, static_cast<uint8_t>(0xC0 | (ext << 3) | (reg & 7))},
+         std::string(mnemonic) + " " + regName(reg), comment);
+}
+
+// --- Data movement ---
+
+void X86_64Instructions::mov(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x89, "mov", dst, src, comment);
+}
+
+void X86_64Instructions::loadImmediate(uint32_t dst, int64_t value, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    std::string assembly = "mov " + regName(dst) + ", " + std::to_string(value);
+    if (value == 0) {
+        // xor r32, r32 clears the full register
+        if (dst >= 8) bytes.push_back(rex(false, dst, 0, dst));
+        bytes.push_back(0x31);
+        bytes.push_back(static_cast<uint8_t>(0xC0 | ((dst & 7) << 3) | (dst & 7)));
+        assembly = "xor " + regName32(dst) + ", " + regName32(dst);
+    } else if (value > 0 && value <= UINT32_MAX) {
+        // mov r32, imm32 zero-extends into the full register
+        if (dst >= 8) bytes.push_back(rex(false, 0, 0, dst));
+        bytes.push_back(static_cast<uint8_t>(0xB8 + (dst & 7)));
+        appendImm32(bytes, static_cast<int32_t>(static_cast<uint32_t>(value)));
+    } else if (fitsInt32(value)) {
+        bytes = {rex(true, 0, 0, dst), 0xC7, static_cast<uint8_t>(0xC0 | (dst & 7))};
+        appendImm32(bytes, static_cast<int32_t>(value));
+    } else {
+        bytes = {rex(true, 0, 0, dst), static_cast<uint8_t>(0xB8 + (dst & 7))};
+        uint64_t v = static_cast<uint64_t>(value);
+        for (int i = 0; i < 8; ++i) {
+            bytes.push_back(static_cast<uint8_t>((v >> (i * 8)) & 0xFF));
+        }
+        assembly = "movabs " + regName(dst) + ", " + std::to_string(value);
+    }
+    emit(std::move(bytes), assembly, comment);
+}
+
+void X86_64Instructions::movabs(uint32_t dst, const std::string& label, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, 0, 0, dst), static_cast<uint8_t>(0xB8 + (dst & 7))};
+    bytes.resize(bytes.size() + 8, 0);
+    emitLabelRef(std::move(bytes), Fixup::Abs64, label, "movabs " + regName(dst) + ", " + label, comment);
+}
+
+void X86_64Instructions::load(uint32_t dst, uint32_t base, int32_t disp, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, dst, 0, base), 0x8B};
+    appendMemory(bytes, dst, base, disp);
+    emit(std::move(bytes), "mov " + regName(dst) + ", " + memoryOperand(base, disp), comment);
+}
+
+void X86_64Instructions::store(uint32_t base, int32_t disp, uint32_t src, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, src, 0, base), 0x89};
+    appendMemory(bytes, src, base, disp);
+    emit(std::move(bytes), "mov " + memoryOperand(base, disp) + ", " + regName(src), comment);
+}
+
+void X86_64Instructions::loadIndexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, dst, index, base), 0x8B};
+    appendIndexed(bytes, dst, base, index, scale);
+    emit(std::move(bytes), "mov " + regName(dst) + ", " + indexedOperand(base, index, scale), comment);
+}
+
+void X86_64Instructions::storeIndexed(uint32_t base, uint32_t index, uint32_t scale, uint32_t src, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, src, index, base), 0x89};
+    appendIndexed(bytes, src, base, index, scale);
+    emit(std::move(bytes), "mov " + indexedOperand(base, index, scale) + ", " + regName(src), comment);
+}
+
+void X86_64Instructions::load32Indexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    uint8_t prefix = rex(false, dst, index, base);
+    if (prefix != 0x40) bytes.push_back(prefix);
+    bytes.push_back(0x8B);
+    appendIndexed(bytes, dst, base, index, scale);
+    emit(std::move(bytes), "mov " + regName32(dst) + ", dword " + indexedOperand(base, index, scale), comment);
+}
+
+void X86_64Instructions::store32Indexed(uint32_t base, uint32_t index, uint32_t scale, uint32_t src, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    uint8_t prefix = rex(false, src, index, base);
+    if (prefix != 0x40) bytes.push_back(prefix);
+    bytes.push_back(0x89);
+    appendIndexed(bytes, src, base, index, scale);
+    emit(std::move(bytes), "mov dword " + indexedOperand(base, index, scale) + ", " + regName32(src), comment);
+}
+
+void X86_64Instructions::lea(uint32_t dst, uint32_t base, int32_t disp, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, dst, 0, base), 0x8D};
+    appendMemory(bytes, dst, base, disp);
+    emit(std::move(bytes), "lea " + regName(dst) + ", " + memoryOperand(base, disp), comment);
+}
+
+void X86_64Instructions::leaIndexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, dst, index, base), 0x8D};
+    appendIndexed(bytes, dst, base, index, scale);
+    emit(std::move(bytes), "lea " + regName(dst) + ", " + indexedOperand(base, index, scale), comment);
+}
+
+void X86_64Instructions::leaRip(uint32_t dst, const std::string& label, const std::string& comment) {
+    std::vector<uint8_t> bytes{rex(true, dst, 0, 0), 0x8D, static_cast<uint8_t>(((dst & 7) << 3) | 5), 0, 0, 0, 0};
+    emitLabelRef(std::move(bytes), Fixup::Rel32, label, "lea " + regName(dst) + ", [rip + " + label + "]", comment);
+}
+
+void X86_64Instructions::push(uint32_t reg, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    if (reg >= 8) bytes.push_back(0x41);
+    bytes.push_back(static_cast<uint8_t>(0x50 + (reg & 7)));
+    emit(std::move(bytes), "push " + regName(reg), comment);
+}
+
+void X86_64Instructions::pop(uint32_t reg, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    if (reg >= 8) bytes.push_back(0x41);
+    bytes.push_back(static_cast<uint8_t>(0x58 + (reg & 7)));
+    emit(std::move(bytes), "pop " + regName(reg), comment);
+}
+
+// --- Arithmetic and logic ---
+
+void X86_64Instructions::add(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x01, "add", dst, src, comment);
+}
+
+void X86_64Instructions::add_imm(uint32_t dst, int32_t imm, const std::string& comment) {
+    aluImm(0, "add", dst, imm, false, comment);
+}
+
+void X86_64Instructions::sub(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x29, "sub", dst, src, comment);
+}
+
+void X86_64Instructions::sub_imm(uint32_t dst, int32_t imm, const std::string& comment) {
+    aluImm(5, "sub", dst, imm, false, comment);
+}
+
+void X86_64Instructions::sub_imm32(uint32_t dst, int32_t imm, const std::string& comment) {
+    aluImm(5, "sub", dst, imm, true, comment);
+}
+
+void X86_64Instructions::imul(uint32_t dst, uint32_t src, const std::string& comment) {
+    emit({rex(true, dst, 0, src), 0x0F, 0xAF, static_cast<uint8_t>(0xC0 | ((dst & 7) << 3) | (src & 7))},
+         "imul " + regName(dst) + ", " + regName(src), comment);
+}
+
+void X86_64Instructions::cqo(const std::string& comment) {
+    emit({0x48, 0x99}, "cqo", comment);
+}
+
+void X86_64Instructions::idiv(uint32_t src, const std::string& comment) {
+    unary(0xF7, 7, "idiv", src, comment);
+}
+
+void X86_64Instructions::and_op(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x21, "and", dst, src, comment);
+}
+
+void X86_64Instructions::or_op(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x09, "or", dst, src, comment);
+}
+
+void X86_64Instructions::xor_op(uint32_t dst, uint32_t src, const std::string& comment) {
+    aluReg(0x31, "xor", dst, src, comment);
+}
+
+void X86_64Instructions::neg(uint32_t reg, const std::string& comment) {
+    unary(0xF7, 3, "neg", reg, comment);
+}
+
+void X86_64Instructions::not_op(uint32_t reg, const std::string& comment) {
+    unary(0xF7, 2, "not", reg, comment);
+}
+
+void X86_64Instructions::shl_cl(uint32_t reg, const std::string& comment) {
+    emit({rex(true, 0, 0, reg), 0xD3, static_cast<uint8_t>(0xE0 | (reg & 7))}, "shl " + regName(reg) + ", cl", comment);
+}
+
+void X86_64Instructions::shr_cl(uint32_t reg, const std::string& comment) {
+    emit({rex(true, 0, 0, reg), 0xD3, static_cast<uint8_t>(0xE8 | (reg & 7))}, "shr " + regName(reg) + ", cl", comment);
+}
+
+void X86_64Instructions::sar_cl(uint32_t reg, const std::string& comment) {
+    emit({rex(true, 0, 0, reg), 0xD3, static_cast<uint8_t>(0xF8 | (reg & 7))}, "sar " + regName(reg) + ", cl", comment);
+}
+
+void X86_64Instructions::cmp(uint32_t lhs, uint32_t rhs, const std::string& comment) {
+    aluReg(0x39, "cmp", lhs, rhs, comment);
+}
+
+void X86_64Instructions::cmp_imm(uint32_t reg, int32_t imm, const std::string& comment) {
+    aluImm(7, "cmp", reg, imm, false, comment);
+}
+
+void X86_64Instructions::test(uint32_t lhs, uint32_t rhs, const std::string& comment) {
+    aluReg(0x85, "test", lhs, rhs, comment);
+}
+
+void X86_64Instructions::setcc(Condition cond, uint32_t reg, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    // Without a REX prefix, byte registers 4-7 would be ah/ch/dh/bh.
+    if (reg >= 4) bytes.push_back(rex(false, 0, 0, reg));
+    bytes.push_back(0x0F);
+    bytes.push_back(static_cast<uint8_t>(0x90 + cond));
+    bytes.push_back(static_cast<uint8_t>(0xC0 | (reg & 7)));
+    emit(std::move(bytes), "set" + conditionName(cond) + " " + regName8(reg), comment);
+}
+
+void X86_64Instructions::movzx8(uint32_t dst, uint32_t src, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    if (dst >= 8 || src >= 4) bytes.push_back(rex(false, dst, 0, src));
+    bytes.push_back(0x0F);
+    bytes.push_back(0xB6);
+    bytes.push_back(static_cast<uint8_t>(0xC0 | ((dst & 7) << 3) | (src & 7)));
+    emit(std::move(bytes), "movzx " + regName32(dst) + ", " + regName8(src), comment);
+}
+
+// --- Control flow ---
+
+void X86_64Instructions::jmp(const std::string& label, const std::string& comment) {
+    emitLabelRef({0xE9, 0, 0, 0, 0}, Fixup::Rel32, label, "jmp " + label, comment);
+}
+
+void X86_64Instructions::jcc(Condition cond, const std::string& label, const std::string& comment) {
+    emitLabelRef({0x0F, static_cast<uint8_t>(0x80 + cond), 0, 0, 0, 0}, Fixup::Rel32, label,
+                 "j" + conditionName(cond) + " " + label, comment);
+}
+
+void X86_64Instructions::call(const std::string& label, const std::string& comment) {
+    emitLabelRef({0xE8, 0, 0, 0, 0}, Fixup::Rel32, label, "call " + label, comment);
+}
+
+void X86_64Instructions::call_reg(uint32_t reg, const std::string& comment) {
+    std::vector<uint8_t> bytes;
+    if (reg >= 8) bytes.push_back(0x41);
+    bytes.push_back(0xFF);
+    bytes.push_back(static_cast<uint8_t>(0xD0 | (reg & 7)));
+    emit(std::move(bytes), "call " + regName(reg), comment);
+}
+
+void X86_64Instructions::ret(const std::string& comment) {
+    emit({0xC3}, "ret", comment);
+}
+
+void X86_64Instructions::leave(const std::string& comment) {
+    emit({0xC9}, "leave", comment);
+}
+
+// --- Names ---
+
+std::string X86_64Instructions::regName(uint32_t reg) {
+    static const char* names[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                  "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+    return reg < 16 ? names[reg] : "r?";
+}
+
+std::string X86_64Instructions::regName32(uint32_t reg) {
+    static const char* names[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+                                  "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"};
+    return reg < 16 ? names[reg] : "r?d";
+}
+
+std::string X86_64Instructions::regName8(uint32_t reg) {
+    static const char* names[] = {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+                                  "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"};
+    return reg < 16 ? names[reg] : "r?b";
+}
+
+std::string X86_64Instructions::conditionName(Condition cond) {
+    switch (cond) {
+        case O: return "o";
+        case NO: return "no";
+        case B: return "b";
+        case AE: return "ae";
+        case E: return "e";
+        case NE: return "ne";
+        case BE: return "be";
+        case A: return "a";
+        case S: return "s";
+        case NS: return "ns";
+        case L: return "l";
+        case GE: return "ge";
+        case LE: return "le";
+        case G: return "g";
+    }
+    return "?";
+}
+
+// --- Finalization ---
+
+size_t X86_64Instructions::getCurrentAddress() const {
+    return codeSize_;
+}
+
+void X86_64Instructions::patchImm32(size_t index, int32_t value) {
+    Instruction& instr = instructions.at(index);
+    if (instr.bytes.size() < 4) {
+        throw std::runtime_error("x86-64: instruction has no 32-bit immediate to patch");
+    }
+    size_t offset = instr.bytes.size() - 4;
+    uint32_t v = static_cast<uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        instr.bytes[offset + i] = static_cast<uint8_t>((v >> (i * 8)) & 0xFF);
+    }
+}
+
+void X86_64Instructions::computeAddresses(size_t baseAddress) {
+    size_t currentAddress = baseAddress;
+    for (auto& instr : instructions) {
+        instr.address = currentAddress;
+        currentAddress += instr.bytes.size();
+    }
+}
+
+void X86_64Instructions::resolveAllBranches() {
+    std::map<std::string, size_t> labelMap;
+    for (const auto& instr : instructions) {
+        if (instr.hasLabel) {
+            labelMap[instr.label] = instr.address;
+        }
+    }
+
+    for (auto& instr : instructions) {
+        if (!instr.needsLabelResolution || instr.fixup != Fixup::Rel32) continue;
+        auto it = labelMap.find(instr.targetLabel);
+        if (it == labelMap.end()) continue; // Left for the JIT loader
+
+        int64_t offset = static_cast<int64_t>(it->second) - static_cast<int64_t>(instr.address + instr.bytes.size());
+        if (!fitsInt32(offset)) {
+            throw std::runtime_error("x86-64: branch to '" + instr.targetLabel + "' out of range");
+        }
+        uint32_t v = static_cast<uint32_t>(static_cast<int32_t>(offset));
+        for (int i = 0; i < 4; ++i) {
+            instr.bytes[instr.fixupOffset + i] = static_cast<uint8_t>((v >> (i * 8)) & 0xFF);
+        }
+        instr.needsLabelResolution = false;
+    }
+}
+
+size_t X86_64Instructions::encodeToBuffer(uint8_t* buffer, size_t bufferSize) const {
+    if (bufferSize < codeSize()) {
+        throw std::runtime_error("Buffer too small for instruction encoding");
+    }
+
+    size_t bytesWritten = 0;
+    for (const auto& instr : instructions) {
+        for (uint8_t byte : instr.bytes) {
+            buffer[bytesWritten++] = byte;
+        }
+    }
+    return bytesWritten;
+}
+
+void X86_64Instructions::clear() {
+    instructions.clear();
+    codeSize_ = 0;
+}
+
+X86_64Instructions::Instruction& X86_64Instructions::at(size_t index) {
+    return instructions.at(index);
+}
+
+size_t X86_64Instructions::size() const {
+    return instructions.size();
+}
+
+size_t X86_64Instructions::codeSize() const {
+    size_t total = 0;
+    for (const auto& instr : instructions) {
+        total += instr.bytes.size();
+    }
+    return total;
+}
@@ -0,0 +1,195 @@
+// X86_64Instructions.h
+#ifndef X86_64_INSTRUCTIONS_H
+#define X86_64_INSTRUCTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * x86-64 Instruction Generator and Binary Encoder
+ *
+ * The x86-64 counterpart of AArch64Instructions. Instructions are variable
+ * length, so each one carries its own byte encoding. The encoding process is
+ * the same as for AArch64:
+ * 1. Instructions are created with their bytes pre-computed
+ * 2. computeAddresses() assigns byte addresses to each instruction
+ * 3. resolveAllBranches() patches rel32 fields of jumps, calls and
+ *    RIP-relative lea instructions whose label is defined in the stream
+ * 4. encodeToBuffer() outputs the final machine code
+ *
+ * References to labels that are not defined in the stream (runtime symbols,
+ * string literals, the global vector) are left unresolved for the JIT loader.
+ * Labels are zero-length entries in the stream, so any number of labels may
+ * share one address.
+ */
+class X86_64Instructions {
+public:
+    // Register definitions (hardware encoding numbers)
+    static const uint32_t RAX = 0;  // Return value / accumulator
+    static const uint32_t RCX = 1;  // Fourth argument / shift count
+    static const uint32_t RDX = 2;  // Third argument / division remainder
+    static const uint32_t RBX = 3;
+    static const uint32_t RSP = 4;  // Stack pointer
+    static const uint32_t RBP = 5;  // Frame pointer
+    static const uint32_t RSI = 6;  // Second argument
+    static const uint32_t RDI = 7;  // First argument
+    static const uint32_t R8 = 8;   // Fifth argument
+    static const uint32_t R9 = 9;   // Sixth argument
+    static const uint32_t R10 = 10;
+    static const uint32_t R11 = 11; // Scratch for indirect calls and the global vector
+    static const uint32_t R12 = 12;
+    static const uint32_t R13 = 13;
+    static const uint32_t R14 = 14;
+    static const uint32_t R15 = 15;
+
+    // Condition codes, as used by jcc and setcc
+    enum Condition {
+        O = 0x0, NO = 0x1,
+        B = 0x2, AE = 0x3,
+        E = 0x4, NE = 0x5,
+        BE = 0x6, A = 0x7,
+        S = 0x8, NS = 0x9,
+        L = 0xC, GE = 0xD,
+        LE = 0xE, G = 0xF
+    };
+
+    // How an unresolved label reference is patched
+    enum class Fixup {
+        None,
+        Rel32,  // 32-bit displacement relative to the end of the instruction
+        Abs64   // 64-bit absolute address (movabs)
+    };
+
+    struct Instruction {
+        std::vector<uint8_t> bytes;
+        std::string assembly;
+        std::string comment;
+        bool needsLabelResolution = false;
+        std::string targetLabel;
+        Fixup fixup = Fixup::None;
+        size_t fixupOffset = 0; // Offset of the patched field within bytes
+        size_t address = 0;     // Address of the instruction in the generated code
+        bool hasLabel = false;  // True for label definitions (no bytes)
+        std::string label;
+
+        size_t size() const { return bytes.size(); }
+        std::string toString() const { return assembly; }
+    };
+
+    // Labels
+    void defineLabel(const std::string& label);
+
+    // Data movement
+    void mov(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void loadImmediate(uint32_t dst, int64_t value, const std::string& comment = "");
+    void movabs(uint32_t dst, const std::string& label, const std::string& comment = "");
+    void load(uint32_t dst, uint32_t base, int32_t disp, const std::string& comment = "");
+    void store(uint32_t base, int32_t disp, uint32_t src, const std::string& comment = "");
+    void loadIndexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment = "");
+    void storeIndexed(uint32_t base, uint32_t index, uint32_t scale, uint32_t src, const std::string& comment = "");
+    void load32Indexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment = "");
+    void store32Indexed(uint32_t base, uint32_t index, uint32_t scale, uint32_t src, const std::string& comment = "");
+    void lea(uint32_t dst, uint32_t base, int32_t disp, const std::string& comment = "");
+    void leaIndexed(uint32_t dst, uint32_t base, uint32_t index, uint32_t scale, const std::string& comment = "");
+    void leaRip(uint32_t dst, const std::string& label, const std::string& comment = "");
+    void push(uint32_t reg, const std::string& comment = "");
+    void pop(uint32_t reg, const std::string& comment = "");
+
+    // Arithmetic and logic (64-bit)
+    void add(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void add_imm(uint32_t dst, int32_t imm, const std::string& comment = "");
+    void sub(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void sub_imm(uint32_t dst, int32_t imm, const std::string& comment = "");
+    void sub_imm32(uint32_t dst, int32_t imm, const std::string& comment = ""); // Always imm32, for back-patching
+    void imul(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void cqo(const std::string& comment = "");
+    void idiv(uint32_t src, const std::string& comment = "");
+    void and_op(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void or_op(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void xor_op(uint32_t dst, uint32_t src, const std::string& comment = "");
+    void neg(uint32_t reg, const std::string& comment = "");
+    void not_op(uint32_t reg, const std::string& comment = "");
+    void shl_cl(uint32_t reg, const std::string& comment = "");
+    void shr_cl(uint32_t reg, const std::string& comment = "");
+    void sar_cl(uint32_t reg, const std::string& comment = "");
+    void cmp(uint32_t lhs, uint32_t rhs, const std::string& comment = "");
+    void cmp_imm(uint32_t reg, int32_t imm, const std::string& comment = "");
+    void test(uint32_t lhs, uint32_t rhs, const std::string& comment = "");
+    void setcc(Condition cond, uint32_t reg, const std::string& comment = "");
+    void movzx8(uint32_t dst, uint32_t src, const std::string& comment = "");
+
+    // Control flow
+    void jmp(const std::string& label, const std::string& comment = "");
+    void jcc(Condition cond, const std::string& label, const std::string& comment = "");
+    void call(const std::string& label, const std::string& comment = "");
+    void call_reg(uint32_t reg, const std::string& comment = "");
+    void ret(const std::string& comment = "");
+    void leave(const std::string& comment = "");
+
+    // Helper method to convert register numbers to strings
+    static std::string regName(uint32_t reg);
+    static std::string regName8(uint32_t reg);
+    static std::string regName32(uint32_t reg);
+    static std::string conditionName(Condition cond);
+
+    // Get the address the next instruction will be placed at
+    size_t getCurrentAddress() const;
+
+    /**
+     * Overwrites the trailing 32-bit immediate of an instruction, e.g. the
+     * frame size of a prologue emitted with sub_imm32().
+     */
+    void patchImm32(size_t index, int32_t value);
+
+    /**
+     * Compute addresses for all instructions in the sequence.
+     * @param baseAddress Starting address for the first instruction
+     */
+    void computeAddresses(size_t baseAddress = 0);
+
+    /**
+     * Resolve rel32 references to labels defined in this stream.
+     * Must be called after computeAddresses(). References to undefined
+     * labels are left for the JIT loader.
+     */
+    void resolveAllBranches();
+
+    /**
+     * Encode all instructions to a binary buffer.
+     * @param buffer Output buffer to write encoded instructions to
+     * @param bufferSize Size of the output buffer in bytes
+     * @return Number of bytes written to the buffer
+     */
+    size_t encodeToBuffer(uint8_t* buffer, size_t bufferSize) const;
+
+    void clear();
+    Instruction& at(size_t index);
+    size_t size() const;
+    size_t codeSize() const;
+
+    std::vector<Instruction>& getInstructions() { return instructions; }
+    const std::vector<Instruction>& getInstructions() const { return instructions; }
+
+private:
+    std::vector<Instruction> instructions;
+    size_t codeSize_ = 0;
+
+    void addInstruction(Instruction instr);
+    void emit(std::vector<uint8_t> bytes, const std::string& assembly, const std::string& comment);
+    void emitLabelRef(std::vector<uint8_t> bytes, Fixup fixup, const std::string& label,
+                      const std::string& assembly, const std::string& comment);
+
+    // Encoding helpers
+    static uint8_t rex(bool w, uint32_t reg, uint32_t index, uint32_t base);
+    static void appendMemory(std::vector<uint8_t>& out, uint32_t reg, uint32_t base, int32_t disp);
+    static void appendIndexed(std::vector<uint8_t>& out, uint32_t reg, uint32_t base, uint32_t index, uint32_t scale);
+    static void appendImm32(std::vector<uint8_t>& out, int32_t value);
+    static std::string memoryOperand(uint32_t base, int32_t disp);
+    static std::string indexedOperand(uint32_t base, uint32_t index, uint32_t scale);
+    void aluReg(uint8_t opcode, const char* mnemonic, uint32_t dst, uint32_t src, const std::string& comment);
+    void aluImm(uint32_t ext, const char* mnemonic, uint32_t dst, int32_t imm, bool forceImm32, const std::string& comment);
+    void unary(uint8_t opcode, uint32_t ext, const char* mnemonic, uint32_t reg, const std::string& comment);
+};
+
+#endif // X86_64_INSTRUCTIONS_H
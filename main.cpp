@@ -4,13 +4,19 @@
 #include <string>
 #include <set>
 #include <filesystem>
+#include <chrono>
 #include "Parser.h"
 #include "CodeGenerator.h"
 #include "JitRuntime.h"
 #include "AST.h"
+#include "ASTArena.h"
+#include "SymbolTable.h"
 #include "DebugPrinter.h"
 #include "Preprocessor.h"
 #include "Optimizer.h"
+#include "JITExecutor.h"
+#include "AArch64Simulator.h"
+#include "Target.h"
 
 void printUsage(const char* programName) {
     std::cerr << "Usage: " << programName << " [options] <source_file.b>\n"
@@ -18,6 +24,13 @@ void printUsage(const char* programName) {
               << "  --debug     Print debug information (tokens and AST)\n"
               << "  --asm       Output generated assembly\n"
               << "  --opt       Enable optimization\n"
+              << "  --run       JIT the program into executable memory and run START\n"
+              << "  --sim       With --run, execute under the AArch64 simulator and print statistics\n"
+              << "              (the default on hosts that cannot run AArch64 code)\n"
+              << "  --stats     Print code generator statistics (peephole pattern hits)\n"
+              << "  --jobs=N    With --opt, run the per-function passes on N threads\n"
+              << "              (symbol numbering then depends on scheduling; default 1)\n"
+              << "  --target=T  Generate code for T: aarch64 (default), x86_64, or host\n"
               << "  --help      Display this help message\n";
 }
 
@@ -30,6 +43,8 @@ int main(int argc, char* argv[]) {
     // Parse command line arguments
     std::set<std::string> flags;
     std::string source_filename_str;
+    TargetArch target = TargetArch::AArch64;
+    unsigned jobs = 1;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -37,7 +52,21 @@ int main(int argc, char* argv[]) {
             printUsage(argv[0]);
             return 0;
         }
-        if (arg.rfind("--", 0) == 0) {
+        if (arg.rfind("--target=", 0) == 0) {
+            try {
+                target = parseTarget(arg.substr(9));
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+                return 1;
+            }
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            try {
+                jobs = static_cast<unsigned>(std::stoul(arg.substr(7)));
+            } catch (const std::exception&) {
+                std::cerr << "Error: --jobs expects a number of threads\n";
+                return 1;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
             flags.insert(arg);
         } else {
             source_filename_str = arg;
@@ -52,18 +81,27 @@ int main(int argc, char* argv[]) {
     std::filesystem::path source_filename(source_filename_str);
 
     try {
+        auto compile_start = std::chrono::steady_clock::now();
+
         std::cout << "=== BCPL Compiler ===\n";
-        std::cout << "Source file: " << source_filename << "\n\n";
+        std::cout << "Source file: " << source_filename << "\n";
+        std::cout << "Target: " << targetName(target) << "\n\n";
 
         // Preprocess the source file
         std::cout << "Preprocessing...\n";
-        std::string source_code = Preprocessor::getInstance().process(source_filename);
+        SourceBuffer source = Preprocessor::getInstance().load(source_filename);
+        std::string_view source_code = source.text();
         std::cout << "Preprocessing complete.\n\n";
 
         std::cout << "=== Preprocessed Source Code ===\n";
         std::cout << source_code << "\n";
         std::cout << "==============================\n\n";
 
+        // Every node of this compilation unit lives in one arena, released in bulk
+        // after code generation. Declared first so it outlives the trees below.
+        ASTArena ast_arena;
+        ASTArena::Scope ast_scope(ast_arena);
+
         // Parse source code
         std::cout << "Parsing...\n";
         ProgramPtr ast = Parser::getInstance().parse(source_code);
@@ -73,6 +111,7 @@ int main(int argc, char* argv[]) {
         if (flags.count("--opt")) {
             // Optimize the AST
             std::cout << "Optimizing...\n";
+            Optimizer::getInstance().setThreadCount(jobs);
             optimized_ast = Optimizer::getInstance().optimize(std::move(ast));
             std::cout << "Optimization complete.\n\n";
         } else {
@@ -92,23 +131,76 @@ int main(int argc, char* argv[]) {
         std::cout << "Generating code...\n";
         JitRuntime::getInstance().registerSymbol("bcpl_vec", (uintptr_t)bcpl_vec);
         JitRuntime::getInstance().registerSymbol("bcpl_unpack_string", (uintptr_t)bcpl_unpack_string);
-        JitRuntime::getInstance().registerSymbol("writes", (uintptr_t)bcpl_writes);
-        JitRuntime::getInstance().registerSymbol("writen", (uintptr_t)bcpl_writen);
-        JitRuntime::getInstance().registerSymbol("newline", (uintptr_t)bcpl_newline);
-        JitRuntime::getInstance().registerSymbol("finish", (uintptr_t)bcpl_finish);
+        JitRuntime::getInstance().registerSymbol("writes", (uintptr_t)bcpl_jit_writes);
+        JitRuntime::getInstance().registerSymbol("writen", (uintptr_t)bcpl_jit_writen);
+        JitRuntime::getInstance().registerSymbol("newline", (uintptr_t)bcpl_jit_newline);
+        JitRuntime::getInstance().registerSymbol("finish", (uintptr_t)bcpl_jit_finish);
+        JitRuntime::getInstance().registerSymbol("writef", (uintptr_t)bcpl_jit_writef);
         
-        CodeGenerator codegen;
-        codegen.compile(std::move(optimized_ast));
+        std::unique_ptr<TargetCodeGenerator> codegen = createCodeGenerator(target);
+        codegen->setListingEnabled(flags.count("--asm") != 0);
+        codegen->setIRSelectionEnabled(flags.count("--opt") != 0);
+        uintptr_t entry_offset = codegen->compile(std::move(optimized_ast));
         std::cout << "Code generation complete.\n\n";
 
+        if (flags.count("--stats")) {
+            codegen->printStatistics();
+            std::cout << "AST arena: " << ast_arena.allocationCount() << " nodes, "
+                      << ast_arena.bytesAllocated() << " bytes in "
+                      << ast_arena.chunkCount() << " chunk(s)\n";
+            std::cout << "Symbols: " << SymbolTable::getInstance().size() << " interned identifiers\n";
+            std::cout << "\n";
+        }
+
         // Print assembly if requested
         if (flags.count("--asm")) {
             std::cout << "=== Generated Assembly ===\n";
-            codegen.printAsm();
+            codegen->printAsm();
             std::cout << "\n";
         }
 
         std::cout << "Compilation successful.\n";
+
+        if (flags.count("--run")) {
+            JITExecutor executor;
+            codegen->load(executor, entry_offset);
+            auto entry_time = std::chrono::steady_clock::now();
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(entry_time - compile_start);
+
+            std::cout << "JIT image: " << executor.getImageSize() << " bytes ("
+                      << executor.getCodeSize() << " code, " << executor.getVeneerCount() << " runtime veneers)\n";
+            std::cout << "Compile-to-first-instruction latency: " << latency.count() << " us\n";
+            int64_t result;
+            bool simulate = flags.count("--sim") || !JITExecutor::isNativeHost(target);
+            if (simulate && target != TargetArch::AArch64) {
+                std::cerr << "Error: the simulator only executes AArch64 code; " << targetName(target)
+                          << " code can only run natively on a matching host\n";
+                return 1;
+            }
+            AArch64Simulator simulator;
+            try {
+                if (simulate) {
+                    std::cout << "=== Running START (simulated) ===\n" << std::flush;
+                    simulator.setGlobalPointer(reinterpret_cast<uintptr_t>(executor.getGlobals()));
+                    simulator.protect(reinterpret_cast<uintptr_t>(executor.getImage()), executor.getMappedSize());
+                    result = simulator.run(reinterpret_cast<uintptr_t>(executor.getEntryPoint()));
+                } else {
+                    std::cout << "=== Running START ===\n" << std::flush;
+                    result = executor.run();
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "\n=== Execution Failed ===\n";
+                std::cerr << "Error: " << e.what() << "\n";
+                if (simulate) {
+                    simulator.printStats();
+                }
+                return 1;
+            }
+            std::cout << "\n=== START returned " << result << " ===\n";
+            if (simulate) {
+                simulator.printStats();
+            }
+        }
         return 0;
 
     } catch (const std::exception& e) {
@@ -0,0 +1,283 @@
+#include "AArch64Simulator.h"
+#include "AArch64Instructions.h"
+#include "JITExecutor.h"
+#include "JitRuntime.h"
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Test the AArch64 simulator against small hand-written programs.
+ * This test validates that:
+ * 1. Arithmetic, compare and branch instructions execute correctly
+ * 2. Retired-instruction, branch and memory-access counts are exact
+ * 3. Stack loads/stores (str/ldr/stp/ldp) round-trip through guest memory
+ * 4. Calls through JIT veneers reach JitRuntime symbols natively
+ * 5. Far calls reach their target through the veneers branch relaxation inserts
+ * 6. GLOBALs are read and written through x28, set by the simulator or the entry trampoline
+ * 7. Stores into protected memory and accesses to the null page fault with the guest PC
+ */
+
+using A = AArch64Instructions;
+
+static std::vector<uint32_t> assemble(A& instructions) {
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+    std::vector<uint32_t> code(instructions.size());
+    instructions.encodeToBuffer(reinterpret_cast<uint8_t*>(code.data()), code.size() * 4);
+    return code;
+}
+
+extern "C" int64_t test_host_triple(int64_t n) {
+    return n * 3;
+}
+
+void testLoopAndCounts() {
+    std::cout << "\n=== Testing Loop Execution and Counters ===\n";
+
+    // x0 = 10 + 9 + ... + 1
+    A instructions;
+    instructions.movz(A::X0, 0, 0);
+    instructions.movz(A::X1, 10, 0);
+    instructions.setPendingLabel("loop");
+    instructions.add(A::X0, A::X0, A::X1, A::LSL, 0);
+    instructions.sub_imm(A::X1, A::X1, 1, "");
+    instructions.cmp(A::X1, A::XZR);
+    instructions.bne("loop");
+    instructions.ret();
+    auto code = assemble(instructions);
+
+    AArch64Simulator sim;
+    int64_t result = sim.run(reinterpret_cast<uintptr_t>(code.data()));
+    const auto& stats = sim.getStats();
+
+    assert(result == 55);
+    assert(stats.instructions == 2 + 10 * 4 + 1);
+    assert(stats.branches == 11);
+    assert(stats.takenBranches == 10);
+    assert(stats.memoryAccesses() == 0);
+
+    std::cout << "  Result: " << result << ", instructions: " << stats.instructions << "\n";
+    std::cout << "✓ Loop execution test passed\n";
+}
+
+void testArithmetic() {
+    std::cout << "\n=== Testing Arithmetic and Conditional Set ===\n";
+
+    A instructions;
+    instructions.loadImmediate(A::X1, 47);
+    instructions.loadImmediate(A::X2, 5);
+    instructions.sdiv(A::X3, A::X1, A::X2);          // 9
+    instructions.msub(A::X4, A::X3, A::X2, A::X1);   // 47 - 9*5 = 2
+    instructions.mul(A::X5, A::X4, A::X3);           // 18
+    instructions.cmp(A::X5, A::X3);
+    instructions.cset(A::X6, A::GT);                 // 1
+    instructions.neg(A::X6, A::X6);                  // -1 (BCPL TRUE)
+    instructions.eor(A::X0, A::X5, A::X6);           // ~18
+    instructions.ret();
+    auto code = assemble(instructions);
+
+    AArch64Simulator sim;
+    int64_t result = sim.run(reinterpret_cast<uintptr_t>(code.data()));
+    assert(sim.getRegister(A::X3) == 9);
+    assert(sim.getRegister(A::X4) == 2);
+    assert(sim.getRegister(A::X5) == 18);
+    assert(static_cast<int64_t>(sim.getRegister(A::X6)) == -1);
+    assert(result == ~int64_t(18));
+
+    std::cout << "✓ Arithmetic test passed\n";
+}
+
+void testStackFrame() {
+    std::cout << "\n=== Testing Stack Frame Loads and Stores ===\n";
+
+    A instructions;
+    instructions.sub_imm(A::SP, A::SP, 32, "");
+    instructions.stp(A::X29, A::X30, A::SP, 16);
+    instructions.mov(A::X29, A::SP);
+    instructions.loadImmediate(A::X1, 1234);
+    instructions.str(A::X1, A::X29, 8);
+    instructions.str(A::X1, A::X29, -8);             // Unscaled (STUR) form
+    instructions.ldr(A::X2, A::X29, 8);
+    instructions.ldr(A::X3, A::X29, -8);
+    instructions.add(A::X0, A::X2, A::X3, A::LSL, 0);
+    instructions.ldp(A::X29, A::X30, A::SP, 16);
+    instructions.add(A::SP, A::SP, 32);
+    instructions.ret();
+    auto code = assemble(instructions);
+
+    AArch64Simulator sim;
+    uint64_t initialSP = 0;
+    int64_t result = sim.run(reinterpret_cast<uintptr_t>(code.data()));
+    initialSP = sim.getSP();
+    assert(result == 2468);
+    assert(sim.getStats().stores == 3);
+    assert(sim.getStats().loads == 3);
+    assert(initialSP % 16 == 0);
+
+    std::cout << "✓ Stack frame test passed\n";
+}
+
+void testRuntimeCall() {
+    std::cout << "\n=== Testing Runtime Calls Through Veneers ===\n";
+
+    JitRuntime::getInstance().registerSymbol("triple", reinterpret_cast<uintptr_t>(test_host_triple));
+
+    A instructions;
+    instructions.setPendingLabel("START");
+    instructions.sub_imm(A::SP, A::SP, 16, "");
+    instructions.stp(A::X29, A::X30, A::SP, 0);
+    instructions.loadImmediate(A::X0, 14);
+    instructions.bl("triple");
+    instructions.ldp(A::X29, A::X30, A::SP, 0);
+    instructions.add(A::SP, A::SP, 16);
+    instructions.ret();
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+
+    JITExecutor executor;
+    void* entry = executor.load(instructions, {}, 0, 0);
+    assert(executor.getVeneerCount() == 1);
+
+    AArch64Simulator sim;
+    int64_t result = sim.run(reinterpret_cast<uintptr_t>(entry));
+    assert(result == 42);
+    assert(sim.getStats().runtimeCalls == 1);
+
+    std::cout << "✓ Runtime call test passed\n";
+}
+
+void testFarCallVeneer() {
+    std::cout << "\n=== Testing Calls Through Relaxation Veneers ===\n";
+
+    // With a 12-bit call field, F is out of reach and START calls it through a veneer
+    A instructions;
+    instructions.setPendingLabel("START");
+    instructions.sub_imm(A::SP, A::SP, 16, "");
+    instructions.stp(A::X29, A::X30, A::SP, 0);
+    instructions.bl("F");
+    instructions.ldp(A::X29, A::X30, A::SP, 0);
+    instructions.add(A::SP, A::SP, 16);
+    instructions.ret();
+    for (int i = 0; i < 5000; i++) {
+        instructions.nop();
+    }
+    instructions.setPendingLabel("F");
+    instructions.loadImmediate(A::X0, 42);
+    instructions.ret();
+    auto relaxation = instructions.relaxBranches(12);
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+    assert(relaxation.veneers == 1);
+
+    // JIT memory is page aligned, as the veneer's adrp requires
+    JITExecutor executor;
+    void* entry = executor.load(instructions, {}, 0, 0);
+
+    AArch64Simulator sim;
+    int64_t result = sim.run(reinterpret_cast<uintptr_t>(entry));
+    assert(result == 42);
+    assert(sim.getStats().instructions == 11); // Including adrp, add and br x16
+
+    std::cout << "✓ Far call veneer test passed\n";
+}
+
+void testGlobalVector() {
+    std::cout << "\n=== Testing the Global Vector ===\n";
+
+    // G1 := G1 + 5; RESULTIS G1
+    A instructions;
+    instructions.setPendingLabel("START");
+    instructions.ldr(A::X0, A::X28, 8);
+    instructions.add(A::X0, A::X0, 5);
+    instructions.str(A::X0, A::X28, 8);
+    instructions.ret();
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+
+    JITExecutor executor;
+    void* entry = executor.load(instructions, {}, 0, 2);
+    executor.getGlobals()[1] = 10;
+
+    AArch64Simulator sim;
+    sim.setGlobalPointer(reinterpret_cast<uintptr_t>(executor.getGlobals()));
+    assert(sim.run(reinterpret_cast<uintptr_t>(entry)) == 15);
+    assert(executor.getGlobals()[1] == 15);
+    std::cout << "✓ Global read/write test passed\n";
+
+    // The trampoline native runs enter through sets x28 itself and restores it
+    AArch64Simulator bare;
+    assert(bare.run(reinterpret_cast<uintptr_t>(executor.getNativeEntryPoint())) == 20);
+    assert(executor.getGlobals()[1] == 20);
+    assert(bare.getRegister(28) == 0);
+    assert(bare.getSP() % 16 == 0);
+    std::cout << "✓ Entry trampoline test passed\n";
+}
+
+// Runs code expected to fault and returns the simulator's message
+static std::string faultOf(AArch64Simulator& sim, const std::vector<uint32_t>& code) {
+    try {
+        sim.run(reinterpret_cast<uintptr_t>(code.data()));
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    throw std::runtime_error("Expected a simulator fault");
+}
+
+void testMemoryFaults() {
+    std::cout << "\n=== Testing Memory Faults ===\n";
+
+    // Overwrite the first instruction, as a store into a string literal in the image would
+    A instructions;
+    instructions.setPendingLabel("start");
+    instructions.adr(A::X1, "start");
+    instructions.movz(A::X2, 42, 0);
+    instructions.str(A::X2, A::X1, 0);
+    instructions.ret();
+    auto code = assemble(instructions);
+    const uint32_t first = code[0];
+
+    AArch64Simulator sim;
+    sim.protect(reinterpret_cast<uintptr_t>(code.data()), code.size() * 4);
+    std::string message = faultOf(sim, code);
+    assert(message.find("store to read-only memory") != std::string::npos);
+    assert(sim.getPC() == reinterpret_cast<uintptr_t>(&code[2]));
+    assert(code[0] == first);
+    std::cout << "  " << message << "\n";
+
+    // A store through a null pointer
+    A null;
+    null.movz(A::X1, 0, 0);
+    null.str(A::X1, A::X1, 16);
+    null.ret();
+    auto nullCode = assemble(null);
+    AArch64Simulator bare;
+    message = faultOf(bare, nullCode);
+    assert(message.find("store out of bounds") != std::string::npos);
+    assert(bare.getPC() == reinterpret_cast<uintptr_t>(&nullCode[1]));
+    std::cout << "✓ Memory fault test passed\n";
+}
+
+int main() {
+    std::cout << "AArch64 Simulator Test Suite\n";
+    std::cout << "============================\n";
+
+    try {
+        testLoopAndCounts();
+        testArithmetic();
+        testStackFrame();
+        testRuntimeCall();
+        testFarCallVeneer();
+        testGlobalVector();
+        testMemoryFaults();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
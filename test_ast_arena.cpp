@@ -0,0 +1,137 @@
+#include "ASTArena.h"
+#include "Parser.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+/**
+ * Test the AST arena.
+ * This test validates that:
+ * 1. Nodes parsed inside a scope are bump-allocated from the arena
+ * 2. Nodes made outside any scope still come from the heap, and trees may mix both
+ * 3. Scopes nest and restore the enclosing arena
+ * 4. reset() releases every chunk at once and the arena can be reused
+ */
+
+static const char* SOURCE =
+    "LET F(N) = VALOF $(\n"
+    "    LET S = 0\n"
+    "    FOR I = 1 TO N DO S := S + I * 2\n"
+    "    RESULTIS S\n"
+    "$)\n"
+    "LET START() = F(10)\n";
+
+void testParseIntoArena() {
+    std::cout << "\n=== Testing Parsing Into an Arena ===\n";
+
+    ASTArena arena(1024);
+    {
+        ASTArena::Scope scope(arena);
+        ProgramPtr program = Parser::getInstance().parse(SOURCE);
+        assert(arena.contains(program.get()));
+        for (const auto& decl : program->declarations) {
+            assert(arena.contains(decl.get()));
+        }
+        // Each node is one bump allocation; a small tree spans a few chunks
+        assert(arena.allocationCount() > 20);
+        assert(arena.chunkCount() >= 2);
+        assert(arena.bytesAllocated() <= arena.chunkCount() * 1024);
+
+        // Consecutive allocations are laid out contiguously
+        ExprPtr a = std::make_unique<NumberLiteral>(1);
+        ExprPtr b = std::make_unique<NumberLiteral>(2);
+        assert(reinterpret_cast<char*>(b.get()) > reinterpret_cast<char*>(a.get()));
+        assert(reinterpret_cast<char*>(b.get()) - reinterpret_cast<char*>(a.get()) < 256);
+    }
+    assert(ASTArena::current() == nullptr);
+
+    std::cout << "  " << arena.allocationCount() << " nodes, " << arena.bytesAllocated()
+              << " bytes in " << arena.chunkCount() << " chunks\n";
+    std::cout << "✓ Parse into arena test passed\n";
+}
+
+void testMixedTrees() {
+    std::cout << "\n=== Testing Mixed Arena and Heap Trees ===\n";
+
+    ASTArena arena;
+    ProgramPtr program;
+    {
+        ASTArena::Scope scope(arena);
+        program = Parser::getInstance().parse(SOURCE);
+    }
+
+    // Clones made after the scope ends live on the heap
+    ProgramPtr copy(static_cast<Program*>(program->clone().release()));
+    assert(!arena.contains(copy.get()));
+    assert(!arena.contains(copy->declarations[0].get()));
+
+    // A heap subtree grafted into an arena tree is freed normally with it
+    program->declarations.push_back(std::move(copy->declarations[0]));
+    copy.reset();
+    program.reset();
+    assert(arena.chunkCount() == 1);
+
+    std::cout << "✓ Mixed tree test passed\n";
+}
+
+void testNestedScopesAndReset() {
+    std::cout << "\n=== Testing Nested Scopes and Reset ===\n";
+
+    ASTArena unit;
+    ASTArena function;
+    {
+        ASTArena::Scope outer(unit);
+        ExprPtr first = std::make_unique<VariableAccess>("A");
+        {
+            ASTArena::Scope inner(function);
+            assert(ASTArena::current() == &function);
+            ExprPtr second = std::make_unique<VariableAccess>("B");
+            assert(function.contains(second.get()));
+            assert(!unit.contains(second.get()));
+        }
+        assert(ASTArena::current() == &unit);
+        ExprPtr third = std::make_unique<VariableAccess>("C");
+        assert(unit.contains(first.get()));
+        assert(unit.contains(third.get()));
+    }
+
+    // All nodes are gone, so the function's memory can go in one step
+    function.reset();
+    assert(function.chunkCount() == 0);
+    assert(function.allocationCount() == 0);
+
+    // A reset arena hands out memory again
+    {
+        ASTArena::Scope scope(function);
+        ExprPtr again = std::make_unique<NumberLiteral>(7);
+        assert(function.contains(again.get()));
+        assert(function.chunkCount() == 1);
+    }
+
+    // Requests larger than a chunk get a chunk of their own
+    ASTArena small(64);
+    void* big = small.allocate(1000);
+    assert(small.contains(big));
+    assert(small.contains(static_cast<char*>(big) + 999));
+    assert(small.chunkCount() == 1);
+
+    std::cout << "✓ Nested scope and reset test passed\n";
+}
+
+int main() {
+    std::cout << "AST Arena Test Suite\n";
+    std::cout << "====================\n";
+
+    try {
+        testParseIntoArena();
+        testMixedTrees();
+        testNestedScopesAndReset();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
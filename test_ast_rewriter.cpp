@@ -0,0 +1,239 @@
+#include "ASTRewriter.h"
+#include "ASTMutator.h"
+#include "ConstantFoldingPass.h"
+#include "Parser.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+/**
+ * Test kind-tagged AST dispatch.
+ * This test validates that:
+ * 1. Every node reports its kind, and nodeCast matches dynamic_cast for concrete and abstract classes
+ * 2. An ASTRewriter that overrides one node rewrites it everywhere and rebuilds the rest
+ * 3. Rewriting leaves the source tree untouched
+ * 4. An ASTMutator replaces only the nodes it rewrites and keeps the rest of the tree
+ * 5. Passes edit the program in place and report whether they changed it
+ */
+
+static const char* SOURCE =
+    "GLOBAL $( G : 200 $)\n"
+    "LET F(S, N) = VALOF $(\n"
+    "    LET T = S % N + 1\n"
+    "    FOR I = 1 TO N DO T := T + I\n"
+    "    RESULTIS N > 0 -> T, 0\n"
+    "$)\n";
+
+// Renames every variable and counts how many it saw
+class RenamingRewriter : public ASTRewriter<RenamingRewriter> {
+public:
+    using ASTRewriter<RenamingRewriter>::visit;
+
+    ExprPtr visit(VariableAccess* node) {
+        ++renamed;
+        return std::make_unique<VariableAccess>(node->name + "_");
+    }
+
+    int renamed = 0;
+};
+
+// Records variable names while copying the tree unchanged
+class NameCollector : public ASTRewriter<NameCollector> {
+public:
+    using ASTRewriter<NameCollector>::visit;
+
+    ExprPtr visit(VariableAccess* node) {
+        names += node->name + " ";
+        return node->cloneExpr();
+    }
+
+    std::string names;
+};
+
+// Replaces every literal 1 with a 2, editing the tree in place
+class OneToTwo : public ASTMutator<OneToTwo> {
+public:
+    using ASTMutator<OneToTwo>::mutate;
+    using ASTMutator<OneToTwo>::rewrite;
+
+    ExprPtr rewrite(NumberLiteral* node) {
+        if (node->value != 1) return nullptr;
+        ++replaced;
+        return std::make_unique<NumberLiteral>(2);
+    }
+
+    int replaced = 0;
+};
+
+void testKindsAndCasts() {
+    std::cout << "\n=== Testing Node Kinds and nodeCast ===\n";
+
+    ExprPtr number = std::make_unique<NumberLiteral>(3);
+    ExprPtr binary = std::make_unique<BinaryOp>(TokenType::OpPlus, number->cloneExpr(), std::make_unique<VariableAccess>("X"));
+    StmtPtr finish = std::make_unique<FinishStatement>();
+    DeclPtr let = std::make_unique<LetDeclaration>(std::vector<LetDeclaration::VarInit>{});
+
+    assert(number->kind() == NodeKind::NumberLiteral);
+    assert(binary->kind() == NodeKind::BinaryOp);
+    assert(finish->kind() == NodeKind::FinishStatement);
+    assert(let->kind() == NodeKind::LetDeclaration);
+
+    // Copies keep their kind
+    assert(number->cloneExpr()->kind() == NodeKind::NumberLiteral);
+
+    assert(nodeCast<NumberLiteral>(number.get()) == number.get());
+    assert(nodeCast<BinaryOp>(number.get()) == nullptr);
+    assert(nodeCast<NumberLiteral>(static_cast<Expression*>(nullptr)) == nullptr);
+
+    // Abstract bases match their whole range
+    const Node* nodes[] = {number.get(), binary.get(), finish.get(), let.get()};
+    for (const Node* node : nodes) {
+        assert((nodeCast<Expression>(node) != nullptr) == (dynamic_cast<const Expression*>(node) != nullptr));
+        assert((nodeCast<Statement>(node) != nullptr) == (dynamic_cast<const Statement*>(node) != nullptr));
+        assert((nodeCast<Declaration>(node) != nullptr) == (dynamic_cast<const Declaration*>(node) != nullptr));
+    }
+    assert(isNode<Statement>(finish.get()) && !isNode<Expression>(finish.get()));
+
+    std::cout << "✓ Kind and cast test passed\n";
+}
+
+void testRewriter() {
+    std::cout << "\n=== Testing ASTRewriter ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(SOURCE);
+    assert(program->declarations.size() == 2);
+
+    RenamingRewriter rewriter;
+    ProgramPtr rewritten = rewriter.visit(program.get());
+
+    // Every variable read in the body is renamed
+    NameCollector before;
+    before.visit(program.get());
+    NameCollector after;
+    after.visit(rewritten.get());
+    std::cout << "  renamed " << rewriter.renamed << " variables\n";
+    assert(rewriter.renamed >= 7);
+    assert(after.names.find("T_") != std::string::npos);
+    assert(before.names.find("_") == std::string::npos);
+
+    // GLOBAL declarations are dropped; the function is rebuilt around the renamed variables
+    assert(rewritten->declarations.size() == 1);
+    auto* function = nodeCast<FunctionDeclaration>(rewritten->declarations[0].get());
+    assert(function && function->name == "F");
+    assert(function->params.size() == 2);
+
+    auto* valof = nodeCast<Valof>(function->body_expr.get());
+    assert(valof);
+    auto* body = nodeCast<CompoundStatement>(valof->body.get());
+    assert(body && body->statements.size() == 3);
+
+    auto* decl = nodeCast<DeclarationStatement>(body->statements[0].get());
+    assert(decl);
+    auto* let = nodeCast<LetDeclaration>(decl->declaration.get());
+    assert(let && let->initializers[0].name == "T");
+    auto* sum = nodeCast<BinaryOp>(let->initializers[0].init.get());
+    assert(sum);
+    auto* access = nodeCast<CharacterAccess>(sum->left.get());
+    assert(access);
+    assert(nodeCast<VariableAccess>(access->string.get())->name == "S_");
+    assert(nodeCast<VariableAccess>(access->index.get())->name == "N_");
+
+    // The original tree is left as it was
+    auto* original = nodeCast<FunctionDeclaration>(program->declarations[1].get());
+    assert(original && original != function);
+
+    std::cout << "✓ Rewriter test passed\n";
+}
+
+void testMutator() {
+    std::cout << "\n=== Testing ASTMutator ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(SOURCE);
+    auto* function = nodeCast<FunctionDeclaration>(program->declarations[1].get());
+    auto* valof = nodeCast<Valof>(function->body_expr.get());
+    auto* body = nodeCast<CompoundStatement>(valof->body.get());
+    Node* letStatement = body->statements[0].get();
+    auto* loop = nodeCast<ForStatement>(body->statements[1].get());
+    auto* increment = nodeCast<Assignment>(loop->body.get());
+    assert(increment);
+    Expression* step = increment->rhs[0].get();
+
+    OneToTwo mutator;
+    mutator.mutate(program.get());
+
+    // FOR I = 1 and T := ... + 1 both change; nothing else is reallocated
+    assert(mutator.replaced == 2);
+    assert(mutator.hasMutated());
+    assert(program->declarations.size() == 2);
+    assert(program->declarations[1].get() == function);
+    assert(function->body_expr.get() == valof);
+    assert(valof->body.get() == body);
+    assert(body->statements[0].get() == letStatement);
+    assert(body->statements[1].get() == loop);
+    assert(loop->body.get() == increment && increment->rhs[0].get() == step);
+    assert(nodeCast<NumberLiteral>(loop->from_expr.get())->value == 2);
+
+    auto* let = nodeCast<LetDeclaration>(nodeCast<DeclarationStatement>(letStatement)->declaration.get());
+    auto* sum = nodeCast<BinaryOp>(let->initializers[0].init.get());
+    assert(nodeCast<NumberLiteral>(sum->right.get())->value == 2);
+
+    // A second walk finds nothing left to replace
+    mutator.resetMutated();
+    mutator.mutate(program.get());
+    assert(mutator.replaced == 2 && !mutator.hasMutated());
+
+    std::cout << "✓ Mutator test passed\n";
+}
+
+void testPassChanges() {
+    std::cout << "\n=== Testing In-Place Passes ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(X) = VALOF $(\n"
+        "    LET A = 2 * 3\n"
+        "    RESULTIS X * 2 + A\n"
+        "$)\n");
+    Program* root = program.get();
+    auto* function = nodeCast<FunctionDeclaration>(root->declarations[0].get());
+    auto* body = nodeCast<CompoundStatement>(nodeCast<Valof>(function->body_expr.get())->body.get());
+    auto* result = nodeCast<ResultisStatement>(body->statements[1].get());
+    Expression* sum = result->value.get();
+
+    SymbolMap<int64_t> manifests;
+    ConstantFoldingPass folding(manifests);
+    program = folding.apply(std::move(program));
+    assert(folding.hasChanged());
+    assert(program.get() == root);
+    assert(body->statements[1].get() == result);
+    assert(result->value.get() == sum);
+
+    // 2 * 3 is folded, X * 2 becomes a shift in place
+    auto* let = nodeCast<LetDeclaration>(nodeCast<DeclarationStatement>(body->statements[0].get())->declaration.get());
+    assert(nodeCast<NumberLiteral>(let->initializers[0].init.get())->value == 6);
+    auto* shift = nodeCast<BinaryOp>(nodeCast<BinaryOp>(sum)->left.get());
+    assert(shift && shift->op == TokenType::OpLshift);
+
+    program = folding.apply(std::move(program));
+    assert(!folding.hasChanged());
+
+    std::cout << "✓ In-place pass test passed\n";
+}
+
+int main() {
+    std::cout << "AST Dispatch Test Suite\n";
+    std::cout << "=======================\n";
+
+    try {
+        testKindsAndCasts();
+        testRewriter();
+        testMutator();
+        testPassChanges();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "CFGBuilder.h"
+#include "Parser.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+/**
+ * Test the index-based control flow graph.
+ * This test validates that:
+ * 1. Edges are kept once each, inline or spilled past the inline capacity
+ * 2. Reverse postorder covers exactly the reachable blocks, entry first
+ * 3. Immediate dominators and post-dominators match a hand-built graph
+ * 4. Cached orders are recomputed after the graph changes
+ * 5. CFGBuilder links GOTOs to their labels and flags jumps it cannot follow
+ */
+
+void testEdges() {
+    std::cout << "\n=== Testing Edges ===\n";
+
+    ControlFlowGraph cfg;
+    BlockId a = cfg.createBlock();
+    cfg.addEdge(cfg.entry(), a);
+    cfg.addEdge(cfg.entry(), a);
+    cfg.addEdge(NoBlock, a);
+    assert(cfg.block(cfg.entry()).successors.size() == 1);
+    assert(cfg.block(a).predecessors.size() == 1);
+
+    // A switch-like block with more successors than fit inline
+    for (int i = 0; i < 5; ++i) {
+        cfg.addEdge(a, cfg.createBlock());
+    }
+    assert(cfg.block(a).successors.size() == 5);
+    assert(cfg.block(a).successors[0] == 2);
+    assert(cfg.block(a).successors[4] == 6);
+    assert(cfg.block(a).successors.contains(4));
+    std::cout << "✓ Edge test passed\n";
+}
+
+void testOrders() {
+    std::cout << "\n=== Testing Orders and Dominators ===\n";
+
+    // 0 -> {1, 2} -> 3 -> 4 -> {3, 5}; block 6 is unreachable
+    ControlFlowGraph cfg;
+    for (int i = 1; i <= 6; ++i) {
+        cfg.createBlock();
+    }
+    cfg.addEdge(0, 1);
+    cfg.addEdge(0, 2);
+    cfg.addEdge(1, 3);
+    cfg.addEdge(2, 3);
+    cfg.addEdge(3, 4);
+    cfg.addEdge(4, 3);
+    cfg.addEdge(4, 5);
+    cfg.addEdge(6, 5);
+
+    assert((cfg.reversePostorder() == std::vector<BlockId>{0, 2, 1, 3, 4, 5}));
+    assert(cfg.rpoIndex(3) == 3);
+    assert(!cfg.isReachable(6));
+
+    assert(cfg.idom(0) == NoBlock);
+    assert(cfg.idom(1) == 0 && cfg.idom(2) == 0 && cfg.idom(3) == 0);
+    assert(cfg.idom(4) == 3 && cfg.idom(5) == 4);
+    assert(cfg.idom(6) == NoBlock);
+    assert(cfg.dominates(3, 5));
+    assert(cfg.dominates(0, 0));
+    assert(!cfg.dominates(1, 3));
+    std::cout << "✓ Dominator test passed\n";
+
+    assert(cfg.ipdom(0) == 3 && cfg.ipdom(1) == 3 && cfg.ipdom(2) == 3);
+    assert(cfg.ipdom(3) == 4 && cfg.ipdom(4) == 5);
+    assert(cfg.ipdom(5) == NoBlock);
+    assert(cfg.postDominates(3, 0));
+    assert(!cfg.postDominates(1, 0));
+    assert(cfg.postDominatorOrder().front() == 5);
+    assert(cfg.postDominatorOrder().size() == 6);
+    std::cout << "✓ Post-dominator test passed\n";
+
+    // Give 2 its own path to the exit; 3 no longer post-dominates the entry
+    cfg.addEdge(2, 5);
+    assert(cfg.ipdom(0) == 5);
+    assert(!cfg.postDominates(3, 0));
+    assert(cfg.idom(5) == 0);
+    std::cout << "✓ Cache invalidation test passed\n";
+}
+
+void testBuilder() {
+    std::cout << "\n=== Testing CFG Construction ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(N) = VALOF $(\n"
+        "    LET S = 0\n"
+        "    WHILE N > 0 DO $(\n"
+        "        S := S + N\n"
+        "        N := N - 1\n"
+        "    $)\n"
+        "    GOTO done\n"
+        "    S := 0\n"
+        "done:\n"
+        "    RESULTIS S\n"
+        "$)\n"
+        "LET G(N) = VALOF $(\n"
+        "    GOTO N\n"
+        "    RESULTIS 0\n"
+        "$)\n");
+
+    CFGBuilder builder;
+    builder.build(program);
+    const auto& cfgs = builder.getFunctionCFGs();
+    const ControlFlowGraph& f = cfgs.at("F");
+
+    // entry, loop header, loop body, loop exit, the skipped write, label
+    assert(f.size() == 6);
+    assert(f.isStructured());
+    assert(f.reversePostorder().size() == 5);
+    const BlockId header = f.block(f.entry()).successors[0];
+    const BlockId body = f.block(header).successors[0];
+    assert(f.dominates(header, body));
+    assert(f.idom(body) == header);
+    assert(f.block(body).successors[0] == header);
+
+    // The labelled block is reached only by the GOTO and post-dominates the loop
+    const BlockId exit = f.block(header).successors[1];
+    const BlockId label = f.block(exit).successors[0];
+    assert(f.block(label).statements.size() == 1);
+    assert(f.postDominates(label, header));
+    assert(f.idom(label) == exit);
+    std::cout << "✓ Loop and GOTO test passed\n";
+
+    // A GOTO through a variable has no edge the builder can add
+    assert(!cfgs.at("G").isStructured());
+    std::cout << "✓ Unstructured flow test passed\n";
+}
+
+int main() {
+    std::cout << "Control Flow Graph Test Suite\n";
+    std::cout << "=============================\n";
+
+    try {
+        testEdges();
+        testOrders();
+        testBuilder();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
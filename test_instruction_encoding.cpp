@@ -1,8 +1,10 @@
 #include "AArch64Instructions.h"
+#include "AArch64Disassembler.h"
 #include <iostream>
 #include <iomanip>
 #include <cassert>
 #include <cstring>
+#include <stdexcept>
 
 /**
  * Test basic instruction encoding functionality.
@@ -11,6 +13,9 @@
  * 2. Address computation works correctly
  * 3. Branch resolution updates encodings properly
  * 4. Full buffer encoding produces correct machine code
+ * 5. The disassembler renders every emitted form, and comments are only kept, or formatted, on request
+ * 6. Label handles resolve in one pass, with duplicate definitions and range overflows rejected
+ * 7. Branch relaxation rewrites out-of-range conditional branches and routes far calls through veneers
  */
 
 void printBytes(const uint8_t* buffer, size_t size) {
@@ -71,14 +76,14 @@ void testAddressComputation() {
     instructions.computeAddresses(0x1000);
     
     // Verify addresses
-    assert(instructions.at(0).address == 0x1000);
-    assert(instructions.at(1).address == 0x1004);
-    assert(instructions.at(2).address == 0x1008);
+    assert(instructions.addressOf(0) == 0x1000);
+    assert(instructions.addressOf(1) == 0x1004);
+    assert(instructions.addressOf(2) == 0x1008);
     
     std::cout << "✓ Address computation test passed\n";
-    std::cout << "  Instruction 0 address: 0x" << std::hex << instructions.at(0).address << "\n";
-    std::cout << "  Instruction 1 address: 0x" << std::hex << instructions.at(1).address << "\n";
-    std::cout << "  Instruction 2 address: 0x" << std::hex << instructions.at(2).address << "\n";
+    std::cout << "  Instruction 0 address: 0x" << std::hex << instructions.addressOf(0) << "\n";
+    std::cout << "  Instruction 1 address: 0x" << std::hex << instructions.addressOf(1) << "\n";
+    std::cout << "  Instruction 2 address: 0x" << std::hex << instructions.addressOf(2) << "\n";
 }
 
 void testBranchResolution() {
@@ -107,15 +112,300 @@ void testBranchResolution() {
     // Print instruction details
     for (size_t i = 0; i < instructions.size(); i++) {
         const auto& instr = instructions.at(i);
-        std::cout << "  [" << i << "] 0x" << std::hex << instr.address << ": " 
-                  << instr.assembly;
-        if (instr.hasLabel) {
-            std::cout << " (label: " << instr.label << ")";
+        std::cout << "  [" << i << "] 0x" << std::hex << instructions.addressOf(i) << ": " 
+                  << instructions.disassemble(instr);
+        if (instr.hasLabel()) {
+            std::cout << " (label: " << instructions.labelName(instr.label) << ")";
         }
         std::cout << "\n";
     }
 }
 
+void testJumpTableEncoding() {
+    std::cout << "\n=== Testing Jump Table Encoding ===\n";
+
+    AArch64Instructions instructions;
+
+    // Bounds check and computed jump through a table of branches
+    instructions.cmp_imm(AArch64Instructions::X0, 2, "Jump table bounds");
+    instructions.bhi("default");
+    instructions.adr(9, "table");
+    instructions.add(9, 9, AArch64Instructions::X0, AArch64Instructions::LSL, 2);
+    instructions.br(9);
+    instructions.setPendingLabel("table");
+    instructions.b("case0");
+    instructions.b("default");
+    instructions.b("case2");
+    instructions.setPendingLabel("case0");
+    instructions.setPendingLabel("case2"); // Two labels at one address
+    instructions.setPendingLabel("default");
+    instructions.ret();
+
+    instructions.computeAddresses(0x3000);
+    instructions.resolveAllBranches();
+
+    assert(instructions.at(0).encoding == 0xF100081F);       // cmp x0, #2
+    assert(instructions.at(1).encoding == (0x54000000 | (9 << 5) | 0b1000));  // b.hi +36
+    assert(instructions.at(2).encoding == (0x10000009 | (3 << 5)));  // adr x9, +12
+    assert(instructions.at(4).encoding == 0xD61F0120);       // br x9
+
+    // Each label keeps its own address; the earlier ones sit on NOPs
+    assert(instructions.size() == 11);
+    assert(instructions.at(8).encoding == 0xD503201F && instructions.labelName(instructions.at(8).label) == "case0");
+    assert(instructions.at(9).encoding == 0xD503201F && instructions.labelName(instructions.at(9).label) == "case2");
+    assert(instructions.labelName(instructions.at(10).label) == "default");
+    assert(instructions.at(5).encoding == (0x14000000 | 3));  // b case0
+    assert(instructions.at(6).encoding == (0x14000000 | 4));  // b default
+    assert(instructions.at(7).encoding == (0x14000000 | 2));  // b case2
+
+    bool rejected = false;
+    try {
+        instructions.cmp_imm(AArch64Instructions::X0, 4096);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    std::cout << "✓ Jump table encoding test passed\n";
+}
+
+void testConditionEncoding() {
+    std::cout << "\n=== Testing Condition Encoding ===\n";
+
+    AArch64Instructions instructions;
+    instructions.csetm(AArch64Instructions::X0, AArch64Instructions::LT);
+    instructions.mvn(AArch64Instructions::X0, AArch64Instructions::X1);
+    instructions.cbz(AArch64Instructions::X0, "end");
+    instructions.cbnz(AArch64Instructions::X1, "end");
+    instructions.tbnz(AArch64Instructions::X0, 63, "end");
+    instructions.tbz(AArch64Instructions::X2, 3, "end");
+    instructions.bcond(AArch64Instructions::LE, "end");
+    instructions.setPendingLabel("end");
+    instructions.ret();
+
+    instructions.computeAddresses(0);
+    instructions.resolveAllBranches();
+
+    assert(instructions.at(0).encoding == 0xDA9FA3E0);               // csetm x0, lt
+    assert(instructions.disassemble(instructions.at(0)) == "csetm x0, lt");
+    assert(instructions.at(1).encoding == 0xAA2103E0);               // mvn x0, x1
+    assert(instructions.at(2).encoding == (0xB4000000 | (5 << 5)));  // cbz x0 (64-bit), +20
+    assert(instructions.at(3).encoding == (0xB5000001 | (4 << 5)));  // cbnz x1, +16
+    assert(instructions.at(4).encoding == (0xB7F80000 | (3 << 5)));  // tbnz x0, #63, +12
+    assert(instructions.at(5).encoding == (0x36180002 | (2 << 5)));  // tbz x2, #3, +8
+    assert(instructions.at(6).encoding == (0x5400000D | (1 << 5)));  // b.le +4
+    assert(instructions.disassemble(instructions.at(6)) == "b.le end");
+
+    std::cout << "✓ Condition encoding test passed\n";
+}
+
+void testDisassembly() {
+    std::cout << "\n=== Testing Disassembly ===\n";
+
+    using A = AArch64Instructions;
+    A instructions;
+    instructions.setPendingLabel("top");
+    instructions.mov(A::X0, A::X1);
+    instructions.mov(A::X29, A::SP);
+    instructions.movz(A::X2, 0x1234, 1);
+    instructions.movk(A::X2, 0xBEEF, 0);
+    instructions.add(A::X3, A::X4, A::X5, A::LSL, 3);
+    instructions.add(A::SP, A::SP, 32);
+    instructions.sub_imm(A::X6, A::X7, 1, "");
+    instructions.sub_reg(A::X6, A::X7, A::X9, "");
+    instructions.mul(A::X0, A::X1, A::X2);
+    instructions.sdiv(A::X0, A::X1, A::X2);
+    instructions.msub(A::X0, A::X1, A::X2, A::X3);
+    instructions.lslv(A::X0, A::X1, A::X2, "");
+    instructions.lsrv(A::X0, A::X1, A::X2, "");
+    instructions.str(A::X0, A::X29, -16);
+    instructions.ldr(A::X1, A::X29, 24);
+    instructions.ldr(A::X1, A::X28, 0);
+    instructions.stp(A::X29, A::X30, A::SP, -16);
+    instructions.ldp(A::X29, A::X30, A::SP, 16);
+    instructions.neg(A::X0, A::X0);
+    instructions.mvn(A::X0, A::X0);
+    instructions.and_op(A::X0, A::X1, A::X2);
+    instructions.orr(A::X0, A::X1, A::X2);
+    instructions.eor(A::X0, A::X1, A::X2);
+    instructions.cmp(A::X1, A::X2);
+    instructions.cmp_imm(A::X1, 7);
+    instructions.cset(A::X0, A::GE);
+    instructions.csetm(A::X0, A::NE);
+    instructions.cbnz(A::X3, "top");
+    instructions.tbz(A::X0, 63, "top");
+    instructions.bcond(A::GT, "top");
+    instructions.adr(A::X9, "top");
+    instructions.br(A::X9);
+    instructions.bl("WRITEN");
+    instructions.b("top");
+    instructions.nop();
+    instructions.ret();
+
+    const char* const expected[] = {
+        "mov x0, x1", "mov x29, sp", "movz x2, #0x1234, lsl #16", "movk x2, #0xbeef",
+        "add x3, x4, x5, lsl #3", "add sp, sp, #32", "sub x6, x7, #1", "sub x6, x7, x9",
+        "mul x0, x1, x2", "sdiv x0, x1, x2", "msub x0, x1, x2, x3", "lslv x0, x1, x2", "lsrv x0, x1, x2",
+        "str x0, [x29, #-16]", "ldr x1, [x29, #24]", "ldr x1, [x28]",
+        "stp x29, x30, [sp, #-16]", "ldp x29, x30, [sp, #16]",
+        "neg x0, x0", "mvn x0, x0", "and x0, x1, x2", "orr x0, x1, x2", "eor x0, x1, x2",
+        "cmp x1, x2", "cmp x1, #7", "cset x0, ge", "csetm x0, ne",
+        "cbnz x3, top", "tbz x0, #63, top", "b.gt top", "adr x9, top", "br x9", "bl WRITEN", "b top",
+        "nop", "ret"
+    };
+    assert(instructions.size() == sizeof(expected) / sizeof(expected[0]));
+    for (size_t i = 0; i < instructions.size(); i++) {
+        assert(instructions.disassemble(instructions.at(i)) == expected[i]);
+    }
+
+    // Resolved branches show their offset when no label name is supplied
+    instructions.computeAddresses(0);
+    instructions.resolveAllBranches();
+    assert(AArch64Disassembler::disassemble(instructions.at(33).encoding) == "b #-132");
+    assert(instructions.disassemble(instructions.at(33)) == "b top");
+    assert(AArch64Disassembler::disassemble(0x00000000) == ".word 0x00000000");
+
+    // Instructions carry indices, not strings; comments are dropped, and never formatted, unless kept
+    assert(sizeof(A::Instruction) <= 20);
+    assert(instructions.labelCount() == 2);
+    instructions.clear();
+    int formatted = 0;
+    auto format = [&] { ++formatted; return "Formatted " + std::to_string(formatted); };
+    instructions.ret("Dropped");
+    instructions.ret(format);
+    assert(instructions.commentOf(instructions.at(0)).empty());
+    assert(formatted == 0);
+    instructions.setKeepComments(true);
+    instructions.ret("Kept");
+    instructions.ret(format);
+    assert(instructions.commentOf(instructions.at(2)) == "Kept");
+    assert(instructions.commentOf(instructions.at(3)) == "Formatted 1");
+
+    std::cout << "✓ Disassembly test passed\n";
+}
+
+void testLabelTable() {
+    std::cout << "\n=== Testing Label Table ===\n";
+
+    using A = AArch64Instructions;
+    A instructions;
+    A::Label loop = instructions.newLabel("loop");
+    A::Label done = instructions.newLabel("done");
+    A::Label start = instructions.namedLabel("START");
+    assert(loop.id == 0 && done.id == 1 && start.id == 2);
+    assert(instructions.namedLabel("START") == start);
+    assert(instructions.labelName(loop) == "loop_0");
+    assert(instructions.labelName(done) == "done_1");
+    assert(instructions.labelName(start) == "START");
+
+    // Forward and backward references, plus a call to a symbol bound elsewhere
+    instructions.setPendingLabel(start);
+    instructions.setPendingLabel(loop);
+    instructions.cbz(A::X0, done);
+    instructions.bl("WRITEN");
+    instructions.b(loop);
+    instructions.setPendingLabel(done);
+    instructions.ret();
+    instructions.computeAddresses(0);
+    instructions.resolveAllBranches();
+
+    assert(instructions.at(0).encoding == 0xD503201F);            // nop holding START
+    assert(instructions.at(1).encoding == (0xB4000000 | (3 << 5))); // cbz x0, +12
+    assert(instructions.at(2).needsLabelResolution);               // left for the JIT loader
+    assert(instructions.at(3).encoding == (0x14000000 | 0x3FFFFFE)); // b -8
+
+    bool rejected = false;
+    try {
+        instructions.setPendingLabel(loop);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // tbz reaches +-32KB; a longer branch must not be silently truncated
+    A far;
+    far.tbz(A::X0, 1, "far");
+    for (int i = 0; i < 8192; i++) {
+        far.nop();
+    }
+    far.setPendingLabel("far");
+    far.ret();
+    far.computeAddresses(0);
+    rejected = false;
+    try {
+        far.resolveAllBranches();
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    std::cout << "✓ Label table test passed\n";
+}
+
+void testBranchRelaxation() {
+    std::cout << "\n=== Testing Branch Relaxation ===\n";
+
+    using A = AArch64Instructions;
+
+    // b.eq reaches +-1MB and tbz +-32KB; beyond that they branch over a b
+    A far;
+    far.beq("far");
+    far.tbz(A::X1, 3, "near");
+    for (int i = 0; i < 300000; i++) {
+        far.nop();
+    }
+    far.setPendingLabel("near");
+    far.nop();
+    far.setPendingLabel("far");
+    far.ret();
+    auto stats = far.relaxBranches();
+    far.computeAddresses(0);
+    far.resolveAllBranches();
+
+    assert(stats.conditionalBranches == 2);
+    assert(far.size() == 300006);
+    assert(far.at(0).encoding == (0x54000001 | (2 << 5)));        // b.ne +8
+    assert(far.at(1).encoding == (0x14000000 | 300004));          // b far
+    assert(far.at(2).encoding == ((0x36000000 | (3 << 19) | 1 | (2 << 5)) ^ 0x01000000)); // tbnz x1, #3, +8
+    assert(far.at(3).encoding == (0x14000000 | 300001));          // b near
+    assert(far.disassemble(far.at(0)) == "b.ne #8");
+
+    // In-range branches are left alone
+    A near;
+    near.cbz(A::X0, "done");
+    near.nop();
+    near.setPendingLabel("done");
+    near.ret();
+    stats = near.relaxBranches();
+    assert(stats.conditionalBranches == 0 && stats.veneers == 0 && stats.passes == 1);
+    assert(near.size() == 3);
+
+    // A call beyond reach goes through a veneer placed after the nearest ret
+    A call;
+    call.setPendingLabel("START");
+    call.bl("F");
+    call.ret();
+    for (int i = 0; i < 5000; i++) {
+        call.nop();
+    }
+    call.setPendingLabel("F");
+    call.ret();
+    stats = call.relaxBranches(12);
+    call.computeAddresses(0);
+    call.resolveAllBranches();
+
+    assert(stats.veneers == 1);
+    assert(call.size() == 5006);
+    assert(call.at(0).encoding == (0x94000000 | 2));              // bl veneer
+    assert(call.disassemble(call.at(2)) == "adrp x16, F");
+    assert(call.at(2).encoding == (0x90000000 | (1 << 5) | 16) ); // F is 4 pages on
+    assert(call.at(3).encoding == (0x91000000 | ((20020 & 0xFFF) << 10) | (16 << 5) | 16));
+    assert(call.disassemble(call.at(4)) == "br x16");
+    assert(call.labelName(call.at(2).label) == "veneer_0");
+
+    std::cout << "✓ Branch relaxation test passed\n";
+}
+
 void testFullBufferEncoding() {
     std::cout << "\n=== Testing Full Buffer Encoding ===\n";
     
@@ -145,6 +435,7 @@ void testCodeGeneratorIntegration() {
     std::cout << "\n=== Testing CodeGenerator Integration ===\n";
     
     AArch64Instructions instructions;
+    instructions.setKeepComments(true);
     
     // Simulate creating a simple function: int add42(int x) { return x + 42; }
     // Function prologue
@@ -174,9 +465,9 @@ void testCodeGeneratorIntegration() {
     std::cout << "\nInstruction breakdown:\n";
     for (size_t i = 0; i < instructions.size(); i++) {
         const auto& instr = instructions.at(i);
-        std::cout << "  0x" << std::hex << instr.address << ": " << instr.assembly;
-        if (!instr.comment.empty()) {
-            std::cout << " // " << instr.comment;
+        std::cout << "  0x" << std::hex << instructions.addressOf(i) << ": " << instructions.disassemble(instr);
+        if (!instructions.commentOf(instr).empty()) {
+            std::cout << " // " << instructions.commentOf(instr);
         }
         std::cout << "\n";
     }
@@ -192,6 +483,11 @@ int main() {
         testBasicEncoding();
         testAddressComputation();
         testBranchResolution();
+        testJumpTableEncoding();
+        testConditionEncoding();
+        testDisassembly();
+        testLabelTable();
+        testBranchRelaxation();
         testFullBufferEncoding();
         testCodeGeneratorIntegration();
         
@@ -0,0 +1,447 @@
+#include "IRBuilder.h"
+#include "GlobalValueNumbering.h"
+#include "SparseConditionalConstantPropagation.h"
+#include "CodeGenerator.h"
+#include "JITExecutor.h"
+#include "AArch64Simulator.h"
+#include "TestHelpers.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+/**
+ * Test the SSA IR, its construction from the AST and code selection from it.
+ * This test validates that:
+ * 1. Loops get phis at their headers, and the IR passes verify()
+ * 2. Vector and character access lower to address arithmetic with loads and stores
+ * 3. Critical edges are split and unreachable blocks dropped
+ * 4. Constructs the IR does not cover make build() return nullptr with a reason
+ * 5. Value numbering shares address arithmetic and loads where they dominate,
+ *    in either operand order, and not across stores or calls
+ * 6. Programs compiled through the IR compute what the AST code generator does,
+ *    including across calls, with values spilled, and through tail calls
+ */
+
+static std::unique_ptr<IRFunction> buildFunction(const ProgramPtr& program, const std::string& name, std::string* reason = nullptr) {
+    static const SymbolMap<size_t> globals;
+    static const SymbolMap<int> manifests;
+    IRBuilder::Environment environment;
+    environment.globals = &globals;
+    environment.manifests = &manifests;
+    environment.isFunction = [](SymbolId) { return true; };
+    IRBuilder builder(std::move(environment));
+    std::unique_ptr<IRFunction> function = builder.build(findFunction(program, name));
+    if (reason) {
+        *reason = builder.getUnsupportedReason();
+    }
+    return function;
+}
+
+static size_t countOps(const IRFunction& function, IROp op) {
+    size_t count = 0;
+    for (ValueId v = 0; v < function.valueCount(); ++v) {
+        if (!function.inst(v).isRemoved() && function.inst(v).op == op) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void testLoopsAndPhis() {
+    std::cout << "\n=== Testing Loops and Phis ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(N) = VALOF $(\n"
+        "    LET S = 0\n"
+        "    FOR I = 1 TO N DO S := S + I\n"
+        "    RESULTIS S\n"
+        "$)\n");
+    std::unique_ptr<IRFunction> f = buildFunction(program, "F");
+    assert(f);
+    f->verify();
+
+    // I and S are carried around the loop, and S also merges with the zero-trip path
+    size_t headerPhis = 0;
+    for (ValueId v = 0; v < f->valueCount(); ++v) {
+        const IRInst& inst = f->inst(v);
+        if (!inst.isRemoved() && inst.op == IROp::Phi) {
+            assert(inst.operands.size() == f->block(inst.block).predecessors.size());
+            ++headerPhis;
+        }
+    }
+    assert(headerPhis == 3);
+    assert(countOps(*f, IROp::Load) == 0);
+    assert(countOps(*f, IROp::Store) == 0);
+    assert(countOps(*f, IROp::Return) == 1);
+
+    // A variable never reassigned needs no phi
+    program = Parser::getInstance().parse(
+        "LET G(N) = VALOF $(\n"
+        "    LET K = N * 2\n"
+        "    WHILE N > 0 DO N := N - K\n"
+        "    RESULTIS K\n"
+        "$)\n");
+    std::unique_ptr<IRFunction> g = buildFunction(program, "G");
+    assert(g);
+    g->verify();
+    assert(countOps(*g, IROp::Phi) == 1);
+    std::cout << "✓ Loop and phi test passed\n";
+}
+
+void testMemoryAccess() {
+    std::cout << "\n=== Testing Vector and Character Access ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(V, S, I) BE $(\n"
+        "    V!I := V!(I + 1) + S%I\n"
+        "    V!3 := 0\n"
+        "$)\n");
+    std::unique_ptr<IRFunction> f = buildFunction(program, "F");
+    assert(f);
+    f->verify();
+    assert(!f->returnsValue);
+    assert(countOps(*f, IROp::Load) == 2);
+    assert(countOps(*f, IROp::Store) == 2);
+    assert(countOps(*f, IROp::Shl) >= 2);
+    std::cout << "✓ Memory access test passed\n";
+}
+
+void testEdgesAndUnreachableBlocks() {
+    std::cout << "\n=== Testing Edge Splitting and Unreachable Blocks ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(A, B) = VALOF $(\n"
+        "    LET X = 0\n"
+        "    IF A > B THEN X := A\n"
+        "    RESULTIS X\n"
+        "    X := 99\n"
+        "$)\n");
+    std::unique_ptr<IRFunction> f = buildFunction(program, "F");
+    assert(f);
+    f->verify();
+    for (ValueId v = 0; v < f->valueCount(); ++v) {
+        assert(f->inst(v).isRemoved() || f->inst(v).op != IROp::Const || f->inst(v).imm != 99);
+    }
+
+    // The IF jumps straight to the join, which the assignment also reaches
+    f->splitCriticalEdges();
+    f->verify();
+    for (BlockId b = 0; b < f->blockCount(); ++b) {
+        const IRBlock& block = f->block(b);
+        if (block.successors.size() > 1) {
+            for (BlockId succ : block.successors) {
+                assert(f->block(succ).predecessors.size() == 1);
+            }
+        }
+    }
+    // Blocks cut off by RESULTIS keep their IDs but are left empty
+    std::vector<bool> reachable(f->blockCount(), false);
+    for (BlockId b : f->reversePostorder()) {
+        reachable[b] = true;
+    }
+    for (BlockId b = 0; b < f->blockCount(); ++b) {
+        assert(reachable[b] || f->block(b).insts.empty());
+    }
+    std::cout << "✓ Edge test passed\n";
+}
+
+void testUnsupportedConstructs() {
+    std::cout << "\n=== Testing Unsupported Constructs ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(N) BE $(\n"
+        "L:  N := N - 1\n"
+        "    IF N > 0 THEN GOTO L\n"
+        "$)\n"
+        "LET G(N) = VALOF $(\n"
+        "    LET H = 0\n"
+        "    RESULTIS @H\n"
+        "$)\n");
+    std::string reason;
+    assert(!buildFunction(program, "F", &reason));
+    assert(reason.find("GOTO") != std::string::npos);
+    assert(!buildFunction(program, "G", &reason));
+    assert(!reason.empty());
+    std::cout << "✓ Unsupported construct test passed\n";
+}
+
+void testValueNumbering() {
+    std::cout << "\n=== Testing Global Value Numbering ===\n";
+
+    // v!(i*n+j) three times: one multiply, one address, and the second load
+    // takes the value just stored
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(V, I, J, N) = VALOF $(\n"
+        "    V!(I*N+J) := V!(I*N+J) + 1\n"
+        "    RESULTIS V!(N*I+J)\n"
+        "$)\n"
+        "LET G(A, B, C) = VALOF $(\n"
+        "    LET Y = 0\n"
+        "    TEST C THEN Y := A * B OR Y := 1\n"
+        "    RESULTIS Y + A * B + (A < B) + (B > A)\n"
+        "$)\n"
+        "LET H(V) = VALOF $(\n"
+        "    LET X = V!0\n"
+        "    H(X)\n"
+        "    RESULTIS X + V!0\n"
+        "$)\n");
+    GlobalValueNumbering gvn;
+    std::unique_ptr<IRFunction> f = buildFunction(program, "F");
+    assert(gvn.run(*f));
+    f->verify();
+    assert(countOps(*f, IROp::Mul) == 1);
+    assert(countOps(*f, IROp::Shl) == 1);
+    assert(countOps(*f, IROp::Load) == 1);
+    assert(countOps(*f, IROp::Store) == 1);
+    assert(gvn.getStatistics().loads == 1);
+
+    // The product in one arm does not dominate the one after the join
+    std::unique_ptr<IRFunction> g = buildFunction(program, "G");
+    gvn.run(*g);
+    g->verify();
+    assert(countOps(*g, IROp::Mul) == 2);
+    assert(countOps(*g, IROp::Lt) + countOps(*g, IROp::Gt) == 1);
+
+    // A call may change V!0
+    std::unique_ptr<IRFunction> h = buildFunction(program, "H");
+    gvn.run(*h);
+    h->verify();
+    assert(countOps(*h, IROp::Load) == 2);
+    std::cout << "✓ Value numbering test passed\n";
+}
+
+void testConstantPropagation() {
+    std::cout << "\n=== Testing Sparse Conditional Constant Propagation ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F(A) = VALOF $(\n"
+        "    LET X = 3\n"
+        "    LET Y = X * 4\n"
+        "    TEST Y > 10 THEN X := A OR X := 0\n"
+        "    RESULTIS X + Y\n"
+        "$)\n"
+        "LET G(A) = VALOF $(\n"
+        "    LET S = A\n"
+        "    FOR I = 5 TO 1 DO S := S + I\n"
+        "    RESULTIS S\n"
+        "$)\n"
+        "LET H(N) = VALOF $(\n"
+        "    LET K = 2\n"
+        "    FOR I = 1 TO N DO K := 4 / K\n"
+        "    RESULTIS K\n"
+        "$)\n"
+        "LET W(A) = VALOF $(\n"
+        "    LET M = 2\n"
+        "    SWITCHON M INTO $(\n"
+        "        CASE 1: RESULTIS A\n"
+        "        CASE 2: RESULTIS A + 1\n"
+        "        DEFAULT: RESULTIS 0\n"
+        "    $)\n"
+        "$)\n"
+        "LET D() = VALOF $(\n"
+        "    LET Z = 0\n"
+        "    RESULTIS 1 / Z\n"
+        "$)\n");
+    SparseConditionalConstantPropagation sccp;
+
+    // The multiply and the test fold, and the arm not taken goes
+    std::unique_ptr<IRFunction> f = buildFunction(program, "F");
+    assert(sccp.run(*f));
+    f->verify();
+    assert(countOps(*f, IROp::Mul) == 0);
+    assert(countOps(*f, IROp::Branch) == 0);
+    assert(countOps(*f, IROp::Phi) == 0);
+    assert(countOps(*f, IROp::Add) == 1);
+
+    // A FOR whose bounds say it never runs leaves no loop
+    std::unique_ptr<IRFunction> g = buildFunction(program, "G");
+    sccp.run(*g);
+    g->verify();
+    assert(countOps(*g, IROp::Branch) == 0);
+    assert(countOps(*g, IROp::Phi) == 0);
+    assert(countOps(*g, IROp::Add) == 0);
+
+    // K is 2 on entry and 4 / 2 around the back edge, so the loop keeps it
+    std::unique_ptr<IRFunction> h = buildFunction(program, "H");
+    sccp.run(*h);
+    h->verify();
+    assert(countOps(*h, IROp::Div) == 0);
+    for (ValueId v = 0; v < h->valueCount(); ++v) {
+        const IRInst& inst = h->inst(v);
+        if (!inst.isRemoved() && inst.op == IROp::Return) {
+            assert(h->inst(inst.operands[0]).op == IROp::Const && h->inst(inst.operands[0]).imm == 2);
+        }
+    }
+
+    // A switch on a constant jumps straight to its case
+    std::unique_ptr<IRFunction> w = buildFunction(program, "W");
+    sccp.run(*w);
+    w->verify();
+    assert(countOps(*w, IROp::Switch) == 0);
+    assert(countOps(*w, IROp::Return) == 1);
+
+    // Division by zero is left for run time
+    std::unique_ptr<IRFunction> d = buildFunction(program, "D");
+    sccp.run(*d);
+    d->verify();
+    assert(countOps(*d, IROp::Div) == 1);
+    assert(sccp.getStatistics().branches == 3);
+    std::cout << "✓ Constant propagation test passed\n";
+}
+
+static int64_t runProgram(const std::string& source, bool throughIR) {
+    ProgramPtr program = Parser::getInstance().parse(source);
+    CodeGenerator codegen;
+    codegen.setIRSelectionEnabled(throughIR);
+    uintptr_t entry = codegen.compile(std::move(program));
+
+    JITExecutor executor;
+    codegen.load(executor, entry);
+    AArch64Simulator sim;
+    sim.setGlobalPointer(reinterpret_cast<uintptr_t>(executor.getGlobals()));
+    return sim.run(reinterpret_cast<uintptr_t>(executor.getEntryPoint()));
+}
+
+static void expectSameResult(const std::string& source, int64_t expected) {
+    const int64_t fromAST = runProgram(source, false);
+    const int64_t fromIR = runProgram(source, true);
+    if (fromAST != expected || fromIR != expected) {
+        throw std::runtime_error("Expected " + std::to_string(expected) + ", AST gave " + std::to_string(fromAST) +
+                                 ", IR gave " + std::to_string(fromIR));
+    }
+}
+
+void testEndToEnd() {
+    std::cout << "\n=== Testing Programs Compiled Through the IR ===\n";
+
+    // Loops, arithmetic and calls
+    expectSameResult(
+        "LET SUM(N) = VALOF $(\n"
+        "    LET S = 0\n"
+        "    FOR I = 1 TO N DO S := S + I * I\n"
+        "    RESULTIS S\n"
+        "$)\n"
+        "LET COLLATZ(N) = VALOF $(\n"
+        "    LET STEPS = 0\n"
+        "    WHILE N ~= 1 DO $(\n"
+        "        TEST N REM 2 = 0 THEN N := N / 2 OR N := 3 * N + 1\n"
+        "        STEPS := STEPS + 1\n"
+        "    $)\n"
+        "    RESULTIS STEPS\n"
+        "$)\n"
+        "LET START() = SUM(10) + COLLATZ(27)\n",
+        385 + 111);
+
+    // SWITCHON, conditional expressions, REPEAT and self tail calls
+    expectSameResult(
+        "LET CLASSIFY(X) = VALOF $(\n"
+        "    SWITCHON X INTO $(\n"
+        "        CASE 1: RESULTIS 10\n"
+        "        CASE 2: RESULTIS 20\n"
+        "        CASE 3: RESULTIS 20\n"
+        "        CASE 7: RESULTIS 70\n"
+        "        DEFAULT: RESULTIS X < 0 -> -1, 0\n"
+        "    $)\n"
+        "$)\n"
+        "LET GCD(A, B) = VALOF $(\n"
+        "    IF B = 0 THEN RESULTIS A\n"
+        "    RESULTIS GCD(B, A REM B)\n"
+        "$)\n"
+        "LET START() = VALOF $(\n"
+        "    LET T = 0\n"
+        "    LET I = -2\n"
+        "    $(\n"
+        "        T := T + CLASSIFY(I)\n"
+        "        I := I + 1\n"
+        "    $) REPEATUNTIL I > 8\n"
+        "    RESULTIS T * 1000 + GCD(1071, 462)\n"
+        "$)\n",
+        (-1 - 1 + 0 + 10 + 20 + 20 + 0 + 0 + 0 + 70 + 0) * 1000 + 21);
+
+    // Calls in arguments, of a self tail call and of a normal call, made
+    // after other arguments are evaluated; G sets X1 when it calls H
+    expectSameResult(
+        "LET H(A, B) = A * 10 + B\n"
+        "LET G(X) = H(X, 0)\n"
+        "LET F(A, B) = VALOF $(\n"
+        "    IF A > 100 THEN RESULTIS A + B\n"
+        "    RESULTIS F(G(A), B)\n"
+        "$)\n"
+        "LET P(A, B, C) = A * 100 + B * 10 + C\n"
+        "LET START() = F(1, 5) * 1000 + P(5, G(1), 7)\n",
+        1005 * 1000 + 607);
+
+    // Parameters after the eighth arrive on the stack, from a function call
+    // and from a routine call; the IR leaves these functions to the AST path
+    expectSameResult(
+        "GLOBAL $( G : 0 $)\n"
+        "LET SUM(A, B, C, D, E, F, H, I, J, K) = A + 2*B + 3*C + 4*D + 5*E + 6*F + 7*H + 8*I + 9*J + 10*K\n"
+        "LET KEEP(A, B, C, D, E, F, H, I, J) BE G := J * 100 + I\n"
+        "LET START() = VALOF $(\n"
+        "    KEEP(1, 2, 3, 4, 5, 6, 7, 8, 9)\n"
+        "    RESULTIS SUM(1, 2, 3, 4, 5, 6, 7, 8, 9, 10) * 1000 + G\n"
+        "$)\n",
+        385 * 1000 + 908);
+
+    // More values live across a call than there are callee-saved registers
+    expectSameResult(
+        "LET TWICE(X) = X + X\n"
+        "LET MANY(A) = VALOF $(\n"
+        "    LET B = A + 1\n"
+        "    LET C = A * 3\n"
+        "    LET D = A - 4\n"
+        "    LET E = A * A\n"
+        "    LET F = B + C\n"
+        "    LET G = C + D\n"
+        "    LET H = D + E\n"
+        "    LET I = E + F\n"
+        "    LET J = F + G\n"
+        "    LET K = G + H\n"
+        "    LET L = H + I\n"
+        "    LET M = TWICE(A)\n"
+        "    RESULTIS A + B + C + D + E + F + G + H + I + J + K + L + M\n"
+        "$)\n"
+        "LET START() = MANY(5)\n",
+        5 + 6 + 15 + 1 + 25 + 21 + 16 + 26 + 46 + 37 + 42 + 72 + 10);
+
+    // RESULTIS in a nested VALOF, and BREAK; the AST code generator returns
+    // from the function there instead, so only the IR result is checked
+    const std::string nestedValof =
+        "LET START() = VALOF $(\n"
+        "    LET N = 0\n"
+        "    FOR I = 1 TO 100 DO $(\n"
+        "        IF I > 20 THEN BREAK\n"
+        "        LET W = VALOF $(\n"
+        "            IF I REM 3 = 0 THEN RESULTIS 0\n"
+        "            RESULTIS I\n"
+        "        $)\n"
+        "        N := N + W\n"
+        "    $)\n"
+        "    RESULTIS N\n"
+        "$)\n";
+    assert(runProgram(nestedValof, true) == 210 - (3 + 6 + 9 + 12 + 15 + 18));
+
+    std::cout << "✓ End-to-end test passed\n";
+}
+
+int main() {
+    std::cout << "SSA IR Test Suite\n";
+    std::cout << "=================\n";
+
+    try {
+        testLoopsAndPhis();
+        testMemoryAccess();
+        testEdgesAndUnreachableBlocks();
+        testUnsupportedConstructs();
+        testValueNumbering();
+        testConstantPropagation();
+        testEndToEnd();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
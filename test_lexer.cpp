@@ -0,0 +1,275 @@
+#include "Lexer.h"
+#include "SourceBuffer.h"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * Test the lexer.
+ * This test validates that:
+ * 1. Token kinds, values and line/column positions are correct
+ * 2. Token text is a view into the source buffer, not a copy
+ * 3. String literal escapes are decoded by Lexer::unescape
+ * 4. A memory-mapped source is lexed without any heap allocation
+ * 5. Batch tokenization into a TokenStream matches token-at-a-time lexing
+ * 6. Keywords are found by perfect hash, and block scanning keeps positions exact
+ * 7. Identifiers are interned to dense symbol IDs that key flat SymbolMaps
+ */
+
+// Counts every heap allocation made by the test
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static const char* SOURCE =
+    "LET START() = VALOF $(\n"
+    "  LET x, y = #x1F, #17 // comment\n"
+    "  x := x +. 2.5 REM 'A'\n"
+    "  WRITES(\"hi*n*\"there*\"\")\n"
+    "  RESULTIS x <= y -> 1, 0\n"
+    "$)\n";
+
+static std::vector<Token> lexAll(std::string_view source) {
+    Lexer& lexer = Lexer::getInstance();
+    lexer.init(source);
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(lexer.getNextToken());
+    } while (tokens.back().type != TokenType::Eof);
+    return tokens;
+}
+
+void testTokens() {
+    std::cout << "\n=== Testing Token Kinds and Values ===\n";
+
+    std::string_view source(SOURCE);
+    auto tokens = lexAll(source);
+
+    const std::vector<TokenType> expected = {
+        TokenType::KwLet, TokenType::Identifier, TokenType::LParen, TokenType::RParen, TokenType::OpEq,
+        TokenType::KwValof, TokenType::LSection,
+        TokenType::KwLet, TokenType::Identifier, TokenType::Comma, TokenType::Identifier, TokenType::OpEq,
+        TokenType::IntegerLiteral, TokenType::Comma, TokenType::IntegerLiteral,
+        TokenType::Identifier, TokenType::OpAssign, TokenType::Identifier, TokenType::OpFloatPlus,
+        TokenType::FloatLiteral, TokenType::OpRemainder, TokenType::CharLiteral,
+        TokenType::Identifier, TokenType::LParen, TokenType::StringLiteral, TokenType::RParen,
+        TokenType::KwResultis, TokenType::Identifier, TokenType::OpLe, TokenType::Identifier,
+        TokenType::OpConditional, TokenType::IntegerLiteral, TokenType::Comma, TokenType::IntegerLiteral,
+        TokenType::RSection, TokenType::Eof};
+    assert(tokens.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        assert(tokens[i].type == expected[i]);
+    }
+
+    assert(tokens[12].int_val == 0x1F && tokens[12].text == "#x1F");
+    assert(tokens[14].int_val == 017);
+    assert(tokens[19].float_val == 2.5);
+    assert(tokens[21].int_val == 'A' && tokens[21].text == "A");
+    assert(tokens[28].text == "<=");
+    assert(tokens[8].line == 2 && tokens[8].col == 7);
+    assert(tokens[35].text.empty());
+
+    // Every token views the source buffer itself
+    for (const auto& token : tokens) {
+        assert(token.text.data() >= source.data() && token.text.data() + token.text.size() <= source.data() + source.size());
+    }
+
+    std::cout << "✓ Token test passed\n";
+}
+
+void testKeywordsAndLongRuns() {
+    std::cout << "\n=== Testing Keyword Hashing and Block Scanning ===\n";
+
+    const std::vector<std::pair<std::string, TokenType>> keywords = {
+        {"LET", TokenType::KwLet}, {"BE", TokenType::KwBe}, {"REPEATWHILE", TokenType::KwRepeatWhile},
+        {"REPEATUNTIL", TokenType::KwRepeatUntil}, {"SWITCHON", TokenType::KwSwitchon},
+        {"RESULTIS", TokenType::KwResultis}, {"FINISH", TokenType::KwFinish}, {"REM", TokenType::OpRemainder},
+        {"EQV", TokenType::OpLogEqv}, {"NEQV", TokenType::OpLogNeqv}};
+    for (const auto& keyword : keywords) {
+        assert(lexAll(keyword.first)[0].type == keyword.second);
+        assert(Token::tokenTypeToString(keyword.second) == keyword.first);
+    }
+    for (const char* name : {"let", "LETS", "REPEATUNTIL_", "B", "REPEATUNTILX", "VALOF1", "DOX"}) {
+        assert(lexAll(name)[0].type == TokenType::Identifier);
+    }
+
+    // Runs longer than a SIMD block, ending at every offset within one
+    for (size_t length = 1; length < 80; ++length) {
+        std::string source = std::string(length, ' ') + std::string(length, 'x') + " \"" +
+                             std::string(length, 's') + "*n\" //" + std::string(length, 'c') + "\n" +
+                             std::string(length, '\n') + "/*" + std::string(length, '*') + "\n*/y";
+        auto tokens = lexAll(source);
+        assert(tokens.size() == 4);
+        assert(tokens[0].type == TokenType::Identifier && tokens[0].text.size() == length);
+        assert(tokens[0].line == 1 && tokens[0].col == length + 1);
+        assert(tokens[1].type == TokenType::StringLiteral && tokens[1].text.size() == length + 2);
+        assert(tokens[2].text == "y" && tokens[2].line == length + 3 && tokens[2].col == 3);
+    }
+
+    std::cout << "✓ Keyword and block scanning test passed\n";
+}
+
+void testStringEscapes() {
+    std::cout << "\n=== Testing String Literal Escapes ===\n";
+
+    auto tokens = lexAll("\"hi*n*\"there*\"*s**\"");
+    assert(tokens[0].type == TokenType::StringLiteral);
+    assert(tokens[0].text == "hi*n*\"there*\"*s**");
+    assert(Lexer::unescape(tokens[0].text) == "hi\n\"there\" *");
+    assert(tokens[1].type == TokenType::Eof);
+
+    std::cout << "✓ String escape test passed\n";
+}
+
+void testTokenStream() {
+    std::cout << "\n=== Testing Batch Tokenization ===\n";
+
+    std::string_view source(SOURCE);
+    auto expected = lexAll(source);
+    TokenStream stream = Lexer::getInstance().tokenize(source);
+
+    // The arrays hold exactly what getNextToken() returns one at a time
+    assert(stream.size() == expected.size());
+    for (size_t i = 0; i < stream.size(); ++i) {
+        Token token = stream.at(i);
+        assert(token.type == expected[i].type && stream.type(i) == expected[i].type);
+        assert(token.text == expected[i].text && token.text.data() == expected[i].text.data());
+        assert(token.int_val == expected[i].int_val);
+        assert(token.float_val == expected[i].float_val);
+        assert(token.line == expected[i].line && token.col == expected[i].col);
+        assert(token.symbol == expected[i].symbol && stream.symbol(i) == expected[i].symbol);
+    }
+    assert(stream.floatValue(19) == 2.5);
+    assert(stream.intValue(12) == 0x1F);
+    assert(stream.type(stream.size() - 1) == TokenType::Eof);
+
+    TokenStream empty = Lexer::getInstance().tokenize("  // nothing\n");
+    assert(empty.size() == 1 && empty.type(0) == TokenType::Eof && empty.line(0) == 2);
+
+    std::cout << "✓ Token stream test passed\n";
+}
+
+void testSymbols() {
+    std::cout << "\n=== Testing Interned Identifiers ===\n";
+
+    SymbolTable& symbols = SymbolTable::getInstance();
+    auto tokens = lexAll("LET alpha = beta + alpha; LET beta2 = beta");
+
+    // Every identifier carries its symbol; keywords and operators carry none
+    assert(tokens[0].type == TokenType::KwLet && tokens[0].symbol == SymbolTable::NoSymbol);
+    assert(tokens[2].symbol == SymbolTable::NoSymbol);
+    SymbolId alpha = tokens[1].symbol;
+    SymbolId beta = tokens[3].symbol;
+    assert(alpha != SymbolTable::NoSymbol && beta != SymbolTable::NoSymbol && alpha != beta);
+    assert(tokens[5].symbol == alpha);
+    assert(tokens[8].symbol != beta && tokens[10].symbol == beta);
+    assert(symbols.name(alpha) == "alpha" && symbols.name(beta) == "beta");
+
+    // IDs are dense and lookup never interns
+    assert(alpha < symbols.size() && beta < symbols.size());
+    size_t count = symbols.size();
+    assert(symbols.lookup("never_seen_here") == SymbolTable::NoSymbol);
+    assert(symbols.lookup("beta") == beta);
+    assert(symbols.size() == count);
+    assert(symbols.intern("beta") == beta && symbols.size() == count);
+
+    // Interning enough names to grow the table keeps every ID stable
+    std::vector<SymbolId> ids;
+    for (int i = 0; i < 5000; ++i) {
+        ids.push_back(symbols.intern("v" + std::to_string(i)));
+    }
+    assert(symbols.intern("alpha") == alpha);
+    for (int i = 0; i < 5000; ++i) {
+        assert(symbols.lookup("v" + std::to_string(i)) == ids[i]);
+        assert(symbols.name(ids[i]) == "v" + std::to_string(i));
+    }
+
+    SymbolMap<int> offsets;
+    assert(offsets.insert(beta, -8) && !offsets.insert(beta, -16));
+    offsets[alpha] = -24;
+    assert(offsets.size() == 2 && *offsets.find(beta) == -8 && offsets[alpha] == -24);
+    assert(!offsets.contains(ids[0]) && !offsets.find(SymbolTable::NoSymbol));
+    offsets.clear();
+    assert(offsets.empty() && !offsets.contains(alpha) && !offsets.find(beta));
+    offsets[beta] = 1;
+    assert(offsets.keys().size() == 1 && offsets.keys()[0] == beta);
+
+    SymbolSet names;
+    assert(names.insert(alpha) && !names.insert(alpha) && names.insert(ids.back()));
+    assert(names.contains(alpha) && !names.contains(beta) && names.size() == 2);
+
+    std::cout << "✓ Symbol test passed\n";
+}
+
+void testMappedSourceAllocatesNothing() {
+    std::cout << "\n=== Testing Allocation-Free Lexing of a Mapped File ===\n";
+
+    const char* path = "test_lexer_source.b";
+    {
+        std::ofstream file(path);
+        for (int i = 0; i < 2000; ++i) {
+            file << SOURCE;
+        }
+    }
+
+    SourceBuffer source = SourceBuffer::map(path);
+    assert(source.text().size() == 2000 * std::string_view(SOURCE).size());
+
+    Lexer& lexer = Lexer::getInstance();
+    lexer.init(source.text());
+    size_t before = allocations;
+    size_t count = 0;
+    Token token;
+    do {
+        token = lexer.getNextToken();
+        ++count;
+    } while (token.type != TokenType::Eof);
+
+    assert(allocations == before);
+    assert(count == 2000 * 35 + 1);
+    assert(token.line == 2000 * 6 + 1);
+    std::remove(path);
+
+    std::cout << "  Tokens: " << count << ", heap allocations while lexing: " << (allocations - before) << "\n";
+    std::cout << "✓ Mapped source test passed\n";
+}
+
+int main() {
+    std::cout << "Lexer Test Suite\n";
+    std::cout << "================\n";
+
+    try {
+        testTokens();
+        testKeywordsAndLongRuns();
+        testStringEscapes();
+        testTokenStream();
+        testSymbols();
+        testMappedSourceAllocatesNothing();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "PassManager.h"
+#include "ASTMutator.h"
+#include "ConstantFoldingPass.h"
+#include "RepeatUntilOptimizationPass.h"
+#include "Parser.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Test the staged pass pipeline.
+ * This test validates that:
+ * 1. A function pass group reruns each declaration only until it stops changing
+ * 2. The iteration cap stops a declaration that keeps changing
+ * 3. Whole-program passes between groups see every declaration finished
+ * 4. Running groups on a thread pool gives the same tree as running them serially
+ */
+
+// Counts every positive literal down by one per application
+class CountdownPass : public OptimizationPass, private ASTMutator<CountdownPass> {
+public:
+    std::string getName() const override { return "Countdown"; }
+    bool isFunctionPass() const override { return true; }
+
+    ProgramPtr apply(ProgramPtr program) override {
+        resetMutated();
+        mutate(program.get());
+        changed = hasMutated();
+        return program;
+    }
+
+    bool applyToDeclaration(Declaration* declaration) override {
+        resetMutated();
+        mutate(declaration);
+        return hasMutated();
+    }
+
+private:
+    friend class ASTMutator<CountdownPass>;
+    using ASTMutator<CountdownPass>::rewrite;
+
+    ExprPtr rewrite(NumberLiteral* node) {
+        if (node->value > 0) {
+            --node->value;
+            markMutated();
+        }
+        return nullptr;
+    }
+};
+
+// Whole-program pass that records the largest literal it sees
+class MaxLiteralPass : public OptimizationPass, private ASTMutator<MaxLiteralPass> {
+public:
+    std::string getName() const override { return "Max Literal"; }
+
+    ProgramPtr apply(ProgramPtr program) override {
+        largest = INT64_MIN;
+        mutate(program.get());
+        return program;
+    }
+
+    int64_t largest = INT64_MIN;
+
+private:
+    friend class ASTMutator<MaxLiteralPass>;
+    using ASTMutator<MaxLiteralPass>::rewrite;
+
+    ExprPtr rewrite(NumberLiteral* node) {
+        largest = std::max(largest, node->value);
+        return nullptr;
+    }
+};
+
+// Flattens a tree into the literals, names, operators and loops it contains
+class TreeDump : public ASTMutator<TreeDump> {
+public:
+    using ASTMutator<TreeDump>::mutate;
+    using ASTMutator<TreeDump>::rewrite;
+
+    ExprPtr rewrite(NumberLiteral* node) { text += std::to_string(node->value) + " "; return nullptr; }
+    ExprPtr rewrite(VariableAccess* node) { text += node->name + " "; return nullptr; }
+
+    ExprPtr rewrite(BinaryOp* node) {
+        text += "op" + std::to_string(static_cast<int>(node->op)) + " ";
+        mutateChildren(node);
+        return nullptr;
+    }
+
+    StmtPtr rewrite(WhileStatement* node) { text += "while "; mutateChildren(node); return nullptr; }
+    StmtPtr rewrite(RepeatStatement* node) { text += "repeat "; mutateChildren(node); return nullptr; }
+
+    std::string text;
+};
+
+static int64_t resultOf(const ProgramPtr& program, size_t index) {
+    auto* function = nodeCast<FunctionDeclaration>(program->declarations[index].get());
+    assert(function);
+    auto* literal = nodeCast<NumberLiteral>(function->body_expr.get());
+    if (!literal) {
+        throw std::runtime_error("Function " + function->name + " was not folded to a literal");
+    }
+    return literal->value;
+}
+
+void testFixedPoint() {
+    std::cout << "\n=== Testing Fixed-Point Groups ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F() = 2\n"
+        "LET G() = 0\n"
+        "LET H() = 10\n");
+
+    PassManager manager;
+    manager.addFunctionPassGroup({[] { return std::make_unique<CountdownPass>(); }}, 4);
+    program = manager.optimize(std::move(program));
+
+    // F settles after two changes, G is never changed, H is still changing at the cap
+    assert(resultOf(program, 0) == 0);
+    assert(resultOf(program, 1) == 0);
+    assert(resultOf(program, 2) == 6);
+
+    const auto& stats = manager.getStatistics();
+    assert(stats.declarations == 3);
+    assert(stats.passRuns == 3 + 1 + 4);
+    assert(stats.changedRuns == 2 + 0 + 4);
+    assert(stats.capped == 1);
+    std::cout << "✓ Fixed point and cap test passed\n";
+}
+
+void testBarriers() {
+    std::cout << "\n=== Testing Whole-Program Barriers ===\n";
+
+    ProgramPtr program = Parser::getInstance().parse(
+        "LET F() = 3\n"
+        "LET G() = 5\n");
+
+    PassManager manager;
+    manager.setThreadCount(2);
+    manager.addFunctionPassGroup({[] { return std::make_unique<CountdownPass>(); }}, 2);
+    auto barrier = std::make_unique<MaxLiteralPass>();
+    MaxLiteralPass* observed = barrier.get();
+    manager.addPass(std::move(barrier));
+    manager.addFunctionPassGroup({[] { return std::make_unique<CountdownPass>(); }}, 10);
+    assert(manager.getPassCount() == 3);
+
+    program = manager.optimize(std::move(program));
+
+    // The barrier ran after both functions had been counted down twice
+    assert(observed->largest == 3);
+    assert(resultOf(program, 0) == 0 && resultOf(program, 1) == 0);
+    std::cout << "✓ Barrier test passed\n";
+
+    // Only function passes may be grouped
+    PassManager bad;
+    bad.addFunctionPassGroup({[] { return std::make_unique<MaxLiteralPass>(); }});
+    bool threw = false;
+    try {
+        bad.optimize(Parser::getInstance().parse("LET F() = 1\n"));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "✓ Group validation test passed\n";
+}
+
+void testParallelMatchesSerial() {
+    std::cout << "\n=== Testing Parallel Groups ===\n";
+
+    std::string source;
+    for (int i = 0; i < 40; ++i) {
+        std::string n = std::to_string(i);
+        source += "LET F" + n + "(X) = VALOF $(\n"
+                  "    LET A = " + n + " * 4 + 0\n"
+                  "    $( A := A + X * 2 $) REPEATUNTIL " + n + " = " + n + "\n"
+                  "    TEST " + n + " > 20 THEN A := A - 1 OR A := A + 1\n"
+                  "    RESULTIS A\n"
+                  "$)\n";
+    }
+
+    SymbolMap<int64_t> manifests;
+    auto run = [&](unsigned threads) {
+        PassManager manager;
+        manager.setThreadCount(threads);
+        manager.addFunctionPassGroup({
+            [&] { return std::make_unique<ConstantFoldingPass>(manifests); },
+            [&] { return std::make_unique<RepeatUntilOptimizationPass>(manifests); },
+        });
+        ProgramPtr program = manager.optimize(Parser::getInstance().parse(source));
+        assert(manager.getStatistics().declarations == 40);
+        assert(manager.getStatistics().capped == 0);
+        TreeDump dump;
+        dump.mutate(program.get());
+        return dump.text;
+    };
+
+    std::string serial = run(1);
+    std::string parallel = run(4);
+    assert(serial == parallel);
+
+    // Each REPEAT runs once and was replaced by its body
+    assert(serial.find("repeat") == std::string::npos);
+    assert(serial.find("while") == std::string::npos);
+    assert(serial.find("op") != std::string::npos);
+    std::cout << "✓ Parallel and serial pipelines agree\n";
+}
+
+int main() {
+    std::cout << "Pass Manager Test Suite\n";
+    std::cout << "=======================\n";
+
+    try {
+        testFixedPoint();
+        testBarriers();
+        testParallelMatchesSerial();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
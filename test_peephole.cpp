@@ -0,0 +1,228 @@
+#include "PeepholeOptimizer.h"
+#include "AArch64Instructions.h"
+#include "AArch64Disassembler.h"
+#include "AArch64Simulator.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+/**
+ * Test the AArch64 peephole optimizer.
+ * This test validates that:
+ * 1. Each pattern fires on the code shapes the code generator emits
+ * 2. Labels, branch targets and live registers are preserved
+ * 3. Optimized code computes the same result as the original under the simulator
+ * 4. canCombineLoadStore() rejects pairs that ldp/stp cannot express
+ */
+
+using A = AArch64Instructions;
+using Instruction = A::Instruction;
+
+// Runs code emitted by @p program, whose label table it shares
+static int64_t simulate(const A& program, const std::vector<Instruction>& code) {
+    A instructions = program;
+    instructions.getInstructions() = code;
+    instructions.computeAddresses();
+    instructions.resolveAllBranches();
+    std::vector<uint32_t> buffer(instructions.size());
+    instructions.encodeToBuffer(reinterpret_cast<uint8_t*>(buffer.data()), buffer.size() * 4);
+
+    AArch64Simulator sim;
+    return sim.run(reinterpret_cast<uintptr_t>(buffer.data()));
+}
+
+// Optimizes a copy of the program and checks that its result is unchanged
+static std::vector<Instruction> optimizeAndCompare(A& program, int64_t expected,
+                                                   PeepholeOptimizer::Statistics& stats) {
+    std::vector<Instruction> optimized = program.getInstructions();
+    PeepholeOptimizer optimizer(optimized);
+    optimizer.run();
+    stats = optimizer.getStatistics();
+
+    int64_t before = simulate(program, program.getInstructions());
+    int64_t after = simulate(program, optimized);
+    assert(before == expected);
+    assert(after == expected);
+    assert(stats.instructionsBefore == program.size());
+    assert(stats.instructionsAfter == optimized.size());
+    std::cout << "  Result: " << after << ", instructions: " << stats.instructionsBefore
+              << " -> " << stats.instructionsAfter << "\n";
+    return optimized;
+}
+
+static size_t countMnemonic(const std::vector<Instruction>& code, const std::string& mnemonic) {
+    size_t count = 0;
+    for (const auto& instr : code) {
+        if (AArch64Disassembler::disassemble(instr.encoding).compare(0, mnemonic.size() + 1, mnemonic + " ") == 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void testMovesAndCopies() {
+    std::cout << "\n=== Testing Move Clean-up and Copy Propagation ===\n";
+
+    // The accumulator ping-pong produced for LET x = 5 IN RESULTIS x * x
+    A program;
+    program.movz(A::X0, 5, 0);
+    program.mov(A::X0, A::X0);
+    program.mov(13, A::X0);
+    program.mov(A::X0, 13);
+    program.mov(14, A::X0);
+    program.mul(A::X0, 13, 14);
+    program.ret();
+
+    PeepholeOptimizer::Statistics stats;
+    auto optimized = optimizeAndCompare(program, 25, stats);
+
+    assert(stats.selfMoves >= 1);
+    assert(stats.propagatedCopies >= 2);
+    assert(stats.deadDefinitions >= 2);
+    assert(countMnemonic(optimized, "mov") == 0);
+    assert(optimized.size() == 3); // movz, mul, ret
+
+    std::cout << "✓ Move and copy test passed\n";
+}
+
+void testLoadsAndStores() {
+    std::cout << "\n=== Testing Redundant Loads and Load/Store Pairing ===\n";
+
+    A program;
+    program.sub_imm(A::SP, A::SP, 32, "");
+    program.add(A::X29, A::SP, 16);
+    program.movz(A::X1, 7, 0);
+    program.movz(A::X2, 9, 0);
+    program.str(A::X1, A::X29, -16);
+    program.str(A::X2, A::X29, -8);
+    program.ldr(A::X3, A::X29, -16);   // Reloads what was just stored
+    program.ldr(A::X4, A::X29, -8);
+    program.add(A::X0, A::X3, A::X4, A::LSL, 0);
+    program.add(A::SP, A::SP, 32);
+    program.ret();
+
+    PeepholeOptimizer::Statistics stats;
+    auto optimized = optimizeAndCompare(program, 16, stats);
+
+    assert(stats.redundantLoads == 2);
+    assert(stats.pairedLoadStores == 1);
+    assert(countMnemonic(optimized, "ldr") == 0);
+    assert(countMnemonic(optimized, "str") == 0);
+    assert(countMnemonic(optimized, "stp") == 1);
+
+    // Pairing rules
+    A pairs;
+    pairs.ldr(A::X3, A::X29, -16);   // 0
+    pairs.ldr(A::X4, A::X29, -8);    // 1
+    pairs.ldr(A::X29, A::X29, -16);  // 2: clobbers the base
+    pairs.ldr(A::X5, A::X29, 8);     // 3
+    pairs.str(A::X1, A::X29, 16);    // 4
+    pairs.str(A::X2, A::X29, 32);    // 5: not adjacent slots
+    pairs.str(A::X2, A::X29, 8);     // 6
+    const auto& p = pairs.getInstructions();
+
+    assert(PeepholeOptimizer::canCombineLoadStore(p[0], p[1]));
+    assert(PeepholeOptimizer::canCombineLoadStore(p[1], p[0]));
+    assert(!PeepholeOptimizer::canCombineLoadStore(p[2], p[3]));
+    assert(!PeepholeOptimizer::canCombineLoadStore(p[4], p[5]));
+    assert(!PeepholeOptimizer::canCombineLoadStore(p[1], p[4])); // load + store
+    assert(PeepholeOptimizer::canCombineLoadStore(p[4], p[6]));
+
+    A expected;
+    expected.ldp(A::X3, A::X4, A::X29, -16);
+    expected.stp(A::X2, A::X1, A::X29, 8);
+    assert(PeepholeOptimizer::combineLoadStore(p[1], p[0]).encoding == expected.getInstructions()[0].encoding);
+    assert(PeepholeOptimizer::combineLoadStore(p[4], p[6]).encoding == expected.getInstructions()[1].encoding);
+    assert(AArch64Disassembler::disassemble(PeepholeOptimizer::combineLoadStore(p[0], p[1]).encoding) ==
+           "ldp x3, x4, [x29, #-16]");
+
+    std::cout << "✓ Load and store test passed\n";
+}
+
+void testBranches() {
+    std::cout << "\n=== Testing Compare/Branch Fusion and Branch to Next ===\n";
+
+    // IF 3 < 4 THEN RESULTIS 1 ELSE RESULTIS 2, as the code generator emits it
+    A program;
+    program.movz(A::X1, 3, 0);
+    program.movz(A::X2, 4, 0);
+    program.cmp(A::X1, A::X2);
+    program.cset(A::X0, A::LT);
+    program.neg(A::X0, A::X0);
+    program.cbz(A::X0, "else");
+    program.movz(A::X0, 1, 0);
+    program.b("end");
+    program.setPendingLabel("else");
+    program.movz(A::X0, 2, 0);
+    program.b("end");
+    program.setPendingLabel("end");
+    program.ret();
+
+    PeepholeOptimizer::Statistics stats;
+    auto optimized = optimizeAndCompare(program, 1, stats);
+
+    assert(stats.fusedCompareBranches == 1);
+    assert(stats.foldedImmediates == 1);
+    assert(stats.branchesToNext == 1);
+    assert(countMnemonic(optimized, "b.ge") == 1);
+    assert(countMnemonic(optimized, "cset") == 0);
+    assert(countMnemonic(optimized, "cbz") == 0);
+    assert(countMnemonic(optimized, "cmp") == 1);
+    assert(optimized.back().hasLabel() && program.labelName(optimized.back().label) == "end");
+
+    // WHILE-style test through cmp/b.eq; x0 is read at the target, so the
+    // cset must stay
+    A live;
+    live.movz(A::X1, 9, 0);
+    live.movz(A::X2, 4, 0);
+    live.cmp(A::X1, A::X2);
+    live.cset(A::X0, A::GT);
+    live.neg(A::X0, A::X0);
+    live.cmp(A::X0, A::XZR);
+    live.beq("out");
+    live.movz(A::X0, 5, 0);
+    live.setPendingLabel("out");
+    live.ret();
+
+    optimized = optimizeAndCompare(live, 5, stats);
+    assert(stats.fusedCompareBranches == 0);
+
+    // Same shape with x0 redefined on both paths fuses into b.le
+    A dead;
+    dead.movz(A::X1, 9, 0);
+    dead.movz(A::X2, 4, 0);
+    dead.cmp(A::X1, A::X2);
+    dead.cset(A::X0, A::GT);
+    dead.neg(A::X0, A::X0);
+    dead.cmp(A::X0, A::XZR);
+    dead.beq("out");
+    dead.movz(A::X0, 5, 0);
+    dead.ret();
+    dead.setPendingLabel("out");
+    dead.movz(A::X0, 6, 0);
+    dead.ret();
+
+    optimized = optimizeAndCompare(dead, 5, stats);
+    assert(stats.fusedCompareBranches == 1);
+    assert(countMnemonic(optimized, "b.le") == 1);
+
+    std::cout << "✓ Branch test passed\n";
+}
+
+int main() {
+    std::cout << "Peephole Optimizer Test Suite\n";
+    std::cout << "=============================\n";
+
+    try {
+        testMovesAndCopies();
+        testLoadsAndStores();
+        testBranches();
+
+        std::cout << "\n🎉 All tests passed!\n";
+    } catch (const std::exception& e) {
+        std::cerr << "\n❌ Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}